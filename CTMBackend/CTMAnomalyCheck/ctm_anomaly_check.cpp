@@ -0,0 +1,290 @@
+#include "ctm_anomaly_check.h"
+
+//Don't really want these macros, they are messing up the std::max and std::min functions
+#undef max
+#undef min
+
+//--------------------ENTRY POINTS--------------------
+bool CTMAnomalyCheck::IsCheckModeRequested()
+{
+    int     argc = 0;
+    LPWSTR* argv = CommandLineToArgvW(GetCommandLineW(), &argc);
+    if(!argv)
+        return false;
+
+    bool isRequested = argc > 1 && wcscmp(argv[1], L"--anomaly-check") == 0;
+    LocalFree(argv);
+    return isRequested;
+}
+
+int CTMAnomalyCheck::RunFromCommandLine()
+{
+    CTMAnomalyCheckOptions checkOptions;
+    if(!ParseOptions(checkOptions))
+    {
+        CTM_LOG_TEXT("Usage: CTMApp --anomaly-check [--record <seconds>] [--max-rate <percent>] [--cores <n>] <file.csv>");
+        return 1;
+    }
+
+    CTMAnomalyCheck anomalyCheck;
+    if(checkOptions.recordSeconds > 0)
+        return anomalyCheck.Record(checkOptions.tracePath, checkOptions.recordSeconds) ? 0 : 1;
+
+    if(!anomalyCheck.Replay(checkOptions.tracePath, checkOptions.coreCount))
+        return 1;
+
+    anomalyCheck.PrintReport(checkOptions.maxFlaggedPercent);
+    bool isWithinMaxRate = std::all_of(anomalyCheck.GetSeries().begin(), anomalyCheck.GetSeries().end(),
+                                       [&](const CTMAnomalyCheckSeries& checkedSeries){ return checkedSeries.GetFlaggedPercent() <= checkOptions.maxFlaggedPercent; });
+    return isWithinMaxRate ? 0 : 1;
+}
+
+//--------------------MAIN FUNCTIONS--------------------
+bool CTMAnomalyCheck::Record(const std::wstring& tracePath, int recordSeconds)
+{
+    std::ofstream traceFile{std::filesystem::path(tracePath)};
+    if(!traceFile)
+    {
+        CTM_LOG_ERROR("Failed to open the trace file for writing.");
+        return false;
+    }
+
+    //First call only sets the previous times, the CPU usage of an interval needs both ends
+    double cpuUsage = 0.0, memoryInUse = 0.0;
+    if(!SampleSystem(cpuUsage, memoryInUse))
+    {
+        CTM_LOG_ERROR("Failed to sample the system. Error code: ", GetLastError());
+        return false;
+    }
+
+    CTM_LOG_INFO("Recording CPU and memory usage for ", recordSeconds, " seconds.");
+    traceFile << "elapsed_s,cpu_percent,memory_gb\n";
+    auto nextSampleTime = std::chrono::steady_clock::now();
+    for(int second = 1; second <= recordSeconds; second++)
+    {
+        nextSampleTime += sampleInterval;
+        std::this_thread::sleep_until(nextSampleTime);
+        if(SampleSystem(cpuUsage, memoryInUse))
+            traceFile << second << ',' << cpuUsage << ',' << memoryInUse << '\n';
+    }
+
+    CTM_LOG_SUCCESS("Trace written, replay it with 'CTMApp --anomaly-check <file.csv>'.");
+    return static_cast<bool>(traceFile);
+}
+
+bool CTMAnomalyCheck::Replay(const std::wstring& tracePath, std::uint32_t coreCount)
+{
+    std::filesystem::path traceFilePath = tracePath;
+    std::ifstream         traceFile(traceFilePath);
+    if(!traceFile)
+    {
+        CTM_LOG_ERROR("Failed to open the trace file for reading.");
+        return false;
+    }
+    traceName = traceFilePath.filename().string();
+
+    std::string              line;
+    std::vector<std::string> fields;
+    if(!std::getline(traceFile, line))
+    {
+        CTM_LOG_ERROR("The trace file is empty.");
+        return false;
+    }
+
+    //Every column we know gets its own detector, set up exactly like the one in the app
+    SplitCsvLine(line, fields);
+    for(std::size_t i = 0; i < fields.size(); i++)
+    {
+        for(auto&& knownColumn : knownColumns)
+        {
+            if(fields[i] != knownColumn.columnName)
+                continue;
+
+            CTMAnomalyCheckSeries& checkedSeries = series.emplace_back();
+            checkedSeries.columnName  = fields[i];
+            checkedSeries.minSigma    = knownColumn.minSigma;
+            checkedSeries.columnIndex = i;
+            checkedSeries.detector.SetParameters(CTMAnomalyDetector::defaultAlpha, CTMAnomalyDetector::defaultKSigma, knownColumn.minSigma);
+        }
+    }
+    if(series.empty())
+    {
+        CTM_LOG_ERROR("The trace has none of the columns the app has a detector for (cpu_percent, memory_gb or private_mb).");
+        return false;
+    }
+
+    //Only the launch profiler writes 'private_mb', and its 'cpu_percent' is 100% per core where the app's is 100% for the whole machine
+    bool isProfilerTrace = std::find(fields.begin(), fields.end(), "private_mb") != fields.end();
+    if(isProfilerTrace)
+    {
+        traceCoreCount = std::max<std::uint32_t>(coreCount > 0 ? coreCount : GetActiveProcessorCount(ALL_PROCESSOR_GROUPS), 1);
+        for(auto&& checkedSeries : series)
+            if(checkedSeries.columnName == "cpu_percent")
+                checkedSeries.valueScale = 1.0 / traceCoreCount;
+    }
+
+    //Rows of the same sample interval are averaged into one sample, a trace at the app's rate has one row per interval anyway.-
+    //-Without a time column every row is a sample
+    bool          hasTimeColumn   = !fields.empty() && fields.front() == "elapsed_s";
+    bool          hasFirstRow     = false;
+    double        firstSeconds    = 0.0;
+    double        intervalSeconds = std::chrono::duration<double>(sampleInterval).count();
+    std::uint64_t bucketIndex     = 0;
+    std::uint64_t bucketRows      = 0;
+    auto addBucket = [&](){
+        if(bucketRows == 0)
+            return;
+
+        for(auto&& checkedSeries : series)
+        {
+            ++checkedSeries.samples;
+            if(checkedSeries.detector.AddSample(checkedSeries.bucketSum / bucketRows))
+                ++checkedSeries.flaggedSamples;
+            checkedSeries.bucketSum = 0.0;
+        }
+        ++sampleCount;
+        bucketRows = 0;
+    };
+
+    while(std::getline(traceFile, line))
+    {
+        if(line.empty())
+            continue;
+
+        SplitCsvLine(line, fields);
+        ++rowCount;
+        bool isBadRow = std::any_of(series.begin(), series.end(),
+                                    [&fields](const CTMAnomalyCheckSeries& checkedSeries){ return checkedSeries.columnIndex >= fields.size(); });
+        if(isBadRow)
+        {
+            ++badRowCount;
+            continue;
+        }
+
+        std::uint64_t rowBucketIndex = rowCount - badRowCount;
+        if(hasTimeColumn)
+        {
+            //First row that made it this far, a skipped one before it doesn't get to set the start
+            double seconds = std::strtod(fields.front().c_str(), nullptr);
+            if(!hasFirstRow)
+                firstSeconds = seconds;
+            traceSeconds   = seconds - firstSeconds;
+            rowBucketIndex = static_cast<std::uint64_t>(std::max(0.0, traceSeconds) / intervalSeconds);
+        }
+        hasFirstRow = true;
+
+        if(rowBucketIndex != bucketIndex)
+        {
+            addBucket();
+            bucketIndex = rowBucketIndex;
+        }
+        for(auto&& checkedSeries : series)
+            checkedSeries.bucketSum += std::strtod(fields[checkedSeries.columnIndex].c_str(), nullptr) * checkedSeries.valueScale;
+        ++bucketRows;
+    }
+    addBucket();
+
+    return true;
+}
+
+void CTMAnomalyCheck::PrintReport(double maxFlaggedPercent)
+{
+    std::printf("\n--------------------CTM ANOMALY CHECK--------------------\n");
+    std::printf("Trace                        : %s\n", traceName.c_str());
+    std::printf("Rows                         : %llu  (%llu skipped, too few columns)\n",
+                static_cast<unsigned long long>(rowCount), static_cast<unsigned long long>(badRowCount));
+    std::printf("Samples                      : %llu, rows averaged over %lld s each\n",
+                static_cast<unsigned long long>(sampleCount), static_cast<long long>(sampleInterval.count()));
+    if(traceCoreCount > 0)
+        std::printf("Launch profiler trace        : CPU divided by %u cores (100%% = the whole machine, like in the app)\n", traceCoreCount);
+    if(traceSeconds > 0.0)
+        std::printf("Duration                     : %.1lf minutes\n", traceSeconds / 60.0);
+    std::printf("Detector                     : EWMA, alpha %.2lf, flags beyond %.1lf sigma\n", CTMAnomalyDetector::defaultAlpha, CTMAnomalyDetector::defaultKSigma);
+    std::printf("\n");
+
+    //On a quiet trace every flag is a false positive, the per hour number is what it would look like on the graphs
+    for(auto&& checkedSeries : series)
+    {
+        double flaggedPercent = checkedSeries.GetFlaggedPercent();
+        std::printf("%-29s: %8llu flagged of %8llu  (%7.3lf%%", checkedSeries.columnName.c_str(),
+                    static_cast<unsigned long long>(checkedSeries.flaggedSamples), static_cast<unsigned long long>(checkedSeries.samples), flaggedPercent);
+        if(traceSeconds > 0.0)
+            std::printf(", %.1lf per hour", checkedSeries.flaggedSamples * 3600.0 / traceSeconds);
+        std::printf(", min sigma %g)%s\n", checkedSeries.minSigma, flaggedPercent > maxFlaggedPercent ? "  OVER THE MAX RATE" : "");
+    }
+    std::printf("---------------------------------------------------------\n");
+}
+
+//--------------------HELPER FUNCTIONS--------------------
+bool CTMAnomalyCheck::ParseOptions(CTMAnomalyCheckOptions& outOptions)
+{
+    int     argc = 0;
+    LPWSTR* argv = CommandLineToArgvW(GetCommandLineW(), &argc);
+    if(!argv)
+        return false;
+
+    for(int i = 2; i < argc; i++)
+    {
+        if(wcscmp(argv[i], L"--record") == 0 && i + 1 < argc)
+            outOptions.recordSeconds = std::clamp(_wtoi(argv[++i]), 1, 7 * 24 * 3600);
+        else if(wcscmp(argv[i], L"--max-rate") == 0 && i + 1 < argc)
+            outOptions.maxFlaggedPercent = std::clamp(_wtof(argv[++i]), 0.0, 100.0);
+        else if(wcscmp(argv[i], L"--cores") == 0 && i + 1 < argc)
+            outOptions.coreCount = static_cast<std::uint32_t>(std::clamp(_wtoi(argv[++i]), 1, 4096));
+        else if(wcsncmp(argv[i], L"--", 2) != 0)
+            outOptions.tracePath = argv[i];
+        else
+            CTM_LOG_WARNING("Ignoring unknown anomaly check option at position ", i, ".");
+    }
+    LocalFree(argv);
+
+    return !outOptions.tracePath.empty();
+}
+
+void CTMAnomalyCheck::SplitCsvLine(const std::string& line, std::vector<std::string>& outFields)
+{
+    //Nothing we write or read has quoted fields, a plain split is enough
+    outFields.clear();
+    std::size_t fieldStart = 0;
+    while(true)
+    {
+        std::size_t fieldEnd = line.find(',', fieldStart);
+        outFields.emplace_back(line, fieldStart, fieldEnd == std::string::npos ? std::string::npos : fieldEnd - fieldStart);
+        if(fieldEnd == std::string::npos)
+            break;
+        fieldStart = fieldEnd + 1;
+    }
+
+    //Files written on windows keep their '\r'
+    if(!outFields.back().empty() && outFields.back().back() == '\r')
+        outFields.back().pop_back();
+}
+
+bool CTMAnomalyCheck::SampleSystem(double& outCpuUsage, double& outMemoryInUse)
+{
+    //Same math as the performance history, CPU in % of every core and memory in use in GB
+    FILETIME ftIdleTime, ftKernelTime, ftUserTime;
+    if(!GetSystemTimes(&ftIdleTime, &ftKernelTime, &ftUserTime))
+        return false;
+
+    ULARGE_INTEGER currentIdleTime   = reinterpret_cast<ULARGE_INTEGER&>(ftIdleTime),
+                   currentKernelTime = reinterpret_cast<ULARGE_INTEGER&>(ftKernelTime),
+                   currentUserTime   = reinterpret_cast<ULARGE_INTEGER&>(ftUserTime);
+
+    //Kernel time includes idle time
+    ULONGLONG totalTimeDiff = (currentKernelTime.QuadPart + currentUserTime.QuadPart) - (prevKernelTime.QuadPart + prevUserTime.QuadPart);
+    ULONGLONG idleTimeDiff  = currentIdleTime.QuadPart - prevIdleTime.QuadPart;
+
+    prevIdleTime   = currentIdleTime;
+    prevKernelTime = currentKernelTime;
+    prevUserTime   = currentUserTime;
+    outCpuUsage    = totalTimeDiff ? ((100.0 * (totalTimeDiff - idleTimeDiff)) / totalTimeDiff) : 0.0;
+
+    MEMORYSTATUSEX memStatus = {};
+    memStatus.dwLength = sizeof(MEMORYSTATUSEX);
+    if(!GlobalMemoryStatusEx(&memStatus))
+        return false;
+
+    outMemoryInUse = CTM_BYTES_TO_GB(memStatus.ullTotalPhys) - CTM_BYTES_TO_GB(memStatus.ullAvailPhys);
+    return true;
+}
@@ -0,0 +1,119 @@
+#ifndef CTM_ANOMALY_CHECK_HPP
+#define CTM_ANOMALY_CHECK_HPP
+
+//Windows stuff
+#include <windows.h>
+#include <shellapi.h>
+//My stuff
+#include "../CTMPureHeaderFiles/ctm_logger.h"
+#include "../CTMPureHeaderFiles/ctm_constants.h"
+#include "../CTMPureHeaderFiles/ctm_anomaly_detector.h"
+//Stdlib stuff
+#include <vector>
+#include <string>
+#include <chrono>
+#include <thread>
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <cwchar>
+
+//Options parsed from 'CTMApp --anomaly-check [--record <seconds>] [--max-rate <percent>] [--cores <n>] <file.csv>'
+struct CTMAnomalyCheckOptions
+{
+    std::wstring  tracePath;
+    double        maxFlaggedPercent = 100.0; //Share of flagged samples above which the check fails, the default never does
+    int           recordSeconds     = 0;     //Above 0 -> sample the system for this long and write the trace instead of checking it
+    std::uint32_t coreCount         = 0;     //Logical processors of the machine a launch profiler trace was recorded on, 0 -> this one's
+};
+
+//Column of a trace the app has a detector for, and what that detector made of it
+struct CTMAnomalyCheckSeries
+{
+    CTMAnomalyDetector detector;
+    std::string        columnName;
+    double             minSigma       = 0.0;
+    double             valueScale     = 1.0; //Trace value -> what the app's detector gets
+    double             bucketSum      = 0.0; //Scaled values of the rows in the current sample interval
+    std::size_t        columnIndex    = 0;
+    std::uint64_t      samples        = 0;
+    std::uint64_t      flaggedSamples = 0;
+
+    double GetFlaggedPercent() const { return samples > 0 ? flaggedSamples * 100.0 / samples : 0.0; }
+};
+
+//Name in the trace header -> lower bound of sigma the app uses for it
+struct CTMAnomalyCheckColumn
+{
+    const char* columnName;
+    double      minSigma;
+};
+
+using AnomalyCheckSeriesVector = std::vector<CTMAnomalyCheckSeries>;
+
+/*
+ * Headless check of the anomaly detector (check ctm_anomaly_detector.h) against recorded traces, no window and no administrator rights needed.
+ * '--record <seconds>' samples total CPU usage and memory in use once a second (same math and rate as the performance graphs) into a CSV.
+ * Without it the CSV is replayed: every column the app has a detector for gets one with the exact same parameters, and the report-
+ * -says how many samples it flagged. On a quiet trace every flag is a false positive, '--max-rate' turns that into a pass/fail.
+ * The launch profiler's '--csv' files (check ctm_launch_profiler.h) replay too, their CPU and private memory go through the per process detectors.
+ * Rows are averaged into samples of the app's interval first (the profiler samples every 50 ms), and the profiler's CPU (100% per core)-
+ * -is divided by the core count, so the detectors see what they would in the app.
+ */
+class CTMAnomalyCheck
+{
+public:
+    CTMAnomalyCheck() = default;
+    ~CTMAnomalyCheck() = default;
+
+    //No need for copy or move operations
+    CTMAnomalyCheck(const CTMAnomalyCheck&)            = delete;
+    CTMAnomalyCheck& operator=(const CTMAnomalyCheck&) = delete;
+    CTMAnomalyCheck(CTMAnomalyCheck&&)                 = delete;
+    CTMAnomalyCheck& operator=(CTMAnomalyCheck&&)      = delete;
+
+public: //Entry points used by main
+    static bool IsCheckModeRequested();
+    //0 if every series stayed at or under '--max-rate', meant to be returned from main
+    static int  RunFromCommandLine();
+
+public: //Main functions
+    bool Record(const std::wstring&, int);
+    //Core count only matters for launch profiler traces, 0 -> this machine's
+    bool Replay(const std::wstring&, std::uint32_t);
+    void PrintReport(double);
+
+public: //Getter functions
+    const AnomalyCheckSeriesVector& GetSeries() const { return series; }
+
+private: //Helper functions
+    static bool ParseOptions(CTMAnomalyCheckOptions&);
+    static void SplitCsvLine(const std::string&, std::vector<std::string>&);
+    bool        SampleSystem(double&, double&);
+
+private: //Replayed trace
+    AnomalyCheckSeriesVector series;
+    std::string              traceName;
+    double                   traceSeconds   = 0.0; //From the first column, if it is a time column
+    std::uint64_t            rowCount       = 0;
+    std::uint64_t            badRowCount    = 0;   //Rows with fewer columns than the header, skipped
+    std::uint64_t            sampleCount    = 0;   //Sample intervals the rows were averaged into
+    std::uint32_t            traceCoreCount = 0;   //CPU was divided by this, 0 -> not a launch profiler trace
+
+private: //Recording state
+    ULARGE_INTEGER prevIdleTime = {}, prevKernelTime = {}, prevUserTime = {};
+
+private: //Constant stuff
+    //What 'Record' writes and the launch profiler's CSV, per process memory is in MB there
+    constexpr static CTMAnomalyCheckColumn knownColumns[] = {
+        {"cpu_percent", CTMAnomalyMinSigma::cpuUsage},
+        {"memory_gb",   CTMAnomalyMinSigma::memoryInUse},
+        {"private_mb",  CTMAnomalyMinSigma::processMemory}
+    };
+    constexpr static std::chrono::seconds sampleInterval{1};
+};
+
+#endif
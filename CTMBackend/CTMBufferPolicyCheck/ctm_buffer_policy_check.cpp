@@ -0,0 +1,95 @@
+#include "ctm_buffer_policy_check.h"
+
+//--------------------ENTRY POINTS--------------------
+bool CTMBufferPolicyCheck::IsCheckModeRequested()
+{
+    int     argc = 0;
+    LPWSTR* argv = CommandLineToArgvW(GetCommandLineW(), &argc);
+    if(!argv)
+        return false;
+
+    bool isRequested = argc > 1 && wcscmp(argv[1], L"--buffer-policy-check") == 0;
+    LocalFree(argv);
+    return isRequested;
+}
+
+int CTMBufferPolicyCheck::RunFromCommandLine()
+{
+    CTMBufferPolicyCheck policyCheck;
+    policyCheck.Run();
+    policyCheck.PrintReport();
+    return policyCheck.IsPassing() ? 0 : 1;
+}
+
+//--------------------MAIN FUNCTIONS--------------------
+void CTMBufferPolicyCheck::Run()
+{
+    //Worked out by hand from the policy constants (128 byte events, 2 s bursts, 0.1 s fills, 256 MB cap), changing those means redoing these
+    struct SizingCase
+    {
+        const char*          description;
+        std::uint32_t        logicalProcessors;
+        CTMEtwBufferSettings settings;
+        CTMEtwBufferSizing   expected;
+    };
+    const SizingCase sizingCases[] = {
+        {"8 CPUs, nothing seen yet (20K events/s)",          8,    {},                    {64,   16,   95,    1}},
+        {"16 CPUs at 1M events/s, biggest buffers, at cap",  16,   {1000000.0},           {1024, 32,   256,   1}},
+        {"256 CPUs at 1M events/s, small buffers, at cap",   256,  {1000000.0},           {64,   512,  4096,  1}},
+        {"4096 CPUs, the minimum alone is over the cap",     4096, {1000000.0},           {64,   8192, 12288, 1}},
+        {"0 CPUs reported, taken as 1",                      0,    {},                    {256,  2,    22,    1}},
+        {"Settings win, clamped to what the kernel takes",   8,    {0.0, 2048, 4, 10, 5}, {1024, 16,   24,    5}}
+    };
+
+    //Running session, the maximum is the only thing which can still change
+    struct GrowCase
+    {
+        const char*        description;
+        CTMEtwBufferSizing sizing;
+        double             observedEventRate;
+        bool               isLosingEvents;
+        std::uint32_t      expectedMaximum;
+    };
+    const GrowCase growCases[] = {
+        {"Rate went up to 100K events/s",                 {64,   16, 95,  1}, 100000.0,  false, 407},
+        {"Rate went down, the maximum never shrinks",     {64,   16, 95,  1}, 1000.0,    false, 95},
+        {"Quiet but losing events, half again on top",    {64,   16, 95,  1}, 1000.0,    true,  142},
+        {"Losing events at the memory cap, stays there",  {1024, 32, 256, 1}, 1000000.0, true,  256}
+    };
+
+    failedCases.clear();
+    char failedCase[256];
+    for(auto&& sizingCase : sizingCases)
+    {
+        CTMEtwBufferSizing sizing = CTMEtwBufferPolicy::Compute(sizingCase.logicalProcessors, sizingCase.settings);
+        if(sizing == sizingCase.expected)
+            continue;
+
+        std::snprintf(failedCase, sizeof(failedCase), "%s: %u KB x %u..%u buffers, %u s flush (expected %u KB x %u..%u, %u s)",
+                      sizingCase.description, sizing.bufferSizeKB, sizing.minimumBuffers, sizing.maximumBuffers, sizing.flushTimerSeconds,
+                      sizingCase.expected.bufferSizeKB, sizingCase.expected.minimumBuffers, sizingCase.expected.maximumBuffers,
+                      sizingCase.expected.flushTimerSeconds);
+        failedCases.emplace_back(failedCase);
+    }
+
+    for(auto&& growCase : growCases)
+    {
+        std::uint32_t maximumBuffers = CTMEtwBufferPolicy::GrowMaximumBuffers(growCase.sizing, growCase.observedEventRate, growCase.isLosingEvents);
+        if(maximumBuffers == growCase.expectedMaximum)
+            continue;
+
+        std::snprintf(failedCase, sizeof(failedCase), "%s: grew to %u buffers (expected %u)", growCase.description, maximumBuffers, growCase.expectedMaximum);
+        failedCases.emplace_back(failedCase);
+    }
+
+    caseCount = std::size(sizingCases) + std::size(growCases);
+}
+
+void CTMBufferPolicyCheck::PrintReport()
+{
+    std::printf("\n--------------------CTM BUFFER POLICY CHECK--------------------\n");
+    std::printf("ETW buffer sizing policy     : %zu of %zu cases as worked out\n", caseCount - failedCases.size(), caseCount);
+    for(auto&& failedCase : failedCases)
+        std::printf("    %s\n", failedCase.c_str());
+    std::printf("---------------------------------------------------------------\n");
+}
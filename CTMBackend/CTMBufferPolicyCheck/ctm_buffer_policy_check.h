@@ -0,0 +1,51 @@
+#ifndef CTM_BUFFER_POLICY_CHECK_HPP
+#define CTM_BUFFER_POLICY_CHECK_HPP
+
+//Windows stuff
+#include <windows.h>
+#include <shellapi.h>
+//My stuff
+#include "../CTMPureHeaderFiles/ctm_logger.h"
+#include "../CTMProcessScreen/ctm_etw_buffer_policy.h"
+//Stdlib stuff
+#include <vector>
+#include <string>
+#include <iterator>
+#include <cstdint>
+#include <cstdio>
+#include <cwchar>
+
+/*
+ * Headless check of the ETW buffer sizing (check ctm_etw_buffer_policy.h) against cases worked out by hand.
+ * The real session can't be started without administrator rights, but its sizing is plain math and can be checked anywhere.
+ */
+class CTMBufferPolicyCheck
+{
+public:
+    CTMBufferPolicyCheck() = default;
+    ~CTMBufferPolicyCheck() = default;
+
+    //No need for copy or move operations
+    CTMBufferPolicyCheck(const CTMBufferPolicyCheck&)            = delete;
+    CTMBufferPolicyCheck& operator=(const CTMBufferPolicyCheck&) = delete;
+    CTMBufferPolicyCheck(CTMBufferPolicyCheck&&)                 = delete;
+    CTMBufferPolicyCheck& operator=(CTMBufferPolicyCheck&&)      = delete;
+
+public: //Entry points used by main
+    static bool IsCheckModeRequested();
+    //0 if every case came out as worked out, meant to be returned from main
+    static int  RunFromCommandLine();
+
+public: //Main functions
+    void Run();
+    void PrintReport();
+
+public: //Getter functions
+    bool IsPassing() const { return failedCases.empty(); }
+
+private: //Check stuff
+    std::vector<std::string> failedCases; //What the case was about, and what the policy came up with
+    std::size_t              caseCount = 0;
+};
+
+#endif
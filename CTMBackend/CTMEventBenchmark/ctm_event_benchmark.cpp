@@ -0,0 +1,917 @@
+#include "ctm_event_benchmark.h"
+
+//Don't really want these macros, they are messing up the std::max and std::min functions
+#undef max
+#undef min
+
+//--------------------ENTRY POINTS--------------------
+bool CTMEventBenchmark::IsBenchmarkModeRequested()
+{
+    int     argc = 0;
+    LPWSTR* argv = CommandLineToArgvW(GetCommandLineW(), &argc);
+    if(!argv)
+        return false;
+
+    bool isRequested = argc > 1 && wcscmp(argv[1], L"--event-benchmark") == 0;
+    LocalFree(argv);
+    return isRequested;
+}
+
+int CTMEventBenchmark::RunFromCommandLine()
+{
+    CTMEventBenchmarkOptions benchmarkOptions;
+    if(!ParseOptions(benchmarkOptions))
+    {
+        CTM_LOG_TEXT("Usage: CTMApp --event-benchmark [--lossy] [--record <file>] [--publish-every <ms>] [--event-source synthetic|replay] [--replay-file <file>]\n"
+                     "       [--replay-speed <x>] [--events <n>] [--rate <events/s>] [--pids <n>] [--flows <n>] [--skew <s>]\n"
+                     "       [--files <n>] [--file-skew <s>] [--ipv6-share <0..1>] [--mix <tcpSent,tcpRecv,udpSent,udpRecv,fileRead,fileWrite>] [--seed <n>]\n"
+                     "       [--sample-above <events/s>]");
+        return 1;
+    }
+
+    //Recording only, nothing to measure
+    if(!benchmarkOptions.recordPath.empty())
+    {
+        CTMSyntheticEventSource generator(benchmarkOptions.sourceOptions.synthetic);
+        return generator.WriteRecording(benchmarkOptions.recordPath, benchmarkOptions.sourceOptions.synthetic.maxEvents) ? 0 : 1;
+    }
+
+    CTMEventBenchmark benchmark;
+    if(!benchmark.Run(benchmarkOptions))
+        return 1;
+
+    benchmark.PrintReport();
+    return benchmark.IsPassing() ? 0 : 1;
+}
+
+//--------------------MAIN FUNCTIONS--------------------
+bool CTMEventBenchmark::Run(const CTMEventBenchmarkOptions& benchmarkOptions)
+{
+    options = benchmarkOptions;
+    processBytes.clear();
+
+    std::unique_ptr<CTMEventSource> eventSource = CTMEventSource::Create(options.sourceOptions);
+    sourceName = eventSource->GetName();
+
+    globalUsageEventPipeline.SetSamplingThreshold(options.sourceOptions.samplingThreshold);
+    globalUsageEventPipeline.Start();
+    if(!eventSource->Start())
+    {
+        globalUsageEventPipeline.Stop();
+        return false;
+    }
+
+    //Ready latencies ride along with the synthetic switches (a replay has none), the switches go on the generated clock like everything else
+    bool isReadyEnabled = options.sourceOptions.type == CTMEventSourceType::Synthetic && eventSource->SetProviderEnabled(CTMEventProvider::KernelReadyThread, true);
+    bool isDpcEnabled   = options.sourceOptions.type == CTMEventSourceType::Synthetic && eventSource->SetProviderEnabled(CTMEventProvider::KernelDpc, true);
+
+    //Reads while the aggregator writes, the way the process screen does while ETW events come in
+    std::atomic<bool> isSourceDone = false;
+    std::thread       publishThread;
+    if(options.publishIntervalMs > 0.0)
+        publishThread = std::thread(&CTMEventBenchmark::PublishConcurrently, this, std::cref(isSourceDone));
+
+    //Source runs on this thread, it returns once it is out of events
+    auto startTime = std::chrono::steady_clock::now();
+    bool isSuccess = eventSource->ProcessEvents();
+    auto produceEndTime = std::chrono::steady_clock::now();
+
+    //Whatever is still in the rings belongs to the run as well
+    while(!globalUsageEventPipeline.IsDrained() || !globalReadyLatencyTracker.IsDrained() || !globalDpcLatencyTracker.IsDrained())
+        std::this_thread::yield();
+    auto pipelineEndTime = std::chrono::steady_clock::now();
+
+    isSourceDone.store(true);
+    if(publishThread.joinable())
+        publishThread.join();
+
+    //Source ran on this thread, so it is done with the switches by now
+    std::uint64_t contextSwitchCount = isReadyEnabled ? static_cast<CTMSyntheticEventSource*>(eventSource.get())->GetContextSwitchCount() : 0;
+    std::uint64_t dpcCount           = isDpcEnabled   ? static_cast<CTMSyntheticEventSource*>(eventSource.get())->GetDpcCount() : 0;
+    if(isReadyEnabled)
+        eventSource->SetProviderEnabled(CTMEventProvider::KernelReadyThread, false);
+    if(isDpcEnabled)
+        eventSource->SetProviderEnabled(CTMEventProvider::KernelDpc, false);
+    eventSource->Stop();
+    globalUsageEventPipeline.Stop();
+    if(!isSuccess)
+    {
+        CTM_LOG_ERROR("The event source failed while the benchmark was running.");
+        return false;
+    }
+
+    CTMEventTracingDiagnostics diagnostics = eventSource->GetDiagnostics();
+    result.produceSeconds   = std::chrono::duration<double>(produceEndTime - startTime).count();
+    result.pipelineSeconds  = std::chrono::duration<double>(pipelineEndTime - startTime).count();
+    result.eventsReceived   = diagnostics.eventsReceived;
+    result.eventsAggregated = diagnostics.eventsAggregated;
+    result.eventsDropped    = diagnostics.ringDrops;
+    result.eventsSampledOut = diagnostics.eventsSampledOut;
+    result.aggregationNs    = diagnostics.aggregationNanoseconds;
+
+    //The UI side, timed on its own as it runs once a second and not per event. With '--publish-every' this picks up the last epoch
+    auto publishStartTime = std::chrono::steady_clock::now();
+    Publish();
+    result.publishSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - publishStartTime).count();
+
+    //Exact counts come from generating the stream again, a replay can't be played twice cheaply and dropped events would be missing from the sketch only
+    if(options.sourceOptions.type == CTMEventSourceType::Synthetic && result.eventsDropped == 0)
+    {
+        CheckSampling();
+        //Sampled runs only have estimates, both of these check bounds on exact counts
+        if(result.eventsSampledOut == 0)
+        {
+            CheckTopFiles();
+            CheckFileLatencies();
+        }
+        //Switches never go through the pipeline, sampling doesn't touch them
+        if(isReadyEnabled && globalReadyLatencyTracker.GetStats().ringDrops == 0)
+            CheckReadyLatencies(contextSwitchCount);
+        if(isDpcEnabled && globalDpcLatencyTracker.GetStats().ringDrops == 0)
+            CheckDpcLatencies(dpcCount);
+    }
+
+    //Nothing to do with the event source, but the handles screen's counting is the other hot loop fed by a big kernel buffer
+    CheckHandleCounting();
+    //The two stages the source and the aggregator time together above, each on its own
+    CheckDecoder();
+    CheckFlowTable();
+
+    globalUsageEventPipeline.SetSamplingThreshold(0.0);
+    globalProcessUsageTable.Clear();
+    globalNetworkFlowTable.Clear();
+    globalFileUsageTracker.Clear();
+    globalFileLatencyTracker.Clear();
+    globalReadyLatencyTracker.Clear();
+    globalDpcLatencyTracker.Clear();
+    return true;
+}
+
+void CTMEventBenchmark::PrintReport()
+{
+    auto nsPerEvent = [](double seconds, std::uint64_t eventCount){
+        return eventCount > 0 ? seconds * 1e9 / eventCount : 0.0;
+    };
+    auto eventsPerSecond = [](double seconds, std::uint64_t eventCount){
+        return seconds > 0.0 ? eventCount / seconds : 0.0;
+    };
+
+    std::printf("\n--------------------CTM EVENT BENCHMARK--------------------\n");
+    std::printf("Event source                 : %s%s\n", sourceName.c_str(), options.isLossy ? " (lossy, full rings drop)" : "");
+    std::printf("Events published             : %llu\n", static_cast<unsigned long long>(result.eventsReceived));
+    std::printf("Events aggregated            : %llu\n", static_cast<unsigned long long>(result.eventsAggregated));
+    std::printf("Events dropped (rings full)  : %llu\n", static_cast<unsigned long long>(result.eventsDropped));
+    std::printf("Events sampled out           : %llu\n", static_cast<unsigned long long>(result.eventsSampledOut));
+    std::printf("\n");
+    std::printf("Decode + publish (source)    : %12.0lf events/s  %8.1lf ns/event\n",
+                eventsPerSecond(result.produceSeconds, result.eventsReceived), nsPerEvent(result.produceSeconds, result.eventsReceived));
+    std::printf("Aggregate (aggregator busy)  : %12.0lf events/s  %8.1lf ns/event\n",
+                eventsPerSecond(result.aggregationNs / 1e9, result.eventsAggregated), nsPerEvent(result.aggregationNs / 1e9, result.eventsAggregated));
+    std::printf("End to end (wall clock)      : %12.0lf events/s  %8.1lf ns/event  (%.3lf s)\n",
+                eventsPerSecond(result.pipelineSeconds, result.eventsAggregated), nsPerEvent(result.pipelineSeconds, result.eventsAggregated),
+                result.pipelineSeconds);
+    std::printf("Publish (one UI update)      : %12.1lf us for %zu processes and %zu flows\n",
+                result.publishSeconds * 1e6, result.publishedProcesses, result.publishedFlows);
+    if(options.publishIntervalMs > 0.0)
+    {
+        //Dropped events and the byte check below are the other half of it, a reader which slows the aggregator down shows up as drops
+        if(options.sourceOptions.type == CTMEventSourceType::Synthetic)
+            std::printf("Source rate asked for        : %12.0lf events/s\n", options.sourceOptions.synthetic.eventsPerSecond);
+        std::printf("Publishes while running      : %12llu every %.1lf ms  %8.1lf us average  %8.1lf us worst\n",
+                    static_cast<unsigned long long>(result.concurrentPublishes), options.publishIntervalMs,
+                    result.concurrentPublishes > 0 ? result.concurrentPublishSeconds * 1e6 / result.concurrentPublishes : 0.0,
+                    result.maxPublishSeconds * 1e6);
+        std::printf("Epoch swap, worst            : %12.1lf us (waits for the aggregator batch in progress)\n", result.maxAdvanceEpochSeconds * 1e6);
+        if(!samplingResult.isChecked)
+            std::printf("Counters across the swaps    : not checked (only for synthetic runs with nothing dropped)\n");
+    }
+    //What sampling is there to save, compare this one between runs with and without '--sample-above'
+    std::printf("Aggregator busy, whole run   : %12.1lf ms  %8.1lf ns per published event\n",
+                result.aggregationNs / 1e6, nsPerEvent(result.aggregationNs / 1e9, result.eventsReceived));
+    std::printf("\n");
+
+    if(handleCountResult.isChecked)
+    {
+        std::printf("Handle table counting        : %12.0lf handles/s  %8.1lf ns/handle  (%.1lf ms first pass, %.1lf ms with deltas)\n",
+                    eventsPerSecond(handleCountResult.nextPassSeconds, handleCountResult.handleCount),
+                    nsPerEvent(handleCountResult.nextPassSeconds, handleCountResult.handleCount),
+                    handleCountResult.firstPassSeconds * 1e3, handleCountResult.nextPassSeconds * 1e3);
+        std::printf("Handles counted              : %llu over %zu processes and %zu types, %zu counts off%s\n",
+                    static_cast<unsigned long long>(handleCountResult.handleCount), handleCountResult.processCount, handleCountResult.typeCount,
+                    handleCountResult.countMismatches, handleCountResult.IsWithinBounds() ? "" : "  COUNTS DON'T ADD UP");
+        std::printf("\n");
+    }
+
+    if(decoderResult.isChecked)
+    {
+        std::printf("Decode only (fixed schemas)  : %12.0lf events/s  %8.1lf ns/event  (%llu events, %llu network, %llu failed)%s\n",
+                    eventsPerSecond(decoderResult.decodeSeconds, decoderResult.eventCount), nsPerEvent(decoderResult.decodeSeconds, decoderResult.eventCount),
+                    static_cast<unsigned long long>(decoderResult.eventCount), static_cast<unsigned long long>(decoderResult.networkEvents),
+                    static_cast<unsigned long long>(decoderResult.failedEvents), decoderResult.IsWithinBounds() ? "" : "  DECODER TURNED EVENTS DOWN");
+    }
+    if(flowTableResult.isChecked)
+    {
+        double flowTableRate = eventsPerSecond(flowTableResult.addSeconds, flowTableResult.recordCount);
+        std::printf("Flow table only              : %12.0lf events/s  %8.1lf ns/event  (%s the %.0lf events/s target)\n",
+                    flowTableRate, nsPerEvent(flowTableResult.addSeconds, flowTableResult.recordCount),
+                    flowTableRate >= flowTableTargetRate ? "meets" : "MISSES", flowTableTargetRate);
+        std::printf("Flow table entries           : %zu of %zu, %llu evicted, %zu flows in the stream%s\n",
+                    flowTableResult.entryCount, flowTableResult.capacity, static_cast<unsigned long long>(flowTableResult.evictedCount),
+                    flowTableResult.flowCount, flowTableResult.IsWithinBounds() ? "" : "  OVER THE CAP OR NEVER EVICTED");
+    }
+    if(decoderResult.isChecked || flowTableResult.isChecked)
+        std::printf("\n");
+
+    if(samplingResult.isChecked)
+    {
+        auto toMb = [](std::uint64_t bytes){ return static_cast<double>(bytes) / (1024.0 * 1024.0); };
+        double bytesError = samplingResult.exactBytes > 0 ?
+                            (static_cast<double>(samplingResult.estimatedBytes) - static_cast<double>(samplingResult.exactBytes)) * 100.0 / samplingResult.exactBytes : 0.0;
+        if(samplingResult.isSampled)
+            std::printf("Sampling                     : 1 in %.1lf events kept on average (above %.0lf events/s)\n",
+                        1.0 / samplingResult.keptShare, options.sourceOptions.samplingThreshold);
+        else
+            std::printf("Sampling                     : %s\n", samplingResult.IsWithinBounds() ? "off, every byte accounted for" : "off, BYTES DON'T ADD UP");
+        std::printf("Bytes of every process       : %12.1lf MB shown  %12.1lf MB exact  (%+.3lf%%)\n",
+                    toMb(samplingResult.estimatedBytes), toMb(samplingResult.exactBytes), bytesError);
+        std::printf("Process shares, worst        : %12.4lf percentage points off over %zu processes\n",
+                    samplingResult.maxShareError, samplingResult.processCount);
+        std::printf("Busiest 10 processes, worst  : %12.3lf%% off their exact bytes\n", samplingResult.maxTopRelativeError * 100.0);
+        std::printf("\n");
+    }
+
+    if(readyLatencyResult.isChecked)
+    {
+        const CTMReadyLatencyStats& readyStats = readyLatencyResult.stats;
+        const CTMLatencySummary&    exact      = readyLatencyResult.exactSystem;
+        const CTMLatencySummary&    measured   = readyLatencyResult.measuredSystem;
+        std::printf("Ready latency histograms     : %s\n", readyLatencyResult.IsWithinBounds() ? "within a bucket of the exact percentiles" : "OUTSIDE OF THEIR BOUND");
+        std::printf("Switches matched to a ready  : %llu of %llu over %zu processes  (%llu overwritten, %llu too long, %llu dropped)\n",
+                    static_cast<unsigned long long>(readyStats.matched), static_cast<unsigned long long>(readyLatencyResult.expectedSamples),
+                    readyLatencyResult.processCount, static_cast<unsigned long long>(readyStats.overwritten),
+                    static_cast<unsigned long long>(readyStats.tooLong), static_cast<unsigned long long>(readyStats.ringDrops));
+        std::printf("Ready latency, histogram     : %8llu %8llu %8llu %8llu us (p50 p95 p99 max)\n",
+                    static_cast<unsigned long long>(measured.p50), static_cast<unsigned long long>(measured.p95),
+                    static_cast<unsigned long long>(measured.p99), static_cast<unsigned long long>(measured.max));
+        std::printf("Ready latency, exact         : %8llu %8llu %8llu %8llu us (p50 p95 p99 max)\n",
+                    static_cast<unsigned long long>(exact.p50), static_cast<unsigned long long>(exact.p95),
+                    static_cast<unsigned long long>(exact.p99), static_cast<unsigned long long>(exact.max));
+        std::printf("Percentiles outside their bucket : %zu  (%zu KB for the tracker)\n", readyLatencyResult.percentileViolations, readyStats.memoryUsage / 1024);
+        std::printf("\n");
+    }
+
+    if(dpcLatencyResult.isChecked)
+    {
+        const CTMDpcLatencyStats& dpcStats = dpcLatencyResult.stats;
+        auto printSummary = [](const char* label, const CTMLatencySummary& summary){
+            std::printf("%s: %8llu %8llu %8llu %8llu us (p50 p95 p99 max)\n", label, static_cast<unsigned long long>(summary.p50),
+                        static_cast<unsigned long long>(summary.p95), static_cast<unsigned long long>(summary.p99), static_cast<unsigned long long>(summary.max));
+        };
+        std::printf("DPC/ISR latency histograms   : %s\n", dpcLatencyResult.IsWithinBounds() ? "within a bucket of the exact percentiles" : "OUTSIDE OF THEIR BOUND");
+        std::printf("DPCs and ISRs recorded       : %llu of %llu over %zu drivers  (%llu bad timestamps, %llu dropped, %zu cores off)\n",
+                    static_cast<unsigned long long>(dpcStats.dpcEvents + dpcStats.isrEvents), static_cast<unsigned long long>(dpcLatencyResult.expectedSamples),
+                    dpcLatencyResult.driverCount, static_cast<unsigned long long>(dpcStats.badTimestamps),
+                    static_cast<unsigned long long>(dpcStats.ringDrops), dpcLatencyResult.coreMismatches);
+        printSummary("DPC latency, histogram       ", dpcLatencyResult.measuredDpc);
+        printSummary("DPC latency, exact           ", dpcLatencyResult.exactDpc);
+        printSummary("ISR latency, histogram       ", dpcLatencyResult.measuredIsr);
+        printSummary("ISR latency, exact           ", dpcLatencyResult.exactIsr);
+        std::printf("Runs over the threshold      : %llu  (exact %llu to %llu, %u us)\n", static_cast<unsigned long long>(dpcStats.longEvents),
+                    static_cast<unsigned long long>(dpcLatencyResult.minLongCount), static_cast<unsigned long long>(dpcLatencyResult.maxLongCount),
+                    globalDpcLatencyTracker.GetThreshold());
+        std::printf("Percentiles outside their bucket : %zu  (%zu KB for the tracker)\n", dpcLatencyResult.percentileViolations, dpcStats.memoryUsage / 1024);
+        std::printf("\n");
+    }
+
+    if(!topFilesResult.isChecked)
+    {
+        std::printf("Top files sketch             : not checked (only for synthetic runs with nothing dropped or sampled)\n");
+        std::printf("-----------------------------------------------------------\n");
+        return;
+    }
+
+    auto toKb = [](std::uint64_t bytes){ return static_cast<double>(bytes) / 1024.0; };
+    std::printf("Top files sketch             : %s\n", topFilesResult.IsWithinBounds() ? "within its error bound" : "OUTSIDE OF ITS ERROR BOUND");
+    std::printf("File bytes seen (N)          : %.0lf KB over %zu files and %zu (process, file) pairs\n",
+                toKb(topFilesResult.totalBytes), topFilesResult.distinctFiles, topFilesResult.distinctProcessFiles);
+    std::printf("Files, overestimate          : %12.0lf KB worst  %12.0lf KB bound (N / capacity)\n",
+                toKb(topFilesResult.maxFileOverestimate), toKb(topFilesResult.fileErrorBound));
+    std::printf("Process files, overestimate  : %12.0lf KB worst  %12.0lf KB bound (N / capacity)\n",
+                toKb(topFilesResult.maxProcessFileOverestimate), toKb(topFilesResult.processFileErrorBound));
+    std::printf("Heavy hitters (above bound)  : %zu, %zu missed\n", topFilesResult.heavyHitters, topFilesResult.missedHeavyHitters);
+    std::printf("Counts outside [count - error, count] : %zu\n", topFilesResult.boundViolations);
+    std::printf("Exact top %zu found in the top %zu  : %zu\n", maxTopFiles, maxTopFiles, topFilesResult.topTenMatches);
+    std::printf("\n");
+
+    if(!fileLatencyResult.isChecked)
+    {
+        std::printf("File latency histograms      : not checked (no file reads or writes in the stream)\n");
+        std::printf("-----------------------------------------------------------\n");
+        return;
+    }
+
+    const CTMFileLatencyStats& stats = fileLatencyResult.stats;
+    std::printf("File latency histograms      : %s\n", fileLatencyResult.IsWithinBounds() ? "within a bucket of the exact percentiles" : "OUTSIDE OF THEIR BOUND");
+    std::printf("Reads/writes matched         : %llu of %llu  (%llu unmatched completions, %llu timed out, %llu dropped)\n",
+                static_cast<unsigned long long>(stats.matched), static_cast<unsigned long long>(fileLatencyResult.exactRead.count + fileLatencyResult.exactWrite.count),
+                static_cast<unsigned long long>(stats.unmatchedEnds), static_cast<unsigned long long>(stats.timedOut),
+                static_cast<unsigned long long>(stats.inFlightDrops));
+    std::printf("Still in flight at the end   : %zu  (%zu KB for the tracker)\n", stats.inFlightCount, stats.memoryUsage / 1024);
+
+    auto printLatencyRow = [](const char* label, const CTMLatencySummary& latency){
+        std::printf("%-29s: %8llu %8llu %8llu %8llu us (p50 p95 p99 max)\n", label,
+                    static_cast<unsigned long long>(latency.p50), static_cast<unsigned long long>(latency.p95),
+                    static_cast<unsigned long long>(latency.p99), static_cast<unsigned long long>(latency.max));
+    };
+    printLatencyRow("Read latency, histogram",  fileLatencyResult.measuredRead);
+    printLatencyRow("Read latency, exact",      fileLatencyResult.exactRead);
+    printLatencyRow("Write latency, histogram", fileLatencyResult.measuredWrite);
+    printLatencyRow("Write latency, exact",     fileLatencyResult.exactWrite);
+    std::printf("Percentiles outside their bucket : %zu\n", fileLatencyResult.percentileViolations);
+    std::printf("-----------------------------------------------------------\n");
+}
+
+//--------------------HELPER FUNCTIONS--------------------
+bool CTMEventBenchmark::ParseOptions(CTMEventBenchmarkOptions& outOptions)
+{
+    int     argc = 0;
+    LPWSTR* argv = CommandLineToArgvW(GetCommandLineW(), &argc);
+    if(!argv)
+        return false;
+
+    //Benchmark defaults, flat out through the synthetic source with nothing dropped
+    CTMEventSourceOptions& sourceOptions = outOptions.sourceOptions;
+    sourceOptions.type                      = CTMEventSourceType::Synthetic;
+    sourceOptions.synthetic.eventsPerSecond = 0.0;
+    sourceOptions.synthetic.maxEvents       = defaultEventCount;
+    sourceOptions.replaySpeed               = 0.0;
+    sourceOptions.samplingThreshold         = 0.0;
+
+    for(int i = 2; i < argc; i++)
+    {
+        if(wcscmp(argv[i], L"--lossy") == 0)
+            outOptions.isLossy = true;
+        else if(wcscmp(argv[i], L"--record") == 0 && i + 1 < argc)
+            outOptions.recordPath = argv[++i];
+        else if(wcscmp(argv[i], L"--publish-every") == 0 && i + 1 < argc)
+            outOptions.publishIntervalMs = std::max(0.0, _wtof(argv[++i]));
+    }
+
+    bool isSuccess = CTMEventSource::ParseOptions(argc, argv, 2, sourceOptions);
+    LocalFree(argv);
+
+    sourceOptions.shouldWaitForRoom = !outOptions.isLossy;
+    if(!isSuccess)
+        return false;
+
+    //The whole point is not needing a kernel session, and an endless run would never report
+    if(sourceOptions.type == CTMEventSourceType::Etw)
+    {
+        CTM_LOG_ERROR("The benchmark only runs the synthetic or replay event source.");
+        return false;
+    }
+    if(sourceOptions.type == CTMEventSourceType::Synthetic && sourceOptions.synthetic.maxEvents == 0)
+        sourceOptions.synthetic.maxEvents = defaultEventCount;
+    //Flat out would only measure how fast the rings fill up, the reader is supposed to race a realistic (if busy) event rate
+    if(outOptions.publishIntervalMs > 0.0 && sourceOptions.synthetic.eventsPerSecond == 0.0)
+        sourceOptions.synthetic.eventsPerSecond = defaultConcurrentRate;
+
+    return true;
+}
+
+void CTMEventBenchmark::Publish()
+{
+    //What the process screen does every update: swap the usage epochs and read every process, turn flow bytes into rates, collect the details window flows.
+    //Going over the whole table for pids stands in for the process list the screen has
+    auto advanceStartTime = std::chrono::steady_clock::now();
+    globalProcessUsageTable.AdvanceEpoch();
+    result.maxAdvanceEpochSeconds = std::max(result.maxAdvanceEpochSeconds,
+                                             std::chrono::duration<double>(std::chrono::steady_clock::now() - advanceStartTime).count());
+    globalProcessUsageTable.CollectPendingProcessIds(processIds);
+
+    //Every epoch is handed over once, so adding them up over all publishes has to give the whole stream
+    std::uint64_t ioUsage[static_cast<std::size_t>(CTMUsageCounter::Count)];
+    for(auto&& processId : processIds)
+    {
+        globalProcessUsageTable.ReadAll(processId, ioUsage);
+        std::uint64_t& bytes = processBytes[processId];
+        for(auto&& counterBytes : ioUsage)
+            bytes += counterBytes;
+    }
+
+    globalNetworkFlowTable.UpdateRates(1.0);
+    if(!processIds.empty())
+    {
+        globalNetworkFlowTable.CollectProcessFlows(processIds.front(), flowBuffer, maxFlowsPerProcess);
+        globalFileUsageTracker.CollectProcessTopFiles(processIds.front(), fileBuffer, maxTopFiles);
+    }
+    globalFileUsageTracker.CollectTopFiles(fileBuffer, maxTopFiles);
+    CTMLatencySummary readLatency, writeLatency;
+    globalFileLatencyTracker.GetSystemSummary(readLatency, writeLatency);
+
+    result.publishedProcesses = processIds.size();
+    result.publishedFlows     = globalNetworkFlowTable.GetEntryCount();
+}
+
+void CTMEventBenchmark::PublishConcurrently(const std::atomic<bool>& isSourceDone)
+{
+    //Only this thread publishes until the source is done, 'Run' waits for it before its own last publish
+    auto interval    = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double, std::milli>(options.publishIntervalMs));
+    auto nextPublish = std::chrono::steady_clock::now() + interval;
+    while(!isSourceDone.load())
+    {
+        std::this_thread::sleep_until(nextPublish);
+        auto publishStartTime = std::chrono::steady_clock::now();
+        Publish();
+        auto publishEndTime   = std::chrono::steady_clock::now();
+
+        double publishSeconds = std::chrono::duration<double>(publishEndTime - publishStartTime).count();
+        result.concurrentPublishSeconds += publishSeconds;
+        result.maxPublishSeconds         = std::max(result.maxPublishSeconds, publishSeconds);
+        ++result.concurrentPublishes;
+
+        //A publish slower than the interval pushes the next one back, instead of a burst of them to catch up
+        nextPublish = std::max(nextPublish + interval, publishEndTime);
+    }
+}
+
+void CTMEventBenchmark::CheckTopFiles()
+{
+    //Same options, same events
+    CTMSyntheticEventSource generator(options.sourceOptions.synthetic);
+    std::unordered_map<ULONGLONG, std::uint64_t>                                exactFileBytes;
+    std::unordered_map<CTMProcessFileKey, std::uint64_t, CTMProcessFileKeyHash> exactProcessFileBytes;
+
+    constexpr std::size_t checkBatchSize = 4096;
+    auto batch = std::make_unique<CTMRecordedEvent[]>(checkBatchSize);
+    for(std::uint64_t generated = 0; generated < options.sourceOptions.synthetic.maxEvents; )
+    {
+        std::size_t batchSize = static_cast<std::size_t>(std::min<std::uint64_t>(checkBatchSize, options.sourceOptions.synthetic.maxEvents - generated));
+        generator.Generate(batch.get(), batchSize);
+        generated += batchSize;
+
+        DWORD         processId = 0;
+        ULONGLONG     fileKey   = 0;
+        std::uint32_t bytes     = 0;
+        for(std::size_t i = 0; i < batchSize; i++)
+        {
+            if(!CTMEventSource::ReadFileEvent(batch[i], processId, fileKey, bytes) || fileKey == 0)
+                continue;
+            exactFileBytes[fileKey] += bytes;
+            exactProcessFileBytes[CTMProcessFileKey{fileKey, processId}] += bytes;
+            topFilesResult.totalBytes += bytes;
+        }
+    }
+
+    //Something other than the sketch disagrees, the numbers below would mean nothing
+    if(topFilesResult.totalBytes != globalFileUsageTracker.GetTotalBytes())
+    {
+        CTM_LOG_WARNING("The top files saw a different stream than the one generated again, skipping the check.");
+        return;
+    }
+
+    topFilesResult.isChecked             = true;
+    topFilesResult.distinctFiles         = exactFileBytes.size();
+    topFilesResult.distinctProcessFiles  = exactProcessFileBytes.size();
+    topFilesResult.fileErrorBound        = globalFileUsageTracker.GetFileErrorBound();
+    topFilesResult.processFileErrorBound = globalFileUsageTracker.GetProcessErrorBound();
+
+    //Every monitored count has to be in [count - error, count] of the truth, and everything above the bound has to be monitored
+    auto checkCounts = [this](const FileUsageVector& sketchFiles, const auto& exactBytes, auto makeKey, std::uint64_t errorBound, std::uint64_t& outMaxOverestimate){
+        std::size_t foundHeavyHitters = 0;
+        for(auto&& file : sketchFiles)
+        {
+            auto          it    = exactBytes.find(makeKey(file));
+            std::uint64_t exact = it != exactBytes.end() ? it->second : 0;
+            if(exact > file.bytes || file.bytes - file.errorBytes > exact)
+                ++topFilesResult.boundViolations;
+            outMaxOverestimate = std::max(outMaxOverestimate, file.bytes - std::min(exact, file.bytes));
+            if(exact > errorBound)
+                ++foundHeavyHitters;
+        }
+
+        std::size_t heavyHitters = 0;
+        for(auto&& [_, bytes] : exactBytes)
+            if(bytes > errorBound)
+                ++heavyHitters;
+        topFilesResult.heavyHitters       += heavyHitters;
+        topFilesResult.missedHeavyHitters += heavyHitters - std::min(heavyHitters, foundHeavyHitters);
+    };
+
+    globalFileUsageTracker.CollectTopFiles(fileBuffer, std::numeric_limits<std::size_t>::max());
+    checkCounts(fileBuffer, exactFileBytes, [](const CTMFileUsageEntry& file){ return file.fileKey; },
+                topFilesResult.fileErrorBound, topFilesResult.maxFileOverestimate);
+
+    //Exact top 10 against the sketch's top 10, the part the UI actually shows
+    std::vector<std::pair<std::uint64_t, ULONGLONG>> exactTopFiles;
+    for(auto&& [fileKey, bytes] : exactFileBytes)
+        exactTopFiles.emplace_back(bytes, fileKey);
+    std::size_t topCount = std::min(maxTopFiles, exactTopFiles.size());
+    std::partial_sort(exactTopFiles.begin(), exactTopFiles.begin() + topCount, exactTopFiles.end(), std::greater<>());
+
+    std::unordered_set<ULONGLONG> sketchTopFiles;
+    for(std::size_t i = 0; i < std::min(maxTopFiles, fileBuffer.size()); i++)
+        sketchTopFiles.insert(fileBuffer[i].fileKey);
+    for(std::size_t i = 0; i < topCount; i++)
+        topFilesResult.topTenMatches += sketchTopFiles.count(exactTopFiles[i].second);
+
+    //Per process lists are slices of one sketch, checking every process covers all of it
+    std::unordered_set<DWORD> processIdSet;
+    for(auto&& [processFileKey, _] : exactProcessFileBytes)
+        processIdSet.insert(processFileKey.processId);
+
+    FileUsageVector processFiles;
+    for(auto&& processId : processIdSet)
+    {
+        globalFileUsageTracker.CollectProcessTopFiles(processId, fileBuffer, std::numeric_limits<std::size_t>::max());
+        processFiles.insert(processFiles.end(), fileBuffer.begin(), fileBuffer.end());
+    }
+    checkCounts(processFiles, exactProcessFileBytes, [](const CTMFileUsageEntry& file){ return CTMProcessFileKey{file.fileKey, file.processId}; },
+                topFilesResult.processFileErrorBound, topFilesResult.maxProcessFileOverestimate);
+}
+
+
+void CTMEventBenchmark::CheckFileLatencies()
+{
+    //Same options, same events, starts matched with their completions by IRP like the tracker does (nothing is lost here, so every one of them matches)
+    CTMSyntheticEventSource generator(options.sourceOptions.synthetic);
+    std::unordered_map<ULONGLONG, std::pair<ULONGLONG, bool>> pendingStarts; //IRP -> start timestamp, is write
+    std::vector<std::uint64_t> readLatencies, writeLatencies;
+
+    constexpr std::size_t checkBatchSize = 4096;
+    auto batch = std::make_unique<CTMRecordedEvent[]>(checkBatchSize);
+    for(std::uint64_t generated = 0; generated < options.sourceOptions.synthetic.maxEvents; )
+    {
+        std::size_t batchSize = static_cast<std::size_t>(std::min<std::uint64_t>(checkBatchSize, options.sourceOptions.synthetic.maxEvents - generated));
+        generator.Generate(batch.get(), batchSize);
+        generated += batchSize;
+
+        ULONGLONG irp   = 0;
+        bool      isEnd = false;
+        for(std::size_t i = 0; i < batchSize; i++)
+        {
+            if(!CTMEventSource::ReadFileIrp(batch[i], irp, isEnd) || irp == 0)
+                continue;
+
+            if(!isEnd)
+            {
+                pendingStarts[irp] = {batch[i].timestamp, batch[i].kind == CTMUsageCounter::FileWrite};
+                continue;
+            }
+
+            auto it = pendingStarts.find(irp);
+            if(it == pendingStarts.end())
+                continue;
+            //Generated ticks -> microseconds
+            std::uint64_t latency = (batch[i].timestamp - it->second.first) * 1000000 / CTMSyntheticEventSource::timestampFrequency;
+            (it->second.second ? writeLatencies : readLatencies).push_back(latency);
+            pendingStarts.erase(it);
+        }
+    }
+
+    if(readLatencies.empty() && writeLatencies.empty())
+        return;
+
+    fileLatencyResult.isChecked  = true;
+    fileLatencyResult.stats      = globalFileLatencyTracker.GetStats();
+    fileLatencyResult.exactRead  = SummarizeExact(readLatencies);
+    fileLatencyResult.exactWrite = SummarizeExact(writeLatencies);
+    globalFileLatencyTracker.GetSystemSummary(fileLatencyResult.measuredRead, fileLatencyResult.measuredWrite);
+
+    fileLatencyResult.percentileViolations += CountPercentileViolations(fileLatencyResult.exactRead, fileLatencyResult.measuredRead);
+    fileLatencyResult.percentileViolations += CountPercentileViolations(fileLatencyResult.exactWrite, fileLatencyResult.measuredWrite);
+}
+
+void CTMEventBenchmark::CheckReadyLatencies(std::uint64_t contextSwitchCount)
+{
+    //Same options, same switches. The waits only come from the switch stream, so where the run's switches started on the clock doesn't matter
+    CTMSyntheticEventSource generator(options.sourceOptions.synthetic);
+    std::unordered_map<DWORD, std::vector<std::uint64_t>> exactProcessLatencies;
+    std::vector<std::uint64_t>                            exactLatencies;
+
+    CTMSyntheticContextSwitch contextSwitch;
+    for(std::uint64_t i = 0; i < contextSwitchCount; i++)
+    {
+        generator.GenerateContextSwitch(0, contextSwitch);
+        if(contextSwitch.threadId == 0)
+            continue;
+
+        //Generated ticks -> microseconds
+        std::uint64_t latency = contextSwitch.waitTicks * 1000000 / CTMSyntheticEventSource::timestampFrequency;
+        exactProcessLatencies[contextSwitch.processId].push_back(latency);
+        exactLatencies.push_back(latency);
+    }
+
+    if(exactLatencies.empty())
+        return;
+
+    readyLatencyResult.isChecked       = true;
+    readyLatencyResult.stats           = globalReadyLatencyTracker.GetStats();
+    readyLatencyResult.expectedSamples = exactLatencies.size();
+    readyLatencyResult.processCount    = exactProcessLatencies.size();
+    readyLatencyResult.exactSystem     = SummarizeExact(exactLatencies);
+    globalReadyLatencyTracker.GetSystemSummary(readyLatencyResult.measuredSystem);
+
+    readyLatencyResult.percentileViolations += CountPercentileViolations(readyLatencyResult.exactSystem, readyLatencyResult.measuredSystem);
+
+    //A handful of processes, the tables have room for all of them so none may have lost a sample
+    for(auto&& [processId, latencies] : exactProcessLatencies)
+    {
+        CTMLatencySummary exact = SummarizeExact(latencies), measured;
+        globalReadyLatencyTracker.GetProcessSummary(processId, measured);
+        readyLatencyResult.percentileViolations += CountPercentileViolations(exact, measured);
+    }
+}
+
+void CTMEventBenchmark::CheckDpcLatencies(std::uint64_t dpcCount)
+{
+    //Same options, same DPCs. They come from a stream of their own, so where the run's DPCs started on the clock doesn't matter
+    CTMSyntheticEventSource generator(options.sourceOptions.synthetic);
+    const std::size_t       kindCount = static_cast<std::size_t>(CTMDpcKind::Count);
+    std::unordered_map<std::string, std::vector<std::uint64_t>> exactDriverDurations[kindCount];
+    std::vector<std::uint64_t>                                   exactDurations[kindCount];
+    std::vector<CTMCoreDpcUsage>                                 exactCores;
+    std::uint32_t threshold = globalDpcLatencyTracker.GetThreshold();
+
+    CTMSyntheticDpc dpc;
+    for(std::uint64_t i = 0; i < dpcCount; i++)
+    {
+        generator.GenerateDpc(0, dpc);
+        std::size_t kindIndex = static_cast<std::size_t>(dpc.kind);
+        exactDriverDurations[kindIndex][CTMSyntheticEventSource::GetSyntheticDriverName(dpc.driverIndex)].push_back(dpc.durationMicros);
+        exactDurations[kindIndex].push_back(dpc.durationMicros);
+
+        if(dpc.core >= exactCores.size())
+            exactCores.resize(dpc.core + 1);
+        (dpc.kind == CTMDpcKind::Isr ? exactCores[dpc.core].isrCount : exactCores[dpc.core].dpcCount)++;
+
+        //Both ends get rounded onto QPC on their own, so a run can come out a microsecond short
+        if(dpc.durationMicros >= static_cast<std::uint64_t>(threshold) + 1)
+            ++dpcLatencyResult.minLongCount;
+        if(dpc.durationMicros >= threshold)
+            ++dpcLatencyResult.maxLongCount;
+    }
+
+    if(dpcCount == 0)
+        return;
+
+    dpcLatencyResult.isChecked       = true;
+    dpcLatencyResult.stats           = globalDpcLatencyTracker.GetStats();
+    dpcLatencyResult.expectedSamples = dpcCount;
+    dpcLatencyResult.exactDpc        = SummarizeExact(exactDurations[static_cast<std::size_t>(CTMDpcKind::Dpc)]);
+    dpcLatencyResult.exactIsr        = SummarizeExact(exactDurations[static_cast<std::size_t>(CTMDpcKind::Isr)]);
+    globalDpcLatencyTracker.GetSystemSummary(dpcLatencyResult.measuredDpc, dpcLatencyResult.measuredIsr);
+
+    dpcLatencyResult.percentileViolations += CountPercentileViolations(dpcLatencyResult.exactDpc, dpcLatencyResult.measuredDpc);
+    dpcLatencyResult.percentileViolations += CountPercentileViolations(dpcLatencyResult.exactIsr, dpcLatencyResult.measuredIsr);
+
+    //A dozen drivers, every one of them gets a slot of its own. A driver missing from the tracker fails its count check
+    std::vector<CTMDriverDpcLatency> drivers;
+    globalDpcLatencyTracker.CollectDrivers(drivers);
+    dpcLatencyResult.driverCount = drivers.size();
+    for(std::size_t kindIndex = 0; kindIndex < kindCount; kindIndex++)
+        for(auto&& [driverName, durations] : exactDriverDurations[kindIndex])
+        {
+            CTMLatencySummary exact = SummarizeExact(durations), measured;
+            auto it = std::find_if(drivers.begin(), drivers.end(), [&driverName = driverName](const CTMDriverDpcLatency& driver){ return driver.name == driverName; });
+            if(it != drivers.end())
+                measured = kindIndex == static_cast<std::size_t>(CTMDpcKind::Isr) ? it->isr : it->dpc;
+            dpcLatencyResult.percentileViolations += CountPercentileViolations(exact, measured);
+        }
+
+    //Counted on the event thread, no rounding involved
+    std::vector<CTMCoreDpcUsage> measuredCores;
+    globalDpcLatencyTracker.GetCoreUsage(measuredCores);
+    for(std::size_t core = 0; core < std::min(exactCores.size(), CTMDpcLatencyTracker::maxTrackedCores); core++)
+    {
+        CTMCoreDpcUsage measured = core < measuredCores.size() ? measuredCores[core] : CTMCoreDpcUsage{};
+        if(measured.dpcCount != exactCores[core].dpcCount || measured.isrCount != exactCores[core].isrCount)
+            ++dpcLatencyResult.coreMismatches;
+    }
+}
+
+void CTMEventBenchmark::CheckSampling()
+{
+    //Same options, same events, every byte of every process exactly
+    CTMSyntheticEventSource generator(options.sourceOptions.synthetic);
+    std::unordered_map<DWORD, std::uint64_t> exactProcessBytes;
+
+    constexpr std::size_t checkBatchSize = 4096;
+    auto batch = std::make_unique<CTMRecordedEvent[]>(checkBatchSize);
+    for(std::uint64_t generated = 0; generated < options.sourceOptions.synthetic.maxEvents; )
+    {
+        std::size_t batchSize = static_cast<std::size_t>(std::min<std::uint64_t>(checkBatchSize, options.sourceOptions.synthetic.maxEvents - generated));
+        generator.Generate(batch.get(), batchSize);
+        generated += batchSize;
+
+        DWORD         processId = 0;
+        ULONGLONG     fileKey   = 0;
+        std::uint32_t bytes     = 0;
+        for(std::size_t i = 0; i < batchSize; i++)
+        {
+            if(!CTMEventSource::ReadNetworkEvent(batch[i], processId, bytes) && !CTMEventSource::ReadFileEvent(batch[i], processId, fileKey, bytes))
+                continue;
+            exactProcessBytes[processId] += bytes;
+            samplingResult.exactBytes    += bytes;
+        }
+    }
+
+    const ProcessBytesMap& estimatedProcessBytes = processBytes;
+    for(auto&& [_, bytes] : estimatedProcessBytes)
+        samplingResult.estimatedBytes += bytes;
+    if(samplingResult.exactBytes == 0 || samplingResult.estimatedBytes == 0)
+        return;
+
+    samplingResult.isChecked    = true;
+    samplingResult.isSampled    = result.eventsSampledOut > 0;
+    samplingResult.keptShare    = result.eventsReceived > 0 ? 1.0 - static_cast<double>(result.eventsSampledOut) / result.eventsReceived : 1.0;
+    samplingResult.processCount = exactProcessBytes.size();
+
+    //Shares and not bytes, so a total that came out a bit high or low doesn't count against every process at once
+    std::vector<std::pair<std::uint64_t, DWORD>> busiestProcesses;
+    for(auto&& [processId, exactBytes] : exactProcessBytes)
+    {
+        auto          it             = estimatedProcessBytes.find(processId);
+        std::uint64_t estimatedBytes = it != estimatedProcessBytes.end() ? it->second : 0;
+        double exactShare     = static_cast<double>(exactBytes) * 100.0 / samplingResult.exactBytes;
+        double estimatedShare = static_cast<double>(estimatedBytes) * 100.0 / samplingResult.estimatedBytes;
+        samplingResult.maxShareError = std::max(samplingResult.maxShareError, std::abs(estimatedShare - exactShare));
+        busiestProcesses.emplace_back(exactBytes, processId);
+    }
+
+    //The ones on top of the list are what people look at, they should be the closest too
+    std::size_t topCount = std::min<std::size_t>(10, busiestProcesses.size());
+    std::partial_sort(busiestProcesses.begin(), busiestProcesses.begin() + topCount, busiestProcesses.end(), std::greater<>());
+    for(std::size_t i = 0; i < topCount; i++)
+    {
+        auto [exactBytes, processId] = busiestProcesses[i];
+        auto   it             = estimatedProcessBytes.find(processId);
+        double estimatedBytes = it != estimatedProcessBytes.end() ? static_cast<double>(it->second) : 0.0;
+        if(exactBytes > 0)
+            samplingResult.maxTopRelativeError = std::max(samplingResult.maxTopRelativeError, std::abs(estimatedBytes - exactBytes) / exactBytes);
+    }
+}
+
+void CTMEventBenchmark::CheckHandleCounting()
+{
+    std::vector<double> typeWeights(handleTypeCount);
+    for(USHORT i = 0; i < handleTypeCount; i++)
+        typeWeights[i] = 1.0 / (i + 1);
+    std::discrete_distribution<int> typeDistribution(typeWeights.begin(), typeWeights.end());
+    std::mt19937_64                 randomEngine(options.sourceOptions.synthetic.seed);
+
+    double harmonicSum = 0.0;
+    for(std::size_t i = 0; i < handleProcessCount; i++)
+        harmonicSum += 1.0 / (i + 1);
+
+    //Handles of a process are next to each other, like in the real table
+    std::vector<CTM_SYSTEM_HANDLE_TABLE_ENTRY_INFO_EX> handles;
+    std::unordered_map<DWORD, std::uint32_t>           exactProcessCounts;
+    std::vector<std::uint64_t>                         exactTypeCounts(firstHandleTypeIndex + handleTypeCount, 0);
+    handles.reserve(handleTableSize + handleProcessCount);
+    for(std::size_t processIndex = 0; processIndex < handleProcessCount; processIndex++)
+    {
+        DWORD       processId      = static_cast<DWORD>((processIndex + 1) * 4);
+        std::size_t processHandles = std::max<std::size_t>(1, static_cast<std::size_t>(handleTableSize / harmonicSum / (processIndex + 1)));
+        for(std::size_t i = 0; i < processHandles; i++)
+        {
+            CTM_SYSTEM_HANDLE_TABLE_ENTRY_INFO_EX& entry = handles.emplace_back();
+            entry.UniqueProcessId = processId;
+            entry.HandleValue     = (i + 1) * 4;
+            entry.ObjectTypeIndex = static_cast<USHORT>(firstHandleTypeIndex + typeDistribution(randomEngine));
+            ++exactTypeCounts[entry.ObjectTypeIndex];
+        }
+        exactProcessCounts[processId] = static_cast<std::uint32_t>(processHandles);
+    }
+
+    //Second pass is what the screen does every refresh, the first one only happens once
+    CTMHandleCountsSnapshot firstPass, nextPass;
+    auto startTime = std::chrono::steady_clock::now();
+    CTMHandleCounter::CountHandles(handles.data(), handles.size(), nullptr, firstPass);
+    auto firstEndTime = std::chrono::steady_clock::now();
+    CTMHandleCounter::CountHandles(handles.data(), handles.size(), &firstPass, nextPass);
+    auto nextEndTime = std::chrono::steady_clock::now();
+
+    handleCountResult.firstPassSeconds = std::chrono::duration<double>(firstEndTime - startTime).count();
+    handleCountResult.nextPassSeconds  = std::chrono::duration<double>(nextEndTime - firstEndTime).count();
+    handleCountResult.handleCount      = handles.size();
+    handleCountResult.processCount     = nextPass.processHandleCountsMap.size();
+    handleCountResult.typeCount        = nextPass.typeCount;
+    handleCountResult.isChecked        = true;
+
+    //Same table twice, so every delta has to be 0
+    if(nextPass.handleCount != handles.size() || nextPass.processHandleCountsMap.size() != exactProcessCounts.size())
+        ++handleCountResult.countMismatches;
+    for(auto&& [processId, exactCount] : exactProcessCounts)
+    {
+        auto it = nextPass.processHandleCountsMap.find(processId);
+        if(it == nextPass.processHandleCountsMap.end() || it->second.totalCount != exactCount ||
+           !it->second.hasPrevious || it->second.prevTotalCount != exactCount)
+            ++handleCountResult.countMismatches;
+    }
+    for(std::size_t typeIndex = 0; typeIndex < exactTypeCounts.size(); typeIndex++)
+    {
+        bool          isCounted = typeIndex < nextPass.typeCount;
+        std::uint64_t counted   = isCounted ? nextPass.typeHandleCounts[typeIndex] : 0;
+        std::uint64_t prevCount = isCounted ? nextPass.prevTypeHandleCounts[typeIndex] : 0;
+        if(counted != exactTypeCounts[typeIndex] || prevCount != exactTypeCounts[typeIndex])
+            ++handleCountResult.countMismatches;
+    }
+}
+
+void CTMEventBenchmark::CheckDecoder()
+{
+    //Same raw payloads a recording of this run would hold, decoded with nothing behind it
+    CTMSyntheticEventSource generator(options.sourceOptions.synthetic);
+    std::vector<CTMRecordedEvent> events(isolatedEventCount);
+    generator.Generate(events.data(), events.size());
+
+    CTMUsageEventRecord  usageRecord;
+    CTMNetworkFlowRecord flowRecord;
+    bool                 isNetwork = false;
+    auto startTime = std::chrono::steady_clock::now();
+    for(auto&& event : events)
+    {
+        if(!CTMEventSource::Decode(event, 0, usageRecord, flowRecord, isNetwork))
+        {
+            ++decoderResult.failedEvents;
+            continue;
+        }
+        decoderResult.networkEvents += isNetwork ? 1 : 0;
+        decoderResult.decodedBytes  += isNetwork ? flowRecord.bytes : usageRecord.bytes;
+    }
+    decoderResult.decodeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    decoderResult.eventCount    = events.size();
+    decoderResult.isChecked     = true;
+}
+
+void CTMEventBenchmark::CheckFlowTable()
+{
+    //Network events only and many flows per process, so the clock hand has to make room for most of the new flows
+    CTMSyntheticEventOptions flowOptions = options.sourceOptions.synthetic;
+    flowOptions.flowsPerProcess = flowsPerProcess;
+    flowOptions.mixWeights[static_cast<std::size_t>(CTMUsageCounter::FileRead)]  = 0.0;
+    flowOptions.mixWeights[static_cast<std::size_t>(CTMUsageCounter::FileWrite)] = 0.0;
+
+    CTMSyntheticEventSource generator(flowOptions);
+    std::vector<CTMRecordedEvent> events(isolatedEventCount);
+    generator.Generate(events.data(), events.size());
+
+    std::vector<CTMNetworkFlowRecord> records;
+    records.reserve(events.size());
+    CTMUsageEventRecord usageRecord;
+    bool                isNetwork = false;
+    for(std::size_t i = 0; i < events.size(); i++)
+    {
+        CTMNetworkFlowRecord& record = records.emplace_back();
+        if(!CTMEventSource::Decode(events[i], i, usageRecord, record, isNetwork) || !isNetwork)
+            records.pop_back();
+    }
+
+    //Its own table, the global one would keep the flows of the run above
+    CTMNetworkFlowTable flowTable;
+    auto startTime = std::chrono::steady_clock::now();
+    for(std::size_t i = 0; i < records.size(); i += flowBatchSize)
+        flowTable.AddBatch(records.data() + i, std::min(flowBatchSize, records.size() - i));
+    flowTableResult.addSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+    flowTableResult.recordCount  = records.size();
+    flowTableResult.evictedCount = flowTable.GetEvictedCount();
+    flowTableResult.flowCount    = static_cast<std::size_t>(flowOptions.processCount) * flowOptions.flowsPerProcess;
+    flowTableResult.entryCount   = flowTable.GetEntryCount();
+    flowTableResult.capacity     = flowTable.GetCapacity();
+    flowTableResult.isChecked    = true;
+}
+
+CTMLatencySummary CTMEventBenchmark::SummarizeExact(std::vector<std::uint64_t>& latencies)
+{
+    CTMLatencySummary summary;
+    if(latencies.empty())
+        return summary;
+
+    std::sort(latencies.begin(), latencies.end());
+    //Same rank the histogram uses, 1 based and rounded
+    auto valueAt = [&latencies](double percentile){
+        std::uint64_t rank = static_cast<std::uint64_t>(percentile / 100.0 * latencies.size() + 0.5);
+        rank = std::clamp<std::uint64_t>(rank, 1, latencies.size());
+        return latencies[static_cast<std::size_t>(rank - 1)];
+    };
+
+    summary.count = latencies.size();
+    summary.p50   = valueAt(50.0);
+    summary.p95   = valueAt(95.0);
+    summary.p99   = valueAt(99.0);
+    summary.max   = latencies.back();
+    return summary;
+}
+
+std::size_t CTMEventBenchmark::CountPercentileViolations(const CTMLatencySummary& exact, const CTMLatencySummary& measured)
+{
+    const std::uint64_t exactValues[]    = {exact.p50, exact.p95, exact.p99, exact.max};
+    const std::uint64_t measuredValues[] = {measured.p50, measured.p95, measured.p99, measured.max};
+    std::size_t violations = exact.count != measured.count ? 1 : 0;
+    for(std::size_t i = 0; i < std::size(exactValues); i++)
+        if(!IsWithinBucket(exactValues[i], measuredValues[i]))
+            ++violations;
+    return violations;
+}
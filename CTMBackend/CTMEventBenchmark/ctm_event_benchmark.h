@@ -0,0 +1,297 @@
+#ifndef CTM_EVENT_BENCHMARK_HPP
+#define CTM_EVENT_BENCHMARK_HPP
+
+//Windows stuff
+#include <windows.h>
+#include <shellapi.h>
+//My stuff
+#include "../CTMPureHeaderFiles/ctm_logger.h"
+#include "../CTMProcessScreen/ctm_event_source.h"
+#include "../CTMProcessScreen/ctm_synthetic_event_source.h"
+#include "../CTMHandlesScreen/ctm_handle_counter.h"
+//Stdlib stuff
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <string>
+#include <limits>
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <random>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cwchar>
+
+//Options parsed from 'CTMApp --event-benchmark [--lossy] [--record <file>] [--publish-every <ms>] [event source options]', '--sample-above' is off unless given
+struct CTMEventBenchmarkOptions
+{
+    CTMEventSourceOptions sourceOptions;
+    std::wstring          recordPath; //Non empty -> write the synthetic events to this file instead of benchmarking
+    double                publishIntervalMs = 0.0;   //Above 0 -> publish on another thread while the source runs, instead of once after it
+    bool                  isLossy           = false; //Let the rings drop like they would under ETW, instead of the source waiting for room
+};
+
+//Timings of a single run, all in seconds
+struct CTMEventBenchmarkResult
+{
+    //Perfect 8 byte alignment
+    double        produceSeconds     = 0.0; //Source: generate/read, decode and push into the rings
+    double        pipelineSeconds    = 0.0; //First event in to last event aggregated
+    double        publishSeconds     = 0.0; //One UI update worth of draining and rate updates, after everything is aggregated
+    std::uint64_t eventsReceived     = 0;
+    std::uint64_t eventsAggregated   = 0;
+    std::uint64_t eventsDropped      = 0;
+    std::uint64_t eventsSampledOut   = 0;
+    std::uint64_t aggregationNs      = 0;
+    std::size_t   publishedProcesses = 0;
+    std::size_t   publishedFlows     = 0;
+    //Only with '--publish-every', the publishes done while the source was still running
+    double        concurrentPublishSeconds = 0.0; //All of them added up
+    double        maxPublishSeconds        = 0.0; //Slowest one
+    double        maxAdvanceEpochSeconds   = 0.0; //Slowest epoch swap, the only part which can wait on the aggregator
+    std::uint64_t concurrentPublishes      = 0;
+};
+
+//Top files sketch against the exact numbers of the same stream, only for lossless synthetic runs
+struct CTMTopFilesCheckResult
+{
+    //Perfect 8 byte alignment
+    std::uint64_t totalBytes                 = 0;
+    std::uint64_t fileErrorBound             = 0; //N / capacity, what the sketch promises
+    std::uint64_t processFileErrorBound      = 0;
+    std::uint64_t maxFileOverestimate        = 0; //What it actually got wrong, worst case
+    std::uint64_t maxProcessFileOverestimate = 0;
+    std::size_t   distinctFiles              = 0;
+    std::size_t   distinctProcessFiles       = 0;
+    std::size_t   heavyHitters               = 0; //Files and process files above the bound, all of them have to be in the sketch
+    std::size_t   missedHeavyHitters         = 0;
+    std::size_t   boundViolations            = 0; //Counts outside of [count - error, count]
+    std::size_t   topTenMatches              = 0; //Exact top 10 files found in the sketch's top 10
+
+    bool IsWithinBounds() const { return missedHeavyHitters == 0 && boundViolations == 0; }
+};
+
+//Latency histograms against the sorted exact latencies of the same stream, only for lossless synthetic runs
+struct CTMFileLatencyCheckResult
+{
+    //Perfect 8 byte alignment
+    CTMLatencySummary   exactRead;
+    CTMLatencySummary   exactWrite;
+    CTMLatencySummary   measuredRead;
+    CTMLatencySummary   measuredWrite;
+    CTMFileLatencyStats stats;
+    std::size_t         percentileViolations = 0; //Percentiles under the exact one, or more than a bucket (1/16) over it
+
+    bool IsWithinBounds() const
+    {
+        return percentileViolations == 0 && stats.matched == exactRead.count + exactWrite.count;
+    }
+};
+
+//Ready latency histograms against the exact waits of the same switch stream, only for lossless synthetic runs
+struct CTMReadyLatencyCheckResult
+{
+    //Perfect 8 byte alignment
+    CTMLatencySummary    exactSystem;
+    CTMLatencySummary    measuredSystem;
+    CTMReadyLatencyStats stats;
+    std::uint64_t        expectedSamples      = 0; //Switches to a thread, every one of them comes with a ready
+    std::size_t          processCount         = 0;
+    std::size_t          percentileViolations = 0; //Same bounds as the file latencies, every process and the system wide numbers
+
+    bool IsWithinBounds() const { return percentileViolations == 0 && stats.matched == expectedSamples; }
+};
+
+//DPC/ISR histograms against the exact durations of the same DPC stream, only for lossless synthetic runs
+struct CTMDpcLatencyCheckResult
+{
+    //Perfect 8 byte alignment
+    CTMLatencySummary  exactDpc;             //Every driver merged
+    CTMLatencySummary  measuredDpc;
+    CTMLatencySummary  exactIsr;
+    CTMLatencySummary  measuredIsr;
+    CTMDpcLatencyStats stats;
+    std::uint64_t      expectedSamples      = 0;
+    std::uint64_t      minLongCount         = 0; //Runs a microsecond over the threshold, rounding can't take them under it
+    std::uint64_t      maxLongCount         = 0; //Runs at the threshold or over it, rounding can only take them under it
+    std::size_t        driverCount          = 0;
+    std::size_t        coreMismatches       = 0; //Cores whose DPC or ISR count isn't the exact one
+    std::size_t        percentileViolations = 0; //Same bounds as the file latencies, every driver and the system wide numbers
+
+    bool IsWithinBounds() const
+    {
+        return percentileViolations == 0 && coreMismatches == 0 && stats.dpcEvents + stats.isrEvents == expectedSamples &&
+               stats.longEvents >= minLongCount && stats.longEvents <= maxLongCount;
+    }
+};
+
+//Per process bytes of a sampled run against the exact ones of the same stream, only for lossless synthetic runs.
+//Unsampled runs go through it too, there the numbers have to match exactly
+struct CTMSamplingCheckResult
+{
+    //Perfect 8 byte alignment
+    std::uint64_t exactBytes          = 0;   //Every counter of every process, what the run should have shown
+    std::uint64_t estimatedBytes      = 0;   //What it did show, sampled bytes scaled back up
+    double        maxShareError       = 0.0; //Worst process, how far its share of all bytes is off, in percentage points
+    double        maxTopRelativeError = 0.0; //Worst of the busiest 10 processes, how far its bytes are off relative to the exact ones
+    double        keptShare           = 1.0; //Share of the published events which made it past sampling
+    std::size_t   processCount        = 0;
+    bool          isSampled           = false;
+
+    bool IsWithinBounds() const { return isSampled || (exactBytes == estimatedBytes && maxShareError == 0.0); }
+};
+
+//Handles screen counting on a generated handle table, timed and checked against the counts the table was generated with. Every run does it
+struct CTMHandleCountCheckResult
+{
+    //Perfect 8 byte alignment
+    double        firstPassSeconds = 0.0; //Every process is new, nothing to take the deltas from
+    double        nextPassSeconds  = 0.0; //Same table again, deltas and names come from the first pass
+    std::uint64_t handleCount      = 0;
+    std::size_t   processCount     = 0;
+    std::size_t   typeCount        = 0;
+    std::size_t   countMismatches  = 0; //Process or type counts which aren't the generated ones, or a delta which isn't 0
+
+    bool IsWithinBounds() const { return countMismatches == 0; }
+};
+
+//Fixed schema decoder on its own, generated events straight into records with nothing published. Every run does it
+struct CTMDecoderCheckResult
+{
+    //Perfect 8 byte alignment
+    double        decodeSeconds = 0.0;
+    std::uint64_t eventCount    = 0;
+    std::uint64_t networkEvents = 0;
+    std::uint64_t decodedBytes  = 0; //Bytes of every decoded record added up, also keeps the decoding from being optimized out
+    std::uint64_t failedEvents  = 0; //The generator only writes events the schemas take, any of these is a decoder bug
+
+    bool IsWithinBounds() const { return failedEvents == 0; }
+};
+
+//Flow table on its own, network records from far more flows than it has room for, in aggregator sized batches. Every run does it
+struct CTMFlowTableCheckResult
+{
+    //Perfect 8 byte alignment
+    double        addSeconds   = 0.0;
+    std::uint64_t recordCount  = 0;
+    std::uint64_t evictedCount = 0;
+    std::size_t   flowCount    = 0; //Flows the generator spreads the records over
+    std::size_t   entryCount   = 0;
+    std::size_t   capacity     = 0;
+
+    //Being under the 500K events/s target is only reported, the table going over its cap (or never evicting to stay under it) is a bug
+    bool IsWithinBounds() const { return entryCount <= capacity && (flowCount <= capacity || evictedCount > 0); }
+};
+
+//One of the checks above as the run keeps it. A run can't do every check (replays, drops and sampling rule some out), those stay unchecked and pass
+template<typename CheckResult>
+struct CTMBenchmarkCheck : CheckResult
+{
+    bool isChecked = false;
+
+    bool IsPassing() const { return !isChecked || CheckResult::IsWithinBounds(); }
+};
+
+using ProcessBytesMap = std::unordered_map<DWORD, std::uint64_t>;
+
+/*
+ * Headless throughput benchmark of the process screen's event path: decode -> aggregate -> publish.
+ * Events come from the synthetic or replay source (check ctm_event_source.h), so it needs no administrator rights or kernel session,
+ * and the same options always push the same events through. Prints events/s and ns/event for every stage.
+ * Synthetic runs generate the stream a second time and check every tracker fed by it against the exact numbers, the run fails if one is off.
+ * '--sample-above' and '--publish-every' reproduce a spike and the UI reading while events come in, check 'PrintReport' for what they add.
+ */
+class CTMEventBenchmark
+{
+public:
+    CTMEventBenchmark() = default;
+    ~CTMEventBenchmark() = default;
+
+    //No need for copy or move operations
+    CTMEventBenchmark(const CTMEventBenchmark&)            = delete;
+    CTMEventBenchmark& operator=(const CTMEventBenchmark&) = delete;
+    CTMEventBenchmark(CTMEventBenchmark&&)                 = delete;
+    CTMEventBenchmark& operator=(CTMEventBenchmark&&)      = delete;
+
+public: //Entry points used by main
+    static bool IsBenchmarkModeRequested();
+    //0 on success, meant to be returned from main
+    static int  RunFromCommandLine();
+
+public: //Main functions
+    bool Run(const CTMEventBenchmarkOptions&);
+    void PrintReport();
+
+public: //Getter functions
+    //A sketch or histogram outside of its bound is a bug, not a slow run
+    bool IsPassing() const
+    {
+        return topFilesResult.IsPassing() && fileLatencyResult.IsPassing() && samplingResult.IsPassing() &&
+               readyLatencyResult.IsPassing() && dpcLatencyResult.IsPassing() && handleCountResult.IsPassing() &&
+               decoderResult.IsPassing() && flowTableResult.IsPassing();
+    }
+
+private: //Helper functions
+    static bool ParseOptions(CTMEventBenchmarkOptions&);
+    void        Publish();
+    void        PublishConcurrently(const std::atomic<bool>&);
+    void        CheckTopFiles();
+    void        CheckFileLatencies();
+    void        CheckSampling();
+    void        CheckReadyLatencies(std::uint64_t);
+    void        CheckDpcLatencies(std::uint64_t);
+    void        CheckHandleCounting();
+    void        CheckDecoder();
+    void        CheckFlowTable();
+    //Sorts the latencies, same percentiles as 'Summarize' but exact
+    static CTMLatencySummary SummarizeExact(std::vector<std::uint64_t>&);
+    //Every percentile more than a bucket off, and a count which isn't the exact one, is a violation
+    static std::size_t       CountPercentileViolations(const CTMLatencySummary&, const CTMLatencySummary&);
+    //Mapping generated ticks onto QPC rounds both ends on their own, so a value can be 1 us off on top of the bucket width
+    static bool IsWithinBucket(std::uint64_t exact, std::uint64_t measured)
+    {
+        return measured + 1 >= exact && measured <= exact + exact / 16 + 1;
+    }
+
+private: //Benchmark stuff
+    CTMEventBenchmarkOptions                      options;
+    CTMEventBenchmarkResult                       result;
+    CTMBenchmarkCheck<CTMTopFilesCheckResult>     topFilesResult;
+    CTMBenchmarkCheck<CTMFileLatencyCheckResult>  fileLatencyResult;
+    CTMBenchmarkCheck<CTMSamplingCheckResult>     samplingResult;
+    CTMBenchmarkCheck<CTMReadyLatencyCheckResult> readyLatencyResult;
+    CTMBenchmarkCheck<CTMDpcLatencyCheckResult>   dpcLatencyResult;
+    CTMBenchmarkCheck<CTMHandleCountCheckResult>  handleCountResult;
+    CTMBenchmarkCheck<CTMDecoderCheckResult>      decoderResult;
+    CTMBenchmarkCheck<CTMFlowTableCheckResult>    flowTableResult;
+    std::string                                   sourceName;
+    std::vector<DWORD>                            processIds; //Pids of the last publish
+    ProcessBytesMap                               processBytes; //Every counter of every publish added up, per pid
+    NetworkFlowVector                             flowBuffer;
+    FileUsageVector                               fileBuffer;
+    //Default run, big enough that thread start up and the first page allocations don't matter
+    constexpr static std::uint64_t defaultEventCount     = 5000000;
+    //Rate of the '--publish-every' runs when none is given, what the contention benchmark was asked for
+    constexpr static double        defaultConcurrentRate = 1000000.0;
+    //Same as the process details window
+    constexpr static std::size_t   maxFlowsPerProcess    = 20;
+    constexpr static std::size_t   maxTopFiles           = 10;
+    //Generated handle table, about what a busy desktop has. Handles per process and per type both follow 1/rank
+    constexpr static std::size_t   handleTableSize       = 1000000;
+    constexpr static std::size_t   handleProcessCount    = 400;
+    constexpr static USHORT        handleTypeCount       = 64;
+    constexpr static USHORT        firstHandleTypeIndex  = 2; //Type indices start at 2, like the real ones
+    //Decoder and flow table cases, generated up front so only the decoding and the table are timed
+    constexpr static std::size_t   isolatedEventCount    = 1000000;
+    constexpr static std::size_t   flowBatchSize         = 1024;     //Same as the aggregator's batches
+    constexpr static std::uint32_t flowsPerProcess       = 2048;     //64 processes -> 131072 flows, a few times what the default cap holds
+    constexpr static double        flowTableTargetRate   = 500000.0; //Events/s the flow table was asked to keep up with
+};
+
+#endif
@@ -0,0 +1,83 @@
+#include "ctm_anomaly_event_log.h"
+
+//MSVC warnings forcing me to use _s function... NOPE
+#pragma warning(disable:4996)
+
+//--------------------MAIN FUNCTIONS--------------------
+void CTMAnomalyEventLog::Record(const char* seriesName, double value, double mean, double deviation)
+{
+    CTMAnomalyEvent& event = events[nextIndex];
+
+    event.timestamp = std::time(nullptr);
+    event.value     = value;
+    event.mean      = mean;
+    event.deviation = deviation;
+    //Copy the name, truncating it if needed. strncpy doesn't null terminate when truncating so do it ourselves
+    std::strncpy(event.seriesName, seriesName ? seriesName : "Unnamed Series", sizeof(event.seriesName) - 1);
+    event.seriesName[sizeof(event.seriesName) - 1] = '\0';
+
+    nextIndex = (nextIndex + 1) % maxEvents;
+    if(eventCount < maxEvents)
+        ++eventCount;
+}
+
+void CTMAnomalyEventLog::Clear()
+{
+    nextIndex  = 0;
+    eventCount = 0;
+}
+
+void CTMAnomalyEventLog::RenderEventsTable(const char* tableId, float tableHeight)
+{
+    if(eventCount == 0)
+    {
+        ImGui::TextUnformatted("No anomalies detected so far.");
+        return;
+    }
+
+    if(ImGui::Button("Clear Events"))
+    {
+        Clear();
+        return;
+    }
+
+    if(ImGui::BeginTable(tableId, 5, ImGuiTableFlags_SizingStretchProp | ImGuiTableFlags_BordersInnerV | ImGuiTableFlags_ScrollY,
+                         {-1.0f, tableHeight}))
+    {
+        ImGui::TableSetupScrollFreeze(0, 1);
+        ImGui::TableSetupColumn("Time");
+        ImGui::TableSetupColumn("Series");
+        ImGui::TableSetupColumn("Value");
+        ImGui::TableSetupColumn("Expected");
+        ImGui::TableSetupColumn("Sigma");
+        ImGui::TableHeadersRow();
+
+        char timeBuffer[16];
+        for(std::size_t i = 0; i < eventCount; i++)
+        {
+            const CTMAnomalyEvent& event = GetEvent(i);
+            std::strftime(timeBuffer, sizeof(timeBuffer), "%H:%M:%S", std::localtime(&event.timestamp));
+
+            ImGui::TableNextRow();
+            ImGui::TableSetColumnIndex(0);
+            ImGui::TextUnformatted(timeBuffer);
+            ImGui::TableSetColumnIndex(1);
+            ImGui::TextUnformatted(event.seriesName);
+            ImGui::TableSetColumnIndex(2);
+            ImGui::Text("%.2lf", event.value);
+            ImGui::TableSetColumnIndex(3);
+            ImGui::Text("%.2lf", event.mean);
+            ImGui::TableSetColumnIndex(4);
+            ImGui::Text("%+.1lf", event.deviation);
+        }
+
+        ImGui::EndTable();
+    }
+}
+
+//--------------------GETTERS--------------------
+const CTMAnomalyEvent& CTMAnomalyEventLog::GetEvent(std::size_t index) const
+{
+    //Walk backwards from the latest written event
+    return events[(nextIndex + maxEvents - 1 - index) % maxEvents];
+}
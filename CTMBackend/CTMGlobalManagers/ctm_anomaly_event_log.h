@@ -0,0 +1,65 @@
+#ifndef CTM_ANOMALY_EVENT_LOG_HPP
+#define CTM_ANOMALY_EVENT_LOG_HPP
+
+/*
+ * This class is a 'Singleton'. Every metric series which runs a 'CTMAnomalyDetector' reports its anomalies here.
+ * Its a fixed size ring of events, so recording an event never allocates. Oldest events get overwritten.
+ * Only used from the UI thread (OnUpdate functions), hence no locks.
+ */
+
+//ImGui stuff
+#include "../../ImGUI/imgui.h"
+//Stdlib stuff
+#include <array>
+#include <ctime>
+#include <cstdint>
+#include <cstring>
+
+//Single anomaly event, series name is copied into the event itself (no allocation)
+struct CTMAnomalyEvent
+{
+    std::time_t timestamp;
+    double      value;
+    double      mean;
+    double      deviation; //In number of sigmas, signed
+    char        seriesName[48];
+};
+
+class CTMAnomalyEventLog
+{
+public:
+    static CTMAnomalyEventLog& GetInstance()
+    {
+        static CTMAnomalyEventLog anomalyEventLog;
+        return anomalyEventLog;
+    }
+
+public: //Main functions
+    void Record(const char*, double, double, double);
+    void Clear();
+    //Renders the events as a table, latest event first
+    void RenderEventsTable(const char*, float);
+
+public: //Getters
+    std::size_t            GetEventCount() const { return eventCount; }
+    const CTMAnomalyEvent& GetEvent(std::size_t) const; //0 is the latest event
+
+private: //Constructors and Destructors
+    CTMAnomalyEventLog()  = default;
+    ~CTMAnomalyEventLog() = default;
+
+    //No need for copy or move operations
+    CTMAnomalyEventLog(const CTMAnomalyEventLog&)            = delete;
+    CTMAnomalyEventLog& operator=(const CTMAnomalyEventLog&) = delete;
+    CTMAnomalyEventLog(CTMAnomalyEventLog&&)                 = delete;
+    CTMAnomalyEventLog& operator=(CTMAnomalyEventLog&&)      = delete;
+
+private: //Ring of events
+    constexpr static std::size_t maxEvents = 128;
+
+    std::array<CTMAnomalyEvent, maxEvents> events     = {};
+    std::size_t                            nextIndex  = 0;
+    std::size_t                            eventCount = 0;
+};
+
+#endif
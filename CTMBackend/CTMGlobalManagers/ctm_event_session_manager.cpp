@@ -0,0 +1,195 @@
+#include "ctm_event_session_manager.h"
+
+//Don't really want these macros, they are messing up the std::max and std::min functions
+#undef max
+#undef min
+
+//--------------------MAIN FUNCTIONS--------------------
+bool CTMEventSessionManager::AcquireProvider(CTMEventProvider provider)
+{
+    if(!eventSource && !StartSession())
+        return false;
+
+    //Enabled already (someone holds it or it is still idling), just count the new holder
+    CTMProviderState& providerState = GetProviderState(provider);
+    if(!providerState.isEnabled)
+    {
+        if(!eventSource->SetProviderEnabled(provider, true))
+            return false;
+        providerState.isEnabled = true;
+    }
+
+    ++providerState.referenceCount;
+    return true;
+}
+
+void CTMEventSessionManager::ReleaseProvider(CTMEventProvider provider)
+{
+    CTMProviderState& providerState = GetProviderState(provider);
+    if(providerState.referenceCount == 0)
+        return;
+
+    //Not disabled right away, 'Update' does it if nobody takes it back in time
+    if(--providerState.referenceCount == 0)
+        providerState.idleSince = std::chrono::steady_clock::now();
+}
+
+void CTMEventSessionManager::Update()
+{
+    if(!eventSource)
+        return;
+
+    //ProcessEvents only returns if the session is gone, whoever holds providers gets them back by acquiring again
+    CTMProcessingState state = processingState.load(std::memory_order_acquire);
+    if(state != CTMProcessingState::Running)
+    {
+        if(state == CTMProcessingState::Failed)
+            CTM_LOG_ERROR("Failed to process events for event tracing, the event session was stopped.");
+        else
+            CTM_LOG_INFO("The ", eventSource->GetName(), " event source stopped producing events.");
+        StopSession();
+        return;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    if(now - lastPollTime >= pollInterval)
+        PollSession();
+
+    for(std::size_t i = 0; i < static_cast<std::size_t>(CTMEventProvider::Count); i++)
+    {
+        CTMProviderState& providerState = providerStates[i];
+        if(!providerState.isEnabled || providerState.referenceCount > 0 || now - providerState.idleSince < providerIdleTimeout)
+            continue;
+
+        eventSource->SetProviderEnabled(static_cast<CTMEventProvider>(i), false);
+        providerState.isEnabled = false;
+    }
+}
+
+bool CTMEventSessionManager::HasRecentEventLoss() const
+{
+    return eventsLost > 0 && std::chrono::steady_clock::now() - lastEventLossTime < eventLossWarningDuration;
+}
+
+CTMEventTracingDiagnostics CTMEventSessionManager::GetDiagnostics()
+{
+    if(eventSource)
+        return eventSource->GetDiagnostics();
+
+    CTMEventTracingDiagnostics diagnostics;
+    globalUsageEventPipeline.FillDiagnostics(diagnostics);
+    return diagnostics;
+}
+
+//--------------------HELPER FUNCTIONS--------------------
+bool CTMEventSessionManager::StartSession()
+{
+    //'--event-source synthetic|replay' runs the app without a kernel session (check ctm_event_source.h)
+    CTMEventSourceOptions sourceOptions = CTMEventSource::ParseOptionsFromCommandLine();
+    CTMEtwBufferSettings& etwBuffers    = sourceOptions.etwBuffers;
+    etwBuffers.bufferSizeKB      = stateManager.getSetting(CTMSettingKey::EtwBufferSizeKB, 0u);
+    etwBuffers.minimumBuffers    = stateManager.getSetting(CTMSettingKey::EtwMinimumBuffers, 0u);
+    etwBuffers.maximumBuffers    = stateManager.getSetting(CTMSettingKey::EtwMaximumBuffers, 0u);
+    etwBuffers.flushTimerSeconds = stateManager.getSetting(CTMSettingKey::EtwFlushTimer, 0u);
+    etwBuffers.expectedEventRate = stateManager.getSetting(CTMSettingKey::EtwPeakEventRate, 0u);
+    eventSource = CTMEventSource::Create(sourceOptions);
+
+    //Aggregator goes first, whatever the source publishes has to be picked up from the start
+    globalUsageEventPipeline.SetSamplingThreshold(sourceOptions.samplingThreshold);
+    globalUsageEventPipeline.Start();
+    if(!eventSource->Start())
+    {
+        CTM_LOG_ERROR("Failed to start event tracing. Look at the above errors for more information.");
+        globalUsageEventPipeline.Stop();
+        eventSource.reset();
+        return false;
+    }
+
+    //After we start the etw, most of the things can go wrong if god doesn't like you (yes you, the user of this program)
+    //Register a cleanup function to prevent this from happening
+    resourceGuard.RegisterCleanupFunction(sessionCleanupFunctionName, [this](){
+        eventSource->Stop();
+        globalUsageEventPipeline.Stop();
+    });
+
+    //No waiting around to see if it fails, 'Update' finds out on the next frame if it did
+    processingState.store(CTMProcessingState::Running, std::memory_order_relaxed);
+    processingThread = std::thread([this](){
+        //Blocks until the source is stopped or runs out of events
+        bool isSuccess = eventSource->ProcessEvents();
+        processingState.store(isSuccess ? CTMProcessingState::Finished : CTMProcessingState::Failed, std::memory_order_release);
+    });
+
+    //Session went away with providers still held (it failed, or got stopped from outside), take them back
+    for(std::size_t i = 0; i < static_cast<std::size_t>(CTMEventProvider::Count); i++)
+        if(providerStates[i].referenceCount > 0)
+            providerStates[i].isEnabled = eventSource->SetProviderEnabled(static_cast<CTMEventProvider>(i), true);
+
+    //Whatever an earlier session lost isn't this one's business
+    polledDiagnostics = eventSource->GetDiagnostics();
+    lastPollTime      = std::chrono::steady_clock::now();
+    eventsLost        = 0;
+    eventRate         = 0.0;
+
+    CTM_LOG_SUCCESS("Process usage events are coming from the ", eventSource->GetName(), " event source.");
+    return true;
+}
+
+void CTMEventSessionManager::StopSession()
+{
+    if(!eventSource)
+        return;
+
+    //Disables what is still enabled on its own, then stopping the session makes ProcessEvents return
+    eventSource->Stop();
+    if(processingThread.joinable())
+        processingThread.join();
+    globalUsageEventPipeline.Stop();
+    eventSource.reset();
+
+    for(auto&& providerState : providerStates)
+        providerState.isEnabled = false;
+
+    //Stopped the normal way, no need for the cleanup function anymore
+    resourceGuard.UnregisterCleanupFunction(sessionCleanupFunctionName);
+}
+
+void CTMEventSessionManager::PollSession()
+{
+    auto now = std::chrono::steady_clock::now();
+    double elapsedSeconds = std::chrono::duration<double>(now - lastPollTime).count();
+    lastPollTime = now;
+
+    //One ControlTrace query, cheap enough for once a second
+    CTMEventTracingDiagnostics previousDiagnostics = polledDiagnostics;
+    polledDiagnostics = eventSource->GetDiagnostics();
+
+    std::uint64_t lostNow    = CountEventsLost(polledDiagnostics),
+                  lostBefore = CountEventsLost(previousDiagnostics),
+                  lostDelta  = lostNow > lostBefore ? lostNow - lostBefore : 0;
+    if(lostDelta > 0)
+    {
+        eventsLost       += lostDelta;
+        lastEventLossTime = now;
+    }
+
+    //Context switches don't go through the pipeline but they take up the same buffers
+    std::uint64_t eventsNow    = polledDiagnostics.eventsReceived + polledDiagnostics.contextSwitches,
+                  eventsBefore = previousDiagnostics.eventsReceived + previousDiagnostics.contextSwitches;
+    eventRate = elapsedSeconds > 0.0 && eventsNow >= eventsBefore ? (eventsNow - eventsBefore) / elapsedSeconds : 0.0;
+    eventSource->AdjustToEventRate(eventRate, lostDelta > 0);
+
+    //Only written when it moved a fair bit, the settings file is saved on exit anyway
+    if(eventRate > peakEventRate * 1.1)
+    {
+        peakEventRate = eventRate;
+        stateManager.setSetting(CTMSettingKey::EtwPeakEventRate, static_cast<std::uint32_t>(peakEventRate));
+    }
+}
+
+std::uint64_t CTMEventSessionManager::CountEventsLost(const CTMEventTracingDiagnostics& diagnostics)
+{
+    //A lost buffer is a lot of events, we don't know how many so it counts as one. Ring drops never made it to the tables either
+    return static_cast<std::uint64_t>(diagnostics.etwEventsLost) + diagnostics.etwRealTimeBuffersLost + diagnostics.lostEventNotifications +
+           diagnostics.ringDrops;
+}
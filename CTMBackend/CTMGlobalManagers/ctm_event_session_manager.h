@@ -0,0 +1,116 @@
+#ifndef CTM_EVENT_SESSION_MANAGER_HPP
+#define CTM_EVENT_SESSION_MANAGER_HPP
+
+/*
+ * This class is a 'Singleton'. It owns the event source (the ETW session unless the command line picks another one, check ctm_event_source.h),
+ * the thread processing its events and the aggregator of 'globalUsageEventPipeline', for as long as the app runs.
+ * Screens don't start or stop any of it, they acquire the providers they need and release them when they are destroyed.
+ * The first acquire starts everything, providers are enabled on their first acquire and disabled once nobody held them for a while-
+ * -so switching screens back and forth doesn't restart the session or lose what happened in between.
+ * Only used from the UI thread (constructors, destructors and OnUpdate functions), hence no locks.
+ */
+
+//Windows stuff
+#include <windows.h>
+//My stuff
+#include "ctm_critical_resource_guard.h"
+#include "ctm_state_manager.h"
+#include "../CTMPureHeaderFiles/ctm_logger.h"
+#include "../CTMProcessScreen/ctm_event_source.h"
+//Stdlib stuff
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+class CTMEventSessionManager
+{
+public:
+    static CTMEventSessionManager& GetInstance()
+    {
+        static CTMEventSessionManager eventSessionManager;
+        return eventSessionManager;
+    }
+
+public: //Main functions
+    //Starts the session if it isn't running yet, false if either the session or the provider failed (the errors are logged)
+    bool AcquireProvider(CTMEventProvider);
+    void ReleaseProvider(CTMEventProvider);
+    //Called every frame, disables providers nobody held for 'providerIdleTimeout' and notices a processing thread which gave up.
+    //Once a second it also asks the source what it lost and lets it grow its buffers with the rate
+    void Update();
+
+public: //Getter functions
+    bool                       IsRunning() const { return eventSource != nullptr; }
+    bool                       IsProviderEnabled(CTMEventProvider provider) const { return GetProviderState(provider).isEnabled; }
+    const char*                GetSourceName() const { return eventSource ? eventSource->GetName() : "None"; }
+    //Events lost since the session started (the kernel had nowhere to put them, or our rings were full), and if any of it happened lately
+    std::uint64_t              GetEventsLost() const { return eventsLost; }
+    bool                       HasRecentEventLoss() const;
+    double                     GetEventRate() const { return eventRate; }
+    //Pipeline numbers plus whatever the source adds, only the pipeline's once the session stopped
+    CTMEventTracingDiagnostics GetDiagnostics();
+
+private: //Constructors and Destructors
+    CTMEventSessionManager()  = default;
+    ~CTMEventSessionManager() { StopSession(); }
+
+    //No need for copy or move operations
+    CTMEventSessionManager(const CTMEventSessionManager&)            = delete;
+    CTMEventSessionManager& operator=(const CTMEventSessionManager&) = delete;
+    CTMEventSessionManager(CTMEventSessionManager&&)                 = delete;
+    CTMEventSessionManager& operator=(CTMEventSessionManager&&)      = delete;
+
+private: //Helper functions
+    struct CTMProviderState
+    {
+        std::chrono::steady_clock::time_point idleSince; //Last release which took the count to 0
+        std::uint32_t                         referenceCount = 0;
+        bool                                  isEnabled      = false;
+    };
+
+    bool                    StartSession();
+    void                    StopSession();
+    void                    PollSession();
+    static std::uint64_t    CountEventsLost(const CTMEventTracingDiagnostics&);
+    CTMProviderState&       GetProviderState(CTMEventProvider provider)       { return providerStates[static_cast<std::size_t>(provider)]; }
+    const CTMProviderState& GetProviderState(CTMEventProvider provider) const { return providerStates[static_cast<std::size_t>(provider)]; }
+
+private: //Processing thread states
+    enum class CTMProcessingState : std::uint8_t
+    {
+        Running,
+        Finished, //Source ran out of events (replays) or the session was stopped from outside
+        Failed
+    };
+
+private: //Event session stuff
+    std::unique_ptr<CTMEventSource> eventSource;
+    std::thread                     processingThread;
+    std::atomic<CTMProcessingState> processingState{CTMProcessingState::Finished};
+    CTMProviderState                providerStates[static_cast<std::size_t>(CTMEventProvider::Count)];
+    //Long enough to look at another screen and come back without a gap, short enough to not pay for kernel events nobody looks at
+    constexpr static std::chrono::seconds providerIdleTimeout{60};
+
+private: //Session health, polled once a second
+    CTMEventTracingDiagnostics            polledDiagnostics;
+    std::chrono::steady_clock::time_point lastPollTime;
+    std::chrono::steady_clock::time_point lastEventLossTime;
+    std::uint64_t                         eventsLost     = 0;
+    double                                eventRate      = 0.0; //Network, file and context switch events per second, over the last poll
+    double                                peakEventRate  = 0.0; //Of this run, saved for the next one's buffer sizing
+    constexpr static std::chrono::seconds pollInterval{1};
+    //Warning stays up this long after the last loss, one bad second shouldn't flash by unseen
+    constexpr static std::chrono::seconds eventLossWarningDuration{30};
+
+private: //Settings (buffer sizes of the session)
+    CTMStateManager& stateManager = CTMStateManager::GetInstance();
+
+private: //Resource guard
+    CTMCriticalResourceGuard& resourceGuard              = CTMCriticalResourceGuard::GetInstance();
+    //Just a unique name for cleanup function
+    const char*               sessionCleanupFunctionName = "CTMEventSessionManager::StopSession";
+};
+
+#endif
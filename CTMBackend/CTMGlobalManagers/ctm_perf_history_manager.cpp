@@ -0,0 +1,279 @@
+#include "ctm_perf_history_manager.h"
+
+//Don't really want these macros, they are messing up the std::max and std::min functions
+#undef max
+#undef min
+
+//--------------------CONSTRUCTOR AND DESTRUCTOR--------------------
+CTMPerformanceHistoryManager::CTMPerformanceHistoryManager()
+{
+    //Lower bounds of sigma come from ctm_anomaly_detector.h, the anomaly check replays traces with the same ones
+    GetSampledSeries(CTMHistorySeriesIndex::CpuUsage).SetAnomalyParameters("Total CPU Usage (%)", CTMAnomalyMinSigma::cpuUsage);
+    GetSampledSeries(CTMHistorySeriesIndex::MemoryInUse).SetAnomalyParameters("Memory In Use (GB)", CTMAnomalyMinSigma::memoryInUse);
+    GetSampledSeries(CTMHistorySeriesIndex::NetworkSent).SetAnomalyParameters("Network Sent (KB/s)", CTMAnomalyMinSigma::network);
+    GetSampledSeries(CTMHistorySeriesIndex::NetworkRecieved).SetAnomalyParameters("Network Recieved (KB/s)", CTMAnomalyMinSigma::network);
+    GetSampledSeries(CTMHistorySeriesIndex::DpcTime).SetAnomalyParameters("DPC Time (%)", CTMAnomalyMinSigma::dpcTime);
+    GetSampledSeries(CTMHistorySeriesIndex::IsrTime).SetAnomalyParameters("ISR Time (%)", CTMAnomalyMinSigma::dpcTime);
+
+    //First CPU sample is against these, not against 0
+    FILETIME ftIdleTime, ftKernelTime, ftUserTime;
+    if(GetSystemTimes(&ftIdleTime, &ftKernelTime, &ftUserTime))
+    {
+        prevIdleTime   = reinterpret_cast<ULARGE_INTEGER&>(ftIdleTime);
+        prevKernelTime = reinterpret_cast<ULARGE_INTEGER&>(ftKernelTime);
+        prevUserTime   = reinterpret_cast<ULARGE_INTEGER&>(ftUserTime);
+    }
+
+    //Network and disks just stay empty without PDH, the rest doesn't need it
+    if(!InitPDH())
+        CTM_LOG_WARNING("Network and disk history won't be recorded.");
+
+    startTime = lastSampleTime = std::chrono::steady_clock::now();
+}
+
+CTMPerformanceHistoryManager::~CTMPerformanceHistoryManager()
+{
+    if(hQuery)
+    {
+        PdhCloseQuery(hQuery);
+        resourceGuard.UnregisterCleanupFunction(pdhCleanupFunctionName);
+    }
+}
+
+//--------------------CONSTRUCTOR FUNCTIONS--------------------
+bool CTMPerformanceHistoryManager::InitPDH()
+{
+    PDH_STATUS status = PdhOpenQueryA(nullptr, 0, &hQuery);
+    if(status != ERROR_SUCCESS)
+    {
+        CTM_LOG_ERROR("Failed to open query for performance history. Error code: ", status);
+        hQuery = nullptr;
+        return false;
+    }
+
+    //Initialize resource guard incase of a crash (for PDH query)
+    resourceGuard.RegisterCleanupFunction(pdhCleanupFunctionName, [this](){
+        PdhCloseQuery(hQuery);
+    });
+
+    //Same counters the network page shows, every interface summed up
+    if(PdhAddEnglishCounterA(hQuery, "\\Network Interface(*)\\Bytes Sent/sec", 0, &hNetworkSent) != ERROR_SUCCESS ||
+       PdhAddEnglishCounterA(hQuery, "\\Network Interface(*)\\Bytes Received/sec", 0, &hNetworkRecieved) != ERROR_SUCCESS)
+    {
+        CTM_LOG_ERROR("Failed to add network counters for performance history.");
+        hNetworkSent = hNetworkRecieved = nullptr;
+    }
+
+    InitDrives();
+
+    //Rate counters need a first collection to have something to compare against
+    status = PdhCollectQueryData(hQuery);
+    if(status != ERROR_SUCCESS)
+        CTM_LOG_WARNING("Failed to collect performance history counters initially. Error code: ", status);
+
+    return true;
+}
+
+void CTMPerformanceHistoryManager::InitDrives()
+{
+    DWORD diskDriveMask = GetLogicalDrives();
+    if(diskDriveMask == 0)
+    {
+        CTM_LOG_ERROR("Failed to get logical disk drives for performance history. Error code: ", GetLastError());
+        return;
+    }
+
+    //This is reused for every single drive available (the ~ is replaced when running the loop)
+    char pdhReadQuery[]  = "\\LogicalDisk(~:)\\Disk Read Bytes/sec";
+    char pdhWriteQuery[] = "\\LogicalDisk(~:)\\Disk Write Bytes/sec";
+    const std::uint8_t tildePos = 13;
+
+    for(char letter = 'A'; letter <= 'Z'; letter++)
+    {
+        if(!(diskDriveMask & (1 << (letter - 'A'))))
+            continue;
+
+        pdhReadQuery[tildePos]  = letter;
+        pdhWriteQuery[tildePos] = letter;
+
+        //Drives PDH doesn't know about (network drives, empty card readers...) simply don't get a history
+        PDH_HCOUNTER hReadCounter, hWriteCounter;
+        if(PdhAddEnglishCounterA(hQuery, pdhReadQuery, 0, &hReadCounter) != ERROR_SUCCESS)
+            continue;
+        if(PdhAddEnglishCounterA(hQuery, pdhWriteQuery, 0, &hWriteCounter) != ERROR_SUCCESS)
+        {
+            PdhRemoveCounter(hReadCounter);
+            continue;
+        }
+
+        auto& diskHistory          = diskHistories.emplace_back();
+        diskHistory.letterAssigned = letter;
+        diskHistory.hReadCounter   = hReadCounter;
+        diskHistory.hWriteCounter  = hWriteCounter;
+        diskHistory.readName       = std::string("Disk ") + letter + ": Read (KB/s)";
+        diskHistory.writeName      = std::string("Disk ") + letter + ": Write (KB/s)";
+    }
+
+    //Names only after the vector is done growing, moving a short string moves its characters too
+    for(auto& diskHistory : diskHistories)
+    {
+        diskHistory.read.SetAnomalyParameters(diskHistory.readName.c_str(), CTMAnomalyMinSigma::disk);
+        diskHistory.write.SetAnomalyParameters(diskHistory.writeName.c_str(), CTMAnomalyMinSigma::disk);
+    }
+}
+
+//--------------------MAIN FUNCTIONS--------------------
+void CTMPerformanceHistoryManager::Update()
+{
+    auto now = std::chrono::steady_clock::now();
+    if(now - lastSampleTime < sampleInterval)
+        return;
+
+    //X is whole seconds since we started, samples stay on that grid instead of drifting by a frame every second.
+    //If nobody called us for a while (the message loop stuck in a modal loop, the machine asleep) X jumps, the tiers turn that into a hole
+    auto   sampleSeconds  = std::chrono::duration_cast<std::chrono::seconds>(now - startTime);
+    auto   sampleTime     = startTime + sampleSeconds;
+    double elapsedSeconds = std::chrono::duration<double>(sampleTime - lastSampleTime).count();
+    lastSampleTime = sampleTime;
+    currentX       = static_cast<double>(sampleSeconds.count());
+
+    SampleCpu();
+    SampleMemory();
+    SampleNetworkAndDisks();
+    SampleDpc(elapsedSeconds);
+}
+
+//--------------------GETTER FUNCTIONS--------------------
+const CTMDiskHistory* CTMPerformanceHistoryManager::GetDiskHistory(char letter) const
+{
+    for(const auto& diskHistory : diskHistories)
+        if(diskHistory.letterAssigned == letter)
+            return &diskHistory;
+    return nullptr;
+}
+
+//--------------------SAMPLING FUNCTIONS--------------------
+void CTMPerformanceHistoryManager::SampleCpu()
+{
+    //These values represent the total amount of time the system has spent in various states
+    FILETIME ftIdleTime, ftKernelTime, ftUserTime;
+    if(!GetSystemTimes(&ftIdleTime, &ftKernelTime, &ftUserTime))
+        return;
+
+    ULARGE_INTEGER currentIdleTime   = reinterpret_cast<ULARGE_INTEGER&>(ftIdleTime),
+                   currentKernelTime = reinterpret_cast<ULARGE_INTEGER&>(ftKernelTime),
+                   currentUserTime   = reinterpret_cast<ULARGE_INTEGER&>(ftUserTime);
+
+    //Kernel time includes idle time, same math as the CPU page
+    ULONGLONG totalTimeDiff = (currentKernelTime.QuadPart + currentUserTime.QuadPart) - (prevKernelTime.QuadPart + prevUserTime.QuadPart);
+    ULONGLONG idleTimeDiff  = currentIdleTime.QuadPart - prevIdleTime.QuadPart;
+
+    prevIdleTime   = currentIdleTime;
+    prevKernelTime = currentKernelTime;
+    prevUserTime   = currentUserTime;
+
+    GetSampledSeries(CTMHistorySeriesIndex::CpuUsage).AddSample(currentX, totalTimeDiff ? ((100.0 * (totalTimeDiff - idleTimeDiff)) / totalTimeDiff) : 0.0);
+}
+
+void CTMPerformanceHistoryManager::SampleMemory()
+{
+    MEMORYSTATUSEX memStatus = {};
+    memStatus.dwLength = sizeof(MEMORYSTATUSEX);
+    if(!GlobalMemoryStatusEx(&memStatus))
+        return;
+
+    GetSampledSeries(CTMHistorySeriesIndex::MemoryInUse).AddSample(currentX, CTM_BYTES_TO_GB(memStatus.ullTotalPhys) - CTM_BYTES_TO_GB(memStatus.ullAvailPhys));
+}
+
+void CTMPerformanceHistoryManager::SampleNetworkAndDisks()
+{
+    if(!hQuery)
+        return;
+
+    PDH_STATUS status = PdhCollectQueryData(hQuery);
+    if(status != ERROR_SUCCESS)
+    {
+        CTM_LOG_ERROR("Failed to collect data for performance history. Error code: ", status);
+        return;
+    }
+
+    if(hNetworkSent && hNetworkRecieved)
+    {
+        GetSampledSeries(CTMHistorySeriesIndex::NetworkSent).AddSample(currentX, GetPdhCounterArraySumKB(hNetworkSent));
+        GetSampledSeries(CTMHistorySeriesIndex::NetworkRecieved).AddSample(currentX, GetPdhCounterArraySumKB(hNetworkRecieved));
+    }
+
+    for(auto& diskHistory : diskHistories)
+    {
+        PDH_FMT_COUNTERVALUE readValue = {}, writeValue = {};
+        DWORD dwType;
+        //A drive which went away (usb stick pulled out) just stops getting samples
+        if(PdhGetFormattedCounterValue(diskHistory.hReadCounter, PDH_FMT_LARGE, &dwType, &readValue) != ERROR_SUCCESS ||
+           PdhGetFormattedCounterValue(diskHistory.hWriteCounter, PDH_FMT_LARGE, &dwType, &writeValue) != ERROR_SUCCESS)
+            continue;
+
+        diskHistory.read.AddSample(currentX, readValue.largeValue / 1024.0);
+        diskHistory.write.AddSample(currentX, writeValue.largeValue / 1024.0);
+    }
+}
+
+void CTMPerformanceHistoryManager::SampleDpc(double elapsedSeconds)
+{
+    //Nobody holds the DPC provider, no events are coming in and 0% would be a lie
+    bool isDpcProviderEnabled = eventSessionManager.IsProviderEnabled(CTMEventProvider::KernelDpc);
+    globalDpcLatencyTracker.GetCoreUsage(coreUsage);
+
+    //Everything the tracker gives out is cumulative, the first sample after the provider came back is against what it had back then
+    if(isDpcProviderEnabled && wasDpcProviderEnabled)
+    {
+        std::uint64_t dpcMicros = 0, isrMicros = 0;
+        for(std::size_t core = 0; core < coreUsage.size(); core++)
+        {
+            CTMCoreDpcUsage previous = core < prevCoreUsage.size() ? prevCoreUsage[core] : CTMCoreDpcUsage{};
+            //The tracker got cleared in between (benchmark, never the UI), start over from here
+            if(coreUsage[core].dpcMicros < previous.dpcMicros || coreUsage[core].isrMicros < previous.isrMicros)
+                previous = CTMCoreDpcUsage{};
+
+            dpcMicros += coreUsage[core].dpcMicros - previous.dpcMicros;
+            isrMicros += coreUsage[core].isrMicros - previous.isrMicros;
+        }
+
+        //Share of every logical processor's time, not just the ones which had a DPC
+        double coreMicros = std::max(elapsedSeconds, 0.001) * 1000000.0 * std::max<DWORD>(GetActiveProcessorCount(ALL_PROCESSOR_GROUPS), 1);
+        GetSampledSeries(CTMHistorySeriesIndex::DpcTime).AddSample(currentX, dpcMicros * 100.0 / coreMicros);
+        GetSampledSeries(CTMHistorySeriesIndex::IsrTime).AddSample(currentX, isrMicros * 100.0 / coreMicros);
+    }
+
+    prevCoreUsage         = coreUsage;
+    wasDpcProviderEnabled = isDpcProviderEnabled;
+}
+
+//--------------------HELPER FUNCTIONS--------------------
+double CTMPerformanceHistoryManager::GetPdhCounterArraySumKB(PDH_HCOUNTER hCounter)
+{
+    PDH_STATUS status;
+    //Chances are, we may not be having big enough buffer value. Check for that and resize accordingly
+    do
+    {
+        status = PdhGetFormattedCounterArrayA(hCounter, PDH_FMT_LARGE, &counterArrayBufferSize, &counterArrayItemCount,
+                                    reinterpret_cast<PPDH_FMT_COUNTERVALUE_ITEM_A>(counterArrayBuffer.data()));
+
+        if(status == PDH_MORE_DATA)
+            counterArrayBuffer.resize(counterArrayBufferSize);
+    }
+    while(status == PDH_MORE_DATA);
+
+    if(status != ERROR_SUCCESS)
+    {
+        CTM_LOG_ERROR("Failed to get array data for performance history counter. Error code: ", status);
+        return 0;
+    }
+
+    PPDH_FMT_COUNTERVALUE_ITEM_A counterArray = reinterpret_cast<PPDH_FMT_COUNTERVALUE_ITEM_A>(counterArrayBuffer.data());
+
+    std::uint64_t totalBytes = 0;
+    for(DWORD i = 0; i < counterArrayItemCount; i++)
+        totalBytes += counterArray[i].FmtValue.largeValue;
+
+    return (totalBytes / 1024.0);
+}
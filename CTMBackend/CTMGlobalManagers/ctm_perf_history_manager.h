@@ -0,0 +1,122 @@
+#ifndef CTM_PERF_HISTORY_MANAGER_HPP
+#define CTM_PERF_HISTORY_MANAGER_HPP
+
+/*
+ * This class is a 'Singleton'. It samples every series the performance graphs show, once a second for as long as the app runs,
+ * so the 10 minute, 1 hour and 24 hour ranges still have everything after switching pages (or not having the performance screen open at all).
+ * Screens bind their graphs to the series in here and only read them, they don't add samples.
+ * Every series is a 'CTMHistorySeries' (~401 KB at most, check ctm_perf_graph.h): CPU, memory, 2 for network, 2 for DPC/ISR and 2 per drive.
+ * DPC/ISR time only comes in while something holds the DPC provider (the DPC/ISR page and the minute after it), it is skipped otherwise.
+ * Only used from the UI thread (Update is called every loop of the app, minimized or not), hence no locks.
+ */
+
+//Windows stuff
+#include <windows.h>
+#include <pdh.h>
+#include <pdhmsg.h>
+//My stuff
+#include "ctm_critical_resource_guard.h"
+#include "ctm_event_session_manager.h"
+#include "../CTMPureHeaderFiles/ctm_logger.h"
+#include "../CTMPureHeaderFiles/ctm_constants.h"
+#include "../CTMPerformanceScreen/ctm_perf_graph.h"
+#include "../CTMProcessScreen/ctm_dpc_latency_tracker.h"
+//Stdlib stuff
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cstdint>
+
+//Series which aren't per drive
+enum class CTMHistorySeriesIndex : std::uint8_t
+{
+    CpuUsage,        //%
+    MemoryInUse,     //GB
+    NetworkSent,     //KB/s
+    NetworkRecieved, //KB/s
+    DpcTime,         //% of every logical processor's time
+    IsrTime,
+    Count
+};
+
+//Read and write series of a single drive, both in KB/s
+struct CTMDiskHistory
+{
+    CTMHistorySeries<double> read, write;
+    std::string              readName, writeName; //For the anomaly events list
+    PDH_HCOUNTER             hReadCounter  = nullptr;
+    PDH_HCOUNTER             hWriteCounter = nullptr;
+    char                     letterAssigned = 0;
+};
+
+class CTMPerformanceHistoryManager
+{
+public:
+    static CTMPerformanceHistoryManager& GetInstance()
+    {
+        static CTMPerformanceHistoryManager performanceHistoryManager;
+        return performanceHistoryManager;
+    }
+
+public: //Main functions
+    //Called every loop of the app (not just rendered frames), samples everything once 'sampleInterval' has passed
+    void Update();
+
+public: //Getter functions
+    //X of the latest samples, in seconds since the first sample
+    double                          GetCurrentX() const { return currentX; }
+    const CTMHistorySeries<double>& GetSeries(CTMHistorySeriesIndex index) const { return series[static_cast<std::size_t>(index)]; }
+    //nullptr if the drive didn't get its counters
+    const CTMDiskHistory*           GetDiskHistory(char) const;
+
+private: //Constructors and Destructors
+    CTMPerformanceHistoryManager();
+    ~CTMPerformanceHistoryManager();
+
+    //No need for copy or move operations
+    CTMPerformanceHistoryManager(const CTMPerformanceHistoryManager&)            = delete;
+    CTMPerformanceHistoryManager& operator=(const CTMPerformanceHistoryManager&) = delete;
+    CTMPerformanceHistoryManager(CTMPerformanceHistoryManager&&)                 = delete;
+    CTMPerformanceHistoryManager& operator=(CTMPerformanceHistoryManager&&)      = delete;
+
+private: //Constructor functions
+    bool InitPDH();
+    void InitDrives();
+
+private: //Sampling functions, each one adds a sample at 'currentX' to its series
+    void SampleCpu();
+    void SampleMemory();
+    void SampleNetworkAndDisks();
+    void SampleDpc(double);
+
+private: //Helper functions
+    CTMHistorySeries<double>& GetSampledSeries(CTMHistorySeriesIndex index) { return series[static_cast<std::size_t>(index)]; }
+    double                    GetPdhCounterArraySumKB(PDH_HCOUNTER);
+
+private: //Series
+    CTMHistorySeries<double>    series[static_cast<std::size_t>(CTMHistorySeriesIndex::Count)];
+    std::vector<CTMDiskHistory> diskHistories; //Built once in the constructor, never resized after (graphs keep pointers into it)
+    double                      currentX = 0;
+
+private: //Sampling state
+    std::chrono::steady_clock::time_point startTime, lastSampleTime;
+    ULARGE_INTEGER                        prevIdleTime = {}, prevKernelTime = {}, prevUserTime = {};
+    std::vector<CTMCoreDpcUsage>          coreUsage, prevCoreUsage;
+    bool                                  wasDpcProviderEnabled = false;
+    constexpr static std::chrono::seconds sampleInterval{1};
+
+private: //PDH variables (network and disks share one query)
+    PDH_HQUERY        hQuery = nullptr;
+    PDH_HCOUNTER      hNetworkSent = nullptr, hNetworkRecieved = nullptr;
+    DWORD             counterArrayBufferSize = 0;
+    DWORD             counterArrayItemCount  = 0;
+    std::vector<BYTE> counterArrayBuffer;
+
+private: //Global managers
+    CTMEventSessionManager&   eventSessionManager    = CTMEventSessionManager::GetInstance();
+    CTMCriticalResourceGuard& resourceGuard          = CTMCriticalResourceGuard::GetInstance();
+    //Unique names for registering resource guard
+    const char*               pdhCleanupFunctionName = "CTMPerformanceHistoryManager::CleanupPDH";
+};
+
+#endif
@@ -29,7 +29,17 @@ enum class CTMSettingKey : std::uint8_t
 
     //Display related settings
     DisplayTheme,
-    DisplayMode
+    DisplayMode,
+
+    //Event tracing session buffers, 0 -> sized automatically (check ctm_etw_buffer_policy.h)
+    EtwBufferSizeKB,
+    EtwMinimumBuffers,
+    EtwMaximumBuffers,
+    EtwFlushTimer,
+    EtwPeakEventRate, //Not a setting the user picks, highest events/s of the last run so the next one starts with big enough buffers
+
+    //DPC/ISR page, runs at or above this many microseconds are counted as long (check ctm_dpc_latency_tracker.h)
+    DpcThresholdMicros
 };
 
 //Makes my life EASIER
@@ -83,7 +93,9 @@ private: //Settings variables
     const char* iniFileName = "CTMSettings.ini";
     SettingsMap settingsMap;
     //String repr of 'CTMSettingKey' enum, internal to this class
-    constexpr static const char* CTMSettingKeyStringRepr[] = { "CTMScreenState", "CTMPerfState", "CTMDisplayTheme", "CTMDisplayMode" };
+    constexpr static const char* CTMSettingKeyStringRepr[] = { "CTMScreenState", "CTMPerfState", "CTMDisplayTheme", "CTMDisplayMode",
+                                                               "CTMEtwBufferSizeKB", "CTMEtwMinimumBuffers", "CTMEtwMaximumBuffers",
+                                                               "CTMEtwFlushTimer", "CTMEtwPeakEventRate", "CTMDpcThresholdMicros" };
 };
 
 //--------------------SETTINGS MANAGER (TEMPLATED FUNCTIONS)--------------------
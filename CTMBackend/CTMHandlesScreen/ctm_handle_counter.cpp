@@ -0,0 +1,164 @@
+#include "ctm_handle_counter.h"
+
+//Don't really want these macros, they are messing up the std::max and std::min functions
+#undef max
+#undef min
+
+CTMHandleCounter::~CTMHandleCounter()
+{
+    JoinWorkerThread();
+}
+
+//--------------------MAIN FUNCTIONS--------------------
+bool CTMHandleCounter::CountAsync()
+{
+    if(isBusy.load() || !IsAvailable())
+        return false;
+
+    JoinWorkerThread();
+    isBusy.store(true);
+    workerThread = std::thread([this](){
+        Count();
+        isBusy.store(false);
+    });
+
+    return true;
+}
+
+void CTMHandleCounter::CountHandles(const CTM_SYSTEM_HANDLE_TABLE_ENTRY_INFO_EX* handles, std::size_t handleCount,
+                                    const CTMHandleCountsSnapshot* previous, CTMHandleCountsSnapshot& outCounts)
+{
+    TypeHandleCounts&       typeHandleCounts       = outCounts.typeHandleCounts;
+    ProcessHandleCountsMap& processHandleCountsMap = outCounts.processHandleCountsMap;
+    typeHandleCounts.assign(previous ? previous->typeCount : 0, 0);
+
+    /*
+     * Stream over the table straight from the buffer. Handles of a process are next to each other in the table,-
+     * -so remembering the last process saves a hash lookup for almost every entry
+     */
+    DWORD                lastProcessId    = static_cast<DWORD>(-1);
+    ProcessHandleCounts* lastHandleCounts = nullptr;
+    for(std::size_t i = 0; i < handleCount; i++)
+    {
+        const CTM_SYSTEM_HANDLE_TABLE_ENTRY_INFO_EX& entry = handles[i];
+        DWORD processId = static_cast<DWORD>(entry.UniqueProcessId);
+        if(processId != lastProcessId || !lastHandleCounts)
+        {
+            //unordered_map nodes don't move on rehash, so the pointer stays valid
+            lastHandleCounts = &processHandleCountsMap[processId];
+            lastProcessId    = processId;
+            if(lastHandleCounts->countsByType.size() < typeHandleCounts.size())
+                lastHandleCounts->countsByType.resize(typeHandleCounts.size(), 0);
+        }
+
+        //Type we don't know the name of (created after we asked), the other processes catch up below
+        USHORT typeIndex = entry.ObjectTypeIndex;
+        if(typeIndex >= typeHandleCounts.size())
+            typeHandleCounts.resize(typeIndex + 1, 0);
+        if(typeIndex >= lastHandleCounts->countsByType.size())
+            lastHandleCounts->countsByType.resize(typeHandleCounts.size(), 0);
+
+        ++lastHandleCounts->countsByType[typeIndex];
+        ++lastHandleCounts->totalCount;
+        ++typeHandleCounts[typeIndex];
+    }
+
+    //Every per type vector gets the same size, the previous counts of a process that is still around become its deltas
+    std::size_t typeCount = typeHandleCounts.size();
+    outCounts.typeCount   = typeCount;
+    outCounts.handleCount = handleCount;
+    outCounts.prevTypeHandleCounts.assign(typeCount, 0);
+    if(previous)
+        std::copy_n(previous->typeHandleCounts.begin(), std::min(previous->typeCount, typeCount), outCounts.prevTypeHandleCounts.begin());
+
+    for(auto&& [processId, handleCounts] : processHandleCountsMap)
+    {
+        handleCounts.countsByType.resize(typeCount, 0);
+        handleCounts.prevCountsByType.assign(typeCount, 0);
+        if(!previous)
+            continue;
+
+        auto it = previous->processHandleCountsMap.find(processId);
+        if(it == previous->processHandleCountsMap.end())
+            continue;
+
+        const ProcessHandleCounts& prevCounts = it->second;
+        std::copy_n(prevCounts.countsByType.begin(), std::min(prevCounts.countsByType.size(), typeCount), handleCounts.prevCountsByType.begin());
+        handleCounts.prevTotalCount = prevCounts.totalCount;
+        handleCounts.processName    = prevCounts.processName;
+        handleCounts.hasPrevious    = true;
+    }
+}
+
+//--------------------GETTERS--------------------
+HandleCountsSnapshotPtr CTMHandleCounter::GetSnapshot()
+{
+    std::lock_guard<std::mutex> lock(snapshotMutex);
+    return snapshot;
+}
+
+//--------------------WORKER THREAD FUNCTIONS--------------------
+void CTMHandleCounter::Count()
+{
+    auto startTime = std::chrono::steady_clock::now();
+
+    if(!handleTable.Query())
+        return;
+
+    //Only the worker publishes, so the snapshot it reads here is the one it published last
+    HandleCountsSnapshotPtr previous    = GetSnapshot();
+    auto                    newSnapshot = std::make_shared<CTMHandleCountsSnapshot>();
+    CountHandles(handleTable.GetHandles(), handleTable.GetHandleCount(), previous.get(), *newSnapshot);
+    UpdateProcessNames(*newSnapshot);
+    newSnapshot->bufferSize     = handleTable.GetBufferSize();
+    newSnapshot->snapshotTimeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+
+    std::lock_guard<std::mutex> lock(snapshotMutex);
+    snapshot = std::move(newSnapshot);
+}
+
+void CTMHandleCounter::UpdateProcessNames(CTMHandleCountsSnapshot& counts)
+{
+    //Names carry over from the previous snapshot, only new processes need one
+    bool hasUnnamed = std::any_of(counts.processHandleCountsMap.begin(), counts.processHandleCountsMap.end(),
+                                  [](const auto& processCounts){ return processCounts.second.processName.empty(); });
+    if(!hasUnnamed)
+        return;
+
+    HANDLE hSnapshot = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
+    if(hSnapshot == INVALID_HANDLE_VALUE)
+    {
+        CTM_LOG_ERROR("Failed to create process snapshot for handle screen. Error code: ", GetLastError());
+        return;
+    }
+
+    PROCESSENTRY32W processEntry;
+    processEntry.dwSize = sizeof(processEntry);
+    CHAR processName[MAX_PATH];
+    if(Process32FirstW(hSnapshot, &processEntry))
+    {
+        do
+        {
+            auto it = counts.processHandleCountsMap.find(processEntry.th32ProcessID);
+            if(it == counts.processHandleCountsMap.end() || !it->second.processName.empty())
+                continue;
+
+            int bytesWritten = WideCharToMultiByte(CP_UTF8, 0, processEntry.szExeFile, -1, processName, sizeof(processName), NULL, NULL);
+            it->second.processName = bytesWritten > 0 ? processName : "<Unknown>";
+        }
+        while(Process32NextW(hSnapshot, &processEntry));
+    }
+
+    CloseHandle(hSnapshot);
+
+    //System Idle Process and anything we couldn't name
+    for(auto&& [_, handleCounts] : counts.processHandleCountsMap)
+        if(handleCounts.processName.empty())
+            handleCounts.processName = "<Unknown>";
+}
+
+void CTMHandleCounter::JoinWorkerThread()
+{
+    if(workerThread.joinable())
+        workerThread.join();
+}
@@ -0,0 +1,98 @@
+#ifndef CTM_HANDLE_COUNTER_HPP
+#define CTM_HANDLE_COUNTER_HPP
+
+//Windows stuff
+#include <windows.h>
+#include <tlhelp32.h>
+//My stuff
+#include "ctm_handle_table.h"
+#include "../CTMPureHeaderFiles/ctm_logger.h"
+//Stdlib stuff
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+
+//Handle counts of a single process, indexed by object type index
+struct ProcessHandleCounts
+{
+    //Perfect 8 byte alignment
+    std::vector<std::uint32_t> countsByType;
+    std::vector<std::uint32_t> prevCountsByType;  //Previous snapshot, for deltas
+    std::string                processName;
+    std::uint32_t              totalCount     = 0;
+    std::uint32_t              prevTotalCount = 0;
+    bool                       hasPrevious    = false; //New processes have nothing to compare against
+};
+
+using ProcessHandleCountsMap = std::unordered_map<DWORD, ProcessHandleCounts>;
+using TypeHandleCounts       = std::vector<std::uint64_t>;
+
+//Every count of one pass over the handle table. Immutable once published, the next pass only reads it for the deltas
+struct CTMHandleCountsSnapshot
+{
+    //Perfect 8 byte alignment
+    ProcessHandleCountsMap processHandleCountsMap; //Only processes with at least one handle, exited ones are gone
+    TypeHandleCounts       typeHandleCounts;
+    TypeHandleCounts       prevTypeHandleCounts;
+    std::uint64_t          handleCount    = 0;
+    std::size_t            bufferSize     = 0;   //What the handle table took, in bytes
+    std::size_t            typeCount      = 0;   //Size of every per type vector above
+    double                 snapshotTimeMs = 0.0;
+};
+
+using HandleCountsSnapshotPtr = std::shared_ptr<const CTMHandleCountsSnapshot>;
+
+/*
+ * Per process and per type handle counts of the whole system, for the handles screen.
+ * A pass queries the full handle table (hundreds of MB on busy machines) and streams over it, which is way too slow-
+ * -for the UI thread. So passes run on a worker thread and publish a snapshot (same idea as the open files index, check ctm_open_files_index.h).
+ */
+class CTMHandleCounter
+{
+public:
+    CTMHandleCounter() = default;
+    ~CTMHandleCounter();
+
+    //No need for copy or move operations
+    CTMHandleCounter(const CTMHandleCounter&)            = delete;
+    CTMHandleCounter& operator=(const CTMHandleCounter&) = delete;
+    CTMHandleCounter(CTMHandleCounter&&)                 = delete;
+    CTMHandleCounter& operator=(CTMHandleCounter&&)      = delete;
+
+public: //Main functions
+    //Starts a pass on the worker thread, does nothing if one is already running
+    bool CountAsync();
+    //Counts a table of handles into 'outCounts', the previous snapshot (if any) gives the deltas and the process names.-
+    //-Pure, the worker feeds it the real table and the event benchmark a generated one
+    static void CountHandles(const CTM_SYSTEM_HANDLE_TABLE_ENTRY_INFO_EX*, std::size_t, const CTMHandleCountsSnapshot*, CTMHandleCountsSnapshot&);
+
+public: //Getters
+    HandleCountsSnapshotPtr GetSnapshot();
+    bool                    IsBusy()      const { return isBusy.load(); }
+    bool                    IsAvailable() const { return handleTable.IsAvailable(); }
+    //Type names are only queried when the table is created, so reading them next to the worker is fine
+    const std::string&      GetTypeName(USHORT typeIndex) const { return handleTable.GetTypeName(typeIndex); }
+
+private: //Worker thread functions
+    void Count();
+    void UpdateProcessNames(CTMHandleCountsSnapshot&);
+    void JoinWorkerThread();
+
+private: //Worker thread
+    CTMSystemHandleTable handleTable;
+    std::thread          workerThread;
+    std::atomic<bool>    isBusy{false};
+
+private: //Published snapshot
+    std::mutex              snapshotMutex;
+    HandleCountsSnapshotPtr snapshot;
+};
+
+#endif
@@ -0,0 +1,140 @@
+#include "ctm_handle_table.h"
+
+CTMSystemHandleTable::CTMSystemHandleTable()
+    : handleTableBuffer(1024 * 1024)
+{
+    if(!CTMConstructorInitNTDLL())
+        return;
+
+    if(!QueryTypeNames())
+        CTM_LOG_WARNING("Failed to get object type names, handle types will be shown as indices.");
+}
+
+//--------------------CONSTRUCTOR INIT FUNCTIONS--------------------
+bool CTMSystemHandleTable::CTMConstructorInitNTDLL()
+{
+    HMODULE hNtdll = GetModuleHandleW(L"ntdll.dll");
+    if(!hNtdll)
+    {
+        CTM_LOG_ERROR("Failed to get module handle for ntdll.dll");
+        return false;
+    }
+
+    NtQuerySystemInformation = reinterpret_cast<NtQuerySystemInformation_t>(
+        GetProcAddress(hNtdll, "NtQuerySystemInformation")
+    );
+    NtQueryObject            = reinterpret_cast<NtQueryObject_t>(
+        GetProcAddress(hNtdll, "NtQueryObject")
+    );
+
+    if(!NtQuerySystemInformation || !NtQueryObject)
+    {
+        CTM_LOG_ERROR("Failed to get proc addresses for ntdll.dll functions");
+        NtQuerySystemInformation = nullptr;
+        return false;
+    }
+
+    return true;
+}
+
+//--------------------MAIN FUNCTIONS--------------------
+bool CTMSystemHandleTable::Query()
+{
+    handleCount = 0;
+    if(!IsAvailable())
+        return false;
+
+    NTSTATUS status;
+    ULONG    requiredSize = 0;
+    do
+    {
+        status = NtQuerySystemInformation(systemExtendedHandleInformation, handleTableBuffer.data(),
+                                          static_cast<ULONG>(handleTableBuffer.size()), &requiredSize);
+
+        //Only ever grow, the next snapshot will most likely need the same size again
+        if(status == STATUS_INFO_LENGTH_MISMATCH)
+            handleTableBuffer.resize((requiredSize > handleTableBuffer.size() ? requiredSize : handleTableBuffer.size()) + bufferSlackSize);
+    }
+    while(status == STATUS_INFO_LENGTH_MISMATCH);
+
+    if(status != STATUS_SUCCESS)
+    {
+        CTM_LOG_ERROR("Failed to get system handle information. Error code: ", status);
+        return false;
+    }
+
+    //Don't trust the count blindly, never read past what the buffer holds
+    auto        handleInfo = reinterpret_cast<PCTM_SYSTEM_HANDLE_INFORMATION_EX>(handleTableBuffer.data());
+    std::size_t maxEntries = (handleTableBuffer.size() - offsetof(CTM_SYSTEM_HANDLE_INFORMATION_EX, Handles)) /
+                             sizeof(CTM_SYSTEM_HANDLE_TABLE_ENTRY_INFO_EX);
+    handleCount = handleInfo->NumberOfHandles < maxEntries ? handleInfo->NumberOfHandles : maxEntries;
+
+    return true;
+}
+
+bool CTMSystemHandleTable::QueryTypeNames()
+{
+    if(!NtQueryObject)
+        return false;
+
+    std::vector<BYTE> typesBuffer(64 * 1024);
+    NTSTATUS          status;
+    ULONG             requiredSize = 0;
+    do
+    {
+        status = NtQueryObject(nullptr, objectTypesInformation, typesBuffer.data(), static_cast<ULONG>(typesBuffer.size()), &requiredSize);
+        if(status == STATUS_INFO_LENGTH_MISMATCH)
+            typesBuffer.resize(requiredSize > typesBuffer.size() ? requiredSize : typesBuffer.size() * 2);
+    }
+    while(status == STATUS_INFO_LENGTH_MISMATCH);
+
+    if(status != STATUS_SUCCESS)
+    {
+        CTM_LOG_ERROR("Failed to get object types information. Error code: ", status);
+        return false;
+    }
+
+    auto typesInfo = reinterpret_cast<PCTM_OBJECT_TYPES_INFORMATION>(typesBuffer.data());
+    //First entry starts pointer aligned after the header
+    BYTE* entryPointer = typesBuffer.data() + ((sizeof(CTM_OBJECT_TYPES_INFORMATION) + sizeof(ULONG_PTR) - 1) & ~(sizeof(ULONG_PTR) - 1));
+
+    typeNames.clear();
+    CHAR typeName[128];
+    for(ULONG i = 0; i < typesInfo->NumberOfTypes; i++)
+    {
+        auto typeInfo = reinterpret_cast<PCTM_OBJECT_TYPE_INFORMATION>(entryPointer);
+
+        //TypeIndex is 0 before 6.3, types started at index 2 back then
+        std::size_t typeIndex = typeInfo->TypeIndex ? typeInfo->TypeIndex : i + 2;
+        if(typeIndex >= typeNames.size())
+            typeNames.resize(typeIndex + 1);
+
+        int bytesWritten = WideCharToMultiByte(CP_UTF8, 0, typeInfo->TypeName.Buffer, typeInfo->TypeName.Length / sizeof(WCHAR),
+                                               typeName, sizeof(typeName) - 1, NULL, NULL);
+        typeNames[typeIndex].assign(typeName, bytesWritten > 0 ? bytesWritten : 0);
+
+        //Name is stored right after the struct, next entry is pointer aligned after the name
+        std::size_t entrySize = sizeof(CTM_OBJECT_TYPE_INFORMATION) + typeInfo->TypeName.MaximumLength;
+        entryPointer         += (entrySize + sizeof(ULONG_PTR) - 1) & ~(sizeof(ULONG_PTR) - 1);
+    }
+
+    return true;
+}
+
+//--------------------GETTERS--------------------
+const std::string& CTMSystemHandleTable::GetTypeName(USHORT typeIndex) const
+{
+    if(typeIndex < typeNames.size() && !typeNames[typeIndex].empty())
+        return typeNames[typeIndex];
+
+    return unknownTypeName;
+}
+
+int CTMSystemHandleTable::FindTypeIndex(const char* typeName) const
+{
+    for(std::size_t i = 0; i < typeNames.size(); i++)
+        if(typeNames[i] == typeName)
+            return static_cast<int>(i);
+
+    return -1;
+}
\ No newline at end of file
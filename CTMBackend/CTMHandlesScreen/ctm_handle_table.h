@@ -0,0 +1,147 @@
+#ifndef CTM_HANDLE_TABLE_HPP
+#define CTM_HANDLE_TABLE_HPP
+
+//Windows stuff
+#include <windows.h>
+#include <winternl.h>
+#include <ntstatus.h>
+//My stuff
+#include "../CTMPureHeaderFiles/ctm_logger.h"
+//Stdlib stuff
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstddef>
+
+//Loaded at runtime from ntdll (same typedef as the process screen, redeclaring it with the same type is fine)
+typedef NTSTATUS(NTAPI* NtQuerySystemInformation_t)
+                (SYSTEM_INFORMATION_CLASS, PVOID, ULONG, PULONG);
+typedef NTSTATUS(NTAPI* NtQueryObject_t)
+                (HANDLE, OBJECT_INFORMATION_CLASS, PVOID, ULONG, PULONG);
+
+//--------------------Some useful structs--------------------
+//SystemExtendedHandleInformation (64) output, not in the SDK headers
+typedef struct _CTM_SYSTEM_HANDLE_TABLE_ENTRY_INFO_EX
+{
+    PVOID     Object;
+    ULONG_PTR UniqueProcessId;
+    ULONG_PTR HandleValue;
+    ULONG     GrantedAccess;
+    USHORT    CreatorBackTraceIndex;
+    USHORT    ObjectTypeIndex;
+    ULONG     HandleAttributes;
+    ULONG     Reserved;
+} CTM_SYSTEM_HANDLE_TABLE_ENTRY_INFO_EX, *PCTM_SYSTEM_HANDLE_TABLE_ENTRY_INFO_EX;
+
+typedef struct _CTM_SYSTEM_HANDLE_INFORMATION_EX
+{
+    ULONG_PTR                             NumberOfHandles;
+    ULONG_PTR                             Reserved;
+    CTM_SYSTEM_HANDLE_TABLE_ENTRY_INFO_EX Handles[1];
+} CTM_SYSTEM_HANDLE_INFORMATION_EX, *PCTM_SYSTEM_HANDLE_INFORMATION_EX;
+
+//ObjectTypesInformation (3) output. winternl.h only has the public version with everything after TypeName hidden
+typedef struct _CTM_OBJECT_TYPE_INFORMATION
+{
+    UNICODE_STRING  TypeName;
+    ULONG           TotalNumberOfObjects;
+    ULONG           TotalNumberOfHandles;
+    ULONG           TotalPagedPoolUsage;
+    ULONG           TotalNonPagedPoolUsage;
+    ULONG           TotalNamePoolUsage;
+    ULONG           TotalHandleTableUsage;
+    ULONG           HighWaterNumberOfObjects;
+    ULONG           HighWaterNumberOfHandles;
+    ULONG           HighWaterPagedPoolUsage;
+    ULONG           HighWaterNonPagedPoolUsage;
+    ULONG           HighWaterNamePoolUsage;
+    ULONG           HighWaterHandleTableUsage;
+    ULONG           InvalidAttributes;
+    GENERIC_MAPPING GenericMapping;
+    ULONG           ValidAccessMask;
+    BOOLEAN         SecurityRequired;
+    BOOLEAN         MaintainHandleCount;
+    UCHAR           TypeIndex; //Available in 6.3 and higher
+    CHAR            ReservedByte;
+    ULONG           PoolType;
+    ULONG           DefaultPagedPoolCharge;
+    ULONG           DefaultNonPagedPoolCharge;
+} CTM_OBJECT_TYPE_INFORMATION, *PCTM_OBJECT_TYPE_INFORMATION;
+
+typedef struct _CTM_OBJECT_TYPES_INFORMATION
+{
+    ULONG NumberOfTypes;
+} CTM_OBJECT_TYPES_INFORMATION, *PCTM_OBJECT_TYPES_INFORMATION;
+
+using HandleTableBuffer = std::vector<BYTE>;
+using ObjectTypeNames   = std::vector<std::string>;
+
+/*
+ * Snapshot of the whole system handle table, taken with a single NtQuerySystemInformation call.
+ * On busy machines the table can be hundreds of MB, so the buffer is kept around between snapshots (only grows) and-
+ * -entries are handed to the caller straight from the buffer through 'ForEachHandle', nothing gets copied.
+ * Used by the handles screen and by the job object grouping of the process screen.
+ */
+class CTMSystemHandleTable
+{
+public:
+    CTMSystemHandleTable();
+    ~CTMSystemHandleTable() = default;
+
+    //No need for copy or move operations
+    CTMSystemHandleTable(const CTMSystemHandleTable&)            = delete;
+    CTMSystemHandleTable& operator=(const CTMSystemHandleTable&) = delete;
+    CTMSystemHandleTable(CTMSystemHandleTable&&)                 = delete;
+    CTMSystemHandleTable& operator=(CTMSystemHandleTable&&)      = delete;
+
+public: //Main functions
+    bool Query();
+    bool QueryTypeNames();
+
+    //Calls 'fn(const CTM_SYSTEM_HANDLE_TABLE_ENTRY_INFO_EX&)' for every entry of the last snapshot, in table order-
+    //-which groups handles of the same process together
+    template<typename Fn>
+    void ForEachHandle(Fn&& fn) const
+    {
+        if(handleCount == 0)
+            return;
+
+        auto handleInfo = reinterpret_cast<const CTM_SYSTEM_HANDLE_INFORMATION_EX*>(handleTableBuffer.data());
+        for(ULONG_PTR i = 0; i < handleCount; i++)
+            fn(handleInfo->Handles[i]);
+    }
+
+public: //Getters
+    bool               IsAvailable()    const { return NtQuerySystemInformation != nullptr; }
+    ULONG_PTR          GetHandleCount() const { return handleCount; }
+    //First entry of the last snapshot, 'GetHandleCount' of them follow it
+    const CTM_SYSTEM_HANDLE_TABLE_ENTRY_INFO_EX* GetHandles() const
+    {
+        return reinterpret_cast<const CTM_SYSTEM_HANDLE_INFORMATION_EX*>(handleTableBuffer.data())->Handles;
+    }
+    std::size_t        GetBufferSize()  const { return handleTableBuffer.size(); }
+    //Type indices are sparse-ish and small (< 256), names vector is indexed by them directly
+    std::size_t        GetTypeCount()   const { return typeNames.size(); }
+    const std::string& GetTypeName(USHORT) const;
+    int                FindTypeIndex(const char*) const; //-1 if not found
+
+private: //Constructor init functions
+    bool CTMConstructorInitNTDLL();
+
+private: //Dynamically loaded functions
+    NtQuerySystemInformation_t NtQuerySystemInformation = nullptr;
+    NtQueryObject_t            NtQueryObject            = nullptr;
+
+private: //Snapshot
+    HandleTableBuffer handleTableBuffer;
+    ULONG_PTR         handleCount = 0;
+    ObjectTypeNames   typeNames;
+    std::string       unknownTypeName = "Unknown";
+
+private: //Constant stuff
+    constexpr static SYSTEM_INFORMATION_CLASS systemExtendedHandleInformation = static_cast<SYSTEM_INFORMATION_CLASS>(64);
+    constexpr static OBJECT_INFORMATION_CLASS objectTypesInformation          = static_cast<OBJECT_INFORMATION_CLASS>(3);
+    constexpr static std::size_t              bufferSlackSize                 = 256 * 1024; //Table grows between the two calls
+};
+
+#endif
\ No newline at end of file
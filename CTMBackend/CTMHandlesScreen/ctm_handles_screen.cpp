@@ -0,0 +1,351 @@
+#include "ctm_handles_screen.h"
+
+//Don't really want these macros, they are messing up the std::max and std::min functions
+#undef max
+#undef min
+
+//Equivalent to OnInit function
+CTMHandlesScreen::CTMHandlesScreen()
+{
+    if(!handleCounter.IsAvailable())
+    {
+        CTM_LOG_ERROR("System handle table is not available, look at the above errors for more information.");
+        return;
+    }
+
+    //Start the first pass right away, the tables show up once it's done
+    handleCounter.CountAsync();
+    SetInitialized(true);
+}
+
+//Equivalent to OnClean function
+CTMHandlesScreen::~CTMHandlesScreen()
+{
+    SetInitialized(false);
+}
+
+//--------------------MAIN RENDER AND UPDATE FUNCTIONS--------------------
+void CTMHandlesScreen::OnRender()
+{
+    if(!handleCountsSnapshot)
+    {
+        ImGui::TextDisabled("Counting the handles of every process...");
+        return;
+    }
+
+    RenderToolbar();
+    ImGui::Separator();
+
+    if(ImGui::CollapsingHeader("By Type", ImGuiTreeNodeFlags_DefaultOpen))
+        RenderTypeTable();
+
+    if(ImGui::CollapsingHeader("By Process", ImGuiTreeNodeFlags_DefaultOpen))
+        RenderProcessTable();
+
+    isOpenFilesVisible = ImGui::CollapsingHeader("Open Files");
+    if(isOpenFilesVisible)
+        RenderOpenFiles();
+}
+
+void CTMHandlesScreen::OnUpdate()
+{
+    HandleCountsSnapshotPtr latestSnapshot = handleCounter.GetSnapshot();
+    if(latestSnapshot != handleCountsSnapshot)
+    {
+        handleCountsSnapshot = std::move(latestSnapshot);
+        UpdateSortedViews();
+    }
+
+    //Snapshots of huge handle tables are not free, let the user decide how often. A pass which takes longer just delays the next one
+    if(++updatesSinceRefresh < refreshIntervalSeconds)
+        return;
+
+    updatesSinceRefresh = 0;
+    handleCounter.CountAsync();
+
+    //Resolving file paths is a lot more expensive than counting, don't do it if nobody is looking
+    if(isOpenFilesVisible)
+        openFilesIndex.RefreshAsync();
+}
+
+//--------------------RENDER HELPER FUNCTIONS--------------------
+void CTMHandlesScreen::RenderToolbar()
+{
+    ImGui::Text("Handles: %llu | Processes: %zu | Types: %zu | Snapshot: %.1lf ms | Buffer: %.1lf MB%s",
+                static_cast<unsigned long long>(handleCountsSnapshot->handleCount), handleCountsSnapshot->processHandleCountsMap.size(),
+                sortedTypeIndices.size(), handleCountsSnapshot->snapshotTimeMs, handleCountsSnapshot->bufferSize / (1024.0 * 1024.0),
+                handleCounter.IsBusy() ? " | Counting..." : "");
+
+    ImGui::SetNextItemWidth(150.0f);
+    ImGui::SliderInt("Refresh (s)", &refreshIntervalSeconds, 1, 10);
+    ImGui::SameLine();
+    if(ImGui::Checkbox("Sort By Growth", &isSortByGrowth))
+        UpdateSortedViews();
+    ImGui::SameLine();
+    ImGui::SetNextItemWidth(200.0f);
+    ImGui::InputTextWithHint("##HandlesProcessFilter", "Filter processes", filterTextBuffer, sizeof(filterTextBuffer));
+}
+
+void CTMHandlesScreen::RenderTypeTable()
+{
+    if(!ImGui::BeginTable("HandleTypesTable", 3, ImGuiTableFlags_SizingStretchProp | ImGuiTableFlags_BordersInnerV |
+                                                 ImGuiTableFlags_ScrollY, {-1.0f, 200.0f}))
+        return;
+
+    ImGui::TableSetupScrollFreeze(0, 1);
+    ImGui::TableSetupColumn("Type");
+    ImGui::TableSetupColumn("Handles");
+    ImGui::TableSetupColumn("Change");
+    ImGui::TableHeadersRow();
+
+    const TypeHandleCounts& typeHandleCounts     = handleCountsSnapshot->typeHandleCounts;
+    const TypeHandleCounts& prevTypeHandleCounts = handleCountsSnapshot->prevTypeHandleCounts;
+    for(auto&& typeIndex : sortedTypeIndices)
+    {
+        ImGui::TableNextRow();
+        ImGui::TableSetColumnIndex(0);
+        ImGui::TextUnformatted(handleCounter.GetTypeName(static_cast<USHORT>(typeIndex)).c_str());
+        ImGui::TableSetColumnIndex(1);
+        ImGui::Text("%llu", static_cast<unsigned long long>(typeHandleCounts[typeIndex]));
+        ImGui::TableSetColumnIndex(2);
+        RenderDelta(static_cast<std::int64_t>(typeHandleCounts[typeIndex]) - static_cast<std::int64_t>(prevTypeHandleCounts[typeIndex]), true);
+    }
+
+    ImGui::EndTable();
+}
+
+void CTMHandlesScreen::RenderProcessTable()
+{
+    if(!ImGui::BeginTable("HandleProcessesTable", 4, ImGuiTableFlags_SizingStretchProp | ImGuiTableFlags_BordersInnerV |
+                                                     ImGuiTableFlags_Resizable | ImGuiTableFlags_ScrollX))
+        return;
+
+    ImGui::TableSetupColumn("Name / Type", ImGuiTableColumnFlags_WidthFixed);
+    ImGui::TableSetupColumn("PID", ImGuiTableColumnFlags_WidthFixed);
+    ImGui::TableSetupColumn("Handles", ImGuiTableColumnFlags_WidthFixed);
+    ImGui::TableSetupColumn("Change", ImGuiTableColumnFlags_WidthFixed);
+    ImGui::TableHeadersRow();
+
+    //Case insensitive 'contains' filter, lower case the filter once per frame
+    char filterLower[sizeof(filterTextBuffer)];
+    std::size_t filterLength = std::strlen(filterTextBuffer);
+    for(std::size_t i = 0; i <= filterLength; i++)
+        filterLower[i] = static_cast<char>(std::tolower(static_cast<unsigned char>(filterTextBuffer[i])));
+
+    const ProcessHandleCountsMap& processHandleCountsMap = handleCountsSnapshot->processHandleCountsMap;
+    std::string                   nameLower;
+    for(auto&& processId : sortedProcessIds)
+    {
+        auto it = processHandleCountsMap.find(processId);
+        if(it == processHandleCountsMap.end())
+            continue;
+
+        const ProcessHandleCounts& handleCounts = it->second;
+        if(filterLength > 0)
+        {
+            nameLower.resize(handleCounts.processName.size());
+            std::transform(handleCounts.processName.begin(), handleCounts.processName.end(), nameLower.begin(),
+                           [](unsigned char c){ return static_cast<char>(std::tolower(c)); });
+            if(nameLower.find(filterLower) == std::string::npos)
+                continue;
+        }
+
+        ImGui::TableNextRow();
+        ImGui::TableSetColumnIndex(0);
+        ImGui::PushID(static_cast<int>(processId));
+        bool expandTree = ImGui::TreeNodeEx(handleCounts.processName.c_str(), ImGuiTreeNodeFlags_SpanAllColumns);
+        ImGui::PopID();
+
+        ImGui::TableSetColumnIndex(1);
+        ImGui::Text("%lu", processId);
+        ImGui::TableSetColumnIndex(2);
+        ImGui::Text("%u", handleCounts.totalCount);
+        ImGui::TableSetColumnIndex(3);
+        RenderDelta(static_cast<std::int64_t>(handleCounts.totalCount) - handleCounts.prevTotalCount, handleCounts.hasPrevious);
+
+        if(expandTree)
+        {
+            RenderProcessTypeRows(handleCounts);
+            ImGui::TreePop();
+        }
+    }
+
+    ImGui::EndTable();
+}
+
+void CTMHandlesScreen::RenderProcessTypeRows(const ProcessHandleCounts& handleCounts)
+{
+    //Only for expanded rows, so sorting here every frame is fine
+    SortedIndexVector typeIndices;
+    for(std::uint32_t i = 0; i < handleCounts.countsByType.size(); i++)
+        if(handleCounts.countsByType[i] > 0 || (handleCounts.hasPrevious && handleCounts.prevCountsByType[i] > 0))
+            typeIndices.push_back(i);
+
+    std::sort(typeIndices.begin(), typeIndices.end(), [&handleCounts](std::uint32_t left, std::uint32_t right){
+        return handleCounts.countsByType[left] > handleCounts.countsByType[right];
+    });
+
+    for(auto&& typeIndex : typeIndices)
+    {
+        ImGui::TableNextRow();
+        ImGui::TableSetColumnIndex(0);
+        ImGui::Indent();
+        ImGui::TextUnformatted(handleCounter.GetTypeName(static_cast<USHORT>(typeIndex)).c_str());
+        ImGui::Unindent();
+        ImGui::TableSetColumnIndex(2);
+        ImGui::Text("%u", handleCounts.countsByType[typeIndex]);
+        ImGui::TableSetColumnIndex(3);
+        RenderDelta(static_cast<std::int64_t>(handleCounts.countsByType[typeIndex]) - handleCounts.prevCountsByType[typeIndex],
+                    handleCounts.hasPrevious);
+    }
+}
+
+void CTMHandlesScreen::RenderDelta(std::int64_t delta, bool hasPrevious)
+{
+    if(!hasPrevious)
+        ImGui::TextDisabled("new");
+    else if(delta > 0)
+        ImGui::TextColored(growthColor, "+%lld", static_cast<long long>(delta));
+    else if(delta < 0)
+        ImGui::TextColored(shrinkColor, "%lld", static_cast<long long>(delta));
+    else
+        ImGui::TextDisabled("0");
+}
+
+void CTMHandlesScreen::RenderOpenFiles()
+{
+    if(!openFilesIndex.IsAvailable())
+    {
+        ImGui::TextDisabled("Open files index is not available.");
+        return;
+    }
+
+    //Kick off the first pass as soon as the section is opened instead of waiting for the next refresh
+    OpenFilesSnapshotPtr latestSnapshot = openFilesIndex.GetSnapshot();
+    if(!latestSnapshot && !openFilesIndex.IsBusy())
+        openFilesIndex.RefreshAsync();
+
+    bool isQueryChanged = ImGui::InputTextWithHint("##OpenFilesQuery", "Path or path prefix (e.g. D:\\deploy\\)", pathQueryBuffer, sizeof(pathQueryBuffer));
+    if(isQueryChanged || latestSnapshot != openFilesSnapshot)
+    {
+        openFilesSnapshot = std::move(latestSnapshot);
+        UpdateOpenFileMatches();
+    }
+
+    if(!openFilesSnapshot)
+    {
+        ImGui::TextDisabled("Indexing open files...");
+        return;
+    }
+
+    ImGui::Text("Paths: %zu | File handles: %llu | Processes: %u (%u rescanned) | Index build: %.1lf ms | Query: %.3lf ms%s",
+                openFilesSnapshot->entries.size(), static_cast<unsigned long long>(openFilesSnapshot->fileHandleCount),
+                openFilesSnapshot->processCount, openFilesSnapshot->rescannedCount, openFilesSnapshot->buildTimeMs, lastQueryTimeMs,
+                openFilesIndex.IsBusy() ? " | Refreshing..." : "");
+
+    if(!ImGui::BeginTable("OpenFilesTable", 2, ImGuiTableFlags_SizingStretchProp | ImGuiTableFlags_BordersInnerV |
+                                               ImGuiTableFlags_Resizable | ImGuiTableFlags_ScrollY, {-1.0f, 300.0f}))
+        return;
+
+    ImGui::TableSetupScrollFreeze(0, 1);
+    ImGui::TableSetupColumn("Path");
+    ImGui::TableSetupColumn("Processes");
+    ImGui::TableHeadersRow();
+
+    //Prefix '' matches every open file on the system, only submit the visible rows
+    ImGuiListClipper clipper;
+    clipper.Begin(static_cast<int>(openFileMatches.size()));
+    while(clipper.Step())
+    {
+        for(int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++)
+        {
+            const CTMOpenFileEntry& fileEntry = openFilesSnapshot->entries[openFileMatches[i]];
+            ImGui::TableNextRow();
+            ImGui::TableSetColumnIndex(0);
+            ImGui::TextUnformatted(fileEntry.path.c_str());
+            ImGui::TableSetColumnIndex(1);
+            RenderOpenFileProcesses(fileEntry);
+        }
+    }
+
+    ImGui::EndTable();
+}
+
+void CTMHandlesScreen::RenderOpenFileProcesses(const CTMOpenFileEntry& fileEntry)
+{
+    const ProcessHandleCountsMap& processHandleCountsMap = handleCountsSnapshot->processHandleCountsMap;
+    for(std::size_t i = 0; i < fileEntry.processIds.size(); i++)
+    {
+        DWORD processId = fileEntry.processIds[i];
+        auto  it        = processHandleCountsMap.find(processId);
+        if(i > 0)
+        {
+            ImGui::SameLine(0.0f, 0.0f);
+            ImGui::TextUnformatted(", ");
+            ImGui::SameLine(0.0f, 0.0f);
+        }
+
+        ImGui::Text("%s (%lu)", it != processHandleCountsMap.end() ? it->second.processName.c_str() : "<Exited>", processId);
+    }
+}
+
+//--------------------UPDATE HELPER FUNCTIONS--------------------
+void CTMHandlesScreen::UpdateSortedViews()
+{
+    const TypeHandleCounts&       typeHandleCounts       = handleCountsSnapshot->typeHandleCounts;
+    const TypeHandleCounts&       prevTypeHandleCounts   = handleCountsSnapshot->prevTypeHandleCounts;
+    const ProcessHandleCountsMap& processHandleCountsMap = handleCountsSnapshot->processHandleCountsMap;
+
+    sortedTypeIndices.clear();
+    for(std::uint32_t i = 0; i < handleCountsSnapshot->typeCount; i++)
+        if(typeHandleCounts[i] > 0 || prevTypeHandleCounts[i] > 0)
+            sortedTypeIndices.push_back(i);
+
+    sortedProcessIds.clear();
+    sortedProcessIds.reserve(processHandleCountsMap.size());
+    for(auto&& [processId, _] : processHandleCountsMap)
+        sortedProcessIds.push_back(processId);
+
+    //Every id in there came from the map, so 'at' never throws
+    if(isSortByGrowth)
+    {
+        std::sort(sortedTypeIndices.begin(), sortedTypeIndices.end(), [&](std::uint32_t left, std::uint32_t right){
+            return static_cast<std::int64_t>(typeHandleCounts[left]) - static_cast<std::int64_t>(prevTypeHandleCounts[left]) >
+                   static_cast<std::int64_t>(typeHandleCounts[right]) - static_cast<std::int64_t>(prevTypeHandleCounts[right]);
+        });
+        std::sort(sortedProcessIds.begin(), sortedProcessIds.end(), [&processHandleCountsMap](DWORD left, DWORD right){
+            const ProcessHandleCounts& leftCounts  = processHandleCountsMap.at(left);
+            const ProcessHandleCounts& rightCounts = processHandleCountsMap.at(right);
+            std::int64_t leftDelta  = leftCounts.hasPrevious ? static_cast<std::int64_t>(leftCounts.totalCount) - leftCounts.prevTotalCount : 0;
+            std::int64_t rightDelta = rightCounts.hasPrevious ? static_cast<std::int64_t>(rightCounts.totalCount) - rightCounts.prevTotalCount : 0;
+            return leftDelta > rightDelta;
+        });
+    }
+    else
+    {
+        std::sort(sortedTypeIndices.begin(), sortedTypeIndices.end(), [&typeHandleCounts](std::uint32_t left, std::uint32_t right){
+            return typeHandleCounts[left] > typeHandleCounts[right];
+        });
+        std::sort(sortedProcessIds.begin(), sortedProcessIds.end(), [&processHandleCountsMap](DWORD left, DWORD right){
+            return processHandleCountsMap.at(left).totalCount > processHandleCountsMap.at(right).totalCount;
+        });
+    }
+}
+
+void CTMHandlesScreen::UpdateOpenFileMatches()
+{
+    if(!openFilesSnapshot)
+    {
+        openFileMatches.clear();
+        return;
+    }
+
+    //Same normalization as the index keys, also accept forward slashes
+    lowerPathQuery = pathQueryBuffer;
+    for(auto&& c : lowerPathQuery)
+        c = c == '/' ? '\\' : static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+
+    auto startTime = std::chrono::steady_clock::now();
+    CTMOpenFilesIndex::FindByPrefix(*openFilesSnapshot, lowerPathQuery, openFileMatches);
+    lastQueryTimeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+}
\ No newline at end of file
@@ -0,0 +1,76 @@
+#ifndef CTM_HANDLES_SCREEN_HPP
+#define CTM_HANDLES_SCREEN_HPP
+
+//Windows stuff
+#include <windows.h>
+//ImGui stuff
+#include "../../ImGUI/imgui.h"
+//My stuff
+#include "ctm_handle_counter.h"
+#include "ctm_open_files_index.h"
+#include "../CTMPureHeaderFiles/ctm_base_state.h"
+#include "../CTMPureHeaderFiles/ctm_logger.h"
+//Stdlib stuff
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <cctype>
+
+using SortedIndexVector      = std::vector<std::uint32_t>;
+using SortedProcessIdVector  = std::vector<DWORD>;
+
+class CTMHandlesScreen : public CTMBaseScreen
+{
+public:
+    CTMHandlesScreen();
+    ~CTMHandlesScreen() override;
+
+protected:
+    void OnRender() override;
+    void OnUpdate() override;
+
+private: //Render helper functions
+    void RenderToolbar();
+    void RenderTypeTable();
+    void RenderProcessTable();
+    void RenderProcessTypeRows(const ProcessHandleCounts&);
+    void RenderDelta(std::int64_t, bool);
+    void RenderOpenFiles();
+    void RenderOpenFileProcesses(const CTMOpenFileEntry&);
+
+private: //Update helper functions
+    void UpdateSortedViews();
+    void UpdateOpenFileMatches();
+
+private: //Handle counts, counted on the counter's worker thread
+    CTMHandleCounter        handleCounter;
+    HandleCountsSnapshotPtr handleCountsSnapshot;
+
+private: //Sorted views, rebuilt once per snapshot instead of every frame
+    SortedIndexVector     sortedTypeIndices;
+    SortedProcessIdVector sortedProcessIds;
+
+private: //Open files index, only refreshed while its section is open
+    CTMOpenFilesIndex    openFilesIndex;
+    OpenFilesSnapshotPtr openFilesSnapshot;
+    OpenFileEntryIndices openFileMatches;
+    std::string          lowerPathQuery;
+    double               lastQueryTimeMs    = 0.0;
+    bool                 isOpenFilesVisible = false;
+    char                 pathQueryBuffer[MAX_PATH] = {};
+
+private: //UI state
+    int  refreshIntervalSeconds = 2;
+    int  updatesSinceRefresh    = 0;
+    bool isSortByGrowth         = false;
+    char filterTextBuffer[64]   = {};
+
+    ImVec4 growthColor = {1.0f, 0.45f, 0.45f, 1.0f};
+    ImVec4 shrinkColor = {0.45f, 0.9f, 0.45f, 1.0f};
+};
+
+#endif
\ No newline at end of file
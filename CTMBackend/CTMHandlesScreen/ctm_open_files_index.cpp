@@ -0,0 +1,353 @@
+#include "ctm_open_files_index.h"
+
+CTMOpenFilesIndex::~CTMOpenFilesIndex()
+{
+    JoinWorkerThread();
+    StopPathQueryThread();
+}
+
+//--------------------MAIN FUNCTIONS--------------------
+bool CTMOpenFilesIndex::RefreshAsync()
+{
+    if(isBusy.load() || !IsAvailable())
+        return false;
+
+    JoinWorkerThread();
+    isBusy.store(true);
+    workerThread = std::thread([this](){
+        RefreshIndex();
+        isBusy.store(false);
+    });
+
+    return true;
+}
+
+void CTMOpenFilesIndex::FindByPrefix(const CTMOpenFilesSnapshot& snapshot, const std::string& lowerPrefix, OpenFileEntryIndices& outIndices)
+{
+    outIndices.clear();
+
+    auto first = std::lower_bound(snapshot.entries.begin(), snapshot.entries.end(), lowerPrefix,
+                                  [](const CTMOpenFileEntry& entry, const std::string& prefix){ return entry.lowerPath < prefix; });
+
+    //Everything starting with the prefix sorts right after it, so matches are one contiguous run
+    for(auto it = first; it != snapshot.entries.end() && it->lowerPath.compare(0, lowerPrefix.size(), lowerPrefix) == 0; ++it)
+        outIndices.push_back(static_cast<std::uint32_t>(it - snapshot.entries.begin()));
+}
+
+//--------------------GETTERS--------------------
+OpenFilesSnapshotPtr CTMOpenFilesIndex::GetSnapshot()
+{
+    std::lock_guard<std::mutex> lock(snapshotMutex);
+    return snapshot;
+}
+
+//--------------------WORKER THREAD FUNCTIONS--------------------
+void CTMOpenFilesIndex::RefreshIndex()
+{
+    auto startTime = std::chrono::steady_clock::now();
+
+    if(fileTypeIndex < 0)
+    {
+        fileTypeIndex = handleTable.FindTypeIndex("File");
+        if(fileTypeIndex < 0)
+        {
+            CTM_LOG_ERROR("Failed to find the 'File' object type, open files can't be indexed.");
+            return;
+        }
+    }
+
+    if(!handleTable.Query())
+        return;
+
+    for(auto&& [_, processOpenFiles] : processOpenFilesMap)
+        processOpenFiles.isSeen = false;
+
+    //First pass only counts 'File' handles per process, that's all we need to know who changed
+    std::unordered_map<DWORD, std::uint32_t> fileHandleCounts;
+    std::uint64_t                            fileHandleCount = 0;
+    DWORD                                    lastProcessId   = static_cast<DWORD>(-1);
+    std::uint32_t*                           lastCount       = nullptr;
+    handleTable.ForEachHandle([&](const CTM_SYSTEM_HANDLE_TABLE_ENTRY_INFO_EX& entry){
+        if(entry.ObjectTypeIndex != fileTypeIndex)
+            return;
+
+        DWORD processId = static_cast<DWORD>(entry.UniqueProcessId);
+        if(processId != lastProcessId || !lastCount)
+        {
+            lastCount     = &fileHandleCounts[processId];
+            lastProcessId = processId;
+        }
+        ++*lastCount;
+        ++fileHandleCount;
+    });
+
+    //Processes which are new or whose 'File' handle count changed get rescanned
+    std::unordered_map<DWORD, std::vector<ULONG_PTR>> changedProcesses;
+    for(auto&& [processId, count] : fileHandleCounts)
+    {
+        auto it = processOpenFilesMap.find(processId);
+        if(it == processOpenFilesMap.end() || it->second.fileHandleCount != count)
+            changedProcesses[processId].reserve(count);
+
+        CTMProcessOpenFiles& processOpenFiles = processOpenFilesMap[processId];
+        processOpenFiles.fileHandleCount      = count;
+        processOpenFiles.isSeen               = true;
+    }
+
+    for(auto it = processOpenFilesMap.begin(); it != processOpenFilesMap.end(); )
+    {
+        if(!it->second.isSeen)
+            it = processOpenFilesMap.erase(it);
+        else
+            ++it;
+    }
+
+    //Second pass collects handle values, only for the processes we rescan
+    if(!changedProcesses.empty())
+    {
+        lastProcessId = static_cast<DWORD>(-1);
+        std::vector<ULONG_PTR>* lastHandles = nullptr;
+        handleTable.ForEachHandle([&](const CTM_SYSTEM_HANDLE_TABLE_ENTRY_INFO_EX& entry){
+            if(entry.ObjectTypeIndex != fileTypeIndex)
+                return;
+
+            DWORD processId = static_cast<DWORD>(entry.UniqueProcessId);
+            if(processId != lastProcessId)
+            {
+                auto it       = changedProcesses.find(processId);
+                lastHandles   = it != changedProcesses.end() ? &it->second : nullptr;
+                lastProcessId = processId;
+            }
+            if(lastHandles)
+                lastHandles->push_back(entry.HandleValue);
+        });
+    }
+
+    for(auto&& [processId, handleValues] : changedProcesses)
+        RescanProcess(processId, processOpenFilesMap[processId], handleValues);
+
+    auto newSnapshot             = std::make_shared<CTMOpenFilesSnapshot>();
+    newSnapshot->fileHandleCount = fileHandleCount;
+    newSnapshot->rescannedCount  = static_cast<std::uint32_t>(changedProcesses.size());
+    newSnapshot->processCount    = static_cast<std::uint32_t>(processOpenFilesMap.size());
+    BuildSnapshot(*newSnapshot);
+    newSnapshot->buildTimeMs     = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+
+    std::lock_guard<std::mutex> lock(snapshotMutex);
+    snapshot = std::move(newSnapshot);
+}
+
+void CTMOpenFilesIndex::RescanProcess(DWORD processId, CTMProcessOpenFiles& processOpenFiles, const std::vector<ULONG_PTR>& handleValues)
+{
+    processOpenFiles.paths.clear();
+    processOpenFiles.lowerPaths.clear();
+
+    //Protected and system processes will fail here, nothing we can do about them without a driver
+    HANDLE hProcess = OpenProcess(PROCESS_DUP_HANDLE, FALSE, processId);
+    if(!hProcess)
+        return;
+
+    std::string path;
+    bool        isStuck = false;
+    for(auto&& handleValue : handleValues)
+    {
+        auto& stuckHandleValues = processOpenFiles.stuckHandleValues;
+        if(std::find(stuckHandleValues.begin(), stuckHandleValues.end(), handleValue) != stuckHandleValues.end())
+            continue;
+
+        if(ResolveFilePath(hProcess, handleValue, path, isStuck))
+            processOpenFiles.paths.push_back(path);
+        else if(isStuck)
+            stuckHandleValues.push_back(handleValue);
+    }
+
+    CloseHandle(hProcess);
+
+    //Same file opened multiple times by the same process only counts once
+    std::sort(processOpenFiles.paths.begin(), processOpenFiles.paths.end());
+    processOpenFiles.paths.erase(std::unique(processOpenFiles.paths.begin(), processOpenFiles.paths.end()), processOpenFiles.paths.end());
+
+    processOpenFiles.lowerPaths.reserve(processOpenFiles.paths.size());
+    for(auto&& filePath : processOpenFiles.paths)
+    {
+        std::string& lowerPath = processOpenFiles.lowerPaths.emplace_back(filePath);
+        std::transform(lowerPath.begin(), lowerPath.end(), lowerPath.begin(), [](unsigned char c){ return static_cast<char>(std::tolower(c)); });
+    }
+}
+
+bool CTMOpenFilesIndex::ResolveFilePath(HANDLE hProcess, ULONG_PTR handleValue, std::string& outPath, bool& outIsStuck)
+{
+    outIsStuck = false;
+    if(abandonedQueryCount >= maxAbandonedQueries)
+        return false;
+
+    HANDLE hFile = nullptr;
+    if(!DuplicateHandle(hProcess, reinterpret_cast<HANDLE>(handleValue), GetCurrentProcess(), &hFile, 0, FALSE, DUPLICATE_SAME_ACCESS))
+        return false;
+
+    /*
+     * Only disk files. Asking for the name of a pipe with a pending synchronous read blocks forever,-
+     * -GetFileType doesn't have that problem so it acts as the cheap filter. Disk files opened for synchronous io can still block-
+     * -the same way, hence the timeout in 'QueryFinalPath'
+     */
+    if(GetFileType(hFile) != FILE_TYPE_DISK)
+    {
+        CloseHandle(hFile);
+        return false;
+    }
+
+    //The query thread closes the handle, stuck or not
+    DWORD pathLength = 0;
+    if(!QueryFinalPath(hFile, pathLength))
+    {
+        outIsStuck = true;
+        return false;
+    }
+
+    if(pathLength == 0 || pathLength >= pathBuffer.size())
+        return false;
+
+    //Strip the '\\?\' prefix (and turn '\\?\UNC\' back into '\\') so paths look like what users type
+    const wchar_t* pathStart = pathBuffer.data();
+    if(pathLength >= 8 && wcsncmp(pathStart, L"\\\\?\\UNC\\", 8) == 0)
+    {
+        pathBuffer[6] = L'\\';
+        pathStart    += 6;
+        pathLength   -= 6;
+    }
+    else if(pathLength >= 4 && wcsncmp(pathStart, L"\\\\?\\", 4) == 0)
+    {
+        pathStart  += 4;
+        pathLength -= 4;
+    }
+
+    int bytesNeeded = WideCharToMultiByte(CP_UTF8, 0, pathStart, static_cast<int>(pathLength), NULL, 0, NULL, NULL);
+    if(bytesNeeded <= 0)
+        return false;
+
+    outPath.resize(bytesNeeded);
+    WideCharToMultiByte(CP_UTF8, 0, pathStart, static_cast<int>(pathLength), outPath.data(), bytesNeeded, NULL, NULL);
+    return true;
+}
+
+bool CTMOpenFilesIndex::QueryFinalPath(HANDLE hFile, DWORD& outPathLength)
+{
+    if(!pathQueryState)
+    {
+        pathQueryState  = std::make_shared<CTMPathQueryState>();
+        pathQueryThread = std::thread(PathQueryThread, pathQueryState);
+    }
+
+    std::unique_lock<std::mutex> lock(pathQueryState->queryMutex);
+    pathQueryState->hFile      = hFile;
+    pathQueryState->hasRequest = true;
+    pathQueryState->hasResult  = false;
+    pathQueryState->queryCondition.notify_all();
+
+    if(!pathQueryState->queryCondition.wait_for(lock, pathQueryTimeout, [this](){ return pathQueryState->hasResult; }))
+    {
+        //Nothing we can do to unblock it, so leave it be. It exits on its own if the query ever returns
+        pathQueryState->isStopping = true;
+        lock.unlock();
+        pathQueryThread.detach();
+        pathQueryState.reset();
+
+        if(++abandonedQueryCount == maxAbandonedQueries)
+            CTM_LOG_WARNING("Too many file path queries got stuck, open files won't be resolved anymore.");
+        return false;
+    }
+
+    outPathLength = pathQueryState->pathLength;
+    //Buffers just trade places, the query thread grows ours back if it has to
+    pathBuffer.swap(pathQueryState->pathBuffer);
+    return true;
+}
+
+void CTMOpenFilesIndex::StopPathQueryThread()
+{
+    if(!pathQueryState)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(pathQueryState->queryMutex);
+        pathQueryState->isStopping = true;
+    }
+    pathQueryState->queryCondition.notify_all();
+
+    //Not stuck, those got detached, so it is just waiting for the next request
+    if(pathQueryThread.joinable())
+        pathQueryThread.join();
+    pathQueryState.reset();
+}
+
+void CTMOpenFilesIndex::PathQueryThread(PathQueryStatePtr queryState)
+{
+    std::unique_lock<std::mutex> lock(queryState->queryMutex);
+    while(true)
+    {
+        queryState->queryCondition.wait(lock, [&queryState](){ return queryState->hasRequest || queryState->isStopping; });
+        if(queryState->isStopping)
+            break;
+
+        HANDLE hFile = queryState->hFile;
+        queryState->hasRequest = false;
+        lock.unlock();
+
+        //This is the call that may never return, the worker stops waiting on us after 'pathQueryTimeout'
+        std::wstring& pathBuffer = queryState->pathBuffer;
+        if(pathBuffer.size() < MAX_PATH)
+            pathBuffer.resize(MAX_PATH);
+
+        DWORD pathLength = GetFinalPathNameByHandleW(hFile, pathBuffer.data(), static_cast<DWORD>(pathBuffer.size()), FILE_NAME_NORMALIZED | VOLUME_NAME_DOS);
+        if(pathLength >= pathBuffer.size())
+        {
+            pathBuffer.resize(pathLength + 1);
+            pathLength = GetFinalPathNameByHandleW(hFile, pathBuffer.data(), static_cast<DWORD>(pathBuffer.size()), FILE_NAME_NORMALIZED | VOLUME_NAME_DOS);
+        }
+        CloseHandle(hFile);
+
+        lock.lock();
+        queryState->pathLength = pathLength;
+        queryState->hasResult  = true;
+        queryState->queryCondition.notify_all();
+    }
+
+    //Given up on before we even got to it
+    if(queryState->hasRequest)
+        CloseHandle(queryState->hFile);
+}
+
+void CTMOpenFilesIndex::BuildSnapshot(CTMOpenFilesSnapshot& outSnapshot)
+{
+    struct PathReference
+    {
+        const std::string* lowerPath;
+        const std::string* path;
+        DWORD              processId;
+    };
+
+    std::vector<PathReference> pathReferences;
+    for(auto&& [processId, processOpenFiles] : processOpenFilesMap)
+        for(std::size_t i = 0; i < processOpenFiles.paths.size(); i++)
+            pathReferences.push_back({&processOpenFiles.lowerPaths[i], &processOpenFiles.paths[i], processId});
+
+    std::sort(pathReferences.begin(), pathReferences.end(), [](const PathReference& left, const PathReference& right){
+        int compareResult = left.lowerPath->compare(*right.lowerPath);
+        return compareResult != 0 ? compareResult < 0 : left.processId < right.processId;
+    });
+
+    //Group references to the same path into one entry
+    for(auto&& pathReference : pathReferences)
+    {
+        if(outSnapshot.entries.empty() || outSnapshot.entries.back().lowerPath != *pathReference.lowerPath)
+            outSnapshot.entries.push_back({*pathReference.lowerPath, *pathReference.path, {}});
+
+        outSnapshot.entries.back().processIds.push_back(pathReference.processId);
+    }
+}
+
+void CTMOpenFilesIndex::JoinWorkerThread()
+{
+    if(workerThread.joinable())
+        workerThread.join();
+}
\ No newline at end of file
@@ -0,0 +1,134 @@
+#ifndef CTM_OPEN_FILES_INDEX_HPP
+#define CTM_OPEN_FILES_INDEX_HPP
+
+//Windows stuff
+#include <windows.h>
+//My stuff
+#include "ctm_handle_table.h"
+#include "../CTMPureHeaderFiles/ctm_logger.h"
+//Stdlib stuff
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cctype>
+#include <cwchar>
+
+//Single file path of the index and every process which has it open
+struct CTMOpenFileEntry
+{
+    std::string        lowerPath;  //Sort/search key, Windows paths are case insensitive
+    std::string        path;       //What we display
+    std::vector<DWORD> processIds; //Sorted, unique
+};
+
+//Immutable once published, the UI keeps a shared_ptr to it so the worker can build the next one meanwhile
+struct CTMOpenFilesSnapshot
+{
+    //Perfect 8 byte alignment
+    std::vector<CTMOpenFileEntry> entries;          //Sorted by 'lowerPath'
+    std::uint64_t                 fileHandleCount   = 0;
+    double                        buildTimeMs       = 0.0;
+    std::uint32_t                 rescannedCount    = 0; //Processes whose paths were resolved again in this pass
+    std::uint32_t                 processCount      = 0;
+};
+
+//Files a process had open the last time it was scanned
+struct CTMProcessOpenFiles
+{
+    //Perfect 8 byte alignment
+    std::vector<std::string> paths;
+    std::vector<std::string> lowerPaths;
+    std::vector<ULONG_PTR>   stuckHandleValues; //Their path query timed out once, never asked again
+    std::uint32_t            fileHandleCount = 0; //'File' handles in the handle table, a change means rescan
+    bool                     isSeen          = false;
+};
+
+//Hand off between the worker and the thread asking for final paths. Shared, because a stuck query thread is left behind-
+//-and may only wake up (if ever) after the index is gone
+struct CTMPathQueryState
+{
+    std::mutex              queryMutex;
+    std::condition_variable queryCondition;
+    std::wstring            pathBuffer;
+    HANDLE                  hFile      = nullptr; //Duplicated by the worker, closed by the query thread
+    DWORD                   pathLength = 0;
+    bool                    hasRequest = false;
+    bool                    hasResult  = false;
+    bool                    isStopping = false;
+};
+
+using OpenFilesSnapshotPtr   = std::shared_ptr<const CTMOpenFilesSnapshot>;
+using PathQueryStatePtr      = std::shared_ptr<CTMPathQueryState>;
+using ProcessOpenFilesMap    = std::unordered_map<DWORD, CTMProcessOpenFiles>;
+using OpenFileEntryIndices   = std::vector<std::uint32_t>;
+
+/*
+ * Reverse index from open file path to the processes holding it ("who has this file open").
+ * Built from the system handle table on a worker thread. Resolving a path means duplicating the handle into our process-
+ * -and asking for its final path, which is slow, so a process is only rescanned when its 'File' handle count changed.
+ * The final path query blocks forever on a synchronous file with a pending read, so it runs on its own thread with a timeout.
+ * On a timeout that thread is left to its fate, the handle is never asked about again and a fresh thread takes the next query.
+ * Lookups are a binary search over the sorted entries, prefix queries return a contiguous range.
+ */
+class CTMOpenFilesIndex
+{
+public:
+    CTMOpenFilesIndex() = default;
+    ~CTMOpenFilesIndex();
+
+    //No need for copy or move operations
+    CTMOpenFilesIndex(const CTMOpenFilesIndex&)            = delete;
+    CTMOpenFilesIndex& operator=(const CTMOpenFilesIndex&) = delete;
+    CTMOpenFilesIndex(CTMOpenFilesIndex&&)                 = delete;
+    CTMOpenFilesIndex& operator=(CTMOpenFilesIndex&&)      = delete;
+
+public: //Main functions
+    //Starts a refresh pass on the worker thread, does nothing if one is already running
+    bool RefreshAsync();
+    //Entries whose path starts with the (lower case) prefix, an empty prefix matches everything
+    static void FindByPrefix(const CTMOpenFilesSnapshot&, const std::string&, OpenFileEntryIndices&);
+
+public: //Getters
+    OpenFilesSnapshotPtr GetSnapshot();
+    bool                 IsBusy()      const { return isBusy.load(); }
+    bool                 IsAvailable() const { return handleTable.IsAvailable(); }
+
+private: //Worker thread functions
+    void RefreshIndex();
+    void RescanProcess(DWORD, CTMProcessOpenFiles&, const std::vector<ULONG_PTR>&);
+    bool ResolveFilePath(HANDLE, ULONG_PTR, std::string&, bool&);
+    bool QueryFinalPath(HANDLE, DWORD&);
+    void StopPathQueryThread();
+    static void PathQueryThread(PathQueryStatePtr);
+    void BuildSnapshot(CTMOpenFilesSnapshot&);
+    void JoinWorkerThread();
+
+private: //Worker thread state
+    CTMSystemHandleTable handleTable;
+    ProcessOpenFilesMap  processOpenFilesMap;
+    int                  fileTypeIndex = -1;
+    std::thread          workerThread;
+    std::atomic<bool>    isBusy{false};
+    std::wstring         pathBuffer;
+
+private: //Path query thread, only touched by the worker
+    PathQueryStatePtr    pathQueryState;
+    std::thread          pathQueryThread;
+    int                  abandonedQueryCount = 0;
+    constexpr static std::chrono::milliseconds pathQueryTimeout{200};
+    constexpr static int                       maxAbandonedQueries = 8; //Past this we stop resolving paths, every stuck thread keeps a handle open
+
+private: //Published snapshot
+    std::mutex           snapshotMutex;
+    OpenFilesSnapshotPtr snapshot;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,532 @@
+#include "ctm_launch_profiler.h"
+
+//Don't really want these macros, they are messing up the std::max and std::min functions
+#undef max
+#undef min
+
+CTMLaunchProfiler::~CTMLaunchProfiler()
+{
+    for(auto&& child : children)
+        if(child.hProcess)
+            CloseHandle(child.hProcess);
+
+    if(hMainProcess)
+        CloseHandle(hMainProcess);
+    if(hJob)
+        CloseHandle(hJob);
+}
+
+//--------------------ENTRY POINTS--------------------
+bool CTMLaunchProfiler::IsProfileModeRequested()
+{
+    int     argc = 0;
+    LPWSTR* argv = CommandLineToArgvW(GetCommandLineW(), &argc);
+    if(!argv)
+        return false;
+
+    bool isRequested = argc > 1 && wcscmp(argv[1], L"--profile") == 0;
+    LocalFree(argv);
+    return isRequested;
+}
+
+int CTMLaunchProfiler::RunFromCommandLine()
+{
+    CTMLaunchProfileOptions launchOptions;
+    if(!ParseOptions(launchOptions))
+    {
+        CTM_LOG_TEXT("Usage: CTMApp --profile [--interval <ms>] [--grace <ms>] [--wait-all] [--csv <file>] -- <command> [args...]");
+        return 1;
+    }
+
+    //Ctrl+C goes to everything attached to the console, let the command deal with it and print our report once it's gone
+    SetConsoleCtrlHandler(ConsoleCtrlHandler, TRUE);
+
+    CTMLaunchProfiler profiler;
+    if(!profiler.Launch(launchOptions))
+        return 1;
+
+    profiler.SampleUntilExit();
+    profiler.PrintReport();
+    if(!launchOptions.csvPath.empty())
+        profiler.ExportCsv(launchOptions.csvPath);
+
+    return static_cast<int>(profiler.mainExitCode);
+}
+
+//--------------------MAIN FUNCTIONS--------------------
+bool CTMLaunchProfiler::Launch(const CTMLaunchProfileOptions& launchOptions)
+{
+    options = launchOptions;
+
+    hJob = CreateJobObjectW(nullptr, nullptr);
+    if(!hJob)
+    {
+        CTM_LOG_ERROR("Failed to create job object for the profiled command. Error code: ", GetLastError());
+        return false;
+    }
+
+    //CreateProcessW may write into the command line buffer, so it gets its own copy
+    std::wstring        commandLine  = options.commandLine;
+    STARTUPINFOW        startupInfo  = {};
+    PROCESS_INFORMATION processInfo  = {};
+    startupInfo.cb = sizeof(startupInfo);
+
+    //Suspended so it can't spawn anything before it is in the job. Handles are inherited so redirected stdout/stderr keep working
+    if(!CreateProcessW(nullptr, commandLine.data(), nullptr, nullptr, TRUE, CREATE_SUSPENDED, nullptr, nullptr, &startupInfo, &processInfo))
+    {
+        CTM_LOG_ERROR("Failed to launch the command to profile. Error code: ", GetLastError());
+        return false;
+    }
+
+    if(!AssignProcessToJobObject(hJob, processInfo.hProcess))
+    {
+        CTM_LOG_ERROR("Failed to assign the profiled command to a job object. Error code: ", GetLastError());
+        TerminateProcess(processInfo.hProcess, 1);
+        CloseHandle(processInfo.hThread);
+        CloseHandle(processInfo.hProcess);
+        return false;
+    }
+
+    hMainProcess = processInfo.hProcess;
+    ResumeThread(processInfo.hThread);
+    CloseHandle(processInfo.hThread);
+
+    CTM_LOG_INFO("Profiling PID ", processInfo.dwProcessId, " and its descendants every ", options.intervalMs, " ms.");
+    return true;
+}
+
+void CTMLaunchProfiler::SampleUntilExit()
+{
+    auto      startTime    = std::chrono::steady_clock::now();
+    auto      nextTickTime = startTime;
+    auto      mainExitTime = startTime;
+    bool      isMainExited = false;
+    ULONGLONG prevCpuTime  = 0;
+    double    prevElapsed  = 0.0;
+
+    //A job only empties once every process in it exited, one daemon the command leaves behind (compiler servers, mspdbsrv) would keep us here forever.-
+    //-So the command exiting starts the grace period, and the tree is done once it runs out
+    auto isGraceOver = [&](){
+        if(options.shouldWaitForTree)
+            return false;
+
+        if(!isMainExited)
+        {
+            if(WaitForSingleObject(hMainProcess, 0) != WAIT_OBJECT_0)
+                return false;
+            isMainExited = true;
+            mainExitTime = std::chrono::steady_clock::now();
+        }
+        return std::chrono::steady_clock::now() - mainExitTime >= std::chrono::milliseconds(options.graceMs);
+    };
+
+    //Fixed cadence, a slow sample doesn't push every following sample back
+    bool isTreeRunning = true;
+    do
+    {
+        nextTickTime += std::chrono::milliseconds(options.intervalMs);
+        std::this_thread::sleep_until(nextTickTime);
+        TrackNewChildren();
+        isTreeRunning = TakeSample(std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count(), prevCpuTime, prevElapsed);
+    }
+    while(isTreeRunning && !isGraceOver());
+
+    //Leftovers don't count towards how long the command took, they get their own line in the report
+    elapsedSeconds = std::chrono::duration<double>((isTreeRunning ? mainExitTime : std::chrono::steady_clock::now()) - startTime).count();
+    if(isTreeRunning)
+        leftRunningCount = samples.back().activeProcesses;
+    GetExitCodeProcess(hMainProcess, &mainExitCode);
+    FinalizeChildren();
+}
+
+void CTMLaunchProfiler::PrintReport()
+{
+    CHAR commandUtf8[1024];
+    int  bytesWritten = WideCharToMultiByte(CP_UTF8, 0, options.commandLine.c_str(), -1, commandUtf8, sizeof(commandUtf8), NULL, NULL);
+    if(bytesWritten <= 0)
+        std::snprintf(commandUtf8, sizeof(commandUtf8), "<Unknown>");
+
+    double peakCpuCores = 0.0;
+    for(auto&& sample : samples)
+        peakCpuCores = std::max(peakCpuCores, sample.cpuCores);
+
+    double totalCpuSeconds = (totalUserTime + totalKernelTime) / 1e7;
+
+    std::printf("\n--------------------CTM LAUNCH PROFILE--------------------\n");
+    std::printf("Command                      : %s\n", commandUtf8);
+    std::printf("Exit code                    : %lu (0x%lX)\n", mainExitCode, mainExitCode);
+    std::printf("Elapsed (wall clock)         : %.3lf s\n", elapsedSeconds);
+    std::printf("User / kernel CPU time       : %.3lf s / %.3lf s\n", totalUserTime / 1e7, totalKernelTime / 1e7);
+    std::printf("CPU average / peak           : %.0lf%% / %.0lf%% (100%% = one core)\n",
+                elapsedSeconds > 0.0 ? totalCpuSeconds / elapsedSeconds * 100.0 : 0.0, peakCpuCores * 100.0);
+    std::printf("Peak private memory (tree)   : %.2lf MB\n", peakJobMemory / (1024.0 * 1024.0));
+    std::printf("Peak private memory (single) : %.2lf MB\n", peakProcessMemory / (1024.0 * 1024.0));
+    std::printf("IO read                      : %.2lf MB (%llu ops)\n", totalReadBytes / (1024.0 * 1024.0), static_cast<unsigned long long>(totalReadOps));
+    std::printf("IO write                     : %.2lf MB (%llu ops)\n", totalWriteBytes / (1024.0 * 1024.0), static_cast<unsigned long long>(totalWriteOps));
+    std::printf("Processes total / peak       : %u / %u\n", totalProcessCount, peakActiveCount);
+    if(leftRunningCount > 0)
+        std::printf("Left running after exit      : %u (still running %.1lf s after the command exited, their numbers are as of then)\n",
+                    leftRunningCount, options.graceMs / 1000.0);
+    std::printf("Samples                      : %zu, every %d ms\n\n", samples.size(), options.intervalMs);
+
+    //Poor man's graphs, good enough to spot a phase that suddenly got slower
+    std::vector<double> cpuSeries, memorySeries, processSeries;
+    for(auto&& sample : samples)
+    {
+        cpuSeries.push_back(sample.cpuCores * 100.0);
+        memorySeries.push_back(sample.privateMemoryMB);
+        processSeries.push_back(sample.activeProcesses);
+    }
+    PrintSparkline("CPU (%)    ", cpuSeries);
+    PrintSparkline("Memory (MB)", memorySeries);
+    PrintSparkline("Processes  ", processSeries);
+
+    //Per image name first (300 x cl.exe is more readable as one line), then the heaviest single processes
+    struct ImageSummary { std::string imageName; double cpuSeconds = 0.0; std::uint64_t peakPrivateMemory = 0, readBytes = 0, writeBytes = 0; std::uint32_t count = 0; };
+    std::vector<ImageSummary>                    imageSummaries;
+    std::unordered_map<std::string, std::size_t> imageSummaryIndices;
+    for(auto&& child : children)
+    {
+        auto it = imageSummaryIndices.find(child.imageName);
+        if(it == imageSummaryIndices.end())
+        {
+            it = imageSummaryIndices.emplace(child.imageName, imageSummaries.size()).first;
+            imageSummaries.push_back({child.imageName});
+        }
+
+        ImageSummary& imageSummary     = imageSummaries[it->second];
+        imageSummary.cpuSeconds       += child.cpuTime / 1e7;
+        imageSummary.peakPrivateMemory = std::max(imageSummary.peakPrivateMemory, child.peakPrivateMemory);
+        imageSummary.readBytes        += child.readBytes;
+        imageSummary.writeBytes       += child.writeBytes;
+        ++imageSummary.count;
+    }
+    std::sort(imageSummaries.begin(), imageSummaries.end(), [](const ImageSummary& left, const ImageSummary& right){
+        return left.cpuSeconds > right.cpuSeconds;
+    });
+
+    std::printf("\nBy image (%zu processes seen", children.size());
+    if(totalProcessCount > children.size())
+        std::printf(", %zu too short lived to be seen, they are only in the totals", totalProcessCount - children.size());
+    std::printf(")\n");
+    std::printf("%-32s %8s %12s %16s %12s %12s\n", "Image", "Count", "CPU (s)", "Peak Priv (MB)", "Read (MB)", "Write (MB)");
+    for(auto&& imageSummary : imageSummaries)
+        std::printf("%-32.32s %8u %12.3lf %16.2lf %12.2lf %12.2lf\n", imageSummary.imageName.c_str(), imageSummary.count, imageSummary.cpuSeconds,
+                    imageSummary.peakPrivateMemory / (1024.0 * 1024.0), imageSummary.readBytes / (1024.0 * 1024.0), imageSummary.writeBytes / (1024.0 * 1024.0));
+
+    std::vector<const CTMLaunchProfileChild*> sortedChildren;
+    for(auto&& child : children)
+        sortedChildren.push_back(&child);
+    std::sort(sortedChildren.begin(), sortedChildren.end(), [](const CTMLaunchProfileChild* left, const CTMLaunchProfileChild* right){
+        return left->cpuTime > right->cpuTime;
+    });
+
+    std::size_t printedCount = std::min<std::size_t>(sortedChildren.size(), 20);
+    std::printf("\nTop %zu processes by CPU\n", printedCount);
+    std::printf("%8s %-32s %12s %14s %16s %12s %12s %10s\n", "PID", "Image", "CPU (s)", "Lifetime (s)", "Peak Priv (MB)", "Read (MB)", "Write (MB)", "Exit");
+    for(std::size_t i = 0; i < printedCount; i++)
+    {
+        const CTMLaunchProfileChild& child = *sortedChildren[i];
+        char exitText[16];
+        if(child.isStillRunning)
+            std::snprintf(exitText, sizeof(exitText), "running");
+        else
+            std::snprintf(exitText, sizeof(exitText), "%lu", child.exitCode);
+        std::printf("%8lu %-32.32s %12.3lf %14.3lf %16.2lf %12.2lf %12.2lf %10s\n", child.processId, child.imageName.c_str(), child.cpuTime / 1e7,
+                    child.lifetime / 1e7, child.peakPrivateMemory / (1024.0 * 1024.0), child.readBytes / (1024.0 * 1024.0),
+                    child.writeBytes / (1024.0 * 1024.0), exitText);
+    }
+    std::printf("----------------------------------------------------------\n");
+}
+
+bool CTMLaunchProfiler::ExportCsv(const std::wstring& csvPath)
+{
+    std::filesystem::path samplesPath = csvPath;
+    std::ofstream         samplesFile(samplesPath);
+    if(!samplesFile)
+    {
+        CTM_LOG_ERROR("Failed to open the time series file for writing.");
+        return false;
+    }
+
+    samplesFile << "elapsed_s,cpu_percent,private_mb,read_bytes,write_bytes,active_processes,total_processes\n";
+    for(auto&& sample : samples)
+        samplesFile << sample.elapsedSeconds << ',' << sample.cpuCores * 100.0 << ',' << sample.privateMemoryMB << ','
+                    << sample.readBytes << ',' << sample.writeBytes << ',' << sample.activeProcesses << ',' << sample.totalProcesses << '\n';
+
+    //Per process breakdown goes next to it, 'profile.csv' -> 'profile_children.csv'
+    std::filesystem::path childrenPath = samplesPath;
+    childrenPath.replace_filename(samplesPath.stem().wstring() + L"_children" + samplesPath.extension().wstring());
+    std::ofstream childrenFile(childrenPath);
+    if(!childrenFile)
+    {
+        CTM_LOG_ERROR("Failed to open the per process file for writing.");
+        return false;
+    }
+
+    childrenFile << "pid,image,cpu_s,lifetime_s,peak_private_mb,read_bytes,write_bytes,exit_code\n";
+    for(auto&& child : children)
+    {
+        childrenFile << child.processId << ',' << child.imageName << ',' << child.cpuTime / 1e7 << ',' << child.lifetime / 1e7 << ','
+                     << child.peakPrivateMemory / (1024.0 * 1024.0) << ',' << child.readBytes << ',' << child.writeBytes << ',';
+        if(child.isStillRunning)
+            childrenFile << "running\n";
+        else
+            childrenFile << child.exitCode << '\n';
+    }
+
+    CTM_LOG_SUCCESS("Exported time series to ", samplesPath.string(), " and per process data to ", childrenPath.string());
+    return true;
+}
+
+//--------------------HELPER FUNCTIONS--------------------
+bool CTMLaunchProfiler::ParseOptions(CTMLaunchProfileOptions& outOptions)
+{
+    int     argc = 0;
+    LPWSTR* argv = CommandLineToArgvW(GetCommandLineW(), &argc);
+    if(!argv)
+        return false;
+
+    int commandIndex = argc;
+    for(int i = 2; i < argc; i++)
+    {
+        if(wcscmp(argv[i], L"--") == 0)
+        {
+            commandIndex = i + 1;
+            break;
+        }
+        else if(wcscmp(argv[i], L"--interval") == 0 && i + 1 < argc)
+            outOptions.intervalMs = std::clamp(_wtoi(argv[++i]), 10, 10000);
+        else if(wcscmp(argv[i], L"--grace") == 0 && i + 1 < argc)
+            outOptions.graceMs = std::clamp(_wtoi(argv[++i]), 0, 600000);
+        else if(wcscmp(argv[i], L"--wait-all") == 0)
+            outOptions.shouldWaitForTree = true;
+        else if(wcscmp(argv[i], L"--csv") == 0 && i + 1 < argc)
+            outOptions.csvPath = argv[++i];
+        else
+            CTM_LOG_WARNING("Ignoring unknown profile option at position ", i, ".");
+    }
+
+    //Split on the parsed argv, a ' -- ' inside a quoted option value (a '--csv' path) isn't the separator.-
+    //-The command gets quoted back together, CreateProcessW's child parses it into the same arguments
+    for(int i = commandIndex; i < argc; i++)
+    {
+        if(i > commandIndex)
+            outOptions.commandLine += L' ';
+        AppendQuotedArgument(outOptions.commandLine, argv[i]);
+    }
+    LocalFree(argv);
+
+    return !outOptions.commandLine.empty();
+}
+
+void CTMLaunchProfiler::AppendQuotedArgument(std::wstring& commandLine, const wchar_t* argument)
+{
+    if(*argument != L'\0' && !wcspbrk(argument, L" \t\n\v\""))
+    {
+        commandLine += argument;
+        return;
+    }
+
+    //Backslashes only need doubling right before a quote, the closing one included
+    commandLine += L'"';
+    for(const wchar_t* it = argument; ; ++it)
+    {
+        std::size_t backslashCount = 0;
+        while(*it == L'\\')
+        {
+            ++it;
+            ++backslashCount;
+        }
+
+        if(*it == L'\0')
+        {
+            commandLine.append(backslashCount * 2, L'\\');
+            break;
+        }
+        if(*it == L'"')
+            commandLine.append(backslashCount * 2 + 1, L'\\');
+        else
+            commandLine.append(backslashCount, L'\\');
+        commandLine += *it;
+    }
+    commandLine += L'"';
+}
+
+BOOL WINAPI CTMLaunchProfiler::ConsoleCtrlHandler(DWORD ctrlType)
+{
+    //Swallow Ctrl+C/Ctrl+Break, the command gets them too and once it exits we print what we have
+    return ctrlType == CTRL_C_EVENT || ctrlType == CTRL_BREAK_EVENT;
+}
+
+bool CTMLaunchProfiler::TakeSample(double elapsed, ULONGLONG& prevCpuTime, double& prevElapsed)
+{
+    JOBOBJECT_BASIC_AND_IO_ACCOUNTING_INFORMATION accountingInfo = {};
+    if(!QueryInformationJobObject(hJob, JobObjectBasicAndIoAccountingInformation, &accountingInfo, sizeof(accountingInfo), nullptr))
+    {
+        CTM_LOG_ERROR("Failed to query job accounting for the profiled command. Error code: ", GetLastError());
+        return false;
+    }
+
+    //Job totals include processes which already exited, so nothing short lived gets lost here
+    ULONGLONG cpuTime = accountingInfo.BasicInfo.TotalUserTime.QuadPart + accountingInfo.BasicInfo.TotalKernelTime.QuadPart;
+
+    CTMLaunchProfileSample& sample = samples.emplace_back();
+    sample.elapsedSeconds          = elapsed;
+    sample.cpuCores                = elapsed > prevElapsed ? ((cpuTime - prevCpuTime) / 1e7) / (elapsed - prevElapsed) : 0.0;
+    sample.readBytes               = accountingInfo.IoInfo.ReadTransferCount;
+    sample.writeBytes              = accountingInfo.IoInfo.WriteTransferCount;
+    sample.activeProcesses         = accountingInfo.BasicInfo.ActiveProcesses;
+    sample.totalProcesses          = accountingInfo.BasicInfo.TotalProcesses;
+
+    //Current commit of the tree, summed over the processes alive right now
+    std::uint64_t privateMemory = 0;
+    for(auto&& childIndex : activeChildIndices)
+    {
+        PROCESS_MEMORY_COUNTERS_EX memoryCounters = {};
+        if(GetProcessMemoryInfo(children[childIndex].hProcess, reinterpret_cast<PROCESS_MEMORY_COUNTERS*>(&memoryCounters), sizeof(memoryCounters)))
+            privateMemory += memoryCounters.PrivateUsage;
+    }
+    sample.privateMemoryMB = privateMemory / (1024.0 * 1024.0);
+
+    peakActiveCount = std::max<std::uint32_t>(peakActiveCount, sample.activeProcesses);
+    prevCpuTime     = cpuTime;
+    prevElapsed     = elapsed;
+
+    return sample.activeProcesses > 0;
+}
+
+void CTMLaunchProfiler::TrackNewChildren()
+{
+    if(processIdListBuffer.empty())
+        processIdListBuffer.resize(sizeof(JOBOBJECT_BASIC_PROCESS_ID_LIST) + 1024 * sizeof(ULONG_PTR));
+
+    //List grows with the tree, resize until every pid fits
+    auto processIdList = reinterpret_cast<PJOBOBJECT_BASIC_PROCESS_ID_LIST>(processIdListBuffer.data());
+    while(!QueryInformationJobObject(hJob, JobObjectBasicProcessIdList, processIdList, static_cast<DWORD>(processIdListBuffer.size()), nullptr))
+    {
+        if(GetLastError() != ERROR_MORE_DATA)
+            return;
+
+        processIdListBuffer.resize(sizeof(JOBOBJECT_BASIC_PROCESS_ID_LIST) + (processIdList->NumberOfAssignedProcesses + 256) * sizeof(ULONG_PTR));
+        processIdList = reinterpret_cast<PJOBOBJECT_BASIC_PROCESS_ID_LIST>(processIdListBuffer.data());
+    }
+
+    activeChildIndices.clear();
+    WCHAR imagePath[MAX_PATH];
+    CHAR  imageName[MAX_PATH];
+    for(DWORD i = 0; i < processIdList->NumberOfProcessIdsInList; i++)
+    {
+        DWORD processId = static_cast<DWORD>(processIdList->ProcessIdList[i]);
+
+        //Known pid whose process is still running, nothing to do. A known pid whose process exited got reused by a new child
+        auto it = childIndices.find(processId);
+        if(it != childIndices.end() && WaitForSingleObject(children[it->second].hProcess, 0) == WAIT_TIMEOUT)
+        {
+            activeChildIndices.push_back(it->second);
+            continue;
+        }
+
+        HANDLE hProcess = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION | SYNCHRONIZE, FALSE, processId);
+        if(!hProcess)
+            continue;
+
+        CTMLaunchProfileChild& child = children.emplace_back();
+        child.processId              = processId;
+        child.hProcess               = hProcess;
+
+        DWORD pathLength = MAX_PATH;
+        if(QueryFullProcessImageNameW(hProcess, 0, imagePath, &pathLength))
+        {
+            const wchar_t* fileName = wcsrchr(imagePath, L'\\');
+            int bytesWritten = WideCharToMultiByte(CP_UTF8, 0, fileName ? fileName + 1 : imagePath, -1, imageName, sizeof(imageName), NULL, NULL);
+            child.imageName = bytesWritten > 0 ? imageName : "<Unknown>";
+        }
+        else
+            child.imageName = "<Unknown>";
+
+        childIndices[processId] = children.size() - 1;
+        activeChildIndices.push_back(children.size() - 1);
+    }
+}
+
+void CTMLaunchProfiler::FinalizeChildren()
+{
+    //Exited processes are kept around by our handles, so these are their final numbers. Ones left running get theirs as of now
+    FILETIME ftNow;
+    GetSystemTimeAsFileTime(&ftNow);
+    for(auto&& child : children)
+    {
+        if(!child.hProcess)
+            continue;
+
+        child.isStillRunning = WaitForSingleObject(child.hProcess, 0) == WAIT_TIMEOUT;
+        FILETIME ftCreation, ftExit, ftKernel, ftUser;
+        if(GetProcessTimes(child.hProcess, &ftCreation, &ftExit, &ftKernel, &ftUser))
+        {
+            if(child.isStillRunning)
+                ftExit = ftNow;
+            child.cpuTime  = reinterpret_cast<ULARGE_INTEGER&>(ftKernel).QuadPart + reinterpret_cast<ULARGE_INTEGER&>(ftUser).QuadPart;
+            child.lifetime = reinterpret_cast<ULARGE_INTEGER&>(ftExit).QuadPart - reinterpret_cast<ULARGE_INTEGER&>(ftCreation).QuadPart;
+        }
+
+        IO_COUNTERS ioCounters;
+        if(GetProcessIoCounters(child.hProcess, &ioCounters))
+        {
+            child.readBytes  = ioCounters.ReadTransferCount;
+            child.writeBytes = ioCounters.WriteTransferCount;
+        }
+
+        PROCESS_MEMORY_COUNTERS memoryCounters = {};
+        if(GetProcessMemoryInfo(child.hProcess, &memoryCounters, sizeof(memoryCounters)))
+            child.peakPrivateMemory = memoryCounters.PeakPagefileUsage;
+
+        GetExitCodeProcess(child.hProcess, &child.exitCode);
+        CloseHandle(child.hProcess);
+        child.hProcess = nullptr;
+    }
+
+    JOBOBJECT_BASIC_AND_IO_ACCOUNTING_INFORMATION accountingInfo = {};
+    if(QueryInformationJobObject(hJob, JobObjectBasicAndIoAccountingInformation, &accountingInfo, sizeof(accountingInfo), nullptr))
+    {
+        totalUserTime     = accountingInfo.BasicInfo.TotalUserTime.QuadPart;
+        totalKernelTime   = accountingInfo.BasicInfo.TotalKernelTime.QuadPart;
+        totalReadBytes    = accountingInfo.IoInfo.ReadTransferCount;
+        totalWriteBytes   = accountingInfo.IoInfo.WriteTransferCount;
+        totalReadOps      = accountingInfo.IoInfo.ReadOperationCount;
+        totalWriteOps     = accountingInfo.IoInfo.WriteOperationCount;
+        totalProcessCount = accountingInfo.BasicInfo.TotalProcesses;
+    }
+
+    //Peaks are tracked by the job itself, even for processes we never saw
+    JOBOBJECT_EXTENDED_LIMIT_INFORMATION limitInfo = {};
+    if(QueryInformationJobObject(hJob, JobObjectExtendedLimitInformation, &limitInfo, sizeof(limitInfo), nullptr))
+    {
+        peakJobMemory     = limitInfo.PeakJobMemoryUsed;
+        peakProcessMemory = limitInfo.PeakProcessMemoryUsed;
+    }
+}
+
+void CTMLaunchProfiler::PrintSparkline(const char* label, const std::vector<double>& series)
+{
+    if(series.empty())
+        return;
+
+    //Each column is the max of its bucket so short spikes don't vanish when downsampling
+    std::size_t columnCount = std::min<std::size_t>(series.size(), sparklineWidth);
+    double      peakValue   = *std::max_element(series.begin(), series.end());
+    const char  levels[]    = " .:-=+*#%@";
+    char        sparkline[sparklineWidth + 1];
+
+    for(std::size_t column = 0; column < columnCount; column++)
+    {
+        std::size_t bucketStart = column * series.size() / columnCount;
+        std::size_t bucketEnd   = std::max(bucketStart + 1, (column + 1) * series.size() / columnCount);
+        double      bucketMax   = *std::max_element(series.begin() + bucketStart, series.begin() + bucketEnd);
+        int         level       = peakValue > 0.0 ? static_cast<int>(bucketMax / peakValue * (sizeof(levels) - 2) + 0.5) : 0;
+        sparkline[column]       = levels[level];
+    }
+    sparkline[columnCount] = '\0';
+
+    std::printf("%s |%s| peak %.1lf\n", label, sparkline, peakValue);
+}
\ No newline at end of file
@@ -0,0 +1,138 @@
+#ifndef CTM_LAUNCH_PROFILER_HPP
+#define CTM_LAUNCH_PROFILER_HPP
+
+//Windows stuff
+#include <windows.h>
+#include <Psapi.h>
+#include <shellapi.h>
+//My stuff
+#include "../CTMPureHeaderFiles/ctm_logger.h"
+//Stdlib stuff
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <fstream>
+#include <filesystem>
+#include <cstdint>
+#include <cstdio>
+#include <cwchar>
+
+//Whole process tree at one point in time
+struct CTMLaunchProfileSample
+{
+    //Perfect 8 byte alignment
+    double        elapsedSeconds  = 0.0;
+    double        cpuCores        = 0.0; //CPU time used during the interval / interval length, 1.0 means one core fully busy
+    double        privateMemoryMB = 0.0; //Committed private memory of the live processes
+    std::uint64_t readBytes       = 0;   //Cumulative, includes exited processes
+    std::uint64_t writeBytes      = 0;
+    std::uint32_t activeProcesses = 0;
+    std::uint32_t totalProcesses  = 0;   //Everything which ever ran in the tree so far
+};
+
+//Single process of the tree, final numbers are read once everything exited (we keep its handle until then)
+struct CTMLaunchProfileChild
+{
+    //Perfect 8 byte alignment
+    std::string   imageName;
+    HANDLE        hProcess          = nullptr;
+    ULONGLONG     cpuTime           = 0; //Kernel + user, 100ns units
+    ULONGLONG     lifetime          = 0; //100ns units
+    std::uint64_t peakPrivateMemory = 0;
+    std::uint64_t readBytes         = 0;
+    std::uint64_t writeBytes        = 0;
+    DWORD         processId         = 0;
+    DWORD         exitCode          = 0;
+    bool          isStillRunning    = false; //Left behind by the command and still running when we stopped, numbers are as of then
+};
+
+//Options parsed from 'CTMApp --profile [--interval <ms>] [--grace <ms>] [--wait-all] [--csv <file>] -- <command>'
+struct CTMLaunchProfileOptions
+{
+    std::wstring commandLine;
+    std::wstring csvPath;                   //Empty means no export
+    int          intervalMs        = 50;
+    int          graceMs           = 2000;  //How long the tree gets to wind down after the command exits
+    bool         shouldWaitForTree = false; //Wait until every process of the tree exited, even ones left running for good (build servers and such)
+};
+
+using LaunchProfileSampleVector = std::vector<CTMLaunchProfileSample>;
+using LaunchProfileChildVector  = std::vector<CTMLaunchProfileChild>;
+using LaunchProfileChildIndices = std::unordered_map<DWORD, std::size_t>; //pid -> index into the child vector
+
+/*
+ * Headless 'launch and profile' mode, sort of like '/usr/bin/time -v' with graphs.
+ * The command is created suspended and put into a job object before it runs a single instruction, so every descendant ends up in the job.
+ * Totals (CPU, IO, process count, peak commit) come from the job accounting, which also covers processes too short lived for us to see.
+ * Per child numbers come from the handles we open to every process we see in the job.
+ * Profiling ends once the command exited and the rest of the tree had the grace period to follow it, whatever is still running then-
+ * -is reported as left running (unless '--wait-all' is given).
+ */
+class CTMLaunchProfiler
+{
+public:
+    CTMLaunchProfiler() = default;
+    ~CTMLaunchProfiler();
+
+    //No need for copy or move operations
+    CTMLaunchProfiler(const CTMLaunchProfiler&)            = delete;
+    CTMLaunchProfiler& operator=(const CTMLaunchProfiler&) = delete;
+    CTMLaunchProfiler(CTMLaunchProfiler&&)                 = delete;
+    CTMLaunchProfiler& operator=(CTMLaunchProfiler&&)      = delete;
+
+public: //Entry points used by main
+    static bool IsProfileModeRequested();
+    //Returns the exit code of the command (or 1 if we failed), meant to be returned from main
+    static int  RunFromCommandLine();
+
+public: //Main functions
+    bool Launch(const CTMLaunchProfileOptions&);
+    void SampleUntilExit();
+    void PrintReport();
+    bool ExportCsv(const std::wstring&);
+
+private: //Helper functions
+    static bool        ParseOptions(CTMLaunchProfileOptions&);
+    static BOOL WINAPI ConsoleCtrlHandler(DWORD);
+    //Quotes an argument so CommandLineToArgvW gives it back as it was
+    static void        AppendQuotedArgument(std::wstring&, const wchar_t*);
+    bool               TakeSample(double, ULONGLONG&, double&);
+    void               TrackNewChildren();
+    void               FinalizeChildren();
+    void               PrintSparkline(const char*, const std::vector<double>&);
+
+private: //Launched command
+    CTMLaunchProfileOptions options;
+    HANDLE                  hJob           = nullptr;
+    HANDLE                  hMainProcess   = nullptr;
+    DWORD                   mainExitCode     = 0;
+    double                  elapsedSeconds   = 0.0;
+    std::uint32_t           leftRunningCount = 0; //Processes of the tree still running once the grace period ran out
+
+private: //Collected data
+    LaunchProfileSampleVector samples;
+    LaunchProfileChildVector  children;
+    LaunchProfileChildIndices childIndices;
+    std::vector<std::size_t>  activeChildIndices; //Children in the job as of the last sample
+    std::vector<BYTE>         processIdListBuffer;
+
+private: //Totals from the job accounting, read once everything exited
+    ULONGLONG     totalUserTime      = 0;
+    ULONGLONG     totalKernelTime    = 0;
+    std::uint64_t totalReadBytes     = 0;
+    std::uint64_t totalWriteBytes    = 0;
+    std::uint64_t totalReadOps       = 0;
+    std::uint64_t totalWriteOps      = 0;
+    std::uint64_t peakJobMemory      = 0;
+    std::uint64_t peakProcessMemory  = 0;
+    std::uint32_t totalProcessCount  = 0;
+    std::uint32_t peakActiveCount    = 0;
+
+private: //Constant stuff
+    constexpr static int sparklineWidth = 60;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,275 @@
+#include "ctm_module_inventory.h"
+
+CTMModuleInventory::~CTMModuleInventory()
+{
+    JoinWorkerThread();
+}
+
+//--------------------MAIN FUNCTIONS--------------------
+bool CTMModuleInventory::UpdateAsync()
+{
+    if(isBusy.load())
+        return false;
+
+    JoinWorkerThread();
+    isBusy.store(true);
+    workerThread = std::thread([this](){
+        Update();
+        isBusy.store(false);
+    });
+
+    return true;
+}
+
+//--------------------GETTERS--------------------
+ModuleInventorySnapshotPtr CTMModuleInventory::GetSnapshot()
+{
+    std::lock_guard<std::mutex> lock(snapshotMutex);
+    return snapshot;
+}
+
+//--------------------WORKER THREAD FUNCTIONS--------------------
+bool CTMModuleInventory::Update()
+{
+    auto startTime = std::chrono::steady_clock::now();
+
+    //Module table stays, only the per process lists get rebuilt
+    bool isChanged = isRescanAllRequested.exchange(false);
+    if(isChanged)
+        processModulesMap.clear();
+
+    HANDLE hSnapshot = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
+    if(hSnapshot == INVALID_HANDLE_VALUE)
+    {
+        CTM_LOG_ERROR("Failed to create process snapshot for module inventory. Error code: ", GetLastError());
+        return false;
+    }
+
+    for(auto&& [_, processModules] : processModulesMap)
+        processModules.isSeen = false;
+
+    rescannedCount = 0;
+    PROCESSENTRY32W processEntry;
+    processEntry.dwSize = sizeof(processEntry);
+    CHAR processName[MAX_PATH];
+    if(Process32FirstW(hSnapshot, &processEntry))
+    {
+        do
+        {
+            DWORD processId = processEntry.th32ProcessID;
+            if(processId == 0)
+                continue;
+
+            //Creation time is the cheap part of the identity check, module enumeration is the expensive part
+            std::uint64_t creationTime = 0;
+            HANDLE hProcess = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, processId);
+            if(hProcess)
+            {
+                FILETIME ftCreation, ftExit, ftKernel, ftUser;
+                if(GetProcessTimes(hProcess, &ftCreation, &ftExit, &ftKernel, &ftUser))
+                    creationTime = (static_cast<std::uint64_t>(ftCreation.dwHighDateTime) << 32) | ftCreation.dwLowDateTime;
+                CloseHandle(hProcess);
+            }
+
+            auto it = processModulesMap.find(processId);
+            if(it != processModulesMap.end() && it->second.creationTime == creationTime)
+            {
+                it->second.isSeen = true;
+                continue;
+            }
+
+            CTMProcessModules& processModules = processModulesMap[processId];
+            processModules.creationTime       = creationTime;
+            processModules.isSeen             = true;
+            int bytesWritten = WideCharToMultiByte(CP_UTF8, 0, processEntry.szExeFile, -1, processName, sizeof(processName), NULL, NULL);
+            processModules.processName = bytesWritten > 0 ? processName : "<Unknown>";
+
+            //Protected processes can't be read, they just stay without modules until their identity changes
+            ScanProcessModules(processId, processModules);
+            ++rescannedCount;
+        }
+        while(Process32NextW(hSnapshot, &processEntry));
+    }
+
+    CloseHandle(hSnapshot);
+
+    for(auto it = processModulesMap.begin(); it != processModulesMap.end(); )
+    {
+        if(!it->second.isSeen)
+        {
+            it        = processModulesMap.erase(it);
+            isChanged = true;
+        }
+        else
+            ++it;
+    }
+
+    //Nothing came or went, the published snapshot is still right
+    if(!isChanged && rescannedCount == 0 && snapshot)
+        return true;
+
+    RebuildModuleMembership();
+    PruneUnloadedModules();
+
+    updateTimeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+    PublishSnapshot();
+    return true;
+}
+
+void CTMModuleInventory::ScanProcessModules(DWORD processId, CTMProcessModules& processModules)
+{
+    processModules.moduleIds.clear();
+
+    HANDLE hProcess = OpenProcess(PROCESS_QUERY_INFORMATION | PROCESS_VM_READ, FALSE, processId);
+    if(!hProcess)
+        return;
+
+    if(moduleHandles.empty())
+        moduleHandles.resize(256);
+
+    //Module list can grow between the two calls, so loop until it fits
+    DWORD bytesNeeded = 0;
+    while(true)
+    {
+        DWORD bufferSize = static_cast<DWORD>(moduleHandles.size() * sizeof(HMODULE));
+        if(!EnumProcessModulesEx(hProcess, moduleHandles.data(), bufferSize, &bytesNeeded, LIST_MODULES_ALL))
+        {
+            CloseHandle(hProcess);
+            return;
+        }
+
+        if(bytesNeeded <= bufferSize)
+            break;
+
+        moduleHandles.resize(bytesNeeded / sizeof(HMODULE) + 64);
+    }
+
+    if(pathBuffer.size() < MAX_PATH)
+        pathBuffer.resize(MAX_PATH);
+
+    std::size_t moduleCount = bytesNeeded / sizeof(HMODULE);
+    processModules.moduleIds.reserve(moduleCount);
+    for(std::size_t i = 0; i < moduleCount; i++)
+    {
+        DWORD pathLength = GetModuleFileNameExW(hProcess, moduleHandles[i], pathBuffer.data(), static_cast<DWORD>(pathBuffer.size()));
+        if(pathLength == 0)
+            continue;
+
+        MODULEINFO moduleInfo = {};
+        GetModuleInformation(hProcess, moduleHandles[i], &moduleInfo, sizeof(moduleInfo));
+        processModules.moduleIds.push_back(InternModule(pathBuffer.data(), static_cast<int>(pathLength), moduleInfo.SizeOfImage));
+    }
+
+    CloseHandle(hProcess);
+
+    std::sort(processModules.moduleIds.begin(), processModules.moduleIds.end());
+    processModules.moduleIds.erase(std::unique(processModules.moduleIds.begin(), processModules.moduleIds.end()), processModules.moduleIds.end());
+}
+
+std::uint32_t CTMModuleInventory::InternModule(const wchar_t* modulePath, int pathLength, std::uint64_t imageSize)
+{
+    int bytesNeeded = WideCharToMultiByte(CP_UTF8, 0, modulePath, pathLength, NULL, 0, NULL, NULL);
+    std::string path(bytesNeeded > 0 ? bytesNeeded : 0, '\0');
+    WideCharToMultiByte(CP_UTF8, 0, modulePath, pathLength, path.data(), bytesNeeded, NULL, NULL);
+
+    //Same module can show up with different casing in different processes
+    lowerPathBuffer = path;
+    std::transform(lowerPathBuffer.begin(), lowerPathBuffer.end(), lowerPathBuffer.begin(),
+                   [](unsigned char c){ return static_cast<char>(std::tolower(c)); });
+
+    auto it = moduleIdMap.find(lowerPathBuffer);
+    if(it != moduleIdMap.end())
+        return it->second;
+
+    std::uint32_t moduleId = static_cast<std::uint32_t>(modules.size());
+    moduleIdMap.emplace(lowerPathBuffer, moduleId);
+
+    CTMModuleInfo& moduleInfo = modules.emplace_back();
+    std::size_t    nameStart  = path.find_last_of('\\');
+    moduleInfo.name           = nameStart == std::string::npos ? path : path.substr(nameStart + 1);
+    moduleInfo.lowerName      = nameStart == std::string::npos ? lowerPathBuffer : lowerPathBuffer.substr(nameStart + 1);
+    moduleInfo.path           = std::move(path);
+    moduleInfo.imageSize      = imageSize;
+
+    return moduleId;
+}
+
+void CTMModuleInventory::RebuildModuleMembership()
+{
+    for(auto&& moduleInfo : modules)
+        moduleInfo.processIds.clear();
+
+    for(auto&& [processId, processModules] : processModulesMap)
+        for(auto&& moduleId : processModules.moduleIds)
+            modules[moduleId].processIds.push_back(processId);
+
+    /*
+     * Image pages come from the same file backed section in every process, so a module costs its image size once-
+     * -no matter how many processes load it (copy on write pages which got written to are not accounted for)
+     */
+    totalImageSize  = 0;
+    uniqueImageSize = 0;
+    for(auto&& moduleInfo : modules)
+    {
+        if(moduleInfo.processIds.empty())
+            continue;
+
+        std::sort(moduleInfo.processIds.begin(), moduleInfo.processIds.end());
+        totalImageSize  += moduleInfo.imageSize * moduleInfo.processIds.size();
+        uniqueImageSize += moduleInfo.imageSize;
+    }
+}
+
+void CTMModuleInventory::PruneUnloadedModules()
+{
+    //Old id -> new id, kept modules keep their order so the per process lists stay sorted
+    std::vector<std::uint32_t> newModuleIds(modules.size());
+    std::uint32_t              keptCount = 0;
+    for(std::uint32_t i = 0; i < modules.size(); i++)
+    {
+        newModuleIds[i] = keptCount;
+        if(modules[i].processIds.empty())
+            continue;
+
+        if(keptCount != i)
+            modules[keptCount] = std::move(modules[i]);
+        ++keptCount;
+    }
+    if(keptCount == modules.size())
+        return;
+
+    modules.resize(keptCount);
+    for(auto&& [_, processModules] : processModulesMap)
+        for(auto&& moduleId : processModules.moduleIds)
+            moduleId = newModuleIds[moduleId];
+
+    moduleIdMap.clear();
+    for(std::uint32_t i = 0; i < modules.size(); i++)
+    {
+        //Same key 'InternModule' used, the lower case path
+        lowerPathBuffer = modules[i].path;
+        std::transform(lowerPathBuffer.begin(), lowerPathBuffer.end(), lowerPathBuffer.begin(),
+                       [](unsigned char c){ return static_cast<char>(std::tolower(c)); });
+        moduleIdMap.emplace(lowerPathBuffer, i);
+    }
+}
+
+void CTMModuleInventory::PublishSnapshot()
+{
+    auto newSnapshot               = std::make_shared<CTMModuleInventorySnapshot>();
+    newSnapshot->modules           = modules;
+    newSnapshot->processModulesMap = processModulesMap;
+    newSnapshot->totalImageSize    = totalImageSize;
+    newSnapshot->uniqueImageSize   = uniqueImageSize;
+    newSnapshot->updateTimeMs      = updateTimeMs;
+    newSnapshot->rescannedCount    = rescannedCount;
+
+    std::lock_guard<std::mutex> lock(snapshotMutex);
+    snapshot = std::move(newSnapshot);
+}
+
+void CTMModuleInventory::JoinWorkerThread()
+{
+    if(workerThread.joinable())
+        workerThread.join();
+}
\ No newline at end of file
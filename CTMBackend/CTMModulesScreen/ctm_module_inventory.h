@@ -0,0 +1,128 @@
+#ifndef CTM_MODULE_INVENTORY_HPP
+#define CTM_MODULE_INVENTORY_HPP
+
+//Windows stuff
+#include <windows.h>
+#include <tlhelp32.h>
+#include <Psapi.h>
+//My stuff
+#include "../CTMPureHeaderFiles/ctm_logger.h"
+//Stdlib stuff
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cctype>
+
+//Single module (dll/exe image), interned once no matter how many processes load it
+struct CTMModuleInfo
+{
+    //Perfect 8 byte alignment
+    std::string        path;
+    std::string        name;        //File name part of the path, what we display
+    std::string        lowerName;   //For filtering
+    std::vector<DWORD> processIds;  //Who has it loaded, rebuilt from the per process ids on every update
+    std::uint64_t      imageSize  = 0;
+};
+
+//Modules of a single process, identified by (pid, creation time) so a reused pid is never mistaken for the old process
+struct CTMProcessModules
+{
+    //Perfect 8 byte alignment
+    std::vector<std::uint32_t> moduleIds;        //Sorted ids into the module table
+    std::string                processName;
+    std::uint64_t              creationTime = 0; //0 if we couldn't open the process
+    bool                       isSeen       = false;
+};
+
+using ModuleInfoVector     = std::vector<CTMModuleInfo>;
+using ModuleIdMap          = std::unordered_map<std::string, std::uint32_t>; //Lower case path -> module id
+using ProcessModulesMap    = std::unordered_map<DWORD, CTMProcessModules>;
+using ModuleHandleVector   = std::vector<HMODULE>;
+
+//Immutable once published, the UI keeps a shared_ptr to it while the worker scans for the next one
+struct CTMModuleInventorySnapshot
+{
+    //Perfect 8 byte alignment
+    ModuleInfoVector  modules;                //Every one of them is loaded by at least one process
+    ProcessModulesMap processModulesMap;
+    std::uint64_t     totalImageSize  = 0;    //Sum of image sizes over every (process, module) pair
+    std::uint64_t     uniqueImageSize = 0;    //Sum of image sizes over every loaded module, counted once
+    double            updateTimeMs    = 0.0;
+    std::uint32_t     rescannedCount  = 0;
+};
+
+using ModuleInventorySnapshotPtr = std::shared_ptr<const CTMModuleInventorySnapshot>;
+
+/*
+ * Deduplicated inventory of loaded modules across all processes.
+ * Module paths are interned once, processes only keep a sorted array of module ids. A process is only enumerated when its-
+ * -(pid, creation time) identity is new, everything after that is bookkeeping. Modules loaded later by an already known-
+ * -process show up after 'RescanAll'. Modules no process has loaded anymore are dropped, so the table doesn't only ever grow.
+ * Enumerating modules of every process takes a while, so scans run on a worker thread and publish a snapshot-
+ * -whenever something changed (same idea as the open files index, check ctm_open_files_index.h).
+ */
+class CTMModuleInventory
+{
+public:
+    CTMModuleInventory() = default;
+    ~CTMModuleInventory();
+
+    //No need for copy or move operations
+    CTMModuleInventory(const CTMModuleInventory&)            = delete;
+    CTMModuleInventory& operator=(const CTMModuleInventory&) = delete;
+    CTMModuleInventory(CTMModuleInventory&&)                 = delete;
+    CTMModuleInventory& operator=(CTMModuleInventory&&)      = delete;
+
+public: //Main functions
+    //Starts a scan on the worker thread, does nothing if one is already running
+    bool UpdateAsync();
+    //Forgets every process identity so the next scan enumerates everything again
+    void RescanAll() { isRescanAllRequested.store(true); }
+
+public: //Getters
+    ModuleInventorySnapshotPtr GetSnapshot();
+    bool                       IsBusy() const { return isBusy.load(); }
+
+private: //Worker thread functions
+    bool          Update();
+    void          ScanProcessModules(DWORD, CTMProcessModules&);
+    std::uint32_t InternModule(const wchar_t*, int, std::uint64_t);
+    void          RebuildModuleMembership();
+    void          PruneUnloadedModules();
+    void          PublishSnapshot();
+    void          JoinWorkerThread();
+
+private: //Worker thread
+    std::thread       workerThread;
+    std::atomic<bool> isBusy{false};
+    std::atomic<bool> isRescanAllRequested{false};
+
+private: //Published snapshot
+    std::mutex                 snapshotMutex;
+    ModuleInventorySnapshotPtr snapshot;
+
+private: //Module table, only touched by the worker
+    ModuleInfoVector  modules;
+    ModuleIdMap       moduleIdMap;
+    ProcessModulesMap processModulesMap;
+
+private: //Scratch buffers, reused between scans
+    ModuleHandleVector moduleHandles;
+    std::wstring       pathBuffer;
+    std::string        lowerPathBuffer;
+
+private: //Stats
+    std::uint64_t totalImageSize  = 0; //Sum of image sizes over every (process, module) pair
+    std::uint64_t uniqueImageSize = 0; //Sum of image sizes over every loaded module, counted once
+    std::uint32_t rescannedCount  = 0;
+    double        updateTimeMs    = 0.0;
+};
+
+#endif
\ No newline at end of file
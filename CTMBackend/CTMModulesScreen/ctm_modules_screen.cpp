@@ -0,0 +1,156 @@
+#include "ctm_modules_screen.h"
+
+//Equivalent to OnInit function
+CTMModulesScreen::CTMModulesScreen()
+{
+    //First scan enumerates every process, later ones only the new ones. The table shows up once it's done
+    moduleInventory.UpdateAsync();
+    SetInitialized(true);
+}
+
+//Equivalent to OnClean function
+CTMModulesScreen::~CTMModulesScreen()
+{
+    SetInitialized(false);
+}
+
+//--------------------MAIN RENDER AND UPDATE FUNCTIONS--------------------
+void CTMModulesScreen::OnRender()
+{
+    if(!inventorySnapshot)
+    {
+        ImGui::TextDisabled("Enumerating modules of every process...");
+        return;
+    }
+
+    RenderToolbar();
+    ImGui::Separator();
+    RenderModuleTable();
+}
+
+void CTMModulesScreen::OnUpdate()
+{
+    //A scan which takes longer than a second just delays the next one
+    moduleInventory.UpdateAsync();
+
+    ModuleInventorySnapshotPtr latestSnapshot = moduleInventory.GetSnapshot();
+    if(latestSnapshot != inventorySnapshot)
+    {
+        inventorySnapshot = std::move(latestSnapshot);
+        UpdateSortedModules();
+    }
+}
+
+//--------------------RENDER HELPER FUNCTIONS--------------------
+void CTMModulesScreen::RenderToolbar()
+{
+    std::uint64_t totalImageSize  = inventorySnapshot->totalImageSize;
+    std::uint64_t uniqueImageSize = inventorySnapshot->uniqueImageSize;
+
+    ImGui::Text("Modules: %zu | Processes: %zu | Last change: %.1lf ms (%u processes scanned)%s",
+                sortedModuleIds.size(), inventorySnapshot->processModulesMap.size(),
+                inventorySnapshot->updateTimeMs, inventorySnapshot->rescannedCount, moduleInventory.IsBusy() ? " | Scanning..." : "");
+    ImGui::Text("Mapped images: %.1lf MB | Unique images: %.1lf MB | Saved by sharing: %.1lf MB",
+                totalImageSize / (1024.0 * 1024.0), uniqueImageSize / (1024.0 * 1024.0),
+                (totalImageSize - uniqueImageSize) / (1024.0 * 1024.0));
+    ImGui::SetItemTooltip("Image pages are shared between every process which loads the module,\n"
+                          "so they cost their size once. Pages modified by a process (copy on write) are not accounted for.");
+
+    ImGui::SetNextItemWidth(250.0f);
+    ImGui::InputTextWithHint("##ModulesFilter", "Filter modules (e.g. ntdll.dll)", filterTextBuffer, sizeof(filterTextBuffer));
+    ImGui::SameLine();
+    //Known processes are never enumerated again, this picks up modules they loaded after we first saw them
+    //Picked up by the next scan, the running one (if any) finishes first
+    if(ImGui::Button("Rescan All"))
+    {
+        moduleInventory.RescanAll();
+        moduleInventory.UpdateAsync();
+    }
+}
+
+void CTMModulesScreen::RenderModuleTable()
+{
+    if(!ImGui::BeginTable("ModulesTable", 5, ImGuiTableFlags_SizingStretchProp | ImGuiTableFlags_BordersInnerV |
+                                             ImGuiTableFlags_Resizable | ImGuiTableFlags_ScrollX))
+        return;
+
+    ImGui::TableSetupColumn("Module", ImGuiTableColumnFlags_WidthFixed);
+    ImGui::TableSetupColumn("Processes", ImGuiTableColumnFlags_WidthFixed);
+    ImGui::TableSetupColumn("Image Size", ImGuiTableColumnFlags_WidthFixed);
+    ImGui::TableSetupColumn("Saved By Sharing", ImGuiTableColumnFlags_WidthFixed);
+    ImGui::TableSetupColumn("Path");
+    ImGui::TableHeadersRow();
+
+    //Filter is matched against lower case names, lower case it once per frame
+    char filterLower[sizeof(filterTextBuffer)];
+    std::size_t filterLength = std::strlen(filterTextBuffer);
+    for(std::size_t i = 0; i <= filterLength; i++)
+        filterLower[i] = static_cast<char>(std::tolower(static_cast<unsigned char>(filterTextBuffer[i])));
+
+    const ModuleInfoVector& modules = inventorySnapshot->modules;
+    for(auto&& moduleId : sortedModuleIds)
+    {
+        const CTMModuleInfo& moduleInfo = modules[moduleId];
+        if(filterLength > 0 && moduleInfo.lowerName.find(filterLower) == std::string::npos)
+            continue;
+
+        ImGui::TableNextRow();
+        ImGui::TableSetColumnIndex(0);
+        ImGui::PushID(static_cast<int>(moduleId));
+        bool expandTree = ImGui::TreeNodeEx(moduleInfo.name.c_str(), ImGuiTreeNodeFlags_SpanAllColumns);
+        ImGui::PopID();
+
+        ImGui::TableSetColumnIndex(1);
+        ImGui::Text("%zu", moduleInfo.processIds.size());
+        ImGui::TableSetColumnIndex(2);
+        ImGui::Text("%.2lf MB", moduleInfo.imageSize / (1024.0 * 1024.0));
+        ImGui::TableSetColumnIndex(3);
+        ImGui::Text("%.2lf MB", moduleInfo.imageSize * (moduleInfo.processIds.size() - 1) / (1024.0 * 1024.0));
+        ImGui::TableSetColumnIndex(4);
+        ImGui::TextUnformatted(moduleInfo.path.c_str());
+
+        if(expandTree)
+        {
+            RenderModuleProcessRows(moduleInfo);
+            ImGui::TreePop();
+        }
+    }
+
+    ImGui::EndTable();
+}
+
+void CTMModulesScreen::RenderModuleProcessRows(const CTMModuleInfo& moduleInfo)
+{
+    const ProcessModulesMap& processModulesMap = inventorySnapshot->processModulesMap;
+    for(auto&& processId : moduleInfo.processIds)
+    {
+        auto it = processModulesMap.find(processId);
+        if(it == processModulesMap.end())
+            continue;
+
+        ImGui::TableNextRow();
+        ImGui::TableSetColumnIndex(0);
+        ImGui::Indent();
+        ImGui::Text("%s (%lu)", it->second.processName.c_str(), processId);
+        ImGui::Unindent();
+        ImGui::TableSetColumnIndex(1);
+        ImGui::TextDisabled("%zu modules", it->second.moduleIds.size());
+    }
+}
+
+//--------------------UPDATE HELPER FUNCTIONS--------------------
+void CTMModulesScreen::UpdateSortedModules()
+{
+    //The inventory drops unloaded modules before publishing, every one of them is loaded somewhere
+    const ModuleInfoVector& modules = inventorySnapshot->modules;
+
+    sortedModuleIds.resize(modules.size());
+    for(std::uint32_t i = 0; i < modules.size(); i++)
+        sortedModuleIds[i] = i;
+
+    std::sort(sortedModuleIds.begin(), sortedModuleIds.end(), [&modules](std::uint32_t left, std::uint32_t right){
+        if(modules[left].processIds.size() != modules[right].processIds.size())
+            return modules[left].processIds.size() > modules[right].processIds.size();
+        return modules[left].lowerName < modules[right].lowerName;
+    });
+}
\ No newline at end of file
@@ -0,0 +1,49 @@
+#ifndef CTM_MODULES_SCREEN_HPP
+#define CTM_MODULES_SCREEN_HPP
+
+//Windows stuff
+#include <windows.h>
+//ImGui stuff
+#include "../../ImGUI/imgui.h"
+//My stuff
+#include "ctm_module_inventory.h"
+#include "../CTMPureHeaderFiles/ctm_base_state.h"
+#include "../CTMPureHeaderFiles/ctm_logger.h"
+//Stdlib stuff
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <cctype>
+
+using SortedModuleIdVector = std::vector<std::uint32_t>;
+
+class CTMModulesScreen : public CTMBaseScreen
+{
+public:
+    CTMModulesScreen();
+    ~CTMModulesScreen() override;
+
+protected:
+    void OnRender() override;
+    void OnUpdate() override;
+
+private: //Render helper functions
+    void RenderToolbar();
+    void RenderModuleTable();
+    void RenderModuleProcessRows(const CTMModuleInfo&);
+
+private: //Update helper functions
+    void UpdateSortedModules();
+
+private: //Inventory, scanned on its worker thread
+    CTMModuleInventory         moduleInventory;
+    ModuleInventorySnapshotPtr inventorySnapshot;
+    SortedModuleIdVector       sortedModuleIds; //Most shared first
+
+private: //UI state
+    char filterTextBuffer[64] = {};
+};
+
+#endif
\ No newline at end of file
@@ -23,12 +23,17 @@ CTMPerformanceCPUScreen::CTMPerformanceCPUScreen()
     if(!CTMConstructorGetCPUInfo())
         return;
 
+    //The history manager samples it whether this page is open or not, the graph only shows it
+    BindHistorySeries(0, &performanceHistoryManager.GetSeries(CTMHistorySeriesIndex::CpuUsage));
+
     SetInitialized(true);
 }
 
 //Equivalent to OnClean function
 CTMPerformanceCPUScreen::~CTMPerformanceCPUScreen()
 {
+    //The session keeps it enabled for a bit, coming back to this screen doesn't lose the timeline
+    SetContextSwitchTracing(false);
     SetInitialized(false);
 }
 
@@ -291,7 +296,7 @@ void CTMPerformanceCPUScreen::OnRender()
     ImVec2 windowSize = ImGui::GetWindowSize();
     //Plot the CPU Usage Graph, also specify the max and min range of the graph cuz why not
     ImGui::TextUnformatted("100%");
-    PlotUsageGraph("Overall CPU Usage (over 60 Seconds)", 0.0, 100.0, {-1.0f, 300.0f}, { 0.075f, 0.792f, 0.988f, 1.0f });
+    PlotUsageGraph("Overall CPU Usage", 0.0, 100.0, {-1.0f, 300.0f}, { 0.075f, 0.792f, 0.988f, 1.0f });
     ImGui::TextUnformatted("0%");
 
     //Give some spacing vertically before displaying CPU Info
@@ -308,19 +313,31 @@ void CTMPerformanceCPUScreen::OnRender()
     //Even more spacing vertically
     ImGui::Dummy({-1.0f, 5.0f});
 
+    //Which process and thread had every logical processor, from context switches (opt in)
+    if(ImGui::CollapsingHeader("Logical Processors Timeline"))
+        RenderCoreTimeline();
+
+    //Even more spacing vertically
+    ImGui::Dummy({-1.0f, 5.0f});
+
     //Create a collapsable header containing our CPU statistics
     isStatisticsHeaderExpanded = ImGui::CollapsingHeader("CPU Statistics");
     if(isStatisticsHeaderExpanded)
         RenderCPUStatistics();
+
+    //Even more spacing vertically
+    ImGui::Dummy({-1.0f, 5.0f});
+
+    //Anomalies detected on the graph (global list, so it also contains anomalies from other screens and processes)
+    if(ImGui::CollapsingHeader("Anomaly Events"))
+        RenderAnomalyEvents();
     
     ImGui::PopStyleVar();
 }
 
 void CTMPerformanceCPUScreen::OnUpdate()
 {
-    UpdateXAxis();
     double currentCpuUsage = GetTotalCPUUsage();
-    PlotYAxis(currentCpuUsage);
 
     //Add all the stuff to metrics vector
     metricsVector[static_cast<std::size_t>(MetricsVectorIndex::Usage)].second = currentCpuUsage;
@@ -332,6 +349,10 @@ void CTMPerformanceCPUScreen::OnUpdate()
     //Also only update process counters if 'isStatisticsHeaderExpanded' is true
     if(isStatisticsHeaderExpanded)
         UpdateProcessCounters();
+
+    //Tracing goes on with the header collapsed, so does the rate
+    if(isContextSwitchTracing)
+        UpdateContextSwitchRate();
 }
 
 //--------------------RENDER FUNCTIONS--------------------
@@ -441,6 +462,148 @@ void CTMPerformanceCPUScreen::RenderLogicalProcessorHeatmap()
     ImPlot::PopColormap();
 }
 
+void CTMPerformanceCPUScreen::RenderCoreTimeline()
+{
+    bool shouldTrace = isContextSwitchTracing;
+    if(ImGui::Checkbox("Trace context switches", &shouldTrace))
+        SetContextSwitchTracing(shouldTrace);
+
+    //Add a small question mark icon next to the checkbox, this is our tooltip
+    ImGui::SameLine();
+    ImGui::TextDisabled("(?)");
+    if(ImGui::IsItemHovered())
+    {
+        ImGui::BeginTooltip();
+        ImGui::TextUnformatted("Records every context switch of every logical processor, so you can see which process and thread had it and for how long.\n"
+                               "That is tens of thousands of events per second for the event session, so it stays off until you turn it on.\n"
+                               "Scroll to zoom in, drag to move around. Idle time is left blank.");
+        ImGui::EndTooltip();
+    }
+
+    if(!isContextSwitchTracing)
+        return;
+
+    ImGui::SameLine();
+    ImGui::SetNextItemWidth(200.0f);
+    if(ImGui::SliderFloat("Last seconds", &timelineSeconds, 1.0f, 60.0f, "%.0f s"))
+        shouldResetTimelineZoom = true;
+
+    std::uint32_t coreCount = globalCpuTimeline.GetCoreCount();
+    ImGui::Text("%.0f switches/s, %.1f MB for %u logical processors (%zu runs each, older ones get overwritten)", contextSwitchRate,
+                globalCpuTimeline.GetMemoryUsage() / (1024.0 * 1024.0), coreCount, globalCpuTimeline.GetRunsPerCore());
+    if(coreCount == 0)
+        return;
+
+    //X is seconds before the newest switch, so the lanes scroll on their own and a zoomed in view stays zoomed in
+    float plotHeight = std::clamp(coreCount * 12.0f, 150.0f, 800.0f);
+    if(ImPlot::BeginPlot("##CoreTimeline", {-1.0f, plotHeight}, ImPlotFlags_NoMenus | ImPlotFlags_NoMouseText | ImPlotFlags_NoLegend))
+    {
+        ImPlot::SetupAxes("Seconds ago", "Logical Processor", ImPlotAxisFlags_None, ImPlotAxisFlags_Invert | ImPlotAxisFlags_Lock);
+        ImPlot::SetupAxisLimits(ImAxis_X1, -timelineSeconds, 0.0, shouldResetTimelineZoom ? ImPlotCond_Always : ImPlotCond_Once);
+        ImPlot::SetupAxisLimitsConstraints(ImAxis_X1, -timelineSeconds, 0.0);
+        ImPlot::SetupAxisZoomConstraints(ImAxis_X1, 0.0001, timelineSeconds); //Down to 100us across the whole plot
+        ImPlot::SetupAxisLimits(ImAxis_Y1, 0.0, coreCount, ImPlotCond_Always);
+        ImPlot::SetupFinish();
+        shouldResetTimelineZoom = false;
+
+        //Only what is in view gets read, zoomed in that is a handful of runs per lane
+        ImPlotRect    plotLimits   = ImPlot::GetPlotLimits();
+        std::uint64_t latestMicros = globalCpuTimeline.GetLatestMicros();
+        auto          toMicros     = [latestMicros](double secondsAgo){
+            double micros = static_cast<double>(latestMicros) + secondsAgo * 1000000.0;
+            return micros > 0.0 ? static_cast<std::uint64_t>(micros) : std::uint64_t(0);
+        };
+        auto          toSecondsAgo = [latestMicros](std::uint64_t micros){ return (static_cast<double>(micros) - static_cast<double>(latestMicros)) / 1000000.0; };
+        std::uint64_t fromMicros   = toMicros(plotLimits.X.Min),
+                      untilMicros  = toMicros(plotLimits.X.Max);
+
+        ImPlotPoint      mousePos      = ImPlot::GetPlotMousePos();
+        int              hoveredCore   = ImPlot::IsPlotHovered() ? static_cast<int>(std::floor(mousePos.y)) : -1;
+        std::uint64_t    hoveredMicros = toMicros(mousePos.x);
+        CTMCoreOccupancy hoveredRun;
+        bool             hasHoveredRun = false;
+
+        //Colour per process, grey for threads whose process we don't know
+        ImDrawList* drawList     = ImPlot::GetPlotDrawList();
+        int         colorCount   = ImPlot::GetColormapSize(ImPlotColormap_Deep);
+        ImU32       unknownColor = ImGui::GetColorU32(ImVec4(0.5f, 0.5f, 0.5f, 1.0f));
+        ImPlot::PushPlotClipRect();
+        for(std::uint32_t core = 0; core < coreCount; core++)
+        {
+            timelineRuns.clear();
+            globalCpuTimeline.ReadCore(core, fromMicros, untilMicros, timelineRuns);
+
+            float laneTop    = ImPlot::PlotToPixels(0.0, core + 0.1).y,
+                  laneBottom = ImPlot::PlotToPixels(0.0, core + 0.9).y;
+            if(laneTop > laneBottom)
+                std::swap(laneTop, laneBottom);
+
+            //Runs thinner than a pixel are merged into the one before, the longest run in a pixel picks its colour
+            float pendingLeft  = 0.0f, pendingRight = -1.0f, pendingWidth = 0.0f;
+            ImU32 pendingColor = 0;
+            auto  drawPending  = [&](){
+                if(pendingRight >= pendingLeft)
+                    drawList->AddRectFilled({pendingLeft, laneTop}, {std::max(pendingRight, pendingLeft + 1.0f), laneBottom}, pendingColor);
+            };
+
+            for(auto&& run : timelineRuns)
+            {
+                if(static_cast<int>(core) == hoveredCore && hoveredMicros >= run.startMicros && hoveredMicros < run.endMicros)
+                {
+                    hoveredRun    = run;
+                    hasHoveredRun = true;
+                }
+
+                //Idle is what is left blank
+                if(run.threadId == 0)
+                    continue;
+
+                float left  = ImPlot::PlotToPixels(toSecondsAgo(run.startMicros), 0.0).x,
+                      right = ImPlot::PlotToPixels(toSecondsAgo(run.endMicros), 0.0).x;
+                ImU32 color = run.processId == 0 ? unknownColor :
+                              ImGui::GetColorU32(ImPlot::GetColormapColor(static_cast<int>((run.processId / 4) % colorCount), ImPlotColormap_Deep));
+
+                if(pendingRight >= pendingLeft && right - left < 1.0f && left - pendingRight < 1.0f)
+                {
+                    if(right - left > pendingWidth)
+                    {
+                        pendingWidth = right - left;
+                        pendingColor = color;
+                    }
+                    pendingRight = std::max(pendingRight, right);
+                    continue;
+                }
+
+                drawPending();
+                pendingLeft  = left;
+                pendingRight = right;
+                pendingWidth = right - left;
+                pendingColor = color;
+            }
+            drawPending();
+        }
+        ImPlot::PopPlotClipRect();
+
+        if(hasHoveredRun)
+        {
+            ImGui::BeginTooltip();
+            ImGui::Text("Logical Processor %d", hoveredCore);
+            if(hoveredRun.threadId == 0)
+                ImGui::TextUnformatted("Idle");
+            else
+            {
+                ImGui::Text("Process: %s (%lu)", hoveredRun.processId ? GetTimelineProcessName(hoveredRun.processId).c_str() : "Unknown", hoveredRun.processId);
+                ImGui::Text("Thread: %lu", hoveredRun.threadId);
+            }
+            //Clipped to the view, zoom out to see all of it
+            ImGui::Text("For %.3f ms", (hoveredRun.endMicros - hoveredRun.startMicros) / 1000.0);
+            ImGui::EndTooltip();
+        }
+
+        ImPlot::EndPlot();
+    }
+}
+
 //--------------------HELPER FUNCTIONS--------------------
 double CTMPerformanceCPUScreen::GetTotalCPUUsage()
 {
@@ -566,3 +729,71 @@ void CTMPerformanceCPUScreen::UpdateProcessCounters()
     //                             );
     // }
 }
+
+void CTMPerformanceCPUScreen::UpdateContextSwitchRate()
+{
+    auto   now            = std::chrono::steady_clock::now();
+    double elapsedSeconds = std::chrono::duration<double>(now - lastSwitchCountTime).count();
+    if(elapsedSeconds < 1.0)
+        return;
+
+    std::uint64_t switchCount = globalCpuTimeline.GetSwitchCount();
+    contextSwitchRate   = (switchCount - lastSwitchCount) / elapsedSeconds;
+    lastSwitchCount     = switchCount;
+    lastSwitchCountTime = now;
+}
+
+void CTMPerformanceCPUScreen::SetContextSwitchTracing(bool shouldTrace)
+{
+    if(shouldTrace == isContextSwitchTracing)
+        return;
+
+    if(!shouldTrace)
+    {
+        eventSessionManager.ReleaseProvider(CTMEventProvider::KernelContextSwitch);
+        isContextSwitchTracing = false;
+        return;
+    }
+
+    //Starts the event session too if nothing else did yet
+    if(!eventSessionManager.AcquireProvider(CTMEventProvider::KernelContextSwitch))
+    {
+        CTM_LOG_ERROR("Failed to start context switch tracing. Look at the above errors for more information.");
+        return;
+    }
+
+    isContextSwitchTracing  = true;
+    shouldResetTimelineZoom = true;
+    contextSwitchRate       = 0.0;
+    lastSwitchCount         = globalCpuTimeline.GetSwitchCount();
+    lastSwitchCountTime     = std::chrono::steady_clock::now();
+}
+
+const std::string& CTMPerformanceCPUScreen::GetTimelineProcessName(DWORD processId)
+{
+    auto it = timelineProcessNames.find(processId);
+    if(it != timelineProcessNames.end())
+        return it->second;
+
+    if(timelineProcessNames.size() >= maxTimelineProcessNames)
+        timelineProcessNames.clear();
+
+    //Only the file name, same as the process screen shows it. The process may be gone by now
+    std::string processName = "Exited";
+    HANDLE      hProcess    = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, processId);
+    if(hProcess)
+    {
+        CHAR  imagePath[MAX_PATH];
+        DWORD pathLength = MAX_PATH;
+        if(QueryFullProcessImageNameA(hProcess, 0, imagePath, &pathLength))
+        {
+            processName = imagePath;
+            std::size_t nameStart = processName.find_last_of('\\');
+            if(nameStart != std::string::npos)
+                processName.erase(0, nameStart + 1);
+        }
+        CloseHandle(hProcess);
+    }
+
+    return timelineProcessNames.emplace(processId, std::move(processName)).first->second;
+}
@@ -12,8 +12,13 @@
 #include "../../CTMPureHeaderFiles/ctm_base_state.h"
 #include "../../CTMPureHeaderFiles/ctm_logger.h"
 #include "../../CTMGlobalManagers/ctm_wmi_manager.h"
+#include "../../CTMGlobalManagers/ctm_event_session_manager.h"
+#include "../../CTMGlobalManagers/ctm_perf_history_manager.h"
 //Stdlib stuff
 #include <memory>
+#include <unordered_map>
+#include <string>
+#include <chrono>
 #include <cmath>
 #include <cstring>
 
@@ -50,18 +55,23 @@ private: //Constructor functions
 private: //Render functions
     void RenderCPUStatistics();
     void RenderLogicalProcessorHeatmap();
+    void RenderCoreTimeline();
 
 private: //Some helper functions
     double GetTotalCPUUsage();
     void   UpdatePerLogicalProcessorInfo();
     void   UpdateProcessCounters();
+    void   UpdateContextSwitchRate();
+    void   SetContextSwitchTracing(bool);
+    const std::string& GetTimelineProcessName(DWORD);
 
 private: //NT dll
     HMODULE                     hNtdll                    = nullptr;
     NtQuerySystemInformation_t  NtQuerySystemInformation  = nullptr;
 
 private: //WMI manager
-    CTMWMIManager& wmiManager = CTMWMIManager::GetInstance();
+    CTMWMIManager&                wmiManager                = CTMWMIManager::GetInstance();
+    CTMPerformanceHistoryManager& performanceHistoryManager = CTMPerformanceHistoryManager::GetInstance();
 
 private: //Performance Info
     PERFORMANCE_INFORMATION performanceInfo = { sizeof(PERFORMANCE_INFORMATION) };
@@ -86,6 +96,18 @@ private: //Real small optimization variables
     bool isHeatmapHeaderExpanded    = false;
     bool isStatisticsHeaderExpanded = false;
 
+private: //Core timeline (opt in, context switches cost the event session a lot more than network and file events do)
+    CTMEventSessionManager&                eventSessionManager     = CTMEventSessionManager::GetInstance();
+    std::vector<CTMCoreOccupancy>          timelineRuns;            //One core at a time, reused every frame
+    std::unordered_map<DWORD, std::string> timelineProcessNames;    //Only the ones somebody hovered, so they are resolved once
+    std::chrono::steady_clock::time_point  lastSwitchCountTime;
+    std::uint64_t                          lastSwitchCount         = 0;
+    double                                 contextSwitchRate       = 0.0;
+    float                                  timelineSeconds         = 10.0f; //How far back the lanes go
+    bool                                   isContextSwitchTracing  = false; //Provider acquired from the event session
+    bool                                   shouldResetTimelineZoom = true;
+    constexpr static std::size_t           maxTimelineProcessNames = 4096;  //Pids get reused, start over past this many
+
 private: //Processes, Handles and Threads (count)
     ULONG             systemInformationBufferSize = 1024; //Some random initial value
     std::vector<BYTE> systemInformationBuffer;
@@ -10,6 +10,9 @@ CTMPerformanceDISKScreen::CTMPerformanceDISKScreen()
     //If we can't even get basic info, no point in initializing
     if(!CTMConstructorInitPDH())
         return;
+
+    //The history manager samples every drive whether this page is open or not, the graph shows the one being viewed
+    BindDriveHistory(currentViewingDriveIndex);
     
     SetInitialized(true);
 }
@@ -190,11 +193,11 @@ void CTMPerformanceDISKScreen::OnRender()
         //Every time we click on a disk to view, we check for one thing. That is-
         if(ImGui::Button(diskDriveLabel))
         {
-            //-if we moved our view to another drive, we reset the graph (so they can now show stuff for other drives)
+            //-if we moved our view to another drive, we point the graph at that drive's history (it has been recorded all along)
             if(currentViewingDriveIndex != i)
             {
-                ResetGraph();
                 currentViewingDriveIndex = i;
+                BindDriveHistory(currentViewingDriveIndex);
             }
         }
         
@@ -214,7 +217,7 @@ void CTMPerformanceDISKScreen::OnRender()
 
     //Graph plotting
     ImGui::Text("%.2f %s", decodedMaxLimit, CTMPerformanceCommon::GetDataUnitAtIdx(decodedType));
-    PlotMultiUsageGraph("Drive Usage (Over 60 sec)", "Read Usage", "Write Usage", 0, GetYAxisMaxValue(), {-1, 300}, graphColors);
+    PlotMultiUsageGraph("Drive Usage", "Read Usage", "Write Usage", 0, GetYAxisMaxValue(), {-1, 300}, graphColors);
     ImGui::TextUnformatted("0 KB");
 
     //Give some spacing vertically before displaying Drive Info
@@ -228,28 +231,30 @@ void CTMPerformanceDISKScreen::OnRender()
     if(isStatisticsHeaderExpanded)
         RenderViewForDiskDrive();
 
+    //Even more spacing vertically
+    ImGui::Dummy({-1.0f, 5.0f});
+
+    //Anomalies detected on the graph (global list, so it also contains anomalies from other screens and processes)
+    if(ImGui::CollapsingHeader("Anomaly Events"))
+        RenderAnomalyEvents();
+
     ImGui::PopStyleVar();
 }
 
 void CTMPerformanceDISKScreen::OnUpdate()
 {
-    UpdateXAxis();
-
-    auto&&[readUsageInKB, writeUsageInKB] = GetDriveUsageAtIdx(currentViewingDriveIndex);
-
-    //Assign the metricsVector the above values with encoding only when statistics header is collapsed (user is actively watching the data)
+    //Assign the metricsVector the usage with encoding only when statistics header is expanded (user is actively watching the data)
+    //The graph doesn't need it, the history manager samples every drive on its own
     if(isStatisticsHeaderExpanded)
     {
+        auto&&[readUsageInKB, writeUsageInKB] = GetDriveUsageAtIdx(currentViewingDriveIndex);
+
         metricsVector[static_cast<std::size_t>(MetricsVectorIndex::ReadUsage)].second 
             = CTMPerformanceCommon::EncodeDoubleWithUnits(readUsageInKB);
         metricsVector[static_cast<std::size_t>(MetricsVectorIndex::WriteUsage)].second
             = CTMPerformanceCommon::EncodeDoubleWithUnits(writeUsageInKB);
     }
 
-    //Plot the values as well
-    PlotYAxisAtIndex(static_cast<std::size_t>(CTMPlotTypeIndex::DiskRead), readUsageInKB);
-    PlotYAxisAtIndex(static_cast<std::size_t>(CTMPlotTypeIndex::DiskWrite), writeUsageInKB);
-
     //Also since we need dynamically changing y-axis limits, update y-axis at the backend side to the graphs max limit
     UpdateYAxisToMaxValue();
 
@@ -343,6 +348,18 @@ void CTMPerformanceDISKScreen::RenderDiskDriveTableEntry(const char* metricsText
 }
 
 //--------------------HELPER FUNCTIONS--------------------
+void CTMPerformanceDISKScreen::BindDriveHistory(std::size_t driveIdx)
+{
+    if(driveIdx >= diskDriveVector.size())
+        return;
+
+    //Drives PDH had no counters for don't have a history, the graph just stays empty for them
+    const CTMDiskHistory* diskHistory = performanceHistoryManager.GetDiskHistory(diskDriveVector[driveIdx].letterAssigned);
+    BindHistorySeries(static_cast<std::size_t>(CTMPlotTypeIndex::DiskRead), diskHistory ? &diskHistory->read : nullptr);
+    BindHistorySeries(static_cast<std::size_t>(CTMPlotTypeIndex::DiskWrite), diskHistory ? &diskHistory->write : nullptr);
+    displayMaxYLimit = CTMPerformanceCommon::EncodeDoubleWithUnits(GetYAxisMaxValue());
+}
+
 std::pair<double, double> CTMPerformanceDISKScreen::GetDriveUsageAtIdx(std::size_t driveIdx)
 {
     /*
@@ -9,6 +9,7 @@
 #include "../../CTMPureHeaderFiles/ctm_base_state.h"
 #include "../../CTMPureHeaderFiles/ctm_logger.h"
 #include "../../CTMGlobalManagers/ctm_critical_resource_guard.h"
+#include "../../CTMGlobalManagers/ctm_perf_history_manager.h"
 
 //Struct used to store very basic information about each drive
 struct DiskDriveInfo
@@ -45,11 +46,15 @@ private: //Render functions
 private: //Helper functions
     //std::pair<read usage, write usage>
     std::pair<double, double> GetDriveUsageAtIdx(std::size_t);
+    void                      BindDriveHistory(std::size_t);
 
 private: //Resource guard
     CTMCriticalResourceGuard& resourceGuard = CTMCriticalResourceGuard::GetInstance();
     const char* pdhCleanupFunctionName = "CTMPerformanceDISKScreen::CleanupPDH";
 
+private: //Graph history of every drive
+    CTMPerformanceHistoryManager& performanceHistoryManager = CTMPerformanceHistoryManager::GetInstance();
+
 private: //Collapsable header variables
     bool isStatisticsHeaderExpanded = false;
 
@@ -0,0 +1,295 @@
+#include "ctm_perf_dpc_screen.h"
+
+//Don't really want these macros, they are messing up the std::max and std::min functions
+#undef max
+#undef min
+
+//Equivalent to OnInit function
+CTMPerformanceDPCScreen::CTMPerformanceDPCScreen()
+{
+    //Events need the time they returned compared with now for the long runs table
+    LARGE_INTEGER frequency;
+    if(QueryPerformanceFrequency(&frequency) && frequency.QuadPart > 0)
+        qpcFrequency = static_cast<ULONGLONG>(frequency.QuadPart);
+
+    //Whatever was picked last time, the tracker counts from there
+    thresholdMicros = std::clamp(stateManager.getSetting(CTMSettingKey::DpcThresholdMicros, thresholdMicros), minThresholdMicros, maxThresholdMicros);
+    globalDpcLatencyTracker.SetThreshold(static_cast<std::uint32_t>(thresholdMicros));
+
+    //Starts the event session too if nothing else did yet. Without it the page still opens and says why it is empty
+    isProviderAcquired = eventSessionManager.AcquireProvider(CTMEventProvider::KernelDpc);
+    if(!isProviderAcquired)
+        CTM_LOG_ERROR("Failed to start DPC/ISR tracing. Look at the above errors for more information.");
+
+    //The history manager samples these for as long as anything holds the provider, the graph only shows them
+    BindHistorySeries(static_cast<std::size_t>(CTMPlotTypeIndex::DpcTime), &performanceHistoryManager.GetSeries(CTMHistorySeriesIndex::DpcTime));
+    BindHistorySeries(static_cast<std::size_t>(CTMPlotTypeIndex::IsrTime), &performanceHistoryManager.GetSeries(CTMHistorySeriesIndex::IsrTime));
+
+    globalDpcLatencyTracker.GetCoreUsage(prevCoreUsage);
+    lastRateTime = std::chrono::steady_clock::now();
+    SetInitialized(true);
+}
+
+//Equivalent to OnClean function
+CTMPerformanceDPCScreen::~CTMPerformanceDPCScreen()
+{
+    //The session keeps it enabled for a bit, coming back to this page doesn't lose anything
+    if(isProviderAcquired)
+        eventSessionManager.ReleaseProvider(CTMEventProvider::KernelDpc);
+    SetInitialized(false);
+}
+
+//--------------------MAIN RENDER AND UPDATE FUNCTIONS--------------------
+void CTMPerformanceDPCScreen::OnRender()
+{
+    //1) Graph, time every logical processor spent in DPCs and ISRs
+    double yAxisMaxValue = std::max(GetYAxisMaxValue(), minGraphPercent);
+    ImGui::Text("%.2f%%", yAxisMaxValue);
+    PlotMultiUsageGraph("DPC and ISR Time", "DPC Time", "ISR Time", 0, yAxisMaxValue, {-1, 300}, graphColors);
+    ImGui::TextUnformatted("0%");
+
+    //Give some spacing vertically before the rest
+    ImGui::Dummy({-1.0f, 15.0f});
+
+    if(!isProviderAcquired)
+    {
+        ImGui::TextDisabled("DPC/ISR tracing failed to start, it needs administrator rights (or '--event-source synthetic').");
+        return;
+    }
+
+    RenderThresholdAndRates();
+    ImGui::Dummy({-1.0f, 5.0f});
+
+    //Add some padding to the frame (see the blank space around the text of the collapsable header)
+    ImGui::PushStyleVar(ImGuiStyleVar_FramePadding, ImVec2(10.0f, 10.0f));
+
+    //2) The drivers, the reason this page exists
+    if(ImGui::CollapsingHeader("Drivers", ImGuiTreeNodeFlags_DefaultOpen))
+        RenderDriversTable();
+
+    ImGui::Dummy({-1.0f, 5.0f});
+
+    //3) Runs at or above the threshold, newest first
+    if(ImGui::CollapsingHeader("Recent Long Runs", ImGuiTreeNodeFlags_DefaultOpen))
+        RenderLongEventsTable();
+
+    ImGui::Dummy({-1.0f, 5.0f});
+
+    //4) DPCs and ISRs per second of every logical processor
+    if(ImGui::CollapsingHeader("Logical Processors"))
+        RenderCoreBars();
+
+    ImGui::Dummy({-1.0f, 5.0f});
+
+    //5) How the event path is doing
+    if(ImGui::CollapsingHeader("DPC/ISR Statistics"))
+        RenderTrackerStatistics();
+
+    ImGui::Dummy({-1.0f, 5.0f});
+
+    //Anomalies detected on the graph (global list, so it also contains anomalies from other screens and processes)
+    if(ImGui::CollapsingHeader("Anomaly Events"))
+        RenderAnomalyEvents();
+
+    ImGui::PopStyleVar();
+}
+
+void CTMPerformanceDPCScreen::OnUpdate()
+{
+    auto   now            = std::chrono::steady_clock::now();
+    double elapsedSeconds = std::chrono::duration<double>(now - lastRateTime).count();
+    lastRateTime = now;
+
+    //Rates for the header and the bars, the time for the graph is sampled by the history manager
+    UpdateCoreRates(elapsedSeconds);
+    UpdateYAxisToMaxValue();
+
+    if(!isProviderAcquired)
+        return;
+
+    //Slowest first, that is what anyone opening this page is looking for
+    globalDpcLatencyTracker.CollectDrivers(drivers);
+    std::sort(drivers.begin(), drivers.end(), [](const CTMDriverDpcLatency& left, const CTMDriverDpcLatency& right){
+        return std::max(left.dpc.max, left.isr.max) > std::max(right.dpc.max, right.isr.max);
+    });
+    globalDpcLatencyTracker.CollectLongEvents(longEvents);
+    globalDpcLatencyTracker.GetSystemSummary(systemDpc, systemIsr);
+    trackerStats = globalDpcLatencyTracker.GetStats();
+}
+
+//--------------------RENDER FUNCTIONS--------------------
+void CTMPerformanceDPCScreen::RenderThresholdAndRates()
+{
+    ImGui::SetNextItemWidth(150.0f);
+    if(ImGui::InputInt("Threshold (us)", &thresholdMicros, 50, 500))
+    {
+        thresholdMicros = std::clamp(thresholdMicros, minThresholdMicros, maxThresholdMicros);
+        globalDpcLatencyTracker.SetThreshold(static_cast<std::uint32_t>(thresholdMicros));
+        stateManager.setSetting(CTMSettingKey::DpcThresholdMicros, thresholdMicros);
+    }
+
+    //Add a small question mark icon next to the input, this is our tooltip
+    ImGui::SameLine();
+    ImGui::TextDisabled("(?)");
+    if(ImGui::IsItemHovered())
+    {
+        ImGui::BeginTooltip();
+        ImGui::TextUnformatted("Runs at or above this are counted per driver and listed under 'Recent Long Runs'.\n"
+                               "Microsoft's guideline is that a DPC or ISR shouldn't run for more than 100 us, audio starts to drop out somewhere past 500 us.\n"
+                               "Changing it starts the counting over.");
+        ImGui::EndTooltip();
+    }
+
+    ImGui::SameLine(0.0f, 30.0f);
+    ImGui::Text("%.0f DPCs/s   %.0f ISRs/s   p99: %llu us DPC, %llu us ISR   Max: %llu us DPC, %llu us ISR", dpcRate, isrRate,
+                static_cast<unsigned long long>(systemDpc.p99), static_cast<unsigned long long>(systemIsr.p99),
+                static_cast<unsigned long long>(systemDpc.max), static_cast<unsigned long long>(systemIsr.max));
+}
+
+void CTMPerformanceDPCScreen::RenderDriversTable()
+{
+    if(drivers.empty())
+    {
+        ImGui::TextDisabled("No DPC or ISR ran since the tracing started.");
+        return;
+    }
+
+    constexpr float driversTableHeight = 300.0f;
+    if(!ImGui::BeginTable("DpcDriversTable", 10, ImGuiTableFlags_SizingStretchProp | ImGuiTableFlags_BordersInnerV |
+                                                  ImGuiTableFlags_ScrollY | ImGuiTableFlags_Resizable | ImGuiTableFlags_RowBg, {0.0f, driversTableHeight}))
+        return;
+
+    ImGui::TableSetupScrollFreeze(0, 1);
+    ImGui::TableSetupColumn("Driver");
+    ImGui::TableSetupColumn("DPCs");
+    ImGui::TableSetupColumn("DPC p50 (us)");
+    ImGui::TableSetupColumn("DPC p99 (us)");
+    ImGui::TableSetupColumn("DPC Max (us)");
+    ImGui::TableSetupColumn("ISRs");
+    ImGui::TableSetupColumn("ISR p99 (us)");
+    ImGui::TableSetupColumn("ISR Max (us)");
+    ImGui::TableSetupColumn("Total (ms)");
+    ImGui::TableSetupColumn("Long Runs");
+    ImGui::TableHeadersRow();
+
+    for(auto&& driver : drivers)
+    {
+        ImGui::TableNextRow();
+        //Anything that went past the threshold at some point stands out
+        if(std::max(driver.dpc.max, driver.isr.max) >= static_cast<std::uint64_t>(thresholdMicros))
+            ImGui::TableSetBgColor(ImGuiTableBgTarget_RowBg1, longRowColorU32);
+
+        ImGui::TableNextColumn(); ImGui::TextUnformatted(driver.name.c_str());
+        ImGui::TableNextColumn(); ImGui::Text("%llu", static_cast<unsigned long long>(driver.dpc.count));
+        ImGui::TableNextColumn(); ImGui::Text("%llu", static_cast<unsigned long long>(driver.dpc.p50));
+        ImGui::TableNextColumn(); ImGui::Text("%llu", static_cast<unsigned long long>(driver.dpc.p99));
+        ImGui::TableNextColumn(); ImGui::Text("%llu", static_cast<unsigned long long>(driver.dpc.max));
+        ImGui::TableNextColumn(); ImGui::Text("%llu", static_cast<unsigned long long>(driver.isr.count));
+        ImGui::TableNextColumn(); ImGui::Text("%llu", static_cast<unsigned long long>(driver.isr.p99));
+        ImGui::TableNextColumn(); ImGui::Text("%llu", static_cast<unsigned long long>(driver.isr.max));
+        ImGui::TableNextColumn(); ImGui::Text("%.1f", driver.totalMicros / 1000.0);
+        ImGui::TableNextColumn(); ImGui::Text("%llu", static_cast<unsigned long long>(driver.longCount));
+    }
+
+    ImGui::EndTable();
+}
+
+void CTMPerformanceDPCScreen::RenderCoreBars()
+{
+    if(coreIndices.empty())
+    {
+        ImGui::TextDisabled("No DPC or ISR ran since the tracing started.");
+        return;
+    }
+
+    if(ImPlot::BeginPlot("##DpcCoreBars", {-1.0f, 250.0f}, ImPlotFlags_NoInputs | ImPlotFlags_NoMenus))
+    {
+        ImPlot::SetupAxes("Logical Processor", "Per second", ImPlotAxisFlags_AutoFit, ImPlotAxisFlags_AutoFit);
+        ImPlot::SetNextFillStyle(graphColors[static_cast<std::size_t>(CTMPlotTypeIndex::DpcTime)]);
+        ImPlot::PlotBars("DPCs", coreIndices.data(), coreDpcRates.data(), static_cast<int>(coreIndices.size()), barWidth, ImPlotBarsFlags_None);
+        ImPlot::SetNextFillStyle(graphColors[static_cast<std::size_t>(CTMPlotTypeIndex::IsrTime)]);
+        ImPlot::PlotBars("ISRs", isrBarPositions.data(), coreIsrRates.data(), static_cast<int>(isrBarPositions.size()), barWidth, ImPlotBarsFlags_None);
+        ImPlot::EndPlot();
+    }
+}
+
+void CTMPerformanceDPCScreen::RenderLongEventsTable()
+{
+    if(longEvents.empty())
+    {
+        ImGui::TextDisabled("Nothing ran for %d us or longer since the threshold was set.", thresholdMicros);
+        return;
+    }
+
+    constexpr float longEventsTableHeight = 200.0f;
+    if(!ImGui::BeginTable("DpcLongEventsTable", 5, ImGuiTableFlags_SizingStretchProp | ImGuiTableFlags_BordersInnerV |
+                                                     ImGuiTableFlags_ScrollY | ImGuiTableFlags_Resizable, {0.0f, longEventsTableHeight}))
+        return;
+
+    ImGui::TableSetupScrollFreeze(0, 1);
+    ImGui::TableSetupColumn("Driver");
+    ImGui::TableSetupColumn("Kind");
+    ImGui::TableSetupColumn("Duration (us)");
+    ImGui::TableSetupColumn("Logical Processor");
+    ImGui::TableSetupColumn("Seconds Ago");
+    ImGui::TableHeadersRow();
+
+    //Same clock the events carry
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    for(auto&& event : longEvents)
+    {
+        double secondsAgo = static_cast<ULONGLONG>(now.QuadPart) > event.timestamp ?
+                            static_cast<double>(static_cast<ULONGLONG>(now.QuadPart) - event.timestamp) / qpcFrequency : 0.0;
+
+        ImGui::TableNextRow();
+        ImGui::TableNextColumn(); ImGui::TextUnformatted(event.driverName.c_str());
+        ImGui::TableNextColumn(); ImGui::TextUnformatted(event.kind == CTMDpcKind::Isr ? "ISR" : "DPC");
+        ImGui::TableNextColumn(); ImGui::Text("%u", event.durationMicros);
+        ImGui::TableNextColumn(); ImGui::Text("%u", event.core);
+        ImGui::TableNextColumn(); ImGui::Text("%.1f", secondsAgo);
+    }
+
+    ImGui::EndTable();
+}
+
+void CTMPerformanceDPCScreen::RenderTrackerStatistics()
+{
+    ImGui::Text("DPCs: %llu   ISRs: %llu   Long runs: %llu", static_cast<unsigned long long>(trackerStats.dpcEvents),
+                static_cast<unsigned long long>(trackerStats.isrEvents), static_cast<unsigned long long>(trackerStats.longEvents));
+    ImGui::Text("Drivers loaded: %zu   With a DPC/ISR: %zu   Unknown routines: %llu", trackerStats.driverCount, trackerStats.trackedDrivers,
+                static_cast<unsigned long long>(trackerStats.unknownRoutines));
+    ImGui::Text("Bad timestamps: %llu   Dropped: %llu   Untracked processors: %llu   Memory: %zu KB", static_cast<unsigned long long>(trackerStats.badTimestamps),
+                static_cast<unsigned long long>(trackerStats.ringDrops), static_cast<unsigned long long>(trackerStats.untrackedCores),
+                trackerStats.memoryUsage / 1024);
+}
+
+//--------------------HELPER FUNCTIONS--------------------
+void CTMPerformanceDPCScreen::UpdateCoreRates(double elapsedSeconds)
+{
+    //Everything the tracker gives out is cumulative, the rates come from the difference with the last update
+    globalDpcLatencyTracker.GetCoreUsage(coreUsage);
+    std::size_t coreCount = coreUsage.size();
+    coreIndices.resize(coreCount);
+    isrBarPositions.resize(coreCount);
+    coreDpcRates.assign(coreCount, 0.0);
+    coreIsrRates.assign(coreCount, 0.0);
+    dpcRate = isrRate = 0.0;
+    elapsedSeconds = std::max(elapsedSeconds, 0.001);
+
+    for(std::size_t core = 0; core < coreCount; core++)
+    {
+        CTMCoreDpcUsage previous = core < prevCoreUsage.size() ? prevCoreUsage[core] : CTMCoreDpcUsage{};
+        //The tracker got cleared in between (benchmark, never the UI), start over from here
+        if(coreUsage[core].dpcCount < previous.dpcCount || coreUsage[core].isrCount < previous.isrCount)
+            previous = CTMCoreDpcUsage{};
+
+        coreIndices[core]     = static_cast<double>(core);
+        isrBarPositions[core] = core + barWidth;
+        coreDpcRates[core]    = (coreUsage[core].dpcCount - previous.dpcCount) / elapsedSeconds;
+        coreIsrRates[core]    = (coreUsage[core].isrCount - previous.isrCount) / elapsedSeconds;
+        dpcRate              += coreDpcRates[core];
+        isrRate              += coreIsrRates[core];
+    }
+    prevCoreUsage = coreUsage;
+}
@@ -0,0 +1,79 @@
+#ifndef CTM_PERFORMANCE_DPC_SCREEN_HPP
+#define CTM_PERFORMANCE_DPC_SCREEN_HPP
+
+//Windows stuff
+#include <windows.h>
+//My stuff
+#include "../ctm_perf_graph.h"
+#include "../ctm_perf_common.h"
+#include "../../CTMPureHeaderFiles/ctm_base_state.h"
+#include "../../CTMPureHeaderFiles/ctm_logger.h"
+#include "../../CTMGlobalManagers/ctm_event_session_manager.h"
+#include "../../CTMGlobalManagers/ctm_state_manager.h"
+#include "../../CTMGlobalManagers/ctm_perf_history_manager.h"
+//Stdlib stuff
+#include <vector>
+#include <string>
+#include <chrono>
+#include <algorithm>
+
+/*
+ * How long DPCs and ISRs run and which drivers they belong to, from the DPC/ISR events (check ctm_dpc_latency_tracker.h).
+ * A driver whose DPCs run for too long is what makes audio crackle and input lag, so the drivers table and the recent long runs are the main thing here.
+ * The events are acquired for as long as this page is open, the tracker keeps what it has when the page is left.
+ */
+class CTMPerformanceDPCScreen : public CTMBasePerformanceScreen, protected CTMPerformanceUsageGraph<2, double>
+{
+public:
+    CTMPerformanceDPCScreen();
+    ~CTMPerformanceDPCScreen() override;
+
+protected:
+    void OnRender() override;
+    void OnUpdate() override;
+
+private: //Render functions
+    void RenderThresholdAndRates();
+    void RenderDriversTable();
+    void RenderCoreBars();
+    void RenderLongEventsTable();
+    void RenderTrackerStatistics();
+
+private: //Helper functions
+    //Per core and overall rates since the last update
+    void UpdateCoreRates(double);
+
+private: //Managers
+    CTMEventSessionManager&       eventSessionManager       = CTMEventSessionManager::GetInstance();
+    CTMStateManager&              stateManager              = CTMStateManager::GetInstance();
+    CTMPerformanceHistoryManager& performanceHistoryManager = CTMPerformanceHistoryManager::GetInstance();
+
+private: //Copied out of the tracker once a second, the tables render from these
+    std::vector<CTMDriverDpcLatency>      drivers;         //Slowest (max) first
+    std::vector<CTMLongDpcEvent>          longEvents;      //Newest first
+    std::vector<CTMCoreDpcUsage>          coreUsage, prevCoreUsage;
+    std::vector<double>                   coreIndices;     //0, 1, 2... for the DPC bars
+    std::vector<double>                   isrBarPositions; //Right next to the DPC bar of the same processor
+    std::vector<double>                   coreDpcRates;    //Per second, same order as 'coreUsage'
+    std::vector<double>                   coreIsrRates;
+    CTMLatencySummary                     systemDpc, systemIsr;
+    CTMDpcLatencyStats                    trackerStats;
+    std::chrono::steady_clock::time_point lastRateTime;
+    double                                dpcRate              = 0.0;
+    double                                isrRate              = 0.0;
+    ULONGLONG                             qpcFrequency         = 1;
+    int                                   thresholdMicros      = 500;
+    bool                                  isProviderAcquired   = false;
+
+private: //Misc variables
+    enum class CTMPlotTypeIndex { DpcTime, IsrTime };
+    //Both in % of every logical processor's time, the y limit follows the bigger one
+    static constexpr ImVec4   graphColors[2]     = { {0.7f, 0.3f, 0.9f, 1.0f}, {0.9f, 0.5f, 0.2f, 1.0f} };
+    ImU32                     longRowColorU32    = IM_COL32(200, 50, 50, 120);
+    constexpr static int      minThresholdMicros = 10;
+    constexpr static int      maxThresholdMicros = 100000;
+    constexpr static double   minGraphPercent    = 1.0; //Idle machines sit way below a percent, don't zoom in on the noise
+    constexpr static double   barWidth           = 0.4; //DPC and ISR bars of a processor side by side
+};
+
+#endif
@@ -22,6 +22,9 @@ CTMPerformanceMEMScreen::CTMPerformanceMEMScreen()
     if(!CTMConstructorQueryWMI())
         CTM_LOG_WARNING("Expect improper RAM info.");
 
+    //The history manager samples it whether this page is open or not, the graph only shows it
+    BindHistorySeries(0, &performanceHistoryManager.GetSeries(CTMHistorySeriesIndex::MemoryInUse));
+
     SetInitialized(true);
 }
 
@@ -320,7 +323,7 @@ void CTMPerformanceMEMScreen::OnRender()
 
     //Plotting memory usage, this result is pretty much the same as that of Task Manager
     ImGui::Text("%.2lfGB", totalOSUsableMemoryInGB);
-    PlotUsageGraph("Memory in use (Over 60 Seconds)", 0.0, totalOSUsableMemoryInGB, {-1.0f, 300.0f}, { 0.588f, 0.463f, 0.929f, 1.0f });
+    PlotUsageGraph("Memory in use", 0.0, totalOSUsableMemoryInGB, {-1.0f, 300.0f}, { 0.588f, 0.463f, 0.929f, 1.0f });
     ImGui::TextUnformatted("0GB");
 
     //Give some spacing vertically before displaying Memory Info
@@ -341,14 +344,19 @@ void CTMPerformanceMEMScreen::OnRender()
     if(isStatisticsHeaderExpanded)
         RenderMemoryStatistics();
 
+    //Even more spacing vertically
+    ImGui::Dummy({-1.0f, 5.0f});
+
+    //Anomalies detected on the graph (global list, so it also contains anomalies from other screens and processes)
+    if(ImGui::CollapsingHeader("Anomaly Events"))
+        RenderAnomalyEvents();
+
     ImGui::PopStyleVar();
 }
 
 void CTMPerformanceMEMScreen::OnUpdate()
 {
-    UpdateXAxis();
-    double totalMemoryInUseInGB = UpdateMemoryStatus();
-    PlotYAxis(totalMemoryInUseInGB);
+    (void)UpdateMemoryStatus(); //Graph has its own sample, only the statistics need this
 
     //If the statistics header or memory composition header is collapsed, then only update the paged and cached memory data
     //Cuz the memory composition also uses some data from this function
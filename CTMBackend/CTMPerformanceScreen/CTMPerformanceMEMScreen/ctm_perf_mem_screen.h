@@ -13,6 +13,7 @@
 #include "../../CTMPureHeaderFiles/ctm_logger.h"
 #include "../../CTMGlobalManagers/ctm_wmi_manager.h"
 #include "../../CTMGlobalManagers/ctm_critical_resource_guard.h"
+#include "../../CTMGlobalManagers/ctm_perf_history_manager.h"
 //Stdlib stuff
 #include <string>
 #include <vector>
@@ -63,8 +64,9 @@ private: //Update functions
     void   UpdateMemoryCompositionInfo();
 
 private: //WMI Querying stuff and resource guard for PDH
-    CTMWMIManager&            wmiManager    = CTMWMIManager::GetInstance();
-    CTMCriticalResourceGuard& resourceGuard = CTMCriticalResourceGuard::GetInstance();
+    CTMWMIManager&                wmiManager                = CTMWMIManager::GetInstance();
+    CTMCriticalResourceGuard&     resourceGuard             = CTMCriticalResourceGuard::GetInstance();
+    CTMPerformanceHistoryManager& performanceHistoryManager = CTMPerformanceHistoryManager::GetInstance();
 
     //Unique name for resource guard cleanup function. Didn't really want to make another 'private' section
     const char* pdhCleanupFunctionName = "CTMPerformanceMEMScreen::ClosePDHQuery";
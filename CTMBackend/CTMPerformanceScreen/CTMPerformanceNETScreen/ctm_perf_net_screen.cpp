@@ -16,6 +16,10 @@ CTMPerformanceNETScreen::CTMPerformanceNETScreen()
         CTM_LOG_INFO("TIP: If you see Error code as 5, chances are, you may not have given location permission to this app."
                     " Querying for network info required location permission.");
     }
+
+    //The history manager samples these whether this page is open or not, the graph only shows them
+    BindHistorySeries(static_cast<std::size_t>(CTMNetworkTypeIndex::NetworkSent), &performanceHistoryManager.GetSeries(CTMHistorySeriesIndex::NetworkSent));
+    BindHistorySeries(static_cast<std::size_t>(CTMNetworkTypeIndex::NetworkRecieved), &performanceHistoryManager.GetSeries(CTMHistorySeriesIndex::NetworkRecieved));
     
     SetInitialized(true);
 }
@@ -36,7 +40,7 @@ void CTMPerformanceNETScreen::OnRender()
 
     //1) Graph
     ImGui::Text("%.2f %s", decodedMaxLimit, CTMPerformanceCommon::GetDataUnitAtIdx(decodedType));
-    PlotMultiUsageGraph("Network Usage (Over 60 sec)", "Sent Bytes", "Recieved Bytes", 0, GetYAxisMaxValue(), {-1, 300}, graphColors);
+    PlotMultiUsageGraph("Network Usage", "Sent Bytes", "Recieved Bytes", 0, GetYAxisMaxValue(), {-1, 300}, graphColors);
     ImGui::TextUnformatted("0 KB");
 
     //Give some spacing vertically before displaying Network Info
@@ -49,6 +53,13 @@ void CTMPerformanceNETScreen::OnRender()
     isStatisticsHeaderExpanded = ImGui::CollapsingHeader("Network Statistics");
     if(isStatisticsHeaderExpanded)
         RenderNetworkStatistics();
+
+    //Even more spacing vertically
+    ImGui::Dummy({-1.0f, 5.0f});
+
+    //Anomalies detected on the graph (global list, so it also contains anomalies from other screens and processes)
+    if(ImGui::CollapsingHeader("Anomaly Events"))
+        RenderAnomalyEvents();
     
     ImGui::PopStyleVar();
 }
@@ -56,11 +67,6 @@ void CTMPerformanceNETScreen::OnRender()
 void CTMPerformanceNETScreen::OnUpdate()
 {
     UpdateNetworkUsage();
-    UpdateXAxis();
-    
-    //The base values itself are going to be represented in KB
-    PlotYAxisAtIndex(static_cast<std::size_t>(CTMNetworkTypeIndex::NetworkSent), totalSentBytesKB);
-    PlotYAxisAtIndex(static_cast<std::size_t>(CTMNetworkTypeIndex::NetworkRecieved), totalRecBytesKB);
     
     //Also since we need dynamically changing y-axis limits, update y-axis at the backend side to the graphs max limit
     UpdateYAxisToMaxValue();
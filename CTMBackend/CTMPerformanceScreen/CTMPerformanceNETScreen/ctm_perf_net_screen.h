@@ -20,6 +20,7 @@
 #include "../../CTMPureHeaderFiles/ctm_logger.h"
 #include "../../CTMGlobalManagers/ctm_critical_resource_guard.h"
 #include "../../CTMGlobalManagers/ctm_winsock_manager.h"
+#include "../../CTMGlobalManagers/ctm_perf_history_manager.h"
 //Stdlib stuff
 #include <cstring>
 #include <memory>
@@ -70,8 +71,9 @@ private: //Helper functions
     double GetPdhFormattedNetworkData(PDH_HCOUNTER);
 
 private: //Global managers
-    CTMCriticalResourceGuard& resourceGuard  = CTMCriticalResourceGuard::GetInstance();
-    CTMWinsockManager&        winsockManager = CTMWinsockManager::GetInstance(); //This is all we have to do lmao, no need for anything else
+    CTMCriticalResourceGuard&     resourceGuard             = CTMCriticalResourceGuard::GetInstance();
+    CTMWinsockManager&            winsockManager            = CTMWinsockManager::GetInstance(); //This is all we have to do lmao, no need for anything else
+    CTMPerformanceHistoryManager& performanceHistoryManager = CTMPerformanceHistoryManager::GetInstance();
     //Unique names for registering resource guard
     const char* pdhCleanupFunctionName = "CTMPerformanceNETScreen::CleanupPDH";
     
@@ -89,7 +91,7 @@ private: //Network info variables
     std::vector<BYTE> networkInfoBuffer;
 
 private: //Stuff which cannot be in metricsVector (as i don't want to display them)
-    //Value used for graph. Represented in KB
+    //Current rates shown in the statistics. Represented in KB
     double totalSentBytesKB = 0, totalRecBytesKB = 0;
     //Value used for displaying graph y limits. Dynamically changes its unit
     float displayMaxYLimit = 0;
@@ -1,24 +1,19 @@
 #include "ctm_perf_graph.h"
+#include "../CTMGlobalManagers/ctm_perf_history_manager.h"
 
 //----------------------------------------PLOTTING FUNCTIONS----------------------------------------
 template<std::size_t NumOfPlots, typename PlotType>
 void CTMPerformanceUsageGraph<NumOfPlots, PlotType>::PlotUsageGraph(const char* plotLabel, double minPlotLimit, double maxPlotLimit,
     const ImVec2& plotSize, const ImVec4& plotColor)
 {
+    RenderRangeSelector(plotLabel);
+
     if(ImPlot::BeginPlot(plotLabel, plotSize, ImPlotFlags_NoInputs))
     {
-        ImPlot::SetupAxes(nullptr, nullptr, ImPlotAxisFlags_NoTickLabels, ImPlotAxisFlags_NoTickLabels);
-
-        ImPlot::SetupAxisLimits(ImAxis_X1, xAxisValue - graphDuration, xAxisValue, ImPlotCond_Always);
-        ImPlot::SetupAxisLimits(ImAxis_Y1, minPlotLimit, maxPlotLimit, ImPlotCond_Always);
-
-        ImPlot::SetNextFillStyle(plotColor, 0.5f);
-        ImPlot::SetNextLineStyle(plotColor, 0.5f);
+        SetupGraphAxes(minPlotLimit, maxPlotLimit);
 
-        ImPlot::PlotShaded("", &plotBuffers[0].Data[0].x, &plotBuffers[0].Data[0].y, plotBuffers[0].Data.size(),
-                            0, 0, plotBuffers[0].Offset, 2 * sizeof(PlotType));
-        ImPlot::PlotLine("", &plotBuffers[0].Data[0].x, &plotBuffers[0].Data[0].y, plotBuffers[0].Data.size(),
-                            0, plotBuffers[0].Offset, 2 * sizeof(PlotType));
+        PlotSeries(0, "", plotColor, true);
+        PlotAnomalyMarkers(0);
         
         ImPlot::EndPlot();
     }
@@ -28,31 +23,124 @@ template<std::size_t NumOfPlots, typename PlotType>
 void CTMPerformanceUsageGraph<NumOfPlots, PlotType>::PlotMultiUsageGraph(const char* plotLabel, const char* plotShadedLabel,
     const char* plotLineLabel, double minPlotLimit, double maxPlotLimit, const ImVec2& plotSize, const ImVec4 plotColors[NumOfPlots])
 {   
+    RenderRangeSelector(plotLabel);
+
     if(ImPlot::BeginPlot(plotLabel, plotSize, ImPlotFlags_NoInputs))
     {
-        ImPlot::SetupAxes(nullptr, nullptr, ImPlotAxisFlags_NoTickLabels, ImPlotAxisFlags_NoTickLabels);
-
-        ImPlot::SetupAxisLimits(ImAxis_X1, xAxisValue - graphDuration, xAxisValue, ImPlotCond_Always);
-        ImPlot::SetupAxisLimits(ImAxis_Y1, minPlotLimit, maxPlotLimit, ImPlotCond_Always);
+        SetupGraphAxes(minPlotLimit, maxPlotLimit);
 
         //Rn at max there will be two plots only, so make one line and one shaded
         //1) 0th index is shaded
-        ImPlot::SetNextFillStyle(plotColors[0], 0.5f);
-        ImPlot::SetNextLineStyle(plotColors[0], 0.5f);
-        ImPlot::PlotShaded(plotShadedLabel, &plotBuffers[0].Data[0].x, &plotBuffers[0].Data[0].y, plotBuffers[0].Data.size(),
-                            0, 0, plotBuffers[0].Offset, 2 * sizeof(PlotType));
-        ImPlot::PlotLine(plotShadedLabel, &plotBuffers[0].Data[0].x, &plotBuffers[0].Data[0].y, plotBuffers[0].Data.size(),
-                            0, plotBuffers[0].Offset, 2 * sizeof(PlotType));
+        PlotSeries(0, plotShadedLabel, plotColors[0], true);
 
         //2) 1st index is line
-        ImPlot::SetNextLineStyle(plotColors[1], 0.5f);
-        ImPlot::PlotLine(plotLineLabel, &plotBuffers[1].Data[0].x, &plotBuffers[1].Data[0].y, plotBuffers[1].Data.size(),
-                            0, plotBuffers[1].Offset, 2 * sizeof(PlotType));
+        PlotSeries(1, plotLineLabel, plotColors[1], false);
+
+        //3) Anomalies of both the plots
+        PlotAnomalyMarkers(0);
+        PlotAnomalyMarkers(1);
         
         ImPlot::EndPlot();
     }
 }
 
+//----------------------------------------HELPER FUNCTIONS----------------------------------------
+template<std::size_t NumOfPlots, typename PlotType>
+void CTMPerformanceUsageGraph<NumOfPlots, PlotType>::PlotAnomalyMarkers(std::size_t index)
+{
+    //Marker buffers start empty, nothing to draw (and nothing to index into)
+    if(!boundSeries[index] || boundSeries[index]->GetAnomalyMarkers().Data.empty())
+        return;
+
+    const auto& anomalyBuffer = boundSeries[index]->GetAnomalyMarkers();
+
+    //Red markers on top of the line, the ones which scrolled out of the selected range simply get clipped by the plot
+    ImPlot::SetNextMarkerStyle(ImPlotMarker_Circle, 4.0f, {1.0f, 0.2f, 0.2f, 1.0f}, 1.0f, {1.0f, 0.2f, 0.2f, 1.0f});
+    ImPlot::PlotScatter("##Anomalies", &anomalyBuffer.Data[0].x, &anomalyBuffer.Data[0].y, anomalyBuffer.Data.size(),
+                        0, anomalyBuffer.Offset, 2 * sizeof(PlotType));
+}
+
+template<std::size_t NumOfPlots, typename PlotType>
+void CTMPerformanceUsageGraph<NumOfPlots, PlotType>::PlotSeries(std::size_t index, const char* label, const ImVec4& color, bool isShaded)
+{
+    if(!boundSeries[index])
+        return;
+
+    const auto& range = graphRanges[selectedRangeIndex];
+    const auto& tier  = boundSeries[index]->GetHistory().GetTier(range.tierIndex);
+
+    //Coarse tiers only get their first bucket after 10 sec / 1 min, nothing to draw (and nothing to index into) till then
+    if(tier.GetSize() == 0)
+        return;
+
+    const CTMHistoryBucket<PlotType>* data = tier.GetData();
+    constexpr int stride = sizeof(CTMHistoryBucket<PlotType>);
+
+    //Coarse buckets get a faint band from their min to their max under the average, so a spike merged into a bucket doesn't vanish
+    //1 sec buckets have min == max == avg, no need for it there
+    if(range.tierIndex != 0)
+    {
+        ImPlot::SetNextFillStyle(color, 0.2f);
+        ImPlot::PlotShaded(label, &data->x, &data->min, &data->max, tier.GetSize(), 0, tier.GetOffset(), stride);
+    }
+
+    if(isShaded)
+    {
+        ImPlot::SetNextFillStyle(color, 0.5f);
+        ImPlot::SetNextLineStyle(color, 0.5f);
+        ImPlot::PlotShaded(label, &data->x, &data->avg, tier.GetSize(), 0, 0, tier.GetOffset(), stride);
+    }
+    else
+        ImPlot::SetNextLineStyle(color, 0.5f);
+
+    ImPlot::PlotLine(label, &data->x, &data->avg, tier.GetSize(), 0, tier.GetOffset(), stride);
+}
+
+template<std::size_t NumOfPlots, typename PlotType>
+void CTMPerformanceUsageGraph<NumOfPlots, PlotType>::RenderRangeSelector(const char* plotLabel)
+{
+    //Screens with more than one graph get a selector per graph, the label keeps their ids apart
+    ImGui::PushID(plotLabel);
+    for(std::size_t i = 0; i < std::size(graphRanges); i++)
+    {
+        if(ImGui::RadioButton(graphRanges[i].label, selectedRangeIndex == i) && selectedRangeIndex != i)
+        {
+            selectedRangeIndex = i;
+            //Don't wait for the next update to rescale to what this range shows
+            UpdateYAxisToMaxValue();
+        }
+
+        if(i + 1 < std::size(graphRanges))
+            ImGui::SameLine(0.0f, 15.0f);
+    }
+    ImGui::PopID();
+}
+
+template<std::size_t NumOfPlots, typename PlotType>
+void CTMPerformanceUsageGraph<NumOfPlots, PlotType>::SetupGraphAxes(double minPlotLimit, double maxPlotLimit)
+{
+    ImPlot::SetupAxes(nullptr, nullptr, ImPlotAxisFlags_NoTickLabels, ImPlotAxisFlags_NoTickLabels);
+
+    //Every series shares the history manager's clock, so the right edge is always now
+    double xAxisValue = CTMPerformanceHistoryManager::GetInstance().GetCurrentX();
+    ImPlot::SetupAxisLimits(ImAxis_X1, xAxisValue - graphRanges[selectedRangeIndex].duration, xAxisValue, ImPlotCond_Always);
+    ImPlot::SetupAxisLimits(ImAxis_Y1, minPlotLimit, maxPlotLimit, ImPlotCond_Always);
+}
+
+template<std::size_t NumOfPlots, typename PlotType>
+void CTMPerformanceUsageGraph<NumOfPlots, PlotType>::UpdateYAxisToMaxValue()
+{
+    const auto& range   = graphRanges[selectedRangeIndex];
+    PlotType    fromX   = static_cast<PlotType>(CTMPerformanceHistoryManager::GetInstance().GetCurrentX()) - range.duration;
+    //This is for the case when we start supporting multiple buffers
+    PlotType    temp    = 0;
+    for(std::size_t i = 0; i < NumOfPlots; i++)
+        if(boundSeries[i])
+            temp = std::max(temp, boundSeries[i]->GetHistory().GetTier(range.tierIndex).GetMaxValue(fromX));
+    
+    yAxisMaxValue = temp;
+}
+
 //Because of how templated functions work around files (aka they don't work at all)
 //We need to pre initiate the template building process (if it makes any sense)
 //Aka we need to pre declare templates for the compiler to build a copy of those stuff so they can be used in other files
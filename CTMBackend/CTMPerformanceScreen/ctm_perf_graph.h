@@ -1,17 +1,23 @@
 #ifndef CTM_PERFORMANCE_USAGE_GRAPH_HPP
 #define CTM_PERFORMANCE_USAGE_GRAPH_HPP
 
-//Using std::max instead
+//Using std::max and std::min instead
 #undef max
+#undef min
 
 //My stuff
 #include "../CTMPureHeaderFiles/ctm_logger.h"
+#include "../CTMPureHeaderFiles/ctm_anomaly_detector.h"
+#include "../CTMGlobalManagers/ctm_anomaly_event_log.h"
 //ImGui and Implot stuff
 #include "../../ImGUI/imgui.h"
 #include "../../ImPlot/implot.h"
 //Stdlib stuff
 #include <vector>
 #include <algorithm>
+#include <iterator>
+#include <limits>
+#include <cstdint>
 
 //'using' makes my life alot easi-
 template<typename T>
@@ -41,13 +47,19 @@ public:
     PlotBufferVector<CTMPoint<T>> Data = { {0, 0} };
     std::size_t                   MaxSize;
     std::size_t                   Offset;
+    bool                          HasInitialValue;
 
 public:
-    CTMScrollingBuffer(std::size_t maxSizeIn = 61)
+    CTMScrollingBuffer(std::size_t maxSizeIn = 61, bool hasInitialValueIn = true)
     {
-        MaxSize = maxSizeIn;
-        Offset  = 0;
+        MaxSize         = maxSizeIn;
+        Offset          = 0;
+        HasInitialValue = hasInitialValueIn;
         Data.reserve(MaxSize);
+
+        //Buffers used for markers (like anomalies) don't want a fake point at (0, 0)
+        if(!HasInitialValue)
+            Data.clear();
     }
 
     void AddPoint(T x, T y)
@@ -65,8 +77,9 @@ public:
     {
         Data.clear();
         Offset = 0;
-        //An initial value is always needed so it doesn't throw an access out of bounds error
-        Data.emplace_back(0, 0);
+        //An initial value is always needed so it doesn't throw an access out of bounds error (unless the buffer says otherwise)
+        if(HasInitialValue)
+            Data.emplace_back(0, 0);
     }
 
     T GetMaxYValue()
@@ -76,10 +89,203 @@ public:
     }
 };
 
+//Same as the scrolling buffer but without the initial (0, 0) point. Used for markers drawn on top of the graph (like anomalies)
+//Default size matches the 1 sec tier of 'CTMPerformanceUsageGraph' (600 + 1), an anomaly every second is the worst case
+template<typename T>
+struct CTMMarkerBuffer : public CTMScrollingBuffer<T>
+{
+    CTMMarkerBuffer(std::size_t maxSizeIn = 601) : CTMScrollingBuffer<T>(maxSizeIn, false) {}
+};
+
+//One point of a history tier. Coarse tiers keep the spread of the samples they merged, so a 1 sec spike still shows on a 24 hour view
+//A bucket of NaNs marks a hole (nothing got sampled for a whole bucket), ImPlot draws it as missing data instead of a line across it
+template<typename T>
+struct CTMHistoryBucket
+{
+    T x   = 0; //X of the last sample merged in
+    T min = 0;
+    T max = 0;
+    T avg = 0;
+};
+
+//Ring of buckets of a single resolution, bucket 'n' holds the samples with X (whole seconds) in [n * bucketSeconds, (n + 1) * bucketSeconds)
+//Grows till 'capacity' then overwrites the oldest (same idea as the scrolling buffer), so it never takes more than 'capacity' buckets
+template<typename T>
+class CTMHistoryTier
+{
+public:
+    CTMHistoryTier(std::size_t capacityIn, std::int64_t bucketSecondsIn) : capacity(capacityIn), bucketSeconds(bucketSecondsIn) {}
+
+    void AddSample(T x, T y)
+    {
+        std::int64_t bucketIndex = static_cast<std::int64_t>(x) / bucketSeconds;
+
+        //Bucket we were filling is over even if it missed some samples
+        if(pendingCount > 0 && bucketIndex != pendingBucketIndex)
+            FlushPending();
+        //Whole buckets without a sample in between, leave a hole so the graph doesn't pretend it knows what happened there
+        if(hasSamples && bucketIndex > lastBucketIndex + 1)
+        {
+            constexpr T nan = std::numeric_limits<T>::quiet_NaN();
+            PushBucket({ static_cast<T>((lastBucketIndex + 1) * bucketSeconds), nan, nan, nan });
+        }
+
+        pendingMin         = (pendingCount == 0) ? y : std::min(pendingMin, y);
+        pendingMax         = (pendingCount == 0) ? y : std::max(pendingMax, y);
+        pendingSum        += y;
+        pendingLastX       = x;
+        pendingBucketIndex = bucketIndex;
+        lastBucketIndex    = bucketIndex;
+        hasSamples         = true;
+        ++pendingCount;
+
+        //Sample of the bucket's last second, no need to wait for the next bucket to show it
+        if(static_cast<std::int64_t>(x) + 1 >= (bucketIndex + 1) * bucketSeconds)
+            FlushPending();
+    }
+
+    void Reset()
+    {
+        buckets.clear();
+        offset       = 0;
+        pendingSum   = 0;
+        pendingCount = 0;
+        hasSamples   = false;
+    }
+
+    //Highest max of the buckets which are at or after 'fromX', aka the ones visible on the graph (holes are NaN, std::max keeps the left one)
+    T GetMaxValue(T fromX) const
+    {
+        T maxValue = 0;
+        for(const auto& bucket : buckets)
+            if(bucket.x >= fromX)
+                maxValue = std::max(maxValue, bucket.max);
+        return maxValue;
+    }
+
+    //Laid out for ImPlot, 'offset' is the oldest bucket once the ring has wrapped
+    const CTMHistoryBucket<T>* GetData()   const { return buckets.data(); }
+    int                        GetSize()   const { return static_cast<int>(buckets.size()); }
+    int                        GetOffset() const { return static_cast<int>(offset); }
+
+private:
+    void FlushPending()
+    {
+        PushBucket({ pendingLastX, pendingMin, pendingMax, pendingSum / static_cast<T>(pendingCount) });
+        pendingSum   = 0;
+        pendingCount = 0;
+    }
+
+    void PushBucket(const CTMHistoryBucket<T>& bucket)
+    {
+        if(buckets.size() < capacity)
+            buckets.push_back(bucket);
+        else
+        {
+            buckets[offset] = bucket;
+            offset          = (offset + 1) % capacity;
+        }
+    }
+
+private:
+    PlotBufferVector<CTMHistoryBucket<T>> buckets;
+    std::size_t                           capacity           = 0;
+    std::size_t                           offset             = 0;
+    std::int64_t                          bucketSeconds      = 1;
+    std::int64_t                          lastBucketIndex    = 0;
+    bool                                  hasSamples         = false;
+    //Bucket being filled
+    T                                     pendingMin         = 0;
+    T                                     pendingMax         = 0;
+    T                                     pendingSum         = 0;
+    T                                     pendingLastX       = 0;
+    std::int64_t                          pendingBucketIndex = 0;
+    std::size_t                           pendingCount       = 0;
+};
+
+/*
+ * Everything a single graph series remembers, at three resolutions (a sample comes in every second, X is in seconds of wall clock):
+ * 1) 1 sec  for 10 minutes ->   600 buckets
+ * 2) 10 sec for 6 hours    ->  2160 buckets
+ * 3) 1 min  for 7 days     -> 10080 buckets
+ * Both coarse tiers are merged straight from the 1 sec samples, so their min/max are exact and not a max of averages.
+ * Buckets go by X and not by sample count, so a bucket always covers its 10 sec / 1 min of real time and missed seconds don't stretch it.
+ * 12840 buckets of 4 values, for 'double' thats 32 bytes each -> 410,880 bytes (~401 KB) per series at most, and it never grows past that.
+ */
+template<typename T>
+class CTMTieredSeries
+{
+public:
+    void AddSample(T x, T y)
+    {
+        for(auto& tier : tiers)
+            tier.AddSample(x, y);
+    }
+
+    void Reset()
+    {
+        for(auto& tier : tiers)
+            tier.Reset();
+    }
+
+    const CTMHistoryTier<T>& GetTier(std::size_t index) const { return tiers[index]; }
+
+public:
+    constexpr static std::size_t tierCount = 3;
+
+private:
+    CTMHistoryTier<T> tiers[tierCount] = { {600, 1}, {2160, 10}, {10080, 60} };
+};
+
+/*
+ * A graph series for the whole run of the app: its history tiers, the anomaly detector running over it and the anomalies it found.
+ * They are owned by 'CTMPerformanceHistoryManager' (check ctm_perf_history_manager.h) which keeps sampling them with no screen open,
+ * graphs only read them.
+ */
+template<typename T>
+class CTMHistorySeries
+{
+public:
+    //Name is used in the anomaly events list, so it should be a string literal (or live as long as the series does)
+    //minSigma is in the same unit as the sampled value, it stops a flat series from flagging every tiny wiggle
+    void SetAnomalyParameters(const char* seriesNameIn, double minSigma, double kSigma = CTMAnomalyDetector::defaultKSigma, double alpha = CTMAnomalyDetector::defaultAlpha)
+    {
+        seriesName = seriesNameIn;
+        anomalyDetector.SetParameters(alpha, kSigma, minSigma);
+    }
+
+    void AddSample(T x, T y)
+    {
+        history.AddSample(x, y);
+        latestValue = y;
+
+        //Check the sample against the running estimate, mark it on the graph and log it if its an anomaly
+        if(anomalyDetector.AddSample(y))
+        {
+            anomalyMarkers.AddPoint(x, y);
+            CTMAnomalyEventLog::GetInstance().Record(seriesName, y, anomalyDetector.GetMean(), anomalyDetector.GetLastDeviation());
+        }
+    }
+
+public: //Getter functions
+    const CTMTieredSeries<T>& GetHistory()        const { return history;        }
+    const CTMMarkerBuffer<T>& GetAnomalyMarkers() const { return anomalyMarkers; }
+    T                         GetLatestValue()    const { return latestValue;    }
+
+private:
+    CTMTieredSeries<T> history;
+    //Markers are kept for the last 10 minutes of samples at most, older ones are still in the anomaly events list
+    CTMMarkerBuffer<T> anomalyMarkers;
+    CTMAnomalyDetector anomalyDetector;
+    const char*        seriesName  = "";
+    T                  latestValue = 0;
+};
+
 //Its simply a class to be inherited by 'screen' classes (aka (pages/screens) like Cpu Usage, etc)
 //It contains function and variables to plot graph which is common to all screens
 //No error handling in most cases as i am assuming i'm not dumb ( which i am ) enough to access arrays out of bounds
 //Templating it as it maybe used for plotting multiple lines on a single graph. Template param PlotType added to switch between float and double
+//The data itself isn't in here, every plot reads a 'CTMHistorySeries' which outlives the screen (bound with 'BindHistorySeries')
 template<std::size_t NumOfPlots, typename PlotType>
 class CTMPerformanceUsageGraph
 {
@@ -93,47 +299,47 @@ protected: //Used in render function
     void PlotUsageGraph(const char*, double, double, const ImVec2&, const ImVec4&);
     //For plotting multiple lines in single graph
     void PlotMultiUsageGraph(const char*, const char*, const char*, double, double, const ImVec2&, const ImVec4[NumOfPlots]);
+    //Anomalies of every series are logged to the global event log, this just renders it
+    void RenderAnomalyEvents() { anomalyEventLog.RenderEventsTable("AnomalyEventsTable", 200.0f); }
 
 protected: //Used in update function
-    //Plotting for both multiple and single plots
-    void PlotYAxis(PlotType y)                            { PlotPointAtIndex(0, y);         }
-    void PlotYAxisAtIndex(std::size_t index, PlotType y)  { PlotPointAtIndex(index, y);     }
-
-    //X-Axis will always be fixed to updating per second, unless in future i change my mind
-    void UpdateXAxis()                                    { xAxisValue += xAxisValueOffset; }
     //Update y-axis value dynamically if the user wants to do it. Optional ofc
-    void UpdateYAxisToMaxValue()
-    {
-        //This is for the case when we start supporting multiple buffers
-        PlotType temp = 0;
-        for(std::size_t i = 0; i < NumOfPlots; i++)
-            temp = std::max(temp, plotBuffers[i].GetMaxYValue());
-        
-        yAxisMaxValue = temp;
-    }
+    //Only looks at what the selected time range shows, a spike from 3 hours ago shouldn't squash the last minute
+    void UpdateYAxisToMaxValue();
 
 protected: //Common function
     double GetYAxisMaxValue() { return yAxisMaxValue; }
-    void   ResetGraph()
+    //nullptr plots nothing at that index (disk without counters, etc)
+    void   BindHistorySeries(std::size_t index, const CTMHistorySeries<PlotType>* series)
     {
-        for(std::size_t i = 0; i < NumOfPlots; i++)
-            plotBuffers[i].ResetBuffer();
-        xAxisValue    = 0;
-        yAxisMaxValue = 0;
+        boundSeries[index] = series;
+        UpdateYAxisToMaxValue();
     }
 
 private: //Helper functions
-    void PlotPointAtIndex(std::size_t index, PlotType y) { plotBuffers[index].AddPoint(xAxisValue, y); }
+    void PlotAnomalyMarkers(std::size_t);
+    void PlotSeries(std::size_t, const char*, const ImVec4&, bool);
+    void RenderRangeSelector(const char*);
+    void SetupGraphAxes(double, double);
+
+private: //Time ranges the graphs can show, each one reads from the tier whose resolution fits it (a few hundred to 1440 points)
+    struct CTMGraphRange
+    {
+        const char* label;
+        PlotType    duration; //In seconds, same as the x axis
+        std::size_t tierIndex;
+    };
+    constexpr static CTMGraphRange graphRanges[] = { {"1 min", 60, 0}, {"10 min", 600, 0}, {"1 h", 3600, 1}, {"24 h", 86400, 2} };
 
 private: //I don't want these variables to accidentally get modified in any way other than the method specified by functions
-    //These are hardcoded as all the screens will be having same duration of graph and buffer size
-    constexpr static PlotType    graphDuration    = 60;
-    constexpr static PlotType    xAxisValueOffset = 1;
-    PlotType                     xAxisValue       = 0;
-    CTMScrollingBuffer<PlotType> plotBuffers[NumOfPlots]{ static_cast<std::size_t>(graphDuration + 1) };
+    const CTMHistorySeries<PlotType>* boundSeries[NumOfPlots] = {};
+    std::size_t                       selectedRangeIndex      = 0; //1 min, like it always was
     
     //Used specifically when we plot dynamically changing y axis values
     PlotType yAxisMaxValue    = 0;
+
+private: //Global managers
+    CTMAnomalyEventLog& anomalyEventLog = CTMAnomalyEventLog::GetInstance();
 };
 
 #endif
\ No newline at end of file
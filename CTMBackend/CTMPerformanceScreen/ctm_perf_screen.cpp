@@ -61,6 +61,10 @@ void CTMPerformanceScreen::SwitchScreen(CTMPerformanceScreenState newState)
             currentScreen = std::make_unique<CTMPerformanceDISKScreen>();
             break;
 
+        case CTMPerformanceScreenState::DpcInfo:
+            currentScreen = std::make_unique<CTMPerformanceDPCScreen>();
+            break;
+
         default:
             currentScreen = nullptr;
             break;
@@ -142,6 +146,8 @@ void CTMPerformanceScreen::RenderSidebar(const ImVec2& contentRegion)
                             {0.2f, 0.2f, 0.8f, 1.0f}, {0.1f, 0.1f, 0.6f, 1.0f}, CTMPerformanceScreenState::NetInfo);
         RenderSidebarButton("DISK", "Disk Info", sidebarButtonSize,
                             {0.8f, 0.6f, 0.2f, 1.0f}, {0.6f, 0.4f, 0.1f, 1.0f}, CTMPerformanceScreenState::DiskInfo);
+        RenderSidebarButton("DPC", "DPC/ISR Latency", sidebarButtonSize,
+                            {0.6f, 0.2f, 0.8f, 1.0f}, {0.4f, 0.1f, 0.6f, 1.0f}, CTMPerformanceScreenState::DpcInfo);
 
     }
     ImGui::EndChild();
@@ -12,6 +12,7 @@
 #include "CTMPerformanceMEMScreen/ctm_perf_mem_screen.h"
 #include "CTMPerformanceNETScreen/ctm_perf_net_screen.h"
 #include "CTMPerformanceDISKScreen/ctm_perf_disk_screen.h"
+#include "CTMPerformanceDPCScreen/ctm_perf_dpc_screen.h"
 #include "../CTMPureHeaderFiles/ctm_base_state.h"
 #include "../CTMPureHeaderFiles/ctm_constants.h"
 #include "../CTMGlobalManagers/ctm_state_manager.h"
@@ -0,0 +1,190 @@
+#include "ctm_cpu_timeline.h"
+
+//Don't really want these macros, they are messing up the std::max and std::min functions
+#undef max
+#undef min
+
+//Init global variables
+CTMCpuTimeline globalCpuTimeline;
+
+//--------------------WRITER FUNCTIONS--------------------
+void CTMCpuTimeline::RecordSwitch(std::uint32_t core, ULONGLONG timestamp, DWORD threadId)
+{
+    if(!isAllocated.load(std::memory_order_acquire) || core >= coreCount)
+        return;
+
+    switchCount.fetch_add(1, std::memory_order_relaxed);
+
+    //Events from before we allocated (rundown, a buffer flushed late) all start at 0
+    std::uint64_t micros = timestamp > static_cast<ULONGLONG>(qpcStart) ? static_cast<std::uint64_t>((timestamp - qpcStart) * microsPerTick) : 0;
+
+    //Run length encoding, the thread already has the core so the run just goes on
+    CTMCoreRing& coreRing = coreRings[core];
+    if(coreRing.hasRun && coreRing.lastThreadId == threadId)
+        return;
+
+    //Every core's events come in order, but don't let a bad timestamp make the runs go backwards
+    micros = std::max(micros, coreRing.lastMicros);
+
+    //A reader which sees the overwritten slot has to see the write count that came before it too (pairs with the fence in 'ReadCore')
+    std::uint64_t writeCount = coreRing.writeCount.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    runs[core * runsPerCore + writeCount % runsPerCore].store(PackRun(static_cast<std::uint32_t>(micros), threadId), std::memory_order_relaxed);
+    coreRing.lastMicros   = micros;
+    coreRing.lastThreadId = threadId;
+    coreRing.hasRun       = true;
+
+    //Latest first, a reader which sees the new run must not unwrap it against an older time
+    if(micros > latestMicros.load(std::memory_order_relaxed))
+        latestMicros.store(micros, std::memory_order_release);
+    coreRing.writeCount.store(writeCount + 1, std::memory_order_release);
+    storedRuns.fetch_add(1, std::memory_order_relaxed);
+}
+
+void CTMCpuTimeline::SetThreadProcess(DWORD threadId, DWORD processId)
+{
+    if(!isAllocated.load(std::memory_order_acquire) || threadId == 0)
+        return;
+
+    //The snapshot taken when the provider gets enabled can race the thread events, so empty slots are claimed with a CAS
+    std::uint64_t entry = (static_cast<std::uint64_t>(threadId) << 32) | processId;
+    std::size_t   home  = HashThreadId(threadId);
+    for(std::size_t probe = 0; probe < maxThreadProbe; probe++)
+    {
+        std::atomic<std::uint64_t>& slot = threadSlots[(home + probe) & (threadSlotCount - 1)];
+        std::uint64_t current = slot.load(std::memory_order_relaxed);
+        if(current == 0 && slot.compare_exchange_strong(current, entry, std::memory_order_relaxed))
+            return;
+
+        //Thread ids get reused, the newest process wins
+        if((current >> 32) == threadId)
+        {
+            slot.store(entry, std::memory_order_relaxed);
+            return;
+        }
+    }
+
+    //Too crowded around here, whoever had the home slot is most likely long gone
+    threadSlots[home].store(entry, std::memory_order_relaxed);
+}
+
+//--------------------MAIN FUNCTIONS--------------------
+bool CTMCpuTimeline::Allocate(std::uint32_t logicalProcessors)
+{
+    if(isAllocated.load(std::memory_order_acquire))
+        return true;
+
+    if(logicalProcessors == 0)
+        return false;
+
+    LARGE_INTEGER qpcNow, qpcFrequency;
+    QueryPerformanceCounter(&qpcNow);
+    QueryPerformanceFrequency(&qpcFrequency);
+    qpcStart      = qpcNow.QuadPart;
+    microsPerTick = 1000000.0 / static_cast<double>(qpcFrequency.QuadPart);
+
+    coreCount   = logicalProcessors;
+    runsPerCore = std::max(minRunsPerCore, runBudget / coreCount);
+    runs        = std::make_unique<std::atomic<std::uint64_t>[]>(coreCount * runsPerCore);
+    coreRings   = std::make_unique<CTMCoreRing[]>(coreCount);
+    threadSlots = std::make_unique<std::atomic<std::uint64_t>[]>(threadSlotCount);
+
+    //Writers only look at anything above once this is set
+    isAllocated.store(true, std::memory_order_release);
+    return true;
+}
+
+bool CTMCpuTimeline::ReadCore(std::uint32_t core, std::uint64_t fromMicros, std::uint64_t toMicros, std::vector<CTMCoreOccupancy>& outRuns) const
+{
+    if(!isAllocated.load(std::memory_order_acquire) || core >= coreCount)
+        return false;
+
+    const CTMCoreRing&                coreRing   = coreRings[core];
+    const std::atomic<std::uint64_t>* coreRuns   = &runs[core * runsPerCore];
+    std::uint64_t                     writeCount = coreRing.writeCount.load(std::memory_order_acquire);
+    std::uint64_t                     latest     = latestMicros.load(std::memory_order_acquire);
+    std::uint64_t                     oldest     = writeCount > runsPerCore ? writeCount - runsPerCore : 0;
+
+    //Newest to oldest, the newest run goes on until the newest switch we know of (on any core)
+    std::size_t   firstOut    = outRuns.size();
+    std::uint64_t runEnd      = latest;
+    std::uint64_t oldestIndex = writeCount;
+    for(std::uint64_t index = writeCount; index-- > oldest; )
+    {
+        std::uint64_t packed = coreRuns[index % runsPerCore].load(std::memory_order_relaxed);
+        std::uint64_t start  = UnwrapMicros(static_cast<std::uint32_t>(packed >> 32), latest);
+        //Starts only go down from here, anything else got overwritten while we were reading (or is older than the wrap)
+        if(start > runEnd)
+            break;
+
+        if(start < toMicros && runEnd > fromMicros)
+        {
+            CTMCoreOccupancy occupancy;
+            occupancy.startMicros = std::max(start, fromMicros);
+            occupancy.endMicros   = std::min(runEnd, toMicros);
+            occupancy.threadId    = static_cast<DWORD>(packed);
+            occupancy.processId   = FindProcessId(occupancy.threadId);
+            outRuns.push_back(occupancy);
+            oldestIndex = index;
+        }
+
+        if(start <= fromMicros)
+            break;
+        runEnd = start;
+    }
+
+    //The writer may have lapped the oldest slots we read, those are the last ones we added.-
+    //-An acquire load doesn't keep the relaxed slot reads above from moving after it, the fence does
+    std::atomic_thread_fence(std::memory_order_acquire);
+    std::uint64_t writeCountAfter = coreRing.writeCount.load(std::memory_order_relaxed);
+    std::uint64_t firstValid      = writeCountAfter >= runsPerCore ? writeCountAfter - runsPerCore + 1 : 0;
+    if(oldestIndex < firstValid)
+    {
+        std::size_t overwritten = static_cast<std::size_t>(std::min<std::uint64_t>(firstValid - oldestIndex, outRuns.size() - firstOut));
+        outRuns.resize(outRuns.size() - overwritten);
+    }
+
+    std::reverse(outRuns.begin() + firstOut, outRuns.end());
+    return true;
+}
+
+DWORD CTMCpuTimeline::FindProcessId(DWORD threadId) const
+{
+    if(!isAllocated.load(std::memory_order_acquire) || threadId == 0)
+        return 0;
+
+    std::size_t home = HashThreadId(threadId);
+    for(std::size_t probe = 0; probe < maxThreadProbe; probe++)
+    {
+        std::uint64_t entry = threadSlots[(home + probe) & (threadSlotCount - 1)].load(std::memory_order_relaxed);
+        if(entry == 0)
+            return 0;
+        if((entry >> 32) == threadId)
+            return static_cast<DWORD>(entry);
+    }
+
+    return 0;
+}
+
+std::size_t CTMCpuTimeline::GetMemoryUsage() const
+{
+    if(!IsAllocated())
+        return 0;
+
+    return coreCount * runsPerCore * sizeof(std::atomic<std::uint64_t>) + coreCount * sizeof(CTMCoreRing) +
+           threadSlotCount * sizeof(std::atomic<std::uint64_t>);
+}
+
+//--------------------HELPER FUNCTIONS--------------------
+std::uint64_t CTMCpuTimeline::UnwrapMicros(std::uint32_t wrappedMicros, std::uint64_t latest)
+{
+    //How far behind the latest time it is, modulo 2^32. Runs are never newer than the latest time
+    std::uint32_t behind = static_cast<std::uint32_t>(latest) - wrappedMicros;
+    return latest >= behind ? latest - behind : 0;
+}
+
+std::size_t CTMCpuTimeline::HashThreadId(DWORD threadId)
+{
+    //Thread ids are multiples of 4, drop those bits before spreading them out
+    return static_cast<std::size_t>(((threadId >> 2) * 2654435761u) & (threadSlotCount - 1));
+}
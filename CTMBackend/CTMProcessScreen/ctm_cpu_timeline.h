@@ -0,0 +1,112 @@
+#ifndef CTM_CPU_TIMELINE_HPP
+#define CTM_CPU_TIMELINE_HPP
+
+//Windows stuff
+#include <windows.h>
+//Stdlib stuff
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <algorithm>
+#include <cstdint>
+
+//Stretch of time a core spent on one thread, the way the reader hands it out
+struct CTMCoreOccupancy
+{
+    //Perfect 8 byte alignment
+    std::uint64_t startMicros = 0; //On the timeline's clock (check 'GetLatestMicros')
+    std::uint64_t endMicros   = 0;
+    DWORD         threadId    = 0; //0 -> idle
+    DWORD         processId   = 0; //0 -> idle, or a thread whose process we never found out
+};
+
+/*
+ * Which thread occupied every logical processor, built from context switch events (CSwitch from the kernel, or the synthetic source).
+ * Every core has its own ring of runs, a run is only 8 bytes: 32 bit start in microseconds and the thread switched to.
+ * A run ends where the next one starts, so a core's occupancy is stored run length encoded, and a switch to the thread already there stores nothing.
+ * The start wraps after ~71 minutes, it is unwrapped against the newest event seen which is fine as we only ever look at the last minute.
+ * The ring sizes come out of a fixed budget split over the cores (64 cores * 10s at 50k switches/s fits in 4 MB).
+ * Single writer (the event source's thread), any thread can read. The reader copies runs while the writer may be overwriting the oldest ones-
+ * -so it checks the write count again afterwards and throws away whatever got overwritten, no locks on either side.
+ * Thread ids are mapped to their process in a small fixed open addressing table, filled from thread start events (or a snapshot).
+ */
+class CTMCpuTimeline
+{
+public:
+    CTMCpuTimeline()  = default;
+    ~CTMCpuTimeline() = default;
+
+    //No need for copy or move operations
+    CTMCpuTimeline(const CTMCpuTimeline&)            = delete;
+    CTMCpuTimeline& operator=(const CTMCpuTimeline&) = delete;
+    CTMCpuTimeline(CTMCpuTimeline&&)                 = delete;
+    CTMCpuTimeline& operator=(CTMCpuTimeline&&)      = delete;
+
+public: //Writer functions (the event source's thread, one at a time)
+    //'core' switched to 'threadId' at 'timestamp' (QPC ticks). Ignored until the timeline is allocated
+    void RecordSwitch(std::uint32_t, ULONGLONG, DWORD);
+    //Thread started (or was already running when we started looking), its runs show up under this process
+    void SetThreadProcess(DWORD, DWORD);
+
+public: //Main functions
+    //Allocates the rings for that many cores, before anything gets written. Done once, the rings stay for as long as the app runs-
+    //-a writer could still be finishing a late buffer of switches after the provider was disabled
+    bool Allocate(std::uint32_t);
+    //Runs of one core overlapping [from, to), clipped to it, oldest first and appended to the vector. False if there is no such core
+    bool ReadCore(std::uint32_t, std::uint64_t, std::uint64_t, std::vector<CTMCoreOccupancy>&) const;
+    //0 if we never saw the thread start
+    DWORD FindProcessId(DWORD) const;
+
+public: //Getter functions
+    bool          IsAllocated()     const { return isAllocated.load(std::memory_order_acquire); }
+    std::uint32_t GetCoreCount()    const { return IsAllocated() ? coreCount : 0; }
+    std::size_t   GetRunsPerCore()  const { return IsAllocated() ? runsPerCore : 0; }
+    //Time of the newest switch, in microseconds since the timeline was allocated. Nothing after it is known yet, so views end here
+    std::uint64_t GetLatestMicros() const { return latestMicros.load(std::memory_order_acquire); }
+    std::uint64_t GetSwitchCount()  const { return switchCount.load(std::memory_order_relaxed); }
+    std::uint64_t GetStoredRuns()   const { return storedRuns.load(std::memory_order_relaxed); }
+    std::size_t   GetMemoryUsage()  const;
+
+private: //Helper functions
+    static std::uint64_t PackRun(std::uint32_t startMicros, DWORD threadId) { return (static_cast<std::uint64_t>(startMicros) << 32) | threadId; }
+    static std::uint64_t UnwrapMicros(std::uint32_t, std::uint64_t);
+    static std::size_t   HashThreadId(DWORD);
+
+private: //Per core rings
+    //Own cache line per core, the writer bumps these all the time
+    struct alignas(64) CTMCoreRing
+    {
+        std::atomic<std::uint64_t> writeCount   = 0; //Runs ever written, the next one goes to 'writeCount % runsPerCore'
+        std::uint64_t              lastMicros   = 0; //Writer only, start of the newest run
+        DWORD                      lastThreadId = 0; //Writer only
+        bool                       hasRun       = false;
+    };
+
+    std::unique_ptr<std::atomic<std::uint64_t>[]> runs; //'runsPerCore' per core back to back, start in the upper half and thread in the lower
+    std::unique_ptr<CTMCoreRing[]>                coreRings;
+    std::uint32_t                                 coreCount   = 0;
+    std::size_t                                   runsPerCore = 0;
+    std::atomic<bool>                             isAllocated = false;
+
+private: //Clock
+    LONGLONG                   qpcStart      = 0;
+    double                     microsPerTick = 0.0;
+    std::atomic<std::uint64_t> latestMicros  = 0;
+    std::atomic<std::uint64_t> switchCount   = 0; //Every switch, merged ones too (it is what the session had to carry)
+    std::atomic<std::uint64_t> storedRuns    = 0;
+
+private: //Thread -> process
+    //Thread ids in the upper half, pid in the lower. Threads come and go, so when a probe runs out the home slot gets overwritten
+    std::unique_ptr<std::atomic<std::uint64_t>[]> threadSlots;
+
+public: //Sizes
+    constexpr static std::size_t runBudget       = 1 << 19; //4 MB of runs, split over the cores
+    constexpr static std::size_t minRunsPerCore  = 1 << 13;
+    constexpr static std::size_t threadSlotCount = 1 << 15; //Power of two, 256 KB
+    constexpr static std::size_t maxThreadProbe  = 32;
+};
+
+//Written by whichever event source has the context switch provider enabled, read by the CPU screen
+extern CTMCpuTimeline globalCpuTimeline;
+
+#endif
@@ -0,0 +1,295 @@
+#include "ctm_dpc_latency_tracker.h"
+
+//Don't really want these macros, they are messing up the std::max and std::min functions
+#undef max
+#undef min
+
+//Init global variables
+CTMDpcLatencyTracker globalDpcLatencyTracker;
+
+CTMDpcLatencyTracker::CTMDpcLatencyTracker(std::uint32_t threshold)
+    : thresholdMicros(threshold)
+{
+    LARGE_INTEGER frequency;
+    if(QueryPerformanceFrequency(&frequency) && frequency.QuadPart > 0)
+        qpcFrequency = static_cast<ULONGLONG>(frequency.QuadPart);
+    maxDurationTicks = qpcFrequency;
+
+    aggregateBatch = std::make_unique<CTMDpcSample[]>(aggregateBatchSize);
+    coreCounters   = std::make_unique<CTMCoreCounters[]>(maxTrackedCores);
+    driverSlots    = std::make_unique<CTMDriverEntry[]>(maxTrackedDrivers);
+    ResetDriverSlots();
+}
+
+//--------------------WRITER FUNCTIONS--------------------
+void CTMDpcLatencyTracker::RecordRoutine(ULONGLONG timestamp, ULONGLONG startTimestamp, ULONGLONG routine, std::uint32_t core, CTMDpcKind kind)
+{
+    if(!isEnabled.load(std::memory_order_relaxed))
+        return;
+
+    std::size_t kindIndex = static_cast<std::size_t>(kind);
+    routineEvents[kindIndex].fetch_add(1, std::memory_order_relaxed);
+
+    //'InitialTime' is on the session's clock like the header's timestamp, anything else means it isn't what we think it is
+    if(startTimestamp > timestamp || timestamp - startTimestamp > maxDurationTicks)
+    {
+        badTimestamps.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    ULONGLONG     ticks          = timestamp - startTimestamp;
+    std::uint32_t durationMicros = static_cast<std::uint32_t>(ticks / qpcFrequency * 1000000 + ticks % qpcFrequency * 1000000 / qpcFrequency);
+
+    //Only this thread writes them, the UI reads whatever is there
+    if(core < maxTrackedCores)
+    {
+        CTMCoreCounters& counters = coreCounters[core];
+        counters.counts[kindIndex].fetch_add(1, std::memory_order_relaxed);
+        counters.micros[kindIndex].fetch_add(durationMicros, std::memory_order_relaxed);
+        if(core >= coresSeen.load(std::memory_order_relaxed))
+            coresSeen.store(core + 1, std::memory_order_relaxed);
+    }
+    else
+        untrackedCores.fetch_add(1, std::memory_order_relaxed);
+
+    CTMDpcSample sample;
+    sample.timestamp      = timestamp;
+    sample.routine        = routine;
+    sample.durationMicros = durationMicros;
+    sample.core           = static_cast<std::uint16_t>(std::min<std::uint32_t>(core, UINT16_MAX));
+    sample.kind           = kind;
+
+    //Counted before the push, so the aggregator never looks drained while a sample is on its way
+    publishedSamples.fetch_add(1, std::memory_order_release);
+    sampleRing.Push(sample);
+}
+
+//--------------------MAIN FUNCTIONS--------------------
+void CTMDpcLatencyTracker::SetDrivers(std::vector<CTMDriverModule> modules)
+{
+    std::sort(modules.begin(), modules.end(), [](const CTMDriverModule& left, const CTMDriverModule& right){
+        return left.baseAddress < right.baseAddress;
+    });
+
+    std::lock_guard<std::mutex> lock(trackerMutex);
+    driverModules = std::move(modules);
+    moduleSlots.assign(driverModules.size(), unassignedSlot);
+
+    //Same driver, same slot. Its new base (a reload) is all that changes
+    for(std::size_t i = 0; i < driverModules.size(); i++)
+        for(std::size_t slot = otherSlot + 1; slot < usedSlotCount; slot++)
+            if(driverSlots[slot].name == driverModules[i].name)
+            {
+                moduleSlots[i] = static_cast<std::uint8_t>(slot);
+                break;
+            }
+}
+
+void CTMDpcLatencyTracker::SetThreshold(std::uint32_t threshold)
+{
+    std::lock_guard<std::mutex> lock(trackerMutex);
+    if(threshold == thresholdMicros.load(std::memory_order_relaxed))
+        return;
+
+    thresholdMicros.store(threshold, std::memory_order_relaxed);
+    for(std::size_t slot = 0; slot < usedSlotCount; slot++)
+        driverSlots[slot].longCount = 0;
+    longEventCount = 0;
+}
+
+std::size_t CTMDpcLatencyTracker::AggregateSamples()
+{
+    std::size_t sampleCount = sampleRing.PopBatch(aggregateBatch.get(), aggregateBatchSize);
+    if(sampleCount == 0)
+        return 0;
+
+    {
+        std::lock_guard<std::mutex> lock(trackerMutex);
+        for(std::size_t i = 0; i < sampleCount; i++)
+            AddSample(aggregateBatch[i]);
+    }
+
+    aggregatedSamples.fetch_add(sampleCount, std::memory_order_release);
+    return sampleCount;
+}
+
+bool CTMDpcLatencyTracker::IsDrained() const
+{
+    //Same idea as the pipeline's, a popped batch can still be in the middle of being folded
+    return aggregatedSamples.load(std::memory_order_acquire) + sampleRing.GetDroppedCount() >= publishedSamples.load(std::memory_order_acquire);
+}
+
+void CTMDpcLatencyTracker::CollectDrivers(std::vector<CTMDriverDpcLatency>& outDrivers) const
+{
+    outDrivers.clear();
+
+    std::lock_guard<std::mutex> lock(trackerMutex);
+    for(std::size_t slot = 0; slot < usedSlotCount; slot++)
+    {
+        const CTMDriverEntry& entry = driverSlots[slot];
+        if(entry.dpcLatency.GetCount() == 0 && entry.isrLatency.GetCount() == 0)
+            continue;
+
+        CTMDriverDpcLatency& driver = outDrivers.emplace_back();
+        driver.name        = entry.name;
+        driver.totalMicros = entry.totalMicros;
+        driver.longCount   = entry.longCount;
+        driver.dpc = Summarize(entry.dpcLatency);
+        driver.isr = Summarize(entry.isrLatency);
+    }
+}
+
+void CTMDpcLatencyTracker::CollectLongEvents(std::vector<CTMLongDpcEvent>& outEvents) const
+{
+    outEvents.clear();
+
+    std::lock_guard<std::mutex> lock(trackerMutex);
+    std::uint64_t keptCount = std::min<std::uint64_t>(longEventCount, maxLongEvents);
+    for(std::uint64_t i = 0; i < keptCount; i++)
+    {
+        const CTMLongDpcRecord& record = longEvents[(longEventCount - 1 - i) % maxLongEvents];
+        CTMLongDpcEvent&        event  = outEvents.emplace_back();
+        event.driverName     = driverSlots[record.driverSlot].name;
+        event.timestamp      = record.timestamp;
+        event.durationMicros = record.durationMicros;
+        event.core           = record.core;
+        event.kind           = record.kind;
+    }
+}
+
+void CTMDpcLatencyTracker::GetCoreUsage(std::vector<CTMCoreDpcUsage>& outCores) const
+{
+    outCores.resize(coresSeen.load(std::memory_order_relaxed));
+    for(std::size_t core = 0; core < outCores.size(); core++)
+    {
+        const CTMCoreCounters& counters = coreCounters[core];
+        CTMCoreDpcUsage&       usage    = outCores[core];
+        usage.dpcCount  = counters.counts[static_cast<std::size_t>(CTMDpcKind::Dpc)].load(std::memory_order_relaxed);
+        usage.isrCount  = counters.counts[static_cast<std::size_t>(CTMDpcKind::Isr)].load(std::memory_order_relaxed);
+        usage.dpcMicros = counters.micros[static_cast<std::size_t>(CTMDpcKind::Dpc)].load(std::memory_order_relaxed);
+        usage.isrMicros = counters.micros[static_cast<std::size_t>(CTMDpcKind::Isr)].load(std::memory_order_relaxed);
+    }
+}
+
+void CTMDpcLatencyTracker::GetSystemSummary(CTMLatencySummary& outDpc, CTMLatencySummary& outIsr) const
+{
+    //~3.5 KB on the stack, once a second
+    CTMLatencyHistogram mergedDpc, mergedIsr;
+    {
+        std::lock_guard<std::mutex> lock(trackerMutex);
+        for(std::size_t slot = 0; slot < usedSlotCount; slot++)
+        {
+            mergedDpc.Merge(driverSlots[slot].dpcLatency);
+            mergedIsr.Merge(driverSlots[slot].isrLatency);
+        }
+    }
+
+    outDpc = Summarize(mergedDpc);
+    outIsr = Summarize(mergedIsr);
+}
+
+CTMDpcLatencyStats CTMDpcLatencyTracker::GetStats() const
+{
+    CTMDpcLatencyStats stats;
+    stats.dpcEvents      = routineEvents[static_cast<std::size_t>(CTMDpcKind::Dpc)].load(std::memory_order_relaxed);
+    stats.isrEvents      = routineEvents[static_cast<std::size_t>(CTMDpcKind::Isr)].load(std::memory_order_relaxed);
+    stats.badTimestamps  = badTimestamps.load(std::memory_order_relaxed);
+    stats.ringDrops      = sampleRing.GetDroppedCount();
+    stats.untrackedCores = untrackedCores.load(std::memory_order_relaxed);
+    stats.memoryUsage    = sampleRing.GetCapacity() * sizeof(CTMDpcSample) + aggregateBatchSize * sizeof(CTMDpcSample) +
+                           maxTrackedCores * sizeof(CTMCoreCounters) + maxTrackedDrivers * sizeof(CTMDriverEntry) + sizeof(longEvents);
+
+    std::lock_guard<std::mutex> lock(trackerMutex);
+    for(std::size_t slot = 0; slot < usedSlotCount; slot++)
+        stats.longEvents += driverSlots[slot].longCount;
+    stats.unknownRoutines = unknownRoutines;
+    stats.driverCount     = driverModules.size();
+    stats.trackedDrivers  = usedSlotCount - (otherSlot + 1);
+    return stats;
+}
+
+void CTMDpcLatencyTracker::Clear()
+{
+    {
+        std::lock_guard<std::mutex> lock(trackerMutex);
+        ResetDriverSlots();
+        std::fill(moduleSlots.begin(), moduleSlots.end(), unassignedSlot);
+        longEventCount  = 0;
+        unknownRoutines = 0;
+    }
+
+    //The writer may bump one of these while we clear them, that run just stays counted
+    for(std::size_t core = 0; core < maxTrackedCores; core++)
+        for(std::size_t kindIndex = 0; kindIndex < static_cast<std::size_t>(CTMDpcKind::Count); kindIndex++)
+        {
+            coreCounters[core].counts[kindIndex].store(0, std::memory_order_relaxed);
+            coreCounters[core].micros[kindIndex].store(0, std::memory_order_relaxed);
+        }
+    coresSeen.store(0, std::memory_order_relaxed);
+}
+
+//--------------------HELPER FUNCTIONS--------------------
+std::uint8_t CTMDpcLatencyTracker::FindDriverSlot(ULONGLONG routine)
+{
+    //Module sizes aren't known, but modules don't overlap, so a routine belongs to the last module starting at or below it
+    auto it = std::upper_bound(driverModules.begin(), driverModules.end(), routine, [](ULONGLONG address, const CTMDriverModule& module){
+        return address < module.baseAddress;
+    });
+    if(it == driverModules.begin())
+    {
+        ++unknownRoutines;
+        return unknownSlot;
+    }
+
+    std::size_t   moduleIndex = static_cast<std::size_t>(it - driverModules.begin()) - 1;
+    std::uint8_t& slot        = moduleSlots[moduleIndex];
+    if(slot != unassignedSlot)
+        return slot;
+
+    //First run of this driver, a free slot if there is one left. Only happens once per driver, so the name copy is fine here
+    if(usedSlotCount >= maxTrackedDrivers)
+    {
+        slot = otherSlot;
+        return slot;
+    }
+
+    slot = static_cast<std::uint8_t>(usedSlotCount++);
+    driverSlots[slot].name = driverModules[moduleIndex].name;
+    return slot;
+}
+
+void CTMDpcLatencyTracker::AddSample(const CTMDpcSample& sample)
+{
+    CTMDriverEntry& driver = driverSlots[FindDriverSlot(sample.routine)];
+    (sample.kind == CTMDpcKind::Isr ? driver.isrLatency : driver.dpcLatency).Record(sample.durationMicros);
+    driver.totalMicros += sample.durationMicros;
+
+    if(sample.durationMicros < thresholdMicros.load(std::memory_order_relaxed))
+        return;
+
+    ++driver.longCount;
+    CTMLongDpcRecord& record = longEvents[longEventCount % maxLongEvents];
+    record.timestamp      = sample.timestamp;
+    record.durationMicros = sample.durationMicros;
+    record.core           = sample.core;
+    record.driverSlot     = static_cast<std::uint8_t>(&driver - driverSlots.get());
+    record.kind           = sample.kind;
+    ++longEventCount;
+}
+
+void CTMDpcLatencyTracker::ResetDriverSlots()
+{
+    for(std::size_t slot = 0; slot < maxTrackedDrivers; slot++)
+    {
+        CTMDriverEntry& entry = driverSlots[slot];
+        entry.dpcLatency.Clear();
+        entry.isrLatency.Clear();
+        entry.name.clear();
+        entry.totalMicros = 0;
+        entry.longCount   = 0;
+    }
+
+    driverSlots[unknownSlot].name = "Unknown";
+    driverSlots[otherSlot].name   = "Other drivers";
+    usedSlotCount                 = otherSlot + 1;
+}
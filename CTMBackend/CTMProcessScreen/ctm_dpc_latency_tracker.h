@@ -0,0 +1,210 @@
+#ifndef CTM_DPC_LATENCY_TRACKER_HPP
+#define CTM_DPC_LATENCY_TRACKER_HPP
+
+//Windows stuff
+#include <windows.h>
+//My stuff
+#include "../CTMPureHeaderFiles/ctm_latency_histogram.h"
+#include "../CTMPureHeaderFiles/ctm_spsc_ring.h"
+//Stdlib stuff
+#include <vector>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <cstdint>
+
+//What ran, the classic PerfInfo opcodes tell them apart (threaded and timer DPCs count as DPCs)
+enum class CTMDpcKind : std::uint8_t
+{
+    Dpc,
+    Isr, //Line based and MSI interrupts alike
+    Count
+};
+
+//One DPC/ISR run as the event thread hands it to the aggregator
+struct CTMDpcSample
+{
+    //Perfect 8 byte alignment
+    ULONGLONG     timestamp      = 0; //QPC ticks, when it returned
+    ULONGLONG     routine        = 0; //Address of the routine, the driver is the module it lives in
+    std::uint32_t durationMicros = 0;
+    std::uint16_t core           = 0;
+    CTMDpcKind    kind           = CTMDpcKind::Dpc;
+};
+
+//Kernel module the routines are looked up in
+struct CTMDriverModule
+{
+    ULONGLONG   baseAddress = 0;
+    std::string name;        //Base name, like 'ndis.sys'
+};
+
+//Every routine of one driver merged
+struct CTMDriverDpcLatency
+{
+    std::string       name;
+    CTMLatencySummary dpc;
+    CTMLatencySummary isr;
+    std::uint64_t     totalMicros = 0; //Time its DPCs and ISRs kept a core from running threads
+    std::uint64_t     longCount   = 0; //Runs at or above the threshold, since it was last set
+};
+
+//Run at or above the threshold, newest ones are kept
+struct CTMLongDpcEvent
+{
+    std::string   driverName;
+    ULONGLONG     timestamp      = 0; //QPC ticks, when it returned
+    std::uint32_t durationMicros = 0;
+    std::uint32_t core           = 0;
+    CTMDpcKind    kind           = CTMDpcKind::Dpc;
+};
+
+//One logical processor, cumulative
+struct CTMCoreDpcUsage
+{
+    std::uint64_t dpcCount  = 0;
+    std::uint64_t isrCount  = 0;
+    std::uint64_t dpcMicros = 0;
+    std::uint64_t isrMicros = 0;
+};
+
+//Health of the event path, everything is cumulative
+struct CTMDpcLatencyStats
+{
+    std::uint64_t dpcEvents       = 0;
+    std::uint64_t isrEvents       = 0;
+    std::uint64_t longEvents      = 0; //At or above the threshold, since it was last set
+    std::uint64_t badTimestamps   = 0; //Started after they returned or ran for longer than a second, thrown away
+    std::uint64_t ringDrops       = 0; //Samples the aggregator didn't pick up in time
+    std::uint64_t unknownRoutines = 0; //Below every module we know of, they show up as 'Unknown'
+    std::uint64_t untrackedCores  = 0; //Runs on cores past 'maxTrackedCores', only the per core numbers miss them
+    std::size_t   driverCount     = 0; //Modules the routines are looked up in
+    std::size_t   trackedDrivers  = 0; //Ones which had a routine run
+    std::size_t   memoryUsage     = 0; //Bytes, fixed at construction
+};
+
+/*
+ * How long DPCs and ISRs run, per driver, from the kernel's DPC/interrupt events (or the synthetic source).
+ * Every event carries when its routine started and the event itself is logged when it returned, so one event is one duration, no matching.
+ * The event thread only works the duration out, bumps the per core counters and pushes a 24 byte sample into an SPSC ring: no locks, no allocations.
+ * The aggregator thread (check ctm_usage_event_pipeline.h) finds the module the routine lives in with a binary search over the module bases-
+ * -and folds the sample into that driver's DPC or ISR histogram. Drivers get one of a fixed set of slots the first time one of their routines runs,
+ * past that they share an 'Other drivers' slot. Runs at or above the threshold are counted per driver and the newest of them kept for the UI.
+ * Whoever enables the events hands over the module list (check 'SetDrivers'), drivers loaded after that show up as 'Unknown' until it is enabled again.
+ */
+class CTMDpcLatencyTracker
+{
+public:
+    CTMDpcLatencyTracker(std::uint32_t = 500);
+    ~CTMDpcLatencyTracker() = default;
+
+    //No need for copy or move operations
+    CTMDpcLatencyTracker(const CTMDpcLatencyTracker&)            = delete;
+    CTMDpcLatencyTracker& operator=(const CTMDpcLatencyTracker&) = delete;
+    CTMDpcLatencyTracker(CTMDpcLatencyTracker&&)                 = delete;
+    CTMDpcLatencyTracker& operator=(CTMDpcLatencyTracker&&)      = delete;
+
+public: //Writer functions (the event source's thread, one at a time)
+    //'routine' started at 'startTimestamp' and returned at 'timestamp' (QPC ticks) on 'core'. Ignored while disabled
+    void RecordRoutine(ULONGLONG, ULONGLONG, ULONGLONG, std::uint32_t, CTMDpcKind);
+    //True if the next sample would be dropped, for sources which would rather wait (benchmarks)
+    bool IsRingFull() const { return sampleRing.GetSize() >= sampleRing.GetCapacity(); }
+
+public: //Main functions
+    void SetEnabled(bool shouldEnable) { isEnabled.store(shouldEnable, std::memory_order_release); }
+    //By whoever enables the events, before it does. Drivers which had samples keep them (matched by name)
+    void SetDrivers(std::vector<CTMDriverModule>);
+    //Microseconds, counting starts over from here
+    void SetThreshold(std::uint32_t);
+    //Aggregator thread, folds whatever the ring has. Returns how many samples it took
+    std::size_t AggregateSamples();
+    //True once every sample published so far was either folded in or dropped
+    bool IsDrained() const;
+    //Every driver which had a routine run, in no particular order
+    void CollectDrivers(std::vector<CTMDriverDpcLatency>&) const;
+    //Newest first, atmost 'maxLongEvents'
+    void CollectLongEvents(std::vector<CTMLongDpcEvent>&) const;
+    //Up to the highest core anything ran on
+    void GetCoreUsage(std::vector<CTMCoreDpcUsage>&) const;
+    //Every driver merged
+    void GetSystemSummary(CTMLatencySummary&, CTMLatencySummary&) const;
+    CTMDpcLatencyStats GetStats() const;
+    void Clear();
+
+public: //Getter functions
+    bool          IsEnabled()    const { return isEnabled.load(std::memory_order_relaxed); }
+    std::uint32_t GetThreshold() const { return thresholdMicros.load(std::memory_order_relaxed); }
+
+public: //Sizes
+    constexpr static std::size_t   maxTrackedDrivers = 128; //Two of them are 'Unknown' and 'Other drivers'
+    constexpr static std::size_t   maxTrackedCores   = 256;
+    constexpr static std::size_t   maxLongEvents     = 256;
+
+private: //Helper functions
+    struct CTMDriverEntry
+    {
+        CTMLatencyHistogram dpcLatency;
+        CTMLatencyHistogram isrLatency;
+        std::string         name;
+        std::uint64_t       totalMicros = 0;
+        std::uint64_t       longCount   = 0;
+    };
+
+    struct CTMLongDpcRecord
+    {
+        //Perfect 8 byte alignment
+        ULONGLONG     timestamp      = 0;
+        std::uint32_t durationMicros = 0;
+        std::uint16_t core           = 0;
+        std::uint8_t  driverSlot     = 0;
+        CTMDpcKind    kind           = CTMDpcKind::Dpc;
+    };
+
+    struct alignas(64) CTMCoreCounters
+    {
+        std::atomic<std::uint64_t> counts[static_cast<std::size_t>(CTMDpcKind::Count)] = {};
+        std::atomic<std::uint64_t> micros[static_cast<std::size_t>(CTMDpcKind::Count)] = {};
+    };
+
+    std::uint8_t  FindDriverSlot(ULONGLONG);
+    void          AddSample(const CTMDpcSample&);
+    void          ResetDriverSlots();
+
+private: //Event thread -> aggregator thread
+    CTMSpscRing<CTMDpcSample>       sampleRing{sampleRingCapacity};
+    std::unique_ptr<CTMDpcSample[]> aggregateBatch;
+    std::unique_ptr<CTMCoreCounters[]> coreCounters;
+    std::atomic<bool>               isEnabled         = false;
+    std::atomic<std::uint32_t>      thresholdMicros   = 0;
+    std::atomic<std::uint32_t>      coresSeen         = 0; //Highest core anything ran on + 1
+    std::atomic<std::uint64_t>      routineEvents[static_cast<std::size_t>(CTMDpcKind::Count)] = {};
+    std::atomic<std::uint64_t>      badTimestamps     = 0;
+    std::atomic<std::uint64_t>      untrackedCores    = 0;
+    std::atomic<std::uint64_t>      publishedSamples  = 0;
+    std::atomic<std::uint64_t>      aggregatedSamples = 0;
+    ULONGLONG                       qpcFrequency      = 1;
+    ULONGLONG                       maxDurationTicks  = 0; //A second, a DPC can't run that long without the watchdog bugchecking
+    //~384 KB, a third of a second at 50k DPCs/s (the aggregator looks every millisecond)
+    constexpr static std::size_t    sampleRingCapacity = 1 << 14;
+    constexpr static std::size_t    aggregateBatchSize = 1024;
+
+private: //Drivers, aggregator thread writes and the UI reads
+    std::vector<CTMDriverModule> driverModules;    //Sorted by base address
+    std::vector<std::uint8_t>    moduleSlots;      //Same order as 'driverModules', 'unassignedSlot' until one of its routines runs
+    std::unique_ptr<CTMDriverEntry[]> driverSlots; //'maxTrackedDrivers' of them, ~3.5 KB each
+    std::size_t                  usedSlotCount    = 0;
+    CTMLongDpcRecord             longEvents[maxLongEvents];
+    std::uint64_t                longEventCount   = 0; //Ever kept, the next one goes to 'longEventCount % maxLongEvents'
+    std::uint64_t                unknownRoutines  = 0;
+    mutable std::mutex           trackerMutex;
+    constexpr static std::uint8_t unknownSlot     = 0;
+    constexpr static std::uint8_t otherSlot       = 1;
+    constexpr static std::uint8_t unassignedSlot  = 0xFF;
+};
+
+//Written by whichever event source has the DPC/ISR provider enabled, read by the DPC/ISR screen
+extern CTMDpcLatencyTracker globalDpcLatencyTracker;
+
+#endif
@@ -0,0 +1,60 @@
+#include "ctm_etw_buffer_policy.h"
+
+//--------------------PUBLIC FUNCTIONS--------------------
+CTMEtwBufferSizing CTMEtwBufferPolicy::Compute(std::uint32_t logicalProcessors, const CTMEtwBufferSettings& settings)
+{
+    std::uint32_t processorCount = std::max<std::uint32_t>(logicalProcessors, 1);
+    double        eventRate      = settings.expectedEventRate > 0.0 ? settings.expectedEventRate : defaultEventRate;
+    CTMEtwBufferSizing sizing;
+
+    //Every CPU needs one to write into and one being handed off
+    std::uint32_t cpuMinimum = processorCount * buffersPerCpu;
+    sizing.minimumBuffers    = settings.minimumBuffers > 0 ? std::max(settings.minimumBuffers, cpuMinimum) : cpuMinimum;
+
+    //Busy CPUs get bigger buffers (fewer hand offs), quiet ones don't waste memory. Power of two, one CPU fills it in about 'bufferFillSeconds'.
+    //The minimum is allocated up front, so with a lot of CPUs it can't take more than a quarter of the cap
+    if(settings.bufferSizeKB > 0)
+        sizing.bufferSizeKB = std::clamp<std::uint32_t>(settings.bufferSizeKB, 4, maxBufferSizeKB);
+    else
+    {
+        double kiloBytesPerFill = eventRate / processorCount * averageEventBytes * bufferFillSeconds / 1024.0;
+        sizing.bufferSizeKB = minBufferSizeKB;
+        while(sizing.bufferSizeKB < maxBufferSizeKB && sizing.bufferSizeKB < kiloBytesPerFill &&
+              sizing.bufferSizeKB * 2 * sizing.minimumBuffers <= maxSessionMemoryMB * 1024 / 4)
+            sizing.bufferSizeKB *= 2;
+    }
+
+    //Room for a burst on top of the minimum, but never more than the memory cap (unless the minimum alone is more)
+    if(settings.maximumBuffers > 0)
+        sizing.maximumBuffers = settings.maximumBuffers;
+    else
+        sizing.maximumBuffers = std::min(sizing.minimumBuffers + BuffersForRate(sizing.bufferSizeKB, eventRate), MemoryCapBuffers(sizing.bufferSizeKB));
+    sizing.maximumBuffers = std::max(sizing.maximumBuffers, sizing.minimumBuffers + processorCount);
+
+    sizing.flushTimerSeconds = settings.flushTimerSeconds > 0 ? settings.flushTimerSeconds : defaultFlushTimer;
+    return sizing;
+}
+
+std::uint32_t CTMEtwBufferPolicy::GrowMaximumBuffers(const CTMEtwBufferSizing& sizing, double observedEventRate, bool isLosingEvents)
+{
+    std::uint32_t memoryCap = std::max(MemoryCapBuffers(sizing.bufferSizeKB), sizing.maximumBuffers);
+    std::uint32_t needed    = sizing.minimumBuffers + BuffersForRate(sizing.bufferSizeKB, observedEventRate);
+
+    //Whatever the rate says wasn't enough, half again on top of what we have
+    if(isLosingEvents)
+        needed = std::max(needed, sizing.maximumBuffers + sizing.maximumBuffers / 2);
+
+    return std::max(sizing.maximumBuffers, std::min(needed, memoryCap));
+}
+
+//--------------------HELPER FUNCTIONS--------------------
+std::uint32_t CTMEtwBufferPolicy::BuffersForRate(std::uint32_t bufferSizeKB, double eventRate)
+{
+    double burstKiloBytes = std::max(eventRate, 0.0) * averageEventBytes * burstSeconds / 1024.0;
+    return static_cast<std::uint32_t>(std::ceil(burstKiloBytes / bufferSizeKB));
+}
+
+std::uint32_t CTMEtwBufferPolicy::MemoryCapBuffers(std::uint32_t bufferSizeKB)
+{
+    return (maxSessionMemoryMB * 1024) / bufferSizeKB;
+}
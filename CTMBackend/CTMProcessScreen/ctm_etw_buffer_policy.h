@@ -0,0 +1,64 @@
+#ifndef CTM_ETW_BUFFER_POLICY_HPP
+#define CTM_ETW_BUFFER_POLICY_HPP
+
+//Stdlib stuff
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+//What the user picked in the settings screen, 0 for anything -> sized automatically
+struct CTMEtwBufferSettings
+{
+    //Perfect 8 byte alignment
+    double        expectedEventRate = 0.0; //Events per second the session should keep up with, highest rate seen on earlier runs
+    std::uint32_t bufferSizeKB      = 0;
+    std::uint32_t minimumBuffers    = 0;
+    std::uint32_t maximumBuffers    = 0;
+    std::uint32_t flushTimerSeconds = 0;
+};
+
+//What the session gets, straight into EVENT_TRACE_PROPERTIES
+struct CTMEtwBufferSizing
+{
+    std::uint32_t bufferSizeKB      = 0;
+    std::uint32_t minimumBuffers    = 0;
+    std::uint32_t maximumBuffers    = 0;
+    std::uint32_t flushTimerSeconds = 0;
+
+    bool operator==(const CTMEtwBufferSizing& other) const
+    {
+        return bufferSizeKB == other.bufferSizeKB && minimumBuffers == other.minimumBuffers &&
+               maximumBuffers == other.maximumBuffers && flushTimerSeconds == other.flushTimerSeconds;
+    }
+};
+
+/*
+ * Buffer sizing of the real time session, no Windows calls in here so it can be checked on its own.
+ * The kernel writes events into per CPU buffers and hands full ones to us, if every buffer is full before we get to them it throws events away.
+ * So the buffers have to hold a burst of a couple of seconds at the rate we expect, spread over every CPU, without going past a memory cap.
+ * Buffer size and minimum can only be picked when the session starts, the maximum can be raised while it runs (check 'GrowMaximumBuffers').
+ */
+class CTMEtwBufferPolicy
+{
+public:
+    static CTMEtwBufferSizing Compute(std::uint32_t, const CTMEtwBufferSettings&);
+    //New maximum for a running session at the observed rate, never lower than the current one. Losing events means the last guess was too low
+    static std::uint32_t      GrowMaximumBuffers(const CTMEtwBufferSizing&, double, bool);
+
+private: //Helper functions
+    static std::uint32_t BuffersForRate(std::uint32_t, double);
+    static std::uint32_t MemoryCapBuffers(std::uint32_t);
+
+public: //Policy constants
+    constexpr static double        defaultEventRate   = 20000.0; //Nothing seen yet, a busy desktop
+    constexpr static double        averageEventBytes  = 128.0;   //Network and file events with their header, a bit on the big side
+    constexpr static double        burstSeconds       = 2.0;     //How long the buffers have to hold events if nobody takes them
+    constexpr static double        bufferFillSeconds  = 0.1;     //Auto buffer size fills in about this long on one CPU
+    constexpr static std::uint32_t minBufferSizeKB    = 64;
+    constexpr static std::uint32_t maxBufferSizeKB    = 1024;    //Largest the kernel takes
+    constexpr static std::uint32_t buffersPerCpu      = 2;       //Kernel never goes below this many anyway
+    constexpr static std::uint32_t maxSessionMemoryMB = 256;
+    constexpr static std::uint32_t defaultFlushTimer  = 1;       //Seconds, without it a quiet CPU's events wait until its buffer fills
+};
+
+#endif
@@ -0,0 +1,221 @@
+#include "ctm_event_schema_cache.h"
+
+//Don't really want these macros, they are messing up the std::max and std::min functions
+#undef max
+#undef min
+
+CTMEventSchemaCache::CTMEventSchemaCache(std::initializer_list<LPCWSTR> names) : fieldNames(names) {}
+
+//--------------------MAIN FUNCTIONS--------------------
+bool CTMEventSchemaCache::ReadFields(PEVENT_RECORD eventRecord, ULONGLONG* outValues)
+{
+    const CTMEventSchema& schema = FindOrResolveSchema(eventRecord);
+    if(!schema.isValid)
+        return false;
+
+    //Fast path, the whole thing is a handful of memcpy's
+    if(schema.isAllFixed && DecodeFixedFields(schema, static_cast<const BYTE*>(eventRecord->UserData), eventRecord->UserDataLength, outValues))
+        return true;
+
+    //Variable layout (or a payload shorter than the schema says), go field by field and let TDH handle what we can't
+    tdhFallbackCount.fetch_add(1, std::memory_order_relaxed);
+    for(std::size_t i = 0; i < schema.fields.size(); i++)
+    {
+        const CTMEventSchemaField& field = schema.fields[i];
+        outValues[i] = 0;
+
+        if(field.isFixed && field.offset + field.size <= eventRecord->UserDataLength)
+            std::memcpy(&outValues[i], static_cast<const BYTE*>(eventRecord->UserData) + field.offset, std::min<USHORT>(field.size, sizeof(ULONGLONG)));
+        else if(!ReadFieldWithTdh(eventRecord, i, outValues[i]))
+            outValues[i] = 0;
+    }
+
+    return true;
+}
+
+bool CTMEventSchemaCache::DecodeFixedFields(const CTMEventSchema& schema, const BYTE* userData, USHORT userDataLength, ULONGLONG* outValues)
+{
+    for(std::size_t i = 0; i < schema.fields.size(); i++)
+    {
+        const CTMEventSchemaField& field = schema.fields[i];
+        if(!field.isFixed || field.offset + field.size > userDataLength)
+            return false;
+
+        //Little endian, smaller fields only fill the lower bytes
+        outValues[i] = 0;
+        std::memcpy(&outValues[i], userData + field.offset, std::min<USHORT>(field.size, sizeof(ULONGLONG)));
+    }
+
+    return true;
+}
+
+USHORT CTMEventSchemaCache::ReadFieldBytes(PEVENT_RECORD eventRecord, std::size_t fieldIndex, BYTE* outBytes, USHORT outSize)
+{
+    const CTMEventSchema& schema = FindOrResolveSchema(eventRecord);
+    if(!schema.isValid || fieldIndex >= schema.fields.size())
+        return 0;
+
+    const CTMEventSchemaField& field = schema.fields[fieldIndex];
+    if(field.isFixed && field.size <= outSize && field.offset + field.size <= eventRecord->UserDataLength)
+    {
+        std::memcpy(outBytes, static_cast<const BYTE*>(eventRecord->UserData) + field.offset, field.size);
+        return field.size;
+    }
+
+    //Variable layout, TDH it is
+    PROPERTY_DATA_DESCRIPTOR propertyData = {};
+    propertyData.PropertyName = reinterpret_cast<ULONGLONG>(fieldNames[fieldIndex]);
+    propertyData.ArrayIndex   = 0;
+
+    ULONG propertySize = 0;
+    if(TdhGetPropertySize(eventRecord, 0, nullptr, 1, &propertyData, &propertySize) != ERROR_SUCCESS || propertySize == 0 || propertySize > outSize)
+        return 0;
+
+    tdhFallbackCount.fetch_add(1, std::memory_order_relaxed);
+    if(TdhGetProperty(eventRecord, 0, nullptr, 1, &propertyData, propertySize, outBytes) != ERROR_SUCCESS)
+        return 0;
+    return static_cast<USHORT>(propertySize);
+}
+
+//--------------------HELPER FUNCTIONS--------------------
+const CTMEventSchema& CTMEventSchemaCache::FindOrResolveSchema(PEVENT_RECORD eventRecord)
+{
+    CTMEventSchemaKey key;
+    key.providerId  = eventRecord->EventHeader.ProviderId;
+    key.eventId     = eventRecord->EventHeader.EventDescriptor.Id;
+    key.version     = eventRecord->EventHeader.EventDescriptor.Version;
+    key.pointerSize = (eventRecord->EventHeader.Flags & EVENT_HEADER_FLAG_32_BIT_HEADER) ? 4 : 8;
+
+    if(lastSchema && key == lastKey)
+        return *lastSchema;
+
+    auto it = schemaMap.find(key);
+    if(it == schemaMap.end())
+    {
+        it = schemaMap.emplace(key, CTMEventSchema{}).first;
+        ResolveSchema(eventRecord, it->second);
+    }
+
+    //Map nodes don't move on insert, so the pointer stays good
+    lastKey    = key;
+    lastSchema = &it->second;
+    return it->second;
+}
+
+void CTMEventSchemaCache::ResolveSchema(PEVENT_RECORD eventRecord, CTMEventSchema& schema)
+{
+    schema.fields.assign(fieldNames.size(), CTMEventSchemaField{});
+
+    ULONG status = TdhGetEventInformation(eventRecord, 0, nullptr, reinterpret_cast<PTRACE_EVENT_INFO>(eventInfoBuffer.get()), &eventInfoBufferSize);
+    if(status == ERROR_INSUFFICIENT_BUFFER)
+    {
+        eventInfoBuffer = std::make_unique<BYTE[]>(eventInfoBufferSize);
+        status = TdhGetEventInformation(eventRecord, 0, nullptr, reinterpret_cast<PTRACE_EVENT_INFO>(eventInfoBuffer.get()), &eventInfoBufferSize);
+    }
+
+    //Cached as invalid too, no point asking TDH again for every event of this kind
+    if(status != ERROR_SUCCESS)
+    {
+        CTM_LOG_ERROR("Failed to get event schema for event id: ", eventRecord->EventHeader.EventDescriptor.Id, ". Error code: ", status);
+        return;
+    }
+
+    PTRACE_EVENT_INFO eventInfo   = reinterpret_cast<PTRACE_EVENT_INFO>(eventInfoBuffer.get());
+    USHORT            pointerSize = (eventRecord->EventHeader.Flags & EVENT_HEADER_FLAG_32_BIT_HEADER) ? 4 : 8;
+    USHORT            offset      = 0;
+    bool              isOffsetKnown = !(eventRecord->EventHeader.Flags & EVENT_HEADER_FLAG_STRING_ONLY);
+
+    //Top level properties are laid out back to back, so the offset is known until the first one of variable size
+    for(ULONG i = 0; i < eventInfo->TopLevelPropertyCount; i++)
+    {
+        const EVENT_PROPERTY_INFO& propertyInfo = eventInfo->EventPropertyInfoArray[i];
+        LPCWSTR propNameW = reinterpret_cast<LPCWSTR>(reinterpret_cast<PBYTE>(eventInfo) + propertyInfo.NameOffset);
+
+        USHORT propertySize = 0;
+        bool   isFixedSize  = !(propertyInfo.Flags & (PropertyStruct | PropertyParamLength | PropertyParamCount));
+        if(isFixedSize)
+        {
+            propertySize = GetFixedInTypeSize(propertyInfo.nonStructType.InType, pointerSize);
+            //Binary blobs with a length baked into the manifest are fixed as well
+            if(propertySize == 0 && propertyInfo.nonStructType.InType == TDH_INTYPE_BINARY)
+                propertySize = propertyInfo.length;
+            propertySize = static_cast<USHORT>(propertySize * (propertyInfo.count > 1 ? propertyInfo.count : 1));
+            isFixedSize  = propertySize > 0;
+        }
+
+        for(std::size_t field = 0; field < fieldNames.size(); field++)
+        {
+            if(wcscmp(propNameW, fieldNames[field]) != 0)
+                continue;
+
+            schema.fields[field].offset  = offset;
+            schema.fields[field].size    = propertySize;
+            schema.fields[field].isFixed = isOffsetKnown && isFixedSize;
+        }
+
+        if(!isFixedSize)
+            isOffsetKnown = false;
+        offset = static_cast<USHORT>(offset + propertySize);
+    }
+
+    schema.isValid    = true;
+    schema.isAllFixed = true;
+    for(auto&& field : schema.fields)
+        schema.isAllFixed = schema.isAllFixed && field.isFixed;
+}
+
+bool CTMEventSchemaCache::ReadFieldWithTdh(PEVENT_RECORD eventRecord, std::size_t fieldIndex, ULONGLONG& outValue)
+{
+    PROPERTY_DATA_DESCRIPTOR propertyData = {};
+    propertyData.PropertyName = reinterpret_cast<ULONGLONG>(fieldNames[fieldIndex]);
+    propertyData.ArrayIndex   = 0;
+
+    ULONG propertySize = 0;
+    if(TdhGetPropertySize(eventRecord, 0, nullptr, 1, &propertyData, &propertySize) != ERROR_SUCCESS || propertySize == 0 ||
+       propertySize > sizeof(ULONGLONG))
+        return false;
+
+    return TdhGetProperty(eventRecord, 0, nullptr, 1, &propertyData, propertySize, reinterpret_cast<PBYTE>(&outValue)) == ERROR_SUCCESS;
+}
+
+USHORT CTMEventSchemaCache::GetFixedInTypeSize(USHORT inType, USHORT pointerSize)
+{
+    switch(inType)
+    {
+        case TDH_INTYPE_INT8:
+        case TDH_INTYPE_UINT8:
+        case TDH_INTYPE_ANSICHAR:
+            return 1;
+
+        case TDH_INTYPE_INT16:
+        case TDH_INTYPE_UINT16:
+        case TDH_INTYPE_UNICODECHAR:
+            return 2;
+
+        case TDH_INTYPE_INT32:
+        case TDH_INTYPE_UINT32:
+        case TDH_INTYPE_HEXINT32:
+        case TDH_INTYPE_BOOLEAN:
+        case TDH_INTYPE_FLOAT:
+            return 4;
+
+        case TDH_INTYPE_INT64:
+        case TDH_INTYPE_UINT64:
+        case TDH_INTYPE_HEXINT64:
+        case TDH_INTYPE_DOUBLE:
+        case TDH_INTYPE_FILETIME:
+            return 8;
+
+        case TDH_INTYPE_GUID:
+        case TDH_INTYPE_SYSTEMTIME:
+            return 16;
+
+        case TDH_INTYPE_POINTER:
+        case TDH_INTYPE_SIZET:
+            return pointerSize;
+
+        //Strings, SIDs and friends, size depends on the payload
+        default:
+            return 0;
+    }
+}
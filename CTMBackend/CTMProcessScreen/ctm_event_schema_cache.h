@@ -0,0 +1,114 @@
+#ifndef CTM_EVENT_SCHEMA_CACHE_HPP
+#define CTM_EVENT_SCHEMA_CACHE_HPP
+
+//Windows stuff
+#include <windows.h>
+#include <evntrace.h>
+#include <tdh.h>
+//My stuff
+#include "../CTMPureHeaderFiles/ctm_logger.h"
+//Stdlib stuff
+#include <unordered_map>
+#include <initializer_list>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+
+//Where one of the requested fields lives inside 'UserData' of an event
+struct CTMEventSchemaField
+{
+    USHORT offset  = 0;
+    USHORT size    = 0;     //Bytes, numbers only read the first 8 of them (addresses can be bigger)
+    bool   isFixed = false; //False -> something of variable size comes before it (or it is not there at all), ask TDH
+};
+
+//Resolved once per (provider, event id, version), every event after that is decoded from it
+struct CTMEventSchema
+{
+    std::vector<CTMEventSchemaField> fields;              //Same order as the field names given to the cache
+    bool                             isValid    = false;  //TDH couldn't describe the event, skip it
+    bool                             isAllFixed = false;  //Every field has a fixed offset, no TDH at all
+};
+
+//Pointer size is part of the key, the same event from a 32 bit process has a different layout
+struct CTMEventSchemaKey
+{
+    GUID   providerId;
+    USHORT eventId;
+    UCHAR  version;
+    UCHAR  pointerSize;
+
+    bool operator==(const CTMEventSchemaKey& other) const
+    {
+        return eventId == other.eventId && version == other.version && pointerSize == other.pointerSize &&
+               InlineIsEqualGUID(providerId, other.providerId);
+    }
+};
+
+struct CTMEventSchemaKeyHash
+{
+    std::size_t operator()(const CTMEventSchemaKey& key) const
+    {
+        //Data1 is plenty to tell providers apart, the rest is mixed in so a provider's events don't collide
+        std::uint64_t hash = (static_cast<std::uint64_t>(key.providerId.Data1) << 32) ^
+                             (static_cast<std::uint64_t>(key.eventId) << 16) ^ (key.version << 8) ^ key.pointerSize;
+        return std::hash<std::uint64_t>{}(hash * 0x9E3779B97F4A7C15ull);
+    }
+};
+
+using EventSchemaMap = std::unordered_map<CTMEventSchemaKey, CTMEventSchema, CTMEventSchemaKeyHash>;
+
+/*
+ * 'TdhGetEventInformation' + walking the properties with 'wcscmp' + 'TdhGetProperty' per field, for every single event, adds up fast.
+ * Event layouts never change for a given (provider, id, version), so we ask TDH once, work out the byte offset of the fields we care about-
+ * -and read them straight out of 'UserData' afterwards. Fields behind something of variable size (strings, sized arrays, structs) still go through TDH.
+ * Not thread safe, meant to be used from the event tracing thread only.
+ */
+class CTMEventSchemaCache
+{
+public:
+    //Field names have to outlive the cache (string literals)
+    CTMEventSchemaCache(std::initializer_list<LPCWSTR>);
+    ~CTMEventSchemaCache() = default;
+
+    //No need for copy or move operations
+    CTMEventSchemaCache(const CTMEventSchemaCache&)            = delete;
+    CTMEventSchemaCache& operator=(const CTMEventSchemaCache&) = delete;
+    CTMEventSchemaCache(CTMEventSchemaCache&&)                 = delete;
+    CTMEventSchemaCache& operator=(CTMEventSchemaCache&&)      = delete;
+
+public: //Main functions
+    //Writes one zero extended number per field name into the out array (GetFieldCount() values). False if the event can't be decoded
+    bool ReadFields(PEVENT_RECORD, ULONGLONG*);
+    //No TDH or event record involved, just the resolved layout and the raw payload (so it can be fed recorded payloads)
+    static bool DecodeFixedFields(const CTMEventSchema&, const BYTE*, USHORT, ULONGLONG*);
+    //Raw bytes of a single field (like an IPv6 address), call after 'ReadFields' on the same event. Returns the field size or 0
+    USHORT      ReadFieldBytes(PEVENT_RECORD, std::size_t, BYTE*, USHORT);
+
+public: //Getter functions
+    std::size_t GetFieldCount()  const { return fieldNames.size(); }
+    std::size_t GetSchemaCount() const { return schemaMap.size(); }
+    ULONGLONG   GetTdhFallbackCount() const { return tdhFallbackCount.load(std::memory_order_relaxed); }
+
+private: //Helper functions
+    const CTMEventSchema& FindOrResolveSchema(PEVENT_RECORD);
+    void                  ResolveSchema(PEVENT_RECORD, CTMEventSchema&);
+    bool                  ReadFieldWithTdh(PEVENT_RECORD, std::size_t, ULONGLONG&);
+    static USHORT         GetFixedInTypeSize(USHORT, USHORT);
+
+private: //Cache stuff
+    std::vector<LPCWSTR> fieldNames;
+    EventSchemaMap       schemaMap;
+    //Events come in long runs of the same kind, so remember the last one and skip the hashing
+    CTMEventSchemaKey     lastKey    = {};
+    const CTMEventSchema* lastSchema = nullptr;
+    //Used only while resolving a schema (once per layout)
+    std::unique_ptr<BYTE[]> eventInfoBuffer;
+    ULONG                   eventInfoBufferSize = 0;
+    std::atomic<ULONGLONG>  tdhFallbackCount    = 0; //Events which needed TDH for atleast one field, read by the diagnostics window
+};
+
+#endif
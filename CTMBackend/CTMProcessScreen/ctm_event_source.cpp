@@ -0,0 +1,337 @@
+#include "ctm_event_source.h"
+#include "ctm_process_screen_etw.h"
+#include "ctm_synthetic_event_source.h"
+#include "ctm_replay_event_source.h"
+
+//Don't really want these macros, they are messing up the std::max and std::min functions
+#undef max
+#undef min
+
+//Init static data members (payload layouts of the recorded events, field order matches the ETW network schema: PID, size, daddr, saddr, dport, sport)
+const CTMEventSchema CTMEventSource::recordedNetworkV4Schema    = MakeFixedSchema({{0, 4, true}, {4, 4, true}, {8, 4, true}, {12, 4, true}, {16, 2, true}, {18, 2, true}});
+const CTMEventSchema CTMEventSource::recordedNetworkV6Schema    = MakeFixedSchema({{0, 4, true}, {4, 4, true}, {8, 16, true}, {24, 16, true}, {40, 2, true}, {42, 2, true}});
+const CTMEventSchema CTMEventSource::recordedFileSchema         = MakeFixedSchema({{0, 4, true}, {4, 8, true}, {12, 8, true}});
+const CTMEventSchema CTMEventSource::recordedFileKeySchema      = MakeFixedSchema({{0, 4, true}, {4, 8, true}});
+const CTMEventSchema CTMEventSource::recordedLegacyFileSchema   = MakeFixedSchema({{0, 4, true}});
+const CTMEventSchema CTMEventSource::recordedOperationEndSchema = MakeFixedSchema({{0, 8, true}});
+
+//--------------------MAIN FUNCTIONS--------------------
+CTMEventTracingDiagnostics CTMEventSource::GetDiagnostics()
+{
+    CTMEventTracingDiagnostics diagnostics;
+    globalUsageEventPipeline.FillDiagnostics(diagnostics);
+    diagnostics.contextSwitches = globalCpuTimeline.GetSwitchCount();
+    return diagnostics;
+}
+
+//--------------------FACTORY FUNCTIONS--------------------
+std::unique_ptr<CTMEventSource> CTMEventSource::Create(const CTMEventSourceOptions& options)
+{
+    switch(options.type)
+    {
+        case CTMEventSourceType::Synthetic:
+            return std::make_unique<CTMSyntheticEventSource>(options.synthetic, options.shouldWaitForRoom);
+
+        case CTMEventSourceType::Replay:
+            return std::make_unique<CTMReplayEventSource>(options.replayPath, options.replaySpeed, options.shouldWaitForRoom);
+
+        default:
+            return std::make_unique<CTMProcessScreenEventTracing>(options.etwBuffers);
+    }
+}
+
+bool CTMEventSource::ParseOptions(int argc, LPWSTR* argv, int firstIndex, CTMEventSourceOptions& outOptions)
+{
+    CTMSyntheticEventOptions& synthetic = outOptions.synthetic;
+    for(int i = firstIndex; i < argc; i++)
+    {
+        if(i + 1 >= argc)
+            break;
+
+        if(wcscmp(argv[i], L"--event-source") == 0)
+        {
+            ++i;
+            if(wcscmp(argv[i], L"etw") == 0)
+                outOptions.type = CTMEventSourceType::Etw;
+            else if(wcscmp(argv[i], L"synthetic") == 0)
+                outOptions.type = CTMEventSourceType::Synthetic;
+            else if(wcscmp(argv[i], L"replay") == 0)
+                outOptions.type = CTMEventSourceType::Replay;
+            else
+            {
+                CTM_LOG_ERROR("Unknown event source, expected 'etw', 'synthetic' or 'replay'.");
+                return false;
+            }
+        }
+        else if(wcscmp(argv[i], L"--replay-file") == 0)
+            outOptions.replayPath = argv[++i];
+        else if(wcscmp(argv[i], L"--replay-speed") == 0)
+            outOptions.replaySpeed = std::max(0.0, _wtof(argv[++i]));
+        else if(wcscmp(argv[i], L"--sample-above") == 0)
+            outOptions.samplingThreshold = std::max(0.0, _wtof(argv[++i]));
+        else if(wcscmp(argv[i], L"--rate") == 0)
+            synthetic.eventsPerSecond = std::max(0.0, _wtof(argv[++i]));
+        else if(wcscmp(argv[i], L"--events") == 0)
+            synthetic.maxEvents = _wcstoui64(argv[++i], nullptr, 10);
+        else if(wcscmp(argv[i], L"--seed") == 0)
+            synthetic.seed = _wcstoui64(argv[++i], nullptr, 10);
+        else if(wcscmp(argv[i], L"--pids") == 0)
+            synthetic.processCount = static_cast<std::uint32_t>(std::clamp(_wtoi(argv[++i]), 1, 65536));
+        else if(wcscmp(argv[i], L"--flows") == 0)
+            synthetic.flowsPerProcess = static_cast<std::uint32_t>(std::clamp(_wtoi(argv[++i]), 1, 4096));
+        else if(wcscmp(argv[i], L"--skew") == 0)
+            synthetic.processSkew = std::clamp(_wtof(argv[++i]), 0.0, 4.0);
+        else if(wcscmp(argv[i], L"--files") == 0)
+            synthetic.fileCount = static_cast<std::uint32_t>(std::clamp(_wtoi(argv[++i]), 1, 1 << 20));
+        else if(wcscmp(argv[i], L"--file-skew") == 0)
+            synthetic.fileSkew = std::clamp(_wtof(argv[++i]), 0.0, 4.0);
+        else if(wcscmp(argv[i], L"--cswitch-rate") == 0)
+            synthetic.contextSwitchesPerSecond = std::max(0.0, _wtof(argv[++i]));
+        else if(wcscmp(argv[i], L"--cores") == 0)
+            synthetic.coreCount = static_cast<std::uint32_t>(std::clamp(_wtoi(argv[++i]), 1, 4096));
+        else if(wcscmp(argv[i], L"--threads") == 0)
+            synthetic.threadsPerProcess = static_cast<std::uint32_t>(std::clamp(_wtoi(argv[++i]), 1, 256));
+        else if(wcscmp(argv[i], L"--dpc-rate") == 0)
+            synthetic.dpcsPerSecond = std::max(0.0, _wtof(argv[++i]));
+        else if(wcscmp(argv[i], L"--ipv6-share") == 0)
+            synthetic.ipv6Share = std::clamp(_wtof(argv[++i]), 0.0, 1.0);
+        //'--mix tcpSent,tcpRecv,udpSent,udpRecv,fileRead,fileWrite', missing ones become 0
+        else if(wcscmp(argv[i], L"--mix") == 0)
+        {
+            const wchar_t* weightText = argv[++i];
+            for(auto&& weight : synthetic.mixWeights)
+            {
+                wchar_t* weightEnd = nullptr;
+                weight     = std::max(0.0, std::wcstod(weightText, &weightEnd));
+                weightText = (*weightEnd == L',') ? weightEnd + 1 : weightEnd;
+            }
+        }
+    }
+
+    if(outOptions.type == CTMEventSourceType::Replay && outOptions.replayPath.empty())
+    {
+        CTM_LOG_ERROR("Replay event source needs a recording, pass it with '--replay-file <file>'.");
+        return false;
+    }
+
+    return true;
+}
+
+CTMEventSourceOptions CTMEventSource::ParseOptionsFromCommandLine()
+{
+    CTMEventSourceOptions options;
+
+    int     argc = 0;
+    LPWSTR* argv = CommandLineToArgvW(GetCommandLineW(), &argc);
+    if(!argv)
+        return options;
+
+    //Bad options fall back to the real thing instead of refusing to start
+    if(!ParseOptions(argc, argv, 1, options))
+    {
+        CTM_LOG_WARNING("Falling back to the ETW event source.");
+        options = CTMEventSourceOptions{};
+    }
+
+    LocalFree(argv);
+    return options;
+}
+
+//--------------------RECORDED EVENTS--------------------
+void CTMEventSource::EncodeNetworkEvent(CTMRecordedEvent& outEvent, CTMUsageCounter counter, const CTMNetworkFlowKey& key, std::uint32_t bytes)
+{
+    const CTMEventSchema& schema = key.addressLength == 16 ? recordedNetworkV6Schema : recordedNetworkV4Schema;
+    USHORT                remotePort = SwapPortBytes(key.remotePort), localPort = SwapPortBytes(key.localPort);
+    std::uint32_t         processId  = key.processId;
+
+    outEvent.kind            = counter;
+    outEvent.addressLength   = key.addressLength;
+    outEvent.headerProcessId = 0;
+    outEvent.payloadSize     = static_cast<USHORT>(schema.fields.back().offset + schema.fields.back().size);
+    std::memcpy(outEvent.payload + schema.fields[0].offset, &processId, sizeof(processId));
+    std::memcpy(outEvent.payload + schema.fields[1].offset, &bytes, sizeof(bytes));
+    std::memcpy(outEvent.payload + schema.fields[2].offset, key.remoteAddress, key.addressLength);
+    std::memcpy(outEvent.payload + schema.fields[3].offset, key.localAddress, key.addressLength);
+    std::memcpy(outEvent.payload + schema.fields[4].offset, &remotePort, sizeof(remotePort));
+    std::memcpy(outEvent.payload + schema.fields[5].offset, &localPort, sizeof(localPort));
+}
+
+void CTMEventSource::EncodeFileEvent(CTMRecordedEvent& outEvent, CTMUsageCounter counter, DWORD processId, ULONGLONG fileKey, std::uint32_t bytes, ULONGLONG irp)
+{
+    outEvent.kind            = counter;
+    outEvent.addressLength   = 0;
+    outEvent.headerProcessId = processId;
+    outEvent.payloadSize     = static_cast<USHORT>(recordedFileSchema.fields.back().offset + recordedFileSchema.fields.back().size);
+    std::memcpy(outEvent.payload + recordedFileSchema.fields[0].offset, &bytes, sizeof(bytes));
+    std::memcpy(outEvent.payload + recordedFileSchema.fields[1].offset, &fileKey, sizeof(fileKey));
+    std::memcpy(outEvent.payload + recordedFileSchema.fields[2].offset, &irp, sizeof(irp));
+}
+
+void CTMEventSource::EncodeFileOperationEnd(CTMRecordedEvent& outEvent, ULONGLONG irp)
+{
+    //Kind only has to say 'file', the completion doesn't know if it ended a read or a write (neither does the real one)
+    outEvent.kind            = CTMUsageCounter::FileRead;
+    outEvent.addressLength   = CTMRecordedEvent::operationEndMarker;
+    outEvent.headerProcessId = 0;
+    outEvent.payloadSize     = static_cast<USHORT>(recordedOperationEndSchema.fields.back().offset + recordedOperationEndSchema.fields.back().size);
+    std::memcpy(outEvent.payload + recordedOperationEndSchema.fields[0].offset, &irp, sizeof(irp));
+}
+
+bool CTMEventSource::ReadFileEvent(const CTMRecordedEvent& recordedEvent, DWORD& outProcessId, ULONGLONG& outFileKey, std::uint32_t& outBytes)
+{
+    if(IsNetworkCounter(recordedEvent.kind) || recordedEvent.kind >= CTMUsageCounter::Count || recordedEvent.payloadSize > sizeof(recordedEvent.payload) ||
+       recordedEvent.addressLength == CTMRecordedEvent::operationEndMarker)
+        return false;
+
+    ULONGLONG fieldValues[3] = {};
+    if(!CTMEventSchemaCache::DecodeFixedFields(GetRecordedEventSchema(recordedEvent), recordedEvent.payload, recordedEvent.payloadSize, fieldValues))
+        return false;
+
+    outProcessId = recordedEvent.headerProcessId;
+    outBytes     = static_cast<std::uint32_t>(fieldValues[0]);
+    outFileKey   = fieldValues[1];
+    return true;
+}
+
+bool CTMEventSource::ReadNetworkEvent(const CTMRecordedEvent& recordedEvent, DWORD& outProcessId, std::uint32_t& outBytes)
+{
+    if(!IsNetworkCounter(recordedEvent.kind) || recordedEvent.payloadSize > sizeof(recordedEvent.payload))
+        return false;
+
+    ULONGLONG fieldValues[6] = {};
+    if(!CTMEventSchemaCache::DecodeFixedFields(GetRecordedEventSchema(recordedEvent), recordedEvent.payload, recordedEvent.payloadSize, fieldValues))
+        return false;
+
+    outProcessId = static_cast<DWORD>(fieldValues[0]);
+    outBytes     = static_cast<std::uint32_t>(fieldValues[1]);
+    return true;
+}
+
+bool CTMEventSource::ReadFileIrp(const CTMRecordedEvent& recordedEvent, ULONGLONG& outIrp, bool& outIsEnd)
+{
+    if(IsNetworkCounter(recordedEvent.kind) || recordedEvent.kind >= CTMUsageCounter::Count || recordedEvent.payloadSize > sizeof(recordedEvent.payload))
+        return false;
+
+    ULONGLONG fieldValues[3] = {};
+    if(!CTMEventSchemaCache::DecodeFixedFields(GetRecordedEventSchema(recordedEvent), recordedEvent.payload, recordedEvent.payloadSize, fieldValues))
+        return false;
+
+    outIsEnd = recordedEvent.addressLength == CTMRecordedEvent::operationEndMarker;
+    outIrp   = outIsEnd ? fieldValues[0] : fieldValues[2];
+    return true;
+}
+
+bool CTMEventSource::Decode(const CTMRecordedEvent& recordedEvent, ULONGLONG timestamp, CTMUsageEventRecord& outUsage,
+                           CTMNetworkFlowRecord& outFlow, bool& outIsNetwork)
+{
+    //Garbage in a recording shouldn't be able to read past the payload
+    if(recordedEvent.payloadSize > sizeof(recordedEvent.payload) || recordedEvent.kind >= CTMUsageCounter::Count)
+        return false;
+
+    const CTMEventSchema& schema = GetRecordedEventSchema(recordedEvent);
+    ULONGLONG fieldValues[6] = {};
+    if(!CTMEventSchemaCache::DecodeFixedFields(schema, recordedEvent.payload, recordedEvent.payloadSize, fieldValues))
+        return false;
+
+    outIsNetwork = IsNetworkCounter(recordedEvent.kind);
+
+    //Only the IRP, what it ended is the aggregator's business
+    if(recordedEvent.addressLength == CTMRecordedEvent::operationEndMarker && !outIsNetwork)
+    {
+        outUsage = CTMUsageEventRecord{};
+        outUsage.timestamp = timestamp;
+        outUsage.irp       = fieldValues[0];
+        outUsage.kind      = recordedEvent.kind;
+        outUsage.type      = CTMUsageEventType::FileIoCompletion;
+        return true;
+    }
+
+    //Older file records leave 'fieldValues[1]' (the file key) and 'fieldValues[2]' (the IRP) at 0
+    if(!outIsNetwork)
+    {
+        outUsage = CTMUsageEventRecord{};
+        outUsage.timestamp = timestamp;
+        outUsage.fileKey   = fieldValues[1];
+        outUsage.irp       = fieldValues[2];
+        outUsage.processId = recordedEvent.headerProcessId;
+        outUsage.bytes     = static_cast<std::uint32_t>(fieldValues[0]);
+        outUsage.kind      = recordedEvent.kind;
+        return true;
+    }
+
+    //Same mapping the ETW source does, 'saddr'/'sport' is our side
+    outFlow = CTMNetworkFlowRecord{};
+    outFlow.timestamp = timestamp;
+    outFlow.bytes     = static_cast<std::uint32_t>(fieldValues[1]);
+    outFlow.kind      = recordedEvent.kind;
+
+    CTMNetworkFlowKey& key = outFlow.key;
+    key.processId     = static_cast<DWORD>(fieldValues[0]);
+    key.protocol      = (recordedEvent.kind == CTMUsageCounter::TcpSent || recordedEvent.kind == CTMUsageCounter::TcpReceived) ? CTMFlowProtocol::Tcp : CTMFlowProtocol::Udp;
+    key.addressLength = recordedEvent.addressLength == 16 ? 16 : 4;
+    std::memcpy(key.remoteAddress, recordedEvent.payload + schema.fields[2].offset, key.addressLength);
+    std::memcpy(key.localAddress, recordedEvent.payload + schema.fields[3].offset, key.addressLength);
+    key.remotePort    = SwapPortBytes(fieldValues[4]);
+    key.localPort     = SwapPortBytes(fieldValues[5]);
+    return true;
+}
+
+bool CTMEventSource::DecodeAndPublish(const CTMRecordedEvent& recordedEvent, ULONGLONG timestamp, bool shouldWaitForRoom)
+{
+    CTMUsageEventRecord  usageRecord;
+    CTMNetworkFlowRecord flowRecord;
+    bool                 isNetwork = false;
+    if(!Decode(recordedEvent, timestamp, usageRecord, flowRecord, isNetwork))
+        return false;
+
+    if(isNetwork)
+        globalUsageEventPipeline.PublishNetworkFlow(flowRecord, shouldWaitForRoom);
+    else
+        globalUsageEventPipeline.PublishUsage(usageRecord, shouldWaitForRoom);
+    return true;
+}
+
+ULONGLONG CTMEventSource::ConvertRecordedTime(ULONGLONG recordedTicks, ULONGLONG recordedFrequency, ULONGLONG qpcStart, ULONGLONG qpcFrequency)
+{
+    //Whole seconds and the rest apart, 'ticks * frequency' overflows after a few minutes worth of ticks
+    return qpcStart + recordedTicks / recordedFrequency * qpcFrequency + recordedTicks % recordedFrequency * qpcFrequency / recordedFrequency;
+}
+
+//--------------------HELPER FUNCTIONS--------------------
+const CTMEventSchema& CTMEventSource::GetRecordedEventSchema(const CTMRecordedEvent& recordedEvent)
+{
+    //Too short to hold an IRP (or a file key) -> made before those were recorded
+    if(!IsNetworkCounter(recordedEvent.kind))
+    {
+        if(recordedEvent.addressLength == CTMRecordedEvent::operationEndMarker)
+            return recordedOperationEndSchema;
+
+        const CTMEventSchemaField& irpField     = recordedFileSchema.fields.back();
+        const CTMEventSchemaField& fileKeyField = recordedFileKeySchema.fields.back();
+        if(recordedEvent.payloadSize >= irpField.offset + irpField.size)
+            return recordedFileSchema;
+        return recordedEvent.payloadSize < fileKeyField.offset + fileKeyField.size ? recordedLegacyFileSchema : recordedFileKeySchema;
+    }
+    return recordedEvent.addressLength == 16 ? recordedNetworkV6Schema : recordedNetworkV4Schema;
+}
+
+CTMEventSchema CTMEventSource::MakeFixedSchema(std::initializer_list<CTMEventSchemaField> fields)
+{
+    CTMEventSchema schema;
+    schema.fields     = fields;
+    schema.isValid    = true;
+    schema.isAllFixed = true;
+    return schema;
+}
+
+bool CTMEventSource::IsNetworkCounter(CTMUsageCounter counter)
+{
+    return counter == CTMUsageCounter::TcpSent || counter == CTMUsageCounter::TcpReceived ||
+           counter == CTMUsageCounter::UdpSent || counter == CTMUsageCounter::UdpReceived;
+}
+
+USHORT CTMEventSource::SwapPortBytes(ULONGLONG port)
+{
+    //Ports go on the wire (and into the kernel events) in network byte order
+    return static_cast<USHORT>(((port & 0xFF) << 8) | ((port >> 8) & 0xFF));
+}
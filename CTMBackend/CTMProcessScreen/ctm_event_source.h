@@ -0,0 +1,172 @@
+#ifndef CTM_EVENT_SOURCE_HPP
+#define CTM_EVENT_SOURCE_HPP
+
+//Windows stuff
+#include <windows.h>
+#include <shellapi.h>
+//My stuff
+#include "../CTMPureHeaderFiles/ctm_logger.h"
+#include "ctm_usage_event_pipeline.h"
+#include "ctm_event_schema_cache.h"
+#include "ctm_etw_buffer_policy.h"
+#include "ctm_cpu_timeline.h"
+#include "ctm_ready_latency_tracker.h"
+#include "ctm_dpc_latency_tracker.h"
+//Stdlib stuff
+#include <memory>
+#include <string>
+#include <initializer_list>
+#include <algorithm>
+#include <cstring>
+#include <cwchar>
+#include <cstdint>
+
+enum class CTMEventSourceType : std::uint8_t
+{
+    Etw,       //Real time kernel session, needs administrator rights
+    Synthetic, //Deterministic generator, check ctm_synthetic_event_source.h
+    Replay     //Recording made by the synthetic generator (or anything writing the same format), check ctm_replay_event_source.h
+};
+
+/*
+ * Network or file event the way a non ETW source carries it: a raw payload laid out like the kernel providers lay theirs out.
+ * It is decoded through a fixed 'CTMEventSchema' (same code a cached ETW schema takes), so the decode step costs what it costs for real events.
+ * This is also the on disk record of a recording, so the layout must not change.
+ */
+struct CTMRecordedEvent
+{
+    //Perfect 8 byte alignment (64 bytes)
+    ULONGLONG       timestamp       = 0; //QPC ticks of the original event
+    DWORD           headerProcessId = 0; //File events carry their pid in the header instead of the payload
+    CTMUsageCounter kind            = CTMUsageCounter::TcpSent;
+    std::uint8_t    addressLength   = 0; //4 or 16 for network events, 0 for file events, 'operationEndMarker' for file completions
+    USHORT          payloadSize     = 0;
+    BYTE            payload[44]     = {};
+
+    //File events never had an address length, so a value they can't have tells a completion apart without touching the layout
+    constexpr static std::uint8_t operationEndMarker = 0xE0;
+};
+
+//Start of a recording file, followed by 'eventCount' of 'CTMRecordedEvent' back to back
+struct CTMRecordingHeader
+{
+    //Perfect 8 byte alignment
+    char      magic[8]           = {'C', 'T', 'M', 'E', 'V', 'T', 'S', '1'};
+    ULONGLONG timestampFrequency = 0; //Ticks per second of the recorded timestamps
+    ULONGLONG eventCount         = 0;
+};
+
+//Kernel providers a screen can ask the event session for (check ctm_event_session_manager.h)
+enum class CTMEventProvider : std::uint8_t
+{
+    KernelNetwork,
+    KernelFile,
+    KernelProcess,       //Process start/stop only
+    KernelContextSwitch, //CSwitch and thread start, into 'globalCpuTimeline' (check ctm_cpu_timeline.h)
+    KernelReadyThread,   //ReadyThread and CSwitch, into 'globalReadyLatencyTracker' (check ctm_ready_latency_tracker.h)
+    KernelDpc,           //DPC and ISR runs, into 'globalDpcLatencyTracker' (check ctm_dpc_latency_tracker.h)
+    Count
+};
+
+//Rates, pid distribution and event mix of the synthetic generator
+struct CTMSyntheticEventOptions
+{
+    double        eventsPerSecond = 100000.0; //0 -> as fast as possible
+    std::uint64_t maxEvents       = 0;        //0 -> until stopped
+    std::uint64_t seed            = 1;        //Same seed, same options -> same events
+    double        processSkew     = 1.0;      //Zipf exponent over the processes, 0 -> all of them equally busy
+    double        ipv6Share       = 0.25;     //Share of flows which are IPv6
+    std::uint32_t processCount    = 64;
+    std::uint32_t flowsPerProcess = 8;
+    std::uint32_t fileCount       = 1024;     //Files the file events are spread over, shared by every process
+    double        fileSkew        = 1.1;      //Zipf exponent over the files, a handful of hot ones and a long tail
+    //Context switches only while the provider is enabled (CPU screen), they go to the CPU timeline and not the pipeline
+    double        contextSwitchesPerSecond = 50000.0;
+    std::uint32_t coreCount                = 0; //Cores the switches are spread over, 0 -> this machine's
+    std::uint32_t threadsPerProcess        = 4;
+    //DPCs and ISRs only while their provider is enabled (DPC/ISR screen), spread over the same cores as the switches
+    double        dpcsPerSecond            = 20000.0;
+    //Relative share of every counter, same order as 'CTMUsageCounter'
+    double        mixWeights[static_cast<std::size_t>(CTMUsageCounter::Count)] = {30.0, 40.0, 5.0, 5.0, 12.0, 8.0};
+};
+
+//Parsed from '--event-source etw|synthetic|replay' and the options that go with it, anything not given keeps its default
+struct CTMEventSourceOptions
+{
+    CTMEventSourceType       type              = CTMEventSourceType::Etw;
+    CTMSyntheticEventOptions synthetic;
+    std::wstring             replayPath;
+    double                   replaySpeed       = 1.0;   //0 -> as fast as possible
+    double                   samplingThreshold = 1000000.0; //Events per second above which the pipeline samples 1 in N, 0 -> never
+    CTMEtwBufferSettings     etwBuffers;                    //From the settings screen, only the ETW source uses them
+    bool                     shouldWaitForRoom = false;     //Wait for the aggregator instead of dropping (benchmarks, never ETW)
+};
+
+/*
+ * Anything which produces network and file events for the process screen.
+ * A source publishes into 'globalUsageEventPipeline', it doesn't know or care who aggregates or reads them.
+ * 'ProcessEvents' blocks (it is run on its own thread) until 'Stop' is called or the source runs out of events.
+ */
+class CTMEventSource
+{
+public:
+    CTMEventSource()          = default;
+    virtual ~CTMEventSource() = default;
+
+    //No need for copy or move operations
+    CTMEventSource(const CTMEventSource&)            = delete;
+    CTMEventSource& operator=(const CTMEventSource&) = delete;
+    CTMEventSource(CTMEventSource&&)                 = delete;
+    CTMEventSource& operator=(CTMEventSource&&)      = delete;
+
+public: //Main functions
+    virtual bool        Start()         = 0;
+    virtual bool        ProcessEvents() = 0;
+    virtual void        Stop()          = 0;
+    virtual const char* GetName() const = 0;
+    //Called between 'Start' and 'Stop' from the thread which started it. Sources which aren't ETW produce what they produce anyway
+    virtual bool        SetProviderEnabled(CTMEventProvider, bool) { return true; }
+    //Called about once a second with the rate the pipeline sees and whether the source lost anything since the last call
+    virtual void        AdjustToEventRate(double, bool) {}
+    //Pipeline numbers, sources add their own on top (ETW asks the session what it lost)
+    virtual CTMEventTracingDiagnostics GetDiagnostics();
+
+public: //Factory functions
+    static std::unique_ptr<CTMEventSource> Create(const CTMEventSourceOptions&);
+    //Looks at the options starting at 'firstIndex', unknown ones are left alone (other modes share the command line)
+    static bool                  ParseOptions(int, LPWSTR*, int, CTMEventSourceOptions&);
+    static CTMEventSourceOptions ParseOptionsFromCommandLine();
+
+public: //Recorded events, shared by the sources which don't come from ETW
+    static void EncodeNetworkEvent(CTMRecordedEvent&, CTMUsageCounter, const CTMNetworkFlowKey&, std::uint32_t);
+    static void EncodeFileEvent(CTMRecordedEvent&, CTMUsageCounter, DWORD, ULONGLONG, std::uint32_t, ULONGLONG = 0);
+    static void EncodeFileOperationEnd(CTMRecordedEvent&, ULONGLONG);
+    //Pid, file key and bytes of a file event without publishing it (file key is 0 in recordings made before it was recorded). False for completions
+    static bool ReadFileEvent(const CTMRecordedEvent&, DWORD&, ULONGLONG&, std::uint32_t&);
+    //Pid and bytes of a network event without publishing it, false for anything else
+    static bool ReadNetworkEvent(const CTMRecordedEvent&, DWORD&, std::uint32_t&);
+    //IRP of a file read/write or completion, 0 if it has none (recordings made before IRPs were recorded)
+    static bool ReadFileIrp(const CTMRecordedEvent&, ULONGLONG&, bool&);
+    //Decode through the fixed schema into the record the pipeline takes, network events fill the flow record (out bool true), the rest the usage one
+    static bool Decode(const CTMRecordedEvent&, ULONGLONG, CTMUsageEventRecord&, CTMNetworkFlowRecord&, bool&);
+    //'Decode' and publish, the timestamp replaces the recorded one (it has to be comparable with QPC now)
+    static bool DecodeAndPublish(const CTMRecordedEvent&, ULONGLONG, bool);
+    //Recorded ticks since the first event -> QPC ticks after 'qpcStart', spacing kept as recorded so file latencies come out as recorded
+    static ULONGLONG ConvertRecordedTime(ULONGLONG, ULONGLONG, ULONGLONG, ULONGLONG);
+
+private: //Helper functions
+    static const CTMEventSchema& GetRecordedEventSchema(const CTMRecordedEvent&);
+    static CTMEventSchema        MakeFixedSchema(std::initializer_list<CTMEventSchemaField>);
+    static bool                  IsNetworkCounter(CTMUsageCounter);
+    static USHORT                SwapPortBytes(ULONGLONG);
+
+private: //Recorded event layouts, built once
+    static const CTMEventSchema recordedNetworkV4Schema;
+    static const CTMEventSchema recordedNetworkV6Schema;
+    static const CTMEventSchema recordedFileSchema;         //'IOSize', 'FileKey' and 'Irp', the pid is in the header like it is for the real file events
+    static const CTMEventSchema recordedFileKeySchema;      //'IOSize' and 'FileKey', recordings made before IRPs were recorded
+    static const CTMEventSchema recordedLegacyFileSchema;   //Only 'IOSize', recordings made before file keys were recorded
+    static const CTMEventSchema recordedOperationEndSchema; //Only 'Irp', like the OperationEnd events
+};
+
+#endif
@@ -0,0 +1,320 @@
+#include "ctm_file_latency_tracker.h"
+
+CTMFileLatencyTracker::CTMFileLatencyTracker(std::size_t inFlightCapacity, std::size_t processCapacity, double timeoutSeconds)
+{
+    LARGE_INTEGER frequency;
+    if(QueryPerformanceFrequency(&frequency) && frequency.QuadPart > 0)
+        qpcFrequency = static_cast<ULONGLONG>(frequency.QuadPart);
+    timeoutTicks = static_cast<ULONGLONG>(timeoutSeconds * qpcFrequency);
+
+    //Powers of two (atleast 64 slots), 1/4 of each table stays empty so probes end quickly
+    inFlightSlotCount = 64;
+    while(inFlightSlotCount < inFlightCapacity)
+        inFlightSlotCount *= 2;
+    inFlightSlotMask = inFlightSlotCount - 1;
+    maxInFlight      = inFlightSlotCount / 4 * 3;
+    inFlightSlots    = std::make_unique<CTMInFlightFileOperation[]>(inFlightSlotCount);
+
+    processSlotCount = 64;
+    while(processSlotCount < processCapacity)
+        processSlotCount *= 2;
+    processSlotMask = processSlotCount - 1;
+    maxProcesses    = processSlotCount / 4 * 3;
+    processSlots    = std::make_unique<CTMProcessFileLatency[]>(processSlotCount);
+}
+
+//--------------------MAIN FUNCTIONS--------------------
+void CTMFileLatencyTracker::AddBatch(const CTMFileOperationRecord* records, std::size_t recordCount)
+{
+    std::lock_guard<std::mutex> lock(trackerMutex);
+
+    for(std::size_t i = 0; i < recordCount; i++)
+    {
+        const CTMFileOperationRecord& record = records[i];
+        //Nothing to match it with
+        if(record.irp == 0)
+            continue;
+
+        latestTimestamp = std::max(latestTimestamp, record.timestamp);
+        if(record.isEnd)
+            EndOperation(record);
+        else
+            StartOperation(record);
+    }
+}
+
+void CTMFileLatencyTracker::SweepInFlight()
+{
+    std::lock_guard<std::mutex> lock(trackerMutex);
+    if(inFlightCount == 0 || latestTimestamp <= timeoutTicks)
+        return;
+
+    ULONGLONG oldestAllowed = latestTimestamp - timeoutTicks;
+    std::size_t slot = 0;
+    while(slot < inFlightSlotCount)
+    {
+        //Erasing shifts the next entry of the chain into this slot, so look at it again before moving on
+        if(inFlightSlots[slot].isUsed && inFlightSlots[slot].startTime < oldestAllowed)
+        {
+            EraseInFlightSlot(slot);
+            ++stats.timedOut;
+            continue;
+        }
+        ++slot;
+    }
+}
+
+bool CTMFileLatencyTracker::GetProcessSummary(DWORD processId, CTMLatencySummary& outRead, CTMLatencySummary& outWrite) const
+{
+    outRead  = CTMLatencySummary{};
+    outWrite = CTMLatencySummary{};
+
+    std::lock_guard<std::mutex> lock(trackerMutex);
+    const CTMProcessFileLatency* latency = FindProcess(processId);
+    if(latency == nullptr)
+        return false;
+
+    outRead  = Summarize(latency->readLatency);
+    outWrite = Summarize(latency->writeLatency);
+    return true;
+}
+
+void CTMFileLatencyTracker::GetSystemSummary(CTMLatencySummary& outRead, CTMLatencySummary& outWrite) const
+{
+    //~3.5 KB together, merging a couple hundred of them once a second is nothing
+    CTMLatencyHistogram readLatency, writeLatency;
+    {
+        std::lock_guard<std::mutex> lock(trackerMutex);
+        readLatency.Merge(retiredLatency.readLatency);
+        writeLatency.Merge(retiredLatency.writeLatency);
+        for(std::size_t i = 0; i < processSlotCount; i++)
+        {
+            if(!processSlots[i].isUsed)
+                continue;
+            readLatency.Merge(processSlots[i].readLatency);
+            writeLatency.Merge(processSlots[i].writeLatency);
+        }
+    }
+
+    outRead  = Summarize(readLatency);
+    outWrite = Summarize(writeLatency);
+}
+
+CTMFileLatencyStats CTMFileLatencyTracker::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(trackerMutex);
+    CTMFileLatencyStats outStats = stats;
+    outStats.inFlightCount    = inFlightCount;
+    outStats.inFlightCapacity = maxInFlight;
+    outStats.processCount     = processCount;
+    outStats.memoryUsage      = inFlightSlotCount * sizeof(CTMInFlightFileOperation) + (processSlotCount + 1) * sizeof(CTMProcessFileLatency);
+    return outStats;
+}
+
+void CTMFileLatencyTracker::RemoveProcess(DWORD processId)
+{
+    std::lock_guard<std::mutex> lock(trackerMutex);
+
+    std::size_t slot = HashKey(processId) & processSlotMask;
+    while(processSlots[slot].isUsed)
+    {
+        if(processSlots[slot].processId == processId)
+        {
+            retiredLatency.readLatency.Merge(processSlots[slot].readLatency);
+            retiredLatency.writeLatency.Merge(processSlots[slot].writeLatency);
+            EraseProcessSlot(slot);
+            return;
+        }
+        slot = (slot + 1) & processSlotMask;
+    }
+}
+
+void CTMFileLatencyTracker::Clear()
+{
+    std::lock_guard<std::mutex> lock(trackerMutex);
+    for(std::size_t i = 0; i < inFlightSlotCount; i++)
+        inFlightSlots[i] = CTMInFlightFileOperation{};
+    for(std::size_t i = 0; i < processSlotCount; i++)
+    {
+        processSlots[i].readLatency.Clear();
+        processSlots[i].writeLatency.Clear();
+        processSlots[i].isUsed = false;
+    }
+    retiredLatency.readLatency.Clear();
+    retiredLatency.writeLatency.Clear();
+
+    inFlightCount   = 0;
+    processCount    = 0;
+    latestTimestamp = 0;
+    stats           = CTMFileLatencyStats{};
+}
+
+//--------------------HELPER FUNCTIONS--------------------
+std::uint32_t CTMFileLatencyTracker::HashKey(ULONGLONG key)
+{
+    //IRPs are pool addresses, the low bits are mostly alignment, so mix everything before it gets masked
+    std::uint64_t hash = key * 0x9E3779B97F4A7C15ull;
+    return static_cast<std::uint32_t>(hash ^ (hash >> 32));
+}
+
+void CTMFileLatencyTracker::StartOperation(const CTMFileOperationRecord& record)
+{
+    std::size_t slot = FindInFlightSlot(record.irp);
+    if(inFlightSlots[slot].isUsed)
+    {
+        //IRPs get recycled, a start for one we still hold means the old end got lost, so it counts as timed out
+        ++stats.timedOut;
+    }
+    else if(inFlightCount >= maxInFlight)
+    {
+        ++stats.inFlightDrops;
+        return;
+    }
+    else
+        ++inFlightCount;
+
+    CTMInFlightFileOperation& operation = inFlightSlots[slot];
+    operation.irp          = record.irp;
+    operation.startTime    = record.timestamp;
+    operation.processId    = record.processId;
+    operation.isWrite      = record.isWrite;
+    operation.isUsed       = true;
+    operation.sampleWeight = record.sampleWeight;
+}
+
+void CTMFileLatencyTracker::EndOperation(const CTMFileOperationRecord& record)
+{
+    std::size_t slot = FindInFlightSlot(record.irp);
+    if(!inFlightSlots[slot].isUsed)
+    {
+        ++stats.unmatchedEnds;
+        return;
+    }
+
+    //Copy it out, the slot is gone before the process is looked up
+    CTMInFlightFileOperation operation = inFlightSlots[slot];
+    EraseInFlightSlot(slot);
+
+    //Events of different CPUs can come in slightly out of order, a negative latency is just a very short one
+    ULONGLONG     elapsedTicks        = record.timestamp > operation.startTime ? record.timestamp - operation.startTime : 0;
+    std::uint64_t latencyMicroseconds = elapsedTicks / qpcFrequency * 1000000 + elapsedTicks % qpcFrequency * 1000000 / qpcFrequency;
+
+    //A sampled operation stands for the ones skipped next to it, so the counts come out like nothing was skipped
+    CTMProcessFileLatency& latency = FindOrInsertProcess(operation.processId);
+    if(operation.isWrite)
+        latency.writeLatency.Record(latencyMicroseconds, operation.sampleWeight);
+    else
+        latency.readLatency.Record(latencyMicroseconds, operation.sampleWeight);
+    latency.lastSeen = record.timestamp;
+    ++stats.matched;
+}
+
+std::size_t CTMFileLatencyTracker::FindInFlightSlot(ULONGLONG irp) const
+{
+    std::size_t slot = HashKey(irp) & inFlightSlotMask;
+    while(inFlightSlots[slot].isUsed && inFlightSlots[slot].irp != irp)
+        slot = (slot + 1) & inFlightSlotMask;
+    return slot;
+}
+
+void CTMFileLatencyTracker::EraseInFlightSlot(std::size_t slot)
+{
+    //Backward shift deletion, same as the flow table's (check ctm_network_flow_table.cpp)
+    std::size_t holeSlot = slot;
+    std::size_t nextSlot = (slot + 1) & inFlightSlotMask;
+    while(inFlightSlots[nextSlot].isUsed)
+    {
+        std::size_t homeSlot     = HashKey(inFlightSlots[nextSlot].irp) & inFlightSlotMask;
+        bool        isHomeInside = holeSlot <= nextSlot ? (holeSlot < homeSlot && homeSlot <= nextSlot)
+                                                        : (holeSlot < homeSlot || homeSlot <= nextSlot);
+        if(!isHomeInside)
+        {
+            inFlightSlots[holeSlot] = inFlightSlots[nextSlot];
+            holeSlot                = nextSlot;
+        }
+        nextSlot = (nextSlot + 1) & inFlightSlotMask;
+    }
+
+    inFlightSlots[holeSlot] = CTMInFlightFileOperation{};
+    --inFlightCount;
+}
+
+CTMProcessFileLatency& CTMFileLatencyTracker::FindOrInsertProcess(DWORD processId)
+{
+    std::size_t slot = HashKey(processId) & processSlotMask;
+    while(processSlots[slot].isUsed)
+    {
+        if(processSlots[slot].processId == processId)
+            return processSlots[slot];
+        slot = (slot + 1) & processSlotMask;
+    }
+
+    if(processCount >= maxProcesses)
+    {
+        EvictQuietestProcess();
+        //Erasing can shift entries back, so look the slot up again
+        slot = HashKey(processId) & processSlotMask;
+        while(processSlots[slot].isUsed)
+            slot = (slot + 1) & processSlotMask;
+    }
+
+    CTMProcessFileLatency& latency = processSlots[slot];
+    latency.readLatency.Clear();
+    latency.writeLatency.Clear();
+    latency.lastSeen  = 0;
+    latency.processId = processId;
+    latency.isUsed    = true;
+    ++processCount;
+    return latency;
+}
+
+const CTMProcessFileLatency* CTMFileLatencyTracker::FindProcess(DWORD processId) const
+{
+    std::size_t slot = HashKey(processId) & processSlotMask;
+    while(processSlots[slot].isUsed)
+    {
+        if(processSlots[slot].processId == processId)
+            return &processSlots[slot];
+        slot = (slot + 1) & processSlotMask;
+    }
+    return nullptr;
+}
+
+void CTMFileLatencyTracker::EvictQuietestProcess()
+{
+    //Only when a new process shows up with a full table, a scan of a couple hundred slots is fine
+    std::size_t quietestSlot = processSlotCount;
+    for(std::size_t i = 0; i < processSlotCount; i++)
+        if(processSlots[i].isUsed && (quietestSlot == processSlotCount || processSlots[i].lastSeen < processSlots[quietestSlot].lastSeen))
+            quietestSlot = i;
+
+    if(quietestSlot == processSlotCount)
+        return;
+
+    retiredLatency.readLatency.Merge(processSlots[quietestSlot].readLatency);
+    retiredLatency.writeLatency.Merge(processSlots[quietestSlot].writeLatency);
+    EraseProcessSlot(quietestSlot);
+    ++stats.evictedProcesses;
+}
+
+void CTMFileLatencyTracker::EraseProcessSlot(std::size_t slot)
+{
+    std::size_t holeSlot = slot;
+    std::size_t nextSlot = (slot + 1) & processSlotMask;
+    while(processSlots[nextSlot].isUsed)
+    {
+        std::size_t homeSlot     = HashKey(processSlots[nextSlot].processId) & processSlotMask;
+        bool        isHomeInside = holeSlot <= nextSlot ? (holeSlot < homeSlot && homeSlot <= nextSlot)
+                                                        : (holeSlot < homeSlot || homeSlot <= nextSlot);
+        if(!isHomeInside)
+        {
+            processSlots[holeSlot] = processSlots[nextSlot];
+            holeSlot               = nextSlot;
+        }
+        nextSlot = (nextSlot + 1) & processSlotMask;
+    }
+
+    //Histograms are cleared when the slot gets taken again, no need to touch ~3.5 KB here
+    processSlots[holeSlot].isUsed = false;
+    --processCount;
+}
@@ -0,0 +1,129 @@
+#ifndef CTM_FILE_LATENCY_TRACKER_HPP
+#define CTM_FILE_LATENCY_TRACKER_HPP
+
+//Windows stuff
+#include <windows.h>
+//My stuff
+#include "../CTMPureHeaderFiles/ctm_latency_histogram.h"
+//Stdlib stuff
+#include <memory>
+#include <mutex>
+#include <algorithm>
+#include <cstdint>
+
+//Start or end of a file operation, as the aggregator hands it over (check ctm_usage_event_pipeline.h)
+struct CTMFileOperationRecord
+{
+    //Perfect 8 byte alignment
+    ULONGLONG     irp          = 0; //Kernel's I/O request, the only thing the start and the end have in common
+    ULONGLONG     timestamp    = 0; //QPC ticks
+    DWORD         processId    = 0; //Starts only, the end arrives on whatever thread completed it
+    bool          isEnd        = false;
+    bool          isWrite      = false;
+    std::uint16_t sampleWeight = 1; //Starts only, how many operations this one stands for when the pipeline samples
+};
+
+//A read or write we saw start and not end yet
+struct CTMInFlightFileOperation
+{
+    //Perfect 8 byte alignment
+    ULONGLONG     irp          = 0;
+    ULONGLONG     startTime    = 0; //QPC ticks
+    DWORD         processId    = 0;
+    bool          isWrite      = false;
+    bool          isUsed       = false;
+    std::uint16_t sampleWeight = 1;
+};
+
+//Read and write latencies of a single process
+struct CTMProcessFileLatency
+{
+    CTMLatencyHistogram readLatency;
+    CTMLatencyHistogram writeLatency;
+    ULONGLONG           lastSeen  = 0; //QPC ticks of its last completed operation, the oldest one goes when the table is full
+    DWORD               processId = 0;
+    bool                isUsed    = false;
+};
+
+//Matching health, everything is cumulative
+struct CTMFileLatencyStats
+{
+    std::uint64_t matched          = 0; //Ends which found their start, each one is a latency sample
+    std::uint64_t unmatchedEnds    = 0; //Ends of operations we don't track (opens, closes, ...) or whose start was dropped
+    std::uint64_t timedOut         = 0; //Starts whose end never showed up within the timeout
+    std::uint64_t inFlightDrops    = 0; //Starts thrown away because the in flight table was full
+    std::uint64_t evictedProcesses = 0; //Quietest process pushed out of the latency table to make room (its samples stay in the system wide numbers)
+    std::size_t   inFlightCount    = 0;
+    std::size_t   inFlightCapacity = 0;
+    std::size_t   processCount     = 0;
+    std::size_t   memoryUsage      = 0; //Bytes, fixed at construction
+};
+
+/*
+ * File I/O latency per process: read/write start events are matched with the provider's OperationEnd by IRP, the difference goes into a histogram.
+ * Operations in flight sit in a fixed size open addressing table (linear probing, backward shift deletion, same as the flow table).
+ * A start that never gets its end (lost event, cancelled IRP) is swept out after a timeout, a start that finds the table full is dropped and counted.
+ * Histograms live in a second fixed size table keyed by pid, when that one is full the process with the oldest completion gets merged into
+ * the retired histograms and makes room, so the system wide numbers (all processes merged) never lose a sample.
+ * Time is whatever the events say, so a recording replays with the latencies it was recorded with.
+ * Starts and ends arrive through the aggregator's batches and are matched under one lock per batch. A summary the UI asks for-
+ * -waits at most for the batch in progress, matching never allocates so that one is short.
+ */
+class CTMFileLatencyTracker
+{
+public:
+    CTMFileLatencyTracker(std::size_t = 1 << 14, std::size_t = 256, double = 10.0);
+    ~CTMFileLatencyTracker() = default;
+
+    //No need for copy or move operations
+    CTMFileLatencyTracker(const CTMFileLatencyTracker&)            = delete;
+    CTMFileLatencyTracker& operator=(const CTMFileLatencyTracker&) = delete;
+    CTMFileLatencyTracker(CTMFileLatencyTracker&&)                 = delete;
+    CTMFileLatencyTracker& operator=(CTMFileLatencyTracker&&)      = delete;
+
+public: //Main functions
+    void AddBatch(const CTMFileOperationRecord*, std::size_t);
+    //Drops starts older than the timeout, relative to the newest event seen (not the wall clock, recordings have their own time)
+    void SweepInFlight();
+    //Read and write summaries, false if the process has no samples
+    bool GetProcessSummary(DWORD, CTMLatencySummary&, CTMLatencySummary&) const;
+    //Every process merged, including the ones which were evicted or exited
+    void GetSystemSummary(CTMLatencySummary&, CTMLatencySummary&) const;
+    CTMFileLatencyStats GetStats() const;
+    //Process exited, its samples go to the retired histograms so the pid can be reused cleanly
+    void RemoveProcess(DWORD);
+    void Clear();
+
+private: //Helper functions
+    static std::uint32_t          HashKey(ULONGLONG);
+    void                          StartOperation(const CTMFileOperationRecord&);
+    void                          EndOperation(const CTMFileOperationRecord&);
+    std::size_t                   FindInFlightSlot(ULONGLONG) const;
+    void                          EraseInFlightSlot(std::size_t);
+    CTMProcessFileLatency&        FindOrInsertProcess(DWORD);
+    const CTMProcessFileLatency*  FindProcess(DWORD) const;
+    void                          EvictQuietestProcess();
+    void                          EraseProcessSlot(std::size_t);
+
+private: //In flight operations
+    std::unique_ptr<CTMInFlightFileOperation[]> inFlightSlots;
+    std::size_t inFlightSlotCount = 0;
+    std::size_t inFlightSlotMask  = 0;
+    std::size_t maxInFlight       = 0;
+    std::size_t inFlightCount     = 0;
+    ULONGLONG   timeoutTicks      = 0;
+    ULONGLONG   latestTimestamp   = 0; //Newest event time seen, the sweep's 'now'
+    ULONGLONG   qpcFrequency      = 1;
+
+private: //Per process histograms
+    std::unique_ptr<CTMProcessFileLatency[]> processSlots;
+    std::size_t           processSlotCount = 0;
+    std::size_t           processSlotMask  = 0;
+    std::size_t           maxProcesses     = 0;
+    std::size_t           processCount     = 0;
+    CTMProcessFileLatency retiredLatency;   //Evicted and cleared processes, merged
+    CTMFileLatencyStats   stats;
+    mutable std::mutex    trackerMutex;
+};
+
+#endif
@@ -0,0 +1,126 @@
+#include "ctm_file_usage_tracker.h"
+
+CTMFileUsageTracker::CTMFileUsageTracker(std::size_t fileCapacity, std::size_t processFileCapacity, std::size_t maxNames)
+    : fileSketch(fileCapacity), processFileSketch(processFileCapacity), maxFileNames(maxNames) {}
+
+//--------------------MAIN FUNCTIONS--------------------
+void CTMFileUsageTracker::AddBatch(const CTMFileIoRecord* records, std::size_t recordCount)
+{
+    std::lock_guard<std::mutex> lock(sketchMutex);
+
+    for(std::size_t i = 0; i < recordCount; i++)
+    {
+        const CTMFileIoRecord& record = records[i];
+        //No key, nothing to attribute the bytes to (they still count towards the process columns)
+        if(record.fileKey == 0)
+            continue;
+
+        fileSketch.Add(record.fileKey, record.bytes);
+        processFileSketch.Add(CTMProcessFileKey{record.fileKey, record.processId}, record.bytes);
+    }
+}
+
+void CTMFileUsageTracker::SetFileName(ULONGLONG fileKey, const std::wstring& fileName)
+{
+    if(fileKey == 0 || fileName.empty())
+        return;
+
+    int bytesNeeded = WideCharToMultiByte(CP_UTF8, 0, fileName.c_str(), static_cast<int>(fileName.size()), NULL, 0, NULL, NULL);
+    if(bytesNeeded <= 0)
+        return;
+
+    std::string filePath(static_cast<std::size_t>(bytesNeeded), '\0');
+    WideCharToMultiByte(CP_UTF8, 0, fileName.c_str(), static_cast<int>(fileName.size()), filePath.data(), bytesNeeded, NULL, NULL);
+
+    //Paths are only a few hundred bytes, but a build touching every file of a repo would still grow the map a lot without the cap
+    std::lock_guard<std::mutex> lock(nameMutex);
+    //Keys get reused once a file is closed for good, a new name for a known key just replaces the old one
+    auto it = fileNameMap.find(fileKey);
+    if(it != fileNameMap.end())
+        it->second = std::move(filePath);
+    else if(fileNameMap.size() < maxFileNames)
+        fileNameMap.emplace(fileKey, std::move(filePath));
+}
+
+void CTMFileUsageTracker::RemoveFileName(ULONGLONG fileKey)
+{
+    std::lock_guard<std::mutex> lock(nameMutex);
+    fileNameMap.erase(fileKey);
+}
+
+void CTMFileUsageTracker::CollectTopFiles(FileUsageVector& outFiles, std::size_t maxCount)
+{
+    outFiles.clear();
+    {
+        std::lock_guard<std::mutex> lock(sketchMutex);
+        fileSketch.CollectTop(fileCounters, maxCount);
+    }
+
+    for(auto&& counter : fileCounters)
+    {
+        CTMFileUsageEntry entry;
+        entry.fileKey    = counter.key;
+        entry.bytes      = counter.count;
+        entry.errorBytes = counter.error;
+        outFiles.push_back(std::move(entry));
+    }
+
+    ResolveNames(outFiles);
+}
+
+void CTMFileUsageTracker::CollectProcessTopFiles(DWORD processId, FileUsageVector& outFiles, std::size_t maxCount)
+{
+    outFiles.clear();
+    {
+        std::lock_guard<std::mutex> lock(sketchMutex);
+        processFileSketch.CollectTop(processFileCounters, maxCount, [processId](const CTMProcessFileKey& key){ return key.processId == processId; });
+    }
+
+    for(auto&& counter : processFileCounters)
+    {
+        CTMFileUsageEntry entry;
+        entry.fileKey    = counter.key.fileKey;
+        entry.processId  = counter.key.processId;
+        entry.bytes      = counter.count;
+        entry.errorBytes = counter.error;
+        outFiles.push_back(std::move(entry));
+    }
+
+    ResolveNames(outFiles);
+}
+
+void CTMFileUsageTracker::ResetUsage()
+{
+    std::lock_guard<std::mutex> lock(sketchMutex);
+    fileSketch.Clear();
+    processFileSketch.Clear();
+}
+
+void CTMFileUsageTracker::Clear()
+{
+    ResetUsage();
+
+    std::lock_guard<std::mutex> lock(nameMutex);
+    fileNameMap.clear();
+}
+
+//--------------------FORMATTING HELPER--------------------
+void CTMFileUsageTracker::FormatFileName(const CTMFileUsageEntry& entry, char* outText, std::size_t outTextSize)
+{
+    if(!entry.path.empty())
+        std::snprintf(outText, outTextSize, "%s", entry.path.c_str());
+    else
+        std::snprintf(outText, outTextSize, "File 0x%llX", static_cast<unsigned long long>(entry.fileKey));
+}
+
+//--------------------HELPER FUNCTIONS--------------------
+void CTMFileUsageTracker::ResolveNames(FileUsageVector& files)
+{
+    std::lock_guard<std::mutex> lock(nameMutex);
+    for(auto&& file : files)
+    {
+        auto it = fileNameMap.find(file.fileKey);
+        if(it != fileNameMap.end())
+            file.path = it->second;
+    }
+}
@@ -0,0 +1,131 @@
+#ifndef CTM_FILE_USAGE_TRACKER_HPP
+#define CTM_FILE_USAGE_TRACKER_HPP
+
+//Windows stuff
+#include <windows.h>
+//My stuff
+#include "../CTMPureHeaderFiles/ctm_space_saving.h"
+//Stdlib stuff
+#include <unordered_map>
+#include <vector>
+#include <string>
+#include <mutex>
+#include <functional>
+#include <cstdio>
+#include <cstdint>
+
+//A file read or write, as the aggregator hands it over (check ctm_usage_event_pipeline.h)
+struct CTMFileIoRecord
+{
+    //Perfect 8 byte alignment
+    ULONGLONG     fileKey   = 0; //Kernel's key for the file (FileKey of the Kernel-File events), same for every handle to it
+    std::uint64_t bytes     = 0; //Already scaled up if the event was sampled
+    DWORD         processId = 0;
+};
+
+//Key of the per process sketch, a file as seen by one process
+struct CTMProcessFileKey
+{
+    ULONGLONG fileKey   = 0;
+    DWORD     processId = 0;
+
+    bool operator==(const CTMProcessFileKey& other) const { return fileKey == other.fileKey && processId == other.processId; }
+};
+
+struct CTMProcessFileKeyHash
+{
+    std::size_t operator()(const CTMProcessFileKey& key) const
+    {
+        //File keys are pool addresses, the low bits are mostly alignment, so mix everything before it gets masked
+        std::uint64_t hash = (key.fileKey ^ (static_cast<std::uint64_t>(key.processId) << 32) ^ key.processId) * 0x9E3779B97F4A7C15ull;
+        return static_cast<std::size_t>(hash ^ (hash >> 29));
+    }
+};
+
+struct CTMFileKeyHash
+{
+    std::size_t operator()(ULONGLONG fileKey) const
+    {
+        std::uint64_t hash = fileKey * 0x9E3779B97F4A7C15ull;
+        return static_cast<std::size_t>(hash ^ (hash >> 29));
+    }
+};
+
+//One row of a top files list, bytes are read + write
+struct CTMFileUsageEntry
+{
+    //Perfect 8 byte alignment
+    std::string   path;           //Empty if the name was never seen (file was opened before the session started)
+    ULONGLONG     fileKey    = 0;
+    std::uint64_t bytes      = 0; //Never below the true value
+    std::uint64_t errorBytes = 0; //Atmost this much of 'bytes' may belong to other files, 0 -> exact
+    DWORD         processId  = 0; //0 for the system wide list
+};
+
+using FileUsageVector   = std::vector<CTMFileUsageEntry>;
+using FileNameMap       = std::unordered_map<ULONGLONG, std::string>;
+using FileUsageSketch   = CTMSpaceSaving<ULONGLONG, CTMFileKeyHash>;
+using ProcessFileSketch = CTMSpaceSaving<CTMProcessFileKey, CTMProcessFileKeyHash>;
+
+/*
+ * Which files get the most read/write bytes, system wide and per process, in fixed memory no matter how many files are touched.
+ * Two Space-Saving sketches (check ctm_space_saving.h): one keyed by file and one keyed by (process, file).
+ * Error bound: with N bytes seen so far, every count is over by atmost N / capacity, and any file (or process file) with more than that is in the list.
+ * The per process list is the slice of the (process, file) sketch for that pid, so a quiet process only shows files which are heavy system wide-
+ * -which is what someone looking for disk thrashing cares about anyway.
+ * Paths come from the Kernel-File NameCreate/NameDelete events, kept in a bounded map (new names are skipped when it is full).
+ * Sketches are written in batches by the aggregator thread and names by the event source, the UI reads both once a second, so mutexes are plenty.
+ */
+class CTMFileUsageTracker
+{
+public:
+    CTMFileUsageTracker(std::size_t = 512, std::size_t = 4096, std::size_t = 65536);
+    ~CTMFileUsageTracker() = default;
+
+    //No need for copy or move operations
+    CTMFileUsageTracker(const CTMFileUsageTracker&)            = delete;
+    CTMFileUsageTracker& operator=(const CTMFileUsageTracker&) = delete;
+    CTMFileUsageTracker(CTMFileUsageTracker&&)                 = delete;
+    CTMFileUsageTracker& operator=(CTMFileUsageTracker&&)      = delete;
+
+public: //Main functions
+    void AddBatch(const CTMFileIoRecord*, std::size_t);
+    void SetFileName(ULONGLONG, const std::wstring&);
+    void RemoveFileName(ULONGLONG);
+    //Heaviest first, atmost 'maxCount' of them
+    void CollectTopFiles(FileUsageVector&, std::size_t);
+    void CollectProcessTopFiles(DWORD, FileUsageVector&, std::size_t);
+    //Sketches only, names stay (they describe files, not usage)
+    void ResetUsage();
+    void Clear();
+
+public: //Getter functions
+    std::uint64_t GetTotalBytes()        const { std::lock_guard<std::mutex> lock(sketchMutex); return fileSketch.GetTotalWeight(); }
+    //N / capacity of each sketch, the most any count in its list can be over by
+    std::uint64_t GetFileErrorBound()    const { std::lock_guard<std::mutex> lock(sketchMutex); return fileSketch.GetErrorBound(); }
+    std::uint64_t GetProcessErrorBound() const { std::lock_guard<std::mutex> lock(sketchMutex); return processFileSketch.GetErrorBound(); }
+    std::size_t   GetFileNameCount()     const { std::lock_guard<std::mutex> lock(nameMutex); return fileNameMap.size(); }
+    std::size_t   GetMemoryUsage()       const { return fileSketch.GetMemoryUsage() + processFileSketch.GetMemoryUsage(); }
+
+public: //Formatting helper
+    //Path if we know it, 'File 0x...' otherwise
+    static void FormatFileName(const CTMFileUsageEntry&, char*, std::size_t);
+
+private: //Helper functions
+    void ResolveNames(FileUsageVector&);
+
+private: //Sketch stuff
+    FileUsageSketch    fileSketch;
+    ProcessFileSketch  processFileSketch;
+    mutable std::mutex sketchMutex;
+    //Reused between collects, so the UI doesn't allocate every update
+    std::vector<FileUsageSketch::Counter>   fileCounters;
+    std::vector<ProcessFileSketch::Counter> processFileCounters;
+
+private: //Name stuff
+    FileNameMap        fileNameMap;
+    std::size_t        maxFileNames = 0;
+    mutable std::mutex nameMutex;
+};
+
+#endif
@@ -0,0 +1,237 @@
+#include "ctm_network_flow_table.h"
+
+CTMNetworkFlowTable::CTMNetworkFlowTable(std::size_t maxMemoryBytes)
+{
+    //Largest power of two which fits the cap (atleast 64 slots), 1/4 of it stays empty so probes end quickly
+    slotCount = 64;
+    while(slotCount * 2 * sizeof(CTMNetworkFlowEntry) <= maxMemoryBytes)
+        slotCount *= 2;
+    slotMask   = slotCount - 1;
+    maxEntries = slotCount / 4 * 3;
+    slots      = std::make_unique<CTMNetworkFlowEntry[]>(slotCount);
+}
+
+//--------------------MAIN FUNCTIONS--------------------
+void CTMNetworkFlowTable::AddBatch(const CTMNetworkFlowRecord* records, std::size_t recordCount)
+{
+    std::lock_guard<std::mutex> lock(tableMutex);
+
+    for(std::size_t i = 0; i < recordCount; i++)
+    {
+        const CTMNetworkFlowRecord& record = records[i];
+        CTMNetworkFlowEntry&        entry  = FindOrInsert(record.key, record.timestamp);
+        std::uint64_t               bytes  = static_cast<std::uint64_t>(record.bytes) * record.sampleWeight;
+
+        if(record.kind == CTMUsageCounter::TcpSent || record.kind == CTMUsageCounter::UdpSent)
+            entry.bytesSent += bytes;
+        else
+            entry.bytesReceived += bytes;
+
+        entry.lastSeen     = record.timestamp;
+        entry.isReferenced = true;
+    }
+}
+
+void CTMNetworkFlowTable::UpdateRates(double elapsedSeconds)
+{
+    if(elapsedSeconds <= 0.0)
+        return;
+
+    std::lock_guard<std::mutex> lock(tableMutex);
+
+    //Whole table, it is a few thousand slots once a second
+    for(std::size_t i = 0; i < slotCount; i++)
+    {
+        CTMNetworkFlowEntry& entry = slots[i];
+        if(!entry.isUsed)
+            continue;
+
+        entry.sendRate             = (entry.bytesSent - entry.sampledBytesSent) / elapsedSeconds;
+        entry.receiveRate          = (entry.bytesReceived - entry.sampledBytesReceived) / elapsedSeconds;
+        entry.sampledBytesSent     = entry.bytesSent;
+        entry.sampledBytesReceived = entry.bytesReceived;
+    }
+}
+
+void CTMNetworkFlowTable::CollectProcessFlows(DWORD processId, NetworkFlowVector& outFlows, std::size_t maxCount)
+{
+    outFlows.clear();
+    {
+        std::lock_guard<std::mutex> lock(tableMutex);
+        for(std::size_t i = 0; i < slotCount; i++)
+            if(slots[i].isUsed && slots[i].key.processId == processId)
+                outFlows.push_back(slots[i]);
+    }
+
+    //Fastest first, flows which went quiet are sorted by how much they moved in total
+    std::sort(outFlows.begin(), outFlows.end(), [](const CTMNetworkFlowEntry& left, const CTMNetworkFlowEntry& right){
+        double leftRate = left.sendRate + left.receiveRate, rightRate = right.sendRate + right.receiveRate;
+        if(leftRate != rightRate)
+            return leftRate > rightRate;
+        return left.bytesSent + left.bytesReceived > right.bytesSent + right.bytesReceived;
+    });
+
+    if(outFlows.size() > maxCount)
+        outFlows.resize(maxCount);
+}
+
+void CTMNetworkFlowTable::Clear()
+{
+    std::lock_guard<std::mutex> lock(tableMutex);
+    for(std::size_t i = 0; i < slotCount; i++)
+        slots[i] = CTMNetworkFlowEntry{};
+    entryCount   = 0;
+    clockHand    = 0;
+    evictedCount = 0;
+}
+
+void CTMNetworkFlowTable::FormatEndpoint(const BYTE* address, std::uint8_t addressLength, USHORT port, char* outText, std::size_t outSize)
+{
+    if(addressLength == 4)
+    {
+        std::snprintf(outText, outSize, "%u.%u.%u.%u:%u", address[0], address[1], address[2], address[3], port);
+        return;
+    }
+
+    //Groups are big endian, the longest run of zero groups (2 or more) gets collapsed to '::'
+    USHORT groups[8];
+    for(int i = 0; i < 8; i++)
+        groups[i] = static_cast<USHORT>((address[i * 2] << 8) | address[i * 2 + 1]);
+
+    int bestStart = -1, bestLength = 0;
+    for(int i = 0; i < 8; )
+    {
+        if(groups[i] != 0)
+        {
+            i++;
+            continue;
+        }
+
+        int runStart = i;
+        while(i < 8 && groups[i] == 0)
+            i++;
+        if(i - runStart > bestLength && i - runStart >= 2)
+        {
+            bestStart  = runStart;
+            bestLength = i - runStart;
+        }
+    }
+
+    char        addressText[48];
+    std::size_t written = 0;
+    for(int i = 0; i < 8 && written < sizeof(addressText); i++)
+    {
+        if(i == bestStart)
+        {
+            written += std::snprintf(addressText + written, sizeof(addressText) - written, "::");
+            i += bestLength - 1;
+            continue;
+        }
+
+        bool isAfterCollapse = bestStart >= 0 && i == bestStart + bestLength;
+        written += std::snprintf(addressText + written, sizeof(addressText) - written, (i == 0 || isAfterCollapse) ? "%x" : ":%x", groups[i]);
+    }
+
+    std::snprintf(outText, outSize, "[%s]:%u", addressText, port);
+}
+
+//--------------------HELPER FUNCTIONS--------------------
+std::uint32_t CTMNetworkFlowTable::HashKey(const CTMNetworkFlowKey& key)
+{
+    //FNV-1a over the fields (not the struct, padding bytes would get in the way)
+    std::uint32_t hash = 2166136261u;
+    auto mixBytes = [&hash](const void* data, std::size_t size){
+        const BYTE* bytes = static_cast<const BYTE*>(data);
+        for(std::size_t i = 0; i < size; i++)
+            hash = (hash ^ bytes[i]) * 16777619u;
+    };
+
+    mixBytes(&key.processId, sizeof(key.processId));
+    mixBytes(&key.localPort, sizeof(key.localPort));
+    mixBytes(&key.remotePort, sizeof(key.remotePort));
+    mixBytes(&key.protocol, sizeof(key.protocol));
+    mixBytes(key.remoteAddress, key.addressLength);
+    mixBytes(key.localAddress, key.addressLength);
+    return hash;
+}
+
+CTMNetworkFlowEntry& CTMNetworkFlowTable::FindOrInsert(const CTMNetworkFlowKey& key, ULONGLONG timestamp)
+{
+    std::uint32_t hash = HashKey(key);
+    std::size_t   slot = hash & slotMask;
+
+    //Probe until we hit the key or an empty slot (there always is one, the table never goes above 3/4)
+    while(slots[slot].isUsed)
+    {
+        if(slots[slot].hash == hash && slots[slot].key == key)
+            return slots[slot];
+        slot = (slot + 1) & slotMask;
+    }
+
+    //New flow, make room first. Eviction shifts entries around, so the free slot has to be searched again
+    if(entryCount >= maxEntries)
+    {
+        EvictOne();
+        slot = hash & slotMask;
+        while(slots[slot].isUsed)
+            slot = (slot + 1) & slotMask;
+    }
+
+    CTMNetworkFlowEntry& entry = slots[slot];
+    entry           = CTMNetworkFlowEntry{};
+    entry.key       = key;
+    entry.hash      = hash;
+    entry.firstSeen = timestamp;
+    entry.isUsed    = true;
+    ++entryCount;
+    return entry;
+}
+
+void CTMNetworkFlowTable::EvictOne()
+{
+    //Second chance: referenced flows get their bit cleared and are skipped, the first one without it goes.
+    //Ends within two sweeps at worst, the first sweep clears every bit
+    while(true)
+    {
+        std::size_t slot = clockHand;
+        clockHand        = (clockHand + 1) & slotMask;
+
+        if(!slots[slot].isUsed)
+            continue;
+
+        if(slots[slot].isReferenced)
+        {
+            slots[slot].isReferenced = false;
+            continue;
+        }
+
+        EraseSlot(slot);
+        ++evictedCount;
+        return;
+    }
+}
+
+void CTMNetworkFlowTable::EraseSlot(std::size_t slot)
+{
+    /*
+     * Backward shift deletion, every entry after the hole which could live in it (its home slot is not between the hole and itself)-
+     * -is moved into the hole, until an empty slot ends the probe chain. No tombstones, so lookups never slow down over time
+     */
+    std::size_t holeSlot = slot;
+    std::size_t nextSlot = (slot + 1) & slotMask;
+    while(slots[nextSlot].isUsed)
+    {
+        std::size_t homeSlot     = slots[nextSlot].hash & slotMask;
+        bool        isHomeInside = holeSlot <= nextSlot ? (holeSlot < homeSlot && homeSlot <= nextSlot)
+                                                        : (holeSlot < homeSlot || homeSlot <= nextSlot);
+        if(!isHomeInside)
+        {
+            slots[holeSlot] = slots[nextSlot];
+            holeSlot        = nextSlot;
+        }
+        nextSlot = (nextSlot + 1) & slotMask;
+    }
+
+    slots[holeSlot] = CTMNetworkFlowEntry{};
+    --entryCount;
+}
\ No newline at end of file
@@ -0,0 +1,128 @@
+#ifndef CTM_NETWORK_FLOW_TABLE_HPP
+#define CTM_NETWORK_FLOW_TABLE_HPP
+
+//Windows stuff
+#include <windows.h>
+//My stuff
+#include "ctm_pid_counter_table.h"
+//Stdlib stuff
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+#include <cstdint>
+
+enum class CTMFlowProtocol : std::uint8_t
+{
+    Tcp,
+    Udp
+};
+
+//Identity of a flow, every field is compared so it has to be zero initialized
+struct CTMNetworkFlowKey
+{
+    //Perfect 4 byte alignment
+    BYTE            localAddress[16]  = {}; //IPv4 only uses the first 4 bytes
+    BYTE            remoteAddress[16] = {};
+    DWORD           processId         = 0;
+    USHORT          localPort         = 0;  //Host byte order
+    USHORT          remotePort        = 0;
+    CTMFlowProtocol protocol          = CTMFlowProtocol::Tcp;
+    std::uint8_t    addressLength     = 4;  //4 (IPv4) or 16 (IPv6)
+
+    bool operator==(const CTMNetworkFlowKey& other) const
+    {
+        return processId == other.processId && localPort == other.localPort && remotePort == other.remotePort &&
+               protocol == other.protocol && addressLength == other.addressLength &&
+               std::memcmp(localAddress, other.localAddress, sizeof(localAddress)) == 0 &&
+               std::memcmp(remoteAddress, other.remoteAddress, sizeof(remoteAddress)) == 0;
+    }
+};
+
+//What the ETW callback pushes for every network event (check ctm_process_screen_etw.h)
+struct CTMNetworkFlowRecord
+{
+    CTMNetworkFlowKey key;
+    ULONGLONG         timestamp    = 0; //QPC ticks
+    std::uint32_t     bytes        = 0;
+    CTMUsageCounter   kind         = CTMUsageCounter::TcpSent;
+    std::uint16_t     sampleWeight = 1; //Set by the pipeline when it samples, the bytes count this many times
+};
+
+struct CTMNetworkFlowEntry
+{
+    //Perfect 8 byte alignment
+    CTMNetworkFlowKey key;
+    std::uint32_t     hash                 = 0;
+    std::uint64_t     bytesSent            = 0;
+    std::uint64_t     bytesReceived        = 0;
+    std::uint64_t     sampledBytesSent     = 0;   //Totals as of the last 'UpdateRates', rates are the difference
+    std::uint64_t     sampledBytesReceived = 0;
+    ULONGLONG         firstSeen            = 0;   //QPC ticks
+    ULONGLONG         lastSeen             = 0;
+    double            sendRate             = 0.0; //Bytes per second
+    double            receiveRate          = 0.0;
+    bool              isUsed               = false;
+    bool              isReferenced         = false; //Clock bit, set on every hit and cleared by the eviction hand
+};
+
+using NetworkFlowVector = std::vector<CTMNetworkFlowEntry>;
+
+/*
+ * Every (pid, protocol, local endpoint, remote endpoint) we saw traffic on, with bytes each way and the current rate.
+ * Open addressing with linear probing in a table sized once from a memory cap, so it never allocates after construction.
+ * When it is 3/4 full, the clock hand evicts a flow which wasn't hit since the hand last passed it (roughly the least recently used one).
+ * Deletion shifts the following entries back instead of leaving tombstones, so probe chains stay short forever.
+ * 'AddBatch' holds the lock for a whole aggregator batch. The UI takes it only to refresh the rates and to copy out the flows of a single process,-
+ * -so the aggregator waits at most for one pass over the table and the UI for one batch.
+ */
+class CTMNetworkFlowTable
+{
+public:
+    explicit CTMNetworkFlowTable(std::size_t maxMemoryBytes = 2 * 1024 * 1024);
+    ~CTMNetworkFlowTable() = default;
+
+    //No need for copy or move operations
+    CTMNetworkFlowTable(const CTMNetworkFlowTable&)            = delete;
+    CTMNetworkFlowTable& operator=(const CTMNetworkFlowTable&) = delete;
+    CTMNetworkFlowTable(CTMNetworkFlowTable&&)                 = delete;
+    CTMNetworkFlowTable& operator=(CTMNetworkFlowTable&&)      = delete;
+
+public: //Main functions
+    void AddBatch(const CTMNetworkFlowRecord*, std::size_t);
+    //Turns byte deltas since the last call into rates, meant to be called on a fixed interval
+    void UpdateRates(double);
+    //Flows of a single process, fastest first, atmost 'maxCount' of them
+    void CollectProcessFlows(DWORD, NetworkFlowVector&, std::size_t);
+    void Clear();
+
+public: //Getter functions
+    std::size_t   GetEntryCount()   const { std::lock_guard<std::mutex> lock(tableMutex); return entryCount; }
+    std::uint64_t GetEvictedCount() const { std::lock_guard<std::mutex> lock(tableMutex); return evictedCount; }
+    std::size_t   GetCapacity()     const { return maxEntries; }
+    std::size_t   GetMemoryUsage()  const { return slotCount * sizeof(CTMNetworkFlowEntry); }
+
+public: //Formatting helper
+    //'1.2.3.4:80' or '[2001:db8::1]:443'
+    static void FormatEndpoint(const BYTE*, std::uint8_t, USHORT, char*, std::size_t);
+
+private: //Helper functions
+    static std::uint32_t HashKey(const CTMNetworkFlowKey&);
+    CTMNetworkFlowEntry& FindOrInsert(const CTMNetworkFlowKey&, ULONGLONG);
+    void                 EvictOne();
+    void                 EraseSlot(std::size_t);
+
+private: //Table stuff
+    std::unique_ptr<CTMNetworkFlowEntry[]> slots;
+    std::size_t   slotCount    = 0;
+    std::size_t   slotMask     = 0;
+    std::size_t   maxEntries   = 0;
+    std::size_t   entryCount   = 0;
+    std::size_t   clockHand    = 0;
+    std::uint64_t evictedCount = 0;
+    mutable std::mutex tableMutex;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,221 @@
+#include "ctm_pid_counter_table.h"
+
+CTMPidCounterTable::~CTMPidCounterTable()
+{
+    for(auto&& page : pages)
+        delete page.load(std::memory_order_relaxed);
+    for(auto&& page : retiredPages)
+        delete page;
+}
+
+//--------------------WRITER SIDE--------------------
+void CTMPidCounterTable::BeginWrite()
+{
+    //Say which epoch we write before checking it is still the current one. Paired with 'AdvanceEpoch' (both seq_cst), either we see its new epoch-
+    //-here and go with that, or it sees us in the old one and waits until 'EndWrite'
+    std::uint32_t epoch = currentEpoch.load(std::memory_order_seq_cst);
+    while(true)
+    {
+        writerState.store(epoch * 2 + 1, std::memory_order_seq_cst);
+        std::uint32_t latestEpoch = currentEpoch.load(std::memory_order_seq_cst);
+        if(latestEpoch == epoch)
+            break;
+        epoch = latestEpoch;
+    }
+    writeEpoch = epoch;
+}
+
+void CTMPidCounterTable::EndWrite()
+{
+    //Release, so the reader who sees this also sees every add before it
+    writerState.store(writerIdle, std::memory_order_release);
+}
+
+void CTMPidCounterTable::Add(DWORD processId, CTMUsageCounter counter, std::uint64_t amount)
+{
+    std::size_t        slotIndex = processId / 4;
+    CTMPidCounterPage* page      = FindOrCreatePage(slotIndex / slotsPerPage);
+    if(!page)
+    {
+        droppedCount.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    //Once per page per epoch, the rest of the time it is a load of something already in cache
+    if(page->lastWriteEpoch.load(std::memory_order_relaxed) != writeEpoch)
+        page->lastWriteEpoch.store(writeEpoch, std::memory_order_relaxed);
+
+    //Single writer and the reader never touches this set, so a load and a store is enough (no locked add)
+    std::atomic<std::uint64_t>& value = page->slots[slotIndex % slotsPerPage].counters[writeEpoch & 1][static_cast<std::size_t>(counter)];
+    value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+//--------------------READER SIDE--------------------
+void CTMPidCounterTable::AdvanceEpoch()
+{
+    //Only we change the epoch. The set we read last time becomes the writer's next one, it has to start from 0
+    std::uint32_t epoch = currentEpoch.load(std::memory_order_relaxed);
+    ClearSet((epoch + 1) & 1);
+
+    //A batch still adding to the old epoch is atmost a thousand records away from done
+    currentEpoch.store(epoch + 1, std::memory_order_seq_cst);
+    while(writerState.load(std::memory_order_seq_cst) == epoch * 2 + 1)
+        std::this_thread::yield();
+
+    ReclaimIdlePages();
+}
+
+std::uint64_t CTMPidCounterTable::Read(DWORD processId, CTMUsageCounter counter) const
+{
+    CTMPidCounterSlot* slot = FindSlot(processId);
+    return slot ? slot->counters[GetReadSet()][static_cast<std::size_t>(counter)].load(std::memory_order_relaxed) : 0;
+}
+
+void CTMPidCounterTable::ReadAll(DWORD processId, std::uint64_t* outValues) const
+{
+    CTMPidCounterSlot* slot    = FindSlot(processId);
+    std::size_t        readSet = GetReadSet();
+    for(std::size_t i = 0; i < static_cast<std::size_t>(CTMUsageCounter::Count); i++)
+        outValues[i] = slot ? slot->counters[readSet][i].load(std::memory_order_relaxed) : 0;
+}
+
+void CTMPidCounterTable::Clear()
+{
+    //Pages stay allocated, the same pid ranges will most likely be used again
+    ClearSet(0);
+    ClearSet(1);
+    for(auto&& page : retiredPages)
+    {
+        delete page;
+        page = nullptr;
+    }
+    droppedCount.store(0, std::memory_order_relaxed);
+}
+
+void CTMPidCounterTable::CollectPendingProcessIds(std::vector<DWORD>& outProcessIds) const
+{
+    outProcessIds.clear();
+    std::size_t readSet = GetReadSet();
+    for(std::size_t pageIndex = 0; pageIndex < maxPages; pageIndex++)
+    {
+        CTMPidCounterPage* page = pages[pageIndex].load(std::memory_order_acquire);
+        if(!page)
+            continue;
+
+        for(std::size_t slotIndex = 0; slotIndex < slotsPerPage; slotIndex++)
+        {
+            auto&& counters = page->slots[slotIndex].counters[readSet];
+            bool   isPending = std::any_of(std::begin(counters), std::end(counters),
+                                           [](const std::atomic<std::uint64_t>& value){ return value.load(std::memory_order_relaxed) != 0; });
+            if(isPending)
+                outProcessIds.push_back(static_cast<DWORD>((pageIndex * slotsPerPage + slotIndex) * 4));
+        }
+    }
+}
+
+std::size_t CTMPidCounterTable::GetAllocatedPageCount() const
+{
+    std::size_t pageCount = 0;
+    for(auto&& page : pages)
+        if(page.load(std::memory_order_relaxed))
+            ++pageCount;
+    return pageCount;
+}
+
+//--------------------HELPER FUNCTIONS--------------------
+CTMPidCounterSlot* CTMPidCounterTable::FindSlot(DWORD processId) const
+{
+    std::size_t slotIndex = processId / 4;
+    std::size_t pageIndex = slotIndex / slotsPerPage;
+    if(pageIndex >= maxPages)
+        return nullptr;
+
+    //Not allocated (or freed) means nothing was added for this range lately
+    CTMPidCounterPage* page = pages[pageIndex].load(std::memory_order_acquire);
+    return page ? &page->slots[slotIndex % slotsPerPage] : nullptr;
+}
+
+CTMPidCounterPage* CTMPidCounterTable::FindOrCreatePage(std::size_t pageIndex)
+{
+    if(pageIndex >= maxPages)
+        return nullptr;
+
+    CTMPidCounterPage* page = pages[pageIndex].load(std::memory_order_acquire);
+    if(!page)
+    {
+        //Only happens once per range. If someone else won the race (the reader folding a freed page back), use theirs and throw ours away
+        CTMPidCounterPage* newPage = new CTMPidCounterPage();
+        if(pages[pageIndex].compare_exchange_strong(page, newPage, std::memory_order_acq_rel, std::memory_order_acquire))
+            page = newPage;
+        else
+            delete newPage;
+    }
+
+    return page;
+}
+
+void CTMPidCounterTable::ClearSet(std::size_t counterSet)
+{
+    for(auto&& page : pages)
+    {
+        CTMPidCounterPage* pagePtr = page.load(std::memory_order_acquire);
+        if(!pagePtr)
+            continue;
+
+        for(auto&& slot : pagePtr->slots)
+            for(auto&& value : slot.counters[counterSet])
+                value.store(0, std::memory_order_relaxed);
+    }
+}
+
+void CTMPidCounterTable::ReclaimIdlePages()
+{
+    //Unlink pages nobody added to in a while. Their sets are both 0 by now (each was read and cleared since), so nothing is lost
+    std::uint32_t epoch = currentEpoch.load(std::memory_order_relaxed);
+    CTMPidCounterPage* unlinkedPages[maxPages] = {};
+    for(std::size_t pageIndex = 0; pageIndex < maxPages; pageIndex++)
+    {
+        CTMPidCounterPage* page = pages[pageIndex].load(std::memory_order_acquire);
+        if(!page || epoch - page->lastWriteEpoch.load(std::memory_order_relaxed) <= pageRetireEpochs)
+            continue;
+
+        pages[pageIndex].store(nullptr, std::memory_order_seq_cst);
+        unlinkedPages[pageIndex] = page;
+    }
+
+    //Unlinked one swap ago, the wait in 'AdvanceEpoch' made sure the writer is done with them. Done after the unlinking above-
+    //-so a page the fold has to create isn't unlinked again before anyone read it
+    for(std::size_t pageIndex = 0; pageIndex < maxPages; pageIndex++)
+    {
+        if(retiredPages[pageIndex])
+        {
+            FoldRetiredPage(pageIndex, retiredPages[pageIndex]);
+            delete retiredPages[pageIndex];
+            freedPageCount.fetch_add(1, std::memory_order_relaxed);
+        }
+        retiredPages[pageIndex] = unlinkedPages[pageIndex];
+    }
+}
+
+void CTMPidCounterTable::FoldRetiredPage(std::size_t pageIndex, CTMPidCounterPage* retiredPage)
+{
+    //A batch which found the page before it was unlinked may have added to it, that went into the epoch we just handed to ourselves.
+    //The writer is on the next one, so the read set of the live page is ours to add to
+    std::uint32_t epoch = currentEpoch.load(std::memory_order_relaxed);
+    if(retiredPage->lastWriteEpoch.load(std::memory_order_relaxed) + 1 != epoch)
+        return;
+
+    std::size_t        readSet  = GetReadSet();
+    CTMPidCounterPage* livePage = FindOrCreatePage(pageIndex);
+    for(std::size_t slotIndex = 0; slotIndex < slotsPerPage; slotIndex++)
+    {
+        for(std::size_t i = 0; i < static_cast<std::size_t>(CTMUsageCounter::Count); i++)
+        {
+            std::uint64_t amount = retiredPage->slots[slotIndex].counters[readSet][i].load(std::memory_order_relaxed);
+            if(amount == 0)
+                continue;
+            std::atomic<std::uint64_t>& value = livePage->slots[slotIndex].counters[readSet][i];
+            value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+        }
+    }
+}
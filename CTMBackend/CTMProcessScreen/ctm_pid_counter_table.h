@@ -0,0 +1,115 @@
+#ifndef CTM_PID_COUNTER_TABLE_HPP
+#define CTM_PID_COUNTER_TABLE_HPP
+
+//Windows stuff
+#include <windows.h>
+//Stdlib stuff
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <iterator>
+#include <cstdint>
+
+//Counters every pid gets (bytes), add new ones before 'Count'
+enum class CTMUsageCounter : std::uint8_t
+{
+    TcpSent,
+    TcpReceived,
+    UdpSent,
+    UdpReceived,
+    FileRead,
+    FileWrite,
+    Count
+};
+
+//Counters of a single pid, one fixed size record per possible pid (so splitting usage up costs no extra lookups).
+//Two sets of them, the writer adds to the current epoch's set while the reader goes through the previous one
+struct CTMPidCounterSlot
+{
+    std::atomic<std::uint64_t> counters[2][static_cast<std::size_t>(CTMUsageCounter::Count)] = {};
+};
+
+//A chunk of consecutive pid slots, allocated the first time any pid in its range gets an event
+struct CTMPidCounterPage
+{
+    std::atomic<std::uint32_t> lastWriteEpoch = 0; //Newest epoch anything was added in, idle pages get freed by its age
+    CTMPidCounterSlot          slots[1024];
+};
+
+/*
+ * Per pid usage counters which the aggregator thread adds to and the process screen reads once per update, without either of them taking a lock.
+ * Windows pids are indices into the kernel's client id table times 4 and get reused aggressively, so they stay small and dense.
+ * That makes 'pid / 4' a perfectly good slot index, no hashing, probing or deleting. Pages of slots are allocated on demand.
+ * Counters are double buffered by epoch: the writer adds to epoch N, 'AdvanceEpoch' (once per update) moves it to N + 1 and hands N to the reader,
+ * who reads it with plain loads. The set it hands back to the writer on the next swap is zeroed in bulk, so reads don't write anything per pid.
+ * Single writer: 'Add' only between 'BeginWrite' and 'EndWrite', the swap waits for a write in progress to end (atmost one aggregator batch).
+ * A page nobody added to for 'pageRetireEpochs' swaps is freed, one swap after it was unlinked so the writer can't still be holding it.
+ * Pids beyond the covered range are not counted, 'GetDroppedCount' says if that ever happened.
+ */
+class CTMPidCounterTable
+{
+public:
+    CTMPidCounterTable() = default;
+    ~CTMPidCounterTable();
+
+    //No need for copy or move operations
+    CTMPidCounterTable(const CTMPidCounterTable&)            = delete;
+    CTMPidCounterTable& operator=(const CTMPidCounterTable&) = delete;
+    CTMPidCounterTable(CTMPidCounterTable&&)                 = delete;
+    CTMPidCounterTable& operator=(CTMPidCounterTable&&)      = delete;
+
+public: //Writer side (aggregator thread)
+    //Picks up the epoch to add to, everything until 'EndWrite' goes there
+    void BeginWrite();
+    void EndWrite();
+    void Add(DWORD, CTMUsageCounter, std::uint64_t);
+
+public: //Reader side (process screen, once per update)
+    //Hands the epoch written since the last call to the reader, frees pages which have been idle for long enough
+    void          AdvanceEpoch();
+    //Amount added in the epoch handed over by the last 'AdvanceEpoch'
+    std::uint64_t Read(DWORD, CTMUsageCounter) const;
+    //Same as 'Read' but for every counter of a pid with a single lookup, out array has 'CTMUsageCounter::Count' values
+    void          ReadAll(DWORD, std::uint64_t*) const;
+    //Nothing may be writing, zeroes both epochs
+    void          Clear();
+    //Every pid with something in the read epoch, for when there is no process list to go by (benchmarks)
+    void          CollectPendingProcessIds(std::vector<DWORD>&) const;
+
+public: //Getter functions
+    std::uint64_t GetDroppedCount()       const { return droppedCount.load(std::memory_order_relaxed); }
+    std::size_t   GetAllocatedPageCount() const;
+    std::uint64_t GetFreedPageCount()     const { return freedPageCount.load(std::memory_order_relaxed); }
+
+private: //Helper functions
+    CTMPidCounterSlot* FindSlot(DWORD) const;
+    CTMPidCounterPage* FindOrCreatePage(std::size_t);
+    std::size_t        GetReadSet() const { return (currentEpoch.load(std::memory_order_relaxed) + 1) & 1; }
+    void               ClearSet(std::size_t);
+    void               ReclaimIdlePages();
+    void               FoldRetiredPage(std::size_t, CTMPidCounterPage*);
+
+private: //Constant stuff
+    constexpr static std::size_t   slotsPerPage     = sizeof(CTMPidCounterPage::slots) / sizeof(CTMPidCounterSlot);
+    constexpr static std::size_t   maxPages         = 256; //Covers pids below 4 * 1024 * 256 = 1048576
+    //A minute worth of updates, process ids come back in ranges so freeing a page right away would only allocate it again
+    constexpr static std::uint32_t pageRetireEpochs = 60;
+    //'writerState' when the writer is between writes, an epoch in progress is stored as 'epoch * 2 + 1' so it can't be mistaken for it
+    constexpr static std::uint32_t writerIdle       = 0;
+
+private: //Table stuff
+    std::atomic<CTMPidCounterPage*> pages[maxPages] = {};
+    std::atomic<std::uint64_t>      droppedCount    = 0;
+
+private: //Epoch stuff
+    std::atomic<std::uint32_t> currentEpoch = 1; //Writes go to 'currentEpoch & 1', reads to the other set
+    std::atomic<std::uint32_t> writerState  = writerIdle;
+    std::uint32_t              writeEpoch   = 1; //Writer only, the epoch 'BeginWrite' picked up
+    //Reader only, unlinked by the last swap and freed by the next one
+    CTMPidCounterPage*         retiredPages[maxPages] = {};
+    std::atomic<std::uint64_t> freedPageCount         = 0;
+};
+
+#endif
\ No newline at end of file
@@ -12,7 +12,7 @@ CTMProcessScreen::CTMProcessScreen()
     if(!CTMConstructorInitNTDLL())
         return;
 
-    //Start a new thread for event tracing
+    //Ask the event session for the providers we need (it starts on the first screen asking)
     if(!CTMConstructorInitEventTracingThread())
         return;
 
@@ -66,57 +66,46 @@ bool CTMProcessScreen::CTMConstructorInitNTDLL()
 
 bool CTMProcessScreen::CTMConstructorInitEventTracingThread()
 {
-    if(!processUsageEventTracing.Start())
+    //The session outlives the screen (check ctm_event_session_manager.h), all we do is tell it what we need
+    if(!eventSessionManager.AcquireProvider(CTMEventProvider::KernelNetwork))
+        return false;
+    if(!eventSessionManager.AcquireProvider(CTMEventProvider::KernelFile))
     {
-        CTM_LOG_ERROR("Failed to start event tracing. Look at the above errors for more information.");
+        eventSessionManager.ReleaseProvider(CTMEventProvider::KernelNetwork);
         return false;
     }
-
-    //After we start the etw, most of the things can go wrong if god doesn't like you (yes you, the user of this program)
-    //Register a cleanup function to prevent this from happening
-    resourceGuard.RegisterCleanupFunction(etwCleanupFunctionName, [this](){
-        processUsageEventTracing.Stop();
-    });
-
-    //Will indicate success or failure by getting the response from thread
-    std::atomic<bool> initSuccess{true};
-
-    processUsageEventTracingThread = std::thread([this, &initSuccess](){
-        //Now call ProcessEvents which should block this thread until it is stopped (if it did not fail that is)
-        if(!processUsageEventTracing.ProcessEvents())
-            initSuccess.store(false);
-    });
-
-    //Sleep for 10ms which allows the above thread to start and do stuff. This way, we get an idea if the thread failed or not
-    std::this_thread::sleep_for(std::chrono::milliseconds(10));
-
-    //If ProcessEvents failed, stop the event tracing entirely
-    if(!initSuccess.load())
+    //Process start/stop is nice to have, the screen works fine without it (short lived processes just won't show up)
+    isProcessProviderAcquired = eventSessionManager.AcquireProvider(CTMEventProvider::KernelProcess);
+    if(!isProcessProviderAcquired)
+        CTM_LOG_WARNING("Process start/exit events are not available, short lived processes won't be tracked.");
+    isEventTracingAcquired = true;
+
+    //Whatever piled up in the usage table while we were away would show up as one big spike, swap it out so the first update only has its own
+    globalProcessUsageTable.AdvanceEpoch();
+    //Same goes for the processes which exited meanwhile, we never polled them so their whole lifetime would land on our first update
     {
-        CTM_LOG_ERROR("Failed to process events for event tracing.");
-        processUsageEventTracing.Stop();
-        if(processUsageEventTracingThread.joinable())
-            processUsageEventTracingThread.join(); //Ensure the thread has finished before returning
-
-        //Unregister the cleanup function as all the cleaning work is already done above
-        resourceGuard.UnregisterCleanupFunction(etwCleanupFunctionName);
-        return false;
+        std::lock_guard<std::mutex> lock(globalPsEtwMutex);
+        globalExitedProcessVector.clear();
     }
-
-    //If initialization succeeded, return true
     return true;
 }
 
 void CTMProcessScreen::CTMDestructorCleanEventTracingThread()
 {
-    processUsageEventTracing.Stop();
-    if(processUsageEventTracingThread.joinable())
-        processUsageEventTracingThread.join();
-    
-    //The process was successfully RAII destructed, no need for the cleanup function anymore, say bye bye to it
-    resourceGuard.UnregisterCleanupFunction(etwCleanupFunctionName);
-    
-    CTM_LOG_INFO("Event Tracing Thread destroyed successfully.");
+    //Acquired on its own from the toolbar, so it may be held even if the rest isn't
+    if(isReadyProviderAcquired)
+        eventSessionManager.ReleaseProvider(CTMEventProvider::KernelReadyThread);
+    isReadyProviderAcquired = false;
+
+    if(!isEventTracingAcquired)
+        return;
+
+    //Session and tables keep going, the providers stay enabled for a while in case we come right back
+    eventSessionManager.ReleaseProvider(CTMEventProvider::KernelNetwork);
+    eventSessionManager.ReleaseProvider(CTMEventProvider::KernelFile);
+    if(isProcessProviderAcquired)
+        eventSessionManager.ReleaseProvider(CTMEventProvider::KernelProcess);
+    isEventTracingAcquired = false;
 }
 
 void CTMProcessScreen::CTMDestructorCleanMappedHandles()
@@ -135,15 +124,22 @@ void CTMProcessScreen::CTMDestructorCleanMappedHandles()
 //--------------------MAIN RENDER AND UPDATE FUNCTIONS--------------------
 void CTMProcessScreen::OnRender()
 {
-    if(ImGui::BeginTable("ProcessesTable", 6, ImGuiTableFlags_SizingStretchProp | ImGuiTableFlags_BordersInnerV |
-                                               ImGuiTableFlags_Resizable | ImGuiTableFlags_ScrollX))
+    RenderGroupingToolbar();
+
+    //Job mode has its own table, the image name table is the default one
+    if(groupingMode == ProcessGroupingMode::JobObject)
+        RenderJobTable();
+    else if(ImGui::BeginTable("ProcessesTable", readyLatencyColumnIndex + 1, ImGuiTableFlags_SizingStretchProp |
+                                ImGuiTableFlags_BordersInnerV | ImGuiTableFlags_Resizable | ImGuiTableFlags_ScrollX | ImGuiTableFlags_Hideable))
     {
-        ImGui::TableSetupColumn("Name", ImGuiTableColumnFlags_WidthFixed);
+        ImGui::TableSetupColumn("Name", ImGuiTableColumnFlags_WidthFixed | ImGuiTableColumnFlags_NoHide);
         ImGui::TableSetupColumn("PID", ImGuiTableColumnFlags_WidthFixed);
         ImGui::TableSetupColumn("CPU (%)", ImGuiTableColumnFlags_WidthFixed);
         ImGui::TableSetupColumn("Memory (MB)", ImGuiTableColumnFlags_WidthFixed);
-        ImGui::TableSetupColumn("Network (MB/s)", ImGuiTableColumnFlags_WidthFixed);
-        ImGui::TableSetupColumn("File RW (MB/s)", ImGuiTableColumnFlags_WidthFixed);
+        //Right click on the header to hide the ones you don't care about
+        for(auto&& columnName : ioUsageColumnNames)
+            ImGui::TableSetupColumn(columnName, ImGuiTableColumnFlags_WidthFixed);
+        ImGui::TableSetupColumn("Ready p99 (ms)", ImGuiTableColumnFlags_WidthFixed);
 
         ImGui::TableHeadersRow();
 
@@ -199,27 +195,40 @@ void CTMProcessScreen::OnRender()
             if(appProcesses.size() == 1)
                 ImGui::Text("%d", appProcesses[0].processId);
             
-            //Third, fourth and fith column -> Display total usage initially
-            double totalCPUUsage = 0.0, totalMemoryUsage = 0.0, totalNetworkUsage = 0.0, totalFileUsage = 0.0;
+            //Rest of the columns -> Display total usage initially
+            double         totalCPUUsage = 0.0, totalMemoryUsage = 0.0;
+            ProcessIoUsage totalIoUsage;
+            bool           isAnyCpuAnomaly = false, isAnyMemoryAnomaly = false;
             for(auto&& process : appProcesses)
             {
                 totalCPUUsage      += process.cpuUsage;
                 totalMemoryUsage   += process.memoryUsage;
-                totalNetworkUsage  += process.networkUsage;
-                totalFileUsage     += process.fileUsage;
+                totalIoUsage       += process.ioUsage;
+                isAnyCpuAnomaly    |= (process.isCpuAnomaly == TRUE);
+                isAnyMemoryAnomaly |= (process.isMemoryAnomaly == TRUE);
             }
 
+            //Children which exited since the last update still used CPU, count it here (check 'AttributeExitedProcesses')
+            auto   exitedCpuIt         = exitedChildCpuUsageMap.find(appName);
+            double exitedChildCpuUsage = exitedCpuIt != exitedChildCpuUsageMap.end() ? exitedCpuIt->second : 0.0;
+
             ImGui::TableSetColumnIndex(2);
-            ImGui::Text("%.2lf", totalCPUUsage);
+            ImGui::Text("%.2lf", totalCPUUsage + exitedChildCpuUsage);
+            if(exitedChildCpuUsage > 0.0)
+                ImGui::SetItemTooltip("Includes %.2lf%% from exited child processes", exitedChildCpuUsage);
+            if(isAnyCpuAnomaly)
+                ImGui::TableSetBgColor(ImGuiTableBgTarget_CellBg, anomalyCellColorU32);
 
             ImGui::TableSetColumnIndex(3);
             ImGui::Text("%.2lf", totalMemoryUsage);
+            if(isAnyMemoryAnomaly)
+                ImGui::TableSetBgColor(ImGuiTableBgTarget_CellBg, anomalyCellColorU32);
 
-            ImGui::TableSetColumnIndex(4);
-            ImGui::Text("%.2lf", totalNetworkUsage);
+            RenderIoUsageColumns(totalIoUsage, 4);
 
-            ImGui::TableSetColumnIndex(5);
-            ImGui::Text("%.2lf", totalFileUsage);
+            //Merged histograms of the group, not the worst process' p99
+            auto groupReadyIt = groupReadyLatencyMap.find(appName);
+            RenderReadyLatencyColumn(groupReadyIt != groupReadyLatencyMap.end() ? &groupReadyIt->second : nullptr);
 
             //If we expand the tree, display rest of the details
             if(expandTree)
@@ -231,16 +240,47 @@ void CTMProcessScreen::OnRender()
             }
         }
 
+        //Exited processes whose parent is gone too, they still used CPU
+        if(unattributedExitedCpuUsage > 0.0)
+        {
+            ImGui::TableNextRow();
+            ImGui::TableSetColumnIndex(0);
+            ImGui::TextDisabled("<Exited Processes>");
+            ImGui::TableSetColumnIndex(2);
+            ImGui::Text("%.2lf", unattributedExitedCpuUsage);
+        }
+
         ImGui::EndTable();
     }
 
     //Render any popup which 'popped up' during the loop
     RenderProcessOptionsPopup();
+    //Control and profiler windows stay open (if opened) until the user closes them
+    RenderProcessControlWindow();
+    RenderProcessProfilerWindow();
+    RenderExitedProcessesWindow();
+    RenderProcessDetailsWindow();
+    RenderTopFilesWindow();
+    RenderEventTracingDiagnosticsWindow();
 }
 
 void CTMProcessScreen::OnUpdate()
 {
     UpdateProcessInfo();
+    //Rates are per update, has to run even with nobody looking so the first look isn't a huge spike
+    globalNetworkFlowTable.UpdateRates(1.0);
+    UpdateProcessDetailsHistory();
+    UpdateProcessDetailsFlows();
+    UpdateTopFiles();
+    UpdateReadyLatencies();
+    UpdateEventTracingDiagnostics();
+
+    //Job accounting is only read when someone is looking at it
+    if(groupingMode == ProcessGroupingMode::JobObject)
+    {
+        jobTracker.Update();
+        RebuildProcessLookupMap();
+    }
 }
 
 //--------------------HELPER FUNCTIONS--------------------
@@ -283,15 +323,18 @@ void CTMProcessScreen::RenderProcessVector(ProcessInfoVector& appProcesses, cons
 
         ImGui::TableSetColumnIndex(2);
         ImGui::Text("%.2lf", process.cpuUsage);
+        if(process.isCpuAnomaly)
+            ImGui::TableSetBgColor(ImGuiTableBgTarget_CellBg, anomalyCellColorU32);
 
         ImGui::TableSetColumnIndex(3);
         ImGui::Text("%.2lf", process.memoryUsage);
+        if(process.isMemoryAnomaly)
+            ImGui::TableSetBgColor(ImGuiTableBgTarget_CellBg, anomalyCellColorU32);
 
-        ImGui::TableSetColumnIndex(4);
-        ImGui::Text("%.2lf", process.networkUsage);
+        RenderIoUsageColumns(process.ioUsage, 4);
 
-        ImGui::TableSetColumnIndex(5);
-        ImGui::Text("%.2lf", process.fileUsage);
+        auto readyIt = processReadyLatencyMap.find(process.processId);
+        RenderReadyLatencyColumn(readyIt != processReadyLatencyMap.end() ? &readyIt->second : nullptr);
     }
 }
 
@@ -342,6 +385,64 @@ void CTMProcessScreen::RenderProcessOptionsPopup()
 
         if(!canTerminate)
             ImGui::EndDisabled();
+
+        //Open the control window for this target, the window itself does the batching
+        if(ImGui::MenuItem("Priority And Affinity..."))
+        {
+            controlTargetVariant = processVariant;
+            if(isProcessGroup)
+                controlTargetGroupKey = std::get<std::string>(processVariant);
+            else
+            {
+                //Find the group this process belongs to, needed for the 'Whole Group' scope
+                DWORD processId = std::get<DWORD>(processVariant);
+                controlTargetGroupKey.clear();
+                for(auto&& [groupKey, processVector] : groupedProcessesMap)
+                {
+                    auto it = std::find_if(processVector.begin(), processVector.end(),
+                                           [processId](const ProcessInfo& process){ return process.processId == processId; });
+                    if(it != processVector.end())
+                    {
+                        controlTargetGroupKey = groupKey;
+                        break;
+                    }
+                }
+            }
+
+            isControlWindowOpen = true;
+            ImGui::CloseCurrentPopup();
+        }
+
+        //Network and file usage over time, split by direction and protocol
+        if(!isProcessGroup && ImGui::MenuItem("Details..."))
+        {
+            if(detailsTargetProcessId != std::get<DWORD>(processVariant))
+            {
+                detailsTargetProcessId = std::get<DWORD>(processVariant);
+                detailsPeakUsage       = {};
+                detailsElapsedTime     = 0.0;
+                detailsHistoryTime.clear();
+                for(auto&& history : detailsHistory)
+                    history.clear();
+                detailsFlows.clear();
+                detailsFiles.clear();
+                detailsReadLatency  = {};
+                detailsWriteLatency = {};
+                detailsReadyLatency = {};
+                detailsReadyThreads.clear();
+            }
+
+            isDetailsWindowOpen = true;
+            ImGui::CloseCurrentPopup();
+        }
+
+        //Profiling only makes sense for a single process
+        if(!isProcessGroup && ImGui::MenuItem("Profile..."))
+        {
+            profilerTargetProcessId = std::get<DWORD>(processVariant);
+            isProfilerWindowOpen    = true;
+            ImGui::CloseCurrentPopup();
+        }
         
         //Close the popup
         if(ImGui::MenuItem("Back"))
@@ -351,6 +452,807 @@ void CTMProcessScreen::RenderProcessOptionsPopup()
     }
 }
 
+void CTMProcessScreen::RenderProcessControlWindow()
+{
+    if(!isControlWindowOpen)
+        return;
+
+    if(ImGui::Begin("Process Control", &isControlWindowOpen, ImGuiWindowFlags_AlwaysAutoResize))
+    {
+        bool isProcessGroup = std::holds_alternative<std::string>(controlTargetVariant);
+        if(isProcessGroup)
+            ImGui::Text("Target -> Process Group %s", controlTargetGroupKey.c_str());
+        else
+            ImGui::Text("Target -> PID %lu (%s)", std::get<DWORD>(controlTargetVariant), controlTargetGroupKey.c_str());
+
+        ImGui::Separator();
+
+        //Collect the targets on the UI thread (the map is only touched here), apply them on the worker thread
+        if(processControl.RenderControls(isProcessGroup))
+        {
+            ProcessControlTargetVector targetProcessIds;
+            CollectProcessControlTargets(targetProcessIds);
+            if(processControl.ApplyAsync(std::move(targetProcessIds)))
+                CTM_LOG_INFO("Applying process control batch, check the results in the control window.");
+        }
+
+        processControl.RenderResults();
+    }
+    ImGui::End();
+}
+
+void CTMProcessScreen::RenderProcessProfilerWindow()
+{
+    if(!isProfilerWindowOpen)
+        return;
+
+    ImGui::SetNextWindowSize({700.0f, 500.0f}, ImGuiCond_FirstUseEver);
+    if(ImGui::Begin("Process Profiler", &isProfilerWindowOpen))
+    {
+        ImGui::Text("Target -> PID %lu", profilerTargetProcessId);
+        ImGui::Separator();
+        processProfiler.Render(profilerTargetProcessId);
+    }
+    ImGui::End();
+
+    //Closing the window stops the sampling, no point in suspending threads for nobody
+    if(!isProfilerWindowOpen)
+        processProfiler.Stop();
+}
+
+void CTMProcessScreen::RenderGroupingToolbar()
+{
+    ImGui::TextUnformatted("Group By");
+    ImGui::SameLine();
+    ImGui::SetNextItemWidth(150.0f);
+
+    int groupingModeIndex = static_cast<int>(groupingMode);
+    if(ImGui::Combo("##ProcessGroupingMode", &groupingModeIndex, "Image Name\0Job Object\0"))
+    {
+        groupingMode = static_cast<ProcessGroupingMode>(groupingModeIndex);
+        //Don't wait for the next update to show something
+        if(groupingMode == ProcessGroupingMode::JobObject)
+        {
+            jobTracker.RequestRescan();
+            jobTracker.Update();
+            RebuildProcessLookupMap();
+        }
+    }
+
+    ImGui::SameLine();
+    if(ImGui::Button("Recently Exited"))
+        isExitedWindowOpen = true;
+
+    ImGui::SameLine();
+    if(ImGui::Button("Top Files"))
+    {
+        //Don't wait for the next update to show something
+        isTopFilesWindowOpen = true;
+        UpdateTopFiles();
+    }
+
+    //Off by default, on a busy machine it is two more events for every context switch
+    ImGui::SameLine();
+    bool isReadyLatencyWanted = isReadyProviderAcquired;
+    if(ImGui::Checkbox("Ready Latency", &isReadyLatencyWanted))
+    {
+        if(isReadyLatencyWanted)
+        {
+            isReadyProviderAcquired = eventSessionManager.AcquireProvider(CTMEventProvider::KernelReadyThread);
+            if(!isReadyProviderAcquired)
+                CTM_LOG_WARNING("Ready thread events are not available, the ready latency column stays empty. Check the above errors for more information.");
+        }
+        else
+        {
+            eventSessionManager.ReleaseProvider(CTMEventProvider::KernelReadyThread);
+            isReadyProviderAcquired = false;
+        }
+        UpdateReadyLatencies();
+    }
+    if(ImGui::IsItemHovered())
+        ImGui::SetTooltip("How long threads wait for a core once they are ready to run (p99 since it was turned on).\n"
+                          "High CPU usage means a process runs a lot, a long wait with low CPU usage means it wants to run and can't.");
+
+    ImGui::SameLine();
+    if(ImGui::Button("Diagnostics"))
+    {
+        //Rates need two updates, until then only the totals are shown
+        isDiagnosticsWindowOpen = true;
+        latestDiagnostics       = eventSessionManager.GetDiagnostics();
+        eventsReceivedPerSecond = 0.0;
+        ringDropsPerSecond      = 0.0;
+        aggregationNsPerEvent   = 0.0;
+    }
+
+    //Network/file columns are estimates while this is up, say so where it is seen without opening anything
+    std::uint32_t samplingRatio = globalUsageEventPipeline.GetSamplingRatio();
+    if(samplingRatio > 1)
+    {
+        ImGui::SameLine();
+        ImGui::TextColored({1.0f, 0.8f, 0.3f, 1.0f}, "Sampling 1 in %u events", samplingRatio);
+        if(ImGui::IsItemHovered())
+            ImGui::SetTooltip("Events are coming in faster than they can be kept up with, so only 1 in %u is looked at.\n"
+                              "Network and file numbers are scaled back up and are estimates until the rate drops.", samplingRatio);
+    }
+
+    //Polled by the session manager once a second, so it shows up even with the diagnostics window closed
+    if(eventSessionManager.HasRecentEventLoss())
+    {
+        ImGui::SameLine();
+        ImGui::TextColored({1.0f, 0.4f, 0.4f, 1.0f}, "Events lost, network/file usage is incomplete");
+        if(ImGui::IsItemHovered())
+            ImGui::SetTooltip("%llu events (or whole buffers) were lost since the session started, the latest within the last 30 seconds.\n"
+                              "Network and file numbers are lower than reality. The session grows its buffers when this happens,\n"
+                              "they can also be set in Settings -> Event Tracing Settings.",
+                              static_cast<unsigned long long>(eventSessionManager.GetEventsLost()));
+    }
+
+    if(groupingMode == ProcessGroupingMode::JobObject && !jobTracker.IsAvailable())
+    {
+        ImGui::SameLine();
+        ImGui::TextColored({1.0f, 0.4f, 0.4f, 1.0f}, "Job objects are not available, check the logs.");
+    }
+}
+
+void CTMProcessScreen::RenderExitedProcessesWindow()
+{
+    if(!isExitedWindowOpen)
+        return;
+
+    ImGui::SetNextWindowSize({750.0f, 400.0f}, ImGuiCond_FirstUseEver);
+    if(ImGui::Begin("Recently Exited Processes", &isExitedWindowOpen))
+    {
+        ImGui::Text("Exited since the screen opened: %llu | Showing the last %zu", 
+                    static_cast<unsigned long long>(exitedProcessCount), recentlyExitedProcesses.size());
+        ImGui::Separator();
+
+        if(ImGui::BeginTable("ExitedProcessesTable", 8, ImGuiTableFlags_SizingStretchProp | ImGuiTableFlags_BordersInnerV |
+                                                        ImGuiTableFlags_Resizable | ImGuiTableFlags_ScrollY))
+        {
+            ImGui::TableSetupScrollFreeze(0, 1);
+            ImGui::TableSetupColumn("Name");
+            ImGui::TableSetupColumn("PID");
+            ImGui::TableSetupColumn("Parent PID");
+            ImGui::TableSetupColumn("Lifetime (s)");
+            ImGui::TableSetupColumn("CPU (s)");
+            ImGui::TableSetupColumn("Read (MB)");
+            ImGui::TableSetupColumn("Write (MB)");
+            ImGui::TableSetupColumn("Exit Code");
+            ImGui::TableHeadersRow();
+
+            ImGuiListClipper clipper;
+            clipper.Begin(static_cast<int>(recentlyExitedProcesses.size()));
+            while(clipper.Step())
+            {
+                for(int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++)
+                {
+                    const CTMExitedProcessInfo& exitedProcess = recentlyExitedProcesses[i];
+                    ImGui::TableNextRow();
+
+                    ImGui::TableSetColumnIndex(0);
+                    ImGui::TextUnformatted(exitedProcess.imageName.c_str());
+                    ImGui::TableSetColumnIndex(1);
+                    ImGui::Text("%lu", exitedProcess.processId);
+                    ImGui::TableSetColumnIndex(2);
+                    if(exitedProcess.parentProcessId)
+                        ImGui::Text("%lu", exitedProcess.parentProcessId);
+                    else
+                        ImGui::TextDisabled("?");
+                    ImGui::TableSetColumnIndex(3);
+                    if(exitedProcess.exitTime > exitedProcess.createTime && exitedProcess.createTime)
+                        ImGui::Text("%.3lf", (exitedProcess.exitTime - exitedProcess.createTime) / 1e7);
+                    else
+                        ImGui::TextDisabled("?");
+                    //CPU time is estimated from cycles when we couldn't get a handle before the process went away
+                    ImGui::TableSetColumnIndex(4);
+                    ImGui::Text(exitedProcess.isCpuTimeExact ? "%.3lf" : "~%.3lf", exitedProcess.cpuTime / 1e7);
+                    if(!exitedProcess.isCpuTimeExact)
+                        ImGui::SetItemTooltip("Estimated from the CPU cycle count");
+                    ImGui::TableSetColumnIndex(5);
+                    ImGui::Text("%.2lf", exitedProcess.readBytes / (1024.0 * 1024.0));
+                    ImGui::TableSetColumnIndex(6);
+                    ImGui::Text("%.2lf", exitedProcess.writeBytes / (1024.0 * 1024.0));
+                    ImGui::TableSetColumnIndex(7);
+                    ImGui::Text("0x%lX", exitedProcess.exitCode);
+                }
+            }
+
+            ImGui::EndTable();
+        }
+    }
+    ImGui::End();
+}
+
+void CTMProcessScreen::RenderEventTracingDiagnosticsWindow()
+{
+    if(!isDiagnosticsWindowOpen)
+        return;
+
+    ImGui::SetNextWindowSize({500.0f, 450.0f}, ImGuiCond_FirstUseEver);
+    if(ImGui::Begin("Event Tracing Diagnostics", &isDiagnosticsWindowOpen))
+    {
+        //Anything lost anywhere means the network/file columns are lower than reality
+        bool isLosingEvents = latestDiagnostics.ringDrops > 0 || latestDiagnostics.etwEventsLost > 0 ||
+                              latestDiagnostics.etwRealTimeBuffersLost > 0 || latestDiagnostics.lostEventNotifications > 0;
+        ImGui::Text("Event source -> %s", eventSessionManager.GetSourceName());
+        if(!eventSessionManager.IsRunning())
+            ImGui::TextColored({1.0f, 0.4f, 0.4f, 1.0f}, "Event session stopped, check the logs. Switching screens starts it again.");
+        if(isLosingEvents)
+            ImGui::TextColored({1.0f, 0.4f, 0.4f, 1.0f}, "Events are being lost, network and file usage is under reported.");
+        else
+            ImGui::TextUnformatted("No events lost so far.");
+        if(latestDiagnostics.samplingRatio > 1)
+            ImGui::TextColored({1.0f, 0.8f, 0.3f, 1.0f}, "Sampling 1 in %u events, network and file usage is estimated.", latestDiagnostics.samplingRatio);
+        ImGui::Separator();
+
+        if(ImGui::BeginTable("DiagnosticsTable", 2, ImGuiTableFlags_SizingStretchProp | ImGuiTableFlags_BordersInnerV))
+        {
+            auto renderRow = [](const char* label, const char* format, auto value){
+                ImGui::TableNextRow();
+                ImGui::TableSetColumnIndex(0);
+                ImGui::TextUnformatted(label);
+                ImGui::TableSetColumnIndex(1);
+                ImGui::Text(format, value);
+            };
+
+            renderRow("Events received",                   "%llu", static_cast<unsigned long long>(latestDiagnostics.eventsReceived));
+            renderRow("Events received per second",        "%.0lf", eventsReceivedPerSecond);
+            renderRow("Events aggregated",                 "%llu", static_cast<unsigned long long>(latestDiagnostics.eventsAggregated));
+            renderRow("Sampling ratio (1 in N)",           "%u", latestDiagnostics.samplingRatio);
+            renderRow("Input rate seen by sampling",       "%.0lf", latestDiagnostics.inputRate);
+            renderRow("Events sampled out",                "%llu", static_cast<unsigned long long>(latestDiagnostics.eventsSampledOut));
+            renderRow("Aggregation cost (ns per event)",   "%.1lf", aggregationNsPerEvent);
+            renderRow("Ring fill (high watermark)",        "%zu", latestDiagnostics.ringHighWatermark);
+            renderRow("Ring capacity",                     "%zu", latestDiagnostics.ringCapacity);
+            renderRow("Ring drops",                        "%llu", static_cast<unsigned long long>(latestDiagnostics.ringDrops));
+            renderRow("Ring drops per second",             "%.0lf", ringDropsPerSecond);
+            renderRow("ETW events lost (session)",         "%lu", latestDiagnostics.etwEventsLost);
+            renderRow("ETW real time buffers lost",        "%lu", latestDiagnostics.etwRealTimeBuffersLost);
+            renderRow("ETW lost event notifications",      "%llu", static_cast<unsigned long long>(latestDiagnostics.lostEventNotifications));
+            renderRow("ETW buffer size (KB)",              "%lu", latestDiagnostics.etwBufferSizeKB);
+            renderRow("ETW buffers (allocated)",           "%lu", latestDiagnostics.etwBuffers);
+            renderRow("ETW buffers (maximum)",             "%lu", latestDiagnostics.etwMaximumBuffers);
+            renderRow("ETW flush timer (seconds)",         "%lu", latestDiagnostics.etwFlushTimer);
+            renderRow("Pids outside of the usage table",   "%llu", static_cast<unsigned long long>(latestDiagnostics.pidTableDrops));
+            renderRow("Usage table pages",                 "%zu", latestDiagnostics.pidTablePages);
+            renderRow("Usage table pages freed (idle)",    "%llu", static_cast<unsigned long long>(latestDiagnostics.pidTablePagesFreed));
+            renderRow("Events decoded through TDH",        "%llu", static_cast<unsigned long long>(latestDiagnostics.schemaTdhFallbacks));
+            renderRow("Network flows tracked",             "%zu", latestDiagnostics.flowEntries);
+            renderRow("Network flow capacity",             "%zu", latestDiagnostics.flowCapacity);
+            renderRow("Network flows evicted",             "%llu", static_cast<unsigned long long>(latestDiagnostics.flowEvictions));
+            renderRow("Network flow table memory (KB)",    "%zu", latestDiagnostics.flowMemoryUsage / 1024);
+            renderRow("File names known",                  "%zu", latestDiagnostics.fileNames);
+            renderRow("Top files sketch memory (KB)",      "%zu", latestDiagnostics.fileSketchMemoryUsage / 1024);
+            renderRow("File IO in flight",                 "%zu", latestDiagnostics.fileLatency.inFlightCount);
+            renderRow("File IO in flight capacity",        "%zu", latestDiagnostics.fileLatency.inFlightCapacity);
+            renderRow("File IO latencies measured",        "%llu", static_cast<unsigned long long>(latestDiagnostics.fileLatency.matched));
+            renderRow("File IO completions unmatched",     "%llu", static_cast<unsigned long long>(latestDiagnostics.fileLatency.unmatchedEnds));
+            renderRow("File IO timed out (no completion)", "%llu", static_cast<unsigned long long>(latestDiagnostics.fileLatency.timedOut));
+            renderRow("File IO dropped (in flight full)",  "%llu", static_cast<unsigned long long>(latestDiagnostics.fileLatency.inFlightDrops));
+            renderRow("File latency processes evicted",    "%llu", static_cast<unsigned long long>(latestDiagnostics.fileLatency.evictedProcesses));
+            renderRow("File latency memory (KB)",          "%zu", latestDiagnostics.fileLatency.memoryUsage / 1024);
+            renderRow("Threads made ready",                "%llu", static_cast<unsigned long long>(latestDiagnostics.readyLatency.readyEvents));
+            renderRow("Ready latencies measured",          "%llu", static_cast<unsigned long long>(latestDiagnostics.readyLatency.matched));
+            renderRow("Switches without a ready (yet)",    "%llu", static_cast<unsigned long long>(latestDiagnostics.readyLatency.unmatchedSwitches));
+            renderRow("Ready waits overwritten",           "%llu", static_cast<unsigned long long>(latestDiagnostics.readyLatency.overwritten));
+            renderRow("Ready waits too long (dropped)",    "%llu", static_cast<unsigned long long>(latestDiagnostics.readyLatency.tooLong));
+            renderRow("Ready latency ring drops",          "%llu", static_cast<unsigned long long>(latestDiagnostics.readyLatency.ringDrops));
+            renderRow("Ready latencies of unknown threads","%llu", static_cast<unsigned long long>(latestDiagnostics.readyLatency.unknownProcess));
+            renderRow("Ready latency threads tracked",     "%zu", latestDiagnostics.readyLatency.threadCount);
+            renderRow("Ready latency processes tracked",   "%zu", latestDiagnostics.readyLatency.processCount);
+            renderRow("Ready latency threads evicted",     "%llu", static_cast<unsigned long long>(latestDiagnostics.readyLatency.evictedThreads));
+            renderRow("Ready latency processes evicted",   "%llu", static_cast<unsigned long long>(latestDiagnostics.readyLatency.evictedProcesses));
+            renderRow("Ready latency memory (KB)",         "%zu", latestDiagnostics.readyLatency.memoryUsage / 1024);
+
+            ImGui::EndTable();
+        }
+    }
+    ImGui::End();
+}
+
+void CTMProcessScreen::RenderIoUsageColumns(const ProcessIoUsage& ioUsage, int firstColumnIndex)
+{
+    for(int i = 0; i < static_cast<int>(CTMUsageCounter::Count); i++)
+    {
+        ImGui::TableSetColumnIndex(firstColumnIndex + i);
+        ImGui::Text("%.2lf", ioUsage.values[i]);
+    }
+}
+
+void CTMProcessScreen::RenderReadyLatencyColumn(const std::uint64_t* p99Micros)
+{
+    ImGui::TableSetColumnIndex(readyLatencyColumnIndex);
+    if(p99Micros == nullptr)
+        ImGui::TextDisabled("-");
+    else
+        ImGui::Text("%.3lf", static_cast<double>(*p99Micros) / 1000.0);
+}
+
+void CTMProcessScreen::RenderProcessDetailsWindow()
+{
+    if(!isDetailsWindowOpen)
+        return;
+
+    ImGui::SetNextWindowSize({800.0f, 800.0f}, ImGuiCond_FirstUseEver);
+    if(ImGui::Begin("Process Details", &isDetailsWindowOpen))
+    {
+        ImGui::Text("Target -> PID %lu", detailsTargetProcessId);
+        if(!isDetailsTargetAlive && !detailsHistoryTime.empty())
+        {
+            ImGui::SameLine();
+            ImGui::TextDisabled("(Exited)");
+        }
+        ImGui::Separator();
+
+        //Latest and peak values, same order as the process table columns
+        if(ImGui::BeginTable("ProcessDetailsTable", 3, ImGuiTableFlags_SizingStretchProp | ImGuiTableFlags_BordersInnerV))
+        {
+            ImGui::TableSetupColumn("Counter");
+            ImGui::TableSetupColumn("Current (MB/s)");
+            ImGui::TableSetupColumn("Peak (MB/s)");
+            ImGui::TableHeadersRow();
+
+            for(std::size_t i = 0; i < static_cast<std::size_t>(CTMUsageCounter::Count); i++)
+            {
+                ImGui::TableNextRow();
+                ImGui::TableSetColumnIndex(0);
+                ImGui::TextUnformatted(ioUsageColumnNames[i]);
+                ImGui::TableSetColumnIndex(1);
+                ImGui::Text("%.2lf", detailsHistory[i].empty() ? 0.0 : detailsHistory[i].back());
+                ImGui::TableSetColumnIndex(2);
+                ImGui::Text("%.2lf", detailsPeakUsage.values[i]);
+            }
+
+            ImGui::EndTable();
+        }
+
+        RenderProcessDetailsConnections();
+        RenderProcessDetailsFiles();
+        RenderProcessDetailsReadyLatency();
+
+        if(detailsHistoryTime.empty())
+            ImGui::TextDisabled("Collecting samples...");
+        else
+        {
+            //Network series first, then file series, each in its own plot so one doesn't flatten the other
+            float  plotHeight   = (ImGui::GetContentRegionAvail().y - ImGui::GetStyle().ItemSpacing.y) / 2.0f;
+            int    sampleCount  = static_cast<int>(detailsHistoryTime.size());
+            double xAxisMax     = detailsHistoryTime.back();
+            double xAxisMin     = xAxisMax - static_cast<double>(maxDetailsHistorySize);
+            const std::pair<const char*, std::pair<CTMUsageCounter, CTMUsageCounter>> plots[] = {
+                {"Network##DetailsNetwork", {CTMUsageCounter::TcpSent,  CTMUsageCounter::UdpReceived}},
+                {"File##DetailsFile",       {CTMUsageCounter::FileRead, CTMUsageCounter::FileWrite}}
+            };
+
+            for(auto&& [plotLabel, counterRange] : plots)
+            {
+                if(!ImPlot::BeginPlot(plotLabel, {-1.0f, plotHeight}, ImPlotFlags_NoInputs))
+                    continue;
+
+                ImPlot::SetupAxes("Time (s)", "MB/s", ImPlotAxisFlags_None, ImPlotAxisFlags_AutoFit);
+                ImPlot::SetupAxisLimits(ImAxis_X1, xAxisMin, xAxisMax, ImPlotCond_Always);
+
+                for(std::size_t i = static_cast<std::size_t>(counterRange.first); i <= static_cast<std::size_t>(counterRange.second); i++)
+                    ImPlot::PlotLine(ioUsageColumnNames[i], detailsHistoryTime.data(), detailsHistory[i].data(), sampleCount);
+
+                ImPlot::EndPlot();
+            }
+        }
+    }
+    ImGui::End();
+}
+
+void CTMProcessScreen::RenderProcessDetailsConnections()
+{
+    if(!ImGui::CollapsingHeader("Connections", ImGuiTreeNodeFlags_DefaultOpen))
+        return;
+
+    if(detailsFlows.empty())
+    {
+        ImGui::TextDisabled("No network traffic seen for this process.");
+        return;
+    }
+
+    constexpr float connectionsTableHeight = 200.0f;
+    if(!ImGui::BeginTable("ProcessConnectionsTable", 7, ImGuiTableFlags_SizingStretchProp | ImGuiTableFlags_BordersInnerV |
+                                                        ImGuiTableFlags_ScrollY | ImGuiTableFlags_Resizable, {0.0f, connectionsTableHeight}))
+        return;
+
+    ImGui::TableSetupScrollFreeze(0, 1);
+    ImGui::TableSetupColumn("Protocol");
+    ImGui::TableSetupColumn("Local");
+    ImGui::TableSetupColumn("Remote");
+    ImGui::TableSetupColumn("Sent (KB/s)");
+    ImGui::TableSetupColumn("Recv (KB/s)");
+    ImGui::TableSetupColumn("Total (MB)");
+    ImGui::TableSetupColumn("Last Seen (s)");
+    ImGui::TableHeadersRow();
+
+    char endpointText[64];
+    for(auto&& flow : detailsFlows)
+    {
+        ImGui::TableNextRow();
+        ImGui::TableSetColumnIndex(0);
+        ImGui::TextUnformatted(flow.key.protocol == CTMFlowProtocol::Tcp ? "TCP" : "UDP");
+        ImGui::TableSetColumnIndex(1);
+        CTMNetworkFlowTable::FormatEndpoint(flow.key.localAddress, flow.key.addressLength, flow.key.localPort, endpointText, sizeof(endpointText));
+        ImGui::TextUnformatted(endpointText);
+        ImGui::TableSetColumnIndex(2);
+        CTMNetworkFlowTable::FormatEndpoint(flow.key.remoteAddress, flow.key.addressLength, flow.key.remotePort, endpointText, sizeof(endpointText));
+        ImGui::TextUnformatted(endpointText);
+        ImGui::TableSetColumnIndex(3);
+        ImGui::Text("%.2lf", flow.sendRate / 1024.0);
+        ImGui::TableSetColumnIndex(4);
+        ImGui::Text("%.2lf", flow.receiveRate / 1024.0);
+        ImGui::TableSetColumnIndex(5);
+        ImGui::Text("%.2lf", static_cast<double>(flow.bytesSent + flow.bytesReceived) / (1024.0 * 1024.0));
+        ImGui::TableSetColumnIndex(6);
+        //Events can be stamped slightly after we took our timestamp
+        double lastSeenSeconds = detailsFlowsTimestamp > flow.lastSeen && qpcFrequency.QuadPart > 0
+                               ? static_cast<double>(detailsFlowsTimestamp - flow.lastSeen) / qpcFrequency.QuadPart : 0.0;
+        ImGui::Text("%.0lf", lastSeenSeconds);
+    }
+
+    ImGui::EndTable();
+}
+
+void CTMProcessScreen::RenderProcessDetailsFiles()
+{
+    if(!ImGui::CollapsingHeader("Files", ImGuiTreeNodeFlags_DefaultOpen))
+        return;
+
+    if(detailsReadLatency.count == 0 && detailsWriteLatency.count == 0)
+        ImGui::TextDisabled("No completed file reads or writes seen for this process.");
+    else
+        RenderFileLatencyTable("ProcessFileLatencyTable", detailsReadLatency, detailsWriteLatency);
+
+    //Only the files heavy enough to make the (process, file) sketch show up here, quiet ones can be missing
+    if(detailsFiles.empty())
+    {
+        ImGui::TextDisabled("No heavy file IO seen for this process.");
+        return;
+    }
+
+    RenderFileUsageTable("ProcessFilesTable", detailsFiles, 200.0f);
+}
+
+void CTMProcessScreen::RenderProcessDetailsReadyLatency()
+{
+    if(!ImGui::CollapsingHeader("Ready Latency", ImGuiTreeNodeFlags_DefaultOpen))
+        return;
+
+    if(!isReadyProviderAcquired)
+    {
+        ImGui::TextDisabled("Turn on 'Ready Latency' in the toolbar to see how long this process' threads wait for a core.");
+        return;
+    }
+    if(detailsReadyLatency.count == 0)
+    {
+        ImGui::TextDisabled("No thread of this process waited for a core since it was turned on.");
+        return;
+    }
+
+    constexpr float readyTableHeight = 200.0f;
+    if(!ImGui::BeginTable("ProcessReadyLatencyTable", 6, ImGuiTableFlags_SizingStretchProp | ImGuiTableFlags_BordersInnerV |
+                                                         ImGuiTableFlags_ScrollY | ImGuiTableFlags_Resizable, {0.0f, readyTableHeight}))
+        return;
+
+    //Whole process first, then its threads with the longest p99 first. Same buckets as the file latencies
+    ImGui::TableSetupScrollFreeze(0, 1);
+    ImGui::TableSetupColumn("Wait (ms)");
+    ImGui::TableSetupColumn("Count");
+    ImGui::TableSetupColumn("p50");
+    ImGui::TableSetupColumn("p95");
+    ImGui::TableSetupColumn("p99");
+    ImGui::TableSetupColumn("Max");
+    ImGui::TableHeadersRow();
+
+    auto renderRow = [](const CTMLatencySummary& latency){
+        ImGui::TableSetColumnIndex(1);
+        ImGui::Text("%llu", static_cast<unsigned long long>(latency.count));
+        const std::uint64_t values[] = {latency.p50, latency.p95, latency.p99, latency.max};
+        for(int i = 0; i < 4; i++)
+        {
+            ImGui::TableSetColumnIndex(2 + i);
+            ImGui::Text("%.3lf", static_cast<double>(values[i]) / 1000.0);
+        }
+    };
+
+    ImGui::TableNextRow();
+    ImGui::TableSetColumnIndex(0);
+    ImGui::TextUnformatted("Process");
+    renderRow(detailsReadyLatency);
+
+    for(auto&& thread : detailsReadyThreads)
+    {
+        ImGui::TableNextRow();
+        ImGui::TableSetColumnIndex(0);
+        ImGui::Text("TID %lu", thread.threadId);
+        renderRow(thread.latency);
+    }
+
+    ImGui::EndTable();
+}
+
+void CTMProcessScreen::RenderTopFilesWindow()
+{
+    if(!isTopFilesWindowOpen)
+        return;
+
+    ImGui::SetNextWindowSize({750.0f, 500.0f}, ImGuiCond_FirstUseEver);
+    if(ImGui::Begin("Top Files", &isTopFilesWindowOpen))
+    {
+        ImGui::Text("Read + write since the session started -> %.2lf MB", static_cast<double>(topFilesTotalBytes) / (1024.0 * 1024.0));
+        ImGui::SameLine();
+        if(ImGui::Button("Reset"))
+        {
+            globalFileUsageTracker.ResetUsage();
+            UpdateTopFiles();
+        }
+        //The sketch's promise, worth knowing before reading too much into the small rows
+        ImGui::TextDisabled("Totals are never under, and over by atmost %.2lf MB (the +- column is the exact bound of each row).",
+                            static_cast<double>(topFilesErrorBound) / (1024.0 * 1024.0));
+        ImGui::Separator();
+
+        //System wide, processes which exited or were evicted from the latency table still count
+        if(topFilesReadLatency.count > 0 || topFilesWriteLatency.count > 0)
+        {
+            RenderFileLatencyTable("SystemFileLatencyTable", topFilesReadLatency, topFilesWriteLatency);
+            ImGui::Separator();
+        }
+
+        if(topFiles.empty())
+            ImGui::TextDisabled("No file IO seen yet.");
+        else
+            RenderFileUsageTable("TopFilesTable", topFiles, 0.0f);
+    }
+    ImGui::End();
+}
+
+void CTMProcessScreen::RenderFileUsageTable(const char* tableId, const FileUsageVector& files, float tableHeight)
+{
+    if(!ImGui::BeginTable(tableId, 3, ImGuiTableFlags_SizingStretchProp | ImGuiTableFlags_BordersInnerV | ImGuiTableFlags_ScrollY |
+                                      ImGuiTableFlags_Resizable, {0.0f, tableHeight}))
+        return;
+
+    ImGui::TableSetupScrollFreeze(0, 1);
+    ImGui::TableSetupColumn("File", ImGuiTableColumnFlags_WidthStretch, 4.0f);
+    ImGui::TableSetupColumn("Total (MB)");
+    ImGui::TableSetupColumn("+- (MB)");
+    ImGui::TableHeadersRow();
+
+    char fileNameText[512];
+    for(auto&& file : files)
+    {
+        ImGui::TableNextRow();
+        ImGui::TableSetColumnIndex(0);
+        CTMFileUsageTracker::FormatFileName(file, fileNameText, sizeof(fileNameText));
+        ImGui::TextUnformatted(fileNameText);
+        ImGui::TableSetColumnIndex(1);
+        ImGui::Text("%.2lf", static_cast<double>(file.bytes) / (1024.0 * 1024.0));
+        ImGui::TableSetColumnIndex(2);
+        if(file.errorBytes == 0)
+            ImGui::TextDisabled("exact");
+        else
+            ImGui::Text("%.2lf", static_cast<double>(file.errorBytes) / (1024.0 * 1024.0));
+    }
+
+    ImGui::EndTable();
+}
+
+void CTMProcessScreen::RenderFileLatencyTable(const char* tableId, const CTMLatencySummary& readLatency, const CTMLatencySummary& writeLatency)
+{
+    if(!ImGui::BeginTable(tableId, 6, ImGuiTableFlags_SizingStretchProp | ImGuiTableFlags_BordersInnerV))
+        return;
+
+    //Percentiles are histogram buckets, never under the real value and atmost 1/16 over it (max is exact)
+    ImGui::TableSetupColumn("Latency (ms)");
+    ImGui::TableSetupColumn("Count");
+    ImGui::TableSetupColumn("p50");
+    ImGui::TableSetupColumn("p95");
+    ImGui::TableSetupColumn("p99");
+    ImGui::TableSetupColumn("Max");
+    ImGui::TableHeadersRow();
+
+    const std::pair<const char*, const CTMLatencySummary*> rows[] = {{"Read", &readLatency}, {"Write", &writeLatency}};
+    for(auto&& [rowName, latency] : rows)
+    {
+        ImGui::TableNextRow();
+        ImGui::TableSetColumnIndex(0);
+        ImGui::TextUnformatted(rowName);
+        ImGui::TableSetColumnIndex(1);
+        ImGui::Text("%llu", static_cast<unsigned long long>(latency->count));
+
+        const std::uint64_t values[] = {latency->p50, latency->p95, latency->p99, latency->max};
+        for(int i = 0; i < 4; i++)
+        {
+            ImGui::TableSetColumnIndex(2 + i);
+            if(latency->count == 0)
+                ImGui::TextDisabled("-");
+            else
+                ImGui::Text("%.3lf", static_cast<double>(values[i]) / 1000.0);
+        }
+    }
+
+    ImGui::EndTable();
+}
+
+void CTMProcessScreen::RenderJobTable()
+{
+    if(!ImGui::BeginTable("JobsTable", 8, ImGuiTableFlags_SizingStretchProp | ImGuiTableFlags_BordersInnerV |
+                                          ImGuiTableFlags_Resizable | ImGuiTableFlags_ScrollX))
+        return;
+
+    ImGui::TableSetupColumn("Name", ImGuiTableColumnFlags_WidthFixed);
+    ImGui::TableSetupColumn("PID / Processes", ImGuiTableColumnFlags_WidthFixed);
+    ImGui::TableSetupColumn("CPU (%)", ImGuiTableColumnFlags_WidthFixed);
+    ImGui::TableSetupColumn("Memory (MB)", ImGuiTableColumnFlags_WidthFixed);
+    ImGui::TableSetupColumn("IO Read (MB/s)", ImGuiTableColumnFlags_WidthFixed);
+    ImGui::TableSetupColumn("IO Write (MB/s)", ImGuiTableColumnFlags_WidthFixed);
+    ImGui::TableSetupColumn("CPU Cap (%)", ImGuiTableColumnFlags_WidthFixed);
+    ImGui::TableSetupColumn("Memory Limit (MB)", ImGuiTableColumnFlags_WidthFixed);
+
+    ImGui::TableHeadersRow();
+
+    const JobInfoVector& jobs = jobTracker.GetJobs();
+    for(std::size_t i = 0; i < jobs.size(); i++)
+    {
+        const CTMJobInfo& job = jobs[i];
+        if(job.processIds.empty())
+            continue;
+
+        ImGui::TableNextRow();
+
+        ImGui::PushStyleColor(ImGuiCol_HeaderHovered, {0, 0, 0, 0});
+        ImGui::PushStyleColor(ImGuiCol_HeaderActive, {0, 0, 0, 0});
+
+        ImGui::TableSetColumnIndex(0);
+        ImGui::PushID(static_cast<int>(i));
+        bool expandTree = ImGui::TreeNodeEx(job.jobName.c_str(), ImGuiTreeNodeFlags_SpanAllColumns);
+        ImGui::PopID();
+
+        ImGui::PopStyleColor(2);
+
+        if(ImGui::IsItemHovered())
+        {
+            ImGui::TableSetBgColor(ImGuiTableBgTarget_RowBg0, headerBgColorU32);
+            ImGui::SetTooltip("Active: %lu, Terminated: %lu%s", job.activeProcesses, job.totalTerminated,
+                              job.isThrottled ? "\nRunning at its limit (throttled)" : "");
+        }
+
+        //Accounting is for the whole job, nested jobs included, so say how many of its processes are listed elsewhere
+        ImGui::TableSetColumnIndex(1);
+        if(job.ownProcessIds.size() < job.processIds.size())
+            ImGui::Text("%zu (+%zu nested)", job.ownProcessIds.size(), job.processIds.size() - job.ownProcessIds.size());
+        else
+            ImGui::Text("%zu", job.processIds.size());
+
+        ImGui::TableSetColumnIndex(2);
+        ImGui::Text("%.2lf", job.cpuUsage);
+        if(job.isThrottled)
+            ImGui::TableSetBgColor(ImGuiTableBgTarget_CellBg, throttledCellColorU32);
+
+        //Some jobs don't give us their memory usage, sum up the processes we know about instead
+        double memoryUsage = job.memoryUsage;
+        if(memoryUsage < 0.0)
+        {
+            memoryUsage = 0.0;
+            for(auto&& processId : job.processIds)
+            {
+                auto it = processLookupMap.find(processId);
+                if(it != processLookupMap.end())
+                    memoryUsage += it->second.second->memoryUsage;
+            }
+        }
+        ImGui::TableSetColumnIndex(3);
+        ImGui::Text("%.2lf", memoryUsage);
+
+        ImGui::TableSetColumnIndex(4);
+        ImGui::Text("%.2lf", job.ioReadUsage);
+
+        ImGui::TableSetColumnIndex(5);
+        ImGui::Text("%.2lf", job.ioWriteUsage);
+
+        ImGui::TableSetColumnIndex(6);
+        if(job.cpuRateCap > 0.0)
+            ImGui::Text("%.2lf", job.cpuRateCap);
+        else
+            ImGui::TextUnformatted("-");
+
+        ImGui::TableSetColumnIndex(7);
+        if(job.memoryLimit > 0.0)
+            ImGui::Text("%.2lf", job.memoryLimit);
+        else
+            ImGui::TextUnformatted("-");
+
+        if(expandTree)
+        {
+            RenderJobProcessRows(job.ownProcessIds);
+            ImGui::TreePop();
+        }
+    }
+
+    //Everything which isn't in any job, per process values summed up like the image name table does
+    std::vector<DWORD> jobLessProcessIds;
+    double             totalCPUUsage = 0.0, totalMemoryUsage = 0.0;
+    for(auto&& [processId, lookupEntry] : processLookupMap)
+    {
+        if(jobTracker.GetJobOfProcess(processId))
+            continue;
+
+        jobLessProcessIds.push_back(processId);
+        totalCPUUsage    += lookupEntry.second->cpuUsage;
+        totalMemoryUsage += lookupEntry.second->memoryUsage;
+    }
+
+    if(!jobLessProcessIds.empty())
+    {
+        ImGui::TableNextRow();
+        ImGui::TableSetColumnIndex(0);
+        bool expandTree = ImGui::TreeNodeEx("Not In Any Job", ImGuiTreeNodeFlags_SpanAllColumns);
+
+        ImGui::TableSetColumnIndex(1);
+        ImGui::Text("%zu", jobLessProcessIds.size());
+        ImGui::TableSetColumnIndex(2);
+        ImGui::Text("%.2lf", totalCPUUsage);
+        ImGui::TableSetColumnIndex(3);
+        ImGui::Text("%.2lf", totalMemoryUsage);
+
+        if(expandTree)
+        {
+            RenderJobProcessRows(jobLessProcessIds);
+            ImGui::TreePop();
+        }
+    }
+
+    ImGui::EndTable();
+}
+
+void CTMProcessScreen::RenderJobProcessRows(const std::vector<DWORD>& processIds)
+{
+    for(auto&& processId : processIds)
+    {
+        //Process may have exited since the job list was read
+        auto it = processLookupMap.find(processId);
+        if(it == processLookupMap.end())
+            continue;
+
+        const std::string& processName = *it->second.first;
+        const ProcessInfo& process     = *it->second.second;
+
+        ImGui::TableNextRow();
+        ImGui::TableSetColumnIndex(0);
+        ImGui::Indent();
+
+        ImGui::PushID(process.processId);
+        ImGui::PushStyleColor(ImGuiCol_HeaderHovered, headerBgColorVec4);
+        ImGui::Selectable(processName.c_str(), false, ImGuiSelectableFlags_SpanAllColumns);
+        ImGui::PopStyleColor();
+        ImGui::PopID();
+
+        //Same popup as the image name table
+        if(ImGui::IsItemClicked(ImGuiMouseButton_Right))
+        {
+            processVariant  = process.processId;
+            SetPopupBit(static_cast<std::uint8_t>(PopupBitsetIndex::ShouldOpenPopup), true);
+            SetPopupBit(static_cast<std::uint8_t>(PopupBitsetIndex::IsProcessGroup), false);
+            SetPopupBit(static_cast<std::uint8_t>(PopupBitsetIndex::CanTerminate),
+                            processExcludedHandleSet.find(process.processId) == processExcludedHandleSet.end());
+        }
+
+        ImGui::Unindent();
+
+        ImGui::TableSetColumnIndex(1);
+        ImGui::Text("%d", process.processId);
+
+        ImGui::TableSetColumnIndex(2);
+        ImGui::Text("%.2lf", process.cpuUsage);
+
+        ImGui::TableSetColumnIndex(3);
+        ImGui::Text("%.2lf", process.memoryUsage);
+    }
+}
+
 //--------------------
 void CTMProcessScreen::UpdateProcessInfo()
 {
@@ -375,13 +1277,13 @@ void CTMProcessScreen::UpdateProcessInfo()
         //Process name converted from a wide string to normal string
         CHAR processName[MAX_PATH] = "<System Idle Process>";
 
-        //Before we go ahead and try to update information, lock the event tracing map
-        std::lock_guard<std::mutex> lock(globalPsEtwMutex); //globalPsEtwMutex is global
-
         //Get the current system times
         FILETIME ftSysKernelTime, ftSysUserTime;
         GetSystemTimes(nullptr, &ftSysKernelTime, &ftSysUserTime);
 
+        //Network and file bytes since the last update go to our side of the usage table, the aggregator carries on in the other one
+        globalProcessUsageTable.AdvanceEpoch();
+
         //Loop through all the processes as long as this stuffs valid
         while(systemProcessInfo)
         {
@@ -399,12 +1301,23 @@ void CTMProcessScreen::UpdateProcessInfo()
             
             //It may seem weird that UniqueProcessId is an 'HANDLE' even tho its a pid. Just convert it to DWORD and it works fine
             DWORD  processId = static_cast<DWORD>(reinterpret_cast<ULONG_PTR>(systemProcessInfo->UniqueProcessId));
+            auto   ctmSystemProcessInfo = reinterpret_cast<PCTM_SYSTEM_PROCESS_INFORMATION>(systemProcessInfo);
+            auto&  previousInformation  = perProcessPreviousInformationMap[processId];
+            ULONGLONG createTime = static_cast<ULONGLONG>(ctmSystemProcessInfo->CreateTime.QuadPart);
+            if(previousInformation.createTime != createTime)
+            {
+                //The pid got reused between two updates, the old process never went stale so it vanishes right here
+                if(previousInformation.createTime != 0)
+                    AddVanishedProcess(processId, previousInformation);
+                previousInformation            = {};
+                previousInformation.createTime = createTime;
+            }
+            previousInformation.parentProcessId = static_cast<DWORD>(reinterpret_cast<ULONG_PTR>(ctmSystemProcessInfo->InheritedFromUniqueProcessId));
             HANDLE hProcess  = GetProcessHandleFromId(processId);
 
             //We will use some hacky hacks to get usage data as we can't open the process for its data
             if(hProcess == nullptr)
-                UpdateProcessMapWithoutProcessHandle(processId, processName, 
-                    reinterpret_cast<PCTM_SYSTEM_PROCESS_INFORMATION>(systemProcessInfo), ftSysKernelTime, ftSysUserTime);
+                UpdateProcessMapWithoutProcessHandle(processId, processName, ctmSystemProcessInfo, ftSysKernelTime, ftSysUserTime);
             //We will be closing process handles through destructor and/or while cleaning stale entries
             else
                 UpdateProcessMapWithProcessHandle(hProcess, processId, processName, ftSysKernelTime, ftSysUserTime);
@@ -419,6 +1332,11 @@ void CTMProcessScreen::UpdateProcessInfo()
                                 );
         }
 
+        //Processes which exited since the last update (some of them we never even saw), needs the previous system times
+        ULONGLONG sysTimeDelta = (reinterpret_cast<ULARGE_INTEGER&>(ftSysKernelTime).QuadPart - reinterpret_cast<ULARGE_INTEGER&>(ftPrevSysKernelTime).QuadPart) +
+                                 (reinterpret_cast<ULARGE_INTEGER&>(ftSysUserTime).QuadPart - reinterpret_cast<ULARGE_INTEGER&>(ftPrevSysUserTime).QuadPart);
+        AttributeExitedProcesses(sysTimeDelta);
+
         //Update the previous system times (kernel and user)
         ftPrevSysKernelTime = ftSysKernelTime;
         ftPrevSysUserTime   = ftSysUserTime;
@@ -442,28 +1360,12 @@ void CTMProcessScreen::UpdateProcessMapWithProcessHandle(HANDLE hProcess, DWORD
     //CPU Usage
     double cpuUsage = CalculateCpuUsage(hProcess, processId, ftSysKernel, ftSysUser);
 
-    //Network Usage
-    double networkUsage = 0;
-    auto   networkIt    = globalProcessNetworkUsageMap.find(processId);
-    if(networkIt != globalProcessNetworkUsageMap.end())
-    {
-        //Set networkIt to 0 as soon as you use networkIt, that will mark the data per second
-        networkUsage = (networkIt->second / (1024.0 * 1024.0));
-        networkIt->second   = 0;
-    }
-
-    //File Usage
-    double fileUsage = 0;
-    auto   fileIt    = globalProcessFileUsageMap.find(processId);
-    if(fileIt != globalProcessFileUsageMap.end())
-    {
-        //Set fileIt to 0 as soon as you use fileIt, that will mark the data per second
-        fileUsage  = (fileIt->second / (1024.0 * 1024.0));
-        fileIt->second = 0;
-    }
+    //Network and File Usage
+    //Bytes of the last second, the table zeroes them on its own when the epoch comes around again
+    ProcessIoUsage ioUsage = ReadIoUsage(processId);
 
     //Update the grouped processes map
-    UpdateProcessMap(processId, processName, memUsage, cpuUsage, networkUsage, fileUsage);
+    UpdateProcessMap(processId, processName, memUsage, cpuUsage, ioUsage);
 }
 
 void CTMProcessScreen::UpdateProcessMapWithoutProcessHandle(DWORD processId, const std::string& processName,
@@ -475,42 +1377,26 @@ void CTMProcessScreen::UpdateProcessMapWithoutProcessHandle(DWORD processId, con
     //Memory Usage
     double memUsage = (processInformation->WorkingSetPrivateSize.QuadPart / (1024.0 * 1024.0));
 
-    //Network Usage
-    double networkUsage = 0;
-    auto   networkIt    = globalProcessNetworkUsageMap.find(processId);
-    if(networkIt != globalProcessNetworkUsageMap.end())
-    {
-        //Set networkIt to 0 as soon as you use networkIt, that will mark the data per second
-        networkUsage = (networkIt->second / (1024.0 * 1024.0));
-        networkIt->second   = 0;
-    }
-    
-    //File Usage
-    double fileUsage = 0;
-    auto   fileIt    = globalProcessFileUsageMap.find(processId);
-    if(fileIt != globalProcessFileUsageMap.end())
-    {
-        //Set fileIt to 0 as soon as you use fileIt, that will mark the data per second
-        fileUsage  = (fileIt->second / (1024.0 * 1024.0));
-        fileIt->second = 0;
-    }
+    //Network and File Usage
+    //Bytes of the last second, the table zeroes them on its own when the epoch comes around again
+    ProcessIoUsage ioUsage = ReadIoUsage(processId);
 
     //CPU Usage
     double cpuUsage = CalculateCpuUsageDelta(processId, ftSysKernel, ftSysUser,
                             processInformation->KernelTime, processInformation->UserTime);
 
-    UpdateProcessMap(processId, processName, memUsage, cpuUsage, networkUsage, fileUsage);
+    UpdateProcessMap(processId, processName, memUsage, cpuUsage, ioUsage);
 }
 
 void CTMProcessScreen::UpdateProcessMap(DWORD processId, const std::string& processName,
-                        double memUsage, double cpuUsage, double networkUsage, double fileUsage)
+                        double memUsage, double cpuUsage, const ProcessIoUsage& ioUsage)
 {
     //Get the process if it exists. If it doesn't exist, it will auto create it for us
     auto& processVector = groupedProcessesMap[processName];
 
     //If the processVector is empty that means its an entirely new process entry
     if(processVector.empty())
-        processVector.emplace_back(processId, memUsage, cpuUsage, networkUsage, fileUsage);
+        UpdateProcessAnomalies(processVector.emplace_back(processId, memUsage, cpuUsage, ioUsage), processName);
     
     //If the processVector is not empty, that means it may or may not exist beforehand
     else
@@ -525,13 +1411,38 @@ void CTMProcessScreen::UpdateProcessMap(DWORD processId, const std::string& proc
         {
             it->cpuUsage     = cpuUsage;
             it->memoryUsage  = memUsage;
-            it->networkUsage = networkUsage;
-            it->fileUsage    = fileUsage;
+            it->ioUsage      = ioUsage;
             it->isStaleEntry = FALSE;
+            UpdateProcessAnomalies(*it, processName);
         }
         //The element does not exist, its a new one under this category
         else
-            processVector.emplace_back(processId, memUsage, cpuUsage, networkUsage, fileUsage);
+            UpdateProcessAnomalies(processVector.emplace_back(processId, memUsage, cpuUsage, ioUsage), processName);
+    }
+}
+
+void CTMProcessScreen::UpdateProcessAnomalies(ProcessInfo& process, const std::string& processName)
+{
+    //Name used in the anomaly event log, built on the stack so it doesn't allocate
+    char seriesName[48];
+
+    //CPU usage is -1.0 when we failed to get process times, don't feed garbage to the detector
+    process.isCpuAnomaly = FALSE;
+    if(process.cpuUsage >= 0.0 && process.cpuAnomalyDetector.AddSample(process.cpuUsage))
+    {
+        process.isCpuAnomaly = TRUE;
+        std::snprintf(seriesName, sizeof(seriesName), "%s (%lu) CPU", processName.c_str(), process.processId);
+        anomalyEventLog.Record(seriesName, process.cpuUsage, process.cpuAnomalyDetector.GetMean(),
+                                process.cpuAnomalyDetector.GetLastDeviation());
+    }
+
+    process.isMemoryAnomaly = FALSE;
+    if(process.memoryAnomalyDetector.AddSample(process.memoryUsage))
+    {
+        process.isMemoryAnomaly = TRUE;
+        std::snprintf(seriesName, sizeof(seriesName), "%s (%lu) MEM", processName.c_str(), process.processId);
+        anomalyEventLog.Record(seriesName, process.memoryUsage, process.memoryAnomalyDetector.GetMean(),
+                                process.memoryAnomalyDetector.GetLastDeviation());
     }
 }
 
@@ -591,6 +1502,261 @@ void CTMProcessScreen::TerminateGroupProcess()
         CTM_LOG_ERROR("Failed to terminate process group -> ", processGroupKey, ". The group may have been terminated beforehand.");
 }
 
+void CTMProcessScreen::CollectProcessControlTargets(ProcessControlTargetVector& targetProcessIds)
+{
+    auto AppendGroup = [&targetProcessIds](const ProcessInfoVector& processVector){
+        for(auto&& process : processVector)
+            targetProcessIds.push_back(process.processId);
+    };
+
+    switch(processControl.GetScope())
+    {
+        case CTMProcessControlScope::Process:
+        {
+            //A group target with 'Process' scope is the group itself
+            if(std::holds_alternative<DWORD>(controlTargetVariant))
+            {
+                targetProcessIds.push_back(std::get<DWORD>(controlTargetVariant));
+                break;
+            }
+        }
+        [[fallthrough]];
+        case CTMProcessControlScope::Group:
+        {
+            auto it = groupedProcessesMap.find(controlTargetGroupKey);
+            if(it != groupedProcessesMap.end())
+                AppendGroup(it->second);
+            else
+                CTM_LOG_ERROR("Failed to find process group -> ", controlTargetGroupKey, ". The group may have been terminated beforehand.");
+            break;
+        }
+        case CTMProcessControlScope::Rule:
+        {
+            //Case insensitive 'name contains' match, lower case the rule once
+            std::string ruleText = processControl.GetRuleText();
+            if(ruleText.empty())
+            {
+                CTM_LOG_WARNING("Process control rule is empty, nothing to apply.");
+                break;
+            }
+            std::transform(ruleText.begin(), ruleText.end(), ruleText.begin(), [](unsigned char c){ return std::tolower(c); });
+
+            std::string groupKeyLower;
+            for(auto&& [groupKey, processVector] : groupedProcessesMap)
+            {
+                groupKeyLower.resize(groupKey.size());
+                std::transform(groupKey.begin(), groupKey.end(), groupKeyLower.begin(), [](unsigned char c){ return std::tolower(c); });
+                if(groupKeyLower.find(ruleText) != std::string::npos)
+                    AppendGroup(processVector);
+            }
+            break;
+        }
+    }
+}
+
+void CTMProcessScreen::UpdateProcessDetailsHistory()
+{
+    if(!isDetailsWindowOpen)
+        return;
+
+    //Find the latest numbers of the target, zeros if it exited (the graph just drops to 0)
+    ProcessIoUsage ioUsage;
+    isDetailsTargetAlive = false;
+    for(auto&& [_, processVector] : groupedProcessesMap)
+    {
+        auto it = std::find_if(processVector.begin(), processVector.end(),
+                               [this](const ProcessInfo& process){ return process.processId == detailsTargetProcessId; });
+        if(it != processVector.end())
+        {
+            ioUsage              = it->ioUsage;
+            isDetailsTargetAlive = true;
+            break;
+        }
+    }
+
+    //Updates happen once a second (check ctm_base_state.h)
+    detailsElapsedTime += 1.0;
+    detailsHistoryTime.push_back(detailsElapsedTime);
+    for(std::size_t i = 0; i < static_cast<std::size_t>(CTMUsageCounter::Count); i++)
+    {
+        detailsHistory[i].push_back(ioUsage.values[i]);
+        detailsPeakUsage.values[i] = std::max(detailsPeakUsage.values[i], ioUsage.values[i]);
+    }
+
+    //Small enough that erasing from the front is cheaper than thinking about ring buffers
+    if(detailsHistoryTime.size() > maxDetailsHistorySize)
+    {
+        detailsHistoryTime.erase(detailsHistoryTime.begin());
+        for(auto&& history : detailsHistory)
+            history.erase(history.begin());
+    }
+}
+
+void CTMProcessScreen::UpdateProcessDetailsFlows()
+{
+    if(!isDetailsWindowOpen)
+        return;
+
+    //Session timestamps are QPC ticks (check ctm_process_screen_etw.cpp)
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    if(qpcFrequency.QuadPart == 0)
+        QueryPerformanceFrequency(&qpcFrequency);
+
+    detailsFlowsTimestamp = now.QuadPart;
+    globalNetworkFlowTable.CollectProcessFlows(detailsTargetProcessId, detailsFlows, maxDetailsFlows);
+}
+
+void CTMProcessScreen::UpdateTopFiles()
+{
+    if(isDetailsWindowOpen)
+    {
+        globalFileUsageTracker.CollectProcessTopFiles(detailsTargetProcessId, detailsFiles, maxDetailsFiles);
+        globalFileLatencyTracker.GetProcessSummary(detailsTargetProcessId, detailsReadLatency, detailsWriteLatency);
+    }
+
+    if(!isTopFilesWindowOpen)
+        return;
+
+    globalFileUsageTracker.CollectTopFiles(topFiles, maxTopFiles);
+    topFilesTotalBytes = globalFileUsageTracker.GetTotalBytes();
+    topFilesErrorBound = globalFileUsageTracker.GetFileErrorBound();
+    globalFileLatencyTracker.GetSystemSummary(topFilesReadLatency, topFilesWriteLatency);
+}
+
+void CTMProcessScreen::UpdateReadyLatencies()
+{
+    processReadyLatencyMap.clear();
+    groupReadyLatencyMap.clear();
+    if(!isReadyProviderAcquired)
+        return;
+
+    //Once a second, a lock and a lookup per process and a merge per group
+    CTMLatencySummary summary;
+    for(auto&& [appName, appProcesses] : groupedProcessesMap)
+    {
+        readyLatencyProcessIds.clear();
+        for(auto&& process : appProcesses)
+        {
+            readyLatencyProcessIds.push_back(process.processId);
+            if(globalReadyLatencyTracker.GetProcessSummary(process.processId, summary))
+                processReadyLatencyMap[process.processId] = summary.p99;
+        }
+
+        if(globalReadyLatencyTracker.GetMergedSummary(readyLatencyProcessIds.data(), readyLatencyProcessIds.size(), summary))
+            groupReadyLatencyMap[appName] = summary.p99;
+    }
+
+    if(isDetailsWindowOpen)
+    {
+        globalReadyLatencyTracker.GetProcessSummary(detailsTargetProcessId, detailsReadyLatency);
+        globalReadyLatencyTracker.CollectProcessThreads(detailsTargetProcessId, detailsReadyThreads, maxDetailsReadyThreads);
+    }
+}
+
+void CTMProcessScreen::UpdateEventTracingDiagnostics()
+{
+    if(!isDiagnosticsWindowOpen)
+        return;
+
+    //Rates are per update, which is once a second (check ctm_base_state.h)
+    CTMEventTracingDiagnostics previousDiagnostics = latestDiagnostics;
+    latestDiagnostics       = eventSessionManager.GetDiagnostics();
+    eventsReceivedPerSecond = static_cast<double>(latestDiagnostics.eventsReceived - previousDiagnostics.eventsReceived);
+    ringDropsPerSecond      = static_cast<double>(latestDiagnostics.ringDrops - previousDiagnostics.ringDrops);
+
+    //Quiet second, keep showing the last cost instead of a 0 that means nothing
+    std::uint64_t aggregatedDelta = latestDiagnostics.eventsAggregated - previousDiagnostics.eventsAggregated;
+    if(aggregatedDelta > 0)
+        aggregationNsPerEvent = static_cast<double>(latestDiagnostics.aggregationNanoseconds - previousDiagnostics.aggregationNanoseconds) / aggregatedDelta;
+}
+
+void CTMProcessScreen::AttributeExitedProcesses(ULONGLONG sysTimeDelta)
+{
+    exitedChildCpuUsageMap.clear();
+    unattributedExitedCpuUsage = 0.0;
+
+    //Whatever vanished a few updates ago and still has no stop event, won't get one (lost events or the process provider wasn't on yet)
+    for(auto&& vanishedProcess : vanishedProcesses)
+        --vanishedProcess.updatesLeft;
+    vanishedProcesses.erase(std::remove_if(vanishedProcesses.begin(), vanishedProcesses.end(),
+                                           [](const VanishedProcessInformation& vanishedProcess){ return vanishedProcess.updatesLeft <= 0; }),
+                            vanishedProcesses.end());
+
+    //Only hold the lock long enough to take what piled up, the event tracing thread shouldn't wait on us
+    {
+        std::lock_guard<std::mutex> lock(globalPsEtwMutex); //globalPsEtwMutex is global
+        exitedProcessBuffer.swap(globalExitedProcessVector);
+    }
+    if(exitedProcessBuffer.empty())
+        return;
+
+    //pid -> group key, only built when something actually exited
+    std::unordered_map<DWORD, const std::string*> processGroupKeyMap;
+    for(auto&& [groupKey, processVector] : groupedProcessesMap)
+        for(auto&& process : processVector)
+            processGroupKeyMap.emplace(process.processId, &groupKey);
+
+    for(auto&& exitedProcess : exitedProcessBuffer)
+    {
+        //If we saw the process while polling, everything up to our last look at it is already shown.
+        //The stop event usually shows up after the pid is gone from the poll, and by then the pid can belong to someone else, hence the create time
+        //(0 if the event didn't carry it, the pid is all we have then)
+        auto isSameProcess = [&exitedProcess](ULONGLONG polledCreateTime){ return exitedProcess.createTime == 0 || exitedProcess.createTime == polledCreateTime; };
+
+        ULONGLONG alreadyCountedTime    = 0;
+        DWORD     polledParentProcessId = 0;
+        auto previousIt = perProcessPreviousInformationMap.find(exitedProcess.processId);
+        auto vanishedIt = std::find_if(vanishedProcesses.begin(), vanishedProcesses.end(),
+                                       [&](const VanishedProcessInformation& vanishedProcess)
+                                       { return vanishedProcess.processId == exitedProcess.processId && isSameProcess(vanishedProcess.createTime); });
+        if(previousIt != perProcessPreviousInformationMap.end() && isSameProcess(previousIt->second.createTime))
+        {
+            alreadyCountedTime    = reinterpret_cast<ULARGE_INTEGER&>(previousIt->second.prevProcKernelTime).QuadPart +
+                                    reinterpret_cast<ULARGE_INTEGER&>(previousIt->second.prevProcUserTime).QuadPart;
+            polledParentProcessId = previousIt->second.parentProcessId;
+        }
+        else if(vanishedIt != vanishedProcesses.end())
+        {
+            alreadyCountedTime    = vanishedIt->lastPolledCpuTime;
+            polledParentProcessId = vanishedIt->parentProcessId;
+            //Its stop event is here, no need to wait for it anymore
+            *vanishedIt = vanishedProcesses.back();
+            vanishedProcesses.pop_back();
+        }
+        if(exitedProcess.parentProcessId == 0)
+            exitedProcess.parentProcessId = polledParentProcessId;
+
+        ULONGLONG unaccountedTime = exitedProcess.cpuTime > alreadyCountedTime ? exitedProcess.cpuTime - alreadyCountedTime : 0;
+        double    cpuUsage        = sysTimeDelta > 0 ? (((double)unaccountedTime) / ((double)sysTimeDelta)) * 100.0 : 0.0;
+
+        auto groupIt = processGroupKeyMap.find(exitedProcess.parentProcessId);
+        if(groupIt != processGroupKeyMap.end())
+            exitedChildCpuUsageMap[*groupIt->second] += cpuUsage;
+        else
+            unattributedExitedCpuUsage += cpuUsage;
+
+        recentlyExitedProcesses.push_front(std::move(exitedProcess));
+        ++exitedProcessCount;
+    }
+
+    //Keeps its capacity, next swap hands it back to the event tracing thread
+    exitedProcessBuffer.clear();
+    while(recentlyExitedProcesses.size() > maxRecentlyExitedProcesses)
+        recentlyExitedProcesses.pop_back();
+}
+
+void CTMProcessScreen::AddVanishedProcess(DWORD processId, const PreviousUpdateInformation& previousInformation)
+{
+    VanishedProcessInformation& vanishedProcess = vanishedProcesses.emplace_back();
+    vanishedProcess.createTime        = previousInformation.createTime;
+    vanishedProcess.lastPolledCpuTime = reinterpret_cast<const ULARGE_INTEGER&>(previousInformation.prevProcKernelTime).QuadPart +
+                                        reinterpret_cast<const ULARGE_INTEGER&>(previousInformation.prevProcUserTime).QuadPart;
+    vanishedProcess.processId         = processId;
+    vanishedProcess.parentProcessId   = previousInformation.parentProcessId;
+    vanishedProcess.updatesLeft       = vanishedProcessUpdates;
+}
+
 void CTMProcessScreen::RemoveStaleEntries()
 {
     for(auto it = groupedProcessesMap.begin(); it != groupedProcessesMap.end(); )
@@ -611,9 +1777,15 @@ void CTMProcessScreen::RemoveStaleEntries()
                                 }
                                 //Remove the entry from other maps using key
                                 DWORD processIdToRemove = child.processId;
-                                globalProcessNetworkUsageMap.erase(processIdToRemove);
-                                globalProcessFileUsageMap.erase(processIdToRemove);
-                                perProcessPreviousInformationMap.erase(processIdToRemove);
+                                globalFileLatencyTracker.RemoveProcess(processIdToRemove);
+                                globalReadyLatencyTracker.RemoveProcess(processIdToRemove);
+                                //Its stop event may still be on the way, it needs to know how much CPU we already showed
+                                auto previousIt = perProcessPreviousInformationMap.find(processIdToRemove);
+                                if(previousIt != perProcessPreviousInformationMap.end())
+                                {
+                                    AddVanishedProcess(processIdToRemove, previousIt->second);
+                                    perProcessPreviousInformationMap.erase(previousIt);
+                                }
                                 
                                 //For processIdToHandleMap, we need to 'CloseHandle' before erasing the entry IF it exists in the map
                                 auto it = processIdToHandleMap.find(processIdToRemove);
@@ -635,6 +1807,14 @@ void CTMProcessScreen::RemoveStaleEntries()
     }
 }
 
+void CTMProcessScreen::RebuildProcessLookupMap()
+{
+    processLookupMap.clear();
+    for(auto&& [groupKey, processVector] : groupedProcessesMap)
+        for(auto&& process : processVector)
+            processLookupMap.emplace(process.processId, std::make_pair(&groupKey, &process));
+}
+
 //--------------------FUNCTIONS FOR OUR BITSET--------------------
 void CTMProcessScreen::SetPopupBit(std::uint8_t pos, bool val)
 {
@@ -717,4 +1897,16 @@ double CTMProcessScreen::CalculateCpuUsageDelta(DWORD processId, FILETIME ftSysK
 
     //Final CPU Usage
     return (((double)procTimeDelta) / ((double)sysTimeDelta)) * 100.0;
+}
+
+ProcessIoUsage CTMProcessScreen::ReadIoUsage(DWORD processId)
+{
+    //One lookup for every counter of the pid, bytes of the epoch 'UpdateProcessInfo' swapped out -> MB/s
+    std::uint64_t counterValues[static_cast<std::size_t>(CTMUsageCounter::Count)];
+    globalProcessUsageTable.ReadAll(processId, counterValues);
+
+    ProcessIoUsage ioUsage;
+    for(std::size_t i = 0; i < static_cast<std::size_t>(CTMUsageCounter::Count); i++)
+        ioUsage.values[i] = counterValues[i] / (1024.0 * 1024.0);
+    return ioUsage;
 }
\ No newline at end of file
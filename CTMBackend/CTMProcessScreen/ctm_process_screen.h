@@ -8,20 +8,30 @@
 #include <ntstatus.h>
 //ImGui stuff
 #include "../../ImGUI/imgui.h"
+#include "../../ImPlot/implot.h"
 //My stuff
 #include "ctm_process_screen_etw.h"
+#include "ctm_process_screen_control.h"
+#include "ctm_process_screen_jobs.h"
+#include "ctm_process_screen_profiler.h"
 #include "../CTMPureHeaderFiles/ctm_base_state.h"
 #include "../CTMPureHeaderFiles/ctm_logger.h"
+#include "../CTMPureHeaderFiles/ctm_anomaly_detector.h"
 #include "../CTMGlobalManagers/ctm_critical_resource_guard.h"
+#include "../CTMGlobalManagers/ctm_anomaly_event_log.h"
+#include "../CTMGlobalManagers/ctm_event_session_manager.h"
 //Stdlib stuff
 #include <vector>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
+#include <deque>
 #include <thread>
 #include <atomic>
 #include <variant>
 #include <algorithm>
+#include <cstdio>
+#include <cctype>
 
 //These functions belong to NT DLL, useful for getting process information like memory usage, etc.
 typedef NTSTATUS(NTAPI* NtQueryInformationProcess_t)
@@ -98,26 +108,60 @@ typedef struct _VM_COUNTERS_EX2
     ULONGLONG SharedCommitUsage;
 } VM_COUNTERS_EX2, *PVM_COUNTERS_EX2;
 
+//Network and file usage (MB/s), one value per 'CTMUsageCounter' (check ctm_pid_counter_table.h)
+struct ProcessIoUsage
+{
+    double values[static_cast<std::size_t>(CTMUsageCounter::Count)] = {};
+
+    double& operator[](CTMUsageCounter counter)       { return values[static_cast<std::size_t>(counter)]; }
+    double  operator[](CTMUsageCounter counter) const { return values[static_cast<std::size_t>(counter)]; }
+
+    ProcessIoUsage& operator+=(const ProcessIoUsage& other)
+    {
+        for(std::size_t i = 0; i < static_cast<std::size_t>(CTMUsageCounter::Count); i++)
+            values[i] += other.values[i];
+        return *this;
+    }
+};
+
 struct ProcessInfo
 {
     //Perfect 8 byte alignment
-    double      memoryUsage;
-    double      cpuUsage;
-    double      networkUsage;
-    double      fileUsage;
-    DWORD       processId;
+    double         memoryUsage;
+    double         cpuUsage;
+    ProcessIoUsage ioUsage;
+    DWORD          processId;
     BOOL        isStaleEntry = FALSE; //Every entry is not stale by default
+    //Per process anomaly detection (CPU in %, Memory in MB). Check ctm_anomaly_detector.h
+    CTMAnomalyDetector cpuAnomalyDetector{CTMAnomalyDetector::defaultAlpha, CTMAnomalyDetector::defaultKSigma, CTMAnomalyMinSigma::cpuUsage};
+    CTMAnomalyDetector memoryAnomalyDetector{CTMAnomalyDetector::defaultAlpha, CTMAnomalyDetector::defaultKSigma, CTMAnomalyMinSigma::processMemory};
+    BOOL               isCpuAnomaly    = FALSE;
+    BOOL               isMemoryAnomaly = FALSE;
 
-    ProcessInfo(DWORD processId, double memoryUsage, double cpuUsage, double networkUsage, double fileUsage)
-        : processId(processId), memoryUsage(memoryUsage), cpuUsage(cpuUsage), networkUsage(networkUsage), fileUsage(fileUsage)
+    ProcessInfo(DWORD processId, double memoryUsage, double cpuUsage, const ProcessIoUsage& ioUsage)
+        : processId(processId), memoryUsage(memoryUsage), cpuUsage(cpuUsage), ioUsage(ioUsage)
     {}
 };
 
 struct PreviousUpdateInformation
 {
     //CPU
-    FILETIME prevProcKernelTime;
-    FILETIME prevProcUserTime;
+    FILETIME  prevProcKernelTime;
+    FILETIME  prevProcUserTime;
+    //Parent, in case the process exits and its start event was never seen (started before us)
+    DWORD     parentProcessId;
+    //Tells a reused pid apart from the process we last saw under it
+    ULONGLONG createTime;
+};
+
+//Last CPU time we polled of a process that disappeared, its stop event can arrive a flush interval or two later
+struct VanishedProcessInformation
+{
+    ULONGLONG createTime;
+    ULONGLONG lastPolledCpuTime; //Kernel + user, 100ns units
+    DWORD     processId;
+    DWORD     parentProcessId;
+    int       updatesLeft; //Dropped once it hits 0, by then the stop event is either here or lost
 };
 
 //'using' makes my life much easier instead of writing this horrendously long classes everywhere
@@ -127,7 +171,14 @@ using ProcessMap                = std::unordered_map<std::string, ProcessInfoVec
 using ProcessHandleMap          = std::unordered_map<DWORD, HANDLE>;
 using ProcessExcludedHandleSet  = std::unordered_set<DWORD>;
 using PreviousInformationMap    = std::unordered_map<DWORD, PreviousUpdateInformation>;
+using VanishedProcessVector     = std::vector<VanishedProcessInformation>;
 using ProcessInfoBuffer         = std::vector<BYTE>;
+using ProcessLookupMap          = std::unordered_map<DWORD, std::pair<const std::string*, const ProcessInfo*>>; //pid -> (group key, info)
+using ExitedCpuUsageMap         = std::unordered_map<std::string, double>; //group key -> CPU (%) of its exited children
+using ExitedProcessDeque        = std::deque<CTMExitedProcessInfo>;
+using IoUsageHistory            = std::vector<double>; //Oldest first, one value per update
+using ProcessReadyLatencyMap    = std::unordered_map<DWORD, std::uint64_t>; //pid -> ready p99 (us), only processes with samples
+using GroupReadyLatencyMap      = std::unordered_map<std::string, std::uint64_t>; //group key -> ready p99 (us) of its processes merged
 
 class CTMProcessScreen : public CTMBaseScreen
 {
@@ -149,16 +200,42 @@ private: //Constructor and destructor functions
 private: //Helper function
     void   RenderProcessVector(ProcessInfoVector&, const std::string&);
     void   RenderProcessOptionsPopup();
+    void   RenderProcessControlWindow();
+    void   RenderProcessProfilerWindow();
+    void   RenderGroupingToolbar();
+    void   RenderJobTable();
+    void   RenderJobProcessRows(const std::vector<DWORD>&);
+    void   RenderExitedProcessesWindow();
+    void   RenderProcessDetailsWindow();
+    void   RenderProcessDetailsConnections();
+    void   RenderProcessDetailsFiles();
+    void   RenderProcessDetailsReadyLatency();
+    void   RenderTopFilesWindow();
+    void   RenderFileUsageTable(const char*, const FileUsageVector&, float);
+    void   RenderFileLatencyTable(const char*, const CTMLatencySummary&, const CTMLatencySummary&);
+    void   RenderEventTracingDiagnosticsWindow();
+    void   RenderIoUsageColumns(const ProcessIoUsage&, int);
+    void   RenderReadyLatencyColumn(const std::uint64_t*);
     //
     void   UpdateProcessInfo();
     void   UpdateProcessMapWithProcessHandle(HANDLE, DWORD, const std::string&, FILETIME, FILETIME);
     void   UpdateProcessMapWithoutProcessHandle(DWORD, const std::string&, PCTM_SYSTEM_PROCESS_INFORMATION, FILETIME, FILETIME);
-    void   UpdateProcessMap(DWORD, const std::string&, double, double, double, double);
+    void   UpdateProcessMap(DWORD, const std::string&, double, double, const ProcessIoUsage&);
+    void   UpdateProcessDetailsHistory();
+    void   UpdateProcessDetailsFlows();
+    void   UpdateTopFiles();
+    void   UpdateReadyLatencies();
+    void   UpdateEventTracingDiagnostics();
+    void   UpdateProcessAnomalies(ProcessInfo&, const std::string&);
+    void   AttributeExitedProcesses(ULONGLONG);
+    void   AddVanishedProcess(DWORD, const PreviousUpdateInformation&);
     //
     HANDLE GetProcessHandleFromId(DWORD);
     void   TerminateChildProcess(DWORD);
     void   TerminateGroupProcess();
+    void   CollectProcessControlTargets(ProcessControlTargetVector&);
     void   RemoveStaleEntries();
+    void   RebuildProcessLookupMap();
 
 private: //Helper functions for our bitset 'popupBitset'
     void SetPopupBit(std::uint8_t, bool);
@@ -169,15 +246,18 @@ private: //Helper function as well, just wanted to keep them seperate
     double CalculateMemoryUsage(HANDLE);
     double CalculateCpuUsage(HANDLE, DWORD, FILETIME, FILETIME);
     double CalculateCpuUsageDelta(DWORD, FILETIME, FILETIME, LARGE_INTEGER, LARGE_INTEGER); //Didn't really have a better name honestly
+    ProcessIoUsage ReadIoUsage(DWORD);
 
 private: //NT dll
     HMODULE                     hNtdll                    = nullptr;
     NtQueryInformationProcess_t NtQueryInformationProcess = nullptr;
     NtQuerySystemInformation_t  NtQuerySystemInformation  = nullptr;
 
-private: //Event Tracing for process usage (Like network usage, etc)
-    CTMProcessScreenEventTracing processUsageEventTracing;
-    std::thread                  processUsageEventTracingThread;
+private: //Event Tracing for process usage (Like network usage, etc), ETW unless the command line picks another source
+    CTMEventSessionManager& eventSessionManager       = CTMEventSessionManager::GetInstance();
+    bool                    isEventTracingAcquired    = false; //Network and file providers
+    bool                    isProcessProviderAcquired = false;
+    bool                    isReadyProviderAcquired   = false; //Opt in from the toolbar, it adds two events to every context switch
 
 private:
     //Mapping process id to its handle to use 'OpenProcess' as less as possible
@@ -193,10 +273,16 @@ private:
     FILETIME               ftPrevSysKernelTime = {},
                            ftPrevSysUserTime   = {};
 
-private: //ETW resource guard and its stuff
+private: //Event tracing diagnostics window (ring drops, lost events, etc)
+    CTMEventTracingDiagnostics latestDiagnostics;
+    double                     eventsReceivedPerSecond = 0.0;
+    double                     ringDropsPerSecond      = 0.0;
+    double                     aggregationNsPerEvent   = 0.0; //Over the last update
+    bool                       isDiagnosticsWindowOpen = false;
+
+private: //Resource guard and its stuff
     CTMCriticalResourceGuard& resourceGuard = CTMCriticalResourceGuard::GetInstance();
     //Just a unique name for registering and unregistering function to resource guard
-    const char* etwCleanupFunctionName    = "CTMProcessScreen::ETWStopTracing";
     const char* handleCleanupFunctionName = "CTMProcessScreen::CloseHandles";
 
 private: //Some stuff related to popup menu when u right click on a process group or a process itself
@@ -206,6 +292,89 @@ private: //Some stuff related to popup menu when u right click on a process grou
     enum class PopupBitsetIndex { ShouldOpenPopup, IsProcessGroup, CanTerminate };
     std::uint8_t popupBitset = 0;
 
+private: //Priority, affinity and cpu set control (check ctm_process_screen_control.h)
+    CTMProcessControl  processControl;
+    ProcessTypeVariant controlTargetVariant  = (DWORD)0;
+    std::string        controlTargetGroupKey;          //Group of the target, same as the variant if target itself is a group
+    bool               isControlWindowOpen   = false;
+
+private: //Stack sampling profiler (check ctm_process_screen_profiler.h)
+    CTMProcessProfiler processProfiler;
+    DWORD              profilerTargetProcessId = 0;
+    bool               isProfilerWindowOpen    = false;
+
+private: //Job object grouping (check ctm_process_screen_jobs.h)
+    enum class ProcessGroupingMode : int { ImageName, JobObject };
+    CTMProcessJobTracker jobTracker;
+    ProcessGroupingMode  groupingMode = ProcessGroupingMode::ImageName;
+    //Only rebuilt in job mode, pointers are valid until the next 'UpdateProcessInfo'
+    ProcessLookupMap     processLookupMap;
+
+private: //Short lived processes, fed by the Kernel-Process provider (check ctm_process_screen_etw.h)
+    //CPU of processes which exited during the last interval goes to their parent's group, so the CPU column adds up
+    ExitedCpuUsageMap  exitedChildCpuUsageMap;
+    double             unattributedExitedCpuUsage = 0.0; //Parent is gone as well
+    ExitedProcessDeque    recentlyExitedProcesses;        //Newest first
+    ExitedProcessVector   exitedProcessBuffer;            //Swapped with the global vector every update
+    VanishedProcessVector vanishedProcesses;              //Gone from the poll, waiting on their stop event
+    std::uint64_t         exitedProcessCount         = 0;
+    bool                  isExitedWindowOpen         = false;
+    constexpr static size_t maxRecentlyExitedProcesses = 500;
+    constexpr static int    vanishedProcessUpdates     = 5;
+
+private: //Process details window, network/file usage split by direction and protocol over time
+    DWORD          detailsTargetProcessId = 0;
+    bool           isDetailsWindowOpen    = false;
+    bool           isDetailsTargetAlive   = false;
+    ProcessIoUsage detailsPeakUsage;
+    IoUsageHistory detailsHistory[static_cast<std::size_t>(CTMUsageCounter::Count)];
+    IoUsageHistory detailsHistoryTime; //Seconds since the window was opened
+    double         detailsElapsedTime     = 0.0;
+    constexpr static size_t maxDetailsHistorySize = 120;
+    //Top connections of the target by rate (check ctm_network_flow_table.h), refreshed every update
+    NetworkFlowVector detailsFlows;
+    ULONGLONG         detailsFlowsTimestamp   = 0; //QPC ticks when they were collected, for the 'last seen' column
+    LARGE_INTEGER     qpcFrequency            = {};
+    constexpr static size_t maxDetailsFlows   = 20;
+    //Heaviest files of the target (check ctm_file_usage_tracker.h), refreshed every update
+    FileUsageVector   detailsFiles;
+    constexpr static size_t maxDetailsFiles   = 20;
+    //Read/write latency percentiles of the target (check ctm_file_latency_tracker.h), refreshed with the files
+    CTMLatencySummary detailsReadLatency;
+    CTMLatencySummary detailsWriteLatency;
+    //Scheduler ready latency of the target and its slowest threads (check ctm_ready_latency_tracker.h), refreshed every update
+    CTMLatencySummary                  detailsReadyLatency;
+    std::vector<CTMThreadReadyLatency> detailsReadyThreads;
+    constexpr static size_t maxDetailsReadyThreads = 20;
+    //Same order as 'CTMUsageCounter', used by the table columns and the graphs
+    constexpr static const char* ioUsageColumnNames[] = {"TCP Sent (MB/s)", "TCP Recv (MB/s)", "UDP Sent (MB/s)",
+                                                          "UDP Recv (MB/s)", "File Read (MB/s)", "File Write (MB/s)"};
+
+private: //System wide top files by read + write bytes since the session started (check ctm_file_usage_tracker.h)
+    FileUsageVector       topFiles;
+    std::uint64_t         topFilesTotalBytes   = 0;
+    std::uint64_t         topFilesErrorBound   = 0;
+    //Every process merged, the same percentiles the details window shows for one
+    CTMLatencySummary     topFilesReadLatency;
+    CTMLatencySummary     topFilesWriteLatency;
+    bool                  isTopFilesWindowOpen = false;
+    constexpr static size_t maxTopFiles  = 50;
+
+private: //Ready latency column, how long threads wait for a core once they want one (check ctm_ready_latency_tracker.h)
+    ProcessReadyLatencyMap processReadyLatencyMap;
+    GroupReadyLatencyMap   groupReadyLatencyMap;
+    std::vector<DWORD>     readyLatencyProcessIds; //Reused for every group's merge
+    //Right after the network/file columns
+    constexpr static int   readyLatencyColumnIndex = 4 + static_cast<int>(CTMUsageCounter::Count);
+
+private: //Other UI stuff
+    //Anomaly event log, shared with the performance screens
+    CTMAnomalyEventLog& anomalyEventLog = CTMAnomalyEventLog::GetInstance();
+    //Background color for table cells which are anomalous in the latest update
+    ImU32 anomalyCellColorU32   = IM_COL32(200, 50, 50, 120);
+    //Background color for job cells which are running at their limit
+    ImU32 throttledCellColorU32 = IM_COL32(220, 140, 30, 120);
+
     //Hovered background color for table rows
     ImVec4 headerBgColorVec4 = ImGui::GetStyleColorVec4(ImGuiCol_TableHeaderBg);
     ImU32  headerBgColorU32  = ImGui::GetColorU32(ImGuiCol_TableHeaderBg);            
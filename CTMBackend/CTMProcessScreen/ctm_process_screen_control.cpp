@@ -0,0 +1,367 @@
+#include "ctm_process_screen_control.h"
+
+//MSVC warnings forcing me to use _s function... NOPE
+#pragma warning(disable:4996)
+
+CTMProcessControl::CTMProcessControl()
+{
+    if(!CTMConstructorInitFunctions())
+        CTM_LOG_WARNING("Some process control functions are not available, related settings will be disabled.");
+
+    //Affinity works on the processor group of our own process, which is what pretty much every machine with <= 64 cores has
+    DWORD_PTR processAffinityMask = 0, systemMask = 0;
+    if(GetProcessAffinityMask(GetCurrentProcess(), &processAffinityMask, &systemMask))
+    {
+        systemAffinityMask   = static_cast<ImU64>(systemMask);
+        request.affinityMask = systemAffinityMask;
+        //Highest set bit + 1, the mask doesn't have holes in practice but doesn't hurt to be safe
+        for(int i = 0; i < 64; i++)
+            if(systemAffinityMask & (1ULL << i))
+                logicalCpuCount = i + 1;
+    }
+    else
+        CTM_LOG_ERROR("Failed to get system affinity mask. Error code: ", GetLastError());
+
+    CTMConstructorInitCpuSets();
+}
+
+CTMProcessControl::~CTMProcessControl()
+{
+    //Batches are small (OpenProcess + a few set calls per pid), just wait for it to finish
+    JoinWorkerThread();
+}
+
+//--------------------CONSTRUCTOR INIT FUNCTIONS--------------------
+bool CTMProcessControl::CTMConstructorInitFunctions()
+{
+    HMODULE hNtdll    = GetModuleHandleW(L"ntdll.dll");
+    HMODULE hKernel32 = GetModuleHandleW(L"kernel32.dll");
+
+    if(hNtdll)
+        NtSetInformationProcess = reinterpret_cast<NtSetInformationProcess_t>(
+            GetProcAddress(hNtdll, "NtSetInformationProcess")
+        );
+    if(hKernel32)
+    {
+        GetSystemCpuSetInformation = reinterpret_cast<GetSystemCpuSetInformation_t>(
+            GetProcAddress(hKernel32, "GetSystemCpuSetInformation")
+        );
+        SetProcessDefaultCpuSets   = reinterpret_cast<SetProcessDefaultCpuSets_t>(
+            GetProcAddress(hKernel32, "SetProcessDefaultCpuSets")
+        );
+    }
+
+    return NtSetInformationProcess && GetSystemCpuSetInformation && SetProcessDefaultCpuSets;
+}
+
+void CTMProcessControl::CTMConstructorInitCpuSets()
+{
+    if(!GetSystemCpuSetInformation || !SetProcessDefaultCpuSets)
+        return;
+
+    //First call gets the required size
+    ULONG requiredSize = 0;
+    GetSystemCpuSetInformation(nullptr, 0, &requiredSize, GetCurrentProcess(), 0);
+    if(requiredSize == 0)
+        return;
+
+    std::vector<BYTE> cpuSetBuffer(requiredSize);
+    if(!GetSystemCpuSetInformation(reinterpret_cast<PSYSTEM_CPU_SET_INFORMATION>(cpuSetBuffer.data()), requiredSize,
+                                   &requiredSize, GetCurrentProcess(), 0))
+    {
+        CTM_LOG_ERROR("Failed to get system cpu set information. Error code: ", GetLastError());
+        return;
+    }
+
+    //Entries are variable sized, walk them using 'Size'
+    for(ULONG offset = 0; offset < requiredSize; )
+    {
+        auto cpuSetInfo = reinterpret_cast<PSYSTEM_CPU_SET_INFORMATION>(cpuSetBuffer.data() + offset);
+        if(cpuSetInfo->Size == 0)
+            break;
+
+        if(cpuSetInfo->Type == CpuSetInformation)
+            cpuSets.push_back({cpuSetInfo->CpuSet.Id, static_cast<BYTE>(cpuSetInfo->CpuSet.Group),
+                               cpuSetInfo->CpuSet.LogicalProcessorIndex, cpuSetInfo->CpuSet.CoreIndex, false});
+
+        offset += cpuSetInfo->Size;
+    }
+}
+
+//--------------------MAIN FUNCTIONS--------------------
+bool CTMProcessControl::RenderControls(bool isProcessGroup)
+{
+    //Scope of the change
+    ImGui::TextUnformatted("Apply To");
+    ImGui::RadioButton(isProcessGroup ? "This Group" : "This Process", reinterpret_cast<int*>(&scope),
+                       static_cast<int>(CTMProcessControlScope::Process));
+    //A group target is already the whole group
+    if(!isProcessGroup)
+    {
+        ImGui::SameLine();
+        ImGui::RadioButton("Whole Group", reinterpret_cast<int*>(&scope), static_cast<int>(CTMProcessControlScope::Group));
+    }
+    ImGui::SameLine();
+    ImGui::RadioButton("Name Contains", reinterpret_cast<int*>(&scope), static_cast<int>(CTMProcessControlScope::Rule));
+    if(scope == CTMProcessControlScope::Rule)
+        ImGui::InputTextWithHint("##ProcessControlRule", "e.g. chrome (case insensitive)", ruleTextBuffer, sizeof(ruleTextBuffer));
+
+    ImGui::Separator();
+
+    //Priority class
+    ImGui::Checkbox("Priority Class", &request.shouldSetPriority);
+    ImGui::SameLine();
+    if(!request.shouldSetPriority)
+        ImGui::BeginDisabled();
+    ImGui::SetNextItemWidth(150.0f);
+    ImGui::Combo("##PriorityClass", &priorityClassIndex, priorityClassNames, IM_ARRAYSIZE(priorityClassNames));
+    if(!request.shouldSetPriority)
+        ImGui::EndDisabled();
+
+    //I/O priority
+    if(!NtSetInformationProcess)
+        ImGui::BeginDisabled();
+    ImGui::Checkbox("I/O Priority", &request.shouldSetIoPrio);
+    ImGui::SameLine();
+    if(!request.shouldSetIoPrio)
+        ImGui::BeginDisabled();
+    ImGui::SetNextItemWidth(150.0f);
+    ImGui::Combo("##IoPriority", &ioPriorityIndex, ioPriorityNames, IM_ARRAYSIZE(ioPriorityNames));
+    if(!request.shouldSetIoPrio)
+        ImGui::EndDisabled();
+    if(!NtSetInformationProcess)
+        ImGui::EndDisabled();
+
+    RenderAffinityControls();
+    RenderCpuSetControls();
+
+    ImGui::Separator();
+
+    //Only one batch at a time
+    bool isNothingSelected = !request.shouldSetPriority && !request.shouldSetIoPrio && !request.shouldSetAffinity && !request.shouldSetCpuSets;
+    bool isDisabled        = IsBusy() || isNothingSelected;
+    if(isDisabled)
+        ImGui::BeginDisabled();
+    bool shouldApply = ImGui::Button("Apply");
+    if(isDisabled)
+        ImGui::EndDisabled();
+
+    if(IsBusy())
+    {
+        ImGui::SameLine();
+        ImGui::TextUnformatted("Applying...");
+    }
+
+    return shouldApply;
+}
+
+void CTMProcessControl::RenderResults()
+{
+    //Copy under the lock so we don't hold it while rendering
+    ProcessControlResultVector resultsCopy;
+    {
+        std::lock_guard<std::mutex> lock(resultsMutex);
+        resultsCopy = results;
+    }
+
+    if(resultsCopy.empty())
+        return;
+
+    std::size_t failedCount = 0;
+    for(auto&& result : resultsCopy)
+        if(result.failedStep)
+            ++failedCount;
+
+    ImGui::Text("Last batch: %zu processes, %zu succeeded, %zu failed", resultsCopy.size(), resultsCopy.size() - failedCount, failedCount);
+
+    if(ImGui::BeginTable("ProcessControlResults", 3, ImGuiTableFlags_SizingStretchProp | ImGuiTableFlags_BordersInnerV |
+                                                     ImGuiTableFlags_ScrollY, {-1.0f, 150.0f}))
+    {
+        ImGui::TableSetupScrollFreeze(0, 1);
+        ImGui::TableSetupColumn("PID");
+        ImGui::TableSetupColumn("Result");
+        ImGui::TableSetupColumn("Error Code");
+        ImGui::TableHeadersRow();
+
+        for(auto&& result : resultsCopy)
+        {
+            ImGui::TableNextRow();
+            ImGui::TableSetColumnIndex(0);
+            ImGui::Text("%lu", result.processId);
+            ImGui::TableSetColumnIndex(1);
+            if(result.failedStep)
+                ImGui::TextColored({1.0f, 0.4f, 0.4f, 1.0f}, "%s failed", result.failedStep);
+            else
+                ImGui::TextUnformatted("OK");
+            ImGui::TableSetColumnIndex(2);
+            if(result.failedStep)
+                ImGui::Text("0x%08lX", result.errorCode);
+        }
+
+        ImGui::EndTable();
+    }
+}
+
+bool CTMProcessControl::ApplyAsync(ProcessControlTargetVector&& processIds)
+{
+    if(IsBusy())
+    {
+        CTM_LOG_WARNING("Process control batch is already running, try again after it finishes.");
+        return false;
+    }
+
+    if(processIds.empty())
+    {
+        CTM_LOG_WARNING("Process control batch has no target processes.");
+        return false;
+    }
+
+    //Previous worker is done (isBusy is false) but still needs joining
+    JoinWorkerThread();
+
+    //Snapshot the request, UI can keep editing while the worker runs
+    CTMProcessControlRequest requestCopy = request;
+    requestCopy.priorityClass = priorityClasses[priorityClassIndex];
+    requestCopy.ioPriority    = static_cast<ULONG>(ioPriorityIndex);
+    requestCopy.affinityMask &= systemAffinityMask;
+    requestCopy.cpuSetIds.clear();
+    for(auto&& cpuSet : cpuSets)
+        if(cpuSet.isSelected)
+            requestCopy.cpuSetIds.push_back(cpuSet.id);
+
+    //An empty affinity mask is invalid, don't even try
+    if(requestCopy.shouldSetAffinity && requestCopy.affinityMask == 0)
+    {
+        CTM_LOG_ERROR("Affinity mask can't be empty, select atleast one cpu.");
+        return false;
+    }
+
+    isBusy.store(true);
+    workerThread = std::thread([this, requestCopy = std::move(requestCopy), processIds = std::move(processIds)](){
+        ProcessControlResultVector batchResults(processIds.size());
+        for(std::size_t i = 0; i < processIds.size(); i++)
+            ApplyRequestToProcess(requestCopy, processIds[i], batchResults[i]);
+
+        {
+            std::lock_guard<std::mutex> lock(resultsMutex);
+            results = std::move(batchResults);
+        }
+        isBusy.store(false);
+    });
+
+    return true;
+}
+
+//--------------------HELPER FUNCTIONS--------------------
+void CTMProcessControl::RenderAffinityControls()
+{
+    ImGui::Checkbox("Affinity Mask", &request.shouldSetAffinity);
+    if(!request.shouldSetAffinity)
+        return;
+
+    ImGui::Indent();
+    //8 checkboxes per line, its a lot more readable than a wall of 64 checkboxes
+    char cpuLabel[16];
+    for(int i = 0; i < logicalCpuCount; i++)
+    {
+        if(!(systemAffinityMask & (1ULL << i)))
+            continue;
+        if(i % 8 != 0)
+            ImGui::SameLine();
+
+        //This ImGui version has no 64 bit CheckboxFlags, toggle the bit ourselves
+        std::snprintf(cpuLabel, sizeof(cpuLabel), "CPU %d", i);
+        bool isCpuSelected = request.affinityMask & (1ULL << i);
+        if(ImGui::Checkbox(cpuLabel, &isCpuSelected))
+            request.affinityMask ^= (1ULL << i);
+    }
+    ImGui::Unindent();
+}
+
+void CTMProcessControl::RenderCpuSetControls()
+{
+    bool isUnavailable = cpuSets.empty();
+    if(isUnavailable)
+        ImGui::BeginDisabled();
+    ImGui::Checkbox("CPU Sets", &request.shouldSetCpuSets);
+    if(isUnavailable)
+    {
+        ImGui::EndDisabled();
+        return;
+    }
+    if(!request.shouldSetCpuSets)
+        return;
+
+    ImGui::Indent();
+    ImGui::TextDisabled("Nothing selected clears the cpu sets of the process.");
+    char cpuSetLabel[48];
+    for(std::size_t i = 0; i < cpuSets.size(); i++)
+    {
+        if(i % 4 != 0)
+            ImGui::SameLine();
+
+        auto& cpuSet = cpuSets[i];
+        std::snprintf(cpuSetLabel, sizeof(cpuSetLabel), "%lu (G%u C%u LP%u)", cpuSet.id, cpuSet.group, cpuSet.coreIndex,
+                      cpuSet.logicalProcessorIndex);
+        ImGui::Checkbox(cpuSetLabel, &cpuSet.isSelected);
+    }
+    ImGui::Unindent();
+}
+
+void CTMProcessControl::ApplyRequestToProcess(const CTMProcessControlRequest& requestToApply, DWORD processId, CTMProcessControlResult& result)
+{
+    result = {nullptr, processId, ERROR_SUCCESS};
+
+    //Our own handle with just the rights we need, the process screen's handles don't have PROCESS_SET_INFORMATION
+    HANDLE hProcess = OpenProcess(PROCESS_SET_INFORMATION | PROCESS_SET_LIMITED_INFORMATION | PROCESS_QUERY_LIMITED_INFORMATION,
+                                  FALSE, processId);
+    if(!hProcess)
+    {
+        result.failedStep = "OpenProcess";
+        result.errorCode  = GetLastError();
+        return;
+    }
+
+    //Stop at the first failure, so the error code is for the step we report
+    if(requestToApply.shouldSetPriority && !SetPriorityClass(hProcess, requestToApply.priorityClass))
+    {
+        result.failedStep = "Priority";
+        result.errorCode  = GetLastError();
+    }
+    else if(requestToApply.shouldSetIoPrio)
+    {
+        ULONG    ioPriority = requestToApply.ioPriority;
+        NTSTATUS status     = NtSetInformationProcess(hProcess, processIoPriorityClass, &ioPriority, sizeof(ioPriority));
+        if(status < 0) //!NT_SUCCESS
+        {
+            result.failedStep = "I/O Priority";
+            result.errorCode  = static_cast<DWORD>(status);
+        }
+    }
+
+    if(!result.failedStep && requestToApply.shouldSetAffinity &&
+       !SetProcessAffinityMask(hProcess, static_cast<DWORD_PTR>(requestToApply.affinityMask)))
+    {
+        result.failedStep = "Affinity";
+        result.errorCode  = GetLastError();
+    }
+
+    if(!result.failedStep && requestToApply.shouldSetCpuSets)
+    {
+        const ULONG* cpuSetIds   = requestToApply.cpuSetIds.empty() ? nullptr : requestToApply.cpuSetIds.data();
+        ULONG        cpuSetCount = static_cast<ULONG>(requestToApply.cpuSetIds.size());
+        if(!SetProcessDefaultCpuSets(hProcess, cpuSetIds, cpuSetCount))
+        {
+            result.failedStep = "CPU Sets";
+            result.errorCode  = GetLastError();
+        }
+    }
+
+    CloseHandle(hProcess);
+}
+
+void CTMProcessControl::JoinWorkerThread()
+{
+    if(workerThread.joinable())
+        workerThread.join();
+}
\ No newline at end of file
@@ -0,0 +1,142 @@
+#ifndef CTM_PROCESS_MENU_CONTROL_HPP
+#define CTM_PROCESS_MENU_CONTROL_HPP
+
+//Windows stuff
+#include <windows.h>
+#include <winternl.h>
+//ImGui stuff
+#include "../../ImGUI/imgui.h"
+//My stuff
+#include "../CTMPureHeaderFiles/ctm_logger.h"
+//Stdlib stuff
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+
+//NtSetInformationProcess is used for I/O priority as there is no documented winapi for it
+typedef NTSTATUS(NTAPI* NtSetInformationProcess_t)
+                (HANDLE, PROCESSINFOCLASS, PVOID, ULONG);
+//CPU set functions are Windows 10+ only, so we load them at runtime instead of linking them
+typedef BOOL(WINAPI* GetSystemCpuSetInformation_t)
+            (PSYSTEM_CPU_SET_INFORMATION, ULONG, PULONG, HANDLE, ULONG);
+typedef BOOL(WINAPI* SetProcessDefaultCpuSets_t)
+            (HANDLE, const ULONG*, ULONG);
+
+//What a single change (Apply button) is applied to
+enum class CTMProcessControlScope : int
+{
+    Process, //The process/group which was right clicked
+    Group,   //Every process in the group of the right clicked process
+    Rule     //Every process whose name contains the rule text
+};
+
+//Snapshot of what the user wants to change, copied into the worker thread so the UI can keep editing
+struct CTMProcessControlRequest
+{
+    //Perfect 8 byte alignment
+    ImU64              affinityMask       = 0;
+    std::vector<ULONG> cpuSetIds;                 //Empty means 'clear cpu sets' (process can run on any cpu set)
+    DWORD              priorityClass      = NORMAL_PRIORITY_CLASS;
+    ULONG              ioPriority         = 2;    //0 -> Very Low, 1 -> Low, 2 -> Normal
+    bool               shouldSetPriority  = false;
+    bool               shouldSetIoPrio    = false;
+    bool               shouldSetAffinity  = false;
+    bool               shouldSetCpuSets   = false;
+};
+
+//Result of applying a request to a single process
+struct CTMProcessControlResult
+{
+    const char* failedStep;  //nullptr if everything went well, else what failed (static string)
+    DWORD       processId;
+    DWORD       errorCode;   //GetLastError() or NTSTATUS for I/O priority
+};
+
+//Single CPU set of the system, fetched once
+struct CTMCpuSetEntry
+{
+    ULONG id;
+    BYTE  group;
+    BYTE  logicalProcessorIndex;
+    BYTE  coreIndex;
+    bool  isSelected;
+};
+
+using ProcessControlTargetVector = std::vector<DWORD>;
+using ProcessControlResultVector = std::vector<CTMProcessControlResult>;
+using CpuSetEntryVector          = std::vector<CTMCpuSetEntry>;
+
+/*
+ * Batch priority/affinity/cpu set control for processes.
+ * The UI thread edits the request through 'RenderControls' and calls 'ApplyAsync' with the target process ids.
+ * The whole batch is applied on a worker thread (opening its own handles), results are stored per pid under a mutex.
+ */
+class CTMProcessControl
+{
+public:
+    CTMProcessControl();
+    ~CTMProcessControl();
+
+    //No need for copy or move operations
+    CTMProcessControl(const CTMProcessControl&)            = delete;
+    CTMProcessControl& operator=(const CTMProcessControl&) = delete;
+    CTMProcessControl(CTMProcessControl&&)                 = delete;
+    CTMProcessControl& operator=(CTMProcessControl&&)      = delete;
+
+public: //Main functions
+    //Renders the scope selector and the settings, returns true if the user pressed 'Apply'
+    bool RenderControls(bool);
+    void RenderResults();
+    bool ApplyAsync(ProcessControlTargetVector&&);
+
+public: //Getters
+    CTMProcessControlScope GetScope()    const { return scope; }
+    const char*            GetRuleText() const { return ruleTextBuffer; }
+    bool                   IsBusy()      const { return isBusy.load(); }
+
+private: //Constructor init functions
+    bool CTMConstructorInitFunctions();
+    void CTMConstructorInitCpuSets();
+
+private: //Helper functions
+    void RenderAffinityControls();
+    void RenderCpuSetControls();
+    void ApplyRequestToProcess(const CTMProcessControlRequest&, DWORD, CTMProcessControlResult&);
+    void JoinWorkerThread();
+
+private: //Dynamically loaded functions
+    NtSetInformationProcess_t    NtSetInformationProcess    = nullptr;
+    GetSystemCpuSetInformation_t GetSystemCpuSetInformation = nullptr;
+    SetProcessDefaultCpuSets_t   SetProcessDefaultCpuSets   = nullptr;
+
+private: //UI state
+    CTMProcessControlRequest request;
+    CTMProcessControlScope   scope               = CTMProcessControlScope::Process;
+    char                     ruleTextBuffer[128] = {};
+    int                      priorityClassIndex  = 2; //Index into 'priorityClasses', 'Normal' by default
+    int                      ioPriorityIndex     = 2; //Same as ULONG io priority value
+    ImU64                    systemAffinityMask  = 0;
+    int                      logicalCpuCount     = 0;
+    CpuSetEntryVector        cpuSets;
+
+private: //Worker thread and results
+    std::thread                workerThread;
+    std::atomic<bool>          isBusy{false};
+    std::mutex                 resultsMutex;
+    ProcessControlResultVector results;
+
+private: //Constant stuff
+    //I/O priority is process info class 33 (ProcessIoPriority), not exposed in winternl.h
+    constexpr static PROCESSINFOCLASS processIoPriorityClass = static_cast<PROCESSINFOCLASS>(33);
+
+    constexpr static const char* priorityClassNames[] = {"Idle", "Below Normal", "Normal", "Above Normal", "High", "Realtime"};
+    constexpr static DWORD       priorityClasses[]    = {IDLE_PRIORITY_CLASS, BELOW_NORMAL_PRIORITY_CLASS, NORMAL_PRIORITY_CLASS,
+                                                         ABOVE_NORMAL_PRIORITY_CLASS, HIGH_PRIORITY_CLASS, REALTIME_PRIORITY_CLASS};
+    constexpr static const char* ioPriorityNames[]    = {"Very Low", "Low", "Normal"};
+};
+
+#endif
\ No newline at end of file
@@ -1,23 +1,31 @@
 #include "ctm_process_screen_etw.h"
 
 //Init global variables
-std::mutex              globalPsEtwMutex;
-ProcessResourceUsageMap globalProcessNetworkUsageMap;
-ProcessResourceUsageMap globalProcessFileUsageMap;
+std::mutex          globalPsEtwMutex;
+ExitedProcessVector globalExitedProcessVector;
 
 //Init static data members
 ULONG                CTMProcessScreenEventTracing::eventInfoBufferSize = 0;
 UniquePtrToByteArray CTMProcessScreenEventTracing::eventInfoBuffer     = nullptr;
+StartedProcessMap    CTMProcessScreenEventTracing::startedProcessMap;
+CTMEventSchemaCache  CTMProcessScreenEventTracing::networkSchemaCache{L"PID", L"size", L"daddr", L"saddr", L"dport", L"sport"};
+CTMEventSchemaCache  CTMProcessScreenEventTracing::fileSchemaCache{L"IOSize", L"FileKey", L"Irp"};
+CTMEventSchemaCache  CTMProcessScreenEventTracing::fileNameSchemaCache{L"FileKey", L"FileName"};
+CTMEventSchemaCache  CTMProcessScreenEventTracing::fileOperationEndSchemaCache{L"Irp"};
+CTMEventSchemaCache  CTMProcessScreenEventTracing::contextSwitchSchemaCache{L"NewThreadId", L"OldThreadId", L"OldThreadState"};
+CTMEventSchemaCache  CTMProcessScreenEventTracing::readyThreadSchemaCache{L"TThreadId"};
+CTMEventSchemaCache  CTMProcessScreenEventTracing::threadSchemaCache{L"ProcessId", L"TThreadId"};
+CTMEventSchemaCache  CTMProcessScreenEventTracing::dpcSchemaCache{L"InitialTime", L"Routine"};
+CTMEventSchemaCache  CTMProcessScreenEventTracing::isrSchemaCache{L"InitialTime", L"Routine"};
+std::atomic<std::uint64_t> CTMProcessScreenEventTracing::lostEventNotifications = 0;
 
 //--------------------PUBLIC FUNCTIONS-------------------- 
 bool CTMProcessScreenEventTracing::Start()
 {
+    //Providers are enabled later, when something asks for them (check ctm_event_session_manager.h)
     if(!StartTraceSession())
         return false;
 
-    if(!EnableProvider(true))
-        return false;
-
     if(!OpenTraceSession())
         return false;
 
@@ -27,16 +35,119 @@ bool CTMProcessScreenEventTracing::Start()
 bool CTMProcessScreenEventTracing::ProcessEvents()
 {
     ULONG status = ProcessTrace(&traceHandle, 1, nullptr, nullptr);
-    return status == ERROR_SUCCESS;
+    return status == ERROR_SUCCESS || status == ERROR_CANCELLED;
 }
 
 void CTMProcessScreenEventTracing::Stop()
 {
     //Disable providers before cleaning up resources
-    EnableProvider(false);
+    for(std::size_t i = 0; i < static_cast<std::size_t>(CTMEventProvider::Count); i++)
+        if(isProviderEnabled[i])
+            SetProviderEnabled(static_cast<CTMEventProvider>(i), false);
     Cleanup();
 }
 
+bool CTMProcessScreenEventTracing::SetProviderEnabled(CTMEventProvider provider, bool shouldEnable)
+{
+    bool& isEnabled = isProviderEnabled[static_cast<std::size_t>(provider)];
+    if(isEnabled == shouldEnable)
+        return true;
+
+    //Whoever owns the session disables what it enabled when it stops, doing it from here would pull the events out from under it
+    if(!shouldEnable && !isSessionOwner)
+    {
+        isEnabled = false;
+        return true;
+    }
+
+    ULONG controlCode = shouldEnable ? EVENT_CONTROL_CODE_ENABLE_PROVIDER : EVENT_CONTROL_CODE_DISABLE_PROVIDER;
+    bool  isSuccess   = false;
+    switch(provider)
+    {
+        case CTMEventProvider::KernelNetwork:
+            isSuccess = ConfigureProvider(krnlNetworkGuid, controlCode);
+            break;
+
+        case CTMEventProvider::KernelFile:
+            isSuccess = ConfigureProvider(krnlFileGuid, controlCode);
+            break;
+
+        case CTMEventProvider::KernelProcess:
+            isSuccess = ConfigureProvider(krnlProcessGuid, controlCode, krnlProcessKeyword);
+            break;
+
+        case CTMEventProvider::KernelContextSwitch:
+        case CTMEventProvider::KernelReadyThread:
+        case CTMEventProvider::KernelDpc:
+            isSuccess = ConfigureKernelFlagEvents(provider, shouldEnable);
+            break;
+
+        default:
+            return false;
+    }
+
+    //A provider which failed to disable is still treated as disabled, nothing is going to try it again anyway
+    isEnabled = shouldEnable && isSuccess;
+    return isSuccess;
+}
+
+void CTMProcessScreenEventTracing::AdjustToEventRate(double eventsPerSecond, bool isLosingEvents)
+{
+    //Buffer size and minimum are fixed once the session runs, the maximum isn't. Someone else's session isn't ours to resize
+    if(!sessionHandle || !isSessionOwner || bufferSettings.maximumBuffers > 0)
+        return;
+
+    std::uint32_t maximumBuffers = CTMEtwBufferPolicy::GrowMaximumBuffers(bufferSizing, eventsPerSecond, isLosingEvents);
+    if(maximumBuffers <= bufferSizing.maximumBuffers)
+        return;
+
+    //Zero -> leave it as it is
+    auto properties = ResetTraceProperties(queryPropsBuffer.get());
+    properties->BufferSize     = 0;
+    properties->MinimumBuffers = 0;
+    properties->MaximumBuffers = maximumBuffers;
+    ULONG status = ControlTraceW(sessionHandle, nullptr, properties, EVENT_TRACE_CONTROL_UPDATE);
+    if(status != ERROR_SUCCESS)
+    {
+        CTM_LOG_WARNING("Failed to grow the trace session's buffers to ", maximumBuffers, ". Error code: ", status);
+        //Don't try the same thing every second
+        bufferSettings.maximumBuffers = bufferSizing.maximumBuffers;
+        return;
+    }
+
+    CTM_LOG_INFO("Trace session buffers grown from ", bufferSizing.maximumBuffers, " to ", maximumBuffers, " (", static_cast<std::uint64_t>(eventsPerSecond), " events/s",
+                 isLosingEvents ? ", losing events)." : ").");
+    bufferSizing.maximumBuffers = maximumBuffers;
+}
+
+CTMEventTracingDiagnostics CTMProcessScreenEventTracing::GetDiagnostics()
+{
+    CTMEventTracingDiagnostics diagnostics = CTMEventSource::GetDiagnostics();
+    diagnostics.schemaTdhFallbacks     = networkSchemaCache.GetTdhFallbackCount() + fileSchemaCache.GetTdhFallbackCount() +
+                                         fileNameSchemaCache.GetTdhFallbackCount() + fileOperationEndSchemaCache.GetTdhFallbackCount() +
+                                         contextSwitchSchemaCache.GetTdhFallbackCount() + readyThreadSchemaCache.GetTdhFallbackCount() +
+                                         threadSchemaCache.GetTdhFallbackCount() + dpcSchemaCache.GetTdhFallbackCount() +
+                                         isrSchemaCache.GetTdhFallbackCount();
+    diagnostics.lostEventNotifications = lostEventNotifications.load(std::memory_order_relaxed);
+
+    if(!sessionHandle || tracePropsBufferSize == 0)
+        return diagnostics;
+
+    //ControlTrace fills the properties in, so it gets a fresh copy of the layout every time
+    auto properties = ResetTraceProperties(queryPropsBuffer.get());
+    if(ControlTraceW(sessionHandle, nullptr, properties, EVENT_TRACE_CONTROL_QUERY) == ERROR_SUCCESS)
+    {
+        diagnostics.etwEventsLost          = properties->EventsLost;
+        diagnostics.etwRealTimeBuffersLost = properties->RealTimeBuffersLost;
+        diagnostics.etwBufferSizeKB        = properties->BufferSize;
+        diagnostics.etwBuffers             = properties->NumberOfBuffers;
+        diagnostics.etwMaximumBuffers      = properties->MaximumBuffers;
+        diagnostics.etwFlushTimer          = properties->FlushTimer;
+    }
+
+    return diagnostics;
+}
+
 //--------------------HELPER FUNCTIONS--------------------
 void CTMProcessScreenEventTracing::Cleanup()
 {
@@ -45,10 +156,16 @@ void CTMProcessScreenEventTracing::Cleanup()
         CloseTrace(traceHandle);
         traceHandle = 0;
     }
-    if(sessionHandle)
+    //An attached session isn't ours to stop, closing our end of it is enough for ProcessTrace to return
+    if(sessionHandle && isSessionOwner)
+        StopTraceW(sessionHandle, nullptr, ResetTraceProperties(tracePropsBuffer.get()));
+    sessionHandle  = 0;
+    isSessionOwner = false;
+    isSystemLogger = false;
+    if(hSessionMutex)
     {
-        StopTraceW(sessionHandle, nullptr, reinterpret_cast<EVENT_TRACE_PROPERTIES*>(tracePropsBuffer.get()));
-        sessionHandle = 0;
+        CloseHandle(hSessionMutex);
+        hSessionMutex = nullptr;
     }
 }
 
@@ -56,18 +173,46 @@ bool CTMProcessScreenEventTracing::StartTraceSession()
 {
     //The part after EVENT_TRACE_PROPERTIES is session name and logger name.
     //What i assume is windows by default will use session name as logger name, hence this '((wcslen(sessionName) + 2) * 2)' length works
-    ULONG bufferSize = sizeof(EVENT_TRACE_PROPERTIES) + ((wcslen(sessionName) + 2) * 2);
-    tracePropsBuffer = std::make_unique<BYTE[]>(bufferSize);
-    ZeroMemory(tracePropsBuffer.get(), bufferSize);
+    tracePropsBufferSize = static_cast<ULONG>(sizeof(EVENT_TRACE_PROPERTIES) + ((wcslen(sessionName) + 2) * 2));
+    tracePropsBuffer     = std::make_unique<BYTE[]>(tracePropsBufferSize);
+    queryPropsBuffer     = std::make_unique<BYTE[]>(tracePropsBufferSize);
+
+    //Defaults are a handful of small buffers, a busy machine fills them faster than we get to them and the kernel drops events.
+    //Sized from the CPU count and the highest rate seen last time, anything picked in the settings screen wins
+    bufferSizing = CTMEtwBufferPolicy::Compute(GetActiveProcessorCount(ALL_PROCESSOR_GROUPS), bufferSettings);
+
+    //Named objects go away with the last handle to them, even if the process holding it crashed. So if it already exists-
+    //-another instance is running right now, and a session we find is its session and not a leftover
+    hSessionMutex = CreateMutexW(nullptr, FALSE, sessionMutexName);
+    bool isSessionInUse = hSessionMutex && GetLastError() == ERROR_ALREADY_EXISTS;
+
+    //A system logger gets the kernel's context switches on top of the providers, without taking the one and only 'NT Kernel Logger'
+    isSystemLogger   = true;
+    auto  properties = ResetTraceProperties(tracePropsBuffer.get());
+    ULONG status     = StartTraceW(&sessionHandle, sessionName, properties);
+    if(status == ERROR_ALREADY_EXISTS)
+    {
+        if(isSessionInUse)
+            return AttachToRunningSession();
 
-    auto properties = reinterpret_cast<EVENT_TRACE_PROPERTIES*>(tracePropsBuffer.get());
-    properties->Wnode.BufferSize = bufferSize;
-    properties->Wnode.ClientContext = 1; //Use QueryPerformanceCounter for timestamps
-    properties->Wnode.Flags = WNODE_FLAG_TRACED_GUID;
-    properties->LogFileMode = EVENT_TRACE_REAL_TIME_MODE;
-    properties->LoggerNameOffset = sizeof(EVENT_TRACE_PROPERTIES);
+        //Nobody is using it, an instance before us crashed (or got killed) without stopping it. Stop it and take the name back
+        CTM_LOG_WARNING("Found a trace session left behind by an earlier run, stopping it.");
+        if(StopOrphanedSession())
+        {
+            properties = ResetTraceProperties(tracePropsBuffer.get());
+            status     = StartTraceW(&sessionHandle, sessionName, properties);
+        }
+    }
+
+    //Windows 7 doesn't know the system logger mode, everything but the context switches works without it
+    if(status == ERROR_INVALID_PARAMETER && isSystemLogger)
+    {
+        CTM_LOG_WARNING("The trace session can't be a system logger on this version of Windows, context switch tracing won't be available.");
+        isSystemLogger = false;
+        properties     = ResetTraceProperties(tracePropsBuffer.get());
+        status         = StartTraceW(&sessionHandle, sessionName, properties);
+    }
 
-    ULONG status = StartTraceW(&sessionHandle, sessionName, properties);
     if(status != ERROR_SUCCESS)
     {
         CTM_LOG_ERROR_NONL("Failed to start trace session.");
@@ -96,16 +241,57 @@ bool CTMProcessScreenEventTracing::StartTraceSession()
                 break;
         }
 
+        sessionHandle = 0;
+        Cleanup();
+        return false;
+    }
+
+    isSessionOwner = true;
+    CTM_LOG_SUCCESS("Successfully started trace session (", bufferSizing.bufferSizeKB, " KB buffers, ", bufferSizing.minimumBuffers, " to ",
+                    bufferSizing.maximumBuffers, " of them, flushed every ", bufferSizing.flushTimerSeconds, "s).");
+    return true;
+}
+
+bool CTMProcessScreenEventTracing::StopOrphanedSession()
+{
+    //No handle to it, it gets stopped by name
+    ULONG status = ControlTraceW(0, sessionName, ResetTraceProperties(tracePropsBuffer.get()), EVENT_TRACE_CONTROL_STOP);
+    if(status != ERROR_SUCCESS)
+    {
+        CTM_LOG_ERROR("Failed to stop the left behind trace session. Error code: ", status);
+        return false;
+    }
+
+    return true;
+}
+
+bool CTMProcessScreenEventTracing::AttachToRunningSession()
+{
+    //Real time sessions can have more than one consumer, the query hands us the handle for enabling providers on it
+    auto  properties = ResetTraceProperties(tracePropsBuffer.get());
+    ULONG status     = ControlTraceW(0, sessionName, properties, EVENT_TRACE_CONTROL_QUERY);
+    if(status != ERROR_SUCCESS)
+    {
+        CTM_LOG_ERROR("Failed to attach to the trace session of another running instance. Error code: ", status);
+        Cleanup();
         return false;
     }
 
-    CTM_LOG_SUCCESS("Successfully started trace session.");
+    sessionHandle  = properties->Wnode.HistoricalContext;
+    isSessionOwner = false;
+    isSystemLogger = (properties->LogFileMode & EVENT_TRACE_SYSTEM_LOGGER_MODE) != 0;
+    //It was sized by whoever started it, show what it really has
+    bufferSizing.bufferSizeKB      = properties->BufferSize;
+    bufferSizing.minimumBuffers    = properties->MinimumBuffers;
+    bufferSizing.maximumBuffers    = properties->MaximumBuffers;
+    bufferSizing.flushTimerSeconds = properties->FlushTimer;
+    CTM_LOG_INFO("Another instance is already running the trace session, attached to it instead of starting a new one.");
     return true;
 }
 
-bool CTMProcessScreenEventTracing::ConfigureProvider(const GUID& providerGuid, ULONG controlCode)
+bool CTMProcessScreenEventTracing::ConfigureProvider(const GUID& providerGuid, ULONG controlCode, ULONGLONG matchAnyKeyword)
 {
-    ULONG status = EnableTraceEx2(sessionHandle, &providerGuid, controlCode, TRACE_LEVEL_INFORMATION, 0, 0, 0, nullptr);
+    ULONG status = EnableTraceEx2(sessionHandle, &providerGuid, controlCode, TRACE_LEVEL_INFORMATION, matchAnyKeyword, 0, 0, nullptr);
     if(status != ERROR_SUCCESS)
     {
         CTM_LOG_ERROR_NONL("Failed to ", (controlCode == EVENT_CONTROL_CODE_ENABLE_PROVIDER ? "enable" : "disable"), " provider(Data1): ",
@@ -132,31 +318,72 @@ bool CTMProcessScreenEventTracing::ConfigureProvider(const GUID& providerGuid, U
     return true;
 }
 
-bool CTMProcessScreenEventTracing::EnableProvider(bool shouldEnable)
+bool CTMProcessScreenEventTracing::ConfigureKernelFlagEvents(CTMEventProvider provider, bool shouldEnable)
 {
-    ULONG controlCode = shouldEnable ? EVENT_CONTROL_CODE_ENABLE_PROVIDER : EVENT_CONTROL_CODE_DISABLE_PROVIDER;
+    const char* eventsName = provider == CTMEventProvider::KernelReadyThread ? "ready thread" :
+                             provider == CTMEventProvider::KernelDpc         ? "DPC/ISR"      : "context switch";
+    if(!isSystemLogger)
+    {
+        if(shouldEnable)
+            CTM_LOG_ERROR("The ", eventsName, " tracing needs the trace session to be a system logger (Windows 8 and newer).");
+        return !shouldEnable;
+    }
 
-    if(shouldEnable)
+    //These providers share the session's flags, so the flags are worked out from what each of them wants after this call
+    auto isWanted = [&](CTMEventProvider flagProvider) {
+        return flagProvider == provider ? shouldEnable : isProviderEnabled[static_cast<std::size_t>(flagProvider)];
+    };
+    bool isTimelineWanted = isWanted(CTMEventProvider::KernelContextSwitch);
+    bool isReadyWanted    = isWanted(CTMEventProvider::KernelReadyThread);
+    bool isDpcWanted      = isWanted(CTMEventProvider::KernelDpc);
+
+    //Rings first, the first switch can show up before TraceSetInformation even returns. The ready latencies need the timeline's thread to process map too.
+    //The snapshot covers threads which started before us, rundown events (if the kernel sends any) just confirm them
+    if(shouldEnable && provider != CTMEventProvider::KernelDpc)
     {
-        isKrnlNetworkInitialized = ConfigureProvider(krnlNetworkGuid, controlCode);
-        if(!isKrnlNetworkInitialized)
-        {
-            Cleanup();
-            return false;
-        }
-        isKrnlFileInitialized = ConfigureProvider(krnlFileGuid, controlCode);
-        if(!isKrnlFileInitialized)
+        if(!globalCpuTimeline.Allocate(GetActiveProcessorCount(ALL_PROCESSOR_GROUPS)))
         {
-            Cleanup();
+            CTM_LOG_ERROR("Failed to allocate the CPU timeline for ", eventsName, " tracing.");
             return false;
         }
+        SeedThreadProcesses();
     }
-    else
+    //DPCs and ISRs only carry the routine, the drivers they live in are looked up in what's loaded right now
+    if(provider == CTMEventProvider::KernelDpc && shouldEnable)
+        globalDpcLatencyTracker.SetDrivers(EnumerateDriverModules());
+
+    auto setTrackerEnabled = [provider](bool isEnabled) {
+        if(provider == CTMEventProvider::KernelReadyThread)
+            globalReadyLatencyTracker.SetEnabled(isEnabled);
+        else if(provider == CTMEventProvider::KernelDpc)
+            globalDpcLatencyTracker.SetEnabled(isEnabled);
+    };
+    if(shouldEnable)
+        setTrackerEnabled(true);
+
+    //Kernel groups aren't providers, they are flags on the session. The first of the 8 group masks is the classic 'EnableFlags'
+    ULONG groupMasks[8] = {};
+    if(isTimelineWanted || isReadyWanted)
+        groupMasks[0] = EVENT_TRACE_FLAG_CSWITCH | EVENT_TRACE_FLAG_THREAD;
+    if(isReadyWanted)
+        groupMasks[0] |= EVENT_TRACE_FLAG_DISPATCHER;
+    if(isDpcWanted)
+        groupMasks[0] |= EVENT_TRACE_FLAG_DPC | EVENT_TRACE_FLAG_INTERRUPT;
+
+    ULONG status = TraceSetInformation(sessionHandle, TraceSystemTraceEnableFlagsInfo, groupMasks, sizeof(groupMasks));
+    if(status != ERROR_SUCCESS)
     {
-        if(isKrnlNetworkInitialized) { ConfigureProvider(krnlNetworkGuid, controlCode); isKrnlNetworkInitialized = false; }
-        if(isKrnlFileInitialized)    { ConfigureProvider(krnlFileGuid, controlCode);    isKrnlFileInitialized    = false; }
+        CTM_LOG_ERROR("Failed to ", (shouldEnable ? "enable" : "disable"), " ", eventsName, " tracing. Error code: ", status);
+        if(shouldEnable)
+            setTrackerEnabled(false);
+        return false;
     }
 
+    //Late buffers can still bring a few, nothing waits on them anymore
+    if(!shouldEnable)
+        setTrackerEnabled(false);
+
+    CTM_LOG_SUCCESS("Successfully ", (shouldEnable ? "enabled" : "disabled"), " ", eventsName, " tracing.");
     return true;
 }
 
@@ -180,95 +407,405 @@ bool CTMProcessScreenEventTracing::OpenTraceSession()
     return true;
 }
 
+EVENT_TRACE_PROPERTIES* CTMProcessScreenEventTracing::ResetTraceProperties(BYTE* propsBuffer)
+{
+    //StartTrace and ControlTrace both write into the properties, every call gets them fresh
+    ZeroMemory(propsBuffer, tracePropsBufferSize);
+
+    auto properties = reinterpret_cast<EVENT_TRACE_PROPERTIES*>(propsBuffer);
+    properties->Wnode.BufferSize    = tracePropsBufferSize;
+    properties->Wnode.ClientContext = 1; //Use QueryPerformanceCounter for timestamps
+    properties->Wnode.Flags         = WNODE_FLAG_TRACED_GUID;
+    properties->LogFileMode         = EVENT_TRACE_REAL_TIME_MODE | (isSystemLogger ? EVENT_TRACE_SYSTEM_LOGGER_MODE : 0);
+    properties->LoggerNameOffset    = sizeof(EVENT_TRACE_PROPERTIES);
+    properties->BufferSize          = bufferSizing.bufferSizeKB;
+    properties->MinimumBuffers      = bufferSizing.minimumBuffers;
+    properties->MaximumBuffers      = bufferSizing.maximumBuffers;
+    properties->FlushTimer          = bufferSizing.flushTimerSeconds;
+    return properties;
+}
+
 //--------------------STATIC FUNCTIONS--------------------
-void CTMProcessScreenEventTracing::WritePropInfoToMap(PEVENT_RECORD eventRecord, HandlePropertyForEventType eventType)
+void CTMProcessScreenEventTracing::WritePropInfoToMap(PEVENT_RECORD eventRecord, HandlePropertyForEventType eventType, CTMUsageCounter usageCounter)
+{
+    //Layout is resolved once per event kind, after that these are direct reads from the event payload
+    ULONGLONG fieldValues[6] = {};
+    ULONGLONG fileKey        = 0;
+    ULONGLONG irp            = 0;
+    switch(eventType)
+    {
+        //Both TCP and UDP have properties named 'PID' and 'size'.
+        //'PID' is process id and 'size' is the packet size sent over network
+        //The endpoints make it a flow, so network events take their own path
+        case HandlePropertyForEventType::KernelNetworkTcpUdp:
+            if(!networkSchemaCache.ReadFields(eventRecord, fieldValues))
+                return;
+            WriteNetworkFlowRecord(eventRecord, fieldValues, usageCounter);
+            return;
+
+        //The process doing the IO is the one in the event header, 'FileKey' is the file it went to (for the top files)-
+        //-and 'Irp' is what its OperationEnd will carry (for the latencies)
+        case HandlePropertyForEventType::KernelFileRW:
+            if(!fileSchemaCache.ReadFields(eventRecord, fieldValues))
+                return;
+            fileKey        = fieldValues[1];
+            irp            = fieldValues[2];
+            fieldValues[1] = fieldValues[0];
+            fieldValues[0] = eventRecord->EventHeader.ProcessId;
+            break;
+
+        //Process lifecycle events are handled by 'WriteProcessLifecycleInfo'
+        default:
+            return;
+    }
+
+    //Fields are UInt32 in the manifests, keep the old truncation
+    UINT32 processId    = static_cast<UINT32>(fieldValues[0]),
+           processUsage = static_cast<UINT32>(fieldValues[1]);
+
+    //Aggregation happens on its own thread, if it falls behind we drop (and count) instead of making the session lose events
+    CTMUsageEventRecord record;
+    record.timestamp = eventRecord->EventHeader.TimeStamp.QuadPart;
+    record.fileKey   = fileKey;
+    record.irp       = irp;
+    record.processId = processId;
+    record.bytes     = processUsage;
+    record.kind      = usageCounter;
+    globalUsageEventPipeline.PublishUsage(record);
+}
+
+void CTMProcessScreenEventTracing::WriteFileOperationEnd(PEVENT_RECORD eventRecord)
+{
+    //Every file operation ends with one of these (creates, closes, ...), the aggregator only keeps the ones it saw a read or write start for
+    ULONGLONG fieldValues[1] = {};
+    if(!fileOperationEndSchemaCache.ReadFields(eventRecord, fieldValues) || fieldValues[0] == 0)
+        return;
+
+    CTMUsageEventRecord record;
+    record.timestamp = eventRecord->EventHeader.TimeStamp.QuadPart;
+    record.irp       = fieldValues[0];
+    record.kind      = CTMUsageCounter::FileRead;
+    record.type      = CTMUsageEventType::FileIoCompletion;
+    globalUsageEventPipeline.PublishUsage(record);
+}
+
+void CTMProcessScreenEventTracing::WriteNetworkFlowRecord(PEVENT_RECORD eventRecord, const ULONGLONG* fieldValues, CTMUsageCounter usageCounter)
 {
-    //For both Kernel Network and Kernel File
-    //By default let the processId have a value (If its Kernel Network, it will be changed below)
-    UINT32 processId    = eventRecord->EventHeader.ProcessId,
-           processUsage = 0;
-    //Also i'm using ULONG instead of TDHSTATUS cuz g++ is not recognizing it for some odd reason
-    ULONG status        = 0;
-
-    //Try to get information with the existing buffer
-    status = TdhGetEventInformation(eventRecord, 0, nullptr,
+    CTMNetworkFlowRecord record;
+    record.timestamp = eventRecord->EventHeader.TimeStamp.QuadPart;
+    record.bytes     = static_cast<UINT32>(fieldValues[1]);
+    record.kind      = usageCounter;
+
+    //'saddr'/'sport' is always our side and 'daddr'/'dport' the other one, no matter the direction (same as Process Hacker reads them).
+    //IPv4 events carry 4 byte addresses and IPv6 ones 16 bytes, the size tells them apart
+    CTMNetworkFlowKey& key = record.key;
+    key.processId     = static_cast<UINT32>(fieldValues[0]);
+    key.protocol      = (usageCounter == CTMUsageCounter::TcpSent || usageCounter == CTMUsageCounter::TcpReceived) ? CTMFlowProtocol::Tcp : CTMFlowProtocol::Udp;
+    USHORT remoteSize = networkSchemaCache.ReadFieldBytes(eventRecord, 2, key.remoteAddress, sizeof(key.remoteAddress));
+    USHORT localSize  = networkSchemaCache.ReadFieldBytes(eventRecord, 3, key.localAddress, sizeof(key.localAddress));
+    key.addressLength = static_cast<std::uint8_t>(remoteSize == 16 && localSize == 16 ? 16 : 4);
+    //Ports are in network byte order
+    auto toHostOrder  = [](ULONGLONG port){ return static_cast<USHORT>(((port & 0xFF) << 8) | ((port >> 8) & 0xFF)); };
+    key.remotePort    = toHostOrder(fieldValues[4]);
+    key.localPort     = toHostOrder(fieldValues[5]);
+
+    globalUsageEventPipeline.PublishNetworkFlow(record);
+}
+
+void CTMProcessScreenEventTracing::WriteProcessLifecycleInfo(PEVENT_RECORD eventRecord, HandlePropertyForEventType eventType)
+{
+    ULONG status = TdhGetEventInformation(eventRecord, 0, nullptr,
                     reinterpret_cast<PTRACE_EVENT_INFO>(eventInfoBuffer.get()), &eventInfoBufferSize);
-    
-    //If buffer isn't long enough, reallocate
+
     if(status == ERROR_INSUFFICIENT_BUFFER)
     {
         eventInfoBuffer = std::make_unique<BYTE[]>(eventInfoBufferSize);
-
-        status = TdhGetEventInformation(eventRecord, 0, nullptr, 
+        status = TdhGetEventInformation(eventRecord, 0, nullptr,
                     reinterpret_cast<PTRACE_EVENT_INFO>(eventInfoBuffer.get()), &eventInfoBufferSize);
+    }
 
-        //Failed to get information, print some error and move on for now
-        if(status != ERROR_SUCCESS)
-        {
-            CTM_LOG_ERROR("Failed to get event information for event type: ", (int)eventType, ". Error code: ", status);
-            return;
-        }
+    if(status != ERROR_SUCCESS)
+    {
+        CTM_LOG_ERROR("Failed to get event information for event type: ", (int)eventType, ". Error code: ", status);
+        return;
     }
 
-    //The buffer is long enough, just use it for now
+    //Every number is read into a zeroed 64 bit value, smaller properties (UInt32) only fill the lower bytes
+    ULONGLONG processId = 0, parentProcessId = 0, exitCode = 0, createTime = 0, exitTime = 0,
+              cycleCount = 0, readKiloBytes = 0, writeKiloBytes = 0, commitPeak = 0;
+    std::string imageName;
+
     PTRACE_EVENT_INFO        eventInfo    = reinterpret_cast<PTRACE_EVENT_INFO>(eventInfoBuffer.get());
     PROPERTY_DATA_DESCRIPTOR propertyData = {};
 
-    //Loop through properties and find the one we require
     for(ULONG i = 0; i < eventInfo->PropertyCount; ++i)
     {
         LPCWSTR propNameW = reinterpret_cast<LPCWSTR>(reinterpret_cast<PBYTE>(eventInfo) + eventInfo->EventPropertyInfoArray[i].NameOffset);
 
         propertyData.PropertyName = reinterpret_cast<ULONGLONG>(propNameW);
-        propertyData.ArrayIndex = 0;
+        propertyData.ArrayIndex   = 0;
+
+        ULONGLONG* numberProperty = nullptr;
+        if(wcscmp(propNameW, L"ProcessID") == 0)                   numberProperty = &processId;
+        else if(wcscmp(propNameW, L"ParentProcessID") == 0)        numberProperty = &parentProcessId;
+        else if(wcscmp(propNameW, L"CreateTime") == 0)             numberProperty = &createTime;
+        else if(wcscmp(propNameW, L"ExitTime") == 0)               numberProperty = &exitTime;
+        else if(wcscmp(propNameW, L"ExitCode") == 0)               numberProperty = &exitCode;
+        else if(wcscmp(propNameW, L"CPUCycleCount") == 0)          numberProperty = &cycleCount;
+        else if(wcscmp(propNameW, L"ReadTransferKiloBytes") == 0)  numberProperty = &readKiloBytes;
+        else if(wcscmp(propNameW, L"WriteTransferKiloBytes") == 0) numberProperty = &writeKiloBytes;
+        else if(wcscmp(propNameW, L"CommitPeak") == 0)             numberProperty = &commitPeak;
+        else if(wcscmp(propNameW, L"ImageName") == 0)
+        {
+            //Full NT path (unicode) in ProcessStart, just the file name (ansi) in ProcessStop
+            ULONG propertySize = 0;
+            if(TdhGetPropertySize(eventRecord, 0, nullptr, 1, &propertyData, &propertySize) != ERROR_SUCCESS || propertySize == 0)
+                continue;
+
+            std::vector<BYTE> nameBuffer(propertySize + sizeof(WCHAR), 0);
+            if(TdhGetProperty(eventRecord, 0, nullptr, 1, &propertyData, propertySize, nameBuffer.data()) != ERROR_SUCCESS)
+                continue;
+
+            if(eventInfo->EventPropertyInfoArray[i].nonStructType.InType == TDH_INTYPE_UNICODESTRING)
+            {
+                CHAR nameUtf8[MAX_PATH];
+                int  bytesWritten = WideCharToMultiByte(CP_UTF8, 0, reinterpret_cast<LPCWSTR>(nameBuffer.data()), -1,
+                                                        nameUtf8, sizeof(nameUtf8), NULL, NULL);
+                if(bytesWritten > 0)
+                    imageName = nameUtf8;
+            }
+            else
+                imageName = reinterpret_cast<const char*>(nameBuffer.data());
+
+            //Only keep the file name so it matches the process screen groups
+            size_t nameStart = imageName.find_last_of('\\');
+            if(nameStart != std::string::npos)
+                imageName.erase(0, nameStart + 1);
+            continue;
+        }
+
+        if(numberProperty)
+        {
+            status = TdhGetProperty(eventRecord, 0, nullptr, 1, &propertyData, sizeof(ULONGLONG), reinterpret_cast<PBYTE>(numberProperty));
+            if(status != ERROR_SUCCESS)
+                *numberProperty = 0;
+        }
+    }
 
-        switch(eventType)
+    if(eventType == HandlePropertyForEventType::KernelProcessStart)
+    {
+        CTMStartedProcessInfo& startedProcess = startedProcessMap[static_cast<DWORD>(processId)];
+        //Same pid again without a stop in between (lost event), the old handle is useless now
+        if(startedProcess.hProcess)
+            CloseHandle(startedProcess.hProcess);
+
+        startedProcess.imageName       = std::move(imageName);
+        startedProcess.parentProcessId = static_cast<DWORD>(parentProcessId);
+        startedProcess.hProcess        = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, static_cast<DWORD>(processId));
+
+        //Events are delivered late, by now the pid may belong to someone else. Creation time tells us
+        FILETIME ftCreation, ftExit, ftKernel, ftUser;
+        if(startedProcess.hProcess && (!GetProcessTimes(startedProcess.hProcess, &ftCreation, &ftExit, &ftKernel, &ftUser) ||
+                                        reinterpret_cast<ULARGE_INTEGER&>(ftCreation).QuadPart != createTime))
         {
-            case HandlePropertyForEventType::KernelNetworkTcpUdp:
+            CloseHandle(startedProcess.hProcess);
+            startedProcess.hProcess = nullptr;
+        }
+        return;
+    }
+
+    CTMExitedProcessInfo exitedProcess;
+    exitedProcess.processId  = static_cast<DWORD>(processId);
+    exitedProcess.exitCode   = static_cast<DWORD>(exitCode);
+    exitedProcess.createTime = createTime;
+    exitedProcess.exitTime   = exitTime;
+    exitedProcess.commitPeak = commitPeak;
+    exitedProcess.readBytes  = readKiloBytes * 1024;
+    exitedProcess.writeBytes = writeKiloBytes * 1024;
+    exitedProcess.imageName  = std::move(imageName);
+
+    auto it = startedProcessMap.find(exitedProcess.processId);
+    if(it != startedProcessMap.end())
+    {
+        CTMStartedProcessInfo& startedProcess = it->second;
+        exitedProcess.parentProcessId         = startedProcess.parentProcessId;
+        if(!startedProcess.imageName.empty())
+            exitedProcess.imageName = std::move(startedProcess.imageName);
+
+        //We kept the process object alive, so its final times and io counters are exact
+        if(startedProcess.hProcess)
+        {
+            FILETIME ftCreation, ftExit, ftKernel, ftUser;
+            if(GetProcessTimes(startedProcess.hProcess, &ftCreation, &ftExit, &ftKernel, &ftUser))
             {
-                //Both TCP and UDP have properties named 'PID' and 'size'.
-                //'PID' is process id and 'size' is the packet size sent over network
-                if(wcscmp(propNameW, L"PID") == 0)
-                {
-                    status = TdhGetProperty(eventRecord, 0, nullptr, 1, &propertyData, sizeof(processId), reinterpret_cast<PBYTE>(&processId));
-                    if(status != ERROR_SUCCESS)
-                        CTM_LOG_ERROR("Failed to get PID property from Kernel-Network. Error code: ", status);
-                }
-                else if(wcscmp(propNameW, L"size") == 0)
-                {
-                    status = TdhGetProperty(eventRecord, 0, nullptr, 1, &propertyData, sizeof(processUsage), reinterpret_cast<PBYTE>(&processUsage));
-                    if(status != ERROR_SUCCESS)
-                        CTM_LOG_ERROR("Failed to get size property from Kernel-Network. Error code: ", status);
-                }
+                exitedProcess.cpuTime        = reinterpret_cast<ULARGE_INTEGER&>(ftKernel).QuadPart +
+                                               reinterpret_cast<ULARGE_INTEGER&>(ftUser).QuadPart;
+                exitedProcess.isCpuTimeExact = true;
             }
-            break;
 
-            case HandlePropertyForEventType::KernelFileRW:
+            IO_COUNTERS ioCounters;
+            if(GetProcessIoCounters(startedProcess.hProcess, &ioCounters))
             {
-                if(wcscmp(propNameW, L"IOSize") == 0)
-                {
-                    status = TdhGetProperty(eventRecord, 0, nullptr, 1, &propertyData, sizeof(processUsage), reinterpret_cast<PBYTE>(&processUsage));
-                    if(status != ERROR_SUCCESS)
-                        CTM_LOG_ERROR("Failed to get IOSize property from Kernel-File. Error code: ", status);
-                }
+                exitedProcess.readBytes  = ioCounters.ReadTransferCount;
+                exitedProcess.writeBytes = ioCounters.WriteTransferCount;
             }
-            break;
+
+            CloseHandle(startedProcess.hProcess);
         }
+
+        startedProcessMap.erase(it);
     }
 
-    //As 'usage maps' will be used in threaded environment, use locks
+    if(!exitedProcess.isCpuTimeExact)
+        exitedProcess.cpuTime = EstimateCpuTimeFromCycles(cycleCount);
+
     std::lock_guard<std::mutex> lock(globalPsEtwMutex);
+    if(globalExitedProcessVector.size() < maxPendingExitedProcesses)
+        globalExitedProcessVector.push_back(std::move(exitedProcess));
+}
 
-    //Finally write the property information to the desired map
-    switch(eventType)
+void CTMProcessScreenEventTracing::WriteFileNameInfo(PEVENT_RECORD eventRecord, HandlePropertyForEventType eventType)
+{
+    //The key is what the read and write events carry, the name is how we show it in the top files
+    ULONGLONG fileKey = 0;
+    if(fileNameSchemaCache.ReadFieldBytes(eventRecord, 0, reinterpret_cast<BYTE*>(&fileKey), sizeof(fileKey)) == 0 || fileKey == 0)
+        return;
+
+    if(eventType == HandlePropertyForEventType::KernelFileNameDelete)
     {
-        case HandlePropertyForEventType::KernelNetworkTcpUdp:
-            globalProcessNetworkUsageMap[processId] += processUsage;
-            break;
-        case HandlePropertyForEventType::KernelFileRW:
-            globalProcessFileUsageMap[processId] += processUsage;
-            break;
+        globalFileUsageTracker.RemoveFileName(fileKey);
+        return;
+    }
+
+    WCHAR  nameBuffer[maxFileNameBytes / sizeof(WCHAR) + 1];
+    USHORT nameSize = fileNameSchemaCache.ReadFieldBytes(eventRecord, 1, reinterpret_cast<BYTE*>(nameBuffer), maxFileNameBytes);
+    if(nameSize < sizeof(WCHAR))
+        return;
+
+    //TDH hands the terminator back as part of the string, don't count on it being there though
+    std::size_t nameLength = nameSize / sizeof(WCHAR);
+    nameBuffer[nameLength] = L'\0';
+    globalFileUsageTracker.SetFileName(fileKey, std::wstring(nameBuffer, wcsnlen(nameBuffer, nameLength)));
+}
+
+void CTMProcessScreenEventTracing::WriteContextSwitch(PEVENT_RECORD eventRecord)
+{
+    //Tens of thousands a second, 'NewThreadId', 'OldThreadId' and 'OldThreadState' are read straight out of the payload once the layout is known.
+    //The core is where the event was logged, CSwitch is always logged on the core which switched
+    ULONGLONG fieldValues[3] = {};
+    if(!contextSwitchSchemaCache.ReadFields(eventRecord, fieldValues))
+        return;
+
+    ULONGLONG timestamp = eventRecord->EventHeader.TimeStamp.QuadPart;
+    DWORD     newThread = static_cast<DWORD>(fieldValues[0]);
+    globalCpuTimeline.RecordSwitch(eventRecord->BufferContext.ProcessorIndex, timestamp, newThread);
+
+    //Both do nothing while the ready latencies are off. A preempted thread never gets a ReadyThread, it starts waiting right here
+    globalReadyLatencyTracker.RecordSwitchIn(timestamp, newThread);
+    if(fieldValues[2] == threadStateReady)
+        globalReadyLatencyTracker.RecordReady(timestamp, static_cast<DWORD>(fieldValues[1]));
+}
+
+void CTMProcessScreenEventTracing::WriteReadyThread(PEVENT_RECORD eventRecord)
+{
+    //'TThreadId' is the thread made ready, the header's is whoever readied it (or whatever ran when an interrupt did)
+    ULONGLONG fieldValues[1] = {};
+    if(!readyThreadSchemaCache.ReadFields(eventRecord, fieldValues))
+        return;
+
+    globalReadyLatencyTracker.RecordReady(eventRecord->EventHeader.TimeStamp.QuadPart, static_cast<DWORD>(fieldValues[0]));
+}
+
+void CTMProcessScreenEventTracing::WriteThreadStart(PEVENT_RECORD eventRecord)
+{
+    //'ProcessId' and 'TThreadId', the header's ids are whoever created the thread
+    ULONGLONG fieldValues[2] = {};
+    if(!threadSchemaCache.ReadFields(eventRecord, fieldValues))
+        return;
+
+    globalCpuTimeline.SetThreadProcess(static_cast<DWORD>(fieldValues[1]), static_cast<DWORD>(fieldValues[0]));
+}
+
+void CTMProcessScreenEventTracing::WriteDpcOrIsr(PEVENT_RECORD eventRecord, CTMDpcKind kind)
+{
+    //'InitialTime' is when the routine started (same clock as the header), the event itself is logged when it returned.
+    //The core is where the event was logged, a DPC or ISR always returns on the core it ran on
+    CTMEventSchemaCache& schemaCache = kind == CTMDpcKind::Isr ? isrSchemaCache : dpcSchemaCache;
+    ULONGLONG fieldValues[2] = {};
+    if(!schemaCache.ReadFields(eventRecord, fieldValues))
+        return;
+
+    globalDpcLatencyTracker.RecordRoutine(eventRecord->EventHeader.TimeStamp.QuadPart, fieldValues[0], fieldValues[1],
+                                          eventRecord->BufferContext.ProcessorIndex, kind);
+}
+
+void CTMProcessScreenEventTracing::SeedThreadProcesses()
+{
+    HANDLE hSnapshot = CreateToolhelp32Snapshot(TH32CS_SNAPTHREAD, 0);
+    if(hSnapshot == INVALID_HANDLE_VALUE)
+    {
+        CTM_LOG_WARNING("Failed to snapshot the running threads, context switches of threads started before tracing may show up without a process.");
+        return;
+    }
+
+    THREADENTRY32 threadEntry;
+    threadEntry.dwSize = sizeof(threadEntry);
+    if(Thread32First(hSnapshot, &threadEntry))
+    {
+        do
+            globalCpuTimeline.SetThreadProcess(threadEntry.th32ThreadID, threadEntry.th32OwnerProcessID);
+        while(Thread32Next(hSnapshot, &threadEntry));
+    }
+
+    CloseHandle(hSnapshot);
+}
+
+std::vector<CTMDriverModule> CTMProcessScreenEventTracing::EnumerateDriverModules()
+{
+    //Ask with a guess first, the second call only happens if more got loaded than that
+    std::vector<LPVOID> driverBases(1024);
+    DWORD neededBytes = 0;
+    if(!EnumDeviceDrivers(driverBases.data(), static_cast<DWORD>(driverBases.size() * sizeof(LPVOID)), &neededBytes))
+    {
+        CTM_LOG_WARNING("Failed to list the loaded drivers, every DPC/ISR will show up as 'Unknown'. Error code: ", GetLastError());
+        return {};
+    }
+    if(neededBytes > driverBases.size() * sizeof(LPVOID))
+    {
+        driverBases.resize(neededBytes / sizeof(LPVOID));
+        if(!EnumDeviceDrivers(driverBases.data(), static_cast<DWORD>(driverBases.size() * sizeof(LPVOID)), &neededBytes))
+            return {};
     }
+
+    std::vector<CTMDriverModule> drivers;
+    drivers.reserve(neededBytes / sizeof(LPVOID));
+    char nameBuffer[MAX_PATH];
+    for(std::size_t i = 0; i < neededBytes / sizeof(LPVOID); i++)
+    {
+        //Bases come back as 0 without administrator rights, the tracing needs those anyway
+        if(!driverBases[i] || GetDeviceDriverBaseNameA(driverBases[i], nameBuffer, MAX_PATH) == 0)
+            continue;
+        drivers.push_back({reinterpret_cast<ULONGLONG>(driverBases[i]), nameBuffer});
+    }
+    return drivers;
+}
+
+ULONGLONG CTMProcessScreenEventTracing::EstimateCpuTimeFromCycles(ULONGLONG cycleCount)
+{
+    //Nominal frequency of the first processor, cycles are counted at a constant rate so this is close enough
+    static DWORD processorMhz = [](){
+        DWORD mhz = 0, valueSize = sizeof(mhz);
+        if(RegGetValueW(HKEY_LOCAL_MACHINE, L"HARDWARE\\DESCRIPTION\\System\\CentralProcessor\\0", L"~MHz",
+                        RRF_RT_REG_DWORD, nullptr, &mhz, &valueSize) != ERROR_SUCCESS)
+            return DWORD(0);
+        return mhz;
+    }();
+
+    if(processorMhz == 0)
+        return 0;
+
+    //cycles / (MHz * 10^6) seconds, in 100ns units
+    return cycleCount * 10 / processorMhz;
 }
 
 void WINAPI CTMProcessScreenEventTracing::EventCallback(PEVENT_RECORD eventRecord)
@@ -284,29 +821,103 @@ void WINAPI CTMProcessScreenEventTracing::EventCallback(PEVENT_RECORD eventRecor
             //TCPIPDatasent
             case 10: // IPv4
             case 26: // IPv6
+                WritePropInfoToMap(eventRecord, HandlePropertyForEventType::KernelNetworkTcpUdp, CTMUsageCounter::TcpSent);
+                break;
             //TCPIPDatareceived
             case 11: // IPv4
             case 27: // IPv6
+                WritePropInfoToMap(eventRecord, HandlePropertyForEventType::KernelNetworkTcpUdp, CTMUsageCounter::TcpReceived);
+                break;
             //UDPIPDatasentoverUDPprotocol
             case 42: // IPv4
             case 58: // IPv6
+                WritePropInfoToMap(eventRecord, HandlePropertyForEventType::KernelNetworkTcpUdp, CTMUsageCounter::UdpSent);
+                break;
             //UDPIPDatareceivedoverUDPprotocol
             case 43: // IPv4
             case 59: // IPv6
-                WritePropInfoToMap(eventRecord, HandlePropertyForEventType::KernelNetworkTcpUdp);
+                WritePropInfoToMap(eventRecord, HandlePropertyForEventType::KernelNetworkTcpUdp, CTMUsageCounter::UdpReceived);
+                break;
+        }
+    }
+    //The session telling us it dropped events or whole buffers, we only count these
+    else if(InlineIsEqualGUID(eventGuid, rtLostEventGuid))
+        lostEventNotifications.fetch_add(1, std::memory_order_relaxed);
+    //Classic kernel events (system logger session), their id is always 0 and the opcode says what they are
+    else if(InlineIsEqualGUID(eventGuid, krnlThreadGuid))
+    {
+        switch(eventRecord->EventHeader.EventDescriptor.Opcode)
+        {
+            case contextSwitchOpcode:
+                WriteContextSwitch(eventRecord);
+                break;
+
+            case readyThreadOpcode:
+                WriteReadyThread(eventRecord);
+                break;
+
+            case threadStartOpcode:
+            case threadRundownOpcode:
+                WriteThreadStart(eventRecord);
+                break;
+        }
+    }
+    //Classic PerfInfo events, same deal. Threaded and timer DPCs are DPCs as far as anyone waiting on them is concerned
+    else if(InlineIsEqualGUID(eventGuid, krnlPerfInfoGuid))
+    {
+        switch(eventRecord->EventHeader.EventDescriptor.Opcode)
+        {
+            case dpcOpcode:
+            case threadedDpcOpcode:
+            case timerDpcOpcode:
+                WriteDpcOrIsr(eventRecord, CTMDpcKind::Dpc);
+                break;
+
+            case isrOpcode:
+            case msiIsrOpcode:
+                WriteDpcOrIsr(eventRecord, CTMDpcKind::Isr);
                 break;
         }
     }
-    //The provider is Kernel File
-    else
+    //Process start and stop, used to catch processes which live shorter than our update interval
+    else if(InlineIsEqualGUID(eventGuid, krnlProcessGuid))
     {
         switch(eventId)
         {
+            //ProcessStart
+            case 1:
+                WriteProcessLifecycleInfo(eventRecord, HandlePropertyForEventType::KernelProcessStart);
+                break;
+            //ProcessStop
+            case 2:
+                WriteProcessLifecycleInfo(eventRecord, HandlePropertyForEventType::KernelProcessStop);
+                break;
+        }
+    }
+    //The provider is Kernel File. A system logger session also gets the kernel's own header events, those land nowhere
+    else if(InlineIsEqualGUID(eventGuid, krnlFileGuid))
+    {
+        switch(eventId)
+        {
+            //NameCreate
+            case 10:
+                WriteFileNameInfo(eventRecord, HandlePropertyForEventType::KernelFileNameCreate);
+                break;
+            //NameDelete
+            case 11:
+                WriteFileNameInfo(eventRecord, HandlePropertyForEventType::KernelFileNameDelete);
+                break;
             //Read
             case 15:
+                WritePropInfoToMap(eventRecord, HandlePropertyForEventType::KernelFileRW, CTMUsageCounter::FileRead);
+                break;
             //Write
             case 16:
-                WritePropInfoToMap(eventRecord, HandlePropertyForEventType::KernelFileRW);
+                WritePropInfoToMap(eventRecord, HandlePropertyForEventType::KernelFileRW, CTMUsageCounter::FileWrite);
+                break;
+            //OperationEnd
+            case 24:
+                WriteFileOperationEnd(eventRecord);
                 break;
         }
     }
@@ -5,45 +5,80 @@
 #include <windows.h>
 #include <evntrace.h>
 #include <tdh.h>
+#include <tlhelp32.h>
+#include <Psapi.h>
 //Stdlib stuff
 #include <unordered_map>
+#include <vector>
+#include <string>
 #include <memory>
 #include <mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
 //My stuff
 #include "../CTMPureHeaderFiles/ctm_constants.h"
 #include "../CTMPureHeaderFiles/ctm_logger.h"
+#include "ctm_event_schema_cache.h"
+#include "ctm_event_source.h"
+
+//Final numbers of a process which exited, straight from the Kernel-Process provider (ProcessStop event)
+struct CTMExitedProcessInfo
+{
+    //Perfect 8 byte alignment
+    std::string imageName;
+    ULONGLONG   createTime      = 0; //FILETIME, 100ns units
+    ULONGLONG   exitTime        = 0; //FILETIME, 100ns units
+    ULONGLONG   cpuTime         = 0; //Kernel + user, 100ns units
+    ULONGLONG   readBytes       = 0;
+    ULONGLONG   writeBytes      = 0;
+    ULONGLONG   commitPeak      = 0;
+    DWORD       processId       = 0;
+    DWORD       parentProcessId = 0; //0 if the process started before the session did
+    DWORD       exitCode        = 0;
+    bool        isCpuTimeExact  = false; //False -> estimated from the CPU cycle count (we couldn't open the process in time)
+};
+
+//What we remember about a process between its start and stop events, only touched by the event tracing thread
+struct CTMStartedProcessInfo
+{
+    std::string imageName;
+    HANDLE      hProcess        = nullptr; //Keeps the process object alive so we can read its final times at stop
+    DWORD       parentProcessId = 0;
+};
 
 //Just for better understanding, also we want total network usage across TCP and UDP (Both IPv4 and IPv6)
 using ProcessUsageType        = ULONGLONG;
 using UniquePtrToByteArray    = std::unique_ptr<BYTE[]>;
-using ProcessResourceUsageMap = std::unordered_map<DWORD, ProcessUsageType>;
+using ExitedProcessVector     = std::vector<CTMExitedProcessInfo>;
+using StartedProcessMap       = std::unordered_map<DWORD, CTMStartedProcessInfo>;
 
-//Mutex to ensure thread safety
+//Mutex to ensure thread safety (only for the exited process vector, usage counters don't need it)
 extern std::mutex globalPsEtwMutex; //It stands for Global Process Screen Event Tracing Mutex
 
 //Used by pretty much everything but bound to the scope of 'CTMProcessScreenEventTracing' class
-extern ProcessResourceUsageMap globalProcessNetworkUsageMap;
-extern ProcessResourceUsageMap globalProcessFileUsageMap;
+//Processes which exited since the process screen last drained it (it drains it every update)
+extern ExitedProcessVector globalExitedProcessVector;
 
 //To differentiate between different GUID's properties, like Kernel Network has different properties (TCP and UDP), etc.
 enum class HandlePropertyForEventType : std::uint8_t
 {
     KernelNetworkTcpUdp,
-    KernelFileRW
+    KernelFileRW,
+    KernelFileNameCreate,
+    KernelFileNameDelete,
+    KernelProcessStart,
+    KernelProcessStop
 };
 
-class CTMProcessScreenEventTracing
+//Real time kernel session, the event source the app uses unless told otherwise (check ctm_event_source.h).
+//Owned by 'CTMEventSessionManager', providers are only enabled when a screen asks for them
+class CTMProcessScreenEventTracing : public CTMEventSource
 {
 public:
-    CTMProcessScreenEventTracing() = default;
-    
-    //No need for copy or move operations
-    CTMProcessScreenEventTracing(const CTMProcessScreenEventTracing&)            = delete;
-    CTMProcessScreenEventTracing& operator=(const CTMProcessScreenEventTracing&) = delete;
-    CTMProcessScreenEventTracing(CTMProcessScreenEventTracing&&)                 = delete;
-    CTMProcessScreenEventTracing& operator=(CTMProcessScreenEventTracing&&)      = delete;
-
-    ~CTMProcessScreenEventTracing()
+    explicit CTMProcessScreenEventTracing(const CTMEtwBufferSettings& bufferSettings) : bufferSettings(bufferSettings) {}
+
+    ~CTMProcessScreenEventTracing() override
     {
         // //Stop tracing events
         // Stop();
@@ -51,43 +86,117 @@ public:
         eventInfoBuffer.reset();
         eventInfoBufferSize = 0;
 
-        //Also its better to clear up the global maps as they won't do it themselves (while they don't add as much memory but still)
-        globalProcessFileUsageMap.clear();
-        globalProcessNetworkUsageMap.clear();
+        //Also its better to clear up the globals as they won't do it themselves (while they don't add as much memory but still)
+        globalExitedProcessVector.clear();
+
+        //Process handles we kept for final times, the tracing thread is done with them by now
+        for(auto&& [_, startedProcess] : startedProcessMap)
+            if(startedProcess.hProcess)
+                CloseHandle(startedProcess.hProcess);
+        startedProcessMap.clear();
     }
 
 public: //Main functions
-    bool Start();
-    bool ProcessEvents();
-    void Stop();
+    bool        Start()         override;
+    bool        ProcessEvents() override;
+    void        Stop()          override;
+    const char* GetName() const override { return "ETW"; }
+    bool        SetProviderEnabled(CTMEventProvider, bool) override;
+    //Grows the session's maximum buffers with the rate, unless the settings pinned it
+    void        AdjustToEventRate(double, bool) override;
+    //Called from the UI thread, asks the session how many events it lost too
+    CTMEventTracingDiagnostics GetDiagnostics() override;
 
 private: //Helper functions
-    void Cleanup();
-    bool StartTraceSession();
-    bool ConfigureProvider(const GUID&, ULONG);
-    bool EnableProvider(bool);
-    bool OpenTraceSession();
+    void                    Cleanup();
+    bool                    StartTraceSession();
+    bool                    StopOrphanedSession();
+    bool                    AttachToRunningSession();
+    bool                    ConfigureProvider(const GUID&, ULONG, ULONGLONG = 0);
+    bool                    ConfigureKernelFlagEvents(CTMEventProvider, bool);
+    bool                    OpenTraceSession();
+    EVENT_TRACE_PROPERTIES* ResetTraceProperties(BYTE*);
 
 private: //Static functions
-    static void        WritePropInfoToMap(PEVENT_RECORD, HandlePropertyForEventType);
+    static void        WritePropInfoToMap(PEVENT_RECORD, HandlePropertyForEventType, CTMUsageCounter);
+    static void        WriteNetworkFlowRecord(PEVENT_RECORD, const ULONGLONG*, CTMUsageCounter);
+    static void        WriteProcessLifecycleInfo(PEVENT_RECORD, HandlePropertyForEventType);
+    static void        WriteFileNameInfo(PEVENT_RECORD, HandlePropertyForEventType);
+    static void        WriteFileOperationEnd(PEVENT_RECORD);
+    static void        WriteContextSwitch(PEVENT_RECORD);
+    static void        WriteReadyThread(PEVENT_RECORD);
+    static void        WriteThreadStart(PEVENT_RECORD);
+    static void        WriteDpcOrIsr(PEVENT_RECORD, CTMDpcKind);
+    static void        SeedThreadProcesses();
+    static std::vector<CTMDriverModule> EnumerateDriverModules();
+    static ULONGLONG   EstimateCpuTimeFromCycles(ULONGLONG);
     static void WINAPI EventCallback(PEVENT_RECORD);
 
 private: //ETW stuff
     //Custom session name as we use specific providers for our work
     LPCWSTR               sessionName              = L"CTM_ProcessScreen_ETWSession";
-    TRACEHANDLE           sessionHandle;
-    TRACEHANDLE           traceHandle;
+    //Held by every running instance using the session, a session nobody holds this for was left behind by a crashed one
+    LPCWSTR               sessionMutexName         = L"Global\\CTM_ProcessScreen_ETWSession_Mutex";
+    HANDLE                hSessionMutex            = nullptr;
+    TRACEHANDLE           sessionHandle            = 0;
+    TRACEHANDLE           traceHandle              = 0;
     UniquePtrToByteArray  tracePropsBuffer;
-    bool                  isKrnlNetworkInitialized = false,
-                          isKrnlFileInitialized    = false;
+    UniquePtrToByteArray  queryPropsBuffer; //Seperate from 'tracePropsBuffer', ControlTrace writes into it
+    ULONG                 tracePropsBufferSize     = 0;
+    bool                  isProviderEnabled[static_cast<std::size_t>(CTMEventProvider::Count)] = {};
+    bool                  isSessionOwner           = false; //False -> attached to the session of another running instance, it stops it
+    bool                  isSystemLogger           = false; //Can take the kernel's classic events (context switches), Windows 8 and newer
+    //Buffers of the session (check ctm_etw_buffer_policy.h), sized when it starts
+    CTMEtwBufferSettings  bufferSettings;
+    CTMEtwBufferSizing    bufferSizing;
 
 private: //ETW Stuff but static (as these are used in static functions).
-    //Used in WritePropsToMap
+    static std::atomic<std::uint64_t> lostEventNotifications;
+    //Used in WritePropsToMap, hot path (every network and file event)
+    static CTMEventSchemaCache  networkSchemaCache;
+    static CTMEventSchemaCache  fileSchemaCache;
+    //Used in WriteFileNameInfo, the name is a string so that one always goes through TDH (names are rare next to reads and writes)
+    static CTMEventSchemaCache  fileNameSchemaCache;
+    //Used in WriteFileOperationEnd, as hot as the reads and writes (every file operation ends with one)
+    static CTMEventSchemaCache  fileOperationEndSchemaCache;
+    //Used in WriteContextSwitch, WriteReadyThread and WriteThreadStart. Classic kernel events all have id 0 (the opcode tells them apart), so each kind gets its own cache
+    static CTMEventSchemaCache  contextSwitchSchemaCache;
+    static CTMEventSchemaCache  readyThreadSchemaCache;
+    static CTMEventSchemaCache  threadSchemaCache;
+    //Used in WriteDpcOrIsr, every DPC and ISR of the machine (can be way more than the switches). The kinds of each one agree on where the two fields are
+    static CTMEventSchemaCache  dpcSchemaCache;
+    static CTMEventSchemaCache  isrSchemaCache;
+    //Used in WriteProcessLifecycleInfo (rare enough to go through TDH every time)
     static UniquePtrToByteArray eventInfoBuffer; //Containing trace event information
     static ULONG                eventInfoBufferSize;
+    //Used in WriteProcessLifecycleInfo
+    static StartedProcessMap    startedProcessMap;
     //Used in EventCallback
-    constexpr static GUID krnlNetworkGuid = MICROSOFT_WINDOWS_KERNEL_NETWORK_GUID,
-                          krnlFileGuid    = MICROSOFT_WINDOWS_KERNEL_FILE_GUID;
+    constexpr static GUID krnlNetworkGuid  = MICROSOFT_WINDOWS_KERNEL_NETWORK_GUID,
+                          krnlFileGuid     = MICROSOFT_WINDOWS_KERNEL_FILE_GUID,
+                          krnlProcessGuid  = MICROSOFT_WINDOWS_KERNEL_PROCESS_GUID,
+                          rtLostEventGuid  = ETW_RT_LOST_EVENT_GUID,
+                          krnlThreadGuid   = KERNEL_THREAD_EVENT_GUID,
+                          krnlPerfInfoGuid = KERNEL_PERFINFO_EVENT_GUID;
+    //WINEVENT_KEYWORD_PROCESS, only process start/stop (no threads, images, etc)
+    constexpr static ULONGLONG krnlProcessKeyword      = 0x10;
+    //Opcodes of the classic Thread events we use, the rest (thread end, set priority, ...) are left alone
+    constexpr static UCHAR     threadStartOpcode       = 1;
+    constexpr static UCHAR     threadRundownOpcode     = 3;  //DCStart, threads which were running when the flags got enabled
+    constexpr static UCHAR     contextSwitchOpcode     = 36;
+    constexpr static UCHAR     readyThreadOpcode       = 50; //Needs the dispatcher flag on top of the context switch one
+    //Opcodes of the classic PerfInfo events we use (they overlap with the Thread ones, the GUID tells them apart)
+    constexpr static UCHAR     msiIsrOpcode            = 50;
+    constexpr static UCHAR     threadedDpcOpcode       = 66;
+    constexpr static UCHAR     isrOpcode               = 67;
+    constexpr static UCHAR     dpcOpcode               = 68;
+    constexpr static UCHAR     timerDpcOpcode          = 69;
+    //KTHREAD_STATE of the thread switched out, 'Ready' -> it got preempted and waits for a core again
+    constexpr static ULONGLONG threadStateReady        = 1;
+    //Exited processes pile up here if nobody drains them (process screen not updating), don't let it grow forever
+    constexpr static size_t    maxPendingExitedProcesses = 4096;
+    //NT paths can go way past MAX_PATH, longer ones than this are just left unnamed
+    constexpr static USHORT    maxFileNameBytes = 2048 * sizeof(WCHAR);
 };
 
 #endif
\ No newline at end of file
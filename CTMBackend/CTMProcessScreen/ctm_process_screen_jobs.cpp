@@ -0,0 +1,353 @@
+#include "ctm_process_screen_jobs.h"
+
+CTMProcessJobTracker::CTMProcessJobTracker()
+    : jobQueryBuffer(sizeof(JOBOBJECT_BASIC_PROCESS_ID_LIST) + 64 * sizeof(ULONG_PTR)),
+      updatesSinceRescan(rescanInterval), prevUpdateTime(std::chrono::steady_clock::now())
+{
+    numberOfCpus = GetActiveProcessorCount(ALL_PROCESSOR_GROUPS);
+    if(numberOfCpus == 0)
+        numberOfCpus = 1;
+
+    if(!CTMConstructorInitNTDLL() || !handleTable.IsAvailable())
+        return;
+
+    //Type indices change between windows builds, look it up by name. Without it we can't tell job handles apart from the rest
+    jobObjectTypeIndex = handleTable.FindTypeIndex("Job");
+    if(jobObjectTypeIndex < 0)
+        CTM_LOG_ERROR("Failed to find job object type index, job grouping will be disabled.");
+}
+
+CTMProcessJobTracker::~CTMProcessJobTracker()
+{
+    //Worker might still be holding on to the known job handles, wait for it before closing them
+    JoinRescanThread();
+    CollectRescannedJobs();
+    CloseJobHandles();
+}
+
+//--------------------CONSTRUCTOR INIT FUNCTIONS--------------------
+bool CTMProcessJobTracker::CTMConstructorInitNTDLL()
+{
+    HMODULE hNtdll = GetModuleHandleW(L"ntdll.dll");
+    if(!hNtdll)
+    {
+        CTM_LOG_ERROR("Failed to get module handle for ntdll.dll");
+        return false;
+    }
+
+    NtQueryObject = reinterpret_cast<NtQueryObject_t>(
+        GetProcAddress(hNtdll, "NtQueryObject")
+    );
+
+    //Not a big deal if its missing, we just won't be able to dedupe jobs when kernel addresses are hidden
+    HMODULE hKernelBase = GetModuleHandleW(L"kernelbase.dll");
+    if(hKernelBase)
+        CompareObjectHandles = reinterpret_cast<CompareObjectHandles_t>(
+            GetProcAddress(hKernelBase, "CompareObjectHandles")
+        );
+
+    if(!NtQueryObject)
+    {
+        CTM_LOG_ERROR("Failed to get proc addresses for ntdll.dll functions");
+        return false;
+    }
+
+    return true;
+}
+
+//--------------------MAIN FUNCTIONS--------------------
+void CTMProcessJobTracker::Update()
+{
+    if(!IsAvailable())
+        return;
+
+    //Jobs found by a rescan which finished since the last update
+    CollectRescannedJobs();
+
+    //A rescan which takes longer than the interval just delays the next one
+    if(++updatesSinceRescan >= rescanInterval && !isRescanning.load())
+    {
+        StartRescan();
+        updatesSinceRescan = 0;
+    }
+
+    auto   now            = std::chrono::steady_clock::now();
+    double elapsedSeconds = std::chrono::duration<double>(now - prevUpdateTime).count();
+    prevUpdateTime        = now;
+
+    for(auto&& job : jobs)
+    {
+        UpdateJobProcessList(job);
+        UpdateJobAccounting(job, elapsedSeconds);
+    }
+
+    RebuildProcessToJobIndex();
+}
+
+//--------------------GETTERS--------------------
+const CTMJobInfo* CTMProcessJobTracker::GetJobOfProcess(DWORD processId) const
+{
+    auto it = processToJobIndex.find(processId);
+    return it != processToJobIndex.end() ? &jobs[it->second] : nullptr;
+}
+
+//--------------------RESCAN FUNCTIONS--------------------
+void CTMProcessJobTracker::StartRescan()
+{
+    //Previous worker is done ('isRescanning' is false), it only needs joining
+    JoinRescanThread();
+
+    //Jobs without any process left are not interesting anymore, drop them (we keep them alive by holding the handle)
+    //Only done here, so the handles the worker gets stay open until it is done
+    for(auto it = jobs.begin(); it != jobs.end(); )
+    {
+        if(it->hasPrevSample && it->activeProcesses == 0)
+        {
+            CloseHandle(it->hJob);
+            it = jobs.erase(it);
+        }
+        else
+            ++it;
+    }
+
+    std::vector<CTMKnownJob> knownJobs;
+    knownJobs.reserve(jobs.size());
+    for(auto&& job : jobs)
+        knownJobs.push_back({job.hJob, job.kernelObject});
+
+    isRescanning.store(true);
+    rescanThread = std::thread([this, knownJobs = std::move(knownJobs)](){
+        JobInfoVector newJobs;
+        RescanJobHandles(knownJobs, newJobs);
+
+        {
+            std::lock_guard<std::mutex> lock(rescannedJobsMutex);
+            rescannedJobs = std::move(newJobs);
+        }
+        isRescanning.store(false);
+    });
+}
+
+void CTMProcessJobTracker::CollectRescannedJobs()
+{
+    JobInfoVector newJobs;
+    {
+        std::lock_guard<std::mutex> lock(rescannedJobsMutex);
+        newJobs.swap(rescannedJobs);
+    }
+
+    for(auto&& job : newJobs)
+        jobs.push_back(std::move(job));
+}
+
+void CTMProcessJobTracker::JoinRescanThread()
+{
+    if(rescanThread.joinable())
+        rescanThread.join();
+}
+
+void CTMProcessJobTracker::RescanJobHandles(const std::vector<CTMKnownJob>& knownJobs, JobInfoVector& newJobs)
+{
+    if(!handleTable.Query())
+        return;
+
+    DWORD currentProcessId = GetCurrentProcessId();
+
+    //Open every owner process once, nullptr if we failed to open it
+    std::unordered_map<DWORD, HANDLE> ownerProcessHandles;
+
+    handleTable.ForEachHandle([&](const CTM_SYSTEM_HANDLE_TABLE_ENTRY_INFO_EX& entry){
+        if(entry.ObjectTypeIndex != jobObjectTypeIndex)
+            return;
+
+        DWORD ownerProcessId = static_cast<DWORD>(entry.UniqueProcessId);
+        if(ownerProcessId == currentProcessId)
+            return;
+
+        //Cheap dedupe first, if we can see kernel addresses there is no need to duplicate anything
+        if(entry.Object && IsKnownJob(knownJobs, newJobs, nullptr, entry.Object))
+            return;
+
+        auto ownerIt = ownerProcessHandles.find(ownerProcessId);
+        if(ownerIt == ownerProcessHandles.end())
+            ownerIt = ownerProcessHandles.emplace(ownerProcessId, OpenProcess(PROCESS_DUP_HANDLE, FALSE, ownerProcessId)).first;
+        if(!ownerIt->second)
+            return;
+
+        HANDLE hJob = nullptr;
+        if(!DuplicateHandle(ownerIt->second, reinterpret_cast<HANDLE>(entry.HandleValue), GetCurrentProcess(), &hJob,
+                            JOB_OBJECT_QUERY, FALSE, 0))
+            return;
+
+        if(!entry.Object && IsKnownJob(knownJobs, newJobs, hJob, nullptr))
+        {
+            CloseHandle(hJob);
+            return;
+        }
+
+        CTMJobInfo& job  = newJobs.emplace_back();
+        job.hJob         = hJob;
+        job.kernelObject = entry.Object;
+        QueryJobName(job, ownerProcessId);
+    });
+
+    for(auto&& [_, hOwnerProcess] : ownerProcessHandles)
+        if(hOwnerProcess)
+            CloseHandle(hOwnerProcess);
+}
+
+bool CTMProcessJobTracker::IsKnownJob(const std::vector<CTMKnownJob>& knownJobs, const JobInfoVector& newJobs, HANDLE hJob, PVOID kernelObject)
+{
+    auto isSameJob = [&](HANDLE hOtherJob, PVOID otherKernelObject){
+        return (kernelObject && otherKernelObject == kernelObject) ||
+               (hJob && CompareObjectHandles && CompareObjectHandles(hOtherJob, hJob));
+    };
+
+    //Jobs we had before this rescan, then the ones this rescan already found
+    for(auto&& job : knownJobs)
+        if(isSameJob(job.hJob, job.kernelObject))
+            return true;
+    for(auto&& job : newJobs)
+        if(isSameJob(job.hJob, job.kernelObject))
+            return true;
+
+    return false;
+}
+
+//--------------------HELPER FUNCTIONS--------------------
+void CTMProcessJobTracker::QueryJobName(CTMJobInfo& job, DWORD ownerProcessId)
+{
+    //Name comes back as an UNICODE_STRING right at the start of the buffer, pointing into the buffer itself
+    BYTE  nameBuffer[1024];
+    ULONG returnLength = 0;
+    if(NtQueryObject(job.hJob, objectNameInformation, nameBuffer, sizeof(nameBuffer), &returnLength) == STATUS_SUCCESS)
+    {
+        auto jobName = reinterpret_cast<PUNICODE_STRING>(nameBuffer);
+        if(jobName->Length > 0 && jobName->Buffer)
+        {
+            CHAR jobNameUtf8[512];
+            int  bytesWritten = WideCharToMultiByte(CP_UTF8, 0, jobName->Buffer, jobName->Length / sizeof(WCHAR),
+                                                    jobNameUtf8, sizeof(jobNameUtf8) - 1, NULL, NULL);
+            if(bytesWritten > 0)
+            {
+                job.jobName.assign(jobNameUtf8, bytesWritten);
+                return;
+            }
+        }
+    }
+
+    //Most jobs are unnamed, the owner pid is the best we can do
+    job.jobName = "Unnamed Job (Owner PID " + std::to_string(ownerProcessId) + ")";
+}
+
+void CTMProcessJobTracker::UpdateJobProcessList(CTMJobInfo& job)
+{
+    job.processIds.clear();
+
+    auto processIdList = reinterpret_cast<PJOBOBJECT_BASIC_PROCESS_ID_LIST>(jobQueryBuffer.data());
+    while(!QueryInformationJobObject(job.hJob, JobObjectBasicProcessIdList, processIdList,
+                                     static_cast<DWORD>(jobQueryBuffer.size()), nullptr))
+    {
+        //Buffer is too small, the header still tells us how many processes there are
+        if(GetLastError() != ERROR_MORE_DATA)
+            return;
+
+        jobQueryBuffer.resize(sizeof(JOBOBJECT_BASIC_PROCESS_ID_LIST) + (processIdList->NumberOfAssignedProcesses + 16) * sizeof(ULONG_PTR));
+        processIdList = reinterpret_cast<PJOBOBJECT_BASIC_PROCESS_ID_LIST>(jobQueryBuffer.data());
+    }
+
+    job.processIds.reserve(processIdList->NumberOfProcessIdsInList);
+    for(DWORD i = 0; i < processIdList->NumberOfProcessIdsInList; i++)
+        job.processIds.push_back(static_cast<DWORD>(processIdList->ProcessIdList[i]));
+}
+
+void CTMProcessJobTracker::UpdateJobAccounting(CTMJobInfo& job, double elapsedSeconds)
+{
+    //CPU and IO, accounted by the job itself (includes processes which already exited, fine for deltas)
+    JOBOBJECT_BASIC_AND_IO_ACCOUNTING_INFORMATION accountingInfo = {};
+    if(QueryInformationJobObject(job.hJob, JobObjectBasicAndIoAccountingInformation, &accountingInfo, sizeof(accountingInfo), nullptr))
+    {
+        ULONGLONG totalCpuTime  = accountingInfo.BasicInfo.TotalUserTime.QuadPart + accountingInfo.BasicInfo.TotalKernelTime.QuadPart;
+        ULONGLONG readTransfer  = accountingInfo.IoInfo.ReadTransferCount;
+        ULONGLONG writeTransfer = accountingInfo.IoInfo.WriteTransferCount;
+
+        if(job.hasPrevSample && elapsedSeconds > 0.0)
+        {
+            //Times are in 100ns units, so 1 second of one cpu is 10^7
+            job.cpuUsage     = (totalCpuTime - job.prevTotalCpuTime) / (elapsedSeconds * 1e7 * numberOfCpus) * 100.0;
+            job.ioReadUsage  = (readTransfer - job.prevReadTransfer) / (elapsedSeconds * 1024.0 * 1024.0);
+            job.ioWriteUsage = (writeTransfer - job.prevWriteTransfer) / (elapsedSeconds * 1024.0 * 1024.0);
+        }
+
+        job.prevTotalCpuTime  = totalCpuTime;
+        job.prevReadTransfer  = readTransfer;
+        job.prevWriteTransfer = writeTransfer;
+        job.activeProcesses   = accountingInfo.BasicInfo.ActiveProcesses;
+        job.totalTerminated   = accountingInfo.BasicInfo.TotalTerminatedProcesses;
+        job.hasPrevSample     = true;
+    }
+
+    //Committed memory of the job as a whole
+    CTM_JOBOBJECT_MEMORY_USAGE_INFORMATION memoryInfo = {};
+    if(QueryInformationJobObject(job.hJob, jobObjectMemoryUsageInformation, &memoryInfo, sizeof(memoryInfo), nullptr))
+        job.memoryUsage = memoryInfo.JobMemory / (1024.0 * 1024.0);
+    else
+        job.memoryUsage = -1.0;
+
+    //Limits, so we can tell if the job is being throttled
+    JOBOBJECT_EXTENDED_LIMIT_INFORMATION limitInfo = {};
+    job.memoryLimit = 0.0;
+    if(QueryInformationJobObject(job.hJob, JobObjectExtendedLimitInformation, &limitInfo, sizeof(limitInfo), nullptr) &&
+       (limitInfo.BasicLimitInformation.LimitFlags & JOB_OBJECT_LIMIT_JOB_MEMORY))
+        job.memoryLimit = limitInfo.JobMemoryLimit / (1024.0 * 1024.0);
+
+    JOBOBJECT_CPU_RATE_CONTROL_INFORMATION cpuRateInfo = {};
+    job.cpuRateCap = 0.0;
+    if(QueryInformationJobObject(job.hJob, JobObjectCpuRateControlInformation, &cpuRateInfo, sizeof(cpuRateInfo), nullptr) &&
+       (cpuRateInfo.ControlFlags & JOB_OBJECT_CPU_RATE_CONTROL_ENABLE))
+    {
+        //Rates are in 1/100 of a percent. Weight based control has no cap, so nothing to show there
+        if(cpuRateInfo.ControlFlags & JOB_OBJECT_CPU_RATE_CONTROL_HARD_CAP)
+            job.cpuRateCap = cpuRateInfo.CpuRate / 100.0;
+        else if(cpuRateInfo.ControlFlags & JOB_OBJECT_CPU_RATE_CONTROL_MIN_MAX_RATE)
+            job.cpuRateCap = cpuRateInfo.MaxRate / 100.0;
+    }
+
+    //Windows doesn't give us throttled time like cgroups do, sitting right at the cap is the next best thing
+    job.isThrottled = (job.cpuRateCap > 0.0 && job.cpuUsage >= job.cpuRateCap * 0.95) ||
+                      (job.memoryLimit > 0.0 && job.memoryUsage >= job.memoryLimit * 0.95);
+}
+
+void CTMProcessJobTracker::RebuildProcessToJobIndex()
+{
+    processToJobIndex.clear();
+    for(std::size_t i = 0; i < jobs.size(); i++)
+    {
+        for(auto&& processId : jobs[i].processIds)
+        {
+            //Nested jobs, keep the innermost one (the one with the least processes)
+            auto [it, isInserted] = processToJobIndex.try_emplace(processId, i);
+            if(!isInserted && jobs[i].processIds.size() < jobs[it->second].processIds.size())
+                it->second = i;
+        }
+    }
+
+    //Every process is listed under its innermost job only, otherwise a nested one shows up under every job around it
+    for(auto&& job : jobs)
+        job.ownProcessIds.clear();
+    for(auto&& [processId, jobIndex] : processToJobIndex)
+        jobs[jobIndex].ownProcessIds.push_back(processId);
+    //Hash map order changes between updates, rows shouldn't jump around
+    for(auto&& job : jobs)
+        std::sort(job.ownProcessIds.begin(), job.ownProcessIds.end());
+}
+
+void CTMProcessJobTracker::CloseJobHandles()
+{
+    for(auto&& job : jobs)
+        if(job.hJob)
+            CloseHandle(job.hJob);
+
+    jobs.clear();
+    processToJobIndex.clear();
+}
\ No newline at end of file
@@ -0,0 +1,145 @@
+#ifndef CTM_PROCESS_MENU_JOBS_HPP
+#define CTM_PROCESS_MENU_JOBS_HPP
+
+//Windows stuff
+#include <windows.h>
+#include <winternl.h>
+#include <ntstatus.h>
+//My stuff
+#include "../CTMPureHeaderFiles/ctm_logger.h"
+#include "../CTMHandlesScreen/ctm_handle_table.h"
+//Stdlib stuff
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <atomic>
+
+//Windows 10+, used to dedupe job handles when kernel object addresses are hidden from us
+typedef BOOL(WINAPI* CompareObjectHandles_t)
+            (HANDLE, HANDLE);
+
+//--------------------Some useful structs--------------------
+//JobObjectMemoryUsageInformation (28) output, not in the SDK headers either
+typedef struct _CTM_JOBOBJECT_MEMORY_USAGE_INFORMATION
+{
+    ULONG64 JobMemory;
+    ULONG64 PeakJobMemoryUsed;
+} CTM_JOBOBJECT_MEMORY_USAGE_INFORMATION;
+
+//A single job object (or server silo, which is a job object as well) and its accounting
+struct CTMJobInfo
+{
+    //Perfect 8 byte alignment
+    double             cpuUsage          = 0.0;  //% of the whole machine
+    double             memoryUsage       = -1.0; //MB, -1 if the job doesn't give it to us
+    double             ioReadUsage       = 0.0;  //MB/s
+    double             ioWriteUsage      = 0.0;  //MB/s
+    double             cpuRateCap        = 0.0;  //% of the whole machine, 0 if not capped
+    double             memoryLimit       = 0.0;  //MB, 0 if not limited
+    ULONGLONG          prevTotalCpuTime  = 0;    //100ns units
+    ULONGLONG          prevReadTransfer  = 0;
+    ULONGLONG          prevWriteTransfer = 0;
+    HANDLE             hJob              = nullptr;
+    PVOID              kernelObject      = nullptr; //Null when we don't have the privilege to see kernel addresses
+    std::vector<DWORD> processIds;
+    std::vector<DWORD> ownProcessIds; //Processes whose innermost job is this one, the rest belong to jobs nested in it
+    std::string        jobName;
+    DWORD              activeProcesses   = 0;
+    DWORD              totalTerminated   = 0;
+    bool               isThrottled       = false;
+    bool               hasPrevSample     = false;
+};
+
+using JobInfoVector        = std::vector<CTMJobInfo>;
+using ProcessToJobIndexMap = std::unordered_map<DWORD, std::size_t>;
+
+//What the rescan worker needs to know about a job we already have, so it doesn't add it twice
+//The handle stays open while the worker runs, jobs are only dropped before a rescan starts
+struct CTMKnownJob
+{
+    HANDLE hJob         = nullptr;
+    PVOID  kernelObject = nullptr;
+};
+
+/*
+ * Finds every job object in the system (through the system handle table) and reads accounting for the job as a whole.
+ * Job handles are duplicated into our process once and kept, so the per update cost is a few QueryInformationJobObject calls per job-
+ * -instead of summing thousands of per process values. The handle table is only rescanned every 'rescanInterval' updates.
+ * The rescan runs on a worker thread (the table is tens of MB on a busy machine), the jobs it finds are handed over under a mutex-
+ * -and picked up by the next 'Update'. Everything else is UI thread only.
+ */
+class CTMProcessJobTracker
+{
+public:
+    CTMProcessJobTracker();
+    ~CTMProcessJobTracker();
+
+    //No need for copy or move operations
+    CTMProcessJobTracker(const CTMProcessJobTracker&)            = delete;
+    CTMProcessJobTracker& operator=(const CTMProcessJobTracker&) = delete;
+    CTMProcessJobTracker(CTMProcessJobTracker&&)                 = delete;
+    CTMProcessJobTracker& operator=(CTMProcessJobTracker&&)      = delete;
+
+public: //Main functions
+    void Update();
+    void RequestRescan() { updatesSinceRescan = rescanInterval; }
+
+public: //Getters
+    const JobInfoVector& GetJobs() const { return jobs; }
+    //Innermost job of the process (smallest process list wins for nested jobs), nullptr if the process is not in any job we know
+    const CTMJobInfo*    GetJobOfProcess(DWORD) const;
+    bool                 IsAvailable()    const { return jobObjectTypeIndex >= 0; }
+
+private: //Constructor init functions
+    bool CTMConstructorInitNTDLL();
+
+private: //Rescan functions
+    //UI thread: drops jobs without processes and starts the worker with what we already know
+    void StartRescan();
+    //UI thread: moves whatever the last rescan found into 'jobs'
+    void CollectRescannedJobs();
+    void JoinRescanThread();
+    //Worker thread, only touches the handle table and what it was given
+    void RescanJobHandles(const std::vector<CTMKnownJob>&, JobInfoVector&);
+    bool IsKnownJob(const std::vector<CTMKnownJob>&, const JobInfoVector&, HANDLE, PVOID);
+
+private: //Helper functions
+    void QueryJobName(CTMJobInfo&, DWORD);
+    void UpdateJobProcessList(CTMJobInfo&);
+    void UpdateJobAccounting(CTMJobInfo&, double);
+    void RebuildProcessToJobIndex();
+    void CloseJobHandles();
+
+private: //Rescan worker
+    std::thread       rescanThread;
+    std::atomic<bool> isRescanning{false};
+    std::mutex        rescannedJobsMutex;
+    JobInfoVector     rescannedJobs; //New jobs found by the last rescan, waiting for 'CollectRescannedJobs'
+
+private: //Dynamically loaded functions
+    NtQueryObject_t        NtQueryObject        = nullptr;
+    CompareObjectHandles_t CompareObjectHandles = nullptr;
+
+private: //Job stuff
+    JobInfoVector        jobs;
+    ProcessToJobIndexMap processToJobIndex;
+    CTMSystemHandleTable handleTable; //Only queried by the rescan worker after the constructor
+    std::vector<BYTE>    jobQueryBuffer;
+    int                  jobObjectTypeIndex = -1;
+    DWORD                numberOfCpus       = 1;
+    int                  updatesSinceRescan = 0;
+
+    std::chrono::steady_clock::time_point prevUpdateTime;
+
+private: //Constant stuff
+    //Rescanning the handle table is the expensive part, jobs don't come and go that often
+    constexpr static int                      rescanInterval                  = 5;
+    constexpr static OBJECT_INFORMATION_CLASS objectNameInformation           = static_cast<OBJECT_INFORMATION_CLASS>(1);
+    constexpr static JOBOBJECTINFOCLASS       jobObjectMemoryUsageInformation = static_cast<JOBOBJECTINFOCLASS>(28);
+};
+
+#endif
\ No newline at end of file
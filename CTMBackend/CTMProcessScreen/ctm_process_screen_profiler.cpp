@@ -0,0 +1,575 @@
+#include "ctm_process_screen_profiler.h"
+
+//Don't really want these macros, they are messing up the std::max and std::min functions
+#undef max
+#undef min
+
+CTMProcessProfiler::~CTMProcessProfiler()
+{
+    Stop();
+}
+
+//--------------------MAIN FUNCTIONS--------------------
+bool CTMProcessProfiler::Start(DWORD processId)
+{
+    if(GetState() == CTMProfilerState::Running)
+    {
+        CTM_LOG_WARNING("Profiler is already running, stop it before starting a new one.");
+        return false;
+    }
+
+    //Suspending our own threads (including the one doing the suspending) is a bad idea
+    if(processId == GetCurrentProcessId() || processId == 0)
+    {
+        CTM_LOG_ERROR("Can't profile process with pid: ", processId);
+        return false;
+    }
+
+    JoinWorkerThread();
+
+    result        = {};
+    errorText.clear();
+    zoomNodeIndex = 0;
+    shouldStop.store(false);
+    progress.store(0.0f);
+    state.store(CTMProfilerState::Running);
+
+    //If we go down while a target thread is suspended, that thread would stay suspended forever
+    resourceGuard.RegisterCleanupFunction(resumeCleanupFunctionName, [this](){
+        HANDLE hThread = hSuspendedThread.exchange(nullptr);
+        if(hThread)
+            ResumeThread(hThread);
+    });
+
+    workerThread = std::thread(&CTMProcessProfiler::SampleProcess, this, processId, durationSeconds, samplingRateHz);
+    return true;
+}
+
+void CTMProcessProfiler::Stop()
+{
+    shouldStop.store(true);
+    JoinWorkerThread();
+}
+
+void CTMProcessProfiler::Render(DWORD processId)
+{
+    CTMProfilerState currentState = GetState();
+    bool             isRunning    = currentState == CTMProfilerState::Running;
+
+    if(isRunning)
+        ImGui::BeginDisabled();
+    ImGui::SetNextItemWidth(200.0f);
+    ImGui::SliderInt("Duration (s)", &durationSeconds, 1, 60);
+    ImGui::SetNextItemWidth(200.0f);
+    ImGui::SliderInt("Sampling Rate (Hz)", &samplingRateHz, 100, 1000);
+    if(ImGui::Button("Start Profiling"))
+        Start(processId);
+    if(isRunning)
+        ImGui::EndDisabled();
+
+    if(isRunning)
+    {
+        ImGui::SameLine();
+        if(ImGui::Button("Stop"))
+            shouldStop.store(true);
+
+        ImGui::ProgressBar(progress.load(), {-1.0f, 0.0f});
+        return;
+    }
+
+    //Worker is done (state isn't Running) so reading its results is safe, join it so the thread doesn't hang around
+    JoinWorkerThread();
+
+    if(currentState == CTMProfilerState::Failed)
+    {
+        ImGui::TextColored({1.0f, 0.4f, 0.4f, 1.0f}, "Profiling failed: %s", errorText.c_str());
+        return;
+    }
+
+    if(currentState != CTMProfilerState::Finished || result.processId != processId)
+        return;
+
+    ImGui::Separator();
+
+    double effectiveRate   = result.elapsedSeconds > 0.0 ? result.tickCount / result.elapsedSeconds : 0.0;
+    double averageThreads  = result.tickCount > 0 ? static_cast<double>(result.stackCount) / result.tickCount : 0.0;
+    double averageSuspendUs = result.stackCount > 0 ? result.suspendedSeconds * 1e6 / result.stackCount : 0.0;
+    //How much of the time a thread of the target spent stopped by us, on average
+    double stalledPercent  = (result.elapsedSeconds > 0.0 && averageThreads > 0.0) ?
+                             result.suspendedSeconds / (result.elapsedSeconds * averageThreads) * 100.0 : 0.0;
+
+    ImGui::Text("Samples: %llu stacks in %llu ticks (%.0lf Hz effective, %.1lf threads on average)",
+                result.stackCount, result.tickCount, effectiveRate, averageThreads);
+    ImGui::Text("Overhead: %.1lf us per stack, each target thread stalled %.3lf%% of the time", averageSuspendUs, stalledPercent);
+
+    char fileName[64];
+    std::snprintf(fileName, sizeof(fileName), "CTMProfile_%lu.txt", result.processId);
+    if(ImGui::Button("Export Collapsed Stacks"))
+    {
+        if(ExportCollapsedStacks(fileName))
+            CTM_LOG_SUCCESS("Exported collapsed stacks to ", fileName);
+    }
+    if(zoomNodeIndex != 0)
+    {
+        ImGui::SameLine();
+        if(ImGui::Button("Reset Zoom"))
+            zoomNodeIndex = 0;
+    }
+
+    RenderFlameGraph();
+}
+
+bool CTMProcessProfiler::ExportCollapsedStacks(const char* filePath)
+{
+    if(GetState() != CTMProfilerState::Finished || result.nodes.empty())
+        return false;
+
+    std::ofstream outputFile(filePath, std::ios::out | std::ios::trunc);
+    if(!outputFile.is_open())
+    {
+        CTM_LOG_ERROR("Failed to open ", filePath, " for writing collapsed stacks.");
+        return false;
+    }
+
+    //Same format as flamegraph.pl / speedscope expect: 'root;child;leaf count'
+    std::string stackPath;
+    for(auto&& childIndex : result.nodes[0].children)
+        WriteCollapsedStacks(outputFile, childIndex, stackPath);
+
+    return true;
+}
+
+//--------------------WORKER THREAD FUNCTIONS--------------------
+void CTMProcessProfiler::SampleProcess(DWORD processId, int sampleDurationSeconds, int sampleRateHz)
+{
+    auto Fail = [this](const char* reason, DWORD errorCode){
+        char errorBuffer[128];
+        std::snprintf(errorBuffer, sizeof(errorBuffer), "%s (error code: %lu)", reason, errorCode);
+        errorText = errorBuffer;
+        CTM_LOG_ERROR("Profiler: ", errorBuffer);
+        CloseThreadHandles();
+        state.store(CTMProfilerState::Failed);
+    };
+
+    HANDLE hProcess = OpenProcess(PROCESS_QUERY_INFORMATION | PROCESS_VM_READ, FALSE, processId);
+    if(!hProcess)
+        return Fail("Failed to open the process", GetLastError());
+
+    //Unwinding a 32 bit process from a 64 bit one needs the WOW64 contexts, not worth it for now
+    BOOL isTargetWow64 = FALSE, isSelfWow64 = FALSE;
+    IsWow64Process(hProcess, &isTargetWow64);
+    IsWow64Process(GetCurrentProcess(), &isSelfWow64);
+    if(isTargetWow64 != isSelfWow64)
+    {
+        CloseHandle(hProcess);
+        return Fail("Target has a different bitness than CTM, not supported", 0);
+    }
+
+    //Deferred loads so symbols are only loaded for modules we actually hit
+    SymSetOptions(SymGetOptions() | SYMOPT_DEFERRED_LOADS | SYMOPT_UNDNAME);
+    if(!SymInitialize(hProcess, nullptr, TRUE))
+    {
+        DWORD errorCode = GetLastError();
+        CloseHandle(hProcess);
+        return Fail("Failed to initialize symbols", errorCode);
+    }
+
+    addressTrie.clear();
+    addressTrie.emplace_back(); //Root
+
+    //High resolution timer is needed for anything above ~64 Hz, fallback to the normal one if its not available (pre 1803)
+    HANDLE hTimer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+    if(!hTimer)
+    {
+        CTM_LOG_WARNING("High resolution timer is not available, sampling rate will be limited by the system timer.");
+        hTimer = CreateWaitableTimerW(nullptr, FALSE, nullptr);
+    }
+
+    LARGE_INTEGER frequency, startTime, now, suspendStart, suspendEnd;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&startTime);
+
+    LONGLONG      durationTicks     = frequency.QuadPart * sampleDurationSeconds;
+    LONGLONG      tickInterval      = frequency.QuadPart / sampleRateHz;
+    LONGLONG      nextThreadRefresh = startTime.QuadPart;
+    LONGLONG      suspendedTicks    = 0;
+    DWORD64       stackFrames[maxStackFrames];
+    std::uint32_t frameCount        = 0;
+
+    while(!shouldStop.load())
+    {
+        QueryPerformanceCounter(&now);
+        LONGLONG elapsedTicks = now.QuadPart - startTime.QuadPart;
+        if(elapsedTicks >= durationTicks)
+            break;
+
+        progress.store(static_cast<float>(elapsedTicks) / durationTicks);
+
+        if(now.QuadPart >= nextThreadRefresh)
+        {
+            RefreshThreadList(processId);
+            nextThreadRefresh = now.QuadPart + frequency.QuadPart * threadRefreshTimeMs / 1000;
+            //Process is gone
+            if(threadHandles.empty())
+                break;
+        }
+
+        for(auto it = threadHandles.begin(); it != threadHandles.end(); )
+        {
+            QueryPerformanceCounter(&suspendStart);
+            bool isSampled = SampleThread(hProcess, it->second, stackFrames, frameCount);
+            QueryPerformanceCounter(&suspendEnd);
+
+            //Thread exited, forget about it
+            if(!isSampled)
+            {
+                CloseHandle(it->second);
+                it = threadHandles.erase(it);
+                continue;
+            }
+
+            suspendedTicks += suspendEnd.QuadPart - suspendStart.QuadPart;
+            //Insertion happens after the thread is resumed, keep the suspension as short as possible
+            if(frameCount > 0)
+            {
+                InsertStack(stackFrames, frameCount);
+                ++result.stackCount;
+            }
+            ++it;
+        }
+        ++result.tickCount;
+
+        //Sleep till the next tick, relative due time in 100ns units (negative means relative)
+        LARGE_INTEGER dueTime;
+        dueTime.QuadPart = -static_cast<LONGLONG>(10'000'000 / sampleRateHz);
+        if(hTimer && SetWaitableTimer(hTimer, &dueTime, 0, nullptr, nullptr, FALSE))
+            WaitForSingleObject(hTimer, INFINITE);
+        else
+            Sleep(static_cast<DWORD>(std::max<LONGLONG>(1, tickInterval * 1000 / frequency.QuadPart)));
+    }
+
+    QueryPerformanceCounter(&now);
+    result.elapsedSeconds   = static_cast<double>(now.QuadPart - startTime.QuadPart) / frequency.QuadPart;
+    result.suspendedSeconds = static_cast<double>(suspendedTicks) / frequency.QuadPart;
+    result.processId        = processId;
+
+    if(hTimer)
+        CloseHandle(hTimer);
+    CloseThreadHandles();
+
+    //Modules may have been loaded while we were sampling
+    SymRefreshModuleList(hProcess);
+    BuildFlameGraph(hProcess);
+
+    SymCleanup(hProcess);
+    CloseHandle(hProcess);
+
+    //Raw data is not needed anymore
+    AddressTrieVector().swap(addressTrie);
+    addressToSymbolId.clear();
+    symbolNameToId.clear();
+
+    progress.store(1.0f);
+    state.store(CTMProfilerState::Finished);
+}
+
+bool CTMProcessProfiler::SampleThread(HANDLE hProcess, HANDLE hThread, DWORD64* stackFrames, std::uint32_t& frameCount)
+{
+    frameCount = 0;
+    if(SuspendThread(hThread) == static_cast<DWORD>(-1))
+        return false;
+    hSuspendedThread.store(hThread);
+
+    CONTEXT threadContext      = {};
+    threadContext.ContextFlags = CONTEXT_FULL;
+    if(GetThreadContext(hThread, &threadContext))
+    {
+        STACKFRAME64 stackFrame = {};
+        DWORD        machineType;
+#if defined(_M_X64) || defined(__x86_64__)
+        machineType                 = IMAGE_FILE_MACHINE_AMD64;
+        stackFrame.AddrPC.Offset    = threadContext.Rip;
+        stackFrame.AddrFrame.Offset = threadContext.Rbp;
+        stackFrame.AddrStack.Offset = threadContext.Rsp;
+#elif defined(_M_IX86) || defined(__i386__)
+        machineType                 = IMAGE_FILE_MACHINE_I386;
+        stackFrame.AddrPC.Offset    = threadContext.Eip;
+        stackFrame.AddrFrame.Offset = threadContext.Ebp;
+        stackFrame.AddrStack.Offset = threadContext.Esp;
+#elif defined(_M_ARM64) || defined(__aarch64__)
+        machineType                 = IMAGE_FILE_MACHINE_ARM64;
+        stackFrame.AddrPC.Offset    = threadContext.Pc;
+        stackFrame.AddrFrame.Offset = threadContext.Fp;
+        stackFrame.AddrStack.Offset = threadContext.Sp;
+#endif
+        stackFrame.AddrPC.Mode    = AddrModeFlat;
+        stackFrame.AddrFrame.Mode = AddrModeFlat;
+        stackFrame.AddrStack.Mode = AddrModeFlat;
+
+        while(frameCount < maxStackFrames &&
+              StackWalk64(machineType, hProcess, hThread, &stackFrame, &threadContext, nullptr,
+                          SymFunctionTableAccess64, SymGetModuleBase64, nullptr))
+        {
+            if(stackFrame.AddrPC.Offset == 0)
+                break;
+            stackFrames[frameCount++] = stackFrame.AddrPC.Offset;
+        }
+    }
+
+    hSuspendedThread.store(nullptr);
+    ResumeThread(hThread);
+    return true;
+}
+
+void CTMProcessProfiler::InsertStack(const DWORD64* stackFrames, std::uint32_t frameCount)
+{
+    //Frames are leaf first, the trie is root first
+    std::uint32_t nodeIndex = 0;
+    ++addressTrie[0].sampleCount;
+
+    for(std::uint32_t i = frameCount; i-- > 0; )
+    {
+        DWORD64 address = stackFrames[i];
+        auto    it      = addressTrie[nodeIndex].children.find(address);
+        if(it == addressTrie[nodeIndex].children.end())
+        {
+            std::uint32_t newIndex = static_cast<std::uint32_t>(addressTrie.size());
+            //emplace_back may reallocate, don't hold references across it
+            addressTrie[nodeIndex].children.emplace(address, newIndex);
+            addressTrie.emplace_back().address = address;
+            nodeIndex = newIndex;
+        }
+        else
+            nodeIndex = it->second;
+
+        ++addressTrie[nodeIndex].sampleCount;
+    }
+
+    ++addressTrie[nodeIndex].selfCount;
+}
+
+void CTMProcessProfiler::BuildFlameGraph(HANDLE hProcess)
+{
+    result.nodes.clear();
+    result.symbolNames.clear();
+
+    //Root symbol is the process itself
+    result.symbolNames.emplace_back("all");
+    result.nodes.emplace_back();
+    result.nodes[0].sampleCount = addressTrie[0].sampleCount;
+
+    MergeIntoFlameNode(hProcess, 0, 0);
+    FinalizeFlameNode(0);
+}
+
+void CTMProcessProfiler::RefreshThreadList(DWORD processId)
+{
+    HANDLE hSnapshot = CreateToolhelp32Snapshot(TH32CS_SNAPTHREAD, 0);
+    if(hSnapshot == INVALID_HANDLE_VALUE)
+        return;
+
+    THREADENTRY32 threadEntry;
+    threadEntry.dwSize = sizeof(threadEntry);
+    if(Thread32First(hSnapshot, &threadEntry))
+    {
+        do
+        {
+            if(threadEntry.th32OwnerProcessID != processId || threadHandles.count(threadEntry.th32ThreadID))
+                continue;
+
+            HANDLE hThread = OpenThread(THREAD_SUSPEND_RESUME | THREAD_GET_CONTEXT | THREAD_QUERY_INFORMATION, FALSE,
+                                        threadEntry.th32ThreadID);
+            if(hThread)
+                threadHandles.emplace(threadEntry.th32ThreadID, hThread);
+        }
+        while(Thread32Next(hSnapshot, &threadEntry));
+    }
+
+    CloseHandle(hSnapshot);
+}
+
+void CTMProcessProfiler::CloseThreadHandles()
+{
+    for(auto&& [_, hThread] : threadHandles)
+        CloseHandle(hThread);
+
+    threadHandles.clear();
+}
+
+void CTMProcessProfiler::JoinWorkerThread()
+{
+    if(workerThread.joinable())
+    {
+        workerThread.join();
+        //Worker is gone, nothing can be left suspended anymore
+        resourceGuard.UnregisterCleanupFunction(resumeCleanupFunctionName);
+    }
+}
+
+//--------------------HELPER FUNCTIONS--------------------
+std::uint32_t CTMProcessProfiler::GetSymbolId(HANDLE hProcess, DWORD64 address, bool isReturnAddress)
+{
+    auto cacheIt = addressToSymbolId.find(address);
+    if(cacheIt != addressToSymbolId.end())
+        return cacheIt->second;
+
+    //Return addresses point after the call, which may already be the next function. Look up the call instruction instead
+    DWORD64 lookupAddress = isReturnAddress ? address - 1 : address;
+
+    alignas(SYMBOL_INFO) char symbolBuffer[sizeof(SYMBOL_INFO) + MAX_SYM_NAME];
+    auto symbolInfo          = reinterpret_cast<PSYMBOL_INFO>(symbolBuffer);
+    symbolInfo->SizeOfStruct = sizeof(SYMBOL_INFO);
+    symbolInfo->MaxNameLen   = MAX_SYM_NAME;
+
+    IMAGEHLP_MODULE64 moduleInfo = {};
+    moduleInfo.SizeOfStruct      = sizeof(moduleInfo);
+    bool hasModule               = SymGetModuleInfo64(hProcess, lookupAddress, &moduleInfo);
+
+    char    symbolName[MAX_SYM_NAME + 64];
+    DWORD64 displacement = 0;
+    if(SymFromAddr(hProcess, lookupAddress, &displacement, symbolInfo))
+        std::snprintf(symbolName, sizeof(symbolName), "%s!%s", hasModule ? moduleInfo.ModuleName : "?", symbolInfo->Name);
+    else if(hasModule)
+        std::snprintf(symbolName, sizeof(symbolName), "%s+0x%llx", moduleInfo.ModuleName, lookupAddress - moduleInfo.BaseOfImage);
+    else
+        std::snprintf(symbolName, sizeof(symbolName), "0x%llx", address);
+
+    //Many addresses end up in the same function, intern the names
+    auto [nameIt, isInserted] = symbolNameToId.try_emplace(symbolName, static_cast<std::uint32_t>(result.symbolNames.size()));
+    if(isInserted)
+        result.symbolNames.emplace_back(symbolName);
+
+    addressToSymbolId.emplace(address, nameIt->second);
+    return nameIt->second;
+}
+
+void CTMProcessProfiler::MergeIntoFlameNode(HANDLE hProcess, std::uint32_t addressNodeIndex, std::uint32_t flameNodeIndex)
+{
+    //Temporary lookup for this node's children, symbol id -> flame node index
+    std::unordered_map<std::uint32_t, std::uint32_t> childBySymbol;
+    for(auto&& childIndex : result.nodes[flameNodeIndex].children)
+        childBySymbol.emplace(result.nodes[childIndex].symbolId, childIndex);
+
+    for(auto&& [address, addressChildIndex] : addressTrie[addressNodeIndex].children)
+    {
+        //Every frame except the leaf of a stack is a return address, leaf only frames have no children
+        bool          isReturnAddress = !addressTrie[addressChildIndex].children.empty();
+        std::uint32_t symbolId        = GetSymbolId(hProcess, address, isReturnAddress);
+
+        auto [it, isInserted] = childBySymbol.try_emplace(symbolId, static_cast<std::uint32_t>(result.nodes.size()));
+        if(isInserted)
+        {
+            result.nodes.emplace_back().symbolId = symbolId;
+            result.nodes[flameNodeIndex].children.push_back(it->second);
+        }
+
+        std::uint32_t flameChildIndex = it->second;
+        result.nodes[flameChildIndex].sampleCount += addressTrie[addressChildIndex].sampleCount;
+        result.nodes[flameChildIndex].selfCount   += addressTrie[addressChildIndex].selfCount;
+
+        MergeIntoFlameNode(hProcess, addressChildIndex, flameChildIndex);
+    }
+}
+
+void CTMProcessProfiler::FinalizeFlameNode(std::uint32_t nodeIndex)
+{
+    auto& children = result.nodes[nodeIndex].children;
+    std::sort(children.begin(), children.end(), [this](std::uint32_t left, std::uint32_t right){
+        return result.symbolNames[result.nodes[left].symbolId] < result.symbolNames[result.nodes[right].symbolId];
+    });
+
+    std::uint32_t maxDepth = 0;
+    for(auto&& childIndex : result.nodes[nodeIndex].children)
+    {
+        FinalizeFlameNode(childIndex);
+        maxDepth = std::max(maxDepth, result.nodes[childIndex].maxDepth + 1);
+    }
+    result.nodes[nodeIndex].maxDepth = maxDepth;
+}
+
+void CTMProcessProfiler::RenderFlameGraph()
+{
+    if(result.nodes.empty() || result.nodes[0].sampleCount == 0)
+    {
+        ImGui::TextUnformatted("No stacks were captured.");
+        return;
+    }
+
+    const CTMFlameNode& zoomNode    = result.nodes[zoomNodeIndex];
+    float               graphHeight = (zoomNode.maxDepth + 1) * flameRowHeight;
+
+    //Top down (icicle) layout, root at the top. Scrolls if the stacks are deep
+    if(ImGui::BeginChild("FlameGraph", {-1.0f, std::min(graphHeight, 400.0f) + 4.0f}, true, ImGuiWindowFlags_HorizontalScrollbar))
+    {
+        ImVec2 origin = ImGui::GetCursorScreenPos();
+        float  width  = ImGui::GetContentRegionAvail().x;
+        ImGui::Dummy({width, graphHeight});
+
+        RenderFlameNode(ImGui::GetWindowDrawList(), zoomNodeIndex, origin.x, width, 0, origin, width / zoomNode.sampleCount);
+    }
+    ImGui::EndChild();
+    ImGui::TextDisabled("Hover for details, click a frame to zoom into it.");
+}
+
+void CTMProcessProfiler::RenderFlameNode(ImDrawList* drawList, std::uint32_t nodeIndex, float x, float width, std::uint32_t depth,
+                                         ImVec2 origin, float pixelsPerSample)
+{
+    //Too thin to see, and so are all of its children
+    if(width < 1.0f)
+        return;
+
+    const CTMFlameNode& node       = result.nodes[nodeIndex];
+    const std::string&  symbolName = result.symbolNames[node.symbolId];
+
+    ImVec2 rectMin = {x, origin.y + depth * flameRowHeight};
+    ImVec2 rectMax = {x + width - 1.0f, rectMin.y + flameRowHeight - 1.0f};
+
+    //Warm colors based on the name, so the same function has the same color everywhere
+    std::size_t nameHash = std::hash<std::string>{}(symbolName);
+    ImU32       color    = IM_COL32(205 + (nameHash % 50), 80 + ((nameHash >> 8) % 120), 40 + ((nameHash >> 16) % 40), 255);
+
+    bool isHovered = ImGui::IsMouseHoveringRect(rectMin, rectMax) && ImGui::IsWindowHovered();
+    drawList->AddRectFilled(rectMin, rectMax, isHovered ? IM_COL32(255, 255, 255, 255) : color);
+
+    //Clip the name to the frame, no point drawing text in frames smaller than a few characters
+    if(width > 20.0f)
+    {
+        ImVec4 clipRect = {rectMin.x + 2.0f, rectMin.y, rectMax.x - 2.0f, rectMax.y};
+        drawList->AddText(ImGui::GetFont(), ImGui::GetFontSize(), {rectMin.x + 3.0f, rectMin.y + 1.0f}, IM_COL32(0, 0, 0, 255),
+                          symbolName.c_str(), nullptr, 0.0f, &clipRect);
+    }
+
+    if(isHovered)
+    {
+        ImGui::SetTooltip("%s\nSamples: %u (%.2lf%%), Self: %u", symbolName.c_str(), node.sampleCount,
+                          100.0 * node.sampleCount / result.nodes[0].sampleCount, node.selfCount);
+        if(ImGui::IsMouseClicked(ImGuiMouseButton_Left))
+            zoomNodeIndex = nodeIndex;
+    }
+
+    float childX = x;
+    for(auto&& childIndex : node.children)
+    {
+        float childWidth = result.nodes[childIndex].sampleCount * pixelsPerSample;
+        RenderFlameNode(drawList, childIndex, childX, childWidth, depth + 1, origin, pixelsPerSample);
+        childX += childWidth;
+    }
+}
+
+void CTMProcessProfiler::WriteCollapsedStacks(std::ofstream& outputFile, std::uint32_t nodeIndex, std::string& stackPath)
+{
+    const CTMFlameNode& node       = result.nodes[nodeIndex];
+    std::size_t         pathLength = stackPath.size();
+
+    if(!stackPath.empty())
+        stackPath += ';';
+    stackPath += result.symbolNames[node.symbolId];
+
+    if(node.selfCount > 0)
+        outputFile << stackPath << ' ' << node.selfCount << '\n';
+
+    for(auto&& childIndex : node.children)
+        WriteCollapsedStacks(outputFile, childIndex, stackPath);
+
+    stackPath.resize(pathLength);
+}
\ No newline at end of file
@@ -0,0 +1,144 @@
+#ifndef CTM_PROCESS_MENU_PROFILER_HPP
+#define CTM_PROCESS_MENU_PROFILER_HPP
+
+//Windows stuff
+#include <windows.h>
+#include <tlhelp32.h>
+#include <dbghelp.h>
+//ImGui stuff
+#include "../../ImGUI/imgui.h"
+//My stuff
+#include "../CTMPureHeaderFiles/ctm_logger.h"
+#include "../CTMGlobalManagers/ctm_critical_resource_guard.h"
+//Stdlib stuff
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <thread>
+#include <atomic>
+#include <fstream>
+#include <algorithm>
+#include <functional>
+#include <cstdint>
+#include <cstdio>
+
+//Call tree keyed by raw addresses, built while sampling (prefixes are shared so repeated stacks cost nothing)
+struct CTMAddressTrieNode
+{
+    //Perfect 8 byte alignment
+    DWORD64                                      address     = 0;
+    std::unordered_map<DWORD64, std::uint32_t>   children;      //address -> node index
+    std::uint32_t                                sampleCount = 0;
+    std::uint32_t                                selfCount   = 0; //Samples where this frame was the leaf
+};
+
+//Call tree keyed by symbols, built from the address trie once sampling is done. This is what the flame graph draws
+struct CTMFlameNode
+{
+    std::vector<std::uint32_t> children;     //Sorted by symbol name so the graph doesn't jump around
+    std::uint32_t              symbolId    = 0;
+    std::uint32_t              sampleCount = 0;
+    std::uint32_t              selfCount   = 0;
+    std::uint32_t              maxDepth    = 0; //Deepest path below this node, used for the graph height
+};
+
+struct CTMProfileResult
+{
+    //Perfect 8 byte alignment
+    std::vector<CTMFlameNode> nodes;           //0 is the root
+    std::vector<std::string>  symbolNames;     //Indexed by symbolId
+    double                    elapsedSeconds   = 0.0;
+    double                    suspendedSeconds = 0.0; //Total time target threads were suspended by us
+    std::uint64_t             stackCount       = 0;   //Thread stacks captured
+    std::uint64_t             tickCount        = 0;   //Sampling ticks, each tick samples every thread
+    DWORD                     processId        = 0;
+};
+
+enum class CTMProfilerState : std::uint8_t
+{
+    Idle,
+    Running,
+    Finished,
+    Failed
+};
+
+using AddressTrieVector = std::vector<CTMAddressTrieNode>;
+using ProfilerThreadMap = std::unordered_map<DWORD, HANDLE>; //Thread id -> thread handle
+
+/*
+ * Stack sampling profiler for a single process.
+ * Every tick, each thread of the target is suspended, its stack is walked with StackWalk64 (uses the unwind tables, x64 code rarely-
+ * -keeps frame pointers) and it is resumed right away. Symbols are only resolved once sampling is done and only for unique addresses.
+ * Everything dbghelp related happens on the worker thread, dbghelp is not thread safe.
+ */
+class CTMProcessProfiler
+{
+public:
+    CTMProcessProfiler() = default;
+    ~CTMProcessProfiler();
+
+    //No need for copy or move operations
+    CTMProcessProfiler(const CTMProcessProfiler&)            = delete;
+    CTMProcessProfiler& operator=(const CTMProcessProfiler&) = delete;
+    CTMProcessProfiler(CTMProcessProfiler&&)                 = delete;
+    CTMProcessProfiler& operator=(CTMProcessProfiler&&)      = delete;
+
+public: //Main functions
+    bool Start(DWORD);
+    void Stop();
+    //Renders settings, progress, overhead and the flame graph for the target process
+    void Render(DWORD);
+    bool ExportCollapsedStacks(const char*);
+
+public: //Getters
+    CTMProfilerState GetState() const { return state.load(); }
+
+private: //Worker thread functions
+    void SampleProcess(DWORD, int, int);
+    bool SampleThread(HANDLE, HANDLE, DWORD64*, std::uint32_t&);
+    void InsertStack(const DWORD64*, std::uint32_t);
+    void BuildFlameGraph(HANDLE);
+    void RefreshThreadList(DWORD);
+    void CloseThreadHandles();
+    void JoinWorkerThread();
+
+private: //Helper functions
+    std::uint32_t GetSymbolId(HANDLE, DWORD64, bool);
+    void          MergeIntoFlameNode(HANDLE, std::uint32_t, std::uint32_t);
+    void          FinalizeFlameNode(std::uint32_t);
+    void          RenderFlameGraph();
+    void          RenderFlameNode(ImDrawList*, std::uint32_t, float, float, std::uint32_t, ImVec2, float);
+    void          WriteCollapsedStacks(std::ofstream&, std::uint32_t, std::string&);
+
+private: //Settings (UI)
+    int durationSeconds = 5;
+    int samplingRateHz  = 200;
+
+private: //Worker thread state
+    std::thread                   workerThread;
+    std::atomic<CTMProfilerState> state{CTMProfilerState::Idle};
+    std::atomic<bool>             shouldStop{false};
+    std::atomic<float>            progress{0.0f};
+    std::atomic<HANDLE>           hSuspendedThread{nullptr}; //Resumed by the resource guard if we die while a thread is suspended
+    ProfilerThreadMap             threadHandles;
+    AddressTrieVector             addressTrie;
+    //Symbol cache, only touched by the worker thread
+    std::unordered_map<DWORD64, std::uint32_t>     addressToSymbolId;
+    std::unordered_map<std::string, std::uint32_t> symbolNameToId;
+
+private: //Result, only read by the UI thread once the state is 'Finished'
+    CTMProfileResult result;
+    std::string      errorText;
+    std::uint32_t    zoomNodeIndex = 0;
+
+private: //Resource guard
+    CTMCriticalResourceGuard& resourceGuard           = CTMCriticalResourceGuard::GetInstance();
+    const char*               resumeCleanupFunctionName = "CTMProcessProfiler::ResumeSuspendedThread";
+
+private: //Constant stuff
+    constexpr static std::uint32_t maxStackFrames      = 128;
+    constexpr static int           threadRefreshTimeMs = 100;  //Thread snapshots are system wide and not that cheap
+    constexpr static float         flameRowHeight      = 18.0f;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,450 @@
+#include "ctm_ready_latency_tracker.h"
+
+//Don't really want these macros, they are messing up the std::max and std::min functions
+#undef max
+#undef min
+
+//Init global variables
+CTMReadyLatencyTracker globalReadyLatencyTracker;
+
+CTMReadyLatencyTracker::CTMReadyLatencyTracker(std::size_t threadCapacity, std::size_t processCapacity, double maxWaitSeconds)
+{
+    LARGE_INTEGER frequency;
+    if(QueryPerformanceFrequency(&frequency) && frequency.QuadPart > 0)
+        qpcFrequency = static_cast<ULONGLONG>(frequency.QuadPart);
+    maxWaitTicks = static_cast<ULONGLONG>(maxWaitSeconds * qpcFrequency);
+
+    pendingSlots   = std::make_unique<CTMPendingReady[]>(pendingSlotCount);
+    aggregateBatch = std::make_unique<CTMReadyLatencySample[]>(aggregateBatchSize);
+    InitTable(threadTable, threadCapacity);
+    InitTable(processTable, processCapacity);
+}
+
+//--------------------WRITER FUNCTIONS--------------------
+void CTMReadyLatencyTracker::RecordReady(ULONGLONG timestamp, DWORD threadId)
+{
+    //Idle thread is never 'ready', it is what a core runs when nobody is
+    if(threadId == 0 || !isEnabled.load(std::memory_order_relaxed))
+        return;
+
+    RestartMatchingIfAsked();
+    readyEvents.fetch_add(1, std::memory_order_relaxed);
+
+    CTMPendingReady* pending = FindPending(threadId);
+    if(pending && pending->hasRun)
+    {
+        //The switch got here first (the ready was logged on another core whose buffer came later), it is the one this ready ends in
+        if(pending->timestamp >= timestamp)
+        {
+            PublishSample(timestamp, pending->timestamp, threadId);
+            *pending = CTMPendingReady{};
+            return;
+        }
+
+        //That run was before this ready, it has nothing to do with it
+        pending->timestamp = timestamp;
+        pending->hasRun    = false;
+        return;
+    }
+
+    //Already waiting means the switch that should have ended the last wait got lost, the newer ready is the one that counts
+    if(pending)
+    {
+        pending->timestamp = std::max(pending->timestamp, timestamp);
+        return;
+    }
+
+    CTMPendingReady& claimed = ClaimPending(threadId, true);
+    claimed.timestamp = timestamp;
+    claimed.threadId  = threadId;
+    claimed.hasRun    = false;
+}
+
+void CTMReadyLatencyTracker::RecordSwitchIn(ULONGLONG timestamp, DWORD threadId)
+{
+    if(threadId == 0 || !isEnabled.load(std::memory_order_relaxed))
+        return;
+
+    RestartMatchingIfAsked();
+
+    CTMPendingReady* pending = FindPending(threadId);
+    if(pending && !pending->hasRun && pending->timestamp <= timestamp)
+    {
+        PublishSample(pending->timestamp, timestamp, threadId);
+        *pending = CTMPendingReady{};
+        return;
+    }
+
+    unmatchedSwitches.fetch_add(1, std::memory_order_relaxed);
+    //A ready newer than the switch belongs to the next wait, leave it be
+    if(pending && !pending->hasRun)
+        return;
+
+    //Leave a mark for a ready which may still be on its way, marks never push a waiting thread out
+    CTMPendingReady* mark = pending ? pending : &ClaimPending(threadId, false);
+    if(mark->threadId != 0 && !mark->hasRun)
+        return;
+
+    mark->timestamp = timestamp;
+    mark->threadId  = threadId;
+    mark->hasRun    = true;
+}
+
+//--------------------MAIN FUNCTIONS--------------------
+void CTMReadyLatencyTracker::SetEnabled(bool shouldEnable)
+{
+    if(shouldEnable && !isEnabled.load(std::memory_order_relaxed))
+        enableGeneration.fetch_add(1, std::memory_order_release);
+    isEnabled.store(shouldEnable, std::memory_order_release);
+}
+
+std::size_t CTMReadyLatencyTracker::AggregateSamples()
+{
+    std::size_t sampleCount = sampleRing.PopBatch(aggregateBatch.get(), aggregateBatchSize);
+    if(sampleCount == 0)
+        return 0;
+
+    {
+        std::lock_guard<std::mutex> lock(trackerMutex);
+        for(std::size_t i = 0; i < sampleCount; i++)
+            AddSample(aggregateBatch[i]);
+    }
+
+    aggregatedSamples.fetch_add(sampleCount, std::memory_order_release);
+    return sampleCount;
+}
+
+bool CTMReadyLatencyTracker::IsDrained() const
+{
+    //Same idea as the pipeline's, a popped batch can still be in the middle of being folded
+    return aggregatedSamples.load(std::memory_order_acquire) + sampleRing.GetDroppedCount() >= matchedSamples.load(std::memory_order_acquire);
+}
+
+bool CTMReadyLatencyTracker::GetProcessSummary(DWORD processId, CTMLatencySummary& outSummary) const
+{
+    outSummary = CTMLatencySummary{};
+
+    std::lock_guard<std::mutex> lock(trackerMutex);
+    const CTMReadyLatencyEntry* entry = FindEntry(processTable, processId);
+    if(entry == nullptr)
+        return false;
+
+    outSummary = Summarize(entry->latency);
+    return true;
+}
+
+bool CTMReadyLatencyTracker::GetMergedSummary(const DWORD* processIds, std::size_t processCount, CTMLatencySummary& outSummary) const
+{
+    outSummary = CTMLatencySummary{};
+
+    //~1.7 KB each, a group is a handful of processes
+    CTMLatencyHistogram mergedLatency;
+    {
+        std::lock_guard<std::mutex> lock(trackerMutex);
+        for(std::size_t i = 0; i < processCount; i++)
+            if(const CTMReadyLatencyEntry* entry = FindEntry(processTable, processIds[i]))
+                mergedLatency.Merge(entry->latency);
+    }
+
+    outSummary = Summarize(mergedLatency);
+    return outSummary.count > 0;
+}
+
+void CTMReadyLatencyTracker::GetSystemSummary(CTMLatencySummary& outSummary) const
+{
+    CTMLatencyHistogram mergedLatency;
+    {
+        std::lock_guard<std::mutex> lock(trackerMutex);
+        mergedLatency.Merge(retiredLatency);
+        for(std::size_t i = 0; i < processTable.slotCount; i++)
+            if(processTable.slots[i].isUsed)
+                mergedLatency.Merge(processTable.slots[i].latency);
+    }
+
+    outSummary = Summarize(mergedLatency);
+}
+
+void CTMReadyLatencyTracker::CollectProcessThreads(DWORD processId, std::vector<CTMThreadReadyLatency>& outThreads, std::size_t maxCount) const
+{
+    outThreads.clear();
+    {
+        std::lock_guard<std::mutex> lock(trackerMutex);
+        for(std::size_t i = 0; i < threadTable.slotCount; i++)
+        {
+            const CTMReadyLatencyEntry& entry = threadTable.slots[i];
+            if(!entry.isUsed || entry.processId != processId)
+                continue;
+
+            CTMThreadReadyLatency& thread = outThreads.emplace_back();
+            thread.threadId = entry.id;
+            thread.latency = Summarize(entry.latency);
+        }
+    }
+
+    //The one waiting the longest is the one worth looking at
+    std::size_t keptCount = std::min(maxCount, outThreads.size());
+    std::partial_sort(outThreads.begin(), outThreads.begin() + keptCount, outThreads.end(), [](const CTMThreadReadyLatency& left, const CTMThreadReadyLatency& right){
+        return left.latency.p99 != right.latency.p99 ? left.latency.p99 > right.latency.p99 : left.latency.count > right.latency.count;
+    });
+    outThreads.resize(keptCount);
+}
+
+CTMReadyLatencyStats CTMReadyLatencyTracker::GetStats() const
+{
+    CTMReadyLatencyStats stats;
+    stats.readyEvents       = readyEvents.load(std::memory_order_relaxed);
+    stats.matched           = matchedSamples.load(std::memory_order_relaxed);
+    stats.unmatchedSwitches = unmatchedSwitches.load(std::memory_order_relaxed);
+    stats.overwritten       = overwrittenWaits.load(std::memory_order_relaxed);
+    stats.tooLong           = tooLongWaits.load(std::memory_order_relaxed);
+    stats.ringDrops         = sampleRing.GetDroppedCount();
+    stats.unknownProcess    = unknownProcess.load(std::memory_order_relaxed);
+    stats.memoryUsage       = pendingSlotCount * sizeof(CTMPendingReady) + sampleRing.GetCapacity() * sizeof(CTMReadyLatencySample) +
+                              aggregateBatchSize * sizeof(CTMReadyLatencySample) +
+                              (threadTable.slotCount + processTable.slotCount) * sizeof(CTMReadyLatencyEntry) + sizeof(CTMLatencyHistogram);
+
+    std::lock_guard<std::mutex> lock(trackerMutex);
+    stats.evictedThreads   = evictedThreads;
+    stats.evictedProcesses = evictedProcesses;
+    stats.threadCount      = threadTable.entryCount;
+    stats.processCount     = processTable.entryCount;
+    return stats;
+}
+
+void CTMReadyLatencyTracker::RemoveProcess(DWORD processId)
+{
+    std::lock_guard<std::mutex> lock(trackerMutex);
+
+    std::size_t slot = HashKey(processId) & processTable.slotMask;
+    while(processTable.slots[slot].isUsed)
+    {
+        if(processTable.slots[slot].id == processId)
+        {
+            retiredLatency.Merge(processTable.slots[slot].latency);
+            EraseEntrySlot(processTable, slot);
+            break;
+        }
+        slot = (slot + 1) & processTable.slotMask;
+    }
+
+    //Thread ids get reused by other processes, don't leave these around to be found by them
+    slot = 0;
+    while(slot < threadTable.slotCount)
+    {
+        //Erasing shifts the next entry of the chain into this slot, so look at it again before moving on
+        if(threadTable.slots[slot].isUsed && threadTable.slots[slot].processId == processId)
+        {
+            EraseEntrySlot(threadTable, slot);
+            continue;
+        }
+        ++slot;
+    }
+}
+
+void CTMReadyLatencyTracker::Clear()
+{
+    std::lock_guard<std::mutex> lock(trackerMutex);
+    for(CTMReadyLatencyTable* table : {&threadTable, &processTable})
+    {
+        for(std::size_t i = 0; i < table->slotCount; i++)
+        {
+            table->slots[i].latency.Clear();
+            table->slots[i].isUsed = false;
+        }
+        table->entryCount = 0;
+    }
+    retiredLatency.Clear();
+    evictedThreads   = 0;
+    evictedProcesses = 0;
+}
+
+//--------------------HELPER FUNCTIONS--------------------
+std::uint32_t CTMReadyLatencyTracker::HashKey(DWORD id)
+{
+    //Thread and process ids are multiples of 4, drop those bits before spreading them out
+    return (id >> 2) * 2654435761u;
+}
+
+void CTMReadyLatencyTracker::InitTable(CTMReadyLatencyTable& table, std::size_t capacity)
+{
+    //Power of two (atleast 64 slots), 1/4 stays empty so probes end quickly
+    table.slotCount = 64;
+    while(table.slotCount < capacity)
+        table.slotCount *= 2;
+    table.slotMask   = table.slotCount - 1;
+    table.maxEntries = table.slotCount / 4 * 3;
+    table.slots      = std::make_unique<CTMReadyLatencyEntry[]>(table.slotCount);
+}
+
+CTMReadyLatencyTracker::CTMReadyLatencyEntry* CTMReadyLatencyTracker::FindEntry(const CTMReadyLatencyTable& table, DWORD id)
+{
+    std::size_t slot = HashKey(id) & table.slotMask;
+    while(table.slots[slot].isUsed)
+    {
+        if(table.slots[slot].id == id)
+            return &table.slots[slot];
+        slot = (slot + 1) & table.slotMask;
+    }
+    return nullptr;
+}
+
+bool CTMReadyLatencyTracker::FindOrInsertEntry(CTMReadyLatencyTable& table, DWORD id, CTMLatencyHistogram* retired, CTMReadyLatencyEntry*& outEntry)
+{
+    outEntry = FindEntry(table, id);
+    if(outEntry)
+        return false;
+
+    bool isEvicted = false;
+    if(table.entryCount >= table.maxEntries)
+    {
+        //Only when something new shows up with a full table, a scan of a few hundred slots is fine
+        std::size_t quietestSlot = table.slotCount;
+        for(std::size_t i = 0; i < table.slotCount; i++)
+            if(table.slots[i].isUsed && (quietestSlot == table.slotCount || table.slots[i].lastSeen < table.slots[quietestSlot].lastSeen))
+                quietestSlot = i;
+
+        if(retired)
+            retired->Merge(table.slots[quietestSlot].latency);
+        EraseEntrySlot(table, quietestSlot);
+        isEvicted = true;
+    }
+
+    //Erasing can shift entries back, so the slot is looked up after it
+    std::size_t slot = HashKey(id) & table.slotMask;
+    while(table.slots[slot].isUsed)
+        slot = (slot + 1) & table.slotMask;
+
+    CTMReadyLatencyEntry& entry = table.slots[slot];
+    entry.latency.Clear();
+    entry.lastSeen  = 0;
+    entry.id        = id;
+    entry.processId = 0;
+    entry.isUsed    = true;
+    ++table.entryCount;
+
+    outEntry = &entry;
+    return isEvicted;
+}
+
+void CTMReadyLatencyTracker::EraseEntrySlot(CTMReadyLatencyTable& table, std::size_t slot)
+{
+    //Backward shift deletion, same as the flow table's (check ctm_network_flow_table.cpp)
+    std::size_t holeSlot = slot;
+    std::size_t nextSlot = (slot + 1) & table.slotMask;
+    while(table.slots[nextSlot].isUsed)
+    {
+        std::size_t homeSlot     = HashKey(table.slots[nextSlot].id) & table.slotMask;
+        bool        isHomeInside = holeSlot <= nextSlot ? (holeSlot < homeSlot && homeSlot <= nextSlot)
+                                                        : (holeSlot < homeSlot || homeSlot <= nextSlot);
+        if(!isHomeInside)
+        {
+            table.slots[holeSlot] = table.slots[nextSlot];
+            holeSlot              = nextSlot;
+        }
+        nextSlot = (nextSlot + 1) & table.slotMask;
+    }
+
+    //Histograms are cleared when the slot gets taken again, no need to touch ~1.7 KB here
+    table.slots[holeSlot].isUsed = false;
+    --table.entryCount;
+}
+
+CTMReadyLatencyTracker::CTMPendingReady* CTMReadyLatencyTracker::FindPending(DWORD threadId)
+{
+    std::size_t home = HashKey(threadId) & (pendingSlotCount - 1);
+    for(std::size_t probe = 0; probe < maxPendingProbe; probe++)
+    {
+        CTMPendingReady& pending = pendingSlots[(home + probe) & (pendingSlotCount - 1)];
+        if(pending.threadId == threadId)
+            return &pending;
+    }
+    return nullptr;
+}
+
+CTMReadyLatencyTracker::CTMPendingReady& CTMReadyLatencyTracker::ClaimPending(DWORD threadId, bool isReady)
+{
+    //Free slot first, then the oldest mark, then (a ready only) the oldest waiting thread
+    std::size_t      home        = HashKey(threadId) & (pendingSlotCount - 1);
+    CTMPendingReady* oldestMark  = nullptr;
+    CTMPendingReady* oldestWait  = nullptr;
+    for(std::size_t probe = 0; probe < maxPendingProbe; probe++)
+    {
+        CTMPendingReady& pending = pendingSlots[(home + probe) & (pendingSlotCount - 1)];
+        if(pending.threadId == 0)
+            return pending;
+
+        CTMPendingReady*& oldest = pending.hasRun ? oldestMark : oldestWait;
+        if(oldest == nullptr || pending.timestamp < oldest->timestamp)
+            oldest = &pending;
+    }
+
+    if(oldestMark)
+        return *oldestMark;
+
+    //A mark asking for a slot gets the oldest wait back untouched, the caller sees it isn't free and leaves it
+    if(isReady)
+        overwrittenWaits.fetch_add(1, std::memory_order_relaxed);
+    return *oldestWait;
+}
+
+void CTMReadyLatencyTracker::PublishSample(ULONGLONG readyTimestamp, ULONGLONG runTimestamp, DWORD threadId)
+{
+    ULONGLONG waitTicks = runTimestamp - readyTimestamp;
+    if(waitTicks > maxWaitTicks)
+    {
+        tooLongWaits.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    CTMReadyLatencySample sample;
+    sample.timestamp     = runTimestamp;
+    sample.threadId      = threadId;
+    sample.processId     = globalCpuTimeline.FindProcessId(threadId);
+    sample.latencyMicros = static_cast<std::uint32_t>(waitTicks / qpcFrequency * 1000000 + waitTicks % qpcFrequency * 1000000 / qpcFrequency);
+    if(sample.processId == 0)
+        unknownProcess.fetch_add(1, std::memory_order_relaxed);
+
+    //Counted before the push, so the aggregator never looks drained while a sample is on its way
+    matchedSamples.fetch_add(1, std::memory_order_release);
+    sampleRing.Push(sample);
+}
+
+void CTMReadyLatencyTracker::RestartMatchingIfAsked()
+{
+    //Only this thread touches the pending slots, so clearing them is left to it
+    std::uint32_t generation = enableGeneration.load(std::memory_order_acquire);
+    if(generation == matchingGeneration)
+        return;
+
+    std::fill(pendingSlots.get(), pendingSlots.get() + pendingSlotCount, CTMPendingReady{});
+    matchingGeneration = generation;
+}
+
+void CTMReadyLatencyTracker::AddSample(const CTMReadyLatencySample& sample)
+{
+    //Processes first, a thread whose process we don't know only counts towards the system wide numbers
+    if(sample.processId == 0)
+    {
+        retiredLatency.Record(sample.latencyMicros);
+        return;
+    }
+
+    CTMReadyLatencyEntry* process = nullptr;
+    if(FindOrInsertEntry(processTable, sample.processId, &retiredLatency, process))
+        ++evictedProcesses;
+    process->latency.Record(sample.latencyMicros);
+    process->lastSeen = sample.timestamp;
+
+    //Already in its process, so an evicted thread takes nothing with it
+    CTMReadyLatencyEntry* thread = nullptr;
+    if(FindOrInsertEntry(threadTable, sample.threadId, nullptr, thread))
+        ++evictedThreads;
+    //Thread id went to another process, the old thread is gone
+    if(thread->processId != sample.processId)
+    {
+        thread->latency.Clear();
+        thread->processId = sample.processId;
+    }
+    thread->latency.Record(sample.latencyMicros);
+    thread->lastSeen = sample.timestamp;
+}
@@ -0,0 +1,186 @@
+#ifndef CTM_READY_LATENCY_TRACKER_HPP
+#define CTM_READY_LATENCY_TRACKER_HPP
+
+//Windows stuff
+#include <windows.h>
+//My stuff
+#include "ctm_cpu_timeline.h"
+#include "../CTMPureHeaderFiles/ctm_latency_histogram.h"
+#include "../CTMPureHeaderFiles/ctm_spsc_ring.h"
+//Stdlib stuff
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <cstdint>
+
+//A thread's wait from ready to running, as the event thread hands it to the aggregator
+struct CTMReadyLatencySample
+{
+    //Perfect 8 byte alignment
+    ULONGLONG     timestamp     = 0; //QPC ticks, when the thread got the core
+    DWORD         threadId      = 0;
+    DWORD         processId     = 0; //0 -> never saw the thread start, it only counts towards the system wide numbers
+    std::uint32_t latencyMicros = 0;
+};
+
+//One thread of a process, for the drill down
+struct CTMThreadReadyLatency
+{
+    CTMLatencySummary latency;
+    DWORD             threadId = 0;
+};
+
+//Matching health, everything is cumulative
+struct CTMReadyLatencyStats
+{
+    std::uint64_t readyEvents       = 0; //Threads made ready (ReadyThread) or preempted while still wanting to run
+    std::uint64_t matched           = 0; //Switches which found their ready, each one is a latency sample
+    std::uint64_t unmatchedSwitches = 0; //Switches to a thread we never saw become ready (its ready may still show up late)
+    std::uint64_t overwritten       = 0; //Waiting threads pushed out of a full probe, their switch finds nothing
+    std::uint64_t tooLong           = 0; //Waits longer than 'maxWaitSeconds', a lost switch most likely, thrown away
+    std::uint64_t ringDrops         = 0; //Samples the aggregator didn't pick up in time
+    std::uint64_t unknownProcess    = 0; //Samples of threads we don't know the process of
+    std::uint64_t evictedThreads    = 0; //Quietest thread pushed out of the thread table (its samples stay in its process)
+    std::uint64_t evictedProcesses  = 0; //Quietest process pushed out of the process table (its samples stay in the system wide numbers)
+    std::size_t   threadCount       = 0;
+    std::size_t   processCount      = 0;
+    std::size_t   memoryUsage       = 0; //Bytes, fixed at construction
+};
+
+/*
+ * How long threads wait in the ready queue before they get a core, per thread and per process.
+ * A thread becomes ready when something wakes it up (ReadyThread) or when it gets preempted (CSwitch with the old thread still 'Ready'),
+ * it stops waiting on the CSwitch which switches to it. Low CPU with long waits is a process starved of CPU, not an idle one.
+ * Matching happens on the event thread in a small fixed table keyed by thread id: no locks, no allocations, a bounded probe per event.
+ * Events of different cores can arrive out of order, so a switch which finds no ready leaves a mark and a ready arriving late is matched against it.
+ * A full probe pushes out its oldest entry, so a lost switch can't hold a slot forever (and waits longer than 'maxWaitSeconds' are thrown away).
+ * Matched waits go through an SPSC ring to the aggregator thread (check ctm_usage_event_pipeline.h), which folds them into histograms-
+ * -per thread and per process. Both tables are fixed size, the quietest entry makes room, a process' samples go to the retired histogram-
+ * -when it leaves so the system wide numbers (every histogram merged) never lose one. The event thread never takes the lock,-
+ * -only the histograms are behind it ('AggregateSamples' once per ring batch, the UI for its summaries).
+ */
+class CTMReadyLatencyTracker
+{
+public:
+    CTMReadyLatencyTracker(std::size_t = 512, std::size_t = 256, double = 10.0);
+    ~CTMReadyLatencyTracker() = default;
+
+    //No need for copy or move operations
+    CTMReadyLatencyTracker(const CTMReadyLatencyTracker&)            = delete;
+    CTMReadyLatencyTracker& operator=(const CTMReadyLatencyTracker&) = delete;
+    CTMReadyLatencyTracker(CTMReadyLatencyTracker&&)                 = delete;
+    CTMReadyLatencyTracker& operator=(CTMReadyLatencyTracker&&)      = delete;
+
+public: //Writer functions (the event source's thread, one at a time)
+    //'threadId' became ready to run at 'timestamp' (QPC ticks). Ignored while disabled
+    void RecordReady(ULONGLONG, DWORD);
+    //A core switched to 'threadId' at 'timestamp', ends its wait
+    void RecordSwitchIn(ULONGLONG, DWORD);
+    //True if the next sample would be dropped, for sources which would rather wait (benchmarks)
+    bool IsRingFull() const { return sampleRing.GetSize() >= sampleRing.GetCapacity(); }
+
+public: //Main functions
+    //By whoever enables the events. Enabling again starts the matching over, whatever waited back then is long gone
+    void SetEnabled(bool);
+    //Aggregator thread, folds whatever the ring has. Returns how many samples it took
+    std::size_t AggregateSamples();
+    //True once every sample matched so far was either folded in or dropped
+    bool IsDrained() const;
+    //False if the process has no samples
+    bool GetProcessSummary(DWORD, CTMLatencySummary&) const;
+    //Histograms of these processes merged (a process group), false if none of them has samples
+    bool GetMergedSummary(const DWORD*, std::size_t, CTMLatencySummary&) const;
+    //Every process merged, including the ones which were evicted or exited
+    void GetSystemSummary(CTMLatencySummary&) const;
+    //Threads of the process with the longest p99 first, atmost 'maxCount'
+    void CollectProcessThreads(DWORD, std::vector<CTMThreadReadyLatency>&, std::size_t) const;
+    CTMReadyLatencyStats GetStats() const;
+    //Process exited, its samples go to the retired histogram and its threads are forgotten
+    void RemoveProcess(DWORD);
+    void Clear();
+
+public: //Getter functions
+    bool IsEnabled() const { return isEnabled.load(std::memory_order_relaxed); }
+
+private: //Helper functions
+    struct CTMReadyLatencyEntry
+    {
+        CTMLatencyHistogram latency;
+        ULONGLONG           lastSeen  = 0; //QPC ticks of its last sample, the oldest one goes when the table is full
+        DWORD               id        = 0; //Thread or process id
+        DWORD               processId = 0; //Threads only
+        bool                isUsed    = false;
+    };
+
+    //Open addressing by id with linear probing and backward shift deletion (same as the file latency tracker's process table)
+    struct CTMReadyLatencyTable
+    {
+        std::unique_ptr<CTMReadyLatencyEntry[]> slots;
+        std::size_t slotCount  = 0;
+        std::size_t slotMask   = 0;
+        std::size_t maxEntries = 0;
+        std::size_t entryCount = 0;
+    };
+
+    //Waiting thread (or a switch whose ready hasn't shown up yet), only the event thread touches these
+    struct CTMPendingReady
+    {
+        //Perfect 8 byte alignment
+        ULONGLONG timestamp = 0; //QPC ticks
+        DWORD     threadId  = 0; //0 -> free
+        bool      hasRun    = false; //True -> switched in at 'timestamp' without a ready before it
+    };
+
+    static std::uint32_t        HashKey(DWORD);
+    static void                 InitTable(CTMReadyLatencyTable&, std::size_t);
+    static CTMReadyLatencyEntry* FindEntry(const CTMReadyLatencyTable&, DWORD);
+    //Evicts the quietest entry if the table is full, merging its histogram into 'retired' if given. Returns true if it had to
+    static bool                 FindOrInsertEntry(CTMReadyLatencyTable&, DWORD, CTMLatencyHistogram*, CTMReadyLatencyEntry*&);
+    static void                 EraseEntrySlot(CTMReadyLatencyTable&, std::size_t);
+    CTMPendingReady*            FindPending(DWORD);
+    CTMPendingReady&            ClaimPending(DWORD, bool);
+    void                        PublishSample(ULONGLONG, ULONGLONG, DWORD);
+    void                        RestartMatchingIfAsked();
+    void                        AddSample(const CTMReadyLatencySample&);
+
+private: //Matching, event thread only (except the counters)
+    std::unique_ptr<CTMPendingReady[]> pendingSlots;
+    std::atomic<bool>                  isEnabled           = false;
+    std::atomic<std::uint32_t>         enableGeneration    = 0; //Bumped on every enable, the writer clears the table when it sees a new one
+    std::uint32_t                      matchingGeneration  = 0;
+    ULONGLONG                          maxWaitTicks        = 0;
+    ULONGLONG                          qpcFrequency        = 1;
+    std::atomic<std::uint64_t>         readyEvents         = 0;
+    std::atomic<std::uint64_t>         matchedSamples      = 0;
+    std::atomic<std::uint64_t>         unmatchedSwitches   = 0;
+    std::atomic<std::uint64_t>         overwrittenWaits    = 0;
+    std::atomic<std::uint64_t>         tooLongWaits        = 0;
+    std::atomic<std::uint64_t>         unknownProcess      = 0;
+    //Threads ready at the same time are a few hundred on a busy machine, 64 KB
+    constexpr static std::size_t       pendingSlotCount    = 1 << 12;
+    //Two cache lines of slots, the whole probe is looked at every time (a freed slot doesn't end it)
+    constexpr static std::size_t       maxPendingProbe     = 8;
+
+private: //Event thread -> aggregator thread
+    CTMSpscRing<CTMReadyLatencySample>       sampleRing{sampleRingCapacity};
+    std::unique_ptr<CTMReadyLatencySample[]> aggregateBatch;
+    std::atomic<std::uint64_t>               aggregatedSamples = 0;
+    //~400 KB, a third of a second at 50k switches/s (the aggregator looks every millisecond)
+    constexpr static std::size_t             sampleRingCapacity = 1 << 14;
+    constexpr static std::size_t             aggregateBatchSize = 1024;
+
+private: //Histograms, aggregator thread writes and the UI reads
+    CTMReadyLatencyTable threadTable;
+    CTMReadyLatencyTable processTable;
+    CTMLatencyHistogram  retiredLatency; //Evicted and exited processes, and threads of unknown processes, merged
+    std::uint64_t        evictedThreads   = 0;
+    std::uint64_t        evictedProcesses = 0;
+    mutable std::mutex   trackerMutex;
+};
+
+//Written by whichever event source has the ready thread provider enabled, read by the process screen
+extern CTMReadyLatencyTracker globalReadyLatencyTracker;
+
+#endif
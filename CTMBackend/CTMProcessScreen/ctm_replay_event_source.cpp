@@ -0,0 +1,98 @@
+#include "ctm_replay_event_source.h"
+
+//Don't really want these macros, they are messing up the std::max and std::min functions
+#undef max
+#undef min
+
+CTMReplayEventSource::CTMReplayEventSource(const std::wstring& filePath, double speed, bool waitForRoom)
+    : recordingPath(filePath), replaySpeed(speed), shouldWaitForRoom(waitForRoom) {}
+
+//--------------------MAIN FUNCTIONS--------------------
+bool CTMReplayEventSource::Start()
+{
+    recordingFile.open(std::filesystem::path(recordingPath), std::ios::binary);
+    if(!recordingFile)
+    {
+        CTM_LOG_ERROR("Failed to open the recording file for replay.");
+        return false;
+    }
+
+    CTMRecordingHeader expectedHeader;
+    recordingFile.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if(!recordingFile || std::memcmp(header.magic, expectedHeader.magic, sizeof(header.magic)) != 0 || header.timestampFrequency == 0)
+    {
+        CTM_LOG_ERROR("The replay file is not a recording (or it was made by an incompatible version).");
+        recordingFile.close();
+        return false;
+    }
+
+    isRunning.store(true);
+    CTM_LOG_INFO("Replaying ", header.eventCount, " recorded events at ", replaySpeed, "x speed (0 means unthrottled).");
+    return true;
+}
+
+bool CTMReplayEventSource::ProcessEvents()
+{
+    if(!recordingFile.is_open())
+        return false;
+
+    auto batch     = std::make_unique<CTMRecordedEvent[]>(readBatchSize);
+    auto startTime = std::chrono::steady_clock::now();
+    LARGE_INTEGER qpcStart, qpcFrequency;
+    QueryPerformanceCounter(&qpcStart);
+    QueryPerformanceFrequency(&qpcFrequency);
+
+    while(isRunning.load(std::memory_order_relaxed) && replayedCount < header.eventCount)
+    {
+        std::size_t batchSize = static_cast<std::size_t>(std::min<std::uint64_t>(readBatchSize, header.eventCount - replayedCount));
+        recordingFile.read(reinterpret_cast<char*>(batch.get()), static_cast<std::streamsize>(batchSize * sizeof(CTMRecordedEvent)));
+
+        //Cut short, play what made it and call it done
+        std::size_t readCount = static_cast<std::size_t>(recordingFile.gcount()) / sizeof(CTMRecordedEvent);
+        if(readCount == 0)
+            break;
+
+        if(replayedCount == 0)
+            firstTimestamp = batch[0].timestamp;
+
+        for(std::size_t i = 0; i < readCount && isRunning.load(std::memory_order_relaxed); i++)
+        {
+            //Checking the clock every event would cost more than the event, every 64th keeps the spacing close enough
+            if(replaySpeed > 0.0 && i % 64 == 0)
+                WaitForRecordedTime(batch[i].timestamp, startTime);
+
+            //Recorded spacing, not replay speed, so file latencies come out as recorded (at other speeds timestamps drift from the wall clock)
+            ULONGLONG recordedTicks = batch[i].timestamp > firstTimestamp ? batch[i].timestamp - firstTimestamp : 0;
+            ULONGLONG timestamp     = ConvertRecordedTime(recordedTicks, header.timestampFrequency, qpcStart.QuadPart, qpcFrequency.QuadPart);
+            if(!DecodeAndPublish(batch[i], timestamp, shouldWaitForRoom))
+                ++malformedCount;
+            ++replayedCount;
+        }
+
+        if(readCount < batchSize)
+            break;
+    }
+
+    if(malformedCount > 0)
+        CTM_LOG_WARNING("Skipped ", malformedCount, " malformed records while replaying.");
+    return true;
+}
+
+void CTMReplayEventSource::Stop()
+{
+    isRunning.store(false);
+}
+
+//--------------------HELPER FUNCTIONS--------------------
+void CTMReplayEventSource::WaitForRecordedTime(ULONGLONG timestamp, std::chrono::steady_clock::time_point startTime)
+{
+    //Recordings aren't guaranteed to be sorted, anything earlier than the first event just goes right away
+    if(timestamp <= firstTimestamp)
+        return;
+
+    double recordedSeconds = static_cast<double>(timestamp - firstTimestamp) / header.timestampFrequency / replaySpeed;
+    auto   dueTime         = startTime + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(recordedSeconds));
+    //Short sleeps in a loop so 'Stop' doesn't have to wait out a long gap in the recording
+    while(isRunning.load(std::memory_order_relaxed) && std::chrono::steady_clock::now() < dueTime)
+        std::this_thread::sleep_until(std::min(dueTime, std::chrono::steady_clock::now() + std::chrono::milliseconds(50)));
+}
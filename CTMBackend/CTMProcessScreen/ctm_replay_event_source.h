@@ -0,0 +1,58 @@
+#ifndef CTM_REPLAY_EVENT_SOURCE_HPP
+#define CTM_REPLAY_EVENT_SOURCE_HPP
+
+//Windows stuff
+#include <windows.h>
+//My stuff
+#include "ctm_event_source.h"
+//Stdlib stuff
+#include <string>
+#include <memory>
+#include <algorithm>
+#include <fstream>
+#include <filesystem>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <cstring>
+#include <cstdint>
+
+/*
+ * Plays a recording (check 'CTMRecordingHeader' in ctm_event_source.h) back through the same decode and publish path as the synthetic source.
+ * Events keep their recorded spacing, scaled by the speed (2.0 is twice as fast, 0 is as fast as the pipeline takes them).
+ * Timestamps are replaced with QPC at publish time, the UI compares them with the current time.
+ * Streams the file in chunks, recordings can be way bigger than what we'd want in memory.
+ */
+class CTMReplayEventSource : public CTMEventSource
+{
+public:
+    CTMReplayEventSource(const std::wstring&, double = 1.0, bool = false);
+    ~CTMReplayEventSource() override = default;
+
+public: //Main functions
+    bool        Start()         override;
+    bool        ProcessEvents() override;
+    void        Stop()          override;
+    const char* GetName() const override { return "Replay"; }
+
+public: //Getter functions
+    std::uint64_t GetEventCount()    const { return header.eventCount; }
+    std::uint64_t GetReplayedCount() const { return replayedCount; }
+
+private: //Helper functions
+    void WaitForRecordedTime(ULONGLONG, std::chrono::steady_clock::time_point);
+
+private: //Replay stuff
+    std::wstring       recordingPath;
+    std::ifstream      recordingFile;
+    CTMRecordingHeader header;
+    ULONGLONG          firstTimestamp    = 0;
+    std::uint64_t      replayedCount     = 0;
+    std::uint64_t      malformedCount    = 0; //Records which failed to decode, skipped
+    double             replaySpeed       = 1.0;
+    bool               shouldWaitForRoom = false;
+    std::atomic<bool>  isRunning         = false;
+    constexpr static std::size_t readBatchSize = 4096;
+};
+
+#endif
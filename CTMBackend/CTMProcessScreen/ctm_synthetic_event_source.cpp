@@ -0,0 +1,501 @@
+#include "ctm_synthetic_event_source.h"
+
+//Don't really want these macros, they are messing up the std::max and std::min functions
+#undef max
+#undef min
+
+//Busiest first, the Zipf over them follows this order
+const CTMSyntheticDriver CTMSyntheticEventSource::syntheticDrivers[12] = {
+    {"ntoskrnl.exe",  8.0, 0.0, 0.0},
+    {"ndis.sys",     15.0, 0.3, 0.0},
+    {"tcpip.sys",    12.0, 0.0, 0.0},
+    {"storport.sys", 10.0, 0.4, 0.0},
+    {"dxgkrnl.sys",  20.0, 0.2, 0.002},
+    {"USBXHCI.SYS",   6.0, 0.5, 0.0},
+    {"HDAudBus.sys",  5.0, 0.5, 0.0},
+    {"Wdf01000.sys",  4.0, 0.0, 0.0},
+    {"ACPI.sys",      3.0, 0.3, 0.0},
+    {"stornvme.sys",  9.0, 0.4, 0.0},
+    {"netwlan.sys",  25.0, 0.3, 0.02}, //The one the threshold is there for
+    {"i8042prt.sys",  2.0, 0.5, 0.0},
+};
+
+CTMSyntheticEventSource::CTMSyntheticEventSource(const CTMSyntheticEventOptions& syntheticOptions, bool waitForRoom)
+    : options(syntheticOptions), shouldWaitForRoom(waitForRoom)
+{
+    options.processCount      = std::max<std::uint32_t>(options.processCount, 1);
+    options.flowsPerProcess   = std::max<std::uint32_t>(options.flowsPerProcess, 1);
+    options.fileCount         = std::max<std::uint32_t>(options.fileCount, 1);
+    options.threadsPerProcess = std::max<std::uint32_t>(options.threadsPerProcess, 1);
+    //Known up front so a generator which never enables anything (the benchmark's regenerated stream) picks the same cores
+    switchCoreCount           = std::max<std::uint32_t>(options.coreCount > 0 ? options.coreCount : GetActiveProcessorCount(ALL_PROCESSOR_GROUPS), 1);
+    dpcCoreCount              = switchCoreCount;
+
+    //xorshift gets stuck on 0, splitmix the seed so nearby seeds don't give nearby streams either
+    randomState = options.seed + 0x9E3779B97F4A7C15ull;
+    randomState = (randomState ^ (randomState >> 30)) * 0xBF58476D1CE4E5B9ull;
+    randomState = (randomState ^ (randomState >> 27)) * 0x94D049BB133111EBull;
+    randomState = (randomState ^ (randomState >> 31)) | 1;
+    //Context switches get a stream of their own, whatever it is, it just has to not be the same one
+    switchRandomState = (randomState * 0xD6E8FEB86659FD93ull) | 1;
+    dpcRandomState    = (randomState * 0x9FB21C651E98DF25ull) | 1;
+
+    BuildZipfCdf(processCdf, options.processCount, options.processSkew);
+    BuildZipfCdf(fileCdf, options.fileCount, options.fileSkew);
+    BuildZipfCdf(driverCdf, static_cast<std::uint32_t>(std::size(syntheticDrivers)), driverSkew);
+
+    //A mix of all zeros would never pick anything, treat it as an even one
+    double totalWeight = 0.0;
+    counterCdf.resize(static_cast<std::size_t>(CTMUsageCounter::Count));
+    for(std::size_t i = 0; i < counterCdf.size(); i++)
+    {
+        totalWeight  += options.mixWeights[i] > 0.0 ? options.mixWeights[i] : 0.0;
+        counterCdf[i] = totalWeight;
+    }
+    for(std::size_t i = 0; i < counterCdf.size(); i++)
+        counterCdf[i] = totalWeight > 0.0 ? counterCdf[i] / totalWeight : static_cast<double>(i + 1) / counterCdf.size();
+}
+
+//--------------------MAIN FUNCTIONS--------------------
+bool CTMSyntheticEventSource::Start()
+{
+    isRunning.store(true);
+
+    //There are no name events to carry them, so the made up files get their names up front
+    wchar_t fileName[64];
+    for(std::uint32_t i = 0; i < options.fileCount; i++)
+    {
+        std::swprintf(fileName, sizeof(fileName) / sizeof(wchar_t), L"\\Device\\HarddiskVolume1\\CTMSynthetic\\file_%05u.dat", i);
+        globalFileUsageTracker.SetFileName(GetFileKey(i), fileName);
+    }
+
+    CTM_LOG_INFO("Synthetic event source: ", options.processCount, " processes, ", options.flowsPerProcess, " flows each, ",
+                 options.fileCount, " files, ", options.eventsPerSecond, " events/s (0 means unthrottled).");
+    return true;
+}
+
+bool CTMSyntheticEventSource::ProcessEvents()
+{
+    CTMRecordedEvent batch[generateBatchSize];
+    LARGE_INTEGER    qpcStart, qpcFrequency;
+    auto             startTime = std::chrono::steady_clock::now();
+    QueryPerformanceCounter(&qpcStart);
+    QueryPerformanceFrequency(&qpcFrequency);
+
+    while(isRunning.load(std::memory_order_relaxed))
+    {
+        std::size_t batchSize = generateBatchSize;
+        if(options.maxEvents > 0)
+        {
+            if(generatedCount >= options.maxEvents)
+                break;
+            batchSize = static_cast<std::size_t>(std::min<std::uint64_t>(batchSize, options.maxEvents - generatedCount));
+        }
+
+        Generate(batch, batchSize);
+
+        //Generated time mapped onto QPC, so a start and its completion are as far apart as they were generated (unthrottled runs drift from the wall clock)
+        for(std::size_t i = 0; i < batchSize; i++)
+            DecodeAndPublish(batch[i], ConvertRecordedTime(batch[i].timestamp, timestampFrequency, qpcStart.QuadPart, qpcFrequency.QuadPart), shouldWaitForRoom);
+
+        //Switches up to where the batch ended, on the same clock. Disabled -> the next enable starts from wherever the events are by then
+        if(isContextSwitchEnabled.load(std::memory_order_acquire) || isReadyThreadEnabled.load(std::memory_order_acquire))
+            GenerateContextSwitches(batch[batchSize - 1].timestamp, qpcStart.QuadPart, qpcFrequency.QuadPart);
+        else
+            nextSwitchTimestamp = 0;
+        if(isDpcEnabled.load(std::memory_order_acquire))
+            GenerateDpcs(batch[batchSize - 1].timestamp, qpcStart.QuadPart, qpcFrequency.QuadPart);
+        else
+            nextDpcTimestamp = 0;
+
+        //Ahead of schedule, sleep it off (in ms steps, the rate only has to hold on average)
+        if(options.eventsPerSecond > 0.0)
+        {
+            auto dueTime = startTime + std::chrono::duration<double>(generatedCount / options.eventsPerSecond);
+            if(dueTime - std::chrono::steady_clock::now() > std::chrono::milliseconds(1))
+                std::this_thread::sleep_until(std::chrono::time_point_cast<std::chrono::steady_clock::duration>(dueTime));
+        }
+    }
+
+    return true;
+}
+
+void CTMSyntheticEventSource::Stop()
+{
+    isRunning.store(false);
+}
+
+bool CTMSyntheticEventSource::SetProviderEnabled(CTMEventProvider provider, bool shouldEnable)
+{
+    //Needs nothing but the tracker, which gets the made up drivers like the file names get their names
+    if(provider == CTMEventProvider::KernelDpc)
+    {
+        if(shouldEnable)
+            globalDpcLatencyTracker.SetDrivers(GetSyntheticDrivers());
+        globalDpcLatencyTracker.SetEnabled(shouldEnable);
+        isDpcEnabled.store(shouldEnable, std::memory_order_release);
+        if(shouldEnable)
+            CTM_LOG_INFO("Synthetic event source: ", options.dpcsPerSecond, " DPCs/ISRs per second over ", dpcCoreCount, " cores.");
+        return true;
+    }
+
+    //Network and file events are generated no matter what, like before there were providers
+    if(provider != CTMEventProvider::KernelContextSwitch && provider != CTMEventProvider::KernelReadyThread)
+        return true;
+
+    std::atomic<bool>& isEnabled = provider == CTMEventProvider::KernelContextSwitch ? isContextSwitchEnabled : isReadyThreadEnabled;
+    if(!shouldEnable)
+    {
+        isEnabled.store(false, std::memory_order_release);
+        if(provider == CTMEventProvider::KernelReadyThread)
+            globalReadyLatencyTracker.SetEnabled(false);
+        return true;
+    }
+
+    //The ready latencies find the process of a thread through the timeline, so they need it as much as the CPU screen does
+    if(!globalCpuTimeline.Allocate(switchCoreCount))
+    {
+        CTM_LOG_ERROR("Failed to allocate the CPU timeline for context switch tracing.");
+        return false;
+    }
+
+    //There are no thread start events, so every made up thread gets its process up front (like the file names)
+    for(std::uint32_t processIndex = 0; processIndex < options.processCount; processIndex++)
+        for(std::uint32_t threadIndex = 0; threadIndex < options.threadsPerProcess; threadIndex++)
+            globalCpuTimeline.SetThreadProcess(GetThreadId(processIndex, threadIndex, options.threadsPerProcess), firstProcessId + processIndex * 4);
+
+    //Allocated once, so it may have fewer cores than asked for (switches on the others would be thrown away anyway).
+    //Only ever goes down, once. The generator may still be reading it from the last time it was enabled
+    if(switchCoreCount > globalCpuTimeline.GetCoreCount())
+        switchCoreCount = globalCpuTimeline.GetCoreCount();
+    if(provider == CTMEventProvider::KernelReadyThread)
+        globalReadyLatencyTracker.SetEnabled(true);
+    isEnabled.store(true, std::memory_order_release);
+
+    CTM_LOG_INFO("Synthetic event source: ", options.contextSwitchesPerSecond, " context switches/s over ", switchCoreCount, " cores",
+                 provider == CTMEventProvider::KernelReadyThread ? ", with a ready before every one of them." : ".");
+    return true;
+}
+
+//--------------------GENERATOR--------------------
+void CTMSyntheticEventSource::Generate(CTMRecordedEvent* outEvents, std::size_t count)
+{
+    //Unthrottled still gets timestamps, as if it ran at a million events per second
+    double ticksPerEvent = timestampFrequency / (options.eventsPerSecond > 0.0 ? options.eventsPerSecond : 1000000.0);
+    auto   isDueLater    = [](const CTMSyntheticCompletion& left, const CTMSyntheticCompletion& right){ return left.dueTimestamp > right.dueTimestamp; };
+
+    for(std::size_t i = 0; i < count; i++)
+    {
+        CTMRecordedEvent& recordedEvent = outEvents[i];
+        recordedEvent = CTMRecordedEvent{};
+
+        ULONGLONG timestamp = static_cast<ULONGLONG>(generatedCount * ticksPerEvent);
+        ++generatedCount;
+
+        //A due completion takes this slot, stamped when it was due so it never comes before anything it was due after
+        if(!pendingCompletions.empty() && pendingCompletions.front().dueTimestamp <= timestamp)
+        {
+            std::pop_heap(pendingCompletions.begin(), pendingCompletions.end(), isDueLater);
+            CTMSyntheticCompletion completion = pendingCompletions.back();
+            pendingCompletions.pop_back();
+
+            EncodeFileOperationEnd(recordedEvent, completion.irp);
+            recordedEvent.timestamp = completion.dueTimestamp;
+            continue;
+        }
+
+        std::uint32_t   processIndex = static_cast<std::uint32_t>(PickFromCdf(processCdf));
+        CTMUsageCounter counter      = static_cast<CTMUsageCounter>(PickFromCdf(counterCdf));
+        DWORD           processId    = firstProcessId + processIndex * 4;
+
+        if(counter == CTMUsageCounter::FileRead || counter == CTMUsageCounter::FileWrite)
+        {
+            //4 KB to 256 KB, in pages
+            std::uint32_t fileIndex = static_cast<std::uint32_t>(PickFromCdf(fileCdf));
+            std::uint32_t ioSize    = static_cast<std::uint32_t>(4096 * (1 + NextRandom() % 64));
+            ULONGLONG     irp       = firstIrp + (irpCount++) * 0x10;
+            EncodeFileEvent(recordedEvent, counter, processId, GetFileKey(fileIndex), ioSize, irp);
+
+            pendingCompletions.push_back(CTMSyntheticCompletion{timestamp + NextLatencyTicks(), irp});
+            std::push_heap(pendingCompletions.begin(), pendingCompletions.end(), isDueLater);
+        }
+        else
+        {
+            CTMNetworkFlowKey key;
+            BuildFlowKey(processIndex, static_cast<std::uint32_t>(NextRandom() % options.flowsPerProcess), counter, key);
+            //Somewhere between an ACK and a full Ethernet frame
+            std::uint32_t packetSize = static_cast<std::uint32_t>(40 + NextRandom() % 1461);
+            EncodeNetworkEvent(recordedEvent, counter, key, packetSize);
+        }
+
+        recordedEvent.timestamp = timestamp;
+    }
+}
+
+bool CTMSyntheticEventSource::WriteRecording(const std::wstring& filePath, std::uint64_t eventCount)
+{
+    std::ofstream recordingFile(std::filesystem::path(filePath), std::ios::binary | std::ios::trunc);
+    if(!recordingFile)
+    {
+        CTM_LOG_ERROR("Failed to create the recording file.");
+        return false;
+    }
+
+    CTMRecordingHeader header;
+    header.timestampFrequency = timestampFrequency;
+    header.eventCount         = eventCount;
+    recordingFile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    CTMRecordedEvent batch[generateBatchSize];
+    for(std::uint64_t written = 0; written < eventCount; )
+    {
+        std::size_t batchSize = static_cast<std::size_t>(std::min<std::uint64_t>(generateBatchSize, eventCount - written));
+        Generate(batch, batchSize);
+        recordingFile.write(reinterpret_cast<const char*>(batch), static_cast<std::streamsize>(batchSize * sizeof(CTMRecordedEvent)));
+        written += batchSize;
+    }
+
+    if(!recordingFile)
+    {
+        CTM_LOG_ERROR("Failed to write the recording file.");
+        return false;
+    }
+
+    CTM_LOG_SUCCESS("Wrote ", eventCount, " synthetic events to the recording file.");
+    return true;
+}
+
+void CTMSyntheticEventSource::GenerateContextSwitch(ULONGLONG timestamp, CTMSyntheticContextSwitch& outSwitch)
+{
+    outSwitch             = CTMSyntheticContextSwitch{};
+    outSwitch.timestamp   = timestamp;
+    outSwitch.core        = static_cast<std::uint32_t>(NextSwitchRandom() % switchCoreCount);
+    ++contextSwitchCount;
+    if(NextSwitchUnit() < idleShare)
+        return;
+
+    //Same Zipf as the events, the busy processes are the ones on the cores too
+    std::size_t   processIndex = std::min<std::size_t>(std::upper_bound(processCdf.begin(), processCdf.end(), NextSwitchUnit()) - processCdf.begin(),
+                                                       processCdf.size() - 1);
+    std::uint32_t threadIndex  = static_cast<std::uint32_t>(NextSwitchRandom() % options.threadsPerProcess);
+    outSwitch.threadId    = GetThreadId(static_cast<std::uint32_t>(processIndex), threadIndex, options.threadsPerProcess);
+    outSwitch.processId   = firstProcessId + static_cast<DWORD>(processIndex) * 4;
+    outSwitch.waitTicks   = NextReadyWaitTicks(static_cast<std::uint32_t>(processIndex));
+    outSwitch.isReadyLate = NextSwitchRandom() % lateReadyShare == 0;
+}
+
+void CTMSyntheticEventSource::GenerateDpc(ULONGLONG timestamp, CTMSyntheticDpc& outDpc)
+{
+    outDpc             = CTMSyntheticDpc{};
+    outDpc.timestamp   = timestamp;
+    outDpc.core        = static_cast<std::uint32_t>(NextDpcRandom() % dpcCoreCount);
+    outDpc.driverIndex = static_cast<std::uint32_t>(std::min<std::size_t>(std::upper_bound(driverCdf.begin(), driverCdf.end(), NextDpcUnit()) - driverCdf.begin(),
+                                                                          driverCdf.size() - 1));
+    ++dpcCount;
+
+    //Every driver has a few routines, a DPC of a driver is never an ISR of it too
+    const CTMSyntheticDriver& driver = syntheticDrivers[outDpc.driverIndex];
+    outDpc.kind    = NextDpcUnit() < driver.isrShare ? CTMDpcKind::Isr : CTMDpcKind::Dpc;
+    outDpc.routine = firstDriverBase + outDpc.driverIndex * driverBaseStride + 0x1000 + (NextDpcRandom() % 4) * 0x1040 +
+                     (outDpc.kind == CTMDpcKind::Isr ? 0x8000 : 0);
+
+    //Whole microseconds, so the exact durations are exact on any QPC frequency (give or take the rounding of both ends)
+    double meanMicros     = NextDpcUnit() < driver.longShare ? longRunMicros : driver.meanMicros;
+    double durationMicros = -std::log(1.0 - NextDpcUnit()) * meanMicros;
+    outDpc.durationMicros = static_cast<std::uint32_t>(std::clamp(durationMicros, 1.0, static_cast<double>(maxRunMicros)));
+}
+
+std::vector<CTMDriverModule> CTMSyntheticEventSource::GetSyntheticDrivers()
+{
+    std::vector<CTMDriverModule> drivers(std::size(syntheticDrivers));
+    for(std::size_t i = 0; i < drivers.size(); i++)
+    {
+        drivers[i].baseAddress = firstDriverBase + i * driverBaseStride;
+        drivers[i].name        = syntheticDrivers[i].name;
+    }
+    return drivers;
+}
+
+//--------------------HELPER FUNCTIONS--------------------
+void CTMSyntheticEventSource::GenerateContextSwitches(ULONGLONG untilTimestamp, ULONGLONG qpcStart, ULONGLONG qpcFrequency)
+{
+    if(options.contextSwitchesPerSecond <= 0.0 || switchCoreCount == 0)
+        return;
+
+    //Just enabled, start where the events are instead of catching up from 0. Far enough in that no ready goes before the clock's start
+    double ticksPerSwitch = timestampFrequency / options.contextSwitchesPerSecond;
+    if(nextSwitchTimestamp == 0)
+        nextSwitchTimestamp = untilTimestamp + maxReadyWaitTicks;
+
+    CTMSyntheticContextSwitch contextSwitch;
+    for(; nextSwitchTimestamp <= untilTimestamp; nextSwitchTimestamp += std::max<ULONGLONG>(1, static_cast<ULONGLONG>(ticksPerSwitch)))
+    {
+        GenerateContextSwitch(nextSwitchTimestamp, contextSwitch);
+        ULONGLONG switchTime = ConvertRecordedTime(contextSwitch.timestamp, timestampFrequency, qpcStart, qpcFrequency);
+        globalCpuTimeline.RecordSwitch(contextSwitch.core, switchTime, contextSwitch.threadId);
+        if(contextSwitch.threadId == 0)
+            continue;
+
+        //The tracker ignores both while the ready thread provider is disabled. A benchmark would rather wait than have its known waits dropped
+        if(shouldWaitForRoom)
+            while(globalReadyLatencyTracker.IsRingFull() && globalUsageEventPipeline.IsAggregatorRunning())
+                std::this_thread::yield();
+
+        ULONGLONG readyTime = ConvertRecordedTime(contextSwitch.timestamp - contextSwitch.waitTicks, timestampFrequency, qpcStart, qpcFrequency);
+        if(contextSwitch.isReadyLate)
+        {
+            globalReadyLatencyTracker.RecordSwitchIn(switchTime, contextSwitch.threadId);
+            globalReadyLatencyTracker.RecordReady(readyTime, contextSwitch.threadId);
+        }
+        else
+        {
+            globalReadyLatencyTracker.RecordReady(readyTime, contextSwitch.threadId);
+            globalReadyLatencyTracker.RecordSwitchIn(switchTime, contextSwitch.threadId);
+        }
+    }
+}
+
+void CTMSyntheticEventSource::GenerateDpcs(ULONGLONG untilTimestamp, ULONGLONG qpcStart, ULONGLONG qpcFrequency)
+{
+    if(options.dpcsPerSecond <= 0.0)
+        return;
+
+    //Just enabled, start where the events are. Far enough in that no run starts before the clock's start
+    double    ticksPerDpc = timestampFrequency / options.dpcsPerSecond;
+    ULONGLONG ticksPerMicro = timestampFrequency / 1000000;
+    if(nextDpcTimestamp == 0)
+        nextDpcTimestamp = untilTimestamp + maxRunMicros * ticksPerMicro;
+
+    CTMSyntheticDpc dpc;
+    for(; nextDpcTimestamp <= untilTimestamp; nextDpcTimestamp += std::max<ULONGLONG>(1, static_cast<ULONGLONG>(ticksPerDpc)))
+    {
+        GenerateDpc(nextDpcTimestamp, dpc);
+
+        //A benchmark would rather wait than have its known durations dropped
+        if(shouldWaitForRoom)
+            while(globalDpcLatencyTracker.IsRingFull() && globalUsageEventPipeline.IsAggregatorRunning())
+                std::this_thread::yield();
+
+        ULONGLONG endTime   = ConvertRecordedTime(dpc.timestamp, timestampFrequency, qpcStart, qpcFrequency),
+                  startTime = ConvertRecordedTime(dpc.timestamp - dpc.durationMicros * ticksPerMicro, timestampFrequency, qpcStart, qpcFrequency);
+        globalDpcLatencyTracker.RecordRoutine(endTime, startTime, dpc.routine, dpc.core, dpc.kind);
+    }
+}
+
+std::uint64_t CTMSyntheticEventSource::NextDpcRandom()
+{
+    //Same xorshift64* as 'NextRandom', on its own state
+    dpcRandomState ^= dpcRandomState >> 12;
+    dpcRandomState ^= dpcRandomState << 25;
+    dpcRandomState ^= dpcRandomState >> 27;
+    return dpcRandomState * 0x2545F4914F6CDD1Dull;
+}
+
+double CTMSyntheticEventSource::NextDpcUnit()
+{
+    return static_cast<double>(NextDpcRandom() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+std::uint64_t CTMSyntheticEventSource::NextSwitchRandom()
+{
+    //Same xorshift64* as 'NextRandom', on its own state
+    switchRandomState ^= switchRandomState >> 12;
+    switchRandomState ^= switchRandomState << 25;
+    switchRandomState ^= switchRandomState >> 27;
+    return switchRandomState * 0x2545F4914F6CDD1Dull;
+}
+
+double CTMSyntheticEventSource::NextSwitchUnit()
+{
+    return static_cast<double>(NextSwitchRandom() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+std::uint64_t CTMSyntheticEventSource::NextRandom()
+{
+    //xorshift64*, plenty for picking events and fast enough to not show up in the benchmark
+    randomState ^= randomState >> 12;
+    randomState ^= randomState << 25;
+    randomState ^= randomState >> 27;
+    return randomState * 0x2545F4914F6CDD1Dull;
+}
+
+double CTMSyntheticEventSource::NextUnit()
+{
+    //Top 53 bits, [0, 1)
+    return static_cast<double>(NextRandom() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+std::size_t CTMSyntheticEventSource::PickFromCdf(const std::vector<double>& cdf)
+{
+    auto it = std::upper_bound(cdf.begin(), cdf.end(), NextUnit());
+    return std::min(static_cast<std::size_t>(it - cdf.begin()), cdf.size() - 1);
+}
+
+void CTMSyntheticEventSource::BuildZipfCdf(std::vector<double>& outCdf, std::uint32_t count, double skew)
+{
+    double totalWeight = 0.0;
+    outCdf.resize(count);
+    for(std::uint32_t i = 0; i < count; i++)
+    {
+        totalWeight += 1.0 / std::pow(static_cast<double>(i + 1), skew);
+        outCdf[i]    = totalWeight;
+    }
+    for(auto&& weight : outCdf)
+        weight /= totalWeight;
+}
+
+ULONGLONG CTMSyntheticEventSource::NextLatencyTicks()
+{
+    //Mostly cache hits (~100 us), some trips to the disk (~2 ms) and the odd one stuck behind something (~30 ms)
+    double pick        = NextUnit();
+    double meanSeconds = pick < 0.90 ? 0.0001 : (pick < 0.99 ? 0.002 : 0.03);
+    //Exponential around that mean, 1 - u so the log never sees 0
+    return static_cast<ULONGLONG>(-std::log(1.0 - NextUnit()) * meanSeconds * timestampFrequency);
+}
+
+ULONGLONG CTMSyntheticEventSource::NextReadyWaitTicks(std::uint32_t processIndex)
+{
+    //Most threads get a core within tens of microseconds, a starved process' threads sit in the queue for milliseconds
+    double    meanSeconds = processIndex % starvedProcessStride == 0 ? starvedWaitSeconds : readyWaitSeconds;
+    ULONGLONG waitTicks   = static_cast<ULONGLONG>(-std::log(1.0 - NextSwitchUnit()) * meanSeconds * timestampFrequency);
+    return std::min(waitTicks, maxReadyWaitTicks);
+}
+
+void CTMSyntheticEventSource::BuildFlowKey(std::uint32_t processIndex, std::uint32_t flowIndex, CTMUsageCounter counter, CTMNetworkFlowKey& outKey)
+{
+    //Everything about a flow follows from (process, flow, protocol), so the same flow comes back with the same endpoints
+    bool          isTcp     = counter == CTMUsageCounter::TcpSent || counter == CTMUsageCounter::TcpReceived;
+    std::uint32_t flowHash  = (processIndex * 2654435761u) ^ (flowIndex * 40503u) ^ (isTcp ? 0u : 0x5BD1E995u);
+    bool          isIpv6    = (flowHash % 1000) < static_cast<std::uint32_t>(options.ipv6Share * 1000.0);
+
+    outKey.processId     = firstProcessId + processIndex * 4;
+    outKey.protocol      = isTcp ? CTMFlowProtocol::Tcp : CTMFlowProtocol::Udp;
+    outKey.addressLength = isIpv6 ? 16 : 4;
+    outKey.localPort     = static_cast<USHORT>(49152 + (flowHash % 16384));
+    outKey.remotePort    = isTcp ? (flowIndex % 4 == 0 ? 80 : 443) : (flowIndex % 2 == 0 ? 53 : 3478);
+
+    if(isIpv6)
+    {
+        //fd00::<process>:<flow> on our side, 2001:db8::<hash> on theirs (documentation prefix)
+        outKey.localAddress[0]   = 0xFD;
+        outKey.localAddress[12]  = static_cast<BYTE>(processIndex >> 8);
+        outKey.localAddress[13]  = static_cast<BYTE>(processIndex);
+        outKey.localAddress[15]  = 1;
+        outKey.remoteAddress[0]  = 0x20;
+        outKey.remoteAddress[1]  = 0x01;
+        outKey.remoteAddress[2]  = 0x0D;
+        outKey.remoteAddress[3]  = 0xB8;
+        outKey.remoteAddress[12] = static_cast<BYTE>(flowHash >> 24);
+        outKey.remoteAddress[13] = static_cast<BYTE>(flowHash >> 16);
+        outKey.remoteAddress[14] = static_cast<BYTE>(flowHash >> 8);
+        outKey.remoteAddress[15] = static_cast<BYTE>(flowIndex);
+    }
+    else
+    {
+        //10.0.x.y on our side, 198.51.10x.y on theirs
+        const BYTE localAddress[4]  = {10, 0, static_cast<BYTE>(processIndex >> 8), static_cast<BYTE>(processIndex)};
+        const BYTE remoteAddress[4] = {198, 51, static_cast<BYTE>(100 + (flowHash % 4)), static_cast<BYTE>(1 + flowIndex % 254)};
+        std::copy(localAddress, localAddress + 4, outKey.localAddress);
+        std::copy(remoteAddress, remoteAddress + 4, outKey.remoteAddress);
+    }
+}
@@ -0,0 +1,179 @@
+#ifndef CTM_SYNTHETIC_EVENT_SOURCE_HPP
+#define CTM_SYNTHETIC_EVENT_SOURCE_HPP
+
+//Windows stuff
+#include <windows.h>
+//My stuff
+#include "ctm_event_source.h"
+//Stdlib stuff
+#include <vector>
+#include <string>
+#include <fstream>
+#include <filesystem>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+
+//Completion the generator still owes, ordered by when it is due
+struct CTMSyntheticCompletion
+{
+    ULONGLONG dueTimestamp = 0; //Generated clock ticks
+    ULONGLONG irp          = 0;
+};
+
+//One context switch of the generator, and the ready that comes with it
+struct CTMSyntheticContextSwitch
+{
+    //Perfect 8 byte alignment
+    ULONGLONG     timestamp   = 0; //Generated clock ticks, when the core switched
+    ULONGLONG     waitTicks   = 0; //Generated clock ticks the thread waited for the core, it became ready at 'timestamp - waitTicks'
+    DWORD         threadId    = 0; //0 -> idle, no ready for that one
+    DWORD         processId   = 0;
+    std::uint32_t core        = 0;
+    bool          isReadyLate = false; //The ready shows up after the switch, like a ready logged on another core whose buffer came later
+};
+
+//One DPC/ISR run of the generator
+struct CTMSyntheticDpc
+{
+    //Perfect 8 byte alignment
+    ULONGLONG     timestamp      = 0; //Generated clock ticks, when it returned
+    ULONGLONG     routine        = 0; //Inside the base of its driver (check 'GetSyntheticDrivers')
+    std::uint32_t durationMicros = 0; //Whole microseconds, it started at 'timestamp - durationMicros'
+    std::uint32_t core           = 0;
+    std::uint32_t driverIndex    = 0;
+    CTMDpcKind    kind           = CTMDpcKind::Dpc;
+};
+
+//Made up driver, its runs are exponential around the mean. Some of them now and then run for way too long
+struct CTMSyntheticDriver
+{
+    const char* name;
+    double      meanMicros;
+    double      isrShare;  //Share of its runs which are ISRs, the rest are DPCs
+    double      longShare; //Share of its runs which get 'longRunMicros' as their mean instead
+};
+
+/*
+ * Network and file events out of thin air, so the whole event path can run without an elevated ETW session.
+ * Deterministic: the generator is a xorshift seeded from the options and never looks at the clock, so the same options always give the same events.
+ * Processes are picked with a Zipf distribution (a few busy ones and a long tail), every process has a fixed set of flows.
+ * File events pick their file with a Zipf distribution of their own, which is what the top files sketch gets checked against (check ctm_event_benchmark.h).
+ * Every read/write gets a completion with the same IRP later on, after a latency from a mix of exponentials (mostly cache hits, some disk, a rare slow one),
+ * so the latency histograms have a long tail to show. Completions take the place of new events when they are due, so they count towards the rate and 'maxEvents'.
+ * Events are encoded into a raw payload and decoded again on publish, so decode is part of what gets measured.
+ * While the context switch provider is enabled, switches go straight into 'globalCpuTimeline' on the generated clock: a random core switches to-
+ * -a thread of a Zipf picked process (or goes idle). They have their own random stream, so the network and file events don't change with them.
+ * While the ready thread provider is enabled, every switch to a thread comes with a ready before it, the waits in between go to 'globalReadyLatencyTracker'.
+ * Waits are exponential, every 8th process (the busiest one included) is starved and waits ~100 times longer. 1 in 8 readies come after their switch.
+ * The waits come from the switch stream only, so a fresh generator gives the same ones back (check ctm_event_benchmark.h).
+ * While the DPC provider is enabled, DPCs and ISRs of a fixed set of made up drivers (Zipf picked) go to 'globalDpcLatencyTracker', from a stream of their own.
+ * A couple of the drivers now and then run for hundreds of microseconds, so the threshold has something to catch.
+ */
+class CTMSyntheticEventSource : public CTMEventSource
+{
+public:
+    CTMSyntheticEventSource(const CTMSyntheticEventOptions&, bool = false);
+    ~CTMSyntheticEventSource() override = default;
+
+public: //Main functions
+    bool        Start()         override;
+    bool        ProcessEvents() override;
+    void        Stop()          override;
+    const char* GetName() const override { return "Synthetic"; }
+    bool        SetProviderEnabled(CTMEventProvider, bool) override;
+
+public: //Generator
+    //Next 'count' events, each call carries on where the last one stopped
+    void Generate(CTMRecordedEvent*, std::size_t);
+    //The next 'count' events into a file the replay source can play back
+    bool WriteRecording(const std::wstring&, std::uint64_t);
+    //Generated timestamps advance at the configured rate on this (QPC like) clock
+    constexpr static ULONGLONG timestampFrequency = 10000000;
+    //Next switch of the switch stream at 'timestamp', each call carries on where the last one stopped. Touches nothing but the generator
+    void GenerateContextSwitch(ULONGLONG, CTMSyntheticContextSwitch&);
+    //Next DPC/ISR of the DPC stream at 'timestamp', same as 'GenerateContextSwitch' for the switches
+    void GenerateDpc(ULONGLONG, CTMSyntheticDpc&);
+    //The made up drivers as the tracker gets them (index -> 'CTMSyntheticDpc::driverIndex')
+    static std::vector<CTMDriverModule> GetSyntheticDrivers();
+    static const char* GetSyntheticDriverName(std::uint32_t driverIndex) { return syntheticDrivers[driverIndex].name; }
+    //Made up, but shaped like the pool addresses real file keys are
+    static ULONGLONG GetFileKey(std::uint32_t fileIndex) { return firstFileKey + static_cast<ULONGLONG>(fileIndex) * 0x150; }
+
+public: //Getter functions
+    std::uint64_t GetGeneratedCount()     const { return generatedCount; }
+    //Switches generated so far, ready or not. Generator thread only
+    std::uint64_t GetContextSwitchCount() const { return contextSwitchCount; }
+    //DPCs and ISRs generated so far. Generator thread only
+    std::uint64_t GetDpcCount()           const { return dpcCount; }
+
+private: //Helper functions
+    std::uint64_t NextRandom();
+    double        NextUnit();
+    std::size_t   PickFromCdf(const std::vector<double>&);
+    static void   BuildZipfCdf(std::vector<double>&, std::uint32_t, double);
+    ULONGLONG     NextLatencyTicks();
+    ULONGLONG     NextReadyWaitTicks(std::uint32_t);
+    void          BuildFlowKey(std::uint32_t, std::uint32_t, CTMUsageCounter, CTMNetworkFlowKey&);
+    void          GenerateContextSwitches(ULONGLONG, ULONGLONG, ULONGLONG);
+    std::uint64_t NextSwitchRandom();
+    double        NextSwitchUnit();
+    void          GenerateDpcs(ULONGLONG, ULONGLONG, ULONGLONG);
+    std::uint64_t NextDpcRandom();
+    double        NextDpcUnit();
+    static DWORD  GetThreadId(std::uint32_t processIndex, std::uint32_t threadIndex, std::uint32_t threadsPerProcess)
+    {
+        return firstThreadId + (processIndex * threadsPerProcess + threadIndex) * 4;
+    }
+
+private: //Generator stuff
+    CTMSyntheticEventOptions options;
+    std::vector<double>      processCdf;   //Cumulative Zipf weights, normalized to 1
+    std::vector<double>      counterCdf;   //Cumulative mix weights, normalized to 1
+    std::vector<double>      fileCdf;      //Cumulative Zipf weights over the files, normalized to 1
+    std::vector<CTMSyntheticCompletion> pendingCompletions; //Min heap by due time, a few hundred at most (rate * mean latency)
+    std::uint64_t            randomState    = 0;
+    std::uint64_t            generatedCount = 0;
+    std::uint64_t            irpCount       = 0;
+    bool                     shouldWaitForRoom = false;
+    std::atomic<bool>        isRunning      = false;
+
+private: //Context switch stuff
+    std::atomic<bool>        isContextSwitchEnabled = false;
+    std::atomic<bool>        isReadyThreadEnabled   = false; //Needs the switches too, either one being set generates them
+    std::uint32_t            switchCoreCount        = 0; //From the options, cut down to what the timeline got allocated with before either of the above is set
+    std::uint64_t            switchRandomState      = 0;
+    std::uint64_t            contextSwitchCount     = 0;
+    ULONGLONG                nextSwitchTimestamp    = 0; //Generated clock ticks, 0 -> starts at the current generated time. Generator only
+    constexpr static std::size_t   generateBatchSize    = 256;
+    constexpr static DWORD         firstProcessId       = 1000; //Pids are 'firstProcessId + 4 * index', like real ones
+    constexpr static DWORD         firstThreadId        = 100000;
+    constexpr static double        idleShare            = 0.3;  //Switches to the idle thread, a desktop is idle most of the time but not at 50k switches/s
+    constexpr static double        readyWaitSeconds     = 0.00004; //Mean wait of a thread which gets a core about as soon as it wants one
+    constexpr static double        starvedWaitSeconds   = 0.004;   //Mean wait of a starved process' threads
+    constexpr static ULONGLONG     maxReadyWaitTicks    = timestampFrequency / 10; //100 ms, longer waits are cut down to this
+    constexpr static std::uint32_t starvedProcessStride = 8;
+    constexpr static std::uint64_t lateReadyShare       = 8;    //1 in this many readies come after their switch
+    constexpr static ULONGLONG     firstFileKey         = 0xFFFF9A0000100000ull;
+    constexpr static ULONGLONG     firstIrp             = 0xFFFF9B0000000000ull;
+
+private: //DPC/ISR stuff
+    std::atomic<bool>              isDpcEnabled      = false;
+    std::uint32_t                  dpcCoreCount      = 0; //From the options, the timeline has nothing to do with these
+    std::uint64_t                  dpcRandomState    = 0;
+    std::uint64_t                  dpcCount          = 0;
+    ULONGLONG                      nextDpcTimestamp  = 0; //Generated clock ticks, 0 -> starts at the current generated time. Generator only
+    std::vector<double>            driverCdf;             //Cumulative Zipf weights over 'syntheticDrivers', normalized to 1
+    constexpr static double        driverSkew        = 1.0;
+    constexpr static double        longRunMicros     = 700.0;
+    constexpr static std::uint32_t maxRunMicros      = 10000; //Longer runs are cut down to this
+    constexpr static ULONGLONG     firstDriverBase   = 0xFFFFF80000000000ull;
+    constexpr static ULONGLONG     driverBaseStride  = 0x400000;
+    static const CTMSyntheticDriver syntheticDrivers[12];
+};
+
+#endif
@@ -0,0 +1,305 @@
+#include "ctm_usage_event_pipeline.h"
+
+//Don't really want these macros, they are messing up the std::max and std::min functions
+#undef max
+#undef min
+
+//Init global variables (tables first, the pipeline's aggregator thread has to be gone before they are)
+CTMPidCounterTable    globalProcessUsageTable;
+CTMNetworkFlowTable   globalNetworkFlowTable;
+CTMFileUsageTracker   globalFileUsageTracker;
+CTMFileLatencyTracker globalFileLatencyTracker;
+CTMUsageEventPipeline globalUsageEventPipeline;
+
+//--------------------PRODUCER SIDE--------------------
+void CTMUsageEventPipeline::PublishUsage(CTMUsageEventRecord record, bool shouldWaitForRoom)
+{
+    eventsReceived.fetch_add(1, std::memory_order_relaxed);
+    if(!ShouldKeepUsage(record))
+        return;
+
+    if(!shouldWaitForRoom)
+    {
+        usageEventRing.Push(record);
+        return;
+    }
+
+    //Without the aggregator thread nobody would ever make room, so it counts as a drop after all
+    while(!usageEventRing.TryPush(record))
+    {
+        if(!isAggregatorRunning.load(std::memory_order_relaxed))
+        {
+            usageEventRing.Push(record);
+            return;
+        }
+        std::this_thread::yield();
+    }
+}
+
+void CTMUsageEventPipeline::PublishNetworkFlow(CTMNetworkFlowRecord record, bool shouldWaitForRoom)
+{
+    eventsReceived.fetch_add(1, std::memory_order_relaxed);
+    if(!ShouldKeepNetworkFlow(record))
+        return;
+
+    if(!shouldWaitForRoom)
+    {
+        networkFlowRing.Push(record);
+        return;
+    }
+
+    while(!networkFlowRing.TryPush(record))
+    {
+        if(!isAggregatorRunning.load(std::memory_order_relaxed))
+        {
+            networkFlowRing.Push(record);
+            return;
+        }
+        std::this_thread::yield();
+    }
+}
+
+//--------------------AGGREGATOR THREAD--------------------
+void CTMUsageEventPipeline::Start()
+{
+    if(aggregatorThread.joinable())
+        return;
+
+    isAggregatorRunning.store(true);
+    aggregatorThread = std::thread(&CTMUsageEventPipeline::AggregatorLoop, this);
+}
+
+void CTMUsageEventPipeline::Stop()
+{
+    isAggregatorRunning.store(false);
+    if(aggregatorThread.joinable())
+        aggregatorThread.join();
+}
+
+bool CTMUsageEventPipeline::IsDrained() const
+{
+    //Ring sizes alone aren't enough, a popped batch can still be in the middle of being folded
+    return eventsAggregated.load(std::memory_order_acquire) + GetDroppedCount() + eventsSampledOut.load(std::memory_order_acquire) >=
+           eventsReceived.load(std::memory_order_acquire);
+}
+
+void CTMUsageEventPipeline::SetSamplingThreshold(double eventsPerSecond)
+{
+    samplingThreshold.store(std::max(0.0, eventsPerSecond), std::memory_order_relaxed);
+    if(eventsPerSecond <= 0.0)
+        samplingRatio.store(1, std::memory_order_relaxed);
+}
+
+void CTMUsageEventPipeline::FillDiagnostics(CTMEventTracingDiagnostics& diagnostics) const
+{
+    diagnostics.eventsReceived         = eventsReceived.load(std::memory_order_relaxed);
+    diagnostics.eventsSampledOut       = eventsSampledOut.load(std::memory_order_relaxed);
+    diagnostics.eventsAggregated       = eventsAggregated.load(std::memory_order_relaxed);
+    diagnostics.aggregationNanoseconds = aggregationNanoseconds.load(std::memory_order_relaxed);
+    diagnostics.ringDrops              = GetDroppedCount();
+    diagnostics.ringCapacity           = usageEventRing.GetCapacity();
+    diagnostics.ringHighWatermark      = usageEventRing.GetHighWatermark();
+    diagnostics.pidTableDrops          = globalProcessUsageTable.GetDroppedCount();
+    diagnostics.pidTablePages          = globalProcessUsageTable.GetAllocatedPageCount();
+    diagnostics.pidTablePagesFreed     = globalProcessUsageTable.GetFreedPageCount();
+    diagnostics.flowEvictions          = globalNetworkFlowTable.GetEvictedCount();
+    diagnostics.flowEntries            = globalNetworkFlowTable.GetEntryCount();
+    diagnostics.flowCapacity           = globalNetworkFlowTable.GetCapacity();
+    diagnostics.flowMemoryUsage        = globalNetworkFlowTable.GetMemoryUsage();
+    diagnostics.fileNames              = globalFileUsageTracker.GetFileNameCount();
+    diagnostics.fileSketchMemoryUsage  = globalFileUsageTracker.GetMemoryUsage();
+    diagnostics.fileLatency            = globalFileLatencyTracker.GetStats();
+    diagnostics.readyLatency           = globalReadyLatencyTracker.GetStats();
+    diagnostics.inputRate              = measuredInputRate.load(std::memory_order_relaxed);
+    diagnostics.samplingRatio          = samplingRatio.load(std::memory_order_relaxed);
+}
+
+//--------------------HELPER FUNCTIONS--------------------
+void CTMUsageEventPipeline::AggregatorLoop()
+{
+    //Too big for the stack together (~64 KB for the flows alone)
+    auto batch          = std::make_unique<CTMUsageEventRecord[]>(aggregatorBatchSize);
+    auto flowBatch      = std::make_unique<CTMNetworkFlowRecord[]>(aggregatorBatchSize);
+    auto fileBatch      = std::make_unique<CTMFileIoRecord[]>(aggregatorBatchSize);
+    auto operationBatch = std::make_unique<CTMFileOperationRecord[]>(aggregatorBatchSize);
+    auto lastSweep      = std::chrono::steady_clock::now();
+    auto lastRateCheck  = lastSweep;
+    lastRateEventCount  = eventsReceived.load(std::memory_order_relaxed);
+
+    while(isAggregatorRunning.load(std::memory_order_relaxed))
+    {
+        std::size_t recordCount     = usageEventRing.PopBatch(batch.get(), aggregatorBatchSize);
+        std::size_t flowRecordCount = networkFlowRing.PopBatch(flowBatch.get(), aggregatorBatchSize);
+        //These have their own rings and locks, nothing to gather with the records below
+        std::size_t readySampleCount = globalReadyLatencyTracker.AggregateSamples();
+        std::size_t dpcSampleCount   = globalDpcLatencyTracker.AggregateSamples();
+
+        //Timeouts go by event time (check ctm_file_latency_tracker.h), this only decides how often we look
+        auto now = std::chrono::steady_clock::now();
+        if(now - lastSweep >= inFlightSweepInterval)
+        {
+            globalFileLatencyTracker.SweepInFlight();
+            lastSweep = now;
+        }
+        if(now - lastRateCheck >= samplingInterval)
+        {
+            UpdateSamplingRatio(std::chrono::duration<double>(now - lastRateCheck).count());
+            lastRateCheck = now;
+        }
+
+        //Nothing to do, the rings are big enough to hold what piles up while we nap
+        if(recordCount == 0 && flowRecordCount == 0)
+        {
+            if(readySampleCount == 0 && dpcSampleCount == 0)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+
+        auto batchStart = std::chrono::steady_clock::now();
+        //The process screen swaps the usage table's epochs once a second, it waits for atmost the adds of this batch
+        globalProcessUsageTable.BeginWrite();
+
+        //File records feed the top files and the latencies too, gathered so each tracker takes its lock once per batch.
+        //Starts and ends keep their ring order, so an end is never looked up before its start went in.
+        //A sampled record stands for 'sampleWeight' of its kind, so that is what it counts as everywhere
+        std::size_t fileRecordCount = 0, operationRecordCount = 0;
+        for(std::size_t i = 0; i < recordCount; i++)
+        {
+            const CTMUsageEventRecord& record = batch[i];
+            if(record.type == CTMUsageEventType::FileIoCompletion)
+            {
+                operationBatch[operationRecordCount++] = CTMFileOperationRecord{record.irp, record.timestamp, 0, true, false};
+                continue;
+            }
+
+            std::uint64_t bytes = static_cast<std::uint64_t>(record.bytes) * record.sampleWeight;
+            globalProcessUsageTable.Add(record.processId, record.kind, bytes);
+            if(record.fileKey != 0)
+                fileBatch[fileRecordCount++] = CTMFileIoRecord{record.fileKey, bytes, record.processId};
+            if(record.irp != 0)
+                operationBatch[operationRecordCount++] = CTMFileOperationRecord{record.irp, record.timestamp, record.processId, false,
+                                                                                record.kind == CTMUsageCounter::FileWrite, record.sampleWeight};
+        }
+
+        //Network records feed both, per process totals and the flow they belong to
+        for(std::size_t i = 0; i < flowRecordCount; i++)
+            globalProcessUsageTable.Add(flowBatch[i].key.processId, flowBatch[i].kind, static_cast<std::uint64_t>(flowBatch[i].bytes) * flowBatch[i].sampleWeight);
+        //Before the trackers, their locks are shared with the UI and the swap shouldn't have to wait on those too
+        globalProcessUsageTable.EndWrite();
+
+        if(fileRecordCount > 0)
+            globalFileUsageTracker.AddBatch(fileBatch.get(), fileRecordCount);
+        if(operationRecordCount > 0)
+            globalFileLatencyTracker.AddBatch(operationBatch.get(), operationRecordCount);
+        if(flowRecordCount > 0)
+            globalNetworkFlowTable.AddBatch(flowBatch.get(), flowRecordCount);
+
+        //Once per batch, the clock read is noise next to a thousand records
+        auto batchTime = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - batchStart);
+        aggregationNanoseconds.fetch_add(static_cast<std::uint64_t>(batchTime.count()), std::memory_order_relaxed);
+        eventsAggregated.fetch_add(recordCount + flowRecordCount, std::memory_order_release);
+    }
+}
+
+bool CTMUsageEventPipeline::ShouldKeepUsage(CTMUsageEventRecord& record)
+{
+    //A completion goes wherever its start went, the start is the one that got sampled
+    if(record.type == CTMUsageEventType::FileIoCompletion)
+    {
+        ULONGLONG& sampledOutIrp = sampledOutIrps[GetSampledOutIrpSlot(record.irp)];
+        if(record.irp == 0 || sampledOutIrp != record.irp)
+            return true;
+
+        sampledOutIrp = 0;
+        eventsSampledOut.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    std::uint32_t ratio = samplingRatio.load(std::memory_order_relaxed);
+    ULONGLONG*    sampledOutIrp = record.irp != 0 ? &sampledOutIrps[GetSampledOutIrpSlot(record.irp)] : nullptr;
+    if(ratio > 1)
+    {
+        //Hash of what the event is, never of which process it belongs to alone, so every process is sampled at the same rate
+        std::uint64_t eventHash = MixSamplingHash(record.timestamp ^ MixSamplingHash(record.fileKey ^ record.irp ^
+                                                  (static_cast<std::uint64_t>(record.processId) << 32 | record.bytes)));
+        if((eventHash & (ratio - 1)) != 0)
+        {
+            if(sampledOutIrp)
+                *sampledOutIrp = record.irp;
+            eventsSampledOut.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+    }
+
+    //Kernel reuses IRPs all the time, an older skipped start with the same IRP must not take this one's completion with it
+    if(sampledOutIrp && *sampledOutIrp == record.irp)
+        *sampledOutIrp = 0;
+    record.sampleWeight = static_cast<std::uint16_t>(ratio);
+    return true;
+}
+
+bool CTMUsageEventPipeline::ShouldKeepNetworkFlow(CTMNetworkFlowRecord& record)
+{
+    std::uint32_t ratio = samplingRatio.load(std::memory_order_relaxed);
+    if(ratio > 1)
+    {
+        const CTMNetworkFlowKey& key = record.key;
+        std::uint64_t ports     = static_cast<std::uint64_t>(key.localPort) << 16 | key.remotePort;
+        std::uint64_t eventHash = MixSamplingHash(record.timestamp ^ MixSamplingHash((static_cast<std::uint64_t>(key.processId) << 32 | record.bytes) ^
+                                                                                     ports << 48 ^ static_cast<std::uint64_t>(record.kind) << 40));
+        if((eventHash & (ratio - 1)) != 0)
+        {
+            eventsSampledOut.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+    }
+
+    record.sampleWeight = static_cast<std::uint16_t>(ratio);
+    return true;
+}
+
+void CTMUsageEventPipeline::UpdateSamplingRatio(double elapsedSeconds)
+{
+    std::uint64_t eventCount = eventsReceived.load(std::memory_order_relaxed);
+    double        inputRate  = (eventCount - lastRateEventCount) / elapsedSeconds;
+    lastRateEventCount = eventCount;
+    measuredInputRate.store(inputRate, std::memory_order_relaxed);
+
+    double threshold = samplingThreshold.load(std::memory_order_relaxed);
+    if(threshold <= 0.0)
+    {
+        samplingRatio.store(1, std::memory_order_relaxed);
+        return;
+    }
+
+    //Up right away and as far as it takes, a spike is exactly when falling behind costs us
+    std::uint32_t ratio       = samplingRatio.load(std::memory_order_relaxed);
+    std::uint32_t neededRatio = 1;
+    while(neededRatio < maxSamplingRatio && inputRate / neededRatio > threshold)
+        neededRatio *= 2;
+
+    if(neededRatio > ratio)
+        ratio = neededRatio;
+    //Down one step per check, and only once half of N is sure to stay under the threshold
+    else if(ratio > 1 && inputRate / (ratio / 2) < threshold * samplingHysteresis)
+        ratio /= 2;
+
+    samplingRatio.store(ratio, std::memory_order_relaxed);
+}
+
+std::uint64_t CTMUsageEventPipeline::MixSamplingHash(std::uint64_t value)
+{
+    //splitmix64 finalizer, every input bit flips about half of the output bits so the low ones are as good as any
+    value ^= value >> 30;
+    value *= 0xBF58476D1CE4E5B9ull;
+    value ^= value >> 27;
+    value *= 0x94D049BB133111EBull;
+    value ^= value >> 31;
+    return value;
+}
+
+std::size_t CTMUsageEventPipeline::GetSampledOutIrpSlot(ULONGLONG irp)
+{
+    //IRPs are pool allocations, the low bits are alignment and the high ones are the same for all of them
+    return static_cast<std::size_t>(MixSamplingHash(irp)) & (sampledOutIrpSlotCount - 1);
+}
@@ -0,0 +1,177 @@
+#ifndef CTM_USAGE_EVENT_PIPELINE_HPP
+#define CTM_USAGE_EVENT_PIPELINE_HPP
+
+//Windows stuff
+#include <windows.h>
+//My stuff
+#include "ctm_pid_counter_table.h"
+#include "ctm_network_flow_table.h"
+#include "ctm_file_usage_tracker.h"
+#include "ctm_file_latency_tracker.h"
+#include "ctm_ready_latency_tracker.h"
+#include "ctm_dpc_latency_tracker.h"
+#include "../CTMPureHeaderFiles/ctm_spsc_ring.h"
+//Stdlib stuff
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <cstdint>
+
+//Completions ride the same ring as the reads and writes they end, so the aggregator always sees a start before its end
+enum class CTMUsageEventType : std::uint8_t
+{
+    Usage,           //Bytes for the usage table (and a latency start if it carries an IRP)
+    FileIoCompletion //Kernel-File OperationEnd, only 'timestamp' and 'irp' mean something
+};
+
+//What an event source hands to the aggregator thread, kept small so the producer is just a decode and a copy
+struct CTMUsageEventRecord
+{
+    //Perfect 8 byte alignment
+    ULONGLONG         timestamp    = 0; //QPC ticks, from the event header
+    ULONGLONG         fileKey      = 0; //File events only, which file the bytes went to (0 -> unknown)
+    ULONGLONG         irp          = 0; //File events only, matches a read/write with its completion (0 -> no latency)
+    DWORD             processId    = 0;
+    std::uint32_t     bytes        = 0;
+    CTMUsageCounter   kind         = CTMUsageCounter::TcpSent;
+    CTMUsageEventType type         = CTMUsageEventType::Usage;
+    std::uint16_t     sampleWeight = 1; //Set by the pipeline, this record stands for that many (check 'CTMUsageEventPipeline' sampling)
+};
+
+//Health of the event pipeline, everything is cumulative since the session started
+struct CTMEventTracingDiagnostics
+{
+    std::uint64_t eventsReceived         = 0; //Network and file events (completions too) the source published
+    std::uint64_t eventsSampledOut       = 0; //Skipped by sampling, the ones kept were scaled up to make up for them
+    std::uint64_t eventsAggregated       = 0; //Records the aggregator thread folded into the usage table
+    std::uint64_t aggregationNanoseconds = 0; //Time the aggregator spent folding them, divided by the above it is the cost per event
+    std::uint64_t ringDrops              = 0; //Ring was full, record thrown away
+    std::uint64_t pidTableDrops          = 0; //Pid outside of what the usage table covers
+    std::size_t   pidTablePages          = 0; //Usage table pages (1024 pids each) allocated right now
+    std::uint64_t pidTablePagesFreed     = 0; //Pages freed after a minute without events
+    std::uint64_t schemaTdhFallbacks     = 0; //Events which needed TDH for atleast one field
+    std::uint64_t lostEventNotifications = 0; //RT_LostEvent events delivered to us
+    std::uint64_t contextSwitches        = 0; //Went into the CPU timeline (not the pipeline), they still fill the session's buffers
+    ULONG         etwEventsLost          = 0; //From the session itself (ControlTrace query)
+    ULONG         etwRealTimeBuffersLost = 0;
+    ULONG         etwBufferSizeKB        = 0;
+    ULONG         etwBuffers             = 0; //Allocated right now, grows towards the maximum under load
+    ULONG         etwMaximumBuffers      = 0;
+    ULONG         etwFlushTimer          = 0; //Seconds
+    std::size_t   ringCapacity           = 0;
+    std::size_t   ringHighWatermark      = 0;
+    std::uint64_t flowEvictions          = 0; //Flows the clock hand threw out to make room
+    std::size_t   flowEntries            = 0;
+    std::size_t   flowCapacity           = 0;
+    std::size_t   flowMemoryUsage        = 0; //Bytes, fixed at construction
+    std::size_t   fileNames              = 0; //File keys we know the path of
+    std::size_t   fileSketchMemoryUsage  = 0; //Bytes, fixed at construction
+    CTMFileLatencyStats fileLatency;             //In flight matching of reads/writes with their completions
+    CTMReadyLatencyStats readyLatency;           //Matching of ready threads with the switches that run them
+    double        inputRate              = 0.0; //Events per second the source published, as the sampling last measured it
+    std::uint32_t samplingRatio          = 1;   //1 in this many events is kept right now, 1 -> full fidelity
+};
+
+/*
+ * Everything between an event source (check ctm_event_source.h) and the tables the process screen reads.
+ * The source publishes records into two rings (network records carry their endpoints so they get their own, bigger one),
+ * the aggregator thread folds them into 'globalProcessUsageTable', 'globalNetworkFlowTable', 'globalFileUsageTracker' and 'globalFileLatencyTracker'.
+ * It also folds the scheduler waits 'globalReadyLatencyTracker' matched on the source's thread, and the DPC/ISR runs of 'globalDpcLatencyTracker',-
+ * -those come through the trackers' own rings.
+ * Single producer: only one source may publish at a time.
+ * Sampling: the aggregator measures the rate the source publishes at, above the threshold only 1 in N events (N a power of two) is let in.
+ * Which ones is decided by a hash of the event itself and not by who it belongs to, so every process keeps its share,
+ * and the kept ones carry N along so the aggregator scales bytes and latency counts back up. A completion follows its read/write, it is-
+ * -skipped only if its start was. N goes up as soon as the rate needs it and comes down one step at a time once the rate drops.
+ */
+class CTMUsageEventPipeline
+{
+public:
+    CTMUsageEventPipeline() = default;
+    ~CTMUsageEventPipeline() { Stop(); }
+
+    //No need for copy or move operations
+    CTMUsageEventPipeline(const CTMUsageEventPipeline&)            = delete;
+    CTMUsageEventPipeline& operator=(const CTMUsageEventPipeline&) = delete;
+    CTMUsageEventPipeline(CTMUsageEventPipeline&&)                 = delete;
+    CTMUsageEventPipeline& operator=(CTMUsageEventPipeline&&)      = delete;
+
+public: //Producer side
+    //If it falls behind we drop (and count) instead of making the source wait, unless the source asks to wait for room.
+    //Taken by value, the pipeline stamps the sample weight on its own copy
+    void PublishUsage(CTMUsageEventRecord, bool = false);
+    void PublishNetworkFlow(CTMNetworkFlowRecord, bool = false);
+
+public: //Aggregator thread
+    void Start();
+    void Stop();
+    //True once everything published so far was either aggregated, dropped or sampled out
+    bool IsDrained() const;
+    //Events per second above which sampling kicks in, 0 -> never sample
+    void SetSamplingThreshold(double);
+
+public: //Getter functions
+    void FillDiagnostics(CTMEventTracingDiagnostics&) const;
+    std::uint64_t GetEventsReceived()   const { return eventsReceived.load(std::memory_order_relaxed); }
+    std::uint64_t GetEventsAggregated() const { return eventsAggregated.load(std::memory_order_relaxed); }
+    std::uint64_t GetDroppedCount()     const { return usageEventRing.GetDroppedCount() + networkFlowRing.GetDroppedCount(); }
+    std::uint32_t GetSamplingRatio()    const { return samplingRatio.load(std::memory_order_relaxed); }
+    bool          IsAggregatorRunning() const { return isAggregatorRunning.load(std::memory_order_relaxed); }
+
+private: //Helper functions
+    void                 AggregatorLoop();
+    bool                 ShouldKeepUsage(CTMUsageEventRecord&);
+    bool                 ShouldKeepNetworkFlow(CTMNetworkFlowRecord&);
+    void                 UpdateSamplingRatio(double);
+    static std::uint64_t MixSamplingHash(std::uint64_t);
+    static std::size_t   GetSampledOutIrpSlot(ULONGLONG);
+
+private: //Rings, between the source (producer) and the aggregator thread (consumer)
+    //~2.5 MB, a couple hundred ms worth of events at very high rates
+    constexpr static std::size_t      usageEventRingCapacity  = 1 << 16;
+    //~2 MB, same idea
+    constexpr static std::size_t      networkFlowRingCapacity = 1 << 15;
+    CTMSpscRing<CTMUsageEventRecord>  usageEventRing{usageEventRingCapacity};
+    CTMSpscRing<CTMNetworkFlowRecord> networkFlowRing{networkFlowRingCapacity};
+    std::atomic<std::uint64_t>        eventsReceived = 0;
+
+private: //Aggregator thread, folds ring records into the global tables so the source never touches them
+    std::thread                  aggregatorThread;
+    std::atomic<bool>            isAggregatorRunning    = false;
+    std::atomic<std::uint64_t>   eventsAggregated       = 0; //Only written by the aggregator thread, read by the UI
+    std::atomic<std::uint64_t>   aggregationNanoseconds = 0;
+    constexpr static std::size_t aggregatorBatchSize    = 1024;
+    //Starts whose completion never came are swept out this often, it is a walk over the whole in flight table
+    constexpr static std::chrono::seconds inFlightSweepInterval{1};
+
+private: //Sampling, the ratio is picked by the aggregator thread and read by the producer for every event
+    std::atomic<std::uint32_t>   samplingRatio      = 1;
+    std::atomic<double>          samplingThreshold  = 0.0;
+    std::atomic<double>          measuredInputRate  = 0.0;
+    std::atomic<std::uint64_t>   eventsSampledOut   = 0; //Only written by the producer
+    std::uint64_t                lastRateEventCount = 0; //Only touched by the aggregator thread
+    //Power of two so a kept event stays kept when N grows, 256 still leaves thousands of events a second to scale up from
+    constexpr static std::uint32_t maxSamplingRatio  = 256;
+    //N only comes down once half of it would keep the rate under this much of the threshold, a rate sitting on it doesn't flip N every check
+    constexpr static double        samplingHysteresis = 0.75;
+    constexpr static std::chrono::milliseconds samplingInterval{250};
+    //IRPs of starts we skipped so their completions get skipped too, direct mapped (a collision only lets a completion through, it ends up unmatched).
+    //Only the producer touches it, 32 KB
+    constexpr static std::size_t sampledOutIrpSlotCount = 1 << 12;
+    ULONGLONG                    sampledOutIrps[sampledOutIrpSlotCount] = {};
+};
+
+//Network and file bytes per pid, added to by the aggregator thread and drained by the process screen every update
+extern CTMPidCounterTable    globalProcessUsageTable;
+//Per connection bytes and rates, filled by the aggregator thread and read by the process details window
+extern CTMNetworkFlowTable   globalNetworkFlowTable;
+//Top files by bytes, sketches filled by the aggregator thread and names by the event source, read by the process screen
+extern CTMFileUsageTracker   globalFileUsageTracker;
+//Per process file read/write latencies, filled by the aggregator thread and read by the process screen
+extern CTMFileLatencyTracker globalFileLatencyTracker;
+//Whatever event source is running publishes here (check ctm_event_source.h)
+extern CTMUsageEventPipeline globalUsageEventPipeline;
+
+#endif
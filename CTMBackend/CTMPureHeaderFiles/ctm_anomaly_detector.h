@@ -0,0 +1,111 @@
+#ifndef CTM_ANOMALY_DETECTOR_HPP
+#define CTM_ANOMALY_DETECTOR_HPP
+
+//Stdlib stuff
+#include <cmath>
+#include <cstdint>
+
+/*
+ * Online (streaming) anomaly detector for a single metric series, like total CPU usage or memory used by a process.
+ * It keeps an exponentially weighted moving average (EWMA) of the mean and variance, so every sample is O(1) with no allocations.
+ * A sample is an anomaly when it deviates from the mean by more than 'kSigma' standard deviations.
+ * NOTE: This file doesn't include anything from windows on purpose, feed it any recorded trace and check the false positives-
+ * -('CTMApp --anomaly-check <file.csv>' does exactly that, check ctm_anomaly_check.h).
+ */
+class CTMAnomalyDetector
+{
+public:
+    constexpr static double defaultAlpha  = 0.1;
+    constexpr static double defaultKSigma = 3.0;
+
+public:
+    CTMAnomalyDetector(double alpha = defaultAlpha, double kSigma = defaultKSigma, double minSigma = 0.5, std::uint32_t warmupSamples = 10)
+        : alpha(alpha), kSigma(kSigma), minSigma(minSigma), warmupSamples(warmupSamples)
+    {}
+
+public: //Main function
+    //Returns true if the sample is an anomaly. The sample is compared against the estimate BEFORE it gets folded in
+    bool AddSample(double value)
+    {
+        //First sample ever, just take it as the mean
+        if(samplesSeen == 0)
+        {
+            mean        = value;
+            variance    = 0.0;
+            samplesSeen = 1;
+            return false;
+        }
+
+        double sigma      = std::sqrt(variance);
+        double usedSigma  = sigma > minSigma ? sigma : minSigma; //Flat series (sigma ~ 0) would flag every tiny wiggle otherwise
+        double diff       = value - mean;
+        bool   isAnomaly  = false;
+
+        lastDeviation = diff / usedSigma;
+
+        //Don't flag anything until we have seen enough samples to trust the estimate
+        if(samplesSeen >= warmupSamples && std::fabs(lastDeviation) > kSigma)
+        {
+            isAnomaly = true;
+            //Clamp the anomaly to the k sigma boundary before folding it in, so a single spike doesn't blow up the variance-
+            //-and hide the next spike. A level shift still gets learned, just slowly
+            diff = (diff > 0.0 ? kSigma : -kSigma) * usedSigma;
+        }
+
+        //EWMA update of mean and variance (West's incremental formula)
+        double increment = alpha * diff;
+        mean            += increment;
+        variance         = (1.0 - alpha) * (variance + diff * increment);
+
+        if(samplesSeen < warmupSamples)
+            ++samplesSeen;
+
+        return isAnomaly;
+    }
+
+    void Reset()
+    {
+        mean          = 0.0;
+        variance      = 0.0;
+        lastDeviation = 0.0;
+        samplesSeen   = 0;
+    }
+
+public: //Setters and getters
+    void SetParameters(double newAlpha, double newKSigma, double newMinSigma)
+    {
+        alpha    = newAlpha;
+        kSigma   = newKSigma;
+        minSigma = newMinSigma;
+    }
+
+    double GetMean()          const { return mean; }
+    double GetSigma()         const { return std::sqrt(variance); }
+    double GetLastDeviation() const { return lastDeviation; } //In number of sigmas, signed
+
+private: //Parameters
+    double        alpha;         //Smoothing factor, higher value = adapts faster
+    double        kSigma;        //Threshold in number of standard deviations
+    double        minSigma;      //Lower bound of sigma, in the same unit as the series
+    std::uint32_t warmupSamples;
+
+private: //Estimator state
+    double        mean          = 0.0;
+    double        variance      = 0.0;
+    double        lastDeviation = 0.0;
+    std::uint32_t samplesSeen   = 0;
+};
+
+//Lower bounds of sigma for the series the performance graphs and the process list check, in the same unit as the series.
+//Shared with the anomaly check, so a replayed trace gets flagged exactly like the app would flag it
+struct CTMAnomalyMinSigma
+{
+    constexpr static double cpuUsage      = 2.0;  //%, usage jumps around quite a bit, anything below 2% deviation is just noise
+    constexpr static double memoryInUse   = 0.05; //GB, memory in use is quite flat, ignore anything below ~50MB of deviation
+    constexpr static double processMemory = 16.0; //MB, a single process allocating a few MB is business as usual
+    constexpr static double network       = 16.0; //KB/s, a few KB of deviation on an idle network is not an anomaly
+    constexpr static double dpcTime       = 0.5;  //%, a DPC storm moves it by whole percents while the noise is way below that
+    constexpr static double disk          = 64.0; //KB/s, background disk activity of a few dozen KB is not an anomaly
+};
+
+#endif
@@ -11,6 +11,8 @@ enum class CTMScreenState : std::uint8_t
     Apps,
     Services,
     Settings,
+    Handles,   //After Settings so saved screen indices stay valid
+    Modules,
     PageCount, //Personal use
     None
 };
@@ -21,6 +23,7 @@ enum class CTMPerformanceScreenState : std::uint8_t
     MemoryInfo,
     NetInfo,
     DiskInfo,
+    DpcInfo,
     PageCount,
     None
 };
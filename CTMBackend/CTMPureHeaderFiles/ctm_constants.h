@@ -24,6 +24,13 @@
 //EWT constants (Change these GUIDs if it doesn't work for your system)
 #define MICROSOFT_WINDOWS_KERNEL_NETWORK_GUID { 0x7DD42A49, 0x5329, 0x4832, { 0x8D, 0xFD, 0x43, 0xD9, 0x79, 0x15, 0x3A, 0x88 } }
 #define MICROSOFT_WINDOWS_KERNEL_FILE_GUID    { 0xEDD08927, 0x9CC4, 0x4E65, { 0xB9, 0x70, 0xC2, 0x56, 0x0F, 0xB5, 0xC2, 0x89 } }
+#define MICROSOFT_WINDOWS_KERNEL_PROCESS_GUID { 0x22FB2CD6, 0x0E7B, 0x422B, { 0xA0, 0xC7, 0x2F, 0xAD, 0x1F, 0xD0, 0xE7, 0x16 } }
+//Not a provider, real time sessions send events with this GUID when they lose events or buffers
+#define ETW_RT_LOST_EVENT_GUID                { 0x6A399AE0, 0x4BC6, 0x4DE9, { 0x87, 0x0B, 0x36, 0x57, 0xF8, 0x94, 0x7E, 0x7E } }
+//Not a provider either, the classic kernel Thread events (CSwitch, thread start) come with this GUID in a system logger session
+#define KERNEL_THREAD_EVENT_GUID              { 0x3D6FA8D1, 0xFE05, 0x11D0, { 0x9D, 0xDA, 0x00, 0xC0, 0x4F, 0xD7, 0xBA, 0x7C } }
+//Same deal for the classic PerfInfo events (DPCs, ISRs, ...)
+#define KERNEL_PERFINFO_EVENT_GUID            { 0xCE1DBFB4, 0x137E, 0x4DA6, { 0x87, 0xB0, 0x3F, 0x59, 0xAA, 0x10, 0x2C, 0xBC } }
 
 //File paths (relative to where exe file exists)
 #define FONT_PRESS_START_PATH "./Fonts/PressStart.ttf"
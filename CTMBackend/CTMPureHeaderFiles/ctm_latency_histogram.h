@@ -0,0 +1,151 @@
+#ifndef CTM_LATENCY_HISTOGRAM_HPP
+#define CTM_LATENCY_HISTOGRAM_HPP
+
+//Stdlib stuff
+#include <algorithm>
+#include <iterator>
+#include <cstddef>
+#include <cstdint>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+/*
+ * Log-linear (HDR style) histogram of latencies in microseconds, fixed size and no allocations.
+ * Values below 16 get a bucket each, above that every power of two is split into 16 equal buckets,
+ * so a bucket is never wider than 1/16 of its value (percentiles are within 6.25% of the real value, the max is exact).
+ * Values up to 2^30 us (~18 minutes) are kept apart, anything longer lands in the last bucket.
+ * Insert is a bit scan and a shift, O(1). Two histograms merge by adding their buckets, so per process ones add up to a system wide one.
+ * Counts saturate instead of wrapping, a bucket would need 4 billion samples for that to matter.
+ * NOTE: This file doesn't include anything from windows on purpose, feed it generated latencies and compare the percentiles with a sorted copy.
+ */
+class CTMLatencyHistogram
+{
+public: //Main functions
+    //'count' > 1 records the same value that many times (a sampled value standing for the ones which weren't)
+    void Record(std::uint64_t valueMicroseconds, std::uint32_t count = 1)
+    {
+        std::uint32_t value = static_cast<std::uint32_t>(std::min<std::uint64_t>(valueMicroseconds, maxTrackedValue));
+        std::uint32_t& bucket = buckets[GetBucketIndex(value)];
+        bucket = static_cast<std::uint32_t>(std::min<std::uint64_t>(static_cast<std::uint64_t>(bucket) + count, UINT32_MAX));
+
+        totalCount += count;
+        maxValue = std::max(maxValue, valueMicroseconds);
+    }
+
+    void Merge(const CTMLatencyHistogram& other)
+    {
+        for(std::size_t i = 0; i < bucketCount; i++)
+        {
+            std::uint64_t sum = static_cast<std::uint64_t>(buckets[i]) + other.buckets[i];
+            buckets[i] = static_cast<std::uint32_t>(std::min<std::uint64_t>(sum, UINT32_MAX));
+        }
+
+        totalCount += other.totalCount;
+        maxValue    = std::max(maxValue, other.maxValue);
+    }
+
+    void Clear()
+    {
+        std::fill(std::begin(buckets), std::end(buckets), 0u);
+        totalCount = 0;
+        maxValue   = 0;
+    }
+
+public: //Getter functions
+    std::uint64_t GetCount() const { return totalCount; }
+    std::uint64_t GetMax()   const { return maxValue; }
+
+    //Highest value of the bucket the percentile falls into (never below the real one), 0 if nothing was recorded
+    std::uint64_t GetValueAtPercentile(double percentile) const
+    {
+        if(totalCount == 0)
+            return 0;
+
+        //Rank of the sample we're after, 1 based, so p100 is the last one and p0 the first
+        std::uint64_t targetRank = static_cast<std::uint64_t>(std::clamp(percentile, 0.0, 100.0) / 100.0 * totalCount + 0.5);
+        targetRank = std::clamp<std::uint64_t>(targetRank, 1, totalCount);
+
+        std::uint64_t seenCount = 0;
+        for(std::size_t i = 0; i < bucketCount; i++)
+        {
+            seenCount += buckets[i];
+            if(seenCount >= targetRank)
+                return std::min<std::uint64_t>(GetBucketUpperBound(i), maxValue);
+        }
+
+        //Only when buckets saturated and the counts don't add up anymore
+        return maxValue;
+    }
+
+private: //Helper functions
+    static std::size_t GetBucketIndex(std::uint32_t value)
+    {
+        if(value < subBucketCount)
+            return value;
+
+        //Which power of two it is in, then which of its 16 slices
+        std::uint32_t magnitude = HighestBit(value);
+        std::uint32_t shift     = magnitude - subBucketBits;
+        return subBucketCount + static_cast<std::size_t>(shift) * subBucketCount + ((value >> shift) - subBucketCount);
+    }
+
+    static std::uint64_t GetBucketUpperBound(std::size_t index)
+    {
+        if(index < subBucketCount)
+            return index;
+
+        std::size_t   offset    = index - subBucketCount;
+        std::uint32_t shift     = static_cast<std::uint32_t>(offset / subBucketCount);
+        std::uint64_t lowerEdge = static_cast<std::uint64_t>(subBucketCount + offset % subBucketCount) << shift;
+        return lowerEdge + (1ull << shift) - 1;
+    }
+
+    static std::uint32_t HighestBit(std::uint32_t value)
+    {
+#if defined(_MSC_VER)
+        unsigned long bitIndex = 0;
+        _BitScanReverse(&bitIndex, value);
+        return static_cast<std::uint32_t>(bitIndex);
+#else
+        return 31u - static_cast<std::uint32_t>(__builtin_clz(value));
+#endif
+    }
+
+private: //Constant stuff
+    constexpr static std::uint32_t subBucketBits   = 4;
+    constexpr static std::uint32_t subBucketCount  = 1u << subBucketBits;
+    constexpr static std::uint32_t maxValueBits    = 30;
+    constexpr static std::uint64_t maxTrackedValue = (1ull << maxValueBits) - 1;
+    //16 exact ones, then 16 for every power of two from 2^4 up to 2^30
+    constexpr static std::size_t   bucketCount     = (maxValueBits - subBucketBits + 1) * subBucketCount;
+
+private: //Histogram stuff
+    std::uint32_t buckets[bucketCount] = {};
+    std::uint64_t totalCount           = 0;
+    std::uint64_t maxValue             = 0;
+};
+
+//What the UI gets out of a histogram, percentiles in microseconds
+struct CTMLatencySummary
+{
+    std::uint64_t count = 0;
+    std::uint64_t p50   = 0;
+    std::uint64_t p95   = 0;
+    std::uint64_t p99   = 0;
+    std::uint64_t max   = 0;
+};
+
+//Same percentiles for every tracker (file, ready thread and DPC/ISR), so their tables line up
+inline CTMLatencySummary Summarize(const CTMLatencyHistogram& histogram)
+{
+    CTMLatencySummary summary;
+    summary.count = histogram.GetCount();
+    summary.p50   = histogram.GetValueAtPercentile(50.0);
+    summary.p95   = histogram.GetValueAtPercentile(95.0);
+    summary.p99   = histogram.GetValueAtPercentile(99.0);
+    summary.max   = histogram.GetMax();
+    return summary;
+}
+
+#endif
@@ -0,0 +1,225 @@
+#ifndef CTM_SPACE_SAVING_HPP
+#define CTM_SPACE_SAVING_HPP
+
+//Stdlib stuff
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Weighted Space-Saving heavy hitter sketch (Metwally et al.), keeps the heaviest keys of a stream in a fixed number of counters.
+ * A key which isn't monitored takes over the smallest counter and inherits its count as its error, so with 'capacity' counters and a total weight of N:
+ *  - every count is an overestimate, by atmost its own 'error' which is never more than N / capacity
+ *  - a key with a true weight above N / capacity is always monitored (nothing heavy can be missed)
+ *  - count - error is a lower bound of the true weight
+ * Counters live in a min heap (smallest one is always at the root) and keys are found with an open addressing index,
+ * all of it sized once in the constructor, so memory stays the same no matter how many distinct keys the stream has.
+ * O(log capacity) per update. Not thread safe.
+ * NOTE: This file doesn't include anything from windows on purpose, feed it a synthetic Zipfian stream and compare it with exact counts.
+ */
+template<typename Key, typename Hash = std::hash<Key>>
+class CTMSpaceSaving
+{
+public:
+    struct Counter
+    {
+        Key           key{};
+        std::uint64_t count = 0; //Upper bound of the key's true weight
+        std::uint64_t error = 0; //Weight it inherited when it took the counter over, count - error is the lower bound
+    };
+
+public:
+    explicit CTMSpaceSaving(std::size_t counterCapacity)
+    {
+        capacity = counterCapacity > 0 ? counterCapacity : 1;
+        counters.resize(capacity);
+        heap.resize(capacity);
+        heapPositions.resize(capacity);
+
+        //Atleast twice the counters, so the index never gets more than half full
+        slotCount = 1;
+        while(slotCount < capacity * 2)
+            slotCount <<= 1;
+        slotMask = slotCount - 1;
+        slots.assign(slotCount, emptySlot);
+    }
+
+    //No need for copy or move operations
+    CTMSpaceSaving(const CTMSpaceSaving&)            = delete;
+    CTMSpaceSaving& operator=(const CTMSpaceSaving&) = delete;
+    CTMSpaceSaving(CTMSpaceSaving&&)                 = delete;
+    CTMSpaceSaving& operator=(CTMSpaceSaving&&)      = delete;
+
+public: //Main functions
+    void Add(const Key& key, std::uint64_t weight)
+    {
+        totalWeight += weight;
+
+        std::size_t slot = FindSlot(key);
+        if(slots[slot] != emptySlot)
+        {
+            std::uint32_t counterIndex = slots[slot];
+            counters[counterIndex].count += weight;
+            SiftDown(heapPositions[counterIndex]);
+            return;
+        }
+
+        //Still room, the key is counted exactly
+        if(counterCount < capacity)
+        {
+            std::uint32_t counterIndex = static_cast<std::uint32_t>(counterCount);
+            counters[counterIndex] = Counter{key, weight, 0};
+            slots[slot]            = counterIndex;
+            heap[counterCount]           = counterIndex;
+            heapPositions[counterIndex]  = counterCount;
+            SiftUp(counterCount++);
+            return;
+        }
+
+        //Take over the smallest counter, whatever it had counted becomes the new key's error
+        std::uint32_t counterIndex = heap[0];
+        Counter&      counter      = counters[counterIndex];
+        EraseSlot(FindSlot(counter.key));
+
+        counter.error  = counter.count;
+        counter.count += weight;
+        counter.key    = key;
+        //Erasing can shift entries back, so look the slot up again
+        slots[FindSlot(key)] = counterIndex;
+        SiftDown(0);
+        ++replacementCount;
+    }
+
+    //Heaviest first, atmost 'maxCount' of the counters which pass the filter
+    template<typename Filter>
+    void CollectTop(std::vector<Counter>& outCounters, std::size_t maxCount, Filter&& filter) const
+    {
+        outCounters.clear();
+        for(std::size_t i = 0; i < counterCount; i++)
+            if(filter(counters[i].key))
+                outCounters.push_back(counters[i]);
+
+        auto isHeavier = [](const Counter& left, const Counter& right){ return left.count > right.count; };
+        if(outCounters.size() > maxCount)
+        {
+            std::partial_sort(outCounters.begin(), outCounters.begin() + maxCount, outCounters.end(), isHeavier);
+            outCounters.resize(maxCount);
+        }
+        else
+            std::sort(outCounters.begin(), outCounters.end(), isHeavier);
+    }
+
+    void CollectTop(std::vector<Counter>& outCounters, std::size_t maxCount) const
+    {
+        CollectTop(outCounters, maxCount, [](const Key&){ return true; });
+    }
+
+    void Clear()
+    {
+        std::fill(slots.begin(), slots.end(), emptySlot);
+        counterCount     = 0;
+        totalWeight      = 0;
+        replacementCount = 0;
+    }
+
+public: //Getter functions
+    std::size_t   GetCapacity()         const { return capacity; }
+    std::size_t   GetCounterCount()     const { return counterCount; }
+    std::uint64_t GetTotalWeight()      const { return totalWeight; }
+    std::uint64_t GetReplacementCount() const { return replacementCount; }
+    //Smallest monitored count, no key outside of the sketch weighs more than this and no count is over by more than this
+    std::uint64_t GetMinCount()         const { return counterCount < capacity ? 0 : counters[heap[0]].count; }
+    //The guarantee, N / capacity. 'GetMinCount' is never above it and usually a lot tighter
+    std::uint64_t GetErrorBound()       const { return totalWeight / capacity; }
+    std::size_t   GetMemoryUsage()      const
+    {
+        return capacity * (sizeof(Counter) + sizeof(std::uint32_t) + sizeof(std::size_t)) + slotCount * sizeof(std::uint32_t);
+    }
+
+private: //Heap helper functions
+    bool IsLighter(std::size_t leftPosition, std::size_t rightPosition) const
+    {
+        return counters[heap[leftPosition]].count < counters[heap[rightPosition]].count;
+    }
+
+    void SwapHeapPositions(std::size_t leftPosition, std::size_t rightPosition)
+    {
+        std::swap(heap[leftPosition], heap[rightPosition]);
+        heapPositions[heap[leftPosition]]  = leftPosition;
+        heapPositions[heap[rightPosition]] = rightPosition;
+    }
+
+    void SiftUp(std::size_t position)
+    {
+        while(position > 0)
+        {
+            std::size_t parent = (position - 1) / 2;
+            if(!IsLighter(position, parent))
+                return;
+            SwapHeapPositions(position, parent);
+            position = parent;
+        }
+    }
+
+    //Counts only ever grow, so a counter only ever moves down
+    void SiftDown(std::size_t position)
+    {
+        while(true)
+        {
+            std::size_t lightest = position, left = position * 2 + 1, right = left + 1;
+            if(left < counterCount && IsLighter(left, lightest))
+                lightest = left;
+            if(right < counterCount && IsLighter(right, lightest))
+                lightest = right;
+            if(lightest == position)
+                return;
+            SwapHeapPositions(position, lightest);
+            position = lightest;
+        }
+    }
+
+private: //Index helper functions
+    //Slot holding the key, or the empty slot where it would go
+    std::size_t FindSlot(const Key& key) const
+    {
+        std::size_t slot = Hash{}(key) & slotMask;
+        while(slots[slot] != emptySlot && !(counters[slots[slot]].key == key))
+            slot = (slot + 1) & slotMask;
+        return slot;
+    }
+
+    //Backward shift instead of tombstones, probe chains stay as short as they were before the key came in
+    void EraseSlot(std::size_t slot)
+    {
+        std::size_t nextSlot = (slot + 1) & slotMask;
+        while(slots[nextSlot] != emptySlot)
+        {
+            std::size_t idealSlot = Hash{}(counters[slots[nextSlot]].key) & slotMask;
+            //Only move it if its ideal slot isn't between the hole and where it sits now (cyclically)
+            if(((nextSlot - idealSlot) & slotMask) >= ((nextSlot - slot) & slotMask))
+            {
+                slots[slot] = slots[nextSlot];
+                slot        = nextSlot;
+            }
+            nextSlot = (nextSlot + 1) & slotMask;
+        }
+        slots[slot] = emptySlot;
+    }
+
+private: //Sketch stuff
+    std::vector<Counter>       counters;
+    std::vector<std::uint32_t> heap;          //Counter indices, min heap by count
+    std::vector<std::size_t>   heapPositions; //Counter index -> where it is in the heap
+    std::vector<std::uint32_t> slots;         //Key index, counter index or 'emptySlot'
+    std::size_t                capacity         = 0;
+    std::size_t                counterCount     = 0;
+    std::size_t                slotCount        = 0;
+    std::size_t                slotMask         = 0;
+    std::uint64_t              totalWeight      = 0;
+    std::uint64_t              replacementCount = 0;
+    constexpr static std::uint32_t emptySlot    = 0xFFFFFFFF;
+};
+
+#endif
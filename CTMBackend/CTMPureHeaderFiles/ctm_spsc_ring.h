@@ -0,0 +1,100 @@
+#ifndef CTM_SPSC_RING_HPP
+#define CTM_SPSC_RING_HPP
+
+//Stdlib stuff
+#include <atomic>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Bounded single producer, single consumer ring of fixed size records.
+ * The producer never waits: if the ring is full the record is dropped and counted, so a slow consumer can't stall the producer (ETW callback).
+ * Head and tail live on their own cache lines, each side only writes its own index and reads the other one with acquire.
+ * NOTE: This file doesn't include anything from windows on purpose, drive it with a synthetic producer to measure throughput.
+ */
+template<typename T>
+class CTMSpscRing
+{
+public:
+    //Capacity is rounded up to a power of two so the index wraps with a mask
+    explicit CTMSpscRing(std::size_t requestedCapacity)
+    {
+        capacity = 1;
+        while(capacity < requestedCapacity)
+            capacity <<= 1;
+        mask    = capacity - 1;
+        records = std::make_unique<T[]>(capacity);
+    }
+
+    //No need for copy or move operations
+    CTMSpscRing(const CTMSpscRing&)            = delete;
+    CTMSpscRing& operator=(const CTMSpscRing&) = delete;
+    CTMSpscRing(CTMSpscRing&&)                 = delete;
+    CTMSpscRing& operator=(CTMSpscRing&&)      = delete;
+
+public: //Producer side
+    bool Push(const T& record)
+    {
+        if(TryPush(record))
+            return true;
+
+        droppedCount.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    //Same as 'Push' but a full ring isn't counted as a drop, for producers which would rather wait and retry (benchmarks, replays)
+    bool TryPush(const T& record)
+    {
+        std::size_t tail = tailIndex.load(std::memory_order_relaxed);
+        std::size_t head = headIndex.load(std::memory_order_acquire);
+        std::size_t used = tail - head;
+        if(used >= capacity)
+            return false;
+
+        records[tail & mask] = record;
+        tailIndex.store(tail + 1, std::memory_order_release);
+
+        //Only the producer writes this one, a plain load + store is enough
+        if(used + 1 > highWatermark.load(std::memory_order_relaxed))
+            highWatermark.store(used + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+public: //Consumer side
+    //Copies up to 'maxCount' records into the out array, returns how many it copied
+    std::size_t PopBatch(T* outRecords, std::size_t maxCount)
+    {
+        std::size_t head  = headIndex.load(std::memory_order_relaxed);
+        std::size_t tail  = tailIndex.load(std::memory_order_acquire);
+        std::size_t count = tail - head;
+        if(count > maxCount)
+            count = maxCount;
+
+        for(std::size_t i = 0; i < count; i++)
+            outRecords[i] = records[(head + i) & mask];
+
+        //Slots are handed back to the producer only after we are done copying them
+        headIndex.store(head + count, std::memory_order_release);
+        return count;
+    }
+
+public: //Getter functions (any thread, approximate while both sides are running)
+    std::size_t   GetCapacity()      const { return capacity; }
+    std::size_t   GetSize()          const { return tailIndex.load(std::memory_order_acquire) - headIndex.load(std::memory_order_acquire); }
+    std::size_t   GetHighWatermark() const { return highWatermark.load(std::memory_order_relaxed); }
+    std::uint64_t GetDroppedCount()  const { return droppedCount.load(std::memory_order_relaxed); }
+
+private: //Ring stuff
+    std::unique_ptr<T[]> records;
+    std::size_t          capacity = 0;
+    std::size_t          mask     = 0;
+
+private: //Indices only ever grow, 'tail - head' is the fill level even after they wrap
+    alignas(64) std::atomic<std::size_t>   headIndex     = 0; //Written by the consumer
+    alignas(64) std::atomic<std::size_t>   tailIndex     = 0; //Written by the producer
+    alignas(64) std::atomic<std::size_t>   highWatermark = 0;
+    std::atomic<std::uint64_t>             droppedCount  = 0;
+};
+
+#endif
\ No newline at end of file
@@ -10,6 +10,15 @@ CTMSettingsScreen::CTMSettingsScreen()
     //Page Settings
     currentPageIndex   = stateManager.getSetting(CTMSettingKey::ScreenState, currentPageIndex);
     currentPerfIndex   = stateManager.getSetting(CTMSettingKey::PerfState, currentPerfIndex);
+    //Event Tracing Settings
+    currentEtwBufferSizeIndex     = FindOptionIndex(etwBufferSizeValues, IM_ARRAYSIZE(etwBufferSizeValues),
+                                                    stateManager.getSetting(CTMSettingKey::EtwBufferSizeKB, 0u));
+    currentEtwMinimumBuffersIndex = FindOptionIndex(etwMinimumBufferValues, IM_ARRAYSIZE(etwMinimumBufferValues),
+                                                    stateManager.getSetting(CTMSettingKey::EtwMinimumBuffers, 0u));
+    currentEtwMaximumBuffersIndex = FindOptionIndex(etwMaximumBufferValues, IM_ARRAYSIZE(etwMaximumBufferValues),
+                                                    stateManager.getSetting(CTMSettingKey::EtwMaximumBuffers, 0u));
+    currentEtwFlushTimerIndex     = FindOptionIndex(etwFlushTimerValues, IM_ARRAYSIZE(etwFlushTimerValues),
+                                                    stateManager.getSetting(CTMSettingKey::EtwFlushTimer, 0u));
 
     SetInitialized(true);
 }
@@ -24,6 +33,11 @@ CTMSettingsScreen::~CTMSettingsScreen()
     //Page Settings
     stateManager.setSetting(CTMSettingKey::ScreenState, currentPageIndex);
     stateManager.setSetting(CTMSettingKey::PerfState, currentPerfIndex);
+    //Event Tracing Settings
+    stateManager.setSetting(CTMSettingKey::EtwBufferSizeKB, etwBufferSizeValues[currentEtwBufferSizeIndex]);
+    stateManager.setSetting(CTMSettingKey::EtwMinimumBuffers, etwMinimumBufferValues[currentEtwMinimumBuffersIndex]);
+    stateManager.setSetting(CTMSettingKey::EtwMaximumBuffers, etwMaximumBufferValues[currentEtwMaximumBuffersIndex]);
+    stateManager.setSetting(CTMSettingKey::EtwFlushTimer, etwFlushTimerValues[currentEtwFlushTimerIndex]);
 
     SetInitialized(false);
 }
@@ -49,6 +63,19 @@ void CTMSettingsScreen::OnRender()
                     comboBoxWidth, screenPadding.x);
     RenderComboBox("Performance Page", "##DefaultPerformancePage", perfPages, perfPageCount, currentPerfIndex, screenSize,
                     comboBoxWidth, screenPadding.x);
+
+    ImGui::Dummy({0, 20.0f});
+    //Section 3: Event tracing settings
+    RenderSectionTitle("Event Tracing Settings", screenSize);
+    RenderComboBox("Buffer Size", "##EtwBufferSize", etwBufferSizes, IM_ARRAYSIZE(etwBufferSizes), currentEtwBufferSizeIndex, screenSize,
+                    comboBoxWidth, screenPadding.x);
+    RenderComboBox("Minimum Buffers", "##EtwMinimumBuffers", etwMinimumBuffers, IM_ARRAYSIZE(etwMinimumBuffers), currentEtwMinimumBuffersIndex,
+                    screenSize, comboBoxWidth, screenPadding.x);
+    RenderComboBox("Maximum Buffers", "##EtwMaximumBuffers", etwMaximumBuffers, IM_ARRAYSIZE(etwMaximumBuffers), currentEtwMaximumBuffersIndex,
+                    screenSize, comboBoxWidth, screenPadding.x);
+    RenderComboBox("Flush Timer", "##EtwFlushTimer", etwFlushTimers, IM_ARRAYSIZE(etwFlushTimers), currentEtwFlushTimerIndex, screenSize,
+                    comboBoxWidth, screenPadding.x);
+    ImGui::TextDisabled("Auto sizes them from the CPU count and the busiest rate of the last run. Used the next time the app starts.");
 }
 
 //--------------------HELPER FUNCTIONS--------------------
@@ -63,6 +90,14 @@ void CTMSettingsScreen::RenderSectionTitle(const char* sectionTitle, ImVec2& scr
     ImGui::Separator();
 }
 
+int CTMSettingsScreen::FindOptionIndex(const unsigned int* optionValues, int optionCount, unsigned int value)
+{
+    for(int i = 0; i < optionCount; i++)
+        if(optionValues[i] == value)
+            return i;
+    return 0;
+}
+
 void CTMSettingsScreen::RenderComboBox(const char* text, const char* label, const char** items, int itemCount, int& currentIndex,
         const ImVec2& screenSize, float comboBoxWidth, float comboBoxPadding, ComboBoxOnChangeFuncPtr onChange)
 {
@@ -35,6 +35,8 @@ protected:
 private: //Helper functions
     void RenderSectionTitle(const char*, ImVec2&);
     void RenderComboBox(const char*, const char*, const char**, int, int&, const ImVec2&, float, float, ComboBoxOnChangeFuncPtr = nullptr);
+    //Settings store the value, combo boxes want its index. Values not in the list fall back to 'Auto'
+    static int FindOptionIndex(const unsigned int*, int, unsigned int);
 
 private: //Pointer to the State Manager singleton
     CTMStateManager& stateManager = CTMStateManager::GetInstance();
@@ -53,8 +55,25 @@ private: //Settings variables
     int                  currentPageIndex = static_cast<int>(CTMScreenState::Settings);
     int                  currentPerfIndex = static_cast<int>(CTMPerformanceScreenState::CpuInfo);
     //
-    const char*          mainPages[mainPageCount] = { "Processes", "Performance", "Apps", "Services", "Settings" };
-    const char*          perfPages[perfPageCount] = { "CPU", "Memory", "Network", "Disk" };
+    const char*          mainPages[mainPageCount] = { "Processes", "Performance", "Apps", "Services", "Settings", "Handles", "Modules" };
+    const char*          perfPages[perfPageCount] = { "CPU", "Memory", "Network", "Disk", "DPC/ISR" };
+
+    //----------Event tracing section----------
+    //Buffers of the event tracing session (check ctm_etw_buffer_policy.h), index 0 is 'Auto' everywhere. Used the next time the session starts
+    int                           currentEtwBufferSizeIndex     = 0;
+    int                           currentEtwMinimumBuffersIndex = 0;
+    int                           currentEtwMaximumBuffersIndex = 0;
+    int                           currentEtwFlushTimerIndex     = 0;
+    //
+    const char*                   etwBufferSizes[6]             = { "Auto", "64 KB", "128 KB", "256 KB", "512 KB", "1024 KB" };
+    const char*                   etwMinimumBuffers[5]          = { "Auto", "32", "64", "128", "256" };
+    const char*                   etwMaximumBuffers[6]          = { "Auto", "128", "256", "512", "1024", "2048" };
+    const char*                   etwFlushTimers[4]             = { "Auto", "1 second", "2 seconds", "5 seconds" };
+    //Same order as the above, what the settings store
+    constexpr static unsigned int etwBufferSizeValues[6]        = { 0, 64, 128, 256, 512, 1024 };
+    constexpr static unsigned int etwMinimumBufferValues[5]     = { 0, 32, 64, 128, 256 };
+    constexpr static unsigned int etwMaximumBufferValues[6]     = { 0, 128, 256, 512, 1024, 2048 };
+    constexpr static unsigned int etwFlushTimerValues[4]        = { 0, 1, 2, 5 };
 
 private: //Common variables
     const float comboBoxWidth     = 230.0f;
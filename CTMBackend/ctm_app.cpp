@@ -57,6 +57,8 @@ void CTMApp::Run()
         if(done)
             break;
 
+        appContent.UpdateBackground();
+
         if(HandleOcclusion())
             continue;
         
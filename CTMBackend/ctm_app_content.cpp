@@ -40,6 +40,14 @@ void CTMAppContent::SwitchScreen(CTMScreenState newState)
             currentScreen = std::make_unique<CTMSettingsScreen>();
             break;
 
+        case CTMScreenState::Handles:
+            currentScreen = std::make_unique<CTMHandlesScreen>();
+            break;
+
+        case CTMScreenState::Modules:
+            currentScreen = std::make_unique<CTMModulesScreen>();
+            break;
+
         default:
             currentScreen = nullptr;
             break;
@@ -88,6 +96,10 @@ void CTMAppContent::RenderSidebar(const ImVec2& contentRegion)
                             ImVec4(0.4f, 0.7f, 0.3f, 1.0f), ImVec4(0.3f, 0.5f, 0.2f, 1.0f), [this](){ SwitchScreen(CTMScreenState::Apps); });
         RenderSidebarButton("Srvc", "Services", sidebarButtonSize,
                             ImVec4(0.9f, 0.7f, 0.2f, 1.0f), ImVec4(0.7f, 0.5f, 0.1f, 1.0f), [this](){ SwitchScreen(CTMScreenState::Services); });
+        RenderSidebarButton("Hndl", "Handles", sidebarButtonSize,
+                            ImVec4(0.8f, 0.4f, 0.4f, 1.0f), ImVec4(0.6f, 0.3f, 0.3f, 1.0f), [this](){ SwitchScreen(CTMScreenState::Handles); });
+        RenderSidebarButton("Mods", "Modules", sidebarButtonSize,
+                            ImVec4(0.6f, 0.5f, 0.8f, 1.0f), ImVec4(0.4f, 0.3f, 0.6f, 1.0f), [this](){ SwitchScreen(CTMScreenState::Modules); });
         //Taskbar settings menu
         ImGui::SetCursorPos({0, contentRegion.y - CREGION_SIDEBAR_WIDTH});
         RenderSidebarButton("Stgs", "Settings", sidebarButtonSize,
@@ -108,6 +120,14 @@ void CTMAppContent::RenderCTMContent(const ImVec2& contentRegion)
     ImGui::EndChild();
 }
 
+void CTMAppContent::UpdateBackground()
+{
+    //Providers nobody held for a while get disabled here, screens only acquire and release them
+    eventSessionManager.Update();
+    //Graph history keeps going whichever screen is open, and while the window is minimized
+    performanceHistoryManager.Update();
+}
+
 void CTMAppContent::RenderContent()
 {
     //Place the cursor below the title bar
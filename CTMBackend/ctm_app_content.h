@@ -11,10 +11,14 @@
 #include <memory>
 //My stuff
 #include "CTMGlobalManagers/ctm_state_manager.h"
+#include "CTMGlobalManagers/ctm_event_session_manager.h"
+#include "CTMGlobalManagers/ctm_perf_history_manager.h"
 #include "CTMPerformanceScreen/ctm_perf_screen.h"
 #include "CTMProcessScreen/ctm_process_screen.h"
 #include "CTMSettingsScreen/ctm_settings_screen.h"
 #include "CTMStartupAppsScreen/ctm_startup_apps_screen.h"
+#include "CTMHandlesScreen/ctm_handles_screen.h"
+#include "CTMModulesScreen/ctm_modules_screen.h"
 #include "CTMPureHeaderFiles/ctm_constants.h"
 
 class CTMAppContent
@@ -30,6 +34,8 @@ class CTMAppContent
         CTMAppContent& operator=(CTMAppContent&&)      = delete;
 
     public: //Client region renderer
+        //Global managers which have to keep going even when nothing is rendered (minimized/occluded window)
+        void UpdateBackground();
         void RenderContent();
 
     private: //Render helper functions
@@ -47,6 +53,12 @@ class CTMAppContent
     
     private: //State Manager
         CTMStateManager& stateManager = CTMStateManager::GetInstance();
+
+    private: //Event session, outlives every screen using it
+        CTMEventSessionManager& eventSessionManager = CTMEventSessionManager::GetInstance();
+
+    private: //Performance graph history, sampled for as long as the app runs
+        CTMPerformanceHistoryManager& performanceHistoryManager = CTMPerformanceHistoryManager::GetInstance();
 };
 
 
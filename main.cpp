@@ -29,9 +29,41 @@
 //My stuff
 #include "CTMBackend/ctm_app.h"
 #include "CTMBackend/ctm_misc.h"
+#include "CTMBackend/CTMLaunchProfiler/ctm_launch_profiler.h"
+#include "CTMBackend/CTMEventBenchmark/ctm_event_benchmark.h"
+#include "CTMBackend/CTMAnomalyCheck/ctm_anomaly_check.h"
+#include "CTMBackend/CTMBufferPolicyCheck/ctm_buffer_policy_check.h"
 
 int main(void)
 {
+    //Headless 'CTMApp --profile -- <command>' mode, no window and no administrator rights needed for our own child processes
+    if(CTMLaunchProfiler::IsProfileModeRequested())
+    {
+        CTMMisc::EnableVirtualTerminalProcessing();
+        return CTMLaunchProfiler::RunFromCommandLine();
+    }
+
+    //Headless 'CTMApp --event-benchmark' mode, synthetic or recorded events through the process screen's event path
+    if(CTMEventBenchmark::IsBenchmarkModeRequested())
+    {
+        CTMMisc::EnableVirtualTerminalProcessing();
+        return CTMEventBenchmark::RunFromCommandLine();
+    }
+
+    //Headless 'CTMApp --anomaly-check' mode, recorded CPU/memory traces through the same detectors the app uses
+    if(CTMAnomalyCheck::IsCheckModeRequested())
+    {
+        CTMMisc::EnableVirtualTerminalProcessing();
+        return CTMAnomalyCheck::RunFromCommandLine();
+    }
+
+    //Headless 'CTMApp --buffer-policy-check' mode, the ETW buffer sizing against cases worked out by hand
+    if(CTMBufferPolicyCheck::IsCheckModeRequested())
+    {
+        CTMMisc::EnableVirtualTerminalProcessing();
+        return CTMBufferPolicyCheck::RunFromCommandLine();
+    }
+
     //Prompt user to run this process as Administrator if it isn't running as Administrator already
     if(!CTMMisc::IsUserAdmin())
     {